@@ -1302,7 +1302,8 @@ Return Value:
     CK_ASSERT(CK_CAN_POP(Fiber, 1));
 
     DictValue = CkpGetStackIndex(Vm, StackIndex);
-    Key = CK_POP(Fiber);
+    Key = *CkpGetStackIndex(Vm, -1);
+    Fiber->StackTop -= 1;
     if (!CK_IS_DICT(*DictValue)) {
         return FALSE;
     }
@@ -1356,7 +1357,7 @@ Return Value:
     CK_ASSERT(CK_CAN_POP(Fiber, 2));
 
     DictValue = CkpGetStackIndex(Vm, StackIndex);
-    Key = Fiber->StackTop - 2;
+    Key = CkpGetStackIndex(Vm, -2);
     Value = Fiber->StackTop - 1;
     if (CK_IS_DICT(*DictValue)) {
         CkpDictSet(Vm, CK_AS_DICT(*DictValue), *Key, *Value);
@@ -1406,7 +1407,7 @@ Return Value:
     CK_ASSERT(CK_CAN_POP(Fiber, 1));
 
     DictValue = CkpGetStackIndex(Vm, StackIndex);
-    Key = Fiber->StackTop - 1;
+    Key = CkpGetStackIndex(Vm, -1);
     if (CK_IS_DICT(*DictValue)) {
         CkpDictRemove(Vm, CK_AS_DICT(*DictValue), *Key);
     }
@@ -1710,6 +1711,7 @@ Return Value:
     Value = *(Fiber->StackTop - 1);
     if (ListIndex == List->Elements.Count) {
         CkpArrayAppend(Vm, &(List->Elements), Value);
+        CK_WRITE_BARRIER(Vm, &(List->Header));
 
     } else if ((ListIndex < List->Elements.Count) ||
                (-ListIndex <= (INTN)List->Elements.Count)) {
@@ -1720,6 +1722,7 @@ Return Value:
         CK_ASSERT(Index < List->Elements.Count);
 
         List->Elements.Data[Index] = Value;
+        CK_WRITE_BARRIER(Vm, &(List->Header));
     }
 
     Fiber->StackTop -= 1;
@@ -2169,6 +2172,7 @@ Return Value:
 {
 
     PCK_FIBER Fiber;
+    PCK_OBJECT Instance;
     PCK_VALUE Value;
 
     Fiber = Vm->Fiber;
@@ -2182,6 +2186,8 @@ Return Value:
     }
 
     *Value = CK_POP(Fiber);
+    Instance = CK_AS_OBJECT(Fiber->Frames[Fiber->FrameCount - 1].StackStart[0]);
+    CK_WRITE_BARRIER(Vm, Instance);
     return;
 }
 
@@ -2297,6 +2303,7 @@ Return Value:
     Value = CkpFindModuleVariable(Vm, Module, Name, TRUE);
     if (Value != NULL) {
         *Value = CK_POP(Fiber);
+        CK_WRITE_BARRIER(Vm, &(Module->Header));
 
     } else {
         Fiber->StackTop -= 1;
@@ -2786,6 +2793,16 @@ Return Value:
 
     CK_ASSERT((Value >= Stack) && (Value < Fiber->StackTop));
 
+    //
+    // C code may look directly at the contents of strings it gets from the
+    // stack, so make sure ropes are flattened first. On allocation failure
+    // the rope stays as it is and appears to have no value.
+    //
+
+    if (CK_IS_ROPE(*Value)) {
+        CkpStringFlatten(Vm, CK_AS_STRING(*Value));
+    }
+
     return Value;
 }
 
@@ -49,7 +49,7 @@ Module Name:
 // Define the current freeze file format version.
 //
 
-#define CK_FREEZE_VERSION 1
+#define CK_FREEZE_VERSION 2
 
 //
 // ------------------------------------------------------ Data Type Definitions
@@ -167,7 +167,8 @@ CkpThawList (
     PCK_MODULE Module,
     PCSTR *Contents,
     PUINTN Size,
-    PCK_VALUE_ARRAY List
+    PCK_VALUE_ARRAY List,
+    PCK_OBJECT Owner
     );
 
 PCK_STRING
@@ -470,10 +471,13 @@ Return Value:
                                     &Size,
                                     &(Module->Closure));
 
+            CK_WRITE_BARRIER(Vm, &(Module->Header));
+
         } else if ((NameSize == 4) &&
                    (CkCompareMemory(Name, "Path", 4) == 0)) {
 
             Module->Path = CkpThawString(Vm, &Contents, &Size);
+            CK_WRITE_BARRIER(Vm, &(Module->Header));
 
         } else if ((NameSize == 17) &&
                    (CkCompareMemory(Name, "CoreVariableCount", 17) == 0)) {
@@ -1184,6 +1188,8 @@ Return Value:
         return FALSE;
     }
 
+    CK_WRITE_BARRIER(Vm, &(Module->Header));
+
     CkpPopRoot(Vm);
     Result = TRUE;
     *Contents += 2;
@@ -1204,7 +1210,8 @@ Return Value:
                                  Module,
                                  Contents,
                                  Size,
-                                 &(Function->Constants));
+                                 &(Function->Constants),
+                                 &(Function->Header));
 
         } else if ((NameSize == 8) &&
                    (CkCompareMemory(Name, "MaxStack", 8) == 0)) {
@@ -1230,6 +1237,9 @@ Return Value:
             Function->Debug.Name = CkpThawString(Vm, Contents, Size);
             if (Function->Debug.Name == NULL) {
                 Result = FALSE;
+
+            } else {
+                CK_WRITE_BARRIER(Vm, &(Function->Header));
             }
 
         } else if ((NameSize == 9) &&
@@ -1376,7 +1386,13 @@ Return Value:
     CK_VALUE Value;
 
     StartIndex = Table->List.Count;
-    if (!CkpThawList(Vm, Module, Contents, Size, &(Table->List))) {
+    if (!CkpThawList(Vm,
+                     Module,
+                     Contents,
+                     Size,
+                     &(Table->List),
+                     &(Module->Header))) {
+
         return FALSE;
     }
 
@@ -1403,7 +1419,8 @@ CkpThawList (
     PCK_MODULE Module,
     PCSTR *Contents,
     PUINTN Size,
-    PCK_VALUE_ARRAY List
+    PCK_VALUE_ARRAY List,
+    PCK_OBJECT Owner
     )
 
 /*++
@@ -1426,6 +1443,8 @@ Routine Description:
 
     List - Supplies a pointer to a list to thaw.
 
+    Owner - Supplies a pointer to the object that contains the list.
+
 Return Value:
 
     Returns a pointer to the string on success.
@@ -1473,6 +1492,7 @@ Return Value:
         //
 
         CkpArrayAppend(Vm, List, Value);
+        CK_WRITE_BARRIER(Vm, Owner);
         if (Index != Count - 1) {
             if ((*Size <= 2) || (**Contents != ',')) {
                 return FALSE;
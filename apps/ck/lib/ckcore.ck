@@ -529,6 +529,52 @@ class String {
     }
 }
 
+//
+// Define a mutable string builder. Appended values are converted to strings
+// and collected, then joined together once when the result is requested.
+//
+
+class StringBuilder {
+    var _length;
+    var _pieces;
+
+    function __init() {
+        _length = 0;
+        _pieces = [];
+        return this;
+    }
+
+    function append(value) {
+        var piece = value.__str();
+
+        _pieces.append(piece);
+        _length += piece.length();
+        return this;
+    }
+
+    function clear() {
+        _length = 0;
+        _pieces = [];
+        return this;
+    }
+
+    function length() {
+        return _length;
+    }
+
+    function __str() {
+        if (_pieces.length() == 0) {
+            return "";
+        }
+
+        if (_pieces.length() > 1) {
+            _pieces = ["".joinList(_pieces)];
+        }
+
+        return _pieces[0];
+    }
+}
+
 class Function {}
 class Dict {}
 class Range {}
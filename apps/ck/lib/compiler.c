@@ -659,6 +659,7 @@ Return Value:
     }
 
     Compiler->Function->Debug.Name = CK_AS_STRING(Value);
+    CK_WRITE_BARRIER(Compiler->Parser->Vm, &(Compiler->Function->Header));
 
     //
     // Don't return the function if there were any errors along the way
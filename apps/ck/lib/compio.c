@@ -163,6 +163,23 @@ CHAR CkOpcodeStackEffects[CkOpcodeCount] = {
     -2, // CkOpStaticMethod
     0,  // CkOpTry
     0,  // CkOpPopTry
+    -1, // CkOpAdd
+    -1,
+    -1,
+    -1,
+    -1,
+    -1,
+    -1,
+    -1,
+    -1,
+    -1,
+    -1, // CkOpIsNotEqual
+    -1, // CkOpLessThanJump
+    -1,
+    -1,
+    -1,
+    -1,
+    -1, // CkOpIsNotEqualJump
     0,  // CkOpEnd
 };
 
@@ -238,6 +255,23 @@ UCHAR CkCompilerOperandSizes[CkOpcodeCount] = {
     2, // CkOpStaticMethod
     2, // CkOpTry
     0, // CkOpPopTry
+    2, // CkOpAdd
+    2,
+    2,
+    2,
+    2,
+    2,
+    2,
+    2,
+    2,
+    2,
+    2, // CkOpIsNotEqual
+    2, // CkOpLessThanJump
+    2,
+    2,
+    2,
+    2,
+    2, // CkOpIsNotEqualJump
     0, // CkOpEnd
 };
 
@@ -444,8 +478,11 @@ Return Value:
 {
 
     PSTR Method;
+    CK_OPCODE Op;
+    CK_SYMBOL_INDEX Symbol;
 
     Method = NULL;
+    Op = CkOpNop;
     if (Arguments == 1) {
 
         CK_ASSERT((Assign == FALSE) ||
@@ -469,18 +506,22 @@ Return Value:
 
         case CkTokenLessOrEqual:
             Method = "__le@1";
+            Op = CkOpLessOrEqual;
             break;
 
         case CkTokenGreaterOrEqual:
             Method = "__ge@1";
+            Op = CkOpGreaterOrEqual;
             break;
 
         case CkTokenIsEqual:
             Method = "__eq@1";
+            Op = CkOpIsEqual;
             break;
 
         case CkTokenIsNotEqual:
             Method = "__ne@1";
+            Op = CkOpIsNotEqual;
             break;
 
         case CkTokenOpenBracket:
@@ -501,34 +542,41 @@ Return Value:
         case CkTokenMinus:
         case CkTokenSubtractAssign:
             Method = "__sub@1";
+            Op = CkOpSubtract;
             break;
 
         case CkTokenPlus:
         case CkTokenAddAssign:
             Method = "__add@1";
+            Op = CkOpAdd;
             break;
 
         case CkTokenAsterisk:
         case CkTokenMultiplyAssign:
             Method = "__mul@1";
+            Op = CkOpMultiply;
             break;
 
         case CkTokenDivide:
         case CkTokenDivideAssign:
             Method = "__div@1";
+            Op = CkOpDivide;
             break;
 
         case CkTokenModulo:
         case CkTokenModuloAssign:
             Method = "__mod@1";
+            Op = CkOpModulo;
             break;
 
         case CkTokenLessThan:
             Method = "__lt@1";
+            Op = CkOpLessThan;
             break;
 
         case CkTokenGreaterThan:
             Method = "__gt@1";
+            Op = CkOpGreaterThan;
             break;
 
         case CkTokenXor:
@@ -609,6 +657,17 @@ Return Value:
         Arguments += 1;
     }
 
+    //
+    // Arithmetic and comparison operators get their own opcodes, which run
+    // inline for integers and only call the method for other types.
+    //
+
+    if (Op != CkOpNop) {
+        Symbol = CkpGetMethodSymbol(Compiler, Method, strlen(Method));
+        CkpEmitShortOp(Compiler, Op, Symbol);
+        return;
+    }
+
     CkpEmitMethodCall(Compiler, Arguments, Method, strlen(Method));
     return;
 }
@@ -885,8 +944,25 @@ Return Value:
 
 {
 
+    PUCHAR Code;
     UINTN Offset;
 
+    //
+    // If a conditional jump directly follows a comparison, convert the
+    // comparison to its fused form, which performs the jump too when both
+    // operands are integers. The jump instruction itself is still emitted so
+    // that the slow path has something to execute.
+    //
+
+    if ((Op == CkOpJumpIf) &&
+        (Compiler->LastOpcode < Compiler->Function->Code.Count)) {
+
+        Code = Compiler->Function->Code.Data + Compiler->LastOpcode;
+        if ((*Code >= CkOpLessThan) && (*Code <= CkOpIsNotEqual)) {
+            *Code += CkOpLessThanJump - CkOpLessThan;
+        }
+    }
+
     CkpEmitOp(Compiler, Op);
     Offset = Compiler->Function->Code.Count;
     CkpEmitShort(Compiler, -1);
@@ -1042,6 +1118,7 @@ Return Value:
     assert(Opcode <= CkOpEnd);
 
     Offset = Compiler->Function->Code.Count;
+    Compiler->LastOpcode = Offset;
     CkpEmitByte(Compiler, Opcode);
     Compiler->StackSlots += CkOpcodeStackEffects[Opcode];
     if (Compiler->StackSlots > Compiler->Function->MaxStack) {
@@ -343,6 +343,10 @@ Structure Description:
         operation. Initially this is NULL. This is used to determine if the
         previous opcode can be updated to accomodate the next bytecode.
 
+    LastOpcode - Stores the bytecode offset of the most recently emitted
+        opcode. This is used to fuse a comparison with the conditional jump
+        that follows it.
+
     Assign - Stores a boolean indicating whether the next primary expression
         needs to be an lvalue or not.
 
@@ -375,6 +379,7 @@ struct _CK_COMPILER {
     INT PreviousLine;
     UINTN LineOffset;
     PUCHAR LastLineOp;
+    UINTN LastOpcode;
     BOOL Assign;
     UINTN FinallyOffset;
     ULONG Flags;
@@ -883,6 +883,9 @@ Return Value:
                        &(Compiler->Function->Constants),
                        Constant);
 
+        CK_WRITE_BARRIER(Compiler->Parser->Vm,
+                         &(Compiler->Function->Header));
+
         if (CK_IS_OBJECT(Constant)) {
             CkpPopRoot(Compiler->Parser->Vm);
         }
@@ -66,7 +66,16 @@ CkpCoreAddPrimitive (
     PCK_CLASS Class,
     PSTR Name,
     CK_ARITY Arity,
-    PCK_PRIMITIVE_FUNCTION Function
+    PCK_PRIMITIVE_FUNCTION Function,
+    ULONG Flags
+    );
+
+VOID
+CkpCoreSetStatistic (
+    PCK_VM Vm,
+    PCK_DICT Dict,
+    PCSTR Name,
+    CK_VALUE Value
     );
 
 BOOL
@@ -183,6 +192,12 @@ CkpCoreGarbageCollect (
     PCK_VALUE Arguments
     );
 
+BOOL
+CkpCoreGarbageStatistics (
+    PCK_VM Vm,
+    PCK_VALUE Arguments
+    );
+
 BOOL
 CkpCoreImportModule (
     PCK_VM Vm,
@@ -275,6 +290,7 @@ CK_PRIMITIVE_DESCRIPTION CkFunctionPrimitives[] = {
 
 CK_PRIMITIVE_DESCRIPTION CkCorePrimitives[] = {
     {"gc@0", 0, CkpCoreGarbageCollect},
+    {"gcStatistics@0", 0, CkpCoreGarbageStatistics},
     {"importModule@1", 1, CkpCoreImportModule},
     {"_write@1", 1, CkpCoreWrite},
     {"modules@0", 0, CkpCoreGetModules},
@@ -316,6 +332,8 @@ Return Value:
     PCK_BUILTIN_CLASSES Classes;
     PCK_MODULE CoreModule;
     CK_ERROR_TYPE Error;
+    ULONG Index;
+    PCK_OBJECT Lists[3];
     PCK_OBJECT Object;
     PCK_CLASS ObjectMeta;
     UINTN Size;
@@ -371,7 +389,9 @@ Return Value:
     }
 
     Classes->Object->Header.Class = ObjectMeta;
+    CK_WRITE_BARRIER(Vm, &(Classes->Object->Header));
     ObjectMeta->Header.Class = Classes->Class;
+    CK_WRITE_BARRIER(Vm, &(ObjectMeta->Header));
     Classes->Class->Header.Class = Classes->Class;
     CkpBindSuperclass(Vm, ObjectMeta, Classes->Class);
 
@@ -443,25 +463,32 @@ Return Value:
     // associated classes existed.
     //
 
-    Object = Vm->FirstObject;
-    while (Object != NULL) {
-        if (Object->Type == CkObjectString) {
-            Object->Class = Classes->String;
+    Lists[0] = Vm->FirstObject;
+    Lists[1] = Vm->OldObjects;
+    Lists[2] = Vm->SweepObjects;
+    for (Index = 0; Index < 3; Index += 1) {
+        Object = Lists[Index];
+        while (Object != NULL) {
+            if (Object->Type == CkObjectString) {
+                Object->Class = Classes->String;
 
-        } else if (Object->Type == CkObjectClosure) {
-            Object->Class = Classes->Function;
+            } else if (Object->Type == CkObjectClosure) {
+                Object->Class = Classes->Function;
 
-        } else if (Object->Type == CkObjectDict) {
-            Object->Class = Classes->Dict;
+            } else if (Object->Type == CkObjectDict) {
+                Object->Class = Classes->Dict;
 
-        } else if (Object->Type == CkObjectFiber) {
-            Object->Class = Classes->Fiber;
-        }
+            } else if (Object->Type == CkObjectFiber) {
+                Object->Class = Classes->Fiber;
+            }
 
-        Object = Object->Next;
+            CK_WRITE_BARRIER(Vm, Object);
+            Object = Object->Next;
+        }
     }
 
     CoreModule->Header.Class = Classes->Module;
+    CK_WRITE_BARRIER(Vm, &(CoreModule->Header));
 
     //
     // Set some flags on the special builtin classes.
@@ -726,7 +753,8 @@ Return Value:
                             Class,
                             Primitives->Name,
                             Primitives->Arity,
-                            Primitives->Primitive);
+                            Primitives->Primitive,
+                            Primitives->Flags);
 
         Primitives += 1;
     }
@@ -740,7 +768,8 @@ CkpCoreAddPrimitive (
     PCK_CLASS Class,
     PSTR Name,
     CK_ARITY Arity,
-    PCK_PRIMITIVE_FUNCTION Function
+    PCK_PRIMITIVE_FUNCTION Function,
+    ULONG Flags
     )
 
 /*++
@@ -763,6 +792,8 @@ Routine Description:
 
     Function - Supplies a pointer to the C function to attach to this method.
 
+    Flags - Supplies object header flags to set on the new closure.
+
 Return Value:
 
     None.
@@ -789,10 +820,66 @@ Return Value:
                                         CK_AS_STRING(NameString),
                                         Arity);
 
+    if (Closure != NULL) {
+        Closure->Header.Flags |= Flags;
+    }
+
     CkpBindMethod(Vm, Class, NameString, Closure);
     return;
 }
 
+VOID
+CkpCoreSetStatistic (
+    PCK_VM Vm,
+    PCK_DICT Dict,
+    PCSTR Name,
+    CK_VALUE Value
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sets a named value in a statistics dictionary.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    Dict - Supplies a pointer to the dictionary to add to.
+
+    Name - Supplies a pointer to the null terminated key name.
+
+    Value - Supplies the value to set.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    CK_VALUE Key;
+
+    if (CK_IS_OBJECT(Value)) {
+        CkpPushRoot(Vm, CK_AS_OBJECT(Value));
+    }
+
+    Key = CkpStringCreate(Vm, Name, strlen(Name));
+    if (!CK_IS_NULL(Key)) {
+        CkpPushRoot(Vm, CK_AS_OBJECT(Key));
+        CkpDictSet(Vm, Dict, Key, Value);
+        CkpPopRoot(Vm);
+    }
+
+    if (CK_IS_OBJECT(Value)) {
+        CkpPopRoot(Vm);
+    }
+
+    return;
+}
+
 BOOL
 CkpObjectInit (
     PCK_VM Vm,
@@ -1177,6 +1264,7 @@ Return Value:
         }
 
         CK_OBJECT_VALUE(Instance->Fields[0], Dict);
+        CK_WRITE_BARRIER(Vm, &(Instance->Header));
 
     } else {
         Dict = CK_AS_DICT(Instance->Fields[0]);
@@ -1646,6 +1734,95 @@ Return Value:
     return TRUE;
 }
 
+BOOL
+CkpCoreGarbageStatistics (
+    PCK_VM Vm,
+    PCK_VALUE Arguments
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns a dictionary of garbage collector statistics.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    Arguments - Supplies the function arguments.
+
+Return Value:
+
+    TRUE on success.
+
+    FALSE if execution caused a runtime error.
+
+--*/
+
+{
+
+    PCK_DICT Dict;
+    UINTN Index;
+    PCK_LIST List;
+    CK_GC_STATISTICS Statistics;
+    CK_VALUE Value;
+
+    //
+    // Snapshot the statistics, since creating the result may itself cause
+    // garbage collections.
+    //
+
+    CkCopy(&Statistics, &(Vm->GcStatistics), sizeof(CK_GC_STATISTICS));
+    Dict = CkpDictCreate(Vm);
+    if (Dict == NULL) {
+        return FALSE;
+    }
+
+    CkpPushRoot(Vm, &(Dict->Header));
+    CK_INT_VALUE(Value, Statistics.YoungCollections);
+    CkpCoreSetStatistic(Vm, Dict, "youngCollections", Value);
+    CK_INT_VALUE(Value, Statistics.MajorCollections);
+    CkpCoreSetStatistic(Vm, Dict, "majorCollections", Value);
+    CK_INT_VALUE(Value, Statistics.FullCollections);
+    CkpCoreSetStatistic(Vm, Dict, "fullCollections", Value);
+    CK_INT_VALUE(Value, Statistics.ObjectsFreed);
+    CkpCoreSetStatistic(Vm, Dict, "objectsFreed", Value);
+    CK_INT_VALUE(Value, Statistics.TotalPause);
+    CkpCoreSetStatistic(Vm, Dict, "totalPause", Value);
+    CK_INT_VALUE(Value, Statistics.MaxPause);
+    CkpCoreSetStatistic(Vm, Dict, "maxPause", Value);
+    CK_INT_VALUE(Value, Vm->OldBytes);
+    CkpCoreSetStatistic(Vm, Dict, "oldBytes", Value);
+    CK_INT_VALUE(Value, Vm->YoungBytes);
+    CkpCoreSetStatistic(Vm, Dict, "youngBytes", Value);
+    List = CkpListCreate(Vm, CK_GC_PAUSE_BUCKETS);
+    if (List != NULL) {
+        for (Index = 0; Index < CK_GC_PAUSE_BUCKETS; Index += 1) {
+            CK_INT_VALUE(List->Elements.Data[Index],
+                         Statistics.YoungPauses[Index]);
+        }
+
+        CK_OBJECT_VALUE(Value, List);
+        CkpCoreSetStatistic(Vm, Dict, "youngPauses", Value);
+    }
+
+    List = CkpListCreate(Vm, CK_GC_PAUSE_BUCKETS);
+    if (List != NULL) {
+        for (Index = 0; Index < CK_GC_PAUSE_BUCKETS; Index += 1) {
+            CK_INT_VALUE(List->Elements.Data[Index],
+                         Statistics.MajorPauses[Index]);
+        }
+
+        CK_OBJECT_VALUE(Value, List);
+        CkpCoreSetStatistic(Vm, Dict, "majorPauses", Value);
+    }
+
+    CkpPopRoot(Vm);
+    CK_OBJECT_VALUE(Arguments[0], Dict);
+    return TRUE;
+}
+
 BOOL
 CkpCoreImportModule (
     PCK_VM Vm,
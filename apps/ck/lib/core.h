@@ -50,12 +50,16 @@ Structure Description:
     Primitive - Stores a pointer to the primitive function to call for the
         function
 
+    Flags - Stores object header flags to set on the closure. See
+        CK_OBJECT_* definitions.
+
 --*/
 
 typedef struct _CK_PRIMITIVE_DESCRIPTION {
     PSTR Name;
     CK_ARITY Arity;
     PCK_PRIMITIVE_FUNCTION Primitive;
+    ULONG Flags;
 } CK_PRIMITIVE_DESCRIPTION, *PCK_PRIMITIVE_DESCRIPTION;
 
 //
@@ -135,6 +135,23 @@ PSTR CkOpcodeNames[CkOpcodeCount] = {
     "StaticMethod",
     "Try",
     "PopTry",
+    "Add",
+    "Subtract",
+    "Multiply",
+    "Divide",
+    "Modulo",
+    "LessThan",
+    "LessOrEqual",
+    "GreaterThan",
+    "GreaterOrEqual",
+    "IsEqual",
+    "IsNotEqual",
+    "LessThanJump",
+    "LessOrEqualJump",
+    "GreaterThanJump",
+    "GreaterOrEqualJump",
+    "IsEqualJump",
+    "IsNotEqualJump",
     "End"
 };
 
@@ -509,6 +526,23 @@ Return Value:
     case CkOpSuperCall8:
     case CkOpMethod:
     case CkOpStaticMethod:
+    case CkOpAdd:
+    case CkOpSubtract:
+    case CkOpMultiply:
+    case CkOpDivide:
+    case CkOpModulo:
+    case CkOpLessThan:
+    case CkOpLessOrEqual:
+    case CkOpGreaterThan:
+    case CkOpGreaterOrEqual:
+    case CkOpIsEqual:
+    case CkOpIsNotEqual:
+    case CkOpLessThanJump:
+    case CkOpLessOrEqualJump:
+    case CkOpGreaterThanJump:
+    case CkOpGreaterOrEqualJump:
+    case CkOpIsEqualJump:
+    case CkOpIsNotEqualJump:
         Symbol = CK_READ16(ByteCode + Offset);
         Offset += 2;
 
@@ -826,7 +860,15 @@ Return Value:
         break;
 
     case CkObjectString:
-        CkpDebugPrint(Vm, "\"%s\"", ((PCK_STRING)Object)->Value);
+        if (((PCK_STRING)Object)->Value == NULL) {
+            CkpDebugPrint(Vm,
+                          "<rope of %lld bytes>",
+                          (LONGLONG)(((PCK_STRING)Object)->Length));
+
+        } else {
+            CkpDebugPrint(Vm, "\"%s\"", ((PCK_STRING)Object)->Value);
+        }
+
         break;
 
     case CkObjectClass:
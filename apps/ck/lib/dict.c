@@ -179,12 +179,12 @@ CkpHashObject (
 
 CK_PRIMITIVE_DESCRIPTION CkDictPrimitives[] = {
     {"get@1", 1, CkpDictGetPrimitive},
-    {"set@2", 2, CkpDictSetPrimitive},
+    {"set@2", 2, CkpDictSetPrimitive, CK_OBJECT_STORES_LAST_ARGUMENT},
     {"remove@1", 1, CkpDictRemovePrimitive},
     {"__get@1", 1, CkpDictSlice},
-    {"__set@2", 2, CkpDictSliceAssign},
+    {"__set@2", 2, CkpDictSliceAssign, CK_OBJECT_STORES_LAST_ARGUMENT},
     {"__slice@1", 1, CkpDictSlice},
-    {"__sliceAssign@2", 2, CkpDictSliceAssign},
+    {"__sliceAssign@2", 2, CkpDictSliceAssign, CK_OBJECT_STORES_LAST_ARGUMENT},
     {"clear@0", 0, CkpDictClearPrimitive},
     {"containsKey@1", 1, CkpDictContainsKey},
     {"length@0", 0, CkpDictLength},
@@ -338,6 +338,7 @@ Return Value:
         Dict->Count += 1;
     }
 
+    CK_WRITE_BARRIER(Vm, &(Dict->Header));
     return;
 }
 
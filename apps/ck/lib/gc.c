@@ -37,11 +37,39 @@ Module Name:
 #include <minoca/lib/yy.h>
 #include "lang.h"
 #include "compsup.h"
+#include <time.h>
 
 //
 // ---------------------------------------------------------------- Definitions
 //
 
+//
+// Define the number of bytes that have to be allocated during an incremental
+// major collection before the collector performs another step.
+//
+
+#define CK_GC_STEP_SIZE (16 * 1024)
+
+//
+// Define the number of objects traversed or swept for each step size worth of
+// allocations.
+//
+
+#define CK_GC_STEP_WORK 1024
+
+//
+// Define the number of objects traversed or swept in each step when stressing
+// the garbage collector.
+//
+
+#define CK_GC_STRESS_WORK 16
+
+//
+// Define the initial capacity of the remembered set.
+//
+
+#define CK_GC_INITIAL_REMEMBERED 64
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -50,6 +78,82 @@ Module Name:
 // ----------------------------------------------- Internal Function Prototypes
 //
 
+VOID
+CkpCollectYoung (
+    PCK_VM Vm
+    );
+
+VOID
+CkpStartMajorCollection (
+    PCK_VM Vm
+    );
+
+VOID
+CkpGcStep (
+    PCK_VM Vm
+    );
+
+VOID
+CkpFinishMarking (
+    PCK_VM Vm
+    );
+
+VOID
+CkpGcSweepStep (
+    PCK_VM Vm,
+    UINTN Work
+    );
+
+VOID
+CkpSetNextCollection (
+    PCK_VM Vm
+    );
+
+VOID
+CkpStartKissing (
+    PCK_VM Vm
+    );
+
+VOID
+CkpKissRoots (
+    PCK_VM Vm
+    );
+
+VOID
+CkpKissRoot (
+    PCK_VM Vm,
+    PCK_OBJECT Object
+    );
+
+VOID
+CkpRekissObject (
+    PCK_VM Vm,
+    PCK_OBJECT Object
+    );
+
+VOID
+CkpRememberRoots (
+    PCK_VM Vm
+    );
+
+VOID
+CkpClearKisses (
+    PCK_VM Vm,
+    PCK_OBJECT List
+    );
+
+ULONGLONG
+CkpGcTimestamp (
+    VOID
+    );
+
+VOID
+CkpGcRecordPause (
+    PCK_VM Vm,
+    PULONG Histogram,
+    ULONGLONG Start
+    );
+
 VOID
 CkpKissCompiler (
     PCK_VM Vm,
@@ -68,15 +172,23 @@ CkpKissObject (
     PCK_OBJECT Object
     );
 
-VOID
+BOOL
 CkpDeeplyKiss (
     PCK_VM Vm,
-    PCK_OBJECT Head
+    UINTN Work
     );
 
 VOID
+CkpKissChildren (
+    PCK_VM Vm,
+    PCK_OBJECT Object
+    );
+
+PCK_OBJECT
 CkpCollectUnkissedObjects (
-    PCK_VM Vm
+    PCK_VM Vm,
+    PCK_OBJECT List,
+    UINTN Work
     );
 
 VOID
@@ -157,17 +269,736 @@ CkpKissValueArray (
     PCK_VALUE_ARRAY Array
     );
 
-//
-// -------------------------------------------------------------------- Globals
-//
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+CK_API
+VOID
+CkCollectGarbage (
+    PCK_VM Vm
+    )
+
+/*++
+
+Routine Description:
+
+    This routine performs a full garbage collection on the given Chalk
+    instance, freeing up unused dynamic memory as appropriate. Any incremental
+    collection in progress is completed or abandoned first.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Index;
+    PCK_OBJECT Lists[2];
+    ULONGLONG Start;
+
+    Start = CkpGcTimestamp();
+
+    //
+    // Finish off any sweep in progress so that all old objects are back on
+    // the old list. Throw away any partial marking, it's all going to be
+    // redone anyway.
+    //
+
+    if (Vm->GcPhase == CkGcSweep) {
+        CkpGcSweepStep(Vm, MAX_UINTN);
+
+    } else if (Vm->GcPhase == CkGcMark) {
+        CkpClearKisses(Vm, Vm->FirstObject);
+        CkpClearKisses(Vm, Vm->OldObjects);
+        Vm->GcPhase = CkGcIdle;
+    }
+
+    CK_ASSERT(Vm->SweepObjects == NULL);
+
+    Vm->GcFlags &= ~(CK_GC_YOUNG_ONLY | CK_GC_REMEMBERED_OVERFLOW);
+    Vm->GarbageRuns += 1;
+    Vm->GarbageFreed = 0;
+    for (Index = 0; Index < Vm->RememberedCount; Index += 1) {
+        Vm->Remembered[Index]->Flags &= ~CK_OBJECT_REMEMBERED;
+    }
+
+    Vm->RememberedCount = 0;
+    CkpStartKissing(Vm);
+    CkpKissRoots(Vm);
+    CkpDeeplyKiss(Vm, MAX_UINTN);
+
+    //
+    // Everything that survives ends up in the old generation.
+    //
+
+    Lists[0] = Vm->FirstObject;
+    Lists[1] = Vm->OldObjects;
+    Vm->FirstObject = NULL;
+    Vm->OldObjects = NULL;
+    for (Index = 0; Index < 2; Index += 1) {
+        CkpCollectUnkissedObjects(Vm, Lists[Index], MAX_UINTN);
+    }
+
+    CkpRememberRoots(Vm);
+    Vm->OldBytes = Vm->KissedBytes;
+    Vm->YoungBytes = 0;
+    Vm->BytesAllocated = Vm->OldBytes;
+    CkpSetNextCollection(Vm);
+    Vm->GcStatistics.FullCollections += 1;
+    CkpGcRecordPause(Vm, Vm->GcStatistics.MajorPauses, Start);
+    return;
+}
+
+VOID
+CkpPushRoot (
+    PCK_VM Vm,
+    PCK_OBJECT Object
+    )
+
+/*++
+
+Routine Description:
+
+    This routine pushes the given object onto a temporary stack to ensure that
+    it will not be garbage collected.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    Object - Supplies a pointer to the object to push.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    CK_ASSERT(Object != NULL);
+    CK_ASSERT(Vm->WorkingObjectCount < CK_MAX_WORKING_OBJECTS);
+
+    Vm->WorkingObjects[Vm->WorkingObjectCount] = Object;
+    Vm->WorkingObjectCount += 1;
+    return;
+}
+
+VOID
+CkpPopRoot (
+    PCK_VM Vm
+    )
+
+/*++
+
+Routine Description:
+
+    This routine pops the top working object off of the temporary stack used to
+    ensure that certain objects are not garbage collected.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    CK_ASSERT(Vm->WorkingObjectCount != 0);
+
+    Vm->WorkingObjectCount -= 1;
+    return;
+}
+
+PVOID
+CkpReallocate (
+    PCK_VM Vm,
+    PVOID Memory,
+    UINTN OldSize,
+    UINTN NewSize
+    )
+
+/*++
+
+Routine Description:
+
+    This routine performs a Chalk dynamic memory operation.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    Memory - Supplies an optional pointer to the memory to resize or free.
+
+    OldSize - Supplies the optional previous size of the allocation.
+
+    NewSize - Supplies the new size of the allocation. Set this to 0 to free
+        the memory.
+
+Return Value:
+
+    Returns a pointer to the newly allocated or reallocated memory on success.
+
+    NULL on allocation failure or for free operations.
+
+--*/
+
+{
+
+    PVOID Allocation;
+    BOOL Stress;
+
+    //
+    // Add the new bytes to the total count. Ignore frees, since those get
+    // handled during garbage collection. Growth also counts towards the
+    // nursery and towards the debt owed to any incremental collection in
+    // progress.
+    //
+
+    Vm->BytesAllocated += NewSize - OldSize;
+    if (NewSize > OldSize) {
+        Vm->YoungBytes += NewSize - OldSize;
+        Vm->GcDebt += NewSize - OldSize;
+    }
+
+    //
+    // Potentially perform garbage collection. Pay down any incremental
+    // collection debt first, then collect the young generation if the nursery
+    // is full. Young collections are held off while marking, since marking
+    // relies on the remembered set staying intact. Finally, kick off a new
+    // major cycle if the old generation has grown enough.
+    //
+
+    if (NewSize > 0) {
+        Stress = CK_VM_FLAG_SET(Vm, CK_CONFIGURATION_GC_STRESS);
+        if ((Vm->GcPhase != CkGcIdle) &&
+            ((Vm->GcDebt >= CK_GC_STEP_SIZE) || (Stress != FALSE))) {
+
+            CkpGcStep(Vm);
+        }
+
+        if ((Vm->GcPhase != CkGcMark) &&
+            ((Vm->YoungBytes >= Vm->Configuration.NurserySize) ||
+             (Stress != FALSE))) {
+
+            CkpCollectYoung(Vm);
+        }
+
+        if ((Vm->GcPhase == CkGcIdle) &&
+            ((Vm->OldBytes >= Vm->NextGarbageCollection) ||
+             (Stress != FALSE))) {
+
+            CkpStartMajorCollection(Vm);
+        }
+    }
+
+    Allocation = CkRawReallocate(Vm, Memory, NewSize);
+    if ((Allocation == NULL) && (NewSize != 0)) {
+
+        //
+        // If there's already a memory exception in progress, then this is
+        // serious. Call the emergency function.
+        //
+
+        if (Vm->MemoryException != 0) {
+            CkpError(Vm, CkErrorNoMemory, "Allocation failure");
+
+        } else {
+            Vm->MemoryException += 1;
+            CkpRuntimeError(Vm, "MemoryError", "Allocation failure");
+            Vm->MemoryException -= 1;
+        }
+    }
+
+    return Allocation;
+}
+
+VOID
+CkpRememberObject (
+    PCK_VM Vm,
+    PCK_OBJECT Object
+    )
+
+/*++
+
+Routine Description:
+
+    This routine adds an old object to the remembered set, causing it to be
+    rescanned during the next young collection. This is usually called via
+    the write barrier macro.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    Object - Supplies a pointer to the object that was written to.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PCK_OBJECT *NewArray;
+    UINTN NewCapacity;
+
+    if ((Object->Flags & CK_OBJECT_REMEMBERED) != 0) {
+        return;
+    }
+
+    //
+    // Grow the array if needed. This uses the raw allocator since a
+    // collection cannot be allowed to start here. If the allocation fails,
+    // fall back to a full collection next time, which does not need the
+    // remembered set.
+    //
+
+    if (Vm->RememberedCount >= Vm->RememberedCapacity) {
+        NewCapacity = Vm->RememberedCapacity * 2;
+        if (NewCapacity == 0) {
+            NewCapacity = CK_GC_INITIAL_REMEMBERED;
+        }
+
+        NewArray = CkRawReallocate(Vm,
+                                   Vm->Remembered,
+                                   NewCapacity * sizeof(PCK_OBJECT));
+
+        if (NewArray == NULL) {
+            Vm->GcFlags |= CK_GC_REMEMBERED_OVERFLOW;
+            return;
+        }
+
+        Vm->Remembered = NewArray;
+        Vm->RememberedCapacity = NewCapacity;
+    }
+
+    Object->Flags |= CK_OBJECT_REMEMBERED;
+    Vm->Remembered[Vm->RememberedCount] = Object;
+    Vm->RememberedCount += 1;
+    return;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+VOID
+CkpCollectYoung (
+    PCK_VM Vm
+    )
+
+/*++
+
+Routine Description:
+
+    This routine collects the young generation. Objects reachable from the
+    roots or from the remembered set survive and are promoted to the old
+    generation.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Count;
+    UINTN Index;
+    PCK_OBJECT Object;
+    ULONGLONG Start;
+    PCK_OBJECT Young;
+
+    CK_ASSERT(Vm->GcPhase != CkGcMark);
+
+    //
+    // If the remembered set is incomplete, then a young collection might miss
+    // something. Do the whole thing.
+    //
+
+    if ((Vm->GcFlags & CK_GC_REMEMBERED_OVERFLOW) != 0) {
+        CkCollectGarbage(Vm);
+        return;
+    }
+
+    Start = CkpGcTimestamp();
+    Vm->GarbageRuns += 1;
+    Vm->GarbageFreed = 0;
+    Vm->GcFlags |= CK_GC_YOUNG_ONLY;
+    CkpStartKissing(Vm);
+    CkpKissRoots(Vm);
+
+    //
+    // Rescan the old objects that have been written to. Fibers stay in the
+    // remembered set for as long as they live, since their stacks are written
+    // without barriers.
+    //
+
+    Count = 0;
+    for (Index = 0; Index < Vm->RememberedCount; Index += 1) {
+        Object = Vm->Remembered[Index];
+        CkpRekissObject(Vm, Object);
+        if (Object->Type == CkObjectFiber) {
+            Vm->Remembered[Count] = Object;
+            Count += 1;
+
+        } else {
+            Object->Flags &= ~CK_OBJECT_REMEMBERED;
+        }
+    }
+
+    Vm->RememberedCount = Count;
+    CkpDeeplyKiss(Vm, MAX_UINTN);
+    Young = Vm->FirstObject;
+    Vm->FirstObject = NULL;
+    CkpCollectUnkissedObjects(Vm, Young, MAX_UINTN);
+    Vm->GcFlags &= ~CK_GC_YOUNG_ONLY;
+    CkpRememberRoots(Vm);
+    Vm->OldBytes += Vm->KissedBytes;
+    Vm->YoungBytes = 0;
+    Vm->BytesAllocated = Vm->OldBytes;
+    Vm->GcStatistics.YoungCollections += 1;
+    CkpGcRecordPause(Vm, Vm->GcStatistics.YoungPauses, Start);
+    return;
+}
+
+VOID
+CkpStartMajorCollection (
+    PCK_VM Vm
+    )
+
+/*++
+
+Routine Description:
+
+    This routine begins an incremental collection of the old generation. The
+    young generation is collected first so that marking starts with an empty
+    nursery.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONGLONG Start;
+
+    CK_ASSERT(Vm->GcPhase == CkGcIdle);
+
+    CkpCollectYoung(Vm);
+    Start = CkpGcTimestamp();
+    Vm->GcPhase = CkGcMark;
+    Vm->GcDebt = 0;
+    CkpStartKissing(Vm);
+    CkpKissRoots(Vm);
+    Vm->GcStatistics.MajorCollections += 1;
+    CkpGcRecordPause(Vm, Vm->GcStatistics.MajorPauses, Start);
+    return;
+}
+
+VOID
+CkpGcStep (
+    PCK_VM Vm
+    )
+
+/*++
+
+Routine Description:
+
+    This routine performs a bounded amount of incremental major collection
+    work, proportional to the amount allocated since the last step.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONGLONG Start;
+    UINTN Work;
+
+    if ((Vm->GcFlags & CK_GC_REMEMBERED_OVERFLOW) != 0) {
+        CkCollectGarbage(Vm);
+        return;
+    }
+
+    Start = CkpGcTimestamp();
+    Work = (Vm->GcDebt / CK_GC_STEP_SIZE) * CK_GC_STEP_WORK;
+    if (Work == 0) {
+        Work = CK_GC_STRESS_WORK;
+    }
+
+    Vm->GcDebt = 0;
+    if (Vm->GcPhase == CkGcMark) {
+        if (CkpDeeplyKiss(Vm, Work) != FALSE) {
+            CkpFinishMarking(Vm);
+        }
+
+    } else if (Vm->GcPhase == CkGcSweep) {
+        CkpGcSweepStep(Vm, Work);
+    }
+
+    CkpGcRecordPause(Vm, Vm->GcStatistics.MajorPauses, Start);
+    return;
+}
+
+VOID
+CkpFinishMarking (
+    PCK_VM Vm
+    )
+
+/*++
+
+Routine Description:
+
+    This routine completes the mark phase of a major collection. The roots,
+    remembered objects, and kissed young objects may all have been changed
+    since they were traversed, so they are traversed again before the old
+    generation is handed over to the sweeper.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Count;
+    UINTN Index;
+    PCK_OBJECT Object;
+
+    Vm->GarbageRuns += 1;
+    Vm->GarbageFreed = 0;
+    CkpKissRoots(Vm);
+    for (Index = 0; Index < Vm->RememberedCount; Index += 1) {
+        Object = Vm->Remembered[Index];
+        if (Object->NextKiss != NULL) {
+            CkpRekissObject(Vm, Object);
+        }
+    }
+
+    Object = Vm->FirstObject;
+    while (Object != NULL) {
+        if (Object->NextKiss != NULL) {
+            CkpRekissObject(Vm, Object);
+        }
+
+        Object = Object->Next;
+    }
+
+    CkpDeeplyKiss(Vm, MAX_UINTN);
+
+    //
+    // Anything in the remembered set that was not kissed is about to be
+    // destroyed by the sweeper.
+    //
+
+    Count = 0;
+    for (Index = 0; Index < Vm->RememberedCount; Index += 1) {
+        Object = Vm->Remembered[Index];
+        if (Object->NextKiss != NULL) {
+            Vm->Remembered[Count] = Object;
+            Count += 1;
+
+        } else {
+            Object->Flags &= ~CK_OBJECT_REMEMBERED;
+        }
+    }
+
+    Vm->RememberedCount = Count;
+
+    //
+    // Young objects are left to the next young collection.
+    //
+
+    CkpClearKisses(Vm, Vm->FirstObject);
+
+    CK_ASSERT(Vm->SweepObjects == NULL);
+
+    Vm->SweepObjects = Vm->OldObjects;
+    Vm->OldObjects = NULL;
+    Vm->OldBytes = Vm->KissedBytes;
+    Vm->BytesAllocated = Vm->OldBytes + Vm->YoungBytes;
+    CkpSetNextCollection(Vm);
+    Vm->GcPhase = CkGcSweep;
+    return;
+}
+
+VOID
+CkpGcSweepStep (
+    PCK_VM Vm,
+    UINTN Work
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sweeps a portion of the old generation, destroying any
+    objects that were not kissed during the mark phase.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    Work - Supplies the maximum number of objects to visit.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    CK_ASSERT(Vm->GcPhase == CkGcSweep);
+
+    Vm->SweepObjects = CkpCollectUnkissedObjects(Vm, Vm->SweepObjects, Work);
+    if (Vm->SweepObjects == NULL) {
+        Vm->GcPhase = CkGcIdle;
+    }
+
+    return;
+}
+
+VOID
+CkpSetNextCollection (
+    PCK_VM Vm
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines the size the old generation has to grow to before
+    the next major collection cycle is started.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UINTN Hysteresis;
+    UINTN Minimum;
+    UINTN NextThreshold;
+
+    //
+    // Determine the next garbage collection time, expressed as an additional
+    // percentage growth. Except rather than using percent 100 exactly, use
+    // 1024 to avoid the divide. It looks nearly the same as percent times 10.
+    //
+
+    Hysteresis = Vm->OldBytes * Vm->Configuration.HeapGrowthPercent / 1024;
+    NextThreshold = Vm->OldBytes + Hysteresis;
+
+    //
+    // Avoid ratcheting down the threshold little by little. Go down by the
+    // same chunk as going up.
+    //
+
+    if (NextThreshold < Vm->NextGarbageCollection) {
+        if (Vm->OldBytes > Hysteresis) {
+            Minimum = Vm->OldBytes - Hysteresis;
+            if (NextThreshold > Minimum) {
+                NextThreshold = Vm->NextGarbageCollection;
+            }
+        }
+    }
+
+    if (NextThreshold < Vm->Configuration.MinimumHeapSize) {
+        NextThreshold = Vm->Configuration.MinimumHeapSize;
+    }
+
+    Vm->NextGarbageCollection = NextThreshold;
+    return;
+}
+
+VOID
+CkpStartKissing (
+    PCK_VM Vm
+    )
+
+/*++
+
+Routine Description:
+
+    This routine resets the kiss list in preparation for a new traversal.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
 
-//
-// ------------------------------------------------------------------ Functions
-//
+    //
+    // Set up the head of the kiss list. Make it a circle so that the last
+    // object added does not have a non-null pointer.
+    //
+
+    Vm->KissHead.Type = CkObjectInvalid;
+    Vm->KissHead.Flags = 0;
+    Vm->KissHead.Next = NULL;
+    Vm->KissHead.NextKiss = &(Vm->KissHead);
+    Vm->KissHead.Class = NULL;
+    Vm->KissList = &(Vm->KissHead);
+    Vm->KissCursor = &(Vm->KissHead);
+    Vm->KissedBytes = 0;
+    return;
+}
 
-CK_API
 VOID
-CkCollectGarbage (
+CkpKissRoots (
     PCK_VM Vm
     )
 
@@ -175,8 +1006,7 @@ CkCollectGarbage (
 
 Routine Description:
 
-    This routine performs garbage collection on the given Chalk instance,
-    freeing up unused dynamic memory as appropriate.
+    This routine kisses all the objects directly referenced by the VM.
 
 Arguments:
 
@@ -184,90 +1014,76 @@ Routine Description:
 
 Return Value:
 
-    Returns a pointer to the newly allocated or reallocated memory on success.
-
-    NULL on allocation failure or for free operations.
+    None.
 
 --*/
 
 {
 
-    UINTN Hysteresis;
     UINTN Index;
-    CK_OBJECT KissHead;
-    UINTN Minimum;
-    UINTN NextThreshold;
-
-    //
-    // Reset the number of bytes allocated, and have the kiss functions count
-    // their allocations. This avoids the extra work of having to determine
-    // the size of objects being freed. The tradeoff is that the bytes
-    // allocated won't count non-object allocations, so it will be a bit low.
-    //
-
-    Vm->BytesAllocated = 0;
-    Vm->GarbageRuns += 1;
-    Vm->GarbageFreed = 0;
-
-    //
-    // Set up the head of the kiss list. Make it a circle so that the last
-    // object added does not have a non-null pointer.
-    //
 
-    KissHead.Type = CkObjectInvalid;
-    KissHead.Next = NULL;
-    KissHead.NextKiss = &KissHead;
-    Vm->KissList = &KissHead;
-    CkpKissObject(Vm, &(Vm->Modules->Header));
-    CkpKissObject(Vm, &(Vm->ModulePath->Header));
+    CkpKissRoot(Vm, &(Vm->Modules->Header));
+    CkpKissRoot(Vm, &(Vm->ModulePath->Header));
     for (Index = 0; Index < Vm->WorkingObjectCount; Index += 1) {
-        CkpKissObject(Vm, Vm->WorkingObjects[Index]);
+        CkpKissRoot(Vm, Vm->WorkingObjects[Index]);
     }
 
-    CkpKissObject(Vm, &(Vm->Fiber->Header));
+    CkpKissRoot(Vm, &(Vm->Fiber->Header));
     if (Vm->Compiler != NULL) {
         CkpKissCompiler(Vm, Vm->Compiler);
     }
 
-    CkpKissObject(Vm, &(Vm->UnhandledException->Header));
-    CkpDeeplyKiss(Vm, &KissHead);
-    CkpCollectUnkissedObjects(Vm);
+    CkpKissRoot(Vm, &(Vm->UnhandledException->Header));
+    return;
+}
 
-    //
-    // Determine the next garbage collection time, expressed as an additional
-    // percentage growth. Except rather than using percent 100 exactly, use
-    // 1024 to avoid the divide. It looks nearly the same as percent times 10.
-    //
+VOID
+CkpKissRoot (
+    PCK_VM Vm,
+    PCK_OBJECT Object
+    )
+
+/*++
 
-    Hysteresis = Vm->BytesAllocated * Vm->Configuration.HeapGrowthPercent /
-                 1024;
+Routine Description:
 
-    NextThreshold = Vm->BytesAllocated + Hysteresis;
+    This routine kisses a root object. Roots are written to without barriers,
+    so if the object has already been kissed or is being skipped because it's
+    old, its components are kissed directly.
 
-    //
-    // Avoid ratcheting down the threshold little by little. Go down by the
-    // same chunk as going up.
-    //
+Arguments:
 
-    if (NextThreshold < Vm->NextGarbageCollection) {
-        if (Vm->BytesAllocated > Hysteresis) {
-            Minimum = Vm->BytesAllocated - Hysteresis;
-            if (NextThreshold > Minimum) {
-                NextThreshold = Vm->NextGarbageCollection;
-            }
-        }
+    Vm - Supplies a pointer to the virtual machine.
+
+    Object - Supplies an optional pointer to the root object.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    if (Object == NULL) {
+        return;
     }
 
-    if (NextThreshold < Vm->Configuration.MinimumHeapSize) {
-        NextThreshold = Vm->Configuration.MinimumHeapSize;
+    if ((Object->NextKiss != NULL) ||
+        (((Vm->GcFlags & CK_GC_YOUNG_ONLY) != 0) &&
+         ((Object->Flags & CK_OBJECT_OLD) != 0))) {
+
+        CkpRekissObject(Vm, Object);
+
+    } else {
+        CkpKissObject(Vm, Object);
     }
 
-    Vm->NextGarbageCollection = NextThreshold;
     return;
 }
 
 VOID
-CkpPushRoot (
+CkpRekissObject (
     PCK_VM Vm,
     PCK_OBJECT Object
     )
@@ -276,14 +1092,14 @@ CkpPushRoot (
 
 Routine Description:
 
-    This routine pushes the given object onto a temporary stack to ensure that
-    it will not be garbage collected.
+    This routine kisses the components of an object that may have already
+    been traversed. The object's own size is not counted again.
 
 Arguments:
 
     Vm - Supplies a pointer to the virtual machine.
 
-    Object - Supplies a pointer to the object to push.
+    Object - Supplies a pointer to the object.
 
 Return Value:
 
@@ -293,16 +1109,16 @@ Return Value:
 
 {
 
-    CK_ASSERT(Object != NULL);
-    CK_ASSERT(Vm->WorkingObjectCount < CK_MAX_WORKING_OBJECTS);
+    UINTN KissedBytes;
 
-    Vm->WorkingObjects[Vm->WorkingObjectCount] = Object;
-    Vm->WorkingObjectCount += 1;
+    KissedBytes = Vm->KissedBytes;
+    CkpKissChildren(Vm, Object);
+    Vm->KissedBytes = KissedBytes;
     return;
 }
 
 VOID
-CkpPopRoot (
+CkpRememberRoots (
     PCK_VM Vm
     )
 
@@ -310,8 +1126,9 @@ CkpPopRoot (
 
 Routine Description:
 
-    This routine pops the top working object off of the temporary stack used to
-    ensure that certain objects are not garbage collected.
+    This routine adds any old root objects to the remembered set. Roots are
+    often written to without barriers, and may stop being roots before the
+    next collection.
 
 Arguments:
 
@@ -325,91 +1142,137 @@ Return Value:
 
 {
 
-    CK_ASSERT(Vm->WorkingObjectCount != 0);
+    PCK_COMPILER Compiler;
+    UINTN Index;
+
+    for (Index = 0; Index < Vm->WorkingObjectCount; Index += 1) {
+        CK_WRITE_BARRIER(Vm, Vm->WorkingObjects[Index]);
+    }
+
+    Compiler = Vm->Compiler;
+    if (Compiler != NULL) {
+        if ((Compiler->Parser != NULL) && (Compiler->Parser->Module != NULL)) {
+            CK_WRITE_BARRIER(Vm, &(Compiler->Parser->Module->Header));
+        }
+
+        while (Compiler != NULL) {
+            if (Compiler->Function != NULL) {
+                CK_WRITE_BARRIER(Vm, &(Compiler->Function->Header));
+            }
+
+            Compiler = Compiler->Parent;
+        }
+    }
 
-    Vm->WorkingObjectCount -= 1;
     return;
 }
 
-PVOID
-CkpReallocate (
+VOID
+CkpClearKisses (
     PCK_VM Vm,
-    PVOID Memory,
-    UINTN OldSize,
-    UINTN NewSize
+    PCK_OBJECT List
     )
 
 /*++
 
 Routine Description:
 
-    This routine performs a Chalk dynamic memory operation.
+    This routine clears the kissed state of every object on the given list.
 
 Arguments:
 
     Vm - Supplies a pointer to the virtual machine.
 
-    Memory - Supplies an optional pointer to the memory to resize or free.
+    List - Supplies a pointer to the first object in the list.
 
-    OldSize - Supplies the optional previous size of the allocation.
+Return Value:
 
-    NewSize - Supplies the new size of the allocation. Set this to 0 to free
-        the memory.
+    None.
 
-Return Value:
+--*/
 
-    Returns a pointer to the newly allocated or reallocated memory on success.
+{
 
-    NULL on allocation failure or for free operations.
+    while (List != NULL) {
+        List->NextKiss = NULL;
+        List = List->Next;
+    }
+
+    return;
+}
+
+ULONGLONG
+CkpGcTimestamp (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns a timestamp used to measure garbage collection pauses.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns the current processor time in microseconds.
 
 --*/
 
 {
 
-    PVOID Allocation;
+    return (ULONGLONG)clock() * 1000000ULL / CLOCKS_PER_SEC;
+}
 
-    //
-    // Add the new bytes to the total count. Ignore frees, since those get
-    // handled during garbage collection.
-    //
+VOID
+CkpGcRecordPause (
+    PCK_VM Vm,
+    PULONG Histogram,
+    ULONGLONG Start
+    )
 
-    Vm->BytesAllocated += NewSize - OldSize;
+/*++
 
-    //
-    // Potentially perform garbage collection.
-    //
+Routine Description:
 
-    if ((NewSize > 0) &&
-        ((Vm->BytesAllocated >= Vm->NextGarbageCollection) ||
-         (CK_VM_FLAG_SET(Vm, CK_CONFIGURATION_GC_STRESS)))) {
+    This routine records the length of a garbage collection pause.
 
-        CkCollectGarbage(Vm);
-    }
+Arguments:
 
-    Allocation = CkRawReallocate(Vm, Memory, NewSize);
-    if ((Allocation == NULL) && (NewSize != 0)) {
+    Vm - Supplies a pointer to the virtual machine.
 
-        //
-        // If there's already a memory exception in progress, then this is
-        // serious. Call the emergency function.
-        //
+    Histogram - Supplies a pointer to the pause histogram to update.
 
-        if (Vm->MemoryException != 0) {
-            CkpError(Vm, CkErrorNoMemory, "Allocation failure");
+    Start - Supplies the timestamp when the pause began.
 
-        } else {
-            Vm->MemoryException += 1;
-            CkpRuntimeError(Vm, "MemoryError", "Allocation failure");
-            Vm->MemoryException -= 1;
-        }
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Bucket;
+    ULONGLONG Pause;
+
+    Pause = CkpGcTimestamp() - Start;
+    Vm->GcStatistics.TotalPause += Pause;
+    if (Pause > Vm->GcStatistics.MaxPause) {
+        Vm->GcStatistics.MaxPause = Pause;
     }
 
-    return Allocation;
-}
+    Bucket = 0;
+    while ((Bucket < CK_GC_PAUSE_BUCKETS - 1) && ((1ULL << Bucket) <= Pause)) {
+        Bucket += 1;
+    }
 
-//
-// --------------------------------------------------------- Internal Functions
-//
+    Histogram[Bucket] += 1;
+    return;
+}
 
 VOID
 CkpKissCompiler (
@@ -443,7 +1306,7 @@ Return Value:
     //
 
     if (Compiler->Parser != NULL) {
-        CkpKissObject(Vm, &(Compiler->Parser->Module->Header));
+        CkpKissRoot(Vm, &(Compiler->Parser->Module->Header));
     }
 
     //
@@ -451,10 +1314,10 @@ Return Value:
     //
 
     while (Compiler != NULL) {
-        CkpKissObject(Vm, &(Compiler->Function->Header));
+        CkpKissRoot(Vm, &(Compiler->Function->Header));
         if (Compiler->EnclosingClass != NULL) {
             CkpKissValueArray(Vm, &(Compiler->EnclosingClass->Fields.List));
-            CkpKissObject(Vm, &(Compiler->EnclosingClass->Fields.Dict->Header));
+            CkpKissRoot(Vm, &(Compiler->EnclosingClass->Fields.Dict->Header));
         }
 
         //
@@ -463,9 +1326,9 @@ Return Value:
         // allocated.
         //
 
-        Vm->BytesAllocated += (Compiler->LocalCapacity * sizeof(CK_LOCAL)) +
-                              (Compiler->UpvalueCapacity *
-                               sizeof(CK_COMPILER_UPVALUE));
+        Vm->KissedBytes += (Compiler->LocalCapacity * sizeof(CK_LOCAL)) +
+                           (Compiler->UpvalueCapacity *
+                            sizeof(CK_COMPILER_UPVALUE));
 
         Compiler = Compiler->Parent;
     }
@@ -538,6 +1401,16 @@ Return Value:
 
     if ((Object != NULL) && (Object->NextKiss == NULL)) {
 
+        //
+        // Old objects are assumed to be alive during a young collection.
+        //
+
+        if (((Vm->GcFlags & CK_GC_YOUNG_ONLY) != 0) &&
+            ((Object->Flags & CK_OBJECT_OLD) != 0)) {
+
+            return;
+        }
+
         //
         // Wire the object in after the end of the list, and make it the new
         // end.
@@ -552,34 +1425,37 @@ Return Value:
     return;
 }
 
-VOID
+BOOL
 CkpDeeplyKiss (
     PCK_VM Vm,
-    PCK_OBJECT Head
+    UINTN Work
     )
 
 /*++
 
 Routine Description:
 
-    This routine performs a depth first traversal of the objects on the kiss
+    This routine performs a breadth first traversal of the objects on the kiss
     list, kissing each of their components recursively.
 
 Arguments:
 
     Vm - Supplies a pointer to the virtual machine.
 
-    Head - Supplies a pointer to a dummy object representing the head of the
-        kiss list. This object itself is not kissed.
+    Work - Supplies the maximum number of objects to traverse. Supply
+        MAX_UINTN to traverse until the kiss list is exhausted.
 
 Return Value:
 
-    None.
+    TRUE if every object on the kiss list has been traversed.
+
+    FALSE if the work limit was reached first.
 
 --*/
 
 {
 
+    PCK_OBJECT Head;
     PCK_OBJECT Object;
 
     //
@@ -587,100 +1463,148 @@ Return Value:
     // may cause more to get added to the end of the list.
     //
 
-    Object = Head->NextKiss;
-    while (Object != Head) {
-        switch (Object->Type) {
-        case CkObjectClass:
-            CkpKissClass(Vm, (PCK_CLASS)Object);
-            break;
+    Head = &(Vm->KissHead);
+    Object = Vm->KissCursor;
+    while (Object->NextKiss != Head) {
+        if (Work == 0) {
+            Vm->KissCursor = Object;
+            return FALSE;
+        }
+
+        Object = Object->NextKiss;
+        CkpKissChildren(Vm, Object);
+        Work -= 1;
+    }
+
+    Vm->KissCursor = Object;
+    return TRUE;
+}
+
+VOID
+CkpKissChildren (
+    PCK_VM Vm,
+    PCK_OBJECT Object
+    )
+
+/*++
+
+Routine Description:
+
+    This routine kisses each of the components of the given object.
+
+Arguments:
 
-        case CkObjectClosure:
-            CkpKissClosure(Vm, (PCK_CLOSURE)Object);
-            break;
+    Vm - Supplies a pointer to the virtual machine.
 
-        case CkObjectFiber:
-            CkpKissFiber(Vm, (PCK_FIBER)Object);
-            break;
+    Object - Supplies a pointer to the object whose components should be
+        kissed.
 
-        case CkObjectFunction:
-            CkpKissFunction(Vm, (PCK_FUNCTION)Object);
-            break;
+Return Value:
 
-        case CkObjectForeign:
-            CkpKissForeignData(Vm, (PCK_FOREIGN_DATA)Object);
-            break;
+    None.
 
-        case CkObjectInstance:
-            CkpKissInstance(Vm, (PCK_INSTANCE)Object);
-            break;
+--*/
 
-        case CkObjectList:
-            CkpKissList(Vm, (PCK_LIST)Object);
-            break;
+{
 
-        case CkObjectDict:
-            CkpKissDict(Vm, (PCK_DICT)Object);
-            break;
+    switch (Object->Type) {
+    case CkObjectClass:
+        CkpKissClass(Vm, (PCK_CLASS)Object);
+        break;
 
-        case CkObjectModule:
-            CkpKissModule(Vm, (PCK_MODULE)Object);
-            break;
+    case CkObjectClosure:
+        CkpKissClosure(Vm, (PCK_CLOSURE)Object);
+        break;
 
-        case CkObjectRange:
-            CkpKissRange(Vm, (PCK_RANGE)Object);
-            break;
+    case CkObjectFiber:
+        CkpKissFiber(Vm, (PCK_FIBER)Object);
+        break;
 
-        case CkObjectString:
-            CkpKissString(Vm, (PCK_STRING)Object);
-            break;
+    case CkObjectFunction:
+        CkpKissFunction(Vm, (PCK_FUNCTION)Object);
+        break;
 
-        case CkObjectUpvalue:
-            CkpKissUpvalue(Vm, (PCK_UPVALUE)Object);
-            break;
+    case CkObjectForeign:
+        CkpKissForeignData(Vm, (PCK_FOREIGN_DATA)Object);
+        break;
 
-        default:
+    case CkObjectInstance:
+        CkpKissInstance(Vm, (PCK_INSTANCE)Object);
+        break;
 
-            CK_ASSERT(FALSE);
+    case CkObjectList:
+        CkpKissList(Vm, (PCK_LIST)Object);
+        break;
 
-            break;
-        }
+    case CkObjectDict:
+        CkpKissDict(Vm, (PCK_DICT)Object);
+        break;
 
-        Object = Object->NextKiss;
+    case CkObjectModule:
+        CkpKissModule(Vm, (PCK_MODULE)Object);
+        break;
+
+    case CkObjectRange:
+        CkpKissRange(Vm, (PCK_RANGE)Object);
+        break;
+
+    case CkObjectString:
+        CkpKissString(Vm, (PCK_STRING)Object);
+        break;
+
+    case CkObjectUpvalue:
+        CkpKissUpvalue(Vm, (PCK_UPVALUE)Object);
+        break;
+
+    default:
+
+        CK_ASSERT(FALSE);
+
+        break;
     }
 
     return;
 }
 
-VOID
+PCK_OBJECT
 CkpCollectUnkissedObjects (
-    PCK_VM Vm
+    PCK_VM Vm,
+    PCK_OBJECT List,
+    UINTN Work
     )
 
 /*++
 
 Routine Description:
 
-    This routine garbage collects any objects that have not been kissed.
+    This routine garbage collects any objects on the given list that have not
+    been kissed. Kissed objects are reset for next time and moved to the old
+    generation.
 
 Arguments:
 
     Vm - Supplies a pointer to the virtual machine.
 
+    List - Supplies a pointer to the first object in the list to collect.
+
+    Work - Supplies the maximum number of objects to visit.
+
 Return Value:
 
-    None.
+    Returns a pointer to the remainder of the list that was not visited.
 
 --*/
 
 {
 
-    PCK_OBJECT DeadAndAlone;
     ULONG DestroyCount;
-    PCK_OBJECT *Object;
+    PCK_OBJECT Object;
 
     DestroyCount = 0;
-    Object = &(Vm->FirstObject);
-    while (*Object != NULL) {
+    while ((List != NULL) && (Work != 0)) {
+        Object = List;
+        List = Object->Next;
+        Work -= 1;
 
         //
         // Take this opportunity to ensure that all objects have classes.
@@ -688,19 +1612,25 @@ Return Value:
         // early init.
         //
 
-        CK_ASSERT(((*Object)->Class != NULL) ||
-                  ((*Object)->Type == CkObjectFunction) ||
-                  ((*Object)->Type == CkObjectUpvalue) ||
+        CK_ASSERT((Object->Class != NULL) ||
+                  (Object->Type == CkObjectFunction) ||
+                  (Object->Type == CkObjectUpvalue) ||
                   (Vm->Class.Class == NULL) ||
                   (Vm->Class.Class->Flags == 0));
 
         //
-        // If the object has been kissed, then reset it for next time.
+        // If the object has been kissed, then reset it for next time. Fibers
+        // always live in the remembered set once they're old.
         //
 
-        if ((*Object)->NextKiss != NULL) {
-            (*Object)->NextKiss = NULL;
-            Object = &((*Object)->Next);
+        if (Object->NextKiss != NULL) {
+            Object->NextKiss = NULL;
+            Object->Flags |= CK_OBJECT_OLD;
+            Object->Next = Vm->OldObjects;
+            Vm->OldObjects = Object;
+            if (Object->Type == CkObjectFiber) {
+                CK_WRITE_BARRIER(Vm, Object);
+            }
 
         //
         // The object was never kissed. No one loves it, and it serves no
@@ -708,21 +1638,20 @@ Return Value:
         //
 
         } else {
-            DeadAndAlone = *Object;
-            *Object = DeadAndAlone->Next;
-            CkpDestroyObject(Vm, DeadAndAlone);
+            CkpDestroyObject(Vm, Object);
             DestroyCount += 1;
         }
     }
 
-    Vm->GarbageFreed = DestroyCount;
+    Vm->GarbageFreed += DestroyCount;
+    Vm->GcStatistics.ObjectsFreed += DestroyCount;
     if ((CK_VM_FLAG_SET(Vm, CK_CONFIGURATION_GC_STRESS)) &&
         (DestroyCount != 0)) {
 
         CkpDebugPrint(Vm, "%d objects destroyed\n", DestroyCount);
     }
 
-    return;
+    return List;
 }
 
 VOID
@@ -757,7 +1686,7 @@ Return Value:
     CkpKissObject(Vm, &(Class->Methods->Header));
     CkpKissObject(Vm, &(Class->Name->Header));
     CkpKissObject(Vm, &(Class->Module->Header));
-    Vm->BytesAllocated += sizeof(CK_CLASS);
+    Vm->KissedBytes += sizeof(CK_CLASS);
     return;
 }
 
@@ -819,8 +1748,8 @@ Return Value:
         break;
     }
 
-    Vm->BytesAllocated += sizeof(CK_CLOSURE) +
-                          (UpvalueCount * sizeof(PCK_UPVALUE));
+    Vm->KissedBytes += sizeof(CK_CLOSURE) +
+                       (UpvalueCount * sizeof(PCK_UPVALUE));
 
     return;
 }
@@ -863,8 +1792,8 @@ Return Value:
         }
     }
 
-    Vm->BytesAllocated += sizeof(CK_DICT) +
-                          (Dict->Capacity * sizeof(CK_DICT_ENTRY));
+    Vm->KissedBytes += sizeof(CK_DICT) +
+                       (Dict->Capacity * sizeof(CK_DICT_ENTRY));
 
     return;
 }
@@ -930,10 +1859,10 @@ Return Value:
 
     CkpKissObject(Vm, &(Fiber->Caller->Header));
     CkpKissValue(Vm, Fiber->Error);
-    Vm->BytesAllocated += sizeof(CK_FIBER) +
-                          (Fiber->FrameCapacity * sizeof(CK_CALL_FRAME)) +
-                          (Fiber->TryCapacity * sizeof(CK_TRY_BLOCK)) +
-                          (Fiber->StackCapacity * sizeof(CK_VALUE));
+    Vm->KissedBytes += sizeof(CK_FIBER) +
+                       (Fiber->FrameCapacity * sizeof(CK_CALL_FRAME)) +
+                       (Fiber->TryCapacity * sizeof(CK_TRY_BLOCK)) +
+                       (Fiber->StackCapacity * sizeof(CK_VALUE));
 
     return;
 }
@@ -965,7 +1894,7 @@ Return Value:
 
 {
 
-    Vm->BytesAllocated += sizeof(CK_FOREIGN_DATA);
+    Vm->KissedBytes += sizeof(CK_FOREIGN_DATA);
     return;
 }
 
@@ -999,10 +1928,10 @@ Return Value:
     CkpKissValueArray(Vm, &(Function->Constants));
     CkpKissObject(Vm, &(Function->Module->Header));
     CkpKissObject(Vm, &(Function->Debug.Name->Header));
-    Vm->BytesAllocated += sizeof(CK_FUNCTION) +
-                          (sizeof(UCHAR) * Function->Code.Capacity) +
-                          (sizeof(UCHAR) *
-                           Function->Debug.LineProgram.Capacity);
+    Vm->KissedBytes += sizeof(CK_FUNCTION) +
+                       (sizeof(UCHAR) * Function->Code.Capacity) +
+                       (sizeof(UCHAR) *
+                        Function->Debug.LineProgram.Capacity);
 
     return;
 }
@@ -1043,7 +1972,7 @@ Return Value:
         CkpKissValue(Vm, Instance->Fields[Index]);
     }
 
-    Vm->BytesAllocated += sizeof(CK_INSTANCE) + (Count * sizeof(CK_VALUE));
+    Vm->KissedBytes += sizeof(CK_INSTANCE) + (Count * sizeof(CK_VALUE));
     return;
 }
 
@@ -1075,7 +2004,7 @@ Return Value:
 {
 
     CkpKissValueArray(Vm, &(List->Elements));
-    Vm->BytesAllocated += sizeof(CK_LIST);
+    Vm->KissedBytes += sizeof(CK_LIST);
     return;
 }
 
@@ -1114,7 +2043,7 @@ Return Value:
     CkpKissObject(Vm, &(Module->Name->Header));
     CkpKissObject(Vm, &(Module->Path->Header));
     CkpKissObject(Vm, &(Module->Closure->Header));
-    Vm->BytesAllocated = sizeof(CK_MODULE);
+    Vm->KissedBytes += sizeof(CK_MODULE);
     return;
 }
 
@@ -1145,7 +2074,7 @@ Return Value:
 
 {
 
-    Vm->BytesAllocated += sizeof(CK_RANGE);
+    Vm->KissedBytes += sizeof(CK_RANGE);
     return;
 }
 
@@ -1176,7 +2105,28 @@ Return Value:
 
 {
 
-    Vm->BytesAllocated += sizeof(CK_STRING) + String->Length + 1;
+    PCK_ROPE Rope;
+
+    //
+    // Ropes keep their pieces alive until they are flattened, after which
+    // they own a separate buffer for the contents.
+    //
+
+    if ((String->Header.Flags & CK_OBJECT_ROPE) != 0) {
+        Rope = (PCK_ROPE)String;
+        if (String->Value == NULL) {
+            CkpKissObject(Vm, &(Rope->Left->Header));
+            CkpKissObject(Vm, &(Rope->Right->Header));
+            Vm->KissedBytes += sizeof(CK_ROPE);
+
+        } else {
+            Vm->KissedBytes += sizeof(CK_ROPE) + String->Length + 1;
+        }
+
+        return;
+    }
+
+    Vm->KissedBytes += sizeof(CK_STRING) + String->Length + 1;
     return;
 }
 
@@ -1208,7 +2158,7 @@ Return Value:
 {
 
     CkpKissValue(Vm, Upvalue->Closed);
-    Vm->BytesAllocated += sizeof(CK_UPVALUE);
+    Vm->KissedBytes += sizeof(CK_UPVALUE);
     return;
 }
 
@@ -1248,7 +2198,7 @@ Return Value:
         CkpKissValue(Vm, Array->Data[Index]);
     }
 
-    Vm->BytesAllocated += Array->Capacity * sizeof(CK_VALUE);
+    Vm->KissedBytes += Array->Capacity * sizeof(CK_VALUE);
     return;
 }
 
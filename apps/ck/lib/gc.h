@@ -30,10 +30,96 @@ Module Name:
 // ---------------------------------------------------------------- Definitions
 //
 
+//
+// This macro must be invoked after storing a reference into an object that
+// may already live in the old generation. If the object is old and not yet in
+// the remembered set, it is added so that the next young collection rescans
+// it. Invoke the barrier after the store, with no allocation in between.
+//
+
+#define CK_WRITE_BARRIER(_Vm, _Object)                                      \
+    ((((_Object)->Flags & (CK_OBJECT_OLD | CK_OBJECT_REMEMBERED)) ==        \
+      CK_OBJECT_OLD) ?                                                      \
+     CkpRememberObject((_Vm), (_Object)) : (VOID)0)
+
+//
+// Define the number of power of two microsecond buckets in the pause time
+// histograms.
+//
+
+#define CK_GC_PAUSE_BUCKETS 20
+
+//
+// Define garbage collector flags.
+//
+
+//
+// This flag is set while the current kiss pass is only tracing young objects.
+//
+
+#define CK_GC_YOUNG_ONLY 0x00000001
+
+//
+// This flag is set if an object could not be added to the remembered set due
+// to allocation failure. The next collection will be a full collection.
+//
+
+#define CK_GC_REMEMBERED_OVERFLOW 0x00000002
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
 
+typedef enum _CK_GC_PHASE {
+    CkGcIdle,
+    CkGcMark,
+    CkGcSweep
+} CK_GC_PHASE, *PCK_GC_PHASE;
+
+/*++
+
+Structure Description:
+
+    This structure contains garbage collector statistics.
+
+Members:
+
+    YoungCollections - Stores the number of young generation collections that
+        have been performed.
+
+    MajorCollections - Stores the number of incremental old generation
+        collection cycles that have been started.
+
+    FullCollections - Stores the number of stop-the-world full collections
+        that have been performed.
+
+    ObjectsFreed - Stores the total number of objects freed.
+
+    TotalPause - Stores the total number of microseconds spent with the
+        collector running.
+
+    MaxPause - Stores the longest single pause in microseconds.
+
+    YoungPauses - Stores a histogram of young collection pause times. Bucket N
+        counts pauses of less than 2^N microseconds, and the last bucket
+        counts everything longer.
+
+    MajorPauses - Stores a histogram of incremental step and full collection
+        pause times, bucketed the same way as the young pauses.
+
+--*/
+
+typedef struct _CK_GC_STATISTICS {
+    ULONGLONG YoungCollections;
+    ULONGLONG MajorCollections;
+    ULONGLONG FullCollections;
+    ULONGLONG ObjectsFreed;
+    ULONGLONG TotalPause;
+    ULONGLONG MaxPause;
+    ULONG YoungPauses[CK_GC_PAUSE_BUCKETS];
+    ULONG MajorPauses[CK_GC_PAUSE_BUCKETS];
+} CK_GC_STATISTICS, *PCK_GC_STATISTICS;
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -120,4 +206,30 @@ Return Value:
 
     NULL on allocation failure or for free operations.
 
+--*/
+
+VOID
+CkpRememberObject (
+    PCK_VM Vm,
+    PCK_OBJECT Object
+    );
+
+/*++
+
+Routine Description:
+
+    This routine adds an old object to the remembered set, causing it to be
+    rescanned during the next young collection. This is usually called via
+    the write barrier macro.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    Object - Supplies a pointer to the object that was written to.
+
+Return Value:
+
+    None.
+
 --*/
\ No newline at end of file
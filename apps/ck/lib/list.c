@@ -126,17 +126,17 @@ CkpListSliceAssign (
 //
 
 CK_PRIMITIVE_DESCRIPTION CkListPrimitives[] = {
-    {"append@1", 1, CkpListAppend},
+    {"append@1", 1, CkpListAppend, CK_OBJECT_STORES_LAST_ARGUMENT},
     {"__add@1", 1, CkpListAdd},
     {"clear@0", 0, CkpListClearPrimitive},
     {"length@0", 0, CkpListLength},
-    {"insert@2", 2, CkpListInsertPrimitive},
+    {"insert@2", 2, CkpListInsertPrimitive, CK_OBJECT_STORES_LAST_ARGUMENT},
     {"removeAt@1", 1, CkpListRemoveIndexPrimitive},
     {"contains@1", 1, CkpListContains},
     {"iterate@1", 1, CkpListIterate},
     {"iteratorValue@1", 1, CkpListIteratorValue},
     {"__slice@1", 1, CkpListSlice},
-    {"__sliceAssign@2", 2, CkpListSliceAssign},
+    {"__sliceAssign@2", 2, CkpListSliceAssign, CK_OBJECT_STORES_LAST_ARGUMENT},
     {NULL, 0, NULL}
 };
 
@@ -296,6 +296,7 @@ Return Value:
     }
 
     List->Elements.Data[Index] = Element;
+    CK_WRITE_BARRIER(Vm, &(List->Header));
     return;
 }
 
@@ -433,6 +434,7 @@ Return Value:
                  Source->Elements.Data,
                  Source->Elements.Count);
 
+    CK_WRITE_BARRIER(Vm, &(Destination->Header));
     return Destination;
 }
 
@@ -756,6 +758,20 @@ Return Value:
 
     List = CK_AS_LIST(Arguments[0]);
     for (Index = 0; Index < List->Elements.Count; Index += 1) {
+
+        //
+        // Elements are stored without being flattened, so flatten any ropes
+        // before comparing their contents.
+        //
+
+        if (CK_IS_ROPE(List->Elements.Data[Index])) {
+            if (!CkpStringFlatten(Vm,
+                                  CK_AS_STRING(List->Elements.Data[Index]))) {
+
+                return FALSE;
+            }
+        }
+
         if (CkpAreValuesEqual(List->Elements.Data[Index], Arguments[1]) !=
             FALSE) {
 
@@ -1004,6 +1020,7 @@ Return Value:
     }
 
     List->Elements.Data[Index] = Arguments[2];
+    CK_WRITE_BARRIER(Vm, &(List->Header));
     Arguments[0] = Arguments[2];
     return TRUE;
 }
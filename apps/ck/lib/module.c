@@ -440,6 +440,7 @@ Return Value:
         }
 
         Module->Closure = Closure;
+        CK_WRITE_BARRIER(Vm, &(Module->Header));
     }
 
     Module->CompiledVariableCount = Module->VariableNames.List.Count;
@@ -534,6 +535,7 @@ Return Value:
     }
 
     Module->Closure = Closure;
+    CK_WRITE_BARRIER(Vm, &(Module->Header));
     return Module;
 }
 
@@ -661,12 +663,14 @@ Return Value:
     Module->Path = Path;
     CkpPushRoot(Vm, &(Module->Header));
     Error = CkpStringTableInitialize(Vm, &(Module->VariableNames));
+    CK_WRITE_BARRIER(Vm, &(Module->Header));
     if (Error != CkSuccess) {
         Module = NULL;
         goto ModuleCreateEnd;
     }
 
     Error = CkpStringTableInitialize(Vm, &(Module->Strings));
+    CK_WRITE_BARRIER(Vm, &(Module->Header));
     if (Error != CkSuccess) {
         Module = NULL;
         goto ModuleCreateEnd;
@@ -1108,6 +1112,7 @@ Return Value:
     }
 
     *Variable = Arguments[2];
+    CK_WRITE_BARRIER(Vm, &(Module->Header));
     Arguments[0] = Arguments[2];
     return TRUE;
 }
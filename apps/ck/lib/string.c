@@ -37,6 +37,22 @@ Module Name:
 // ---------------------------------------------------------------- Definitions
 //
 
+//
+// Define the length at or below which concatenation simply copies both
+// strings into a new flat string instead of creating a rope. Short pieces
+// appended to a rope are also merged together up to this size, which keeps
+// the number of rope nodes proportional to the length of the result rather
+// than the number of appends.
+//
+
+#define CK_ROPE_LEAF_SIZE 256
+
+//
+// Define the rope depth that can be flattened without allocating a stack.
+//
+
+#define CK_ROPE_LOCAL_STACK 32
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -1065,6 +1081,7 @@ Return Value:
     CK_VALUE Value;
 
     FakeStringObject->Header.Type = CkObjectString;
+    FakeStringObject->Header.Flags = 0;
     FakeStringObject->Header.Next = NULL;
     FakeStringObject->Header.Class = NULL;
     FakeStringObject->Length = Length;
@@ -1074,6 +1091,281 @@ Return Value:
     return Value;
 }
 
+CK_VALUE
+CkpStringConcatenate (
+    PCK_VM Vm,
+    PCK_STRING Left,
+    PCK_STRING Right
+    )
+
+/*++
+
+Routine Description:
+
+    This routine concatenates two strings. Short results are copied into a new
+    flat string, while longer ones create a rope that defers the copy until
+    the contents are needed. The caller must ensure both strings are
+    reachable by the garbage collector, usually by having them on the stack.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    Left - Supplies a pointer to the first string.
+
+    Right - Supplies a pointer to the string to append.
+
+Return Value:
+
+    Returns the new string value on success.
+
+    CK_NULL_VALUE on allocation failure.
+
+--*/
+
+{
+
+    UINTN LeftDepth;
+    PCK_ROPE LeftRope;
+    UINTN Length;
+    PCK_STRING Merged;
+    PCK_ROPE Rope;
+    UINTN RightDepth;
+    PCK_STRING Result;
+    CK_VALUE Value;
+
+    if (Left->Length == 0) {
+        CK_OBJECT_VALUE(Value, Right);
+        return Value;
+
+    } else if (Right->Length == 0) {
+        CK_OBJECT_VALUE(Value, Left);
+        return Value;
+    }
+
+    //
+    // Ropes are always longer than the leaf size, so short results are made
+    // of flat strings and can be copied directly.
+    //
+
+    Length = Left->Length + Right->Length;
+    if (Length <= CK_ROPE_LEAF_SIZE) {
+
+        CK_ASSERT((Left->Value != NULL) && (Right->Value != NULL));
+
+        Result = CkpStringAllocate(Vm, Length);
+        if (Result == NULL) {
+            return CK_NULL_VALUE;
+        }
+
+        CkCopy((PSTR)(Result->Value), Left->Value, Left->Length);
+        CkCopy((PSTR)(Result->Value + Left->Length),
+               Right->Value,
+               Right->Length);
+
+        CkpStringHash(Result);
+        CK_OBJECT_VALUE(Value, Result);
+        return Value;
+    }
+
+    //
+    // If a short string is being appended to a rope that itself ended in a
+    // short string, merge the two short pieces rather than adding another
+    // level to the rope. The original rope is unchanged.
+    //
+
+    Merged = NULL;
+    if ((Left->Value == NULL) && (Right->Value != NULL)) {
+        LeftRope = (PCK_ROPE)Left;
+        if ((LeftRope->Right->Value != NULL) &&
+            (LeftRope->Right->Length + Right->Length <= CK_ROPE_LEAF_SIZE)) {
+
+            Merged = CkpStringAllocate(Vm,
+                                       LeftRope->Right->Length + Right->Length);
+
+            if (Merged == NULL) {
+                return CK_NULL_VALUE;
+            }
+
+            CkCopy((PSTR)(Merged->Value),
+                   LeftRope->Right->Value,
+                   LeftRope->Right->Length);
+
+            CkCopy((PSTR)(Merged->Value + LeftRope->Right->Length),
+                   Right->Value,
+                   Right->Length);
+
+            CkpStringHash(Merged);
+            Left = LeftRope->Left;
+            Right = Merged;
+            CkpPushRoot(Vm, &(Merged->Header));
+        }
+    }
+
+    Rope = CkAllocate(Vm, sizeof(CK_ROPE));
+    if (Merged != NULL) {
+        CkpPopRoot(Vm);
+    }
+
+    if (Rope == NULL) {
+        return CK_NULL_VALUE;
+    }
+
+    CkpInitializeObject(Vm,
+                        &(Rope->String.Header),
+                        CkObjectString,
+                        Vm->Class.String);
+
+    Rope->String.Header.Flags |= CK_OBJECT_ROPE;
+    Rope->String.Length = Length;
+    Rope->String.Hash = 0;
+    Rope->String.Value = NULL;
+    Rope->Left = Left;
+    Rope->Right = Right;
+    LeftDepth = 0;
+    if (Left->Value == NULL) {
+        LeftDepth = ((PCK_ROPE)Left)->Depth;
+    }
+
+    RightDepth = 0;
+    if (Right->Value == NULL) {
+        RightDepth = ((PCK_ROPE)Right)->Depth;
+    }
+
+    Rope->Depth = LeftDepth + 1;
+    if (RightDepth > LeftDepth) {
+        Rope->Depth = RightDepth + 1;
+    }
+
+    CK_OBJECT_VALUE(Value, Rope);
+    return Value;
+}
+
+BOOL
+CkpStringFlatten (
+    PCK_VM Vm,
+    PCK_STRING String
+    )
+
+/*++
+
+Routine Description:
+
+    This routine gathers the contents of a rope into a single buffer and
+    computes its hash, after which it can be used like any other string. This
+    routine does nothing for strings that are already flat. The string must
+    be reachable by the garbage collector.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    String - Supplies a pointer to the string to flatten.
+
+Return Value:
+
+    TRUE on success.
+
+    FALSE on allocation failure.
+
+--*/
+
+{
+
+    PSTR Buffer;
+    UINTN Count;
+    PCK_STRING LocalStack[CK_ROPE_LOCAL_STACK];
+    UINTN Offset;
+    PCK_STRING Piece;
+    PCK_ROPE Rope;
+    PCK_STRING *Stack;
+
+    if (String->Value != NULL) {
+        return TRUE;
+    }
+
+    Rope = (PCK_ROPE)String;
+
+    CK_ASSERT((String->Header.Flags & CK_OBJECT_ROPE) != 0);
+
+    Buffer = CkAllocate(Vm, String->Length + 1);
+    if (Buffer == NULL) {
+        return FALSE;
+    }
+
+    //
+    // Walking the tree takes at most one stack entry per level, plus one.
+    // Deep ropes (from appending in a loop) get a stack from the heap.
+    //
+
+    Stack = LocalStack;
+    if (Rope->Depth >= CK_ROPE_LOCAL_STACK) {
+        Stack = CkAllocate(Vm, (Rope->Depth + 1) * sizeof(PCK_STRING));
+        if (Stack == NULL) {
+            CkFree(Vm, Buffer);
+            return FALSE;
+        }
+    }
+
+    //
+    // Fill the buffer from the end, visiting right children first. Ropes
+    // that have already been flattened are copied like any other string.
+    //
+
+    Offset = String->Length;
+    Stack[0] = String;
+    Count = 1;
+    while (Count != 0) {
+        Count -= 1;
+        Piece = Stack[Count];
+        if (Piece->Value != NULL) {
+
+            CK_ASSERT(Offset >= Piece->Length);
+
+            Offset -= Piece->Length;
+            CkCopy(Buffer + Offset, Piece->Value, Piece->Length);
+
+        } else {
+
+            CK_ASSERT(Count + 2 <= Rope->Depth + 1);
+
+            Stack[Count] = ((PCK_ROPE)Piece)->Left;
+            Stack[Count + 1] = ((PCK_ROPE)Piece)->Right;
+            Count += 2;
+        }
+    }
+
+    CK_ASSERT(Offset == 0);
+
+    if (Stack != LocalStack) {
+        CkFree(Vm, Stack);
+    }
+
+    Buffer[String->Length] = '\0';
+    String->Value = Buffer;
+    CkpStringHash(String);
+
+    //
+    // The buffer was charged to the young generation, but if the rope has
+    // already been promoted (perhaps by a collection during the allocation
+    // above) it now belongs to the old generation. Account for it there, or
+    // major collections would never be triggered to free old buffers.
+    //
+
+    if ((String->Header.Flags & CK_OBJECT_OLD) != 0) {
+        Vm->OldBytes += String->Length + 1;
+    }
+
+    //
+    // Let go of the pieces so they can be collected.
+    //
+
+    Rope->Left = NULL;
+    Rope->Right = NULL;
+    Rope->Depth = 0;
+    return TRUE;
+}
+
 //
 // --------------------------------------------------------- Internal Functions
 //
@@ -1818,7 +2110,15 @@ Return Value:
             return FALSE;
         }
 
+        //
+        // Lists hold ropes as they are, so flatten them before copying.
+        //
+
         Element = CK_AS_STRING(List->Elements.Data[Index]);
+        if (!CkpStringFlatten(Vm, Element)) {
+            return FALSE;
+        }
+
         Size += Element->Length;
         if (Index < List->Elements.Count - 1) {
             Size += String->Length;
@@ -2427,7 +2727,7 @@ Return Value:
 {
 
     PCK_STRING Left;
-    PCK_STRING Result;
+    CK_VALUE Result;
     PCK_STRING Right;
 
     if (!CK_IS_STRING(Arguments[1])) {
@@ -2437,23 +2737,12 @@ Return Value:
 
     Left = CK_AS_STRING(Arguments[0]);
     Right = CK_AS_STRING(Arguments[1]);
-    if (Left->Length == 0) {
-        Arguments[0] = Arguments[1];
-        return TRUE;
-
-    } else if (Right->Length == 0) {
-        return TRUE;
-    }
-
-    Result = CkpStringAllocate(Vm, Left->Length + Right->Length);
-    if (Result == NULL) {
+    Result = CkpStringConcatenate(Vm, Left, Right);
+    if (CK_IS_NULL(Result)) {
         return FALSE;
     }
 
-    CkCopy((PSTR)(Result->Value), Left->Value, Left->Length);
-    CkCopy((PSTR)(Result->Value + Left->Length), Right->Value, Right->Length);
-    CkpStringHash(Result);
-    CK_OBJECT_VALUE(Arguments[0], Result);
+    Arguments[0] = Result;
     return TRUE;
 }
 
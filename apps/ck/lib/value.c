@@ -308,6 +308,7 @@ Return Value:
 
     PCK_FOREIGN_DATA Foreign;
     PCK_FUNCTION Function;
+    PCK_STRING String;
 
     switch (Object->Type) {
     case CkObjectFiber:
@@ -346,11 +347,24 @@ Return Value:
         CkpModuleDestroy(Vm, (PCK_MODULE)Object);
         break;
 
+    //
+    // Flattened ropes have their contents in a separate allocation.
+    //
+
+    case CkObjectString:
+        String = (PCK_STRING)Object;
+        if (((Object->Flags & CK_OBJECT_ROPE) != 0) &&
+            (String->Value != NULL)) {
+
+            CkFree(Vm, (PVOID)(String->Value));
+        }
+
+        break;
+
     case CkObjectClass:
     case CkObjectClosure:
     case CkObjectInstance:
     case CkObjectRange:
-    case CkObjectString:
     case CkObjectUpvalue:
         break;
 
@@ -398,6 +412,7 @@ Return Value:
 {
 
     Object->Type = Type;
+    Object->Flags = 0;
     Object->NextKiss = NULL;
     Object->Class = Class;
     Object->Next = Vm->FirstObject;
@@ -677,6 +692,7 @@ Return Value:
     Class->Module = Module;
     CkpPushRoot(Vm, &(Class->Header));
     Class->Methods = CkpDictCreate(Vm);
+    CK_WRITE_BARRIER(Vm, &(Class->Header));
     CkpPopRoot(Vm);
     if (Class->Methods == NULL) {
         return NULL;
@@ -729,6 +745,7 @@ Return Value:
     //
 
     Closure->Class = Class;
+    CK_WRITE_BARRIER(Vm, &(Closure->Header));
     return;
 }
 
@@ -763,6 +780,7 @@ Return Value:
 
     Class->Super = Super;
     Class->SuperFieldCount = Super->FieldCount;
+    CK_WRITE_BARRIER(Vm, &(Class->Header));
 
     //
     // Copy all the methods in the superclass to this class.
@@ -54,6 +54,15 @@ Module Name:
 #define CK_IS_STRING(_Value) CK_IS_OBJECT_TYPE(_Value, CkObjectString)
 #define CK_IS_UPVALUE(_Value) CK_IS_OBJECT_TYPE(_Value, CkObjectUpvalue)
 
+//
+// This macro evaluates to non-zero if the given value is a rope string whose
+// contents have not yet been flattened into a single buffer. The value of
+// such a string must not be accessed until it is flattened.
+//
+
+#define CK_IS_ROPE(_Value) \
+    ((CK_IS_STRING(_Value)) && (CK_AS_STRING(_Value)->Value == NULL))
+
 //
 // This macro evaluates to the object pointer within a given value.
 //
@@ -113,6 +122,39 @@ Module Name:
 #define CK_CLASS_SPECIAL_CREATION 0x00000002
 #define CK_CLASS_FOREIGN 0x00000004
 
+//
+// Define object header flags used by the garbage collector.
+//
+
+//
+// This flag is set once an object has survived a young collection and been
+// moved to the old generation.
+//
+
+#define CK_OBJECT_OLD 0x00000001
+
+//
+// This flag is set if the object is currently in the remembered set, meaning
+// it will be rescanned during the next young collection.
+//
+
+#define CK_OBJECT_REMEMBERED 0x00000002
+
+//
+// This flag is set on string objects that were created by concatenation as
+// ropes, meaning they are really CK_ROPE structures.
+//
+
+#define CK_OBJECT_ROPE 0x00000004
+
+//
+// This flag is set on primitive closures that only store their last argument
+// away without looking at it, such as appending to a list. Ropes passed in
+// that position are left as they are rather than being flattened.
+//
+
+#define CK_OBJECT_STORES_LAST_ARGUMENT 0x00000008
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -273,6 +315,9 @@ Structure Description:
     Type - Stores the type of the object, which defines the parent type this
         structure is embedded in.
 
+    Flags - Stores a bitfield of garbage collection flags. See CK_OBJECT_*
+        definitions.
+
     NextKiss - Stores a pointer to the next object in the list of kissed
         objects (objects that will not get garbage collected this time).
 
@@ -285,6 +330,7 @@ Structure Description:
 
 struct _CK_OBJECT {
     CK_OBJECT_TYPE Type;
+    ULONG Flags;
     PCK_OBJECT NextKiss;
     PCK_OBJECT Next;
     PCK_CLASS Class;
@@ -330,9 +376,11 @@ Structure Description:
 
     Hash - Stores the hash of the string.
 
-    Value - Stores a pointer to the actual string value. This currently always
+    Value - Stores a pointer to the actual string value. For most strings this
         points immediately after the structure, as strings are immutable and
-        so the string plus structure are created in a single allocation.
+        so the string plus structure are created in a single allocation. For
+        ropes this is NULL until the rope is flattened, at which point it
+        points to a separate allocation. The hash is also invalid until then.
 
 --*/
 
@@ -345,6 +393,39 @@ typedef struct _CK_STRING {
 
 /*++
 
+Structure Description:
+
+    This structure contains a rope, a string formed by lazily concatenating
+    two other strings. The contents are only gathered into a single buffer
+    the first time the rope is handed to something that needs to see them,
+    which makes building a long string out of many pieces linear rather than
+    quadratic.
+
+Members:
+
+    String - Stores the string object, which has a NULL value until the rope
+        is flattened.
+
+    Left - Stores a pointer to the first part of the string. This is NULL once
+        the rope has been flattened.
+
+    Right - Stores a pointer to the second part of the string. This is NULL
+        once the rope has been flattened.
+
+    Depth - Stores the maximum number of unflattened ropes between this rope
+        and a flat string, including this one.
+
+--*/
+
+typedef struct _CK_ROPE {
+    CK_STRING String;
+    PCK_STRING Left;
+    PCK_STRING Right;
+    UINTN Depth;
+} CK_ROPE, *PCK_ROPE;
+
+/*++
+
 Structure Description:
 
     This structure defines an upvalue object.
@@ -2048,6 +2129,67 @@ Return Value:
 
 --*/
 
+CK_VALUE
+CkpStringConcatenate (
+    PCK_VM Vm,
+    PCK_STRING Left,
+    PCK_STRING Right
+    );
+
+/*++
+
+Routine Description:
+
+    This routine concatenates two strings. Short results are copied into a new
+    flat string, while longer ones create a rope that defers the copy until
+    the contents are needed. The caller must ensure both strings are
+    reachable by the garbage collector, usually by having them on the stack.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    Left - Supplies a pointer to the first string.
+
+    Right - Supplies a pointer to the string to append.
+
+Return Value:
+
+    Returns the new string value on success.
+
+    CK_NULL_VALUE on allocation failure.
+
+--*/
+
+BOOL
+CkpStringFlatten (
+    PCK_VM Vm,
+    PCK_STRING String
+    );
+
+/*++
+
+Routine Description:
+
+    This routine gathers the contents of a rope into a single buffer and
+    computes its hash, after which it can be used like any other string. This
+    routine does nothing for strings that are already flat. The string must
+    be reachable by the garbage collector.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    String - Supplies a pointer to the string to flatten.
+
+Return Value:
+
+    TRUE on success.
+
+    FALSE on allocation failure.
+
+--*/
+
 //
 // Fiber functions
 //
@@ -67,6 +67,79 @@ Module Name:
 #define CKI_READ_SYMBOL(_Value) CKI_READ_SHORT(_Value)
 #define CKI_READ_OFFSET(_Value) CKI_READ_SHORT(_Value)
 
+//
+// These macros implement the integer fast paths of the binary operator
+// opcodes. If both operands are integers, the operation is done inline.
+// Otherwise execution heads to the common code that calls the operator method
+// named by the symbol operand. Division and modulo also take the slow path for
+// divisors of zero and negative one, leaving those edge cases to the method.
+//
+
+#define CKI_INTEGER_OPERATOR(_Operator)                                     \
+    CKI_READ_SYMBOL(Symbol);                                                \
+    Arguments = Fiber->StackTop - 2;                                        \
+    if ((CK_IS_INTEGER(Arguments[0])) && (CK_IS_INTEGER(Arguments[1]))) {  \
+        CK_INT_VALUE(Arguments[0],                                          \
+                     CK_AS_INTEGER(Arguments[0]) _Operator                  \
+                     CK_AS_INTEGER(Arguments[1]));                          \
+                                                                            \
+        CKI_DROP();                                                         \
+        CKI_DISPATCH();                                                     \
+    }                                                                       \
+                                                                            \
+    goto RunInterpreterCallOperator;
+
+#define CKI_INTEGER_DIVIDE(_Operator)                                       \
+    CKI_READ_SYMBOL(Symbol);                                                \
+    Arguments = Fiber->StackTop - 2;                                        \
+    if ((CK_IS_INTEGER(Arguments[0])) && (CK_IS_INTEGER(Arguments[1])) &&  \
+        (CK_AS_INTEGER(Arguments[1]) != 0) &&                               \
+        (CK_AS_INTEGER(Arguments[1]) != -1)) {                              \
+                                                                            \
+        CK_INT_VALUE(Arguments[0],                                          \
+                     CK_AS_INTEGER(Arguments[0]) _Operator                  \
+                     CK_AS_INTEGER(Arguments[1]));                          \
+                                                                            \
+        CKI_DROP();                                                         \
+        CKI_DISPATCH();                                                     \
+    }                                                                       \
+                                                                            \
+    goto RunInterpreterCallOperator;
+
+//
+// This macro implements a fused comparison and conditional jump. The compiler
+// only emits these opcodes directly in front of a jump-if instruction. On the
+// integer fast path the comparison result is never pushed: the jump-if is
+// consumed here. On the slow path the operator method is called and the
+// jump-if instruction executes normally on the returned value.
+//
+
+#define CKI_INTEGER_COMPARE_JUMP(_Operator)                                 \
+    CKI_READ_SYMBOL(Symbol);                                                \
+    Arguments = Fiber->StackTop - 2;                                        \
+    if ((CK_IS_INTEGER(Arguments[0])) && (CK_IS_INTEGER(Arguments[1]))) {  \
+        Condition = CK_AS_INTEGER(Arguments[0]) _Operator                   \
+                    CK_AS_INTEGER(Arguments[1]);                            \
+                                                                            \
+        Fiber->StackTop -= 2;                                               \
+                                                                            \
+        CK_ASSERT(*Ip == CkOpJumpIf);                                       \
+                                                                            \
+        Ip += 1;                                                            \
+        CKI_READ_OFFSET(Offset);                                            \
+        if (Condition == FALSE) {                                           \
+                                                                            \
+            CK_ASSERT(Ip + Offset <                                         \
+                      Function->Code.Data + Function->Code.Count);          \
+                                                                            \
+            Ip += Offset;                                                   \
+        }                                                                   \
+                                                                            \
+        CKI_DISPATCH();                                                     \
+    }                                                                       \
+                                                                            \
+    goto RunInterpreterCallOperator;
+
 //
 // These macros sync up the pieces of the VM state that are kept in local
 // variables. Keeping a few things in locals allows the compiler to relax a
@@ -206,6 +279,23 @@ Module Name:
         CKI_GOTO_OFFSET(CkOpStaticMethod), \
         CKI_GOTO_OFFSET(CkOpTry), \
         CKI_GOTO_OFFSET(CkOpPopTry), \
+        CKI_GOTO_OFFSET(CkOpAdd), \
+        CKI_GOTO_OFFSET(CkOpSubtract), \
+        CKI_GOTO_OFFSET(CkOpMultiply), \
+        CKI_GOTO_OFFSET(CkOpDivide), \
+        CKI_GOTO_OFFSET(CkOpModulo), \
+        CKI_GOTO_OFFSET(CkOpLessThan), \
+        CKI_GOTO_OFFSET(CkOpLessOrEqual), \
+        CKI_GOTO_OFFSET(CkOpGreaterThan), \
+        CKI_GOTO_OFFSET(CkOpGreaterOrEqual), \
+        CKI_GOTO_OFFSET(CkOpIsEqual), \
+        CKI_GOTO_OFFSET(CkOpIsNotEqual), \
+        CKI_GOTO_OFFSET(CkOpLessThanJump), \
+        CKI_GOTO_OFFSET(CkOpLessOrEqualJump), \
+        CKI_GOTO_OFFSET(CkOpGreaterThanJump), \
+        CKI_GOTO_OFFSET(CkOpGreaterOrEqualJump), \
+        CKI_GOTO_OFFSET(CkOpIsEqualJump), \
+        CKI_GOTO_OFFSET(CkOpIsNotEqualJump), \
         CKI_GOTO_OFFSET(CkOpEnd), \
     };
 
@@ -295,6 +385,7 @@ CkpCaptureUpvalue (
 
 VOID
 CkpCloseUpvalues (
+    PCK_VM Vm,
     PCK_FIBER Fiber,
     PCK_VALUE Last
     );
@@ -448,6 +539,8 @@ Return Value:
 
 {
 
+    ULONG Index;
+    PCK_OBJECT Lists[3];
     PCK_OBJECT Next;
     PCK_OBJECT Object;
     PCK_REALLOCATE Reallocate;
@@ -458,14 +551,25 @@ Return Value:
 
     CK_ASSERT(Vm->Configuration.Reallocate != NULL);
 
-    Object = Vm->FirstObject;
-    while (Object != NULL) {
-        Next = Object->Next;
-        CkpDestroyObject(Vm, Object);
-        Object = Next;
+    Lists[0] = Vm->FirstObject;
+    Lists[1] = Vm->OldObjects;
+    Lists[2] = Vm->SweepObjects;
+    Vm->FirstObject = NULL;
+    Vm->OldObjects = NULL;
+    Vm->SweepObjects = NULL;
+    for (Index = 0; Index < 3; Index += 1) {
+        Object = Lists[Index];
+        while (Object != NULL) {
+            Next = Object->Next;
+            CkpDestroyObject(Vm, Object);
+            Object = Next;
+        }
     }
 
-    Vm->FirstObject = NULL;
+    if (Vm->Remembered != NULL) {
+        CkRawReallocate(Vm, Vm->Remembered, 0);
+        Vm->Remembered = NULL;
+    }
 
     //
     // Null out the reallocate function to catch double frees.
@@ -660,6 +764,8 @@ Return Value:
             return -2;
         }
 
+        CK_WRITE_BARRIER(Vm, &(Module->Header));
+
     //
     // If the variable was previously declared, it will have an integer value.
     // Now it can be defined for real.
@@ -667,6 +773,7 @@ Return Value:
 
     } else if (CK_IS_INTEGER(Module->Variables.Data[Symbol])) {
         Module->Variables.Data[Symbol] = Value;
+        CK_WRITE_BARRIER(Vm, &(Module->Header));
 
     //
     // Otherwise, the variable has been previously defined.
@@ -878,6 +985,7 @@ Return Value:
     CK_ARITY Arity;
     PCK_CLASS Class;
     PCK_CLOSURE Closure;
+    BOOL Condition;
     UCHAR Field;
     PCK_CALL_FRAME Frame;
     PCK_FUNCTION Function;
@@ -995,6 +1103,7 @@ Return Value:
 
         Upvalue = Frame->Closure->Upvalues[Local];
         *(Upvalue->Value) = CKI_STACK_TOP();
+        CK_WRITE_BARRIER(Vm, &(Upvalue->Header));
         CKI_DISPATCH();
 
     CKI_CASE(CkOpLoadModuleVariable):
@@ -1011,6 +1120,7 @@ Return Value:
         CK_ASSERT(Symbol < Function->Module->Variables.Count);
 
         Function->Module->Variables.Data[Symbol] = CKI_STACK_TOP();
+        CK_WRITE_BARRIER(Vm, &(Function->Module->Header));
         CKI_DISPATCH();
 
     CKI_CASE(CkOpLoadFieldThis):
@@ -1039,6 +1149,7 @@ Return Value:
         CK_ASSERT(Symbol < Instance->Header.Class->FieldCount);
 
         Instance->Fields[Symbol] = CKI_STACK_TOP();
+        CK_WRITE_BARRIER(Vm, &(Instance->Header));
         CKI_DISPATCH();
 
     CKI_CASE(CkOpLoadField):
@@ -1067,6 +1178,7 @@ Return Value:
         CK_ASSERT(Symbol < Instance->Header.Class->FieldCount);
 
         Instance->Fields[Symbol] = CKI_STACK_TOP();
+        CK_WRITE_BARRIER(Vm, &(Instance->Header));
         CKI_DISPATCH();
 
     CKI_CASE(CkOpPop):
@@ -1210,7 +1322,7 @@ Return Value:
         CKI_DISPATCH();
 
     CKI_CASE(CkOpCloseUpvalue):
-        CkpCloseUpvalues(Fiber, Fiber->StackTop - 1);
+        CkpCloseUpvalues(Vm, Fiber, Fiber->StackTop - 1);
         CKI_DISPATCH();
 
     CKI_CASE(CkOpReturn):
@@ -1221,7 +1333,7 @@ Return Value:
 
         Fiber->FrameCount -= 1;
         Fiber->TryCount = Frame->TryCount;
-        CkpCloseUpvalues(Fiber, Stack);
+        CkpCloseUpvalues(Vm, Fiber, Stack);
 
         //
         // Handle the fiber completing. Either return the value to the C caller,
@@ -1317,6 +1429,8 @@ Return Value:
             } else {
                 Closure->Upvalues[Index] = Frame->Closure->Upvalues[Local];
             }
+
+            CK_WRITE_BARRIER(Vm, &(Closure->Header));
         }
 
         Function = Frame->Closure->U.Block.Function;
@@ -1370,6 +1484,103 @@ Return Value:
         Fiber->TryCount -= 1;
         CKI_DISPATCH();
 
+    //
+    // Adding two strings is handled here too, since it is so common. The
+    // result may be a rope, which defers copying until the string is used.
+    //
+
+    CKI_CASE(CkOpAdd):
+        CKI_READ_SYMBOL(Symbol);
+        Arguments = Fiber->StackTop - 2;
+        if ((CK_IS_INTEGER(Arguments[0])) && (CK_IS_INTEGER(Arguments[1]))) {
+            CK_INT_VALUE(Arguments[0],
+                         CK_AS_INTEGER(Arguments[0]) +
+                         CK_AS_INTEGER(Arguments[1]));
+
+            CKI_DROP();
+            CKI_DISPATCH();
+
+        } else if ((CK_IS_STRING(Arguments[0])) &&
+                   (CK_IS_STRING(Arguments[1]))) {
+
+            CKI_STORE_FRAME();
+            Value = CkpStringConcatenate(Vm,
+                                         CK_AS_STRING(Arguments[0]),
+                                         CK_AS_STRING(Arguments[1]));
+
+            if (CK_IS_NULL(Value)) {
+                CKI_LOAD_FIBER();
+                CKI_DISPATCH();
+            }
+
+            Arguments[0] = Value;
+            CKI_DROP();
+            CKI_DISPATCH();
+        }
+
+        goto RunInterpreterCallOperator;
+
+    CKI_CASE(CkOpSubtract):
+        CKI_INTEGER_OPERATOR(-);
+
+    CKI_CASE(CkOpMultiply):
+        CKI_INTEGER_OPERATOR(*);
+
+    CKI_CASE(CkOpDivide):
+        CKI_INTEGER_DIVIDE(/);
+
+    CKI_CASE(CkOpModulo):
+        CKI_INTEGER_DIVIDE(%);
+
+    CKI_CASE(CkOpLessThan):
+        CKI_INTEGER_OPERATOR(<);
+
+    CKI_CASE(CkOpLessOrEqual):
+        CKI_INTEGER_OPERATOR(<=);
+
+    CKI_CASE(CkOpGreaterThan):
+        CKI_INTEGER_OPERATOR(>);
+
+    CKI_CASE(CkOpGreaterOrEqual):
+        CKI_INTEGER_OPERATOR(>=);
+
+    CKI_CASE(CkOpIsEqual):
+        CKI_INTEGER_OPERATOR(==);
+
+    CKI_CASE(CkOpIsNotEqual):
+        CKI_INTEGER_OPERATOR(!=);
+
+    CKI_CASE(CkOpLessThanJump):
+        CKI_INTEGER_COMPARE_JUMP(<);
+
+    CKI_CASE(CkOpLessOrEqualJump):
+        CKI_INTEGER_COMPARE_JUMP(<=);
+
+    CKI_CASE(CkOpGreaterThanJump):
+        CKI_INTEGER_COMPARE_JUMP(>);
+
+    CKI_CASE(CkOpGreaterOrEqualJump):
+        CKI_INTEGER_COMPARE_JUMP(>=);
+
+    CKI_CASE(CkOpIsEqualJump):
+        CKI_INTEGER_COMPARE_JUMP(==);
+
+    CKI_CASE(CkOpIsNotEqualJump):
+        CKI_INTEGER_COMPARE_JUMP(!=);
+
+    //
+    // This is the slow path for all the operator opcodes above: call the
+    // operator method on the receiver with one argument.
+    //
+
+RunInterpreterCallOperator:
+        Class = CkpGetClass(Vm, Arguments[0]);
+        MethodName = Function->Module->Strings.List.Data[Symbol];
+        CKI_STORE_FRAME();
+        CkpCallMethod(Vm, Class, MethodName, 2);
+        CKI_LOAD_FIBER();
+        CKI_DISPATCH();
+
     //
     // End opcodes should never get executed because they're always preceded
     // by a return.
@@ -1475,6 +1686,7 @@ Return Value:
 
     CkpPushRoot(Vm, &(Class->Header));
     Class->Header.Class = Metaclass;
+    CK_WRITE_BARRIER(Vm, &(Class->Header));
     CkpBindSuperclass(Vm, Class, Super);
     CkpPopRoot(Vm);
     CkpPopRoot(Vm);
@@ -1669,10 +1881,12 @@ Return Value:
 {
 
     PCK_VALUE Arguments;
+    CK_ARITY Count;
     PCK_FIBER Fiber;
     UINTN FrameCount;
     BOOL FramePushed;
     CK_ARITY FunctionArity;
+    CK_ARITY Index;
     PCK_STRING Name;
     UINTN RequiredStackSize;
     UINTN ReturnStackIndex;
@@ -1701,6 +1915,30 @@ Return Value:
         return FramePushed;
     }
 
+    //
+    // Primitive and foreign functions look directly at string contents, so
+    // flatten any ropes being passed to them. Primitives that just store their
+    // last argument (like setting a list element) leave it alone, otherwise
+    // something like "list[0] += string" would copy the whole string on every
+    // pass.
+    //
+
+    if (Closure->Type != CkClosureBlock) {
+        Arguments = Fiber->StackTop - Arity;
+        Count = Arity;
+        if ((Closure->Header.Flags & CK_OBJECT_STORES_LAST_ARGUMENT) != 0) {
+            Count -= 1;
+        }
+
+        for (Index = 0; Index < Count; Index += 1) {
+            if (CK_IS_ROPE(Arguments[Index])) {
+                if (!CkpStringFlatten(Vm, CK_AS_STRING(Arguments[Index]))) {
+                    return FramePushed;
+                }
+            }
+        }
+    }
+
     //
     // Reallocate the stack if needed.
     //
@@ -1861,6 +2099,7 @@ Return Value:
 
 VOID
 CkpCloseUpvalues (
+    PCK_VM Vm,
     PCK_FIBER Fiber,
     PCK_VALUE Last
     )
@@ -1875,6 +2114,8 @@ Routine Description:
 
 Arguments:
 
+    Vm - Supplies a pointer to the virtual machine.
+
     Fiber - Supplies a pointer to the current fiber.
 
     Last - Supplies the soon-to-be new top of the stack.
@@ -1901,6 +2142,7 @@ Return Value:
         Upvalue = Fiber->OpenUpvalues;
         Upvalue->Closed = *(Upvalue->Value);
         Upvalue->Value = &(Upvalue->Closed);
+        CK_WRITE_BARRIER(Vm, &(Upvalue->Header));
         Fiber->OpenUpvalues = Upvalue->Next;
     }
 
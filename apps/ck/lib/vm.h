@@ -227,6 +227,27 @@ Enumeration Description:
 
     CkOpPopTry - Leaves a previously pushed try block scope.
 
+    CkOpAdd - Pops two values and pushes their sum if both are integers.
+        Otherwise, calls the operator method with the symbol given in the next
+        instruction word on the first value, as CkOpCall1 would. Subsequent
+        opcodes up to CkOpIsNotEqual work the same way for subtraction,
+        multiplication, division, modulo, and the six comparisons.
+
+    CkOpIsNotEqual - Pops two values and pushes whether or not they are
+        unequal if both are integers, or calls the operator method named by
+        the next instruction word otherwise.
+
+    CkOpLessThanJump - Performs a less-than comparison like CkOpLessThan. This
+        opcode is always followed by a CkOpJumpIf. If both values are integers,
+        the comparison and the following conditional jump are performed
+        together without pushing the result. Otherwise the operator method is
+        called, and the jump instruction runs separately on its result.
+        Subsequent opcodes up to CkOpIsNotEqualJump do the same for the other
+        comparisons.
+
+    CkOpIsNotEqualJump - Performs a fused inequality comparison and
+        conditional jump.
+
     CkOpEnd - This opcode terminates a compilation. It should always be
         preceded by a return and therefore should never be executed.
 
@@ -300,6 +321,23 @@ typedef enum _CK_OPCODE {
     CkOpStaticMethod,
     CkOpTry,
     CkOpPopTry,
+    CkOpAdd,
+    CkOpSubtract,
+    CkOpMultiply,
+    CkOpDivide,
+    CkOpModulo,
+    CkOpLessThan,
+    CkOpLessOrEqual,
+    CkOpGreaterThan,
+    CkOpGreaterOrEqual,
+    CkOpIsEqual,
+    CkOpIsNotEqual,
+    CkOpLessThanJump,
+    CkOpLessOrEqualJump,
+    CkOpGreaterThanJump,
+    CkOpGreaterOrEqualJump,
+    CkOpIsEqualJump,
+    CkOpIsNotEqualJump,
     CkOpEnd,
     CkOpcodeCount
 } CK_OPCODE, *PCK_OPCODE;
@@ -380,22 +418,62 @@ Structure Description:
         memory that's been allocated since then. This number does not include
         memory that has been freed since the last garbage collection.
 
-    NextGarbageCollection - Stores the size that the allocated bytes have to
-        get to in order to trigger the next garbage collection.
+    NextGarbageCollection - Stores the size that the old generation has to
+        get to in order to trigger the next major garbage collection cycle.
+
+    YoungBytes - Stores the number of bytes allocated since the last young
+        generation collection.
+
+    OldBytes - Stores the approximate number of bytes used by objects in the
+        old generation.
+
+    KissedBytes - Stores the number of bytes accounted for by the kiss
+        functions during the garbage collection pass currently in progress.
+
+    GcDebt - Stores the number of bytes allocated since the last incremental
+        collection step.
 
     GarbageRuns - Stores the number of times the garbage collector has run.
 
     GarbageFreed - Stores the number of objects freed during the most recent
         garbage collection run.
 
-    FirstObject - Stores a pointer to the first object in the massive singly
-        linked list of all living objects. This is the list that the garbage
-        collector traverses.
+    GcPhase - Stores the current phase of the incremental major collector.
+
+    GcFlags - Stores a bitfield of garbage collector flags. See CK_GC_*
+        definitions.
+
+    FirstObject - Stores a pointer to the first object in the singly linked
+        list of young objects, those allocated since the last young
+        collection.
+
+    OldObjects - Stores a pointer to the first object in the singly linked
+        list of objects that have survived a collection.
+
+    SweepObjects - Stores a pointer to the first old object that has not yet
+        been visited by the incremental sweeper.
+
+    KissHead - Stores the dummy head of the circular list of kissed objects.
 
     KissList - Stores the tail of the list of objects that have been kissed.
         The list is circular to ensure that the last object has a non-null
         next pointer.
 
+    KissCursor - Stores a pointer to the most recent kissed object whose
+        components have been kissed. Everything after this on the kiss list
+        still needs to be traversed.
+
+    Remembered - Stores an array of old objects that have had references
+        stored into them since the last young collection.
+
+    RememberedCount - Stores the number of valid elements in the remembered
+        array.
+
+    RememberedCapacity - Stores the maximum number of elements the remembered
+        array can hold before it must be reallocated.
+
+    GcStatistics - Stores garbage collector statistics.
+
     WorkingObjects - Stores a fixed stack of objects that should not be
         garbage collected but who are not necessarily linked anywhere else.
 
@@ -430,10 +508,24 @@ struct _CK_VM {
     PCK_DICT Modules;
     UINTN BytesAllocated;
     UINTN NextGarbageCollection;
+    UINTN YoungBytes;
+    UINTN OldBytes;
+    UINTN KissedBytes;
+    UINTN GcDebt;
     ULONG GarbageRuns;
     ULONG GarbageFreed;
+    CK_GC_PHASE GcPhase;
+    ULONG GcFlags;
     PCK_OBJECT FirstObject;
+    PCK_OBJECT OldObjects;
+    PCK_OBJECT SweepObjects;
+    CK_OBJECT KissHead;
     PCK_OBJECT KissList;
+    PCK_OBJECT KissCursor;
+    PCK_OBJECT *Remembered;
+    UINTN RememberedCount;
+    UINTN RememberedCapacity;
+    CK_GC_STATISTICS GcStatistics;
     PCK_OBJECT WorkingObjects[CK_MAX_WORKING_OBJECTS];
     ULONG WorkingObjectCount;
     PCK_COMPILER Compiler;
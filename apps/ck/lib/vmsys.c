@@ -52,6 +52,7 @@ Module Name:
 #define CK_INITIAL_HEAP_DEFAULT (1024 * 1024 * 10)
 #define CK_MINIMUM_HEAP_DEFAULT (1024 * 1024)
 #define CK_HEAP_GROWTH_DEFAULT 512
+#define CK_NURSERY_SIZE_DEFAULT (512 * 1024)
 
 //
 // ------------------------------------------------------ Data Type Definitions
@@ -146,7 +147,8 @@ CK_CONFIGURATION CkDefaultConfiguration = {
     CK_INITIAL_HEAP_DEFAULT,
     CK_MINIMUM_HEAP_DEFAULT,
     CK_HEAP_GROWTH_DEFAULT,
-    0
+    0,
+    CK_NURSERY_SIZE_DEFAULT
 };
 
 //
@@ -31,7 +31,7 @@ Module Name:
 //
 
 from io import open;
-from lzma import LzmaEncoder, LzmaDecoder;
+from lzma import LzmaBlockEncoder, LzmaEncoder, LzmaDecoder;
 from iobase import RawIoBase, IoError;
 
 //
@@ -55,6 +55,7 @@ class LzFile is RawIoBase {
     var _writable;
     var _closefd;
     var _level;
+    var _threads;
     var _file;
     var _lz;
     var _remainder;
@@ -72,7 +73,8 @@ class LzFile is RawIoBase {
 
     Routine Description:
 
-        This routine instantiates a new LzFile object.
+        This routine instantiates a new LzFile object that reads or writes a
+        single LZMA stream.
 
     Arguments:
 
@@ -93,6 +95,51 @@ class LzFile is RawIoBase {
 
     --*/
 
+    {
+
+        return this.__init(name, mode, level, null);
+    }
+
+    function
+    __init (
+        name,
+        mode,
+        level,
+        threads
+        )
+
+    /*++
+
+    Routine Description:
+
+        This routine instantiates a new LzFile object. Files opened for reading
+        may be either a single LZMA stream or a block archive.
+
+    Arguments:
+
+        name - Supplies the thing to open. If this is a string, this represents
+            the path to open. If this is an integer, it represents the os file
+            descriptor to open. Otherwise, it's treated as a file object.
+
+        mode - Supplies the access mode. Valid values are 'r' for read, 'w' for
+            write, or 'a' for append. Add a plus to get simultaneous reading
+            and writing.
+
+        level - Supplies the compression level to use. Valid values are from 0
+            to 9.
+
+        threads - Supplies the number of threads to compress with when
+            writing. If this is not null, the file is written as a block
+            archive whose blocks are compressed in parallel. Supply 0 to use
+            one thread per processor. Supply null to write a single LZMA
+            stream.
+
+    Return Value:
+
+        Returns the initialized object.
+
+    --*/
+
     {
 
         var accessCount = 0;
@@ -112,6 +159,7 @@ class LzFile is RawIoBase {
         _remainder = "";
         _remainderOffset = 0;
         _level = level;
+        _threads = threads;
         this.mode = mode;
         this.name = null;
         this.closed = false;
@@ -170,6 +218,9 @@ class LzFile is RawIoBase {
         if (_readable) {
             _lz = LzmaDecoder(level, true);
 
+        } else if (threads != null) {
+            _lz = LzmaBlockEncoder(level, threads);
+
         } else {
             _lz = LzmaEncoder(level, true);
         }
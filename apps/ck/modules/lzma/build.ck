@@ -26,7 +26,7 @@ Module Name:
 
 --*/
 
-from menv import compiledSources, group, mconfig, staticLibrary;
+from menv import addConfig, compiledSources, group, mconfig, staticLibrary;
 from apps.ck.modules.build import chalkSharedModule;
 
 function build() {
@@ -78,6 +78,15 @@ function build() {
         "prefix": "build"
     };
 
+    //
+    // The block encoder uses pthreads, which are part of the C library on
+    // Minoca.
+    //
+
+    if ((buildOs != "Windows") && (buildOs != "Minoca")) {
+        addConfig(lib, "DYNLIBS", "-lpthread");
+    }
+
     entries += chalkSharedModule(lib);
     entries += group("all", [":lzma_static", ":lzma_dynamic"]);
     entries += group("build_all",
@@ -40,6 +40,20 @@ Module Name:
 // --------------------------------------------------------------------- Macros
 //
 
+//
+// Block archives are compressed on multiple threads where pthreads are
+// available, and serially otherwise.
+//
+
+#if !defined(_WIN32)
+
+#include <pthread.h>
+#include <unistd.h>
+
+#define CK_LZ_THREADS 1
+
+#endif
+
 //
 // ---------------------------------------------------------------- Definitions
 //
@@ -56,12 +70,57 @@ Module Name:
 
 #define CK_LZ_DEFAULT_BUFFER_SIZE (1024 * 128)
 
+//
+// Define the maximum number of threads the block encoder will use.
+//
+
+#define CK_LZ_MAX_THREADS 64
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
 
 /*++
 
+Enumeration Description:
+
+    This enumeration describes where a decoder is in its input stream.
+
+Values:
+
+    CkLzStageDetect - Indicates the decoder is collecting the first few bytes
+        of a file wrapped stream to see whether it is a block archive.
+
+    CkLzStageStream - Indicates the input is a single LZMA stream.
+
+    CkLzStageBlockHeader - Indicates the decoder is reading the header of a
+        block archive.
+
+    CkLzStageBlockStart - Indicates the decoder is collecting the magic that
+        says whether another block or the index comes next.
+
+    CkLzStageBlock - Indicates the decoder is in the middle of a block.
+
+    CkLzStageBlockTail - Indicates the decoder is reading the index and
+        trailer of a block archive.
+
+    CkLzStageBlockComplete - Indicates the block archive has been fully
+        decoded and validated.
+
+--*/
+
+typedef enum _CK_LZ_STAGE {
+    CkLzStageDetect,
+    CkLzStageStream,
+    CkLzStageBlockHeader,
+    CkLzStageBlockStart,
+    CkLzStageBlock,
+    CkLzStageBlockTail,
+    CkLzStageBlockComplete
+} CK_LZ_STAGE, *PCK_LZ_STAGE;
+
+/*++
+
 Structure Description:
 
     This structure stores the context for an LZMA encoder or decoder class
@@ -81,10 +140,49 @@ Structure Description:
     FileWrapper - Stores a boolean indicating whether or not the file wrapper
         is requested.
 
+    BlockArchive - Stores a boolean indicating whether the instance reads or
+        writes a block archive rather than a single stream.
+
     Level - Stores the compression level of the stream.
 
     Status - Stores the last status code returned from an operation.
 
+    Stage - Stores the decoder's position within its input.
+
+    ThreadCount - Stores the number of threads the block encoder compresses
+        blocks on.
+
+    Properties - Stores the encoder properties used for each block.
+
+    Header - Stores the block archive header.
+
+    Staging - Stores the beginning of the block archive header, or the magic
+        of the next block, when it is split across calls.
+
+    StagingSize - Stores the number of valid bytes in the staging buffer.
+
+    Buffer - Stores a pointer to the uncompressed data waiting to be encoded
+        for a block encoder, or the index and trailer for a block decoder.
+
+    BufferSize - Stores the number of valid bytes in the buffer.
+
+    BufferCapacity - Stores the allocated size of the buffer.
+
+    Index - Stores a pointer to the index entries for the blocks written or
+        decoded so far.
+
+    BlockCount - Stores the number of valid index entries.
+
+    IndexCapacity - Stores the number of index entries allocated.
+
+    BlockOffset - Stores the archive offset of the block being decoded.
+
+    CompressedSize - Stores the number of block archive bytes written or
+        consumed so far.
+
+    UncompressedSize - Stores the number of uncompressed bytes in the block
+        archive so far.
+
     Lz - Stores the LZMA context.
 
 --*/
@@ -94,11 +192,117 @@ typedef struct _CK_LZ_CONTEXT {
     BOOL Finished;
     BOOL Initialized;
     BOOL FileWrapper;
+    BOOL BlockArchive;
     INT Level;
     LZ_STATUS Status;
+    CK_LZ_STAGE Stage;
+    ULONG ThreadCount;
+    LZMA_ENCODER_PROPERTIES Properties;
+    LZMA_BLOCK_HEADER Header;
+    UCHAR Staging[sizeof(LZMA_BLOCK_HEADER)];
+    ULONG StagingSize;
+    PUCHAR Buffer;
+    UINTN BufferSize;
+    UINTN BufferCapacity;
+    PLZMA_BLOCK_INDEX_ENTRY Index;
+    ULONG BlockCount;
+    ULONG IndexCapacity;
+    ULONGLONG BlockOffset;
+    ULONGLONG CompressedSize;
+    ULONGLONG UncompressedSize;
     LZ_CONTEXT Lz;
 } CK_LZ_CONTEXT, *PCK_LZ_CONTEXT;
 
+/*++
+
+Structure Description:
+
+    This structure stores the output string being built by a call. The string
+    buffer lives at the top of the Chalk stack.
+
+Members:
+
+    Buffer - Stores a pointer to the string buffer.
+
+    Size - Stores the number of valid bytes in the buffer.
+
+    Capacity - Stores the size of the buffer.
+
+--*/
+
+typedef struct _CK_LZ_OUTPUT {
+    PSTR Buffer;
+    UINTN Size;
+    UINTN Capacity;
+} CK_LZ_OUTPUT, *PCK_LZ_OUTPUT;
+
+/*++
+
+Structure Description:
+
+    This structure stores a single block being compressed as part of a batch.
+
+Members:
+
+    Input - Stores a pointer to the uncompressed data.
+
+    InputSize - Stores the size of the uncompressed data in bytes.
+
+    Output - Stores a pointer to the compressed block, allocated by the
+        encoder.
+
+    OutputSize - Stores the size of the compressed block in bytes.
+
+    Crc32 - Stores the CRC32 of the uncompressed data.
+
+    Status - Stores the result of compressing the block.
+
+--*/
+
+typedef struct _CK_LZ_BLOCK {
+    PCVOID Input;
+    UINTN InputSize;
+    PVOID Output;
+    UINTN OutputSize;
+    ULONG Crc32;
+    LZ_STATUS Status;
+} CK_LZ_BLOCK, *PCK_LZ_BLOCK;
+
+/*++
+
+Structure Description:
+
+    This structure stores a batch of blocks shared by the threads compressing
+    them.
+
+Members:
+
+    Properties - Stores a pointer to the encoder properties.
+
+    Blocks - Stores the array of blocks.
+
+    BlockCount - Stores the number of blocks in the array.
+
+    NextBlock - Stores the index of the next block to hand out.
+
+    Lock - Stores the lock serializing access to the next block index.
+
+--*/
+
+typedef struct _CK_LZ_BATCH {
+    PLZMA_ENCODER_PROPERTIES Properties;
+    PCK_LZ_BLOCK Blocks;
+    ULONG BlockCount;
+    ULONG NextBlock;
+
+#ifdef CK_LZ_THREADS
+
+    pthread_mutex_t Lock;
+
+#endif
+
+} CK_LZ_BATCH, *PCK_LZ_BATCH;
+
 //
 // ----------------------------------------------- Internal Function Prototypes
 //
@@ -133,6 +337,21 @@ CkpLzmaDecoderFinish (
     PCK_VM Vm
     );
 
+VOID
+CkpLzmaBlockEncoderInitialize (
+    PCK_VM Vm
+    );
+
+VOID
+CkpLzmaBlockCompress (
+    PCK_VM Vm
+    );
+
+VOID
+CkpLzmaBlockEncoderFinish (
+    PCK_VM Vm
+    );
+
 VOID
 CkpLzmaStats (
     PCK_VM Vm
@@ -146,6 +365,26 @@ CkpLzmaEncode (
     LZ_FLUSH_OPTION FlushOption
     );
 
+VOID
+CkpLzmaBlockEncode (
+    PCK_VM Vm,
+    PCVOID Input,
+    UINTN InputLength,
+    BOOL Finish
+    );
+
+BOOL
+CkpLzmaEncodeBatch (
+    PCK_VM Vm,
+    PCK_LZ_CONTEXT Context,
+    PCK_LZ_OUTPUT Output
+    );
+
+PVOID
+CkpLzmaBatchWorker (
+    PVOID Parameter
+    );
+
 VOID
 CkpLzmaDecode (
     PCK_VM Vm,
@@ -154,6 +393,53 @@ CkpLzmaDecode (
     LZ_FLUSH_OPTION FlushOption
     );
 
+LZ_STATUS
+CkpLzmaDecodeStream (
+    PCK_VM Vm,
+    PCK_LZ_CONTEXT Context,
+    PCVOID Input,
+    UINTN InputLength,
+    LZ_FLUSH_OPTION FlushOption,
+    PCK_LZ_OUTPUT Output
+    );
+
+LZ_STATUS
+CkpLzmaDecodeBlocks (
+    PCK_VM Vm,
+    PCK_LZ_CONTEXT Context,
+    PCUCHAR Input,
+    UINTN InputLength,
+    PCK_LZ_OUTPUT Output
+    );
+
+LZ_STATUS
+CkpLzmaValidateBlockTail (
+    PCK_LZ_CONTEXT Context
+    );
+
+BOOL
+CkpLzmaAddIndexEntry (
+    PCK_LZ_CONTEXT Context,
+    ULONGLONG CompressedSize,
+    ULONGLONG UncompressedSize,
+    ULONG Crc32
+    );
+
+BOOL
+CkpLzmaAppendOutput (
+    PCK_VM Vm,
+    PCK_LZ_OUTPUT Output,
+    PCVOID Data,
+    UINTN Size
+    );
+
+BOOL
+CkpLzmaGrowOutput (
+    PCK_VM Vm,
+    PCK_LZ_OUTPUT Output,
+    UINTN Size
+    );
+
 VOID
 CkpLzmaRaiseLzError (
     PCK_VM Vm,
@@ -170,6 +456,11 @@ CkpLzmaDestroyContext (
     PVOID Data
     );
 
+ULONG
+CkpLzmaGetProcessorCount (
+    VOID
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -317,6 +608,35 @@ Return Value:
     CkBindMethod(Vm, 1);
     CkStackPop(Vm);
 
+    //
+    // Create the LzmaBlockEncoder class.
+    //
+
+    CkPushString(Vm, "LzmaBlockEncoder", 16);
+    CkGetVariable(Vm, 0, "Object");
+    CkPushClass(Vm, 0, 1);
+    CkPushValue(Vm, -1);
+    CkSetVariable(Vm, 0, "LzmaBlockEncoder");
+    CkPushFunction(Vm, CkpLzmaBlockEncoderInitialize, "__init", 0, 0);
+    CkPushString(Vm, "__init", 6);
+    CkBindMethod(Vm, 1);
+    CkPushFunction(Vm, CkpLzmaBlockEncoderInitialize, "__init", 2, 0);
+    CkPushString(Vm, "__init", 6);
+    CkBindMethod(Vm, 1);
+    CkPushFunction(Vm, CkpLzmaBlockEncoderInitialize, "__init", 3, 0);
+    CkPushString(Vm, "__init", 6);
+    CkBindMethod(Vm, 1);
+    CkPushFunction(Vm, CkpLzmaBlockCompress, "compress", 1, 0);
+    CkPushString(Vm, "compress", 8);
+    CkBindMethod(Vm, 1);
+    CkPushFunction(Vm, CkpLzmaBlockEncoderFinish, "finish", 0, 0);
+    CkPushString(Vm, "finish", 6);
+    CkBindMethod(Vm, 1);
+    CkPushFunction(Vm, CkpLzmaStats, "stats", 0, 0);
+    CkPushString(Vm, "stats", 5);
+    CkBindMethod(Vm, 1);
+    CkStackPop(Vm);
+
     //
     // Create the LzmaError exception.
     //
@@ -609,6 +929,29 @@ Return Value:
 
     Context->Level = Level;
     Context->FileWrapper = FileWrapper;
+
+    //
+    // A file wrapped stream might turn out to be a block archive, which isn't
+    // known until the first few bytes come in.
+    //
+
+    Context->BlockArchive = FALSE;
+    Context->Stage = CkLzStageStream;
+    if (FileWrapper != FALSE) {
+        Context->Stage = CkLzStageDetect;
+    }
+
+    Context->StagingSize = 0;
+    if (Context->Buffer != NULL) {
+        free(Context->Buffer);
+        Context->Buffer = NULL;
+    }
+
+    Context->BufferSize = 0;
+    Context->BufferCapacity = 0;
+    Context->BlockCount = 0;
+    Context->CompressedSize = 0;
+    Context->UncompressedSize = 0;
     LzLzmaInitializeProperties(&Properties);
     Properties.Level = Context->Level;
     LzStatus = LzLzmaInitializeDecoder(&(Context->Lz),
@@ -690,7 +1033,7 @@ Return Value:
 }
 
 VOID
-CkpLzmaStats (
+CkpLzmaBlockEncoderInitialize (
     PCK_VM Vm
     )
 
@@ -698,8 +1041,10 @@ CkpLzmaStats (
 
 Routine Description:
 
-    This routine returns a statistics dictionary describing the current
-    state of the LZMA encoder or decoder.
+    This routine is called when a new block encoder class instance is created.
+    It takes an encoder level number 0-9, the number of threads to compress
+    blocks on (0 for one per processor), and optionally the uncompressed size
+    of each block.
 
 Arguments:
 
@@ -713,334 +1058,1529 @@ Return Value:
 
 {
 
+    CK_INTEGER BlockSize;
     PCK_LZ_CONTEXT Context;
+    CK_INTEGER Level;
+    CK_INTEGER ThreadCount;
 
-    CkGetField(Vm, 0);
-    Context = CkGetData(Vm, -1);
-    CkStackPop(Vm);
-    CkPushDict(Vm);
-    CkPushString(Vm, "finished", 8);
-    CkPushInteger(Vm, Context->Finished);
-    CkDictSet(Vm, 1);
-    CkPushString(Vm, "status", 6);
-    CkPushInteger(Vm, Context->Status);
-    CkDictSet(Vm, 1);
-    CkPushString(Vm, "fileWrapper", 11);
-    CkPushInteger(Vm, Context->FileWrapper);
-    CkDictSet(Vm, 1);
-    CkPushString(Vm, "level", 5);
-    CkPushInteger(Vm, Context->Level);
-    CkDictSet(Vm, 1);
-    CkPushString(Vm, "compressedCrc32", 15);
-    CkPushInteger(Vm, Context->Lz.CompressedCrc32);
-    CkDictSet(Vm, 1);
-    CkPushString(Vm, "uncompressedCrc32", 17);
-    CkPushInteger(Vm, Context->Lz.UncompressedCrc32);
-    CkDictSet(Vm, 1);
-    CkPushString(Vm, "compressedSize", 14);
-    CkPushInteger(Vm, Context->Lz.CompressedSize);
-    CkDictSet(Vm, 1);
-    CkPushString(Vm, "uncompressedSize", 16);
-    CkPushInteger(Vm, Context->Lz.UncompressedSize);
-    CkDictSet(Vm, 1);
-    CkStackReplace(Vm, 0);
-    return;
-}
+    //
+    // If this is the __init function with no arguments, supply default
+    // parameters.
+    //
 
-VOID
-CkpLzmaEncode (
-    PCK_VM Vm,
-    PCVOID Input,
-    UINTN InputLength,
-    LZ_FLUSH_OPTION FlushOption
-    )
+    Level = 5;
+    ThreadCount = 0;
+    BlockSize = LZMA_DEFAULT_BLOCK_SIZE;
+    if (CkGetStackSize(Vm) != 1) {
+        if (CkGetStackSize(Vm) == 3) {
+            if (!CkCheckArguments(Vm, 2, CkTypeInteger, CkTypeInteger)) {
+                return;
+            }
 
-/*++
+        } else {
+            if (!CkCheckArguments(Vm,
+                                  3,
+                                  CkTypeInteger,
+                                  CkTypeInteger,
+                                  CkTypeInteger)) {
 
-Routine Description:
+                return;
+            }
 
-    This routine compresses LZMA data. The resulting compressed data is
-    returned in stack slot zero.
+            BlockSize = CkGetInteger(Vm, 3);
+            if ((BlockSize < LZMA_MINIMUM_BLOCK_SIZE) ||
+                (BlockSize > LZMA_MAXIMUM_BLOCK_SIZE)) {
 
-Arguments:
+                CkRaiseBasicException(Vm, "ValueError", "Invalid block size");
+                return;
+            }
+        }
 
-    Vm - Supplies a pointer to the virtual machine.
+        Level = CkGetInteger(Vm, 1);
+        if ((Level < -1) || (Level > 9)) {
+            CkRaiseBasicException(Vm,
+                                  "ValueError",
+                                  "Compression level must be between 0-9");
 
-    Input - Supplies the input data to encode.
+            return;
+        }
 
-    InputLength - Supplies the length of the input data in bytes.
+        ThreadCount = CkGetInteger(Vm, 2);
+        if ((ThreadCount < 0) || (ThreadCount > CK_LZ_MAX_THREADS)) {
+            CkRaiseBasicException(Vm, "ValueError", "Invalid thread count");
+            return;
+        }
+    }
 
-    FlushOption - Supplies the flush option indicating whether or not more data
-        is expected.
+    //
+    // Create a new context, replacing any left over from a previous call to
+    // __init.
+    //
 
-Return Value:
+    Context = CkpLzmaCreateContext();
+    if (Context == NULL) {
+        CkRaiseBasicException(Vm, "MemoryError", "Allocation failure");
+        return;
+    }
 
-    Returns some, all, or none of the compressed data, or raises an
-    exception on error.
+    Context->Encoder = TRUE;
+    if (CkPushData(Vm, Context, CkpLzmaDestroyContext) == FALSE) {
+        CkpLzmaDestroyContext(Context);
+        return;
+    }
 
---*/
+    CkSetField(Vm, 0);
+    if (Level == -1) {
+        Level = 5;
+    }
 
-{
+    if (ThreadCount == 0) {
+        ThreadCount = CkpLzmaGetProcessorCount();
+    }
 
-    PCK_LZ_CONTEXT Context;
-    LZ_STATUS LzStatus;
+#ifndef CK_LZ_THREADS
+
+    ThreadCount = 1;
+
+#endif
+
+    Context->Level = Level;
+    Context->FileWrapper = TRUE;
+    Context->BlockArchive = TRUE;
+    Context->ThreadCount = ThreadCount;
+    LzLzmaInitializeProperties(&(Context->Properties));
+    Context->Properties.Level = Level;
+    LzLzmaInitializeBlockHeader(&(Context->Header), BlockSize);
+    Context->Initialized = TRUE;
+    return;
+}
+
+VOID
+CkpLzmaBlockCompress (
+    PCK_VM Vm
+    )
+
+/*++
+
+Routine Description:
+
+    This routine compresses data into a block archive. It takes one argument:
+    the data to compress. Data is collected until there is a block for every
+    thread, and then those blocks are compressed all at once. It returns some
+    or none of the archive, which should be appended to the result of previous
+    calls.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+Return Value:
+
+    None. Returns some or none of the compressed data, or raises an exception
+    on error.
+
+--*/
+
+{
+
+    PCSTR Input;
+    UINTN InputLength;
+
+    if (!CkCheckArguments(Vm, 1, CkTypeString)) {
+        return;
+    }
+
+    Input = CkGetString(Vm, 1, &InputLength);
+    CkpLzmaBlockEncode(Vm, Input, InputLength, FALSE);
+    return;
+}
+
+VOID
+CkpLzmaBlockEncoderFinish (
+    PCK_VM Vm
+    )
+
+/*++
+
+Routine Description:
+
+    This routine finishes a block archive. It compresses any remaining data
+    and returns it along with the archive index and trailer.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    CkpLzmaBlockEncode(Vm, NULL, 0, TRUE);
+    return;
+}
+
+VOID
+CkpLzmaStats (
+    PCK_VM Vm
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns a statistics dictionary describing the current
+    state of the LZMA encoder or decoder.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONGLONG CompressedSize;
+    PCK_LZ_CONTEXT Context;
+    ULONGLONG UncompressedSize;
+
+    CkGetField(Vm, 0);
+    Context = CkGetData(Vm, -1);
+    CkStackPop(Vm);
+
+    //
+    // Block archives are made of many streams, so report the totals for the
+    // whole archive.
+    //
+
+    CompressedSize = Context->Lz.CompressedSize;
+    UncompressedSize = Context->Lz.UncompressedSize;
+    if (Context->BlockArchive != FALSE) {
+        CompressedSize = Context->CompressedSize;
+        UncompressedSize = Context->UncompressedSize;
+    }
+
+    CkPushDict(Vm);
+    CkPushString(Vm, "finished", 8);
+    CkPushInteger(Vm, Context->Finished);
+    CkDictSet(Vm, 1);
+    CkPushString(Vm, "status", 6);
+    CkPushInteger(Vm, Context->Status);
+    CkDictSet(Vm, 1);
+    CkPushString(Vm, "fileWrapper", 11);
+    CkPushInteger(Vm, Context->FileWrapper);
+    CkDictSet(Vm, 1);
+    CkPushString(Vm, "level", 5);
+    CkPushInteger(Vm, Context->Level);
+    CkDictSet(Vm, 1);
+    CkPushString(Vm, "compressedCrc32", 15);
+    CkPushInteger(Vm, Context->Lz.CompressedCrc32);
+    CkDictSet(Vm, 1);
+    CkPushString(Vm, "uncompressedCrc32", 17);
+    CkPushInteger(Vm, Context->Lz.UncompressedCrc32);
+    CkDictSet(Vm, 1);
+    CkPushString(Vm, "compressedSize", 14);
+    CkPushInteger(Vm, CompressedSize);
+    CkDictSet(Vm, 1);
+    CkPushString(Vm, "uncompressedSize", 16);
+    CkPushInteger(Vm, UncompressedSize);
+    CkDictSet(Vm, 1);
+    CkPushString(Vm, "blockArchive", 12);
+    CkPushInteger(Vm, Context->BlockArchive);
+    CkDictSet(Vm, 1);
+    CkPushString(Vm, "blockCount", 10);
+    CkPushInteger(Vm, Context->BlockCount);
+    CkDictSet(Vm, 1);
+    CkPushString(Vm, "threads", 7);
+    CkPushInteger(Vm, Context->ThreadCount);
+    CkDictSet(Vm, 1);
+    CkStackReplace(Vm, 0);
+    return;
+}
+
+VOID
+CkpLzmaEncode (
+    PCK_VM Vm,
+    PCVOID Input,
+    UINTN InputLength,
+    LZ_FLUSH_OPTION FlushOption
+    )
+
+/*++
+
+Routine Description:
+
+    This routine compresses LZMA data. The resulting compressed data is
+    returned in stack slot zero.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    Input - Supplies the input data to encode.
+
+    InputLength - Supplies the length of the input data in bytes.
+
+    FlushOption - Supplies the flush option indicating whether or not more data
+        is expected.
+
+Return Value:
+
+    Returns some, all, or none of the compressed data, or raises an
+    exception on error.
+
+--*/
+
+{
+
+    PCK_LZ_CONTEXT Context;
+    LZ_STATUS LzStatus;
     PVOID NewBuffer;
     UINTN NewCapacity;
     PSTR Output;
     UINTN OutputDone;
     UINTN OutputLength;
 
-    //
-    // Get the instance context.
-    //
+    //
+    // Get the instance context.
+    //
+
+    CkGetField(Vm, 0);
+    Context = CkGetData(Vm, -1);
+    CkStackPop(Vm);
+
+    assert((Context != NULL) && (Context->Encoder != FALSE));
+
+    //
+    // Create an output buffer that is as big as the input buffer. Almost
+    // certainly this will be too big.
+    //
+
+    OutputDone = 0;
+    OutputLength = InputLength;
+    if (OutputLength == 0) {
+        OutputLength = CK_LZ_DEFAULT_BUFFER_SIZE;
+
+    } else if (OutputLength < CK_LZ_MIN_BUFFER_SIZE) {
+        OutputLength = CK_LZ_MIN_BUFFER_SIZE;
+    }
+
+    Output = CkPushStringBuffer(Vm, OutputLength);
+    if (Output == NULL) {
+        return;
+    }
+
+    //
+    // If the stream is already finished, then complain or return quietly,
+    // depending on the input.
+    //
+
+    if (Context->Finished != FALSE) {
+        if (InputLength != 0) {
+            CkRaiseBasicException(Vm,
+                                  "ValueError",
+                                  "Stream is already complete");
+
+            return;
+        }
+
+        CkFinalizeString(Vm, -1, 0);
+        CkStackReplace(Vm, 0);
+        return;
+    }
+
+    Context->Lz.Input = Input;
+    Context->Lz.InputSize = InputLength;
+
+    //
+    // Loop shoving data into the compressor and pulling it out of the output.
+    //
+
+    while (TRUE) {
+        Context->Lz.Output = Output + OutputDone;
+        Context->Lz.OutputSize = OutputLength - OutputDone;
+        LzStatus = LzLzmaEncode(&(Context->Lz), FlushOption);
+        Context->Status = LzStatus;
+        OutputDone = Context->Lz.Output - (PVOID)Output;
+        if (LzStatus == LzStreamComplete) {
+            LzLzmaFinishEncode(&(Context->Lz));
+            Context->Finished = TRUE;
+            break;
+
+        } else if (LzStatus != LzSuccess) {
+            CkpLzmaRaiseLzError(Vm, LzStatus);
+            return;
+        }
+
+        if ((FlushOption == LzNoFlush) && (Context->Lz.InputSize == 0)) {
+            break;
+        }
+
+        //
+        // Reallocate the output buffer and try again.
+        //
+
+        assert(Context->Lz.OutputSize == 0);
+
+        NewCapacity = OutputLength * 2;
+        if (NewCapacity < OutputLength) {
+            CkRaiseBasicException(Vm, "ValueError", "Buffer size overflow");
+            return;
+        }
+
+        NewBuffer = CkPushStringBuffer(Vm, NewCapacity);
+        if (NewBuffer == NULL) {
+            return;
+        }
+
+        memcpy(NewBuffer, Output, OutputDone);
+        CkStackReplace(Vm, -2);
+        Output = NewBuffer;
+        OutputLength = NewCapacity;
+    }
+
+    //
+    // Return the output data.
+    //
+
+    CkFinalizeString(Vm, -1, OutputDone);
+    CkStackReplace(Vm, 0);
+    return;
+}
+
+VOID
+CkpLzmaBlockEncode (
+    PCK_VM Vm,
+    PCVOID Input,
+    UINTN InputLength,
+    BOOL Finish
+    )
+
+/*++
+
+Routine Description:
+
+    This routine adds data to a block archive. The resulting compressed data
+    is returned in stack slot zero.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    Input - Supplies the input data to encode.
+
+    InputLength - Supplies the length of the input data in bytes.
+
+    Finish - Supplies a boolean indicating whether this is the end of the
+        input, in which case the last blocks, index, and trailer are written.
+
+Return Value:
+
+    None. Returns some, all, or none of the compressed data, or raises an
+    exception on error.
+
+--*/
+
+{
+
+    UINTN BatchSize;
+    PCK_LZ_CONTEXT Context;
+    UINTN CopySize;
+    UINTN IndexSize;
+    CK_LZ_OUTPUT Output;
+    PCUCHAR Source;
+    LZMA_BLOCK_TRAILER Trailer;
+
+    CkGetField(Vm, 0);
+    Context = CkGetData(Vm, -1);
+    CkStackPop(Vm);
+
+    assert((Context != NULL) && (Context->BlockArchive != FALSE));
+
+    Output.Size = 0;
+    Output.Capacity = CK_LZ_MIN_BUFFER_SIZE;
+    Output.Buffer = CkPushStringBuffer(Vm, Output.Capacity);
+    if (Output.Buffer == NULL) {
+        return;
+    }
+
+    //
+    // If the stream is already finished, then complain or return quietly,
+    // depending on the input.
+    //
+
+    if (Context->Finished != FALSE) {
+        if (InputLength != 0) {
+            CkRaiseBasicException(Vm,
+                                  "ValueError",
+                                  "Stream is already complete");
+
+            return;
+        }
+
+        CkFinalizeString(Vm, -1, 0);
+        CkStackReplace(Vm, 0);
+        return;
+    }
+
+    //
+    // Write the header out first.
+    //
+
+    if (Context->CompressedSize == 0) {
+        if (!CkpLzmaAppendOutput(Vm,
+                                 &Output,
+                                 &(Context->Header),
+                                 sizeof(LZMA_BLOCK_HEADER))) {
+
+            return;
+        }
+
+        Context->CompressedSize = sizeof(LZMA_BLOCK_HEADER);
+    }
+
+    //
+    // Collect the input, compressing every time a full batch of blocks is
+    // ready.
+    //
+
+    BatchSize = (UINTN)(Context->Header.BlockSize) * Context->ThreadCount;
+    Source = Input;
+    while (InputLength != 0) {
+        if (Context->Buffer == NULL) {
+            Context->Buffer = malloc(BatchSize);
+            if (Context->Buffer == NULL) {
+                CkRaiseBasicException(Vm, "MemoryError", "Allocation failure");
+                return;
+            }
+
+            Context->BufferCapacity = BatchSize;
+        }
+
+        CopySize = BatchSize - Context->BufferSize;
+        if (CopySize > InputLength) {
+            CopySize = InputLength;
+        }
+
+        memcpy(Context->Buffer + Context->BufferSize, Source, CopySize);
+        Context->BufferSize += CopySize;
+        Source += CopySize;
+        InputLength -= CopySize;
+        if (Context->BufferSize == BatchSize) {
+            if (!CkpLzmaEncodeBatch(Vm, Context, &Output)) {
+                return;
+            }
+        }
+    }
+
+    //
+    // When finishing, compress whatever is left over, and then write out the
+    // index and trailer.
+    //
+
+    if (Finish != FALSE) {
+        if (Context->BufferSize != 0) {
+            if (!CkpLzmaEncodeBatch(Vm, Context, &Output)) {
+                return;
+            }
+        }
+
+        IndexSize = Context->BlockCount * sizeof(LZMA_BLOCK_INDEX_ENTRY);
+        LzLzmaInitializeBlockTrailer(&Trailer,
+                                     Context->Index,
+                                     Context->BlockCount,
+                                     Context->CompressedSize);
+
+        if ((!CkpLzmaAppendOutput(Vm, &Output, Context->Index, IndexSize)) ||
+            (!CkpLzmaAppendOutput(Vm, &Output, &Trailer, sizeof(Trailer)))) {
+
+            return;
+        }
+
+        Context->CompressedSize += IndexSize + sizeof(Trailer);
+        Context->Status = LzStreamComplete;
+        Context->Finished = TRUE;
+        free(Context->Buffer);
+        Context->Buffer = NULL;
+        Context->BufferCapacity = 0;
+    }
+
+    CkFinalizeString(Vm, -1, Output.Size);
+    CkStackReplace(Vm, 0);
+    return;
+}
+
+BOOL
+CkpLzmaEncodeBatch (
+    PCK_VM Vm,
+    PCK_LZ_CONTEXT Context,
+    PCK_LZ_OUTPUT Output
+    )
+
+/*++
+
+Routine Description:
+
+    This routine compresses the data collected in the block encoder's buffer,
+    splitting it into blocks and spreading them across the encoder's threads.
+    The compressed blocks are appended to the output, and the buffer is
+    emptied.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    Context - Supplies a pointer to the block encoder context.
+
+    Output - Supplies a pointer to the output being built.
+
+Return Value:
+
+    TRUE on success.
+
+    FALSE if an exception was raised.
+
+--*/
+
+{
+
+    CK_LZ_BATCH Batch;
+    PCK_LZ_BLOCK Block;
+    ULONG BlockCount;
+    ULONG BlockIndex;
+    PCK_LZ_BLOCK Blocks;
+    UINTN BlockSize;
+    LZ_STATUS LzStatus;
+    BOOL Result;
+    ULONG ThreadCount;
+
+#ifdef CK_LZ_THREADS
+
+    ULONG Created;
+    pthread_t Threads[CK_LZ_MAX_THREADS];
+
+#endif
+
+    BlockSize = Context->Header.BlockSize;
+    BlockCount = (Context->BufferSize + BlockSize - 1) / BlockSize;
+    Blocks = calloc(BlockCount, sizeof(CK_LZ_BLOCK));
+    if (Blocks == NULL) {
+        CkRaiseBasicException(Vm, "MemoryError", "Allocation failure");
+        return FALSE;
+    }
+
+    for (BlockIndex = 0; BlockIndex < BlockCount; BlockIndex += 1) {
+        Block = &(Blocks[BlockIndex]);
+        Block->Input = Context->Buffer + (BlockIndex * BlockSize);
+        Block->InputSize = BlockSize;
+        if (BlockIndex == BlockCount - 1) {
+            Block->InputSize = Context->BufferSize - (BlockIndex * BlockSize);
+        }
+    }
+
+    Batch.Properties = &(Context->Properties);
+    Batch.Blocks = Blocks;
+    Batch.BlockCount = BlockCount;
+    Batch.NextBlock = 0;
+    ThreadCount = Context->ThreadCount;
+    if (ThreadCount > BlockCount) {
+        ThreadCount = BlockCount;
+    }
+
+#ifdef CK_LZ_THREADS
+
+    //
+    // Spin up helper threads, and then have the calling thread pitch in too.
+    // If threads fail to be created, the work simply gets done by fewer of
+    // them.
+    //
+
+    pthread_mutex_init(&(Batch.Lock), NULL);
+    Created = 0;
+    while (Created < ThreadCount - 1) {
+        if (pthread_create(&(Threads[Created]),
+                           NULL,
+                           CkpLzmaBatchWorker,
+                           &Batch) != 0) {
+
+            break;
+        }
+
+        Created += 1;
+    }
+
+    CkpLzmaBatchWorker(&Batch);
+    while (Created != 0) {
+        Created -= 1;
+        pthread_join(Threads[Created], NULL);
+    }
+
+    pthread_mutex_destroy(&(Batch.Lock));
+
+#else
+
+    CkpLzmaBatchWorker(&Batch);
+
+#endif
+
+    //
+    // Write the blocks out in order, recording each one in the index.
+    //
+
+    Result = FALSE;
+    for (BlockIndex = 0; BlockIndex < BlockCount; BlockIndex += 1) {
+        Block = &(Blocks[BlockIndex]);
+        LzStatus = Block->Status;
+        if (LzStatus != LzSuccess) {
+            Context->Status = LzStatus;
+            CkpLzmaRaiseLzError(Vm, LzStatus);
+            goto EncodeBatchEnd;
+        }
+
+        if (!CkpLzmaAppendOutput(Vm,
+                                 Output,
+                                 Block->Output,
+                                 Block->OutputSize)) {
+
+            goto EncodeBatchEnd;
+        }
+
+        if (!CkpLzmaAddIndexEntry(Context,
+                                  Block->OutputSize,
+                                  Block->InputSize,
+                                  Block->Crc32)) {
+
+            CkRaiseBasicException(Vm, "MemoryError", "Allocation failure");
+            goto EncodeBatchEnd;
+        }
+
+        Context->CompressedSize += Block->OutputSize;
+        Context->UncompressedSize += Block->InputSize;
+    }
+
+    Context->BufferSize = 0;
+    Result = TRUE;
+
+EncodeBatchEnd:
+    for (BlockIndex = 0; BlockIndex < BlockCount; BlockIndex += 1) {
+        if (Blocks[BlockIndex].Output != NULL) {
+            free(Blocks[BlockIndex].Output);
+        }
+    }
+
+    free(Blocks);
+    return Result;
+}
+
+PVOID
+CkpLzmaBatchWorker (
+    PVOID Parameter
+    )
+
+/*++
+
+Routine Description:
+
+    This routine implements the work loop for a thread helping with a batch of
+    blocks. It grabs blocks off the batch until there are none left.
+
+Arguments:
+
+    Parameter - Supplies a pointer to the batch.
+
+Return Value:
+
+    NULL always.
+
+--*/
+
+{
+
+    PCK_LZ_BATCH Batch;
+    PCK_LZ_BLOCK Block;
+    ULONG BlockIndex;
+
+    Batch = Parameter;
+    while (TRUE) {
+
+#ifdef CK_LZ_THREADS
+
+        pthread_mutex_lock(&(Batch->Lock));
+
+#endif
+
+        BlockIndex = Batch->NextBlock;
+        if (BlockIndex < Batch->BlockCount) {
+            Batch->NextBlock += 1;
+        }
+
+#ifdef CK_LZ_THREADS
+
+        pthread_mutex_unlock(&(Batch->Lock));
+
+#endif
+
+        if (BlockIndex >= Batch->BlockCount) {
+            break;
+        }
+
+        Block = &(Batch->Blocks[BlockIndex]);
+        Block->Status = LzLzmaEncodeBlock((PLZ_REALLOCATE)realloc,
+                                          Batch->Properties,
+                                          Block->Input,
+                                          Block->InputSize,
+                                          &(Block->Output),
+                                          &(Block->OutputSize),
+                                          &(Block->Crc32));
+    }
+
+    return NULL;
+}
+
+VOID
+CkpLzmaDecode (
+    PCK_VM Vm,
+    PCVOID Input,
+    UINTN InputLength,
+    LZ_FLUSH_OPTION FlushOption
+    )
+
+/*++
+
+Routine Description:
+
+    This routine decompresses LZMA data. The resulting decompressed data is
+    written to the return stack slot.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    Input - Supplies the input data to encode.
+
+    InputLength - Supplies the length of the input data in bytes.
+
+    FlushOption - Supplies the flush option indicating whether or not more data
+        is expected.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PCK_LZ_CONTEXT Context;
+    UINTN CopySize;
+    PCUCHAR Source;
+    LZ_STATUS LzStatus;
+    ULONG Magic;
+    CK_LZ_OUTPUT Output;
+
+    //
+    // Get the instance context.
+    //
+
+    CkGetField(Vm, 0);
+    Context = CkGetData(Vm, -1);
+    CkStackPop(Vm);
+
+    assert((Context != NULL) && (Context->Encoder == FALSE));
+
+    //
+    // Create an output buffer that is four times as big as the input buffer.
+    // This is just a wild guess.
+    //
+
+    Output.Size = 0;
+    Output.Capacity = InputLength * 4;
+    if (Output.Capacity == 0) {
+        Output.Capacity = CK_LZ_DEFAULT_BUFFER_SIZE;
+    }
+
+    Output.Buffer = CkPushStringBuffer(Vm, Output.Capacity);
+    if (Output.Buffer == NULL) {
+        return;
+    }
+
+    //
+    // If the stream is already finished, then complain or return quietly,
+    // depending on the input.
+    //
+
+    if (Context->Finished != FALSE) {
+        if (InputLength != 0) {
+            CkRaiseBasicException(Vm,
+                                  "ValueError",
+                                  "Stream is already complete");
+
+            return;
+        }
+
+        CkFinalizeString(Vm, -1, 0);
+        CkStackReplace(Vm, 0);
+        return;
+    }
+
+    //
+    // A file wrapped stream might instead be a block archive. Collect enough
+    // of the beginning to check the magic before picking a format.
+    //
+
+    Source = Input;
+    if (Context->Stage == CkLzStageDetect) {
+        CopySize = LZMA_HEADER_MAGIC_SIZE - Context->StagingSize;
+        if (CopySize > InputLength) {
+            CopySize = InputLength;
+        }
+
+        memcpy(Context->Staging + Context->StagingSize, Source, CopySize);
+        Context->StagingSize += CopySize;
+        Source += CopySize;
+        InputLength -= CopySize;
+        if (Context->StagingSize == LZMA_HEADER_MAGIC_SIZE) {
+            memcpy(&Magic, Context->Staging, sizeof(Magic));
+            if (Magic == LZMA_BLOCK_HEADER_MAGIC) {
+                LzLzmaFinishDecode(&(Context->Lz));
+                Context->BlockArchive = TRUE;
+                Context->Stage = CkLzStageBlockHeader;
+                Context->CompressedSize = Context->StagingSize;
+
+            } else {
+                Context->Stage = CkLzStageStream;
+            }
+
+        } else if (FlushOption != LzNoFlush) {
+            Context->Stage = CkLzStageStream;
+
+        } else {
+            CkFinalizeString(Vm, -1, 0);
+            CkStackReplace(Vm, 0);
+            return;
+        }
+
+        //
+        // Feed the bytes used to check the magic to the stream decoder.
+        //
+
+        if (Context->Stage == CkLzStageStream) {
+            LzStatus = CkpLzmaDecodeStream(Vm,
+                                           Context,
+                                           Context->Staging,
+                                           Context->StagingSize,
+                                           LzNoFlush,
+                                           &Output);
+
+            Context->StagingSize = 0;
+            if (LzStatus != LzSuccess) {
+                return;
+            }
+        }
+    }
+
+    if (Context->BlockArchive != FALSE) {
+        LzStatus = CkpLzmaDecodeBlocks(Vm,
+                                       Context,
+                                       Source,
+                                       InputLength,
+                                       &Output);
+
+        if (LzStatus != LzSuccess) {
+            return;
+        }
+
+        if (Context->Stage == CkLzStageBlockComplete) {
+            Context->Status = LzStreamComplete;
+            Context->Finished = TRUE;
+
+        } else if (FlushOption != LzNoFlush) {
+            Context->Status = LzErrorInputEof;
+            CkpLzmaRaiseLzError(Vm, LzErrorInputEof);
+            return;
+        }
+
+    } else if ((InputLength != 0) || (FlushOption != LzNoFlush)) {
+        LzStatus = CkpLzmaDecodeStream(Vm,
+                                       Context,
+                                       Source,
+                                       InputLength,
+                                       FlushOption,
+                                       &Output);
+
+        if (LzStatus == LzStreamComplete) {
+            LzLzmaFinishDecode(&(Context->Lz));
+            Context->Finished = TRUE;
+
+        } else if (LzStatus != LzSuccess) {
+            return;
+        }
+    }
+
+    //
+    // Return the output data.
+    //
+
+    CkFinalizeString(Vm, -1, Output.Size);
+    CkStackReplace(Vm, 0);
+    return;
+}
+
+LZ_STATUS
+CkpLzmaDecodeStream (
+    PCK_VM Vm,
+    PCK_LZ_CONTEXT Context,
+    PCVOID Input,
+    UINTN InputLength,
+    LZ_FLUSH_OPTION FlushOption,
+    PCK_LZ_OUTPUT Output
+    )
+
+/*++
+
+Routine Description:
+
+    This routine runs data through the LZMA stream decoder, appending the
+    results to the output. It stops at the end of the stream, leaving any
+    input after it in the LZ context.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    Context - Supplies a pointer to the decoder context.
+
+    Input - Supplies the input data to decode.
+
+    InputLength - Supplies the length of the input data in bytes.
+
+    FlushOption - Supplies the flush option indicating whether or not more data
+        is expected.
+
+    Output - Supplies a pointer to the output being built.
+
+Return Value:
+
+    LzSuccess if all the input was consumed.
+
+    LzStreamComplete if the end of the stream was reached.
+
+    Other LZ status codes on failure, in which case an exception has been
+    raised.
+
+--*/
+
+{
+
+    LZ_STATUS LzStatus;
+
+    Context->Lz.Input = Input;
+    Context->Lz.InputSize = InputLength;
+
+    //
+    // Loop shoving data into the decompressor and pulling it out of the output.
+    //
+
+    while (TRUE) {
+        Context->Lz.Output = Output->Buffer + Output->Size;
+        Context->Lz.OutputSize = Output->Capacity - Output->Size;
+        LzStatus = LzLzmaDecode(&(Context->Lz), FlushOption);
+        Output->Size = Context->Lz.Output - (PVOID)(Output->Buffer);
+        Context->Status = LzStatus;
+        if (LzStatus == LzStreamComplete) {
+            break;
+
+        } else if (LzStatus != LzSuccess) {
+            CkpLzmaRaiseLzError(Vm, LzStatus);
+            break;
+        }
+
+        if ((Context->Lz.InputSize == 0) && (FlushOption == LzNoFlush)) {
+            break;
+        }
+
+        //
+        // Reallocate the output buffer and try again.
+        //
+
+        assert(Context->Lz.OutputSize == 0);
+
+        if (!CkpLzmaGrowOutput(Vm, Output, Output->Capacity)) {
+            LzStatus = LzErrorMemory;
+            break;
+        }
+    }
+
+    return LzStatus;
+}
+
+LZ_STATUS
+CkpLzmaDecodeBlocks (
+    PCK_VM Vm,
+    PCK_LZ_CONTEXT Context,
+    PCUCHAR Input,
+    UINTN InputLength,
+    PCK_LZ_OUTPUT Output
+    )
+
+/*++
+
+Routine Description:
+
+    This routine decodes part of a block archive. The blocks are decoded one
+    after another as they stream in, with each one's size and CRC recorded so
+    that the index at the end can be checked against what was actually
+    decoded.
+
+Arguments:
+
+    Vm - Supplies a pointer to the virtual machine.
+
+    Context - Supplies a pointer to the decoder context.
+
+    Input - Supplies the input data to decode.
+
+    InputLength - Supplies the length of the input data in bytes.
+
+    Output - Supplies a pointer to the output being built.
+
+Return Value:
+
+    LzSuccess on success.
+
+    Other LZ status codes on failure, in which case an exception has been
+    raised.
+
+--*/
+
+{
+
+    UINTN Consumed;
+    UINTN CopySize;
+    LZ_STATUS LzStatus;
+    ULONG Magic;
+
+    LzStatus = LzSuccess;
+    while (InputLength != 0) {
+        switch (Context->Stage) {
+
+        //
+        // Collect and validate the archive header.
+        //
+
+        case CkLzStageBlockHeader:
+            CopySize = sizeof(LZMA_BLOCK_HEADER) - Context->StagingSize;
+            if (CopySize > InputLength) {
+                CopySize = InputLength;
+            }
+
+            memcpy(Context->Staging + Context->StagingSize, Input, CopySize);
+            Context->StagingSize += CopySize;
+            Context->CompressedSize += CopySize;
+            Input += CopySize;
+            InputLength -= CopySize;
+            if (Context->StagingSize == sizeof(LZMA_BLOCK_HEADER)) {
+                memcpy(&(Context->Header),
+                       Context->Staging,
+                       sizeof(LZMA_BLOCK_HEADER));
+
+                Context->StagingSize = 0;
+                LzStatus = LzLzmaValidateBlockHeader(&(Context->Header));
+                if (LzStatus != LzSuccess) {
+                    goto DecodeBlocksEnd;
+                }
+
+                Context->Stage = CkLzStageBlockStart;
+            }
+
+            break;
+
+        //
+        // Every block starts with the LZMA file magic, and the index never
+        // does, since its first field is the offset of the first block (or
+        // of the index itself in an empty archive).
+        //
+
+        case CkLzStageBlockStart:
+            CopySize = LZMA_HEADER_MAGIC_SIZE - Context->StagingSize;
+            if (CopySize > InputLength) {
+                CopySize = InputLength;
+            }
+
+            memcpy(Context->Staging + Context->StagingSize, Input, CopySize);
+            Context->StagingSize += CopySize;
+            Input += CopySize;
+            InputLength -= CopySize;
+            if (Context->StagingSize != LZMA_HEADER_MAGIC_SIZE) {
+                break;
+            }
+
+            Context->StagingSize = 0;
+            memcpy(&Magic, Context->Staging, sizeof(Magic));
+            if (Magic != LZMA_HEADER_MAGIC) {
+                Context->BufferCapacity =
+                            (Context->BlockCount *
+                             sizeof(LZMA_BLOCK_INDEX_ENTRY)) +
+                            sizeof(LZMA_BLOCK_TRAILER);
+
+                Context->Buffer = malloc(Context->BufferCapacity);
+                if (Context->Buffer == NULL) {
+                    LzStatus = LzErrorMemory;
+                    goto DecodeBlocksEnd;
+                }
+
+                memcpy(Context->Buffer,
+                       Context->Staging,
+                       LZMA_HEADER_MAGIC_SIZE);
+
+                Context->BufferSize = LZMA_HEADER_MAGIC_SIZE;
+                Context->CompressedSize += LZMA_HEADER_MAGIC_SIZE;
+                Context->Stage = CkLzStageBlockTail;
+                break;
+            }
+
+            memset(&(Context->Lz), 0, sizeof(LZ_CONTEXT));
+            Context->Lz.Reallocate = (PLZ_REALLOCATE)realloc;
+            LzStatus = LzLzmaInitializeDecoder(&(Context->Lz), NULL, TRUE);
+            if (LzStatus != LzSuccess) {
+                goto DecodeBlocksEnd;
+            }
+
+            Context->BlockOffset = Context->CompressedSize;
+            Context->CompressedSize += LZMA_HEADER_MAGIC_SIZE;
+            Context->Stage = CkLzStageBlock;
+            LzStatus = CkpLzmaDecodeStream(Vm,
+                                           Context,
+                                           Context->Staging,
+                                           LZMA_HEADER_MAGIC_SIZE,
+                                           LzNoFlush,
+                                           Output);
+
+            if (LzStatus != LzSuccess) {
+                return LzStatus;
+            }
+
+            break;
+
+        //
+        // Decode the current block until it ends, and then record it.
+        //
+
+        case CkLzStageBlock:
+            LzStatus = CkpLzmaDecodeStream(Vm,
+                                           Context,
+                                           Input,
+                                           InputLength,
+                                           LzNoFlush,
+                                           Output);
+
+            if ((LzStatus != LzSuccess) && (LzStatus != LzStreamComplete)) {
+                return LzStatus;
+            }
+
+            Consumed = InputLength - Context->Lz.InputSize;
+            Context->CompressedSize += Consumed;
+            Input += Consumed;
+            InputLength -= Consumed;
+            if (LzStatus == LzStreamComplete) {
+                LzLzmaFinishDecode(&(Context->Lz));
+                if (!CkpLzmaAddIndexEntry(
+                                Context,
+                                Context->CompressedSize - Context->BlockOffset,
+                                Context->Lz.UncompressedSize,
+                                Context->Lz.UncompressedCrc32)) {
+
+                    LzStatus = LzErrorMemory;
+                    goto DecodeBlocksEnd;
+                }
+
+                Context->UncompressedSize += Context->Lz.UncompressedSize;
+                Context->Stage = CkLzStageBlockStart;
+                Context->Status = LzSuccess;
+                LzStatus = LzSuccess;
+            }
+
+            break;
+
+        //
+        // Collect the index and trailer, whose size is known now that all
+        // the blocks have been seen.
+        //
+
+        case CkLzStageBlockTail:
+            CopySize = Context->BufferCapacity - Context->BufferSize;
+            if (CopySize > InputLength) {
+                CopySize = InputLength;
+            }
+
+            memcpy(Context->Buffer + Context->BufferSize, Input, CopySize);
+            Context->BufferSize += CopySize;
+            Context->CompressedSize += CopySize;
+            Input += CopySize;
+            InputLength -= CopySize;
+            if (Context->BufferSize == Context->BufferCapacity) {
+                LzStatus = CkpLzmaValidateBlockTail(Context);
+                if (LzStatus != LzSuccess) {
+                    goto DecodeBlocksEnd;
+                }
+
+                Context->Stage = CkLzStageBlockComplete;
+            }
+
+            break;
+
+        //
+        // Nothing is allowed after the trailer.
+        //
+
+        default:
+            LzStatus = LzErrorCorruptData;
+            goto DecodeBlocksEnd;
+        }
+    }
+
+DecodeBlocksEnd:
+    if (LzStatus != LzSuccess) {
+        Context->Status = LzStatus;
+        CkpLzmaRaiseLzError(Vm, LzStatus);
+    }
+
+    return LzStatus;
+}
+
+LZ_STATUS
+CkpLzmaValidateBlockTail (
+    PCK_LZ_CONTEXT Context
+    )
+
+/*++
+
+Routine Description:
+
+    This routine validates the index and trailer at the end of a block archive
+    against the blocks that were decoded.
+
+Arguments:
+
+    Context - Supplies a pointer to the decoder context, whose buffer holds
+        the index and trailer.
+
+Return Value:
+
+    LZ status code.
+
+--*/
+
+{
 
-    CkGetField(Vm, 0);
-    Context = CkGetData(Vm, -1);
-    CkStackPop(Vm);
+    PLZMA_BLOCK_INDEX_ENTRY Index;
+    UINTN IndexSize;
+    LZ_STATUS LzStatus;
+    LZMA_BLOCK_TRAILER Trailer;
 
-    assert((Context != NULL) && (Context->Encoder != FALSE));
+    IndexSize = Context->BlockCount * sizeof(LZMA_BLOCK_INDEX_ENTRY);
+    memcpy(&Trailer, Context->Buffer + IndexSize, sizeof(Trailer));
+    if ((Trailer.BlockCount != Context->BlockCount) ||
+        (Trailer.IndexOffset !=
+         Context->CompressedSize - IndexSize - sizeof(Trailer))) {
 
-    //
-    // Create an output buffer that is as big as the input buffer. Almost
-    // certainly this will be too big.
-    //
+        return LzErrorCorruptData;
+    }
 
-    OutputDone = 0;
-    OutputLength = InputLength;
-    if (OutputLength == 0) {
-        OutputLength = CK_LZ_DEFAULT_BUFFER_SIZE;
+    Index = (PLZMA_BLOCK_INDEX_ENTRY)(Context->Buffer);
+    LzStatus = LzLzmaValidateBlockIndex(&(Context->Header), &Trailer, Index);
 
-    } else if (OutputLength < CK_LZ_MIN_BUFFER_SIZE) {
-        OutputLength = CK_LZ_MIN_BUFFER_SIZE;
+    if (LzStatus != LzSuccess) {
+        return LzStatus;
     }
 
-    Output = CkPushStringBuffer(Vm, OutputLength);
-    if (Output == NULL) {
-        return;
+    if ((IndexSize != 0) &&
+        (memcmp(Index, Context->Index, IndexSize) != 0)) {
+
+        return LzErrorCorruptData;
     }
 
-    //
-    // If the stream is already finished, then complain or return quietly,
-    // depending on the input.
-    //
+    return LzSuccess;
+}
 
-    if (Context->Finished != FALSE) {
-        if (InputLength != 0) {
-            CkRaiseBasicException(Vm,
-                                  "ValueError",
-                                  "Stream is already complete");
+BOOL
+CkpLzmaAddIndexEntry (
+    PCK_LZ_CONTEXT Context,
+    ULONGLONG CompressedSize,
+    ULONGLONG UncompressedSize,
+    ULONG Crc32
+    )
 
-            return;
-        }
+/*++
 
-        CkFinalizeString(Vm, -1, 0);
-        CkStackReplace(Vm, 0);
-        return;
-    }
+Routine Description:
 
-    Context->Lz.Input = Input;
-    Context->Lz.InputSize = InputLength;
+    This routine records a block in the block archive index. The block is
+    assumed to start at the current compressed size.
 
-    //
-    // Loop shoving data into the compressor and pulling it out of the output.
-    //
+Arguments:
 
-    while (TRUE) {
-        Context->Lz.Output = Output + OutputDone;
-        Context->Lz.OutputSize = OutputLength - OutputDone;
-        LzStatus = LzLzmaEncode(&(Context->Lz), FlushOption);
-        Context->Status = LzStatus;
-        OutputDone = Context->Lz.Output - (PVOID)Output;
-        if (LzStatus == LzStreamComplete) {
-            LzLzmaFinishEncode(&(Context->Lz));
-            Context->Finished = TRUE;
-            break;
+    Context - Supplies a pointer to the encoder or decoder context.
 
-        } else if (LzStatus != LzSuccess) {
-            CkpLzmaRaiseLzError(Vm, LzStatus);
-            return;
-        }
+    CompressedSize - Supplies the size of the compressed block.
 
-        if ((FlushOption == LzNoFlush) && (Context->Lz.InputSize == 0)) {
-            break;
-        }
+    UncompressedSize - Supplies the size of the block's data.
 
-        //
-        // Reallocate the output buffer and try again.
-        //
+    Crc32 - Supplies the CRC32 of the block's data.
 
-        assert(Context->Lz.OutputSize == 0);
+Return Value:
 
-        NewCapacity = OutputLength * 2;
-        if (NewCapacity < OutputLength) {
-            CkRaiseBasicException(Vm, "ValueError", "Buffer size overflow");
-            return;
+    TRUE on success.
+
+    FALSE on allocation failure.
+
+--*/
+
+{
+
+    PLZMA_BLOCK_INDEX_ENTRY Entry;
+    ULONG NewCapacity;
+    PVOID NewIndex;
+
+    if (Context->BlockCount == Context->IndexCapacity) {
+        NewCapacity = Context->IndexCapacity * 2;
+        if (NewCapacity == 0) {
+            NewCapacity = 16;
         }
 
-        NewBuffer = CkPushStringBuffer(Vm, NewCapacity);
-        if (NewBuffer == NULL) {
-            return;
+        NewIndex = realloc(Context->Index,
+                           NewCapacity * sizeof(LZMA_BLOCK_INDEX_ENTRY));
+
+        if (NewIndex == NULL) {
+            return FALSE;
         }
 
-        memcpy(NewBuffer, Output, OutputDone);
-        CkStackReplace(Vm, -2);
-        Output = NewBuffer;
-        OutputLength = NewCapacity;
+        Context->Index = NewIndex;
+        Context->IndexCapacity = NewCapacity;
     }
 
-    //
-    // Return the output data.
-    //
+    Entry = &(Context->Index[Context->BlockCount]);
+    Entry->Offset = Context->CompressedSize;
+    if (Context->Encoder == FALSE) {
+        Entry->Offset = Context->BlockOffset;
+    }
 
-    CkFinalizeString(Vm, -1, OutputDone);
-    CkStackReplace(Vm, 0);
-    return;
+    Entry->CompressedSize = CompressedSize;
+    Entry->UncompressedSize = UncompressedSize;
+    Entry->UncompressedCrc32 = Crc32;
+    Entry->Reserved = 0;
+    Context->BlockCount += 1;
+    return TRUE;
 }
 
-VOID
-CkpLzmaDecode (
+BOOL
+CkpLzmaAppendOutput (
     PCK_VM Vm,
-    PCVOID Input,
-    UINTN InputLength,
-    LZ_FLUSH_OPTION FlushOption
+    PCK_LZ_OUTPUT Output,
+    PCVOID Data,
+    UINTN Size
     )
 
 /*++
 
 Routine Description:
 
-    This routine decompresses LZMA data. The resulting decompressed data is
-    written to the return stack slot.
+    This routine appends data to the output being built.
 
 Arguments:
 
     Vm - Supplies a pointer to the virtual machine.
 
-    Input - Supplies the input data to encode.
+    Output - Supplies a pointer to the output.
 
-    InputLength - Supplies the length of the input data in bytes.
+    Data - Supplies the data to append.
 
-    FlushOption - Supplies the flush option indicating whether or not more data
-        is expected.
+    Size - Supplies the number of bytes to append.
 
 Return Value:
 
-    None.
+    TRUE on success.
+
+    FALSE if an exception was raised.
 
 --*/
 
 {
 
-    PCK_LZ_CONTEXT Context;
-    LZ_STATUS LzStatus;
-    PVOID NewBuffer;
-    UINTN NewCapacity;
-    PSTR Output;
-    UINTN OutputDone;
-    UINTN OutputLength;
-
-    //
-    // Get the instance context.
-    //
-
-    CkGetField(Vm, 0);
-    Context = CkGetData(Vm, -1);
-    CkStackPop(Vm);
-
-    assert((Context != NULL) && (Context->Encoder == FALSE));
+    if (Output->Capacity - Output->Size < Size) {
+        if (!CkpLzmaGrowOutput(Vm, Output, Size)) {
+            return FALSE;
+        }
+    }
 
-    //
-    // Create an output buffer that is four times as big as the input buffer.
-    // This is just a wild guess.
-    //
+    memcpy(Output->Buffer + Output->Size, Data, Size);
+    Output->Size += Size;
+    return TRUE;
+}
 
-    OutputDone = 0;
-    OutputLength = InputLength * 4;
-    if (OutputLength == 0) {
-        OutputLength = CK_LZ_DEFAULT_BUFFER_SIZE;
-    }
+BOOL
+CkpLzmaGrowOutput (
+    PCK_VM Vm,
+    PCK_LZ_OUTPUT Output,
+    UINTN Size
+    )
 
-    Output = CkPushStringBuffer(Vm, OutputLength);
-    if (Output == NULL) {
-        return;
-    }
+/*++
 
-    //
-    // If the stream is already finished, then complain or return quietly,
-    // depending on the input.
-    //
+Routine Description:
 
-    if (Context->Finished != FALSE) {
-        if (InputLength != 0) {
-            CkRaiseBasicException(Vm,
-                                  "ValueError",
-                                  "Stream is already complete");
+    This routine makes room for at least the given number of additional bytes
+    in the output, replacing the string buffer at the top of the stack with a
+    bigger one.
 
-            return;
-        }
+Arguments:
 
-        CkFinalizeString(Vm, -1, 0);
-        CkStackReplace(Vm, 0);
-        return;
-    }
+    Vm - Supplies a pointer to the virtual machine.
 
-    Context->Lz.Input = Input;
-    Context->Lz.InputSize = InputLength;
+    Output - Supplies a pointer to the output.
 
-    //
-    // Loop shoving data into the decompressor and pulling it out of the output.
-    //
+    Size - Supplies the number of additional bytes needed.
 
-    while (TRUE) {
-        Context->Lz.Output = Output + OutputDone;
-        Context->Lz.OutputSize = OutputLength - OutputDone;
-        LzStatus = LzLzmaDecode(&(Context->Lz), FlushOption);
-        OutputDone = Context->Lz.Output - (PVOID)Output;
-        Context->Status = LzStatus;
-        if (LzStatus == LzStreamComplete) {
-            LzLzmaFinishDecode(&(Context->Lz));
-            Context->Finished = TRUE;
-            break;
+Return Value:
 
-        } else if (LzStatus != LzSuccess) {
-            CkpLzmaRaiseLzError(Vm, LzStatus);
-            return;
-        }
+    TRUE on success.
 
-        if ((Context->Lz.InputSize == 0) && (FlushOption == LzNoFlush)) {
-            break;
-        }
+    FALSE if an exception was raised.
 
-        //
-        // Reallocate the output buffer and try again.
-        //
+--*/
 
-        assert(Context->Lz.OutputSize == 0);
+{
 
-        NewCapacity = OutputLength * 2;
-        if (NewCapacity < OutputLength) {
-            CkRaiseBasicException(Vm, "ValueError", "Buffer size overflow");
-            return;
-        }
+    PVOID NewBuffer;
+    UINTN NewCapacity;
 
-        NewBuffer = CkPushStringBuffer(Vm, NewCapacity);
-        if (NewBuffer == NULL) {
-            return;
-        }
+    NewCapacity = Output->Capacity * 2;
+    if (NewCapacity - Output->Size < Size) {
+        NewCapacity = Output->Size + Size;
+    }
 
-        memcpy(NewBuffer, Output, OutputDone);
-        CkStackReplace(Vm, -2);
-        Output = NewBuffer;
-        OutputLength = NewCapacity;
+    if ((NewCapacity < Output->Capacity) || (NewCapacity < Size)) {
+        CkRaiseBasicException(Vm, "ValueError", "Buffer size overflow");
+        return FALSE;
     }
 
-    //
-    // Return the output data.
-    //
+    NewBuffer = CkPushStringBuffer(Vm, NewCapacity);
+    if (NewBuffer == NULL) {
+        return FALSE;
+    }
 
-    CkFinalizeString(Vm, -1, OutputDone);
-    CkStackReplace(Vm, 0);
-    return;
+    memcpy(NewBuffer, Output->Buffer, Output->Size);
+    CkStackReplace(Vm, -2);
+    Output->Buffer = NewBuffer;
+    Output->Capacity = NewCapacity;
+    return TRUE;
 }
 
 VOID
@@ -1172,8 +2712,16 @@ Return Value:
         Context->Lz.Output = NULL;
         Context->Lz.OutputSize = 0;
         if (Context->Finished == FALSE) {
+
+            //
+            // The block encoder compresses each block with its own encoder,
+            // so it has no stream to finish.
+            //
+
             if (Context->Encoder != FALSE) {
-                LzLzmaFinishEncode(&(Context->Lz));
+                if (Context->BlockArchive == FALSE) {
+                    LzLzmaFinishEncode(&(Context->Lz));
+                }
 
             } else {
                 LzLzmaFinishDecode(&(Context->Lz));
@@ -1183,7 +2731,57 @@ Return Value:
         }
     }
 
+    if (Context->Buffer != NULL) {
+        free(Context->Buffer);
+    }
+
+    if (Context->Index != NULL) {
+        free(Context->Index);
+    }
+
     free(Context);
     return;
 }
 
+ULONG
+CkpLzmaGetProcessorCount (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the number of threads to use for block compression
+    when the caller asks for one per processor.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns the default thread count.
+
+--*/
+
+{
+
+#ifdef CK_LZ_THREADS
+
+    long Count;
+
+    Count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (Count > CK_LZ_MAX_THREADS) {
+        Count = CK_LZ_MAX_THREADS;
+    }
+
+    if (Count > 0) {
+        return Count;
+    }
+
+#endif
+
+    return 1;
+}
+
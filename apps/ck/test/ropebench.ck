@@ -0,0 +1,294 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    ropebench.ck
+
+Abstract:
+
+    This module benchmarks building a large generated build file, the way
+    mingen does, using several string building styles. Run it with chalk.
+
+Author:
+
+    agent 18-Oct-2026
+
+Environment:
+
+    Chalk
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+import _time;
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// Define the number of build targets to generate. Each one is a few hundred
+// bytes, so the generated file is several megabytes.
+//
+
+var TARGET_COUNT = 20000;
+
+//
+// Define the number of inputs each target has.
+//
+
+var INPUT_COUNT = 6;
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+function
+_targetText (
+    index
+    );
+
+function
+_now (
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+function
+benchLocalAppend (
+    )
+
+/*++
+
+Routine Description:
+
+    This routine builds the file by appending to a local variable.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns the generated text.
+
+--*/
+
+{
+
+    var index;
+    var text = "";
+
+    for (index in 0..TARGET_COUNT) {
+        text += _targetText(index);
+    }
+
+    return text;
+}
+
+function
+benchListAppend (
+    )
+
+/*++
+
+Routine Description:
+
+    This routine builds the file by appending to a list element, which
+    exercises storing unflattened strings into a container.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns the generated text.
+
+--*/
+
+{
+
+    var index;
+    var text = [""];
+
+    for (index in 0..TARGET_COUNT) {
+        text[0] += _targetText(index);
+    }
+
+    return text[0];
+}
+
+function
+benchStringBuilder (
+    )
+
+/*++
+
+Routine Description:
+
+    This routine builds the file with a string builder.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns the generated text.
+
+--*/
+
+{
+
+    var builder = StringBuilder();
+    var index;
+
+    for (index in 0..TARGET_COUNT) {
+        builder.append(_targetText(index));
+    }
+
+    return builder.__str();
+}
+
+function
+benchJoinList (
+    )
+
+/*++
+
+Routine Description:
+
+    This routine builds the file by collecting pieces in a list and joining
+    them at the end.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns the generated text.
+
+--*/
+
+{
+
+    var index;
+    var pieces = [];
+
+    for (index in 0..TARGET_COUNT) {
+        pieces.append(_targetText(index));
+    }
+
+    return "".joinList(pieces);
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+function
+_targetText (
+    index
+    )
+
+/*++
+
+Routine Description:
+
+    This routine creates the text for one build target, in the style of a
+    ninja build statement.
+
+Arguments:
+
+    index - Supplies the target number.
+
+Return Value:
+
+    Returns the text of the target.
+
+--*/
+
+{
+
+    var inputIndex;
+    var name = "apps/lib/module" + index.__str();
+    var text;
+
+    text = "build $OUT/" + name + ".o: cc $SRC/" + name + ".c";
+    for (inputIndex in 0..INPUT_COUNT) {
+        text += " | $SRC/include/header" + inputIndex.__str() + ".h";
+    }
+
+    text += "\n  cflags = $cflags -I$SRC/include -DMODULE=" +
+            index.__str() + "\n\n";
+
+    return text;
+}
+
+function
+_now (
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the current monotonic time.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns the current time in milliseconds.
+
+--*/
+
+{
+
+    var time = (_time.clock_gettime)(_time.CLOCK_MONOTONIC);
+
+    return (time[0] * 1000) + (time[1] / 1000000);
+}
+
+var benchmarks = [
+    ["+= on a local", benchLocalAppend],
+    ["+= on a list element", benchListAppend],
+    ["StringBuilder", benchStringBuilder],
+    ["joinList", benchJoinList]
+];
+
+var benchmark;
+var length;
+var start;
+
+for (benchmark in benchmarks) {
+    start = _now();
+    length = benchmark[1]().length();
+    Core.print("%-24s %d bytes in %d ms" %
+               [benchmark[0], length, _now() - start]);
+}
+
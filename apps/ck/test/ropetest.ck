@@ -0,0 +1,245 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    ropetest.ck
+
+Abstract:
+
+    This module tests string concatenation, which builds ropes that are
+    flattened lazily. Run it with chalk; it raises an exception on failure.
+
+Author:
+
+    agent 18-Oct-2026
+
+Environment:
+
+    Chalk
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+var PIECE = "0123456789";
+
+//
+// Define the number of appends done by the loops below. This builds a
+// string big enough that copying it on every append would take minutes.
+//
+
+var APPEND_COUNT = 60000;
+
+//
+// Define the number of large strings flattened by the old generation test.
+// Each one is bigger than the nursery.
+//
+
+var FLATTEN_COUNT = 300;
+var FLATTEN_SIZE = 60000;
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+function
+_check (
+    condition,
+    description
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+function
+testLocalAppend (
+    )
+
+/*++
+
+Routine Description:
+
+    This routine appends to a local variable in a loop.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    None. An exception is raised on failure.
+
+--*/
+
+{
+
+    var expected = PIECE * APPEND_COUNT;
+    var index;
+    var value = "";
+
+    for (index in 0..APPEND_COUNT) {
+        value += PIECE;
+    }
+
+    _check(value.length() == expected.length(), "local append length");
+    _check(value == expected, "local append contents");
+    return;
+}
+
+function
+testContainerAppend (
+    )
+
+/*++
+
+Routine Description:
+
+    This routine appends to list and dictionary elements in a loop. Storing
+    into a container must not flatten the string, or this loop takes
+    quadratic time.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    None. An exception is raised on failure.
+
+--*/
+
+{
+
+    var dict = {"key": ""};
+    var expected = PIECE * APPEND_COUNT;
+    var index;
+    var list = [""];
+
+    for (index in 0..APPEND_COUNT) {
+        list[0] += PIECE;
+        dict["key"] += PIECE;
+    }
+
+    _check(list[0].length() == expected.length(), "list append length");
+    _check(list[0] == expected, "list append contents");
+    _check(dict["key"] == expected, "dict append contents");
+
+    //
+    // Make sure C code that looks inside containers copes with ropes.
+    //
+
+    list = [PIECE * 100 + "a", "b"];
+    _check(list.contains(PIECE * 100 + "a"), "list contains rope");
+    _check("-".joinList(list).length() == 1003, "join rope");
+    dict = {};
+    dict[PIECE * 100 + "c"] = 1;
+    _check(dict.containsKey(PIECE * 100 + "c"), "rope dict key");
+    return;
+}
+
+function
+testOldFlatten (
+    )
+
+/*++
+
+Routine Description:
+
+    This routine flattens a series of large ropes, each of which promotes the
+    rope to the old generation while allocating its buffer. The buffers must
+    be accounted to the old generation so that major collections free them.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    None. An exception is raised on failure.
+
+--*/
+
+{
+
+    var base = PIECE * FLATTEN_SIZE;
+    var index;
+    var majorCollections;
+    var value;
+
+    majorCollections = Core.gcStatistics()["majorCollections"];
+    for (index in 0..FLATTEN_COUNT) {
+        value = base + PIECE;
+        _check(value.length() == base.length() + PIECE.length(),
+               "flattened length");
+    }
+
+    _check(Core.gcStatistics()["majorCollections"] > majorCollections,
+           "major collections while flattening");
+
+    return;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+function
+_check (
+    condition,
+    description
+    )
+
+/*++
+
+Routine Description:
+
+    This routine raises an exception if a test condition is not met.
+
+Arguments:
+
+    condition - Supplies the result of the test.
+
+    description - Supplies a description of what was tested.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    if (!condition) {
+        Core.raise(RuntimeError("Rope test failed: %s" % description));
+    }
+
+    return;
+}
+
+testLocalAppend();
+testContainerAppend();
+testOldFlatten();
+Core.print("All rope tests passed.");
+
@@ -0,0 +1,636 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    block.c
+
+Abstract:
+
+    This module implements support for LZMA block archives, which split the
+    input into independently compressed blocks followed by an index. Since
+    the blocks share no state, they can be compressed and decompressed in
+    parallel, and readers can seek to any block using the index.
+
+Author:
+
+    agent 18-Oct-2026
+
+Environment:
+
+    Any
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <string.h>
+
+#include <minoca/lib/types.h>
+#include <minoca/lib/lzma.h>
+#include "lzmap.h"
+
+//
+// --------------------------------------------------------------------- Macros
+//
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// Define the minimum size of the growable output buffer used when encoding a
+// block.
+//
+
+#define LZMA_BLOCK_MINIMUM_OUTPUT 0x1000
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+/*++
+
+Structure Description:
+
+    This structure stores the input cursor and growable output buffer used
+    while encoding a single block.
+
+Members:
+
+    Input - Stores a pointer to the remaining uncompressed input.
+
+    InputSize - Stores the number of bytes of input remaining.
+
+    Data - Stores a pointer to the output buffer.
+
+    Size - Stores the number of valid bytes in the output buffer.
+
+    Capacity - Stores the allocated size of the output buffer.
+
+--*/
+
+typedef struct _LZMA_BLOCK_STREAM {
+    PCUCHAR Input;
+    UINTN InputSize;
+    PUCHAR Data;
+    UINTN Size;
+    UINTN Capacity;
+} LZMA_BLOCK_STREAM, *PLZMA_BLOCK_STREAM;
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+INTN
+LzpLzmaBlockRead (
+    PLZ_CONTEXT Context,
+    PVOID Buffer,
+    UINTN Size
+    );
+
+INTN
+LzpLzmaBlockWrite (
+    PLZ_CONTEXT Context,
+    PVOID Buffer,
+    UINTN Size
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+VOID
+LzLzmaInitializeBlockHeader (
+    PLZMA_BLOCK_HEADER Header,
+    ULONG BlockSize
+    )
+
+/*++
+
+Routine Description:
+
+    This routine initializes a block archive header. It also initializes the
+    library's shared tables, so it must be called once before blocks are
+    encoded on multiple threads.
+
+Arguments:
+
+    Header - Supplies a pointer to the header to initialize.
+
+    BlockSize - Supplies the uncompressed size of each block.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    LzpCrcInitialize();
+    Header->Magic = LZMA_BLOCK_HEADER_MAGIC;
+    Header->Version = LZMA_BLOCK_VERSION;
+    Header->BlockSize = BlockSize;
+    Header->Flags = 0;
+    return;
+}
+
+LZ_STATUS
+LzLzmaValidateBlockHeader (
+    PLZMA_BLOCK_HEADER Header
+    )
+
+/*++
+
+Routine Description:
+
+    This routine validates a block archive header.
+
+Arguments:
+
+    Header - Supplies a pointer to the header read from the archive.
+
+Return Value:
+
+    LzSuccess if the header is valid.
+
+    LzErrorMagic if this is not a block archive.
+
+    LzErrorUnsupported if the version or flags are not understood.
+
+--*/
+
+{
+
+    if (Header->Magic != LZMA_BLOCK_HEADER_MAGIC) {
+        return LzErrorMagic;
+    }
+
+    if ((Header->Version != LZMA_BLOCK_VERSION) || (Header->Flags != 0)) {
+        return LzErrorUnsupported;
+    }
+
+    if ((Header->BlockSize < LZMA_MINIMUM_BLOCK_SIZE) ||
+        (Header->BlockSize > LZMA_MAXIMUM_BLOCK_SIZE)) {
+
+        return LzErrorCorruptData;
+    }
+
+    return LzSuccess;
+}
+
+LZ_STATUS
+LzLzmaEncodeBlock (
+    PLZ_REALLOCATE Reallocate,
+    PLZMA_ENCODER_PROPERTIES Properties,
+    PCVOID Input,
+    UINTN InputSize,
+    PVOID *Output,
+    PUINTN OutputSize,
+    PULONG UncompressedCrc32
+    )
+
+/*++
+
+Routine Description:
+
+    This routine compresses a single block of a block archive as a complete,
+    independent LZMA stream. This routine shares no state with other calls, so
+    multiple blocks can be encoded simultaneously on different threads as long
+    as the reallocate routine is thread safe.
+
+Arguments:
+
+    Reallocate - Supplies a pointer to the function used to allocate and free
+        memory.
+
+    Properties - Supplies an optional pointer to the encoder properties. If
+        NULL, default properties are used.
+
+    Input - Supplies a pointer to the uncompressed block data.
+
+    InputSize - Supplies the size of the uncompressed data in bytes.
+
+    Output - Supplies a pointer where a pointer to the compressed block will
+        be returned on success. The caller is responsible for freeing this
+        buffer with the reallocate routine.
+
+    OutputSize - Supplies a pointer where the size of the compressed block will
+        be returned on success.
+
+    UncompressedCrc32 - Supplies a pointer where the CRC32 of the input data
+        will be returned on success.
+
+Return Value:
+
+    LZ Status code.
+
+--*/
+
+{
+
+    LZMA_ENCODER_PROPERTIES BlockProperties;
+    LZ_CONTEXT Lz;
+    LZ_STATUS Status;
+    LZMA_BLOCK_STREAM Stream;
+
+    *Output = NULL;
+    *OutputSize = 0;
+    if (InputSize == 0) {
+        return LzErrorInvalidParameter;
+    }
+
+    Stream.Input = Input;
+    Stream.InputSize = InputSize;
+    Stream.Data = NULL;
+    Stream.Size = 0;
+    Stream.Capacity = 0;
+    memset(&Lz, 0, sizeof(LZ_CONTEXT));
+    Lz.Context = &Stream;
+    Lz.Reallocate = Reallocate;
+    Lz.Read = LzpLzmaBlockRead;
+    Lz.Write = LzpLzmaBlockWrite;
+    if (Properties != NULL) {
+        memcpy(&BlockProperties, Properties, sizeof(LZMA_ENCODER_PROPERTIES));
+
+    } else {
+        LzLzmaInitializeProperties(&BlockProperties);
+    }
+
+    //
+    // Let the encoder shrink its dictionary to fit the block, since no match
+    // can reach outside of it anyway.
+    //
+
+    BlockProperties.ReduceSize = InputSize;
+    Status = LzLzmaInitializeEncoder(&Lz, &BlockProperties, TRUE);
+    if (Status != LzSuccess) {
+        goto EncodeBlockEnd;
+    }
+
+    Status = LzLzmaEncode(&Lz, LzFlushNow);
+    if ((Status == LzSuccess) || (Status == LzStreamComplete)) {
+        Status = LzLzmaFinishEncode(&Lz);
+
+    } else {
+        LzLzmaFinishEncode(&Lz);
+    }
+
+    if (Status != LzStreamComplete) {
+        goto EncodeBlockEnd;
+    }
+
+    if (Lz.UncompressedSize != InputSize) {
+        Status = LzErrorProgress;
+        goto EncodeBlockEnd;
+    }
+
+    *Output = Stream.Data;
+    *OutputSize = Stream.Size;
+    *UncompressedCrc32 = Lz.UncompressedCrc32;
+    Stream.Data = NULL;
+    Status = LzSuccess;
+
+EncodeBlockEnd:
+    if (Stream.Data != NULL) {
+        Reallocate(Stream.Data, 0);
+    }
+
+    return Status;
+}
+
+LZ_STATUS
+LzLzmaDecodeBlock (
+    PLZ_REALLOCATE Reallocate,
+    PCVOID Input,
+    UINTN InputSize,
+    PVOID Output,
+    UINTN OutputSize,
+    ULONG UncompressedCrc32
+    )
+
+/*++
+
+Routine Description:
+
+    This routine decompresses a single block of a block archive. Like encoding,
+    blocks can be decoded simultaneously on different threads.
+
+Arguments:
+
+    Reallocate - Supplies a pointer to the function used to allocate and free
+        memory.
+
+    Input - Supplies a pointer to the compressed block.
+
+    InputSize - Supplies the size of the compressed block in bytes.
+
+    Output - Supplies a pointer where the uncompressed data will be returned.
+
+    OutputSize - Supplies the exact uncompressed size of the block, as
+        recorded in the index.
+
+    UncompressedCrc32 - Supplies the expected CRC32 of the uncompressed data,
+        as recorded in the index.
+
+Return Value:
+
+    LZ Status code.
+
+--*/
+
+{
+
+    LZ_CONTEXT Lz;
+    LZ_STATUS Status;
+
+    memset(&Lz, 0, sizeof(LZ_CONTEXT));
+    Lz.Reallocate = Reallocate;
+    Lz.Input = Input;
+    Lz.InputSize = InputSize;
+    Lz.Output = Output;
+    Lz.OutputSize = OutputSize;
+    Status = LzLzmaInitializeDecoder(&Lz, NULL, TRUE);
+    if (Status != LzSuccess) {
+        return Status;
+    }
+
+    //
+    // With neither read nor write routines and the flush flag set, the
+    // decoder decompresses straight into the output buffer in one shot.
+    //
+
+    Status = LzLzmaDecode(&Lz, LzFlushNow);
+    LzLzmaFinishDecode(&Lz);
+    if (Status != LzStreamComplete) {
+        if (Status == LzSuccess) {
+            Status = LzErrorInputEof;
+        }
+
+        return Status;
+    }
+
+    if ((Lz.UncompressedSize != OutputSize) || (Lz.InputSize != 0)) {
+        return LzErrorCorruptData;
+    }
+
+    if (Lz.UncompressedCrc32 != UncompressedCrc32) {
+        return LzErrorCrc;
+    }
+
+    return LzSuccess;
+}
+
+VOID
+LzLzmaInitializeBlockTrailer (
+    PLZMA_BLOCK_TRAILER Trailer,
+    PLZMA_BLOCK_INDEX_ENTRY Index,
+    ULONG BlockCount,
+    ULONGLONG IndexOffset
+    )
+
+/*++
+
+Routine Description:
+
+    This routine initializes the trailer for a completed block archive.
+
+Arguments:
+
+    Trailer - Supplies a pointer to the trailer to initialize.
+
+    Index - Supplies a pointer to the array of index entries that will be
+        written to the archive.
+
+    BlockCount - Supplies the number of entries in the index.
+
+    IndexOffset - Supplies the offset in bytes where the index is written.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    LzpCrcInitialize();
+    Trailer->IndexOffset = IndexOffset;
+    Trailer->BlockCount = BlockCount;
+    Trailer->IndexCrc32 = LzpComputeCrc32(
+                                0,
+                                Index,
+                                BlockCount * sizeof(LZMA_BLOCK_INDEX_ENTRY));
+
+    Trailer->Reserved = 0;
+    Trailer->Magic = LZMA_BLOCK_TRAILER_MAGIC;
+    return;
+}
+
+LZ_STATUS
+LzLzmaValidateBlockIndex (
+    PLZMA_BLOCK_HEADER Header,
+    PLZMA_BLOCK_TRAILER Trailer,
+    PLZMA_BLOCK_INDEX_ENTRY Index
+    )
+
+/*++
+
+Routine Description:
+
+    This routine validates the index of a block archive against its header and
+    trailer. It ensures the blocks are contiguous, lie between the header and
+    the index, and have the sizes promised by the header.
+
+Arguments:
+
+    Header - Supplies a pointer to the validated archive header.
+
+    Trailer - Supplies a pointer to the archive trailer.
+
+    Index - Supplies a pointer to the index entries, the number of which is
+        specified in the trailer.
+
+Return Value:
+
+    LzSuccess if the index is valid.
+
+    LzErrorMagic if the trailer magic is wrong.
+
+    LzErrorCrc if the index does not match its checksum.
+
+    LzErrorCorruptData if the index entries are inconsistent.
+
+--*/
+
+{
+
+    ULONG BlockIndex;
+    ULONG Crc;
+    PLZMA_BLOCK_INDEX_ENTRY Entry;
+    ULONGLONG Offset;
+
+    if (Trailer->Magic != LZMA_BLOCK_TRAILER_MAGIC) {
+        return LzErrorMagic;
+    }
+
+    LzpCrcInitialize();
+    Crc = LzpComputeCrc32(0,
+                          Index,
+                          Trailer->BlockCount * sizeof(LZMA_BLOCK_INDEX_ENTRY));
+
+    if (Crc != Trailer->IndexCrc32) {
+        return LzErrorCrc;
+    }
+
+    Offset = sizeof(LZMA_BLOCK_HEADER);
+    for (BlockIndex = 0; BlockIndex < Trailer->BlockCount; BlockIndex += 1) {
+        Entry = &(Index[BlockIndex]);
+        if ((Entry->Offset != Offset) || (Entry->Reserved != 0) ||
+            (Entry->CompressedSize < LZMA_HEADER_SIZE + LZMA_FOOTER_SIZE) ||
+            (Entry->UncompressedSize == 0) ||
+            (Entry->UncompressedSize > Header->BlockSize)) {
+
+            return LzErrorCorruptData;
+        }
+
+        //
+        // Only the last block is allowed to come up short.
+        //
+
+        if ((BlockIndex + 1 != Trailer->BlockCount) &&
+            (Entry->UncompressedSize != Header->BlockSize)) {
+
+            return LzErrorCorruptData;
+        }
+
+        Offset += Entry->CompressedSize;
+    }
+
+    if (Offset != Trailer->IndexOffset) {
+        return LzErrorCorruptData;
+    }
+
+    return LzSuccess;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+INTN
+LzpLzmaBlockRead (
+    PLZ_CONTEXT Context,
+    PVOID Buffer,
+    UINTN Size
+    )
+
+/*++
+
+Routine Description:
+
+    This routine feeds the encoder from the block's input buffer.
+
+Arguments:
+
+    Context - Supplies a pointer to the LZ context.
+
+    Buffer - Supplies a pointer where the input data should be returned.
+
+    Size - Supplies the maximum number of bytes to return.
+
+Return Value:
+
+    Returns the number of bytes read, or 0 at the end of the block.
+
+--*/
+
+{
+
+    PLZMA_BLOCK_STREAM Stream;
+
+    Stream = Context->Context;
+    if (Size > Stream->InputSize) {
+        Size = Stream->InputSize;
+    }
+
+    memcpy(Buffer, Stream->Input, Size);
+    Stream->Input += Size;
+    Stream->InputSize -= Size;
+    return Size;
+}
+
+INTN
+LzpLzmaBlockWrite (
+    PLZ_CONTEXT Context,
+    PVOID Buffer,
+    UINTN Size
+    )
+
+/*++
+
+Routine Description:
+
+    This routine appends encoder output to the growable block buffer.
+
+Arguments:
+
+    Context - Supplies a pointer to the LZ context.
+
+    Buffer - Supplies a pointer to the data to write.
+
+    Size - Supplies the number of bytes to write.
+
+Return Value:
+
+    Returns the number of bytes written, which is always the full size on
+    success.
+
+    -1 on allocation failure.
+
+--*/
+
+{
+
+    UINTN NewCapacity;
+    PVOID NewData;
+    PLZMA_BLOCK_STREAM Stream;
+
+    Stream = Context->Context;
+    if (Stream->Size + Size > Stream->Capacity) {
+        NewCapacity = Stream->Capacity * 2;
+        if (NewCapacity < LZMA_BLOCK_MINIMUM_OUTPUT) {
+            NewCapacity = LZMA_BLOCK_MINIMUM_OUTPUT;
+        }
+
+        while (NewCapacity < Stream->Size + Size) {
+            NewCapacity *= 2;
+        }
+
+        NewData = Context->Reallocate(Stream->Data, NewCapacity);
+        if (NewData == NULL) {
+            return -1;
+        }
+
+        Stream->Data = NewData;
+        Stream->Capacity = NewCapacity;
+    }
+
+    memcpy(Stream->Data + Stream->Size, Buffer, Size);
+    Stream->Size += Size;
+    return Size;
+}
+
@@ -34,6 +34,7 @@ function build() {
     var sources;
 
     sources = [
+        "block.c",
         "crc32.c",
         "encopt.c",
         "lzfind.c",
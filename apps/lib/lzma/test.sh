@@ -47,9 +47,15 @@ for f in $files; do
         cmp $f.lz$l $f.lzm$l
         cmp $f.lzm$l.txt $f.lz$l.txt
 
+        # Compress into a block archive on several threads, and round trip it.
+        lzma -clv -$l -T 4 -i $f -o $f.blz$l 2>$f.blz$l.txt
+        lzma -dlv -i $f.blz$l -o $f.bout$l 2>$f.b$l.txt
+        cmp $f.bout$l $f
+
         # Clean up.
         rm $f.lz$l $f.lzm$l $f.out$l $f.lzm$l.txt
         rm $f.lz$l.txt $f.$l.txt
+        rm $f.blz$l $f.bout$l $f.blz$l.txt $f.b$l.txt
     done
 done
 
@@ -36,6 +36,7 @@ Module Name:
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/time.h>
 #include <unistd.h>
 
 #include <minoca/lib/types.h>
@@ -57,6 +58,19 @@ Module Name:
 
 #endif
 
+//
+// Block archives are compressed and decompressed on multiple threads where
+// pthreads are available, and serially otherwise.
+//
+
+#if !defined(_WIN32)
+
+#include <pthread.h>
+
+#define LZMA_UTIL_THREADS 1
+
+#endif
+
 //
 // ---------------------------------------------------------------- Definitions
 //
@@ -84,16 +98,35 @@ Module Name:
     "  --pb=<count> - Set number of position bits [0, 4] (default 2).\n" \
     "  --mf=<type> - Set match finder [hc4, bt2, bt3, bt4] (default bt4).\n" \
     "  --no-eos - Do not write end of stream marker.\n" \
+    "  -T, --threads=<count> - Compress into a block archive using the \n" \
+    "      given number of threads (0 for one per processor). Block \n" \
+    "      archives are decompressed in parallel automatically, but must \n" \
+    "      be read from a seekable file.\n" \
+    "  --block-size=<size> - Compress into a block archive with the given \n" \
+    "      block size [16, 30] (default 22).\n" \
+    "  --benchmark - Compress and decompress the input in memory as a block\n"\
+    "      archive using 1, 2, 4, etc. up to the thread count threads, and \n"\
+    "      report the throughput of each.\n" \
     "  --help - Display this help message.\n" \
     "  --version -- Display the version information and exit.\n"
 
-#define LZMA_OPTIONS_STRING "cdi:lo:0123456789hvV"
+#define LZMA_OPTIONS_STRING "cdi:lo:0123456789T:hvV"
 
 #define LZMA_UTIL_VERSION_MAJOR 1
 #define LZMA_UTIL_VERSION_MINOR 0
 
 #define LZMA_UTIL_OPTION_VERBOSE 0x00000001
 #define LZMA_UTIL_OPTION_LIST 0x00000002
+#define LZMA_UTIL_OPTION_BLOCKS 0x00000004
+#define LZMA_UTIL_OPTION_BENCHMARK 0x00000008
+
+#define LZMA_UTIL_MAX_THREADS 64
+
+//
+// Define the log2 of the default block size.
+//
+
+#define LZMA_UTIL_DEFAULT_BLOCK_SHIFT 22
 
 //
 // ------------------------------------------------------ Data Type Definitions
@@ -111,7 +144,9 @@ typedef enum _LZMA_UTIL_ARGUMENT {
     LzmaUtilLp,
     LzmaUtilPb,
     LzmaUtilMf,
-    LzmaUtilNoEos
+    LzmaUtilNoEos,
+    LzmaUtilBlockSize,
+    LzmaUtilBenchmark
 } LZMA_UTIL_ARGUMENT, *PLZMA_UTIL_ARGUMENT;
 
 typedef enum _LZMA_UTIL_ACTION {
@@ -125,8 +160,34 @@ typedef struct _LZMA_UTIL {
     LZMA_ENCODER_PROPERTIES EncoderProperties;
     ULONG Options;
     UINTN MemoryTest;
+    ULONG ThreadCount;
+    ULONG BlockSize;
 } LZMA_UTIL, *PLZMA_UTIL;
 
+typedef struct _LZMA_UTIL_BLOCK {
+    PVOID Input;
+    UINTN InputSize;
+    PVOID Output;
+    UINTN OutputSize;
+    ULONG Crc32;
+    LZ_STATUS Status;
+} LZMA_UTIL_BLOCK, *PLZMA_UTIL_BLOCK;
+
+typedef struct _LZMA_UTIL_BATCH {
+    PLZMA_UTIL Context;
+    LZMA_UTIL_ACTION Action;
+    PLZMA_UTIL_BLOCK Blocks;
+    ULONG BlockCount;
+    ULONG NextBlock;
+
+#ifdef LZMA_UTIL_THREADS
+
+    pthread_mutex_t Lock;
+
+#endif
+
+} LZMA_UTIL_BATCH, *PLZMA_UTIL_BATCH;
+
 //
 // ----------------------------------------------- Internal Function Prototypes
 //
@@ -145,6 +206,51 @@ LzpUtilRunMemoryTest (
     LZMA_UTIL_ACTION Action
     );
 
+INT
+LzpUtilCompressBlocks (
+    PLZMA_UTIL Context
+    );
+
+INT
+LzpUtilDecompressBlocks (
+    PLZMA_UTIL Context
+    );
+
+BOOL
+LzpUtilIsBlockArchive (
+    FILE *File
+    );
+
+LZ_STATUS
+LzpUtilProcessBatch (
+    PLZMA_UTIL Context,
+    LZMA_UTIL_ACTION Action,
+    PLZMA_UTIL_BLOCK Blocks,
+    ULONG BlockCount,
+    ULONG ThreadCount
+    );
+
+PVOID
+LzpUtilBatchWorker (
+    PVOID Parameter
+    );
+
+INT
+LzpUtilRunBenchmark (
+    PLZMA_UTIL Context,
+    PCSTR InputPath
+    );
+
+ULONG
+LzpUtilGetProcessorCount (
+    VOID
+    );
+
+ULONGLONG
+LzpUtilGetMicroseconds (
+    VOID
+    );
+
 PVOID
 LzpUtilReallocate (
     PVOID Allocation,
@@ -198,6 +304,9 @@ struct option LzmaLongOptions[] = {
     {"pb", required_argument, 0, LzmaUtilPb},
     {"mf", required_argument, 0, LzmaUtilMf},
     {"no-eos", no_argument, 0, LzmaUtilNoEos},
+    {"threads", required_argument, 0, 'T'},
+    {"block-size", required_argument, 0, LzmaUtilBlockSize},
+    {"benchmark", no_argument, 0, LzmaUtilBenchmark},
     {"help", no_argument, 0, 'h'},
     {"version", no_argument, 0, 'V'},
     {"verbose", no_argument, 0, 'v'},
@@ -272,6 +381,7 @@ Return Value:
     Context.Lz.Write = LzpUtilWrite;
     LzLzmaInitializeProperties(&(Context.EncoderProperties));
     Context.EncoderProperties.EndMark = TRUE;
+    Context.BlockSize = 1 << LZMA_UTIL_DEFAULT_BLOCK_SHIFT;
     Status = 1;
     TotalStatus = 0;
 
@@ -444,6 +554,33 @@ Return Value:
             Context.EncoderProperties.EndMark = FALSE;
             break;
 
+        case 'T':
+            Integer = LzpUtilGetNumericOption(optarg,
+                                              0,
+                                              LZMA_UTIL_MAX_THREADS);
+
+            if (Integer < 0) {
+                goto MainEnd;
+            }
+
+            Context.ThreadCount = Integer;
+            Context.Options |= LZMA_UTIL_OPTION_BLOCKS;
+            break;
+
+        case LzmaUtilBlockSize:
+            Integer = LzpUtilGetNumericOption(optarg, 16, 30);
+            if (Integer < 0) {
+                goto MainEnd;
+            }
+
+            Context.BlockSize = 1 << Integer;
+            Context.Options |= LZMA_UTIL_OPTION_BLOCKS;
+            break;
+
+        case LzmaUtilBenchmark:
+            Context.Options |= LZMA_UTIL_OPTION_BENCHMARK;
+            break;
+
         case 'v':
             Context.Options |= LZMA_UTIL_OPTION_VERBOSE;
             break;
@@ -467,6 +604,28 @@ Return Value:
         }
     }
 
+    if (Context.ThreadCount == 0) {
+        Context.ThreadCount = LzpUtilGetProcessorCount();
+    }
+
+    //
+    // The benchmark runs entirely in memory on a single input file.
+    //
+
+    if ((Context.Options & LZMA_UTIL_OPTION_BENCHMARK) != 0) {
+        if ((InputPath == NULL) && (optind < ArgumentCount)) {
+            InputPath = Arguments[optind];
+        }
+
+        if (InputPath == NULL) {
+            fprintf(stderr, "Error: The benchmark requires an input file.\n");
+            goto MainEnd;
+        }
+
+        Status = LzpUtilRunBenchmark(&Context, InputPath);
+        goto MainEnd;
+    }
+
     if (Action == LzmaActionUnspecified) {
         fprintf(stderr,
                 "Error: Specify either -c or -d. Try --help for usage\n");
@@ -602,6 +761,7 @@ Return Value:
 {
 
     PCSTR BaseName;
+    BOOL BlockArchive;
     size_t InLength;
     PSTR LastDot;
     PLZ_CONTEXT Lz;
@@ -730,7 +890,33 @@ Return Value:
         goto ProcessStreamEnd;
     }
 
+    //
+    // Block archives are written when asked for, and detected on input.
+    //
+
     if (Action == LzmaActionCompress) {
+        BlockArchive = FALSE;
+        if ((Context->Options & LZMA_UTIL_OPTION_BLOCKS) != 0) {
+            BlockArchive = TRUE;
+        }
+
+    } else {
+        BlockArchive = LzpUtilIsBlockArchive(Lz->ReadContext);
+    }
+
+    if (BlockArchive != FALSE) {
+        if (Action == LzmaActionCompress) {
+            Status = LzpUtilCompressBlocks(Context);
+
+        } else {
+            Status = LzpUtilDecompressBlocks(Context);
+        }
+
+        if (Status != 0) {
+            goto ProcessStreamEnd;
+        }
+
+    } else if (Action == LzmaActionCompress) {
         LzStatus = LzLzmaInitializeEncoder(Lz,
                                            &(Context->EncoderProperties),
                                            TRUE);
@@ -1024,6 +1210,955 @@ Return Value:
     return Status;
 }
 
+INT
+LzpUtilCompressBlocks (
+    PLZMA_UTIL Context
+    )
+
+/*++
+
+Routine Description:
+
+    This routine compresses the input stream into a block archive, compressing
+    several blocks at once on multiple threads.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+Return Value:
+
+    0 on success.
+
+    Non-zero on failure.
+
+--*/
+
+{
+
+    ULONG BatchSize;
+    PLZMA_UTIL_BLOCK Block;
+    ULONG BlockCount;
+    PLZMA_UTIL_BLOCK Blocks;
+    ULONG Count;
+    PLZMA_BLOCK_INDEX_ENTRY Entry;
+    BOOL Finished;
+    LZMA_BLOCK_HEADER Header;
+    FILE *In;
+    PLZMA_BLOCK_INDEX_ENTRY Index;
+    ULONG IndexCapacity;
+    ULONG IndexIndex;
+    PLZ_CONTEXT Lz;
+    LZ_STATUS LzStatus;
+    PVOID NewIndex;
+    ULONGLONG Offset;
+    FILE *Out;
+    UINTN Size;
+    INT Status;
+    LZMA_BLOCK_TRAILER Trailer;
+
+    Lz = &(Context->Lz);
+    In = Lz->ReadContext;
+    Out = Lz->WriteContext;
+    BlockCount = 0;
+    Index = NULL;
+    IndexCapacity = 0;
+    Status = 1;
+
+    //
+    // Read twice as many blocks as there are threads at a time so that a few
+    // slow blocks don't leave the other threads idle.
+    //
+
+    BatchSize = Context->ThreadCount * 2;
+    Blocks = calloc(BatchSize, sizeof(LZMA_UTIL_BLOCK));
+    if (Blocks == NULL) {
+        goto CompressBlocksEnd;
+    }
+
+    for (Count = 0; Count < BatchSize; Count += 1) {
+        Blocks[Count].Input = malloc(Context->BlockSize);
+        if (Blocks[Count].Input == NULL) {
+            fprintf(stderr, "Error: Allocation failure.\n");
+            goto CompressBlocksEnd;
+        }
+    }
+
+    Lz->CompressedCrc32 = 0;
+    Lz->UncompressedCrc32 = 0;
+    Lz->UncompressedSize = 0;
+    LzLzmaInitializeBlockHeader(&Header, Context->BlockSize);
+    if (fwrite(&Header, 1, sizeof(Header), Out) != sizeof(Header)) {
+        fprintf(stderr, "lzma: Write Error: %s\n", strerror(errno));
+        goto CompressBlocksEnd;
+    }
+
+    Offset = sizeof(Header);
+    Finished = FALSE;
+    while (Finished == FALSE) {
+
+        //
+        // Read in the next batch of blocks.
+        //
+
+        for (Count = 0; Count < BatchSize; Count += 1) {
+            Block = &(Blocks[Count]);
+            Size = fread(Block->Input, 1, Context->BlockSize, In);
+            if (Size < Context->BlockSize) {
+                if (ferror(In)) {
+                    fprintf(stderr, "lzma: Read Error: %s\n", strerror(errno));
+                    goto CompressBlocksEnd;
+                }
+
+                Finished = TRUE;
+            }
+
+            if (Size == 0) {
+                break;
+            }
+
+            Block->InputSize = Size;
+            if (Finished != FALSE) {
+                Count += 1;
+                break;
+            }
+        }
+
+        if (Count == 0) {
+            break;
+        }
+
+        LzStatus = LzpUtilProcessBatch(Context,
+                                       LzmaActionCompress,
+                                       Blocks,
+                                       Count,
+                                       Context->ThreadCount);
+
+        if (LzStatus != LzSuccess) {
+            fprintf(stderr,
+                    "Error: Failed to encode: %s.\n",
+                    LzpUtilGetErrorString(LzStatus));
+
+            goto CompressBlocksEnd;
+        }
+
+        if (BlockCount + Count > IndexCapacity) {
+            IndexCapacity = (BlockCount + Count) * 2;
+            NewIndex = realloc(Index,
+                               IndexCapacity * sizeof(LZMA_BLOCK_INDEX_ENTRY));
+
+            if (NewIndex == NULL) {
+                fprintf(stderr, "Error: Allocation failure.\n");
+                goto CompressBlocksEnd;
+            }
+
+            Index = NewIndex;
+        }
+
+        //
+        // Write the compressed blocks out in order.
+        //
+
+        for (IndexIndex = 0; IndexIndex < Count; IndexIndex += 1) {
+            Block = &(Blocks[IndexIndex]);
+            if (fwrite(Block->Output, 1, Block->OutputSize, Out) !=
+                Block->OutputSize) {
+
+                fprintf(stderr, "lzma: Write Error: %s\n", strerror(errno));
+                goto CompressBlocksEnd;
+            }
+
+            Entry = &(Index[BlockCount]);
+            Entry->Offset = Offset;
+            Entry->CompressedSize = Block->OutputSize;
+            Entry->UncompressedSize = Block->InputSize;
+            Entry->UncompressedCrc32 = Block->Crc32;
+            Entry->Reserved = 0;
+            BlockCount += 1;
+            Offset += Block->OutputSize;
+            Lz->UncompressedSize += Block->InputSize;
+            free(Block->Output);
+            Block->Output = NULL;
+        }
+    }
+
+    //
+    // Finish with the index and the trailer that points at it.
+    //
+
+    LzLzmaInitializeBlockTrailer(&Trailer, Index, BlockCount, Offset);
+    Size = BlockCount * sizeof(LZMA_BLOCK_INDEX_ENTRY);
+    if ((fwrite(Index, 1, Size, Out) != Size) ||
+        (fwrite(&Trailer, 1, sizeof(Trailer), Out) != sizeof(Trailer))) {
+
+        fprintf(stderr, "lzma: Write Error: %s\n", strerror(errno));
+        goto CompressBlocksEnd;
+    }
+
+    Lz->CompressedSize = Offset + Size + sizeof(Trailer);
+    Status = 0;
+
+CompressBlocksEnd:
+    if (Blocks != NULL) {
+        for (Count = 0; Count < BatchSize; Count += 1) {
+            if (Blocks[Count].Input != NULL) {
+                free(Blocks[Count].Input);
+            }
+
+            if (Blocks[Count].Output != NULL) {
+                free(Blocks[Count].Output);
+            }
+        }
+
+        free(Blocks);
+    }
+
+    if (Index != NULL) {
+        free(Index);
+    }
+
+    return Status;
+}
+
+INT
+LzpUtilDecompressBlocks (
+    PLZMA_UTIL Context
+    )
+
+/*++
+
+Routine Description:
+
+    This routine decompresses a block archive, decompressing several blocks at
+    once on multiple threads. The input must be seekable, since the index is
+    at the end.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+Return Value:
+
+    0 on success.
+
+    Non-zero on failure.
+
+--*/
+
+{
+
+    ULONG BatchSize;
+    PLZMA_UTIL_BLOCK Block;
+    ULONG BlockIndex;
+    PLZMA_UTIL_BLOCK Blocks;
+    ULONG Count;
+    PLZMA_BLOCK_INDEX_ENTRY Entry;
+    off_t FileSize;
+    LZMA_BLOCK_HEADER Header;
+    FILE *In;
+    PLZMA_BLOCK_INDEX_ENTRY Index;
+    ULONG IndexIndex;
+    ULONGLONG IndexSize;
+    PLZ_CONTEXT Lz;
+    LZ_STATUS LzStatus;
+    PVOID NewBuffer;
+    FILE *Out;
+    INT Status;
+    LZMA_BLOCK_TRAILER Trailer;
+
+    Lz = &(Context->Lz);
+    In = Lz->ReadContext;
+    Out = Lz->WriteContext;
+    Blocks = NULL;
+    Index = NULL;
+    LzStatus = LzErrorRead;
+    Status = 1;
+
+    //
+    // Read and validate the header, trailer, and index.
+    //
+
+    if ((fseeko(In, 0, SEEK_SET) != 0) ||
+        (fread(&Header, 1, sizeof(Header), In) != sizeof(Header)) ||
+        (fseeko(In, -(off_t)sizeof(Trailer), SEEK_END) != 0) ||
+        (fread(&Trailer, 1, sizeof(Trailer), In) != sizeof(Trailer))) {
+
+        goto DecompressBlocksEnd;
+    }
+
+    FileSize = ftello(In);
+    LzStatus = LzLzmaValidateBlockHeader(&Header);
+    if (LzStatus != LzSuccess) {
+        goto DecompressBlocksEnd;
+    }
+
+    LzStatus = LzErrorCorruptData;
+    IndexSize = (ULONGLONG)(Trailer.BlockCount) *
+                sizeof(LZMA_BLOCK_INDEX_ENTRY);
+
+    if ((Trailer.IndexOffset < sizeof(Header)) ||
+        (Trailer.IndexOffset + IndexSize + sizeof(Trailer) != FileSize)) {
+
+        goto DecompressBlocksEnd;
+    }
+
+    Index = malloc(IndexSize + 1);
+    if (Index == NULL) {
+        LzStatus = LzErrorMemory;
+        goto DecompressBlocksEnd;
+    }
+
+    LzStatus = LzErrorRead;
+    if ((fseeko(In, Trailer.IndexOffset, SEEK_SET) != 0) ||
+        (fread(Index, 1, IndexSize, In) != IndexSize) ||
+        (fseeko(In, sizeof(Header), SEEK_SET) != 0)) {
+
+        goto DecompressBlocksEnd;
+    }
+
+    LzStatus = LzLzmaValidateBlockIndex(&Header, &Trailer, Index);
+    if (LzStatus != LzSuccess) {
+        goto DecompressBlocksEnd;
+    }
+
+    BatchSize = Context->ThreadCount * 2;
+    Blocks = calloc(BatchSize, sizeof(LZMA_UTIL_BLOCK));
+    if (Blocks == NULL) {
+        LzStatus = LzErrorMemory;
+        goto DecompressBlocksEnd;
+    }
+
+    //
+    // The blocks are contiguous, so read them in batches straight through.
+    //
+
+    Lz->CompressedCrc32 = 0;
+    Lz->UncompressedCrc32 = 0;
+    Lz->UncompressedSize = 0;
+    for (BlockIndex = 0;
+         BlockIndex < Trailer.BlockCount;
+         BlockIndex += Count) {
+
+        Count = Trailer.BlockCount - BlockIndex;
+        if (Count > BatchSize) {
+            Count = BatchSize;
+        }
+
+        for (IndexIndex = 0; IndexIndex < Count; IndexIndex += 1) {
+            Block = &(Blocks[IndexIndex]);
+            Entry = &(Index[BlockIndex + IndexIndex]);
+            Block->InputSize = Entry->CompressedSize;
+            Block->OutputSize = Entry->UncompressedSize;
+            Block->Crc32 = Entry->UncompressedCrc32;
+            NewBuffer = realloc(Block->Input, Block->InputSize);
+            if (NewBuffer == NULL) {
+                LzStatus = LzErrorMemory;
+                goto DecompressBlocksEnd;
+            }
+
+            Block->Input = NewBuffer;
+            NewBuffer = realloc(Block->Output, Block->OutputSize);
+            if (NewBuffer == NULL) {
+                LzStatus = LzErrorMemory;
+                goto DecompressBlocksEnd;
+            }
+
+            Block->Output = NewBuffer;
+            if (fread(Block->Input, 1, Block->InputSize, In) !=
+                Block->InputSize) {
+
+                LzStatus = LzErrorRead;
+                goto DecompressBlocksEnd;
+            }
+        }
+
+        LzStatus = LzpUtilProcessBatch(Context,
+                                       LzmaActionDecompress,
+                                       Blocks,
+                                       Count,
+                                       Context->ThreadCount);
+
+        if (LzStatus != LzSuccess) {
+            goto DecompressBlocksEnd;
+        }
+
+        LzStatus = LzErrorWrite;
+        for (IndexIndex = 0; IndexIndex < Count; IndexIndex += 1) {
+            Block = &(Blocks[IndexIndex]);
+            if (fwrite(Block->Output, 1, Block->OutputSize, Out) !=
+                Block->OutputSize) {
+
+                goto DecompressBlocksEnd;
+            }
+
+            Lz->UncompressedSize += Block->OutputSize;
+        }
+    }
+
+    Lz->CompressedSize = FileSize;
+    LzStatus = LzSuccess;
+    Status = 0;
+
+DecompressBlocksEnd:
+    if (LzStatus != LzSuccess) {
+        fprintf(stderr,
+                "Error: Failed to decode: %s.\n",
+                LzpUtilGetErrorString(LzStatus));
+    }
+
+    if (Blocks != NULL) {
+        for (Count = 0; Count < BatchSize; Count += 1) {
+            if (Blocks[Count].Input != NULL) {
+                free(Blocks[Count].Input);
+            }
+
+            if (Blocks[Count].Output != NULL) {
+                free(Blocks[Count].Output);
+            }
+        }
+
+        free(Blocks);
+    }
+
+    if (Index != NULL) {
+        free(Index);
+    }
+
+    return Status;
+}
+
+BOOL
+LzpUtilIsBlockArchive (
+    FILE *File
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines whether the given input stream is a block archive.
+    Streams that cannot be seeked are never treated as block archives.
+
+Arguments:
+
+    File - Supplies the input stream, which is left at its original position.
+
+Return Value:
+
+    TRUE if the input is a seekable block archive.
+
+    FALSE otherwise.
+
+--*/
+
+{
+
+    ULONG Magic;
+    off_t Position;
+    size_t Size;
+
+    Position = ftello(File);
+    if (Position < 0) {
+        return FALSE;
+    }
+
+    Size = fread(&Magic, 1, sizeof(Magic), File);
+    if (fseeko(File, Position, SEEK_SET) != 0) {
+        return FALSE;
+    }
+
+    if ((Size != sizeof(Magic)) || (Magic != LZMA_BLOCK_HEADER_MAGIC)) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+LZ_STATUS
+LzpUtilProcessBatch (
+    PLZMA_UTIL Context,
+    LZMA_UTIL_ACTION Action,
+    PLZMA_UTIL_BLOCK Blocks,
+    ULONG BlockCount,
+    ULONG ThreadCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine compresses or decompresses a batch of blocks, spreading the
+    work across the given number of threads.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Action - Supplies whether to compress or decompress the blocks.
+
+    Blocks - Supplies the array of blocks to work on.
+
+    BlockCount - Supplies the number of blocks in the array.
+
+    ThreadCount - Supplies the number of threads to use, including the calling
+        thread.
+
+Return Value:
+
+    Returns the status of the first block that failed, or LzSuccess if every
+    block succeeded.
+
+--*/
+
+{
+
+    LZMA_UTIL_BATCH Batch;
+    ULONG BlockIndex;
+
+#ifdef LZMA_UTIL_THREADS
+
+    ULONG Created;
+    pthread_t *Threads;
+
+#endif
+
+    Batch.Context = Context;
+    Batch.Action = Action;
+    Batch.Blocks = Blocks;
+    Batch.BlockCount = BlockCount;
+    Batch.NextBlock = 0;
+    if (ThreadCount > BlockCount) {
+        ThreadCount = BlockCount;
+    }
+
+#ifdef LZMA_UTIL_THREADS
+
+    //
+    // Spin up helper threads, and then have the calling thread pitch in too.
+    // If threads fail to be created, the work simply gets done by fewer of
+    // them.
+    //
+
+    Created = 0;
+    Threads = NULL;
+    pthread_mutex_init(&(Batch.Lock), NULL);
+    if (ThreadCount > 1) {
+        Threads = malloc((ThreadCount - 1) * sizeof(pthread_t));
+        if (Threads != NULL) {
+            while (Created < ThreadCount - 1) {
+                if (pthread_create(&(Threads[Created]),
+                                   NULL,
+                                   LzpUtilBatchWorker,
+                                   &Batch) != 0) {
+
+                    break;
+                }
+
+                Created += 1;
+            }
+        }
+    }
+
+    LzpUtilBatchWorker(&Batch);
+    while (Created != 0) {
+        Created -= 1;
+        pthread_join(Threads[Created], NULL);
+    }
+
+    if (Threads != NULL) {
+        free(Threads);
+    }
+
+    pthread_mutex_destroy(&(Batch.Lock));
+
+#else
+
+    LzpUtilBatchWorker(&Batch);
+
+#endif
+
+    for (BlockIndex = 0; BlockIndex < BlockCount; BlockIndex += 1) {
+        if (Blocks[BlockIndex].Status != LzSuccess) {
+            return Blocks[BlockIndex].Status;
+        }
+    }
+
+    return LzSuccess;
+}
+
+PVOID
+LzpUtilBatchWorker (
+    PVOID Parameter
+    )
+
+/*++
+
+Routine Description:
+
+    This routine implements the work loop for a thread helping with a batch of
+    blocks. It grabs blocks off the batch until there are none left.
+
+Arguments:
+
+    Parameter - Supplies a pointer to the batch.
+
+Return Value:
+
+    NULL always.
+
+--*/
+
+{
+
+    PLZMA_UTIL_BATCH Batch;
+    PLZMA_UTIL_BLOCK Block;
+    ULONG BlockIndex;
+
+    Batch = Parameter;
+    while (TRUE) {
+
+#ifdef LZMA_UTIL_THREADS
+
+        pthread_mutex_lock(&(Batch->Lock));
+
+#endif
+
+        BlockIndex = Batch->NextBlock;
+        if (BlockIndex < Batch->BlockCount) {
+            Batch->NextBlock += 1;
+        }
+
+#ifdef LZMA_UTIL_THREADS
+
+        pthread_mutex_unlock(&(Batch->Lock));
+
+#endif
+
+        if (BlockIndex >= Batch->BlockCount) {
+            break;
+        }
+
+        Block = &(Batch->Blocks[BlockIndex]);
+        if (Batch->Action == LzmaActionCompress) {
+            Block->Status = LzLzmaEncodeBlock(
+                                       LzpUtilReallocate,
+                                       &(Batch->Context->EncoderProperties),
+                                       Block->Input,
+                                       Block->InputSize,
+                                       &(Block->Output),
+                                       &(Block->OutputSize),
+                                       &(Block->Crc32));
+
+        } else {
+            Block->Status = LzLzmaDecodeBlock(LzpUtilReallocate,
+                                              Block->Input,
+                                              Block->InputSize,
+                                              Block->Output,
+                                              Block->OutputSize,
+                                              Block->Crc32);
+        }
+    }
+
+    return NULL;
+}
+
+INT
+LzpUtilRunBenchmark (
+    PLZMA_UTIL Context,
+    PCSTR InputPath
+    )
+
+/*++
+
+Routine Description:
+
+    This routine measures block archive compression and decompression
+    throughput on the given file using an increasing number of threads.
+    Everything is done in memory, so disk speed does not factor in.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    InputPath - Supplies the path of the file to compress.
+
+Return Value:
+
+    0 on success.
+
+    Non-zero on failure.
+
+--*/
+
+{
+
+    ULONG BlockCount;
+    ULONG BlockIndex;
+    PLZMA_UTIL_BLOCK Blocks;
+    ULONGLONG CompressedSize;
+    ULONGLONG CompressTime;
+    PUCHAR Data;
+    PLZMA_UTIL_BLOCK DecodeBlocks;
+    ULONGLONG DecompressTime;
+    FILE *File;
+    LZMA_BLOCK_HEADER Header;
+    LZ_STATUS LzStatus;
+    double Megabytes;
+    PUCHAR Result;
+    off_t Size;
+    ULONGLONG Start;
+    INT Status;
+    ULONG ThreadCount;
+
+    Blocks = NULL;
+    Data = NULL;
+    DecodeBlocks = NULL;
+    Result = NULL;
+    Status = 1;
+    File = fopen(InputPath, "rb");
+    if (File == NULL) {
+        fprintf(stderr,
+                "Error: Failed to open %s: %s.\n",
+                InputPath,
+                strerror(errno));
+
+        goto RunBenchmarkEnd;
+    }
+
+    if ((fseeko(File, 0, SEEK_END) != 0) || ((Size = ftello(File)) <= 0) ||
+        (fseeko(File, 0, SEEK_SET) != 0)) {
+
+        fprintf(stderr, "Error: %s is empty or not seekable.\n", InputPath);
+        goto RunBenchmarkEnd;
+    }
+
+    Data = malloc(Size);
+    Result = malloc(Size);
+    BlockCount = (Size + Context->BlockSize - 1) / Context->BlockSize;
+    Blocks = calloc(BlockCount, sizeof(LZMA_UTIL_BLOCK));
+    DecodeBlocks = calloc(BlockCount, sizeof(LZMA_UTIL_BLOCK));
+    if ((Data == NULL) || (Result == NULL) || (Blocks == NULL) ||
+        (DecodeBlocks == NULL)) {
+
+        fprintf(stderr, "Error: Allocation failure.\n");
+        goto RunBenchmarkEnd;
+    }
+
+    if (fread(Data, 1, Size, File) != Size) {
+        fprintf(stderr, "lzma: Read Error: %s\n", strerror(errno));
+        goto RunBenchmarkEnd;
+    }
+
+    //
+    // Initializing a header also sets up the tables shared by the threads.
+    //
+
+    LzLzmaInitializeBlockHeader(&Header, Context->BlockSize);
+
+    Megabytes = (double)Size / (1024.0 * 1024.0);
+    printf("%-9s%-17s%-17s%s\n",
+           "Threads",
+           "Compress MB/s",
+           "Decompress MB/s",
+           "Ratio");
+
+    ThreadCount = 1;
+    while (TRUE) {
+        if (ThreadCount > Context->ThreadCount) {
+            ThreadCount = Context->ThreadCount;
+        }
+
+        for (BlockIndex = 0; BlockIndex < BlockCount; BlockIndex += 1) {
+            Blocks[BlockIndex].Input = Data +
+                                       (BlockIndex * Context->BlockSize);
+
+            Blocks[BlockIndex].InputSize = Context->BlockSize;
+            if (BlockIndex == BlockCount - 1) {
+                Blocks[BlockIndex].InputSize =
+                                   Size - (BlockIndex * Context->BlockSize);
+            }
+        }
+
+        Start = LzpUtilGetMicroseconds();
+        LzStatus = LzpUtilProcessBatch(Context,
+                                       LzmaActionCompress,
+                                       Blocks,
+                                       BlockCount,
+                                       ThreadCount);
+
+        CompressTime = LzpUtilGetMicroseconds() - Start;
+        if (LzStatus != LzSuccess) {
+            fprintf(stderr,
+                    "Error: Failed to encode: %s.\n",
+                    LzpUtilGetErrorString(LzStatus));
+
+            goto RunBenchmarkEnd;
+        }
+
+        CompressedSize = sizeof(Header) + sizeof(LZMA_BLOCK_TRAILER);
+        for (BlockIndex = 0; BlockIndex < BlockCount; BlockIndex += 1) {
+            DecodeBlocks[BlockIndex].Input = Blocks[BlockIndex].Output;
+            DecodeBlocks[BlockIndex].InputSize = Blocks[BlockIndex].OutputSize;
+            DecodeBlocks[BlockIndex].Output = Result +
+                                              (BlockIndex * Context->BlockSize);
+
+            DecodeBlocks[BlockIndex].OutputSize = Blocks[BlockIndex].InputSize;
+            DecodeBlocks[BlockIndex].Crc32 = Blocks[BlockIndex].Crc32;
+            CompressedSize += Blocks[BlockIndex].OutputSize +
+                              sizeof(LZMA_BLOCK_INDEX_ENTRY);
+        }
+
+        Start = LzpUtilGetMicroseconds();
+        LzStatus = LzpUtilProcessBatch(Context,
+                                       LzmaActionDecompress,
+                                       DecodeBlocks,
+                                       BlockCount,
+                                       ThreadCount);
+
+        DecompressTime = LzpUtilGetMicroseconds() - Start;
+        for (BlockIndex = 0; BlockIndex < BlockCount; BlockIndex += 1) {
+            free(Blocks[BlockIndex].Output);
+            Blocks[BlockIndex].Output = NULL;
+        }
+
+        if (LzStatus != LzSuccess) {
+            fprintf(stderr,
+                    "Error: Failed to decode: %s.\n",
+                    LzpUtilGetErrorString(LzStatus));
+
+            goto RunBenchmarkEnd;
+        }
+
+        if (memcmp(Data, Result, Size) != 0) {
+            fprintf(stderr, "Error: Decompressed data does not match.\n");
+            goto RunBenchmarkEnd;
+        }
+
+        if (CompressTime == 0) {
+            CompressTime = 1;
+        }
+
+        if (DecompressTime == 0) {
+            DecompressTime = 1;
+        }
+
+        printf("%-9d%-17.2f%-17.2f%.1f%%\n",
+               ThreadCount,
+               Megabytes * 1000000.0 / CompressTime,
+               Megabytes * 1000000.0 / DecompressTime,
+               (double)CompressedSize * 100.0 / Size);
+
+        if (ThreadCount == Context->ThreadCount) {
+            break;
+        }
+
+        ThreadCount *= 2;
+    }
+
+    Status = 0;
+
+RunBenchmarkEnd:
+    if (Blocks != NULL) {
+        for (BlockIndex = 0; BlockIndex < BlockCount; BlockIndex += 1) {
+            if (Blocks[BlockIndex].Output != NULL) {
+                free(Blocks[BlockIndex].Output);
+            }
+        }
+
+        free(Blocks);
+    }
+
+    if (DecodeBlocks != NULL) {
+        free(DecodeBlocks);
+    }
+
+    if (Data != NULL) {
+        free(Data);
+    }
+
+    if (Result != NULL) {
+        free(Result);
+    }
+
+    if (File != NULL) {
+        fclose(File);
+    }
+
+    return Status;
+}
+
+ULONG
+LzpUtilGetProcessorCount (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the number of threads to use by default, which is
+    one per online processor.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns the default thread count.
+
+--*/
+
+{
+
+#ifdef LZMA_UTIL_THREADS
+
+    long Count;
+
+    Count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (Count > LZMA_UTIL_MAX_THREADS) {
+        Count = LZMA_UTIL_MAX_THREADS;
+    }
+
+    if (Count > 0) {
+        return Count;
+    }
+
+#endif
+
+    return 1;
+}
+
+ULONGLONG
+LzpUtilGetMicroseconds (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the current time in microseconds, for use in
+    measuring elapsed time.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns the current time in microseconds.
+
+--*/
+
+{
+
+    struct timeval Time;
+
+    gettimeofday(&Time, NULL);
+    return (Time.tv_sec * 1000000ULL) + Time.tv_usec;
+}
+
 PVOID
 LzpUtilReallocate (
     PVOID Allocation,
@@ -145,11 +145,13 @@ function build() {
         "pthread/thrattr.c",
         "pty.c",
         "qsort.c",
+        "qsortpar.c",
         "rand.c",
         "random.c",
         "realpath.c",
         "regexcmp.c",
         "regexexe.c",
+        "regexnfa.c",
         "resolv.c",
         "resource.c",
         "scan.c",
@@ -189,12 +191,14 @@ function build() {
         "getopt.c",
         "qsort.c",
         "regexcmp.c",
-        "regexexe.c"
+        "regexexe.c",
+        "regexnfa.c"
     ];
 
     wincsupSources = [
         "regexcmp.c",
         "regexexe.c",
+        "regexnfa.c",
         "wincsup/strftime.c"
     ];
 
@@ -451,6 +451,16 @@ Return Value:
         FileControlCommand = FileControlCommandCloseFrom;
         break;
 
+    case F_GETPIPE_SZ:
+        FileControlCommand = FileControlCommandGetPipeSize;
+        Parameters.PipeSize = 0;
+        break;
+
+    case F_SETPIPE_SZ:
+        FileControlCommand = FileControlCommandSetPipeSize;
+        Parameters.PipeSize = va_arg(ArgumentList, int);
+        break;
+
     default:
         Status = STATUS_INVALID_PARAMETER;
         goto fcntlEnd;
@@ -502,6 +512,11 @@ Return Value:
         ReturnValue = 0;
         break;
 
+    case F_GETPIPE_SZ:
+    case F_SETPIPE_SZ:
+        ReturnValue = Parameters.PipeSize;
+        break;
+
     case F_GETFL:
         ReturnValue = 0;
         Flags = Parameters.Flags;
@@ -207,6 +207,44 @@ typedef struct _CL_TYPE_CONVERSION_INTERFACE {
 
 } CL_TYPE_CONVERSION_INTERFACE, *PCL_TYPE_CONVERSION_INTERFACE;
 
+typedef enum _QUICKSORT_SWAP_TYPE {
+    QuickSortSwapBytes,
+    QuickSortSwapWords,
+    QuickSortSwapWord
+} QUICKSORT_SWAP_TYPE, *PQUICKSORT_SWAP_TYPE;
+
+/*++
+
+Structure Description:
+
+    This structure stores the parameters of a sort operation.
+
+Members:
+
+    CompareFunction - Stores an optional pointer to the qsort style compare
+        function.
+
+    CompareFunctionWithArgument - Stores an optional pointer to the qsort_r
+        style compare function. Exactly one of the two is set.
+
+    Argument - Stores the argument passed to the qsort_r style compare
+        function.
+
+    ElementSize - Stores the size of each element in bytes.
+
+    SwapType - Stores the widest type of exchange the element size and array
+        alignment allow.
+
+--*/
+
+typedef struct _QUICKSORT_CONTEXT {
+    int (*CompareFunction)(const void *, const void *);
+    int (*CompareFunctionWithArgument)(const void *, const void *, void *);
+    void *Argument;
+    size_t ElementSize;
+    QUICKSORT_SWAP_TYPE SwapType;
+} QUICKSORT_CONTEXT, *PQUICKSORT_CONTEXT;
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -899,3 +937,73 @@ Return Value:
     -1 on error, and the errno variable will contain more information.
 
 --*/
+
+VOID
+ClpInitializeQuickSortContext (
+    PQUICKSORT_CONTEXT Context,
+    void *ArrayBase,
+    size_t ElementSize,
+    int (*CompareFunction)(const void *, const void *),
+    int (*CompareFunctionWithArgument)(const void *, const void *, void *),
+    void *Argument
+    );
+
+/*++
+
+Routine Description:
+
+    This routine initializes a sort context, picking the widest swap the
+    array's size and alignment allow.
+
+Arguments:
+
+    Context - Supplies a pointer to the context to initialize.
+
+    ArrayBase - Supplies a pointer to the array that will be sorted.
+
+    ElementSize - Supplies the size of one of the elements.
+
+    CompareFunction - Supplies an optional pointer to the plain compare
+        function.
+
+    CompareFunctionWithArgument - Supplies an optional pointer to the compare
+        function that takes an argument. Exactly one of the two compare
+        functions must be supplied.
+
+    Argument - Supplies the argument to pass to the second form of compare
+        function.
+
+Return Value:
+
+    None.
+
+--*/
+
+VOID
+ClpQuickSortArray (
+    PQUICKSORT_CONTEXT Context,
+    void *ArrayBase,
+    size_t ElementCount
+    );
+
+/*++
+
+Routine Description:
+
+    This routine sorts an array (or a piece of one) in place.
+
+Arguments:
+
+    Context - Supplies a pointer to the initialized sort context.
+
+    ArrayBase - Supplies a pointer to the first element to sort. This must
+        have the same alignment the context was initialized with.
+
+    ElementCount - Supplies the number of elements to sort.
+
+Return Value:
+
+    None.
+
+--*/
+
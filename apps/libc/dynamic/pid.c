@@ -397,6 +397,7 @@ Return Value:
     fflush(NULL);
     Result = OsForkProcess(0, NULL);
     if (Result == 0) {
+        OsResetKernelThreadId();
         ClpRunAtforkChildRoutines();
 
     //
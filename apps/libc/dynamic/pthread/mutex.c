@@ -49,6 +49,13 @@ Module Name:
 #define PTHREAD_MUTEX_STATE_ERRORCHECK 0x80000000
 #define PTHREAD_MUTEX_STATE_TYPE_MASK 0xC0000000
 
+//
+// Define the number of times a contended normal mutex will spin waiting for
+// the owner to release it before waiting in the kernel.
+//
+
+#define PTHREAD_MUTEX_SPIN_ROUNDS 4
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -1010,6 +1017,7 @@ Return Value:
     ULONG LockedWithWaiters;
     ULONG OldState;
     ULONG Operation;
+    ULONG Round;
     ULONG TimeoutInMilliseconds;
     ULONG Unlocked;
 
@@ -1021,6 +1029,29 @@ Return Value:
         return 0;
     }
 
+    //
+    // Spin for a bit while the owner is running on another processor, as
+    // short critical sections are likely to finish before a trip to the
+    // kernel and back would.
+    //
+
+    for (Round = 0; Round < PTHREAD_MUTEX_SPIN_ROUNDS; Round += 1) {
+        OldState = Mutex->State;
+        if ((OldState & PTHREAD_MUTEX_STATE_MASK) !=
+            PTHREAD_MUTEX_STATE_UNLOCKED) {
+
+            if (OsSpinOnLock(&(Mutex->State), OldState, Mutex->KernelOwner) ==
+                FALSE) {
+
+                break;
+            }
+        }
+
+        if (ClpTryToAcquireNormalMutex(Mutex, Shared) == 0) {
+            return 0;
+        }
+    }
+
     LockedWithWaiters = Shared | PTHREAD_MUTEX_STATE_LOCKED_WITH_WAITERS;
     Unlocked = Shared | PTHREAD_MUTEX_STATE_UNLOCKED;
 
@@ -1037,6 +1068,7 @@ Return Value:
         //
 
         if (OldState == Unlocked) {
+            Mutex->KernelOwner = OsGetKernelThreadId();
             break;
         }
 
@@ -1114,6 +1146,7 @@ Return Value:
     Unlocked = Shared | PTHREAD_MUTEX_STATE_UNLOCKED;
     OldState = RtlAtomicCompareExchange32(&(Mutex->State), Locked, Unlocked);
     if (OldState == Unlocked) {
+        Mutex->KernelOwner = OsGetKernelThreadId();
         return 0;
     }
 
@@ -1160,6 +1193,7 @@ Return Value:
     // Exchange out the state to unlocked. If it had waiters, wake them up.
     //
 
+    Mutex->KernelOwner = 0;
     OldState = RtlAtomicExchange32(&(Mutex->State), Unlocked);
     if (OldState == LockedWithWaiters) {
         Operation = UserLockWake;
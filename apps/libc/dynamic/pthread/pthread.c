@@ -39,6 +39,15 @@ Module Name:
 // ---------------------------------------------------------------- Definitions
 //
 
+//
+// Define the limits on the cache of exited thread allocations (each holding a
+// stack, guard region, thread structure, and key data) kept for reuse by new
+// threads.
+//
+
+#define PTHREAD_CACHE_MAX_COUNT 16
+#define PTHREAD_CACHE_MAX_SIZE (64 * _1MB)
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -102,6 +111,18 @@ ClpDestroyThread (
     PPTHREAD Thread
     );
 
+PVOID
+ClpGetCachedThreadAllocation (
+    UINTN AllocationSize,
+    UINTN StackSize
+    );
+
+BOOL
+ClpCacheThreadAllocation (
+    PPTHREAD Thread,
+    UINTN AllocationSize
+    );
+
 VOID
 ClpCallThreadDestructors (
     VOID
@@ -136,6 +157,16 @@ __THREAD PPTHREAD ClCurrentThread;
 
 __THREAD LIST_ENTRY ClThreadDestructors;
 
+//
+// Store the cache of allocations from exited threads, linked through the
+// list entry of the thread structure at the top of each allocation. This is
+// protected by the thread list mutex.
+//
+
+LIST_ENTRY ClThreadCache = {&ClThreadCache, &ClThreadCache};
+UINTN ClThreadCacheCount;
+UINTN ClThreadCacheSize;
+
 //
 // ------------------------------------------------------------------ Functions
 //
@@ -584,6 +615,19 @@ Return Value:
         DestroyRegionSize = Thread->ThreadAllocationSize;
         Thread->ThreadAllocationSize = 0;
         ClpDestroyThread(Thread);
+
+        //
+        // Try to hand the stack to the next thread created rather than
+        // unmapping it. This thread is still running on it, but the cache
+        // will not give it out until the kernel has cleared the thread ID.
+        //
+
+        if ((DestroyRegionSize != 0) &&
+            (ClpCacheThreadAllocation(Thread, DestroyRegionSize) != FALSE)) {
+
+            DestroyRegion = NULL;
+            DestroyRegionSize = 0;
+        }
     }
 
     OsExitThread(DestroyRegion, DestroyRegionSize);
@@ -1397,12 +1441,13 @@ Return Value:
     PVOID Stack;
     UINTN StackSize;
     int Status;
+    UINTN ThreadSize;
 
     Allocation = NULL;
 
     //
-    // If the caller wants something non-standard for a stack, then allocate
-    // the stack.
+    // Unless the caller supplied a stack, allocate one along with the thread
+    // structure.
     //
 
     GuardSize = 0;
@@ -1411,31 +1456,43 @@ Return Value:
     AttributeInternal = (PPTHREAD_ATTRIBUTE)Attribute;
     Stack = AttributeInternal->StackBase;
     StackSize = 0;
-    MapSize = sizeof(PTHREAD) + (PTHREAD_KEYS_MAX * sizeof(PTHREAD_KEY_DATA));
-
-    //
-    // Also allocate a stack if none was supplied but a weird guard size was
-    // requested.
-    //
+    ThreadSize = sizeof(PTHREAD) +
+                 (PTHREAD_KEYS_MAX * sizeof(PTHREAD_KEY_DATA));
 
-    if ((Stack == NULL) && (AttributeInternal->GuardSize != PageSize)) {
+    MapSize = ThreadSize;
+    if (Stack == NULL) {
         StackSize = ALIGN_RANGE_UP(AttributeInternal->StackSize, 16);
         MapSize += StackSize;
         MapSize = ALIGN_RANGE_UP(MapSize, PageSize);
         GuardSize = ALIGN_RANGE_UP(AttributeInternal->GuardSize, PageSize);
         MapSize += GuardSize;
-    }
 
-    MapFlags = MAP_PRIVATE | MAP_ANONYMOUS;
-    Allocation = mmap(Stack, MapSize, PROT_READ | PROT_WRITE, MapFlags, -1, 0);
-    if (Allocation == MAP_FAILED) {
-        Status = errno;
-        goto AllocateThreadEnd;
+        //
+        // Thread-per-request programs create and destroy threads constantly,
+        // so try to reuse the allocation of a thread that has already exited
+        // before going to the kernel for a new one.
+        //
+
+        Allocation = ClpGetCachedThreadAllocation(MapSize, StackSize);
     }
 
-    if ((Stack == NULL) && (AttributeInternal->GuardSize != PageSize)) {
+    if (Allocation == NULL) {
+        MapFlags = MAP_PRIVATE | MAP_ANONYMOUS;
+        Allocation = mmap(Stack,
+                          MapSize,
+                          PROT_READ | PROT_WRITE,
+                          MapFlags,
+                          -1,
+                          0);
+
+        if (Allocation == MAP_FAILED) {
+            Allocation = NULL;
+            Status = errno;
+            goto AllocateThreadEnd;
+        }
+
         if (GuardSize != 0) {
-            if (mprotect(Stack, GuardSize, PROT_NONE) < 0) {
+            if (mprotect(Allocation, GuardSize, PROT_NONE) < 0) {
                 Status = errno;
                 goto AllocateThreadEnd;
             }
@@ -1443,15 +1500,17 @@ Return Value:
     }
 
     NewThread = Allocation + GuardSize + StackSize;
+    memset(NewThread, 0, ThreadSize);
     memcpy(&(NewThread->Attribute),
            AttributeInternal,
            sizeof(PTHREAD_ATTRIBUTE));
 
-    NewThread->Attribute.StackBase = Stack;
     if (StackSize != 0) {
+        Stack = Allocation + GuardSize;
         NewThread->Attribute.StackSize = StackSize;
     }
 
+    NewThread->Attribute.StackBase = Stack;
     NewThread->ThreadRoutine = StartRoutine;
     NewThread->ThreadParameter = Argument;
     NewThread->ThreadAllocation = Allocation;
@@ -1511,12 +1570,148 @@ Return Value:
     }
 
     if (Thread->ThreadAllocationSize != 0) {
-        munmap(Thread->ThreadAllocation, Thread->ThreadAllocationSize);
+        if (ClpCacheThreadAllocation(Thread,
+                                     Thread->ThreadAllocationSize) == FALSE) {
+
+            munmap(Thread->ThreadAllocation, Thread->ThreadAllocationSize);
+        }
     }
 
     return;
 }
 
+PVOID
+ClpGetCachedThreadAllocation (
+    UINTN AllocationSize,
+    UINTN StackSize
+    )
+
+/*++
+
+Routine Description:
+
+    This routine attempts to pull an allocation from an exited thread out of
+    the thread cache.
+
+Arguments:
+
+    AllocationSize - Supplies the total size of the desired allocation,
+        including the guard region.
+
+    StackSize - Supplies the desired stack size.
+
+Return Value:
+
+    Returns a pointer to the base of the allocation, with the guard region
+    already protected, on success.
+
+    NULL if no suitable allocation was cached.
+
+--*/
+
+{
+
+    PVOID Allocation;
+    PPTHREAD CachedThread;
+    PLIST_ENTRY CurrentEntry;
+
+    if (ClThreadCacheCount == 0) {
+        return NULL;
+    }
+
+    Allocation = NULL;
+    pthread_mutex_lock(&ClThreadListMutex);
+    CurrentEntry = ClThreadCache.Next;
+    while (CurrentEntry != &ClThreadCache) {
+        CachedThread = LIST_VALUE(CurrentEntry, PTHREAD, ListEntry);
+        CurrentEntry = CurrentEntry->Next;
+
+        //
+        // The same stack size and total size imply the same guard size. Skip
+        // detached threads that have not quite finished exiting, as they are
+        // still running on the stack. The kernel zeroes the thread ID once
+        // the thread is gone for good.
+        //
+
+        if ((CachedThread->ThreadAllocationSize == AllocationSize) &&
+            (CachedThread->Attribute.StackSize == StackSize) &&
+            (CachedThread->ThreadId == 0)) {
+
+            LIST_REMOVE(&(CachedThread->ListEntry));
+            ClThreadCacheCount -= 1;
+            ClThreadCacheSize -= AllocationSize;
+            Allocation = CachedThread->ThreadAllocation;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&ClThreadListMutex);
+    return Allocation;
+}
+
+BOOL
+ClpCacheThreadAllocation (
+    PPTHREAD Thread,
+    UINTN AllocationSize
+    )
+
+/*++
+
+Routine Description:
+
+    This routine attempts to put the allocation of a destroyed thread onto the
+    thread cache for reuse by a future thread.
+
+Arguments:
+
+    Thread - Supplies a pointer to the destroyed thread, whose structure
+        lives at the top of the allocation.
+
+    AllocationSize - Supplies the size of the thread's allocation.
+
+Return Value:
+
+    TRUE if the allocation was cached. The caller must not unmap it.
+
+    FALSE if the allocation was not cached and should be freed.
+
+--*/
+
+{
+
+    BOOL Cached;
+
+    //
+    // Only cache allocations that contain a stack the C library allocated,
+    // which is exactly when the thread structure is not at the start.
+    //
+
+    if ((PVOID)Thread == Thread->ThreadAllocation) {
+        return FALSE;
+    }
+
+    if ((ClThreadCacheCount >= PTHREAD_CACHE_MAX_COUNT) ||
+        (ClThreadCacheSize + AllocationSize > PTHREAD_CACHE_MAX_SIZE)) {
+
+        return FALSE;
+    }
+
+    Cached = FALSE;
+    pthread_mutex_lock(&ClThreadListMutex);
+    if ((ClThreadCacheCount < PTHREAD_CACHE_MAX_COUNT) &&
+        (ClThreadCacheSize + AllocationSize <= PTHREAD_CACHE_MAX_SIZE)) {
+
+        Thread->ThreadAllocationSize = AllocationSize;
+        INSERT_AFTER(&(Thread->ListEntry), &ClThreadCache);
+        ClThreadCacheCount += 1;
+        ClThreadCacheSize += AllocationSize;
+        Cached = TRUE;
+    }
+
+    pthread_mutex_unlock(&ClThreadListMutex);
+    return Cached;
+}
+
 VOID
 ClpCallThreadDestructors (
     VOID
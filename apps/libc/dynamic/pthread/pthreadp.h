@@ -108,6 +108,9 @@ Structure Description:
 
     State - Stores the state of the mutex.
 
+    KernelOwner - Stores the kernel thread ID of the owner of a normal mutex.
+        This is used as a hint for adaptive spinning.
+
     Owner - Stores the owner of the mutex, used when the recursive
         implementation is set.
 
@@ -115,6 +118,7 @@ Structure Description:
 
 typedef struct _PTHREAD_MUTEX {
     ULONG State;
+    THREAD_ID KernelOwner;
     UINTN Owner;
 } PTHREAD_MUTEX, *PPTHREAD_MUTEX;
 
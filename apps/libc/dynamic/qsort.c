@@ -13,7 +13,11 @@ Module Name:
 
 Abstract:
 
-    This module implements the QuickSort standard C library function.
+    This module implements the QuickSort standard C library function. The
+    sort itself is a pattern-defeating quicksort: an introspective quicksort
+    that falls back to insertion sort for small ranges, detects ranges that
+    are already sorted, groups runs of equal elements, and falls back to
+    heapsort if too many bad pivots are chosen.
 
 Author:
 
@@ -38,40 +42,64 @@ Module Name:
 //
 
 //
-// This macro is a helper to the quicksort swap macro. It gets a pointer to a
-// void pointer at the given index.
+// This macro compares two elements, calling whichever form of the compare
+// function the sort context was set up with.
 //
 
-#define QUICKSORT_ELEMENT(_Base, _ElementSize, _Index) \
-    (*((void **)((_Base) + ((_ElementSize) * (_Index)))))
+#define QSORT_COMPARE(_Context, _Left, _Right)                            \
+    (((_Context)->CompareFunction != NULL) ?                              \
+     (_Context)->CompareFunction((_Left), (_Right)) :                     \
+     (_Context)->CompareFunctionWithArgument((_Left),                     \
+                                             (_Right),                    \
+                                             (_Context)->Argument))
 
 //
-// This macro either performs an exchange directly for pointer sized elements,
-// or calls the bytewise swap function to exchange byte for byte. It assumes
-// the presence of a void pointer local called SwapPointer.
+// This macro evaluates to non-zero if the left element sorts strictly before
+// the right element.
 //
 
-#define QUICKSORT_SWAP(_Base, _ElementSize, _FirstIndex, _SecondIndex)         \
-    {                                                                          \
-        if ((_ElementSize) == sizeof(void *)) {                                \
-            SwapPointer = QUICKSORT_ELEMENT(_Base, _ElementSize, _FirstIndex); \
-            QUICKSORT_ELEMENT(_Base, _ElementSize, _FirstIndex) =              \
-                        QUICKSORT_ELEMENT(_Base, _ElementSize, _SecondIndex);  \
-                                                                               \
-            QUICKSORT_ELEMENT(_Base, _ElementSize, _SecondIndex) =             \
-                                                                  SwapPointer; \
-        } else {                                                               \
-            ClpQuickSortSwap((_Base),                                          \
-                             (_ElementSize),                                   \
-                             (_FirstIndex),                                    \
-                             (_SecondIndex));                                  \
-        }                                                                      \
+#define QSORT_LESS(_Context, _Left, _Right) \
+    (QSORT_COMPARE(_Context, _Left, _Right) < 0)
+
+//
+// This macro exchanges two elements. Single word elements are swapped inline,
+// everything else goes through the swap function.
+//
+
+#define QSORT_SWAP(_Context, _First, _Second)                             \
+    if ((_Context)->SwapType == QuickSortSwapWord) {                      \
+        long _SwapWord = *((long *)(_First));                             \
+        *((long *)(_First)) = *((long *)(_Second));                       \
+        *((long *)(_Second)) = _SwapWord;                                 \
+                                                                          \
+    } else {                                                              \
+        ClpQuickSortSwap((_Context), (_First), (_Second));                \
     }
 
 //
 // ---------------------------------------------------------------- Definitions
 //
 
+//
+// Define the size below which ranges are sorted with insertion sort.
+//
+
+#define QSORT_INSERTION_SORT_THRESHOLD 24
+
+//
+// Define the size above which the pivot is chosen with Tukey's ninther rather
+// than a median of three.
+//
+
+#define QSORT_NINTHER_THRESHOLD 128
+
+//
+// Define the number of element moves a partial insertion sort is allowed
+// before it gives up on a range that looked sorted.
+//
+
+#define QSORT_PARTIAL_INSERTION_SORT_LIMIT 8
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -81,20 +109,79 @@ Module Name:
 //
 
 VOID
-ClpQuickSort (
-    void *ArrayBase,
-    size_t ElementSize,
-    ssize_t StartIndex,
-    ssize_t EndIndex,
-    int (*CompareFunction)(const void *, const void *)
+ClpQuickSortLoop (
+    PQUICKSORT_CONTEXT Context,
+    char *Begin,
+    char *End,
+    ULONG BadAllowed,
+    BOOL Leftmost
+    );
+
+char *
+ClpQuickSortPartitionRight (
+    PQUICKSORT_CONTEXT Context,
+    char *Begin,
+    char *End,
+    PBOOL AlreadyPartitioned
+    );
+
+char *
+ClpQuickSortPartitionLeft (
+    PQUICKSORT_CONTEXT Context,
+    char *Begin,
+    char *End
+    );
+
+VOID
+ClpQuickSortBreakPatterns (
+    PQUICKSORT_CONTEXT Context,
+    char *Begin,
+    char *End
+    );
+
+VOID
+ClpQuickSortInsertionSort (
+    PQUICKSORT_CONTEXT Context,
+    char *Begin,
+    char *End,
+    BOOL Guarded
+    );
+
+BOOL
+ClpQuickSortPartialInsertionSort (
+    PQUICKSORT_CONTEXT Context,
+    char *Begin,
+    char *End
+    );
+
+VOID
+ClpQuickSortHeapSort (
+    PQUICKSORT_CONTEXT Context,
+    char *Begin,
+    char *End
+    );
+
+VOID
+ClpQuickSortSiftDown (
+    PQUICKSORT_CONTEXT Context,
+    char *Base,
+    size_t Root,
+    size_t Count
+    );
+
+VOID
+ClpQuickSortSort3 (
+    PQUICKSORT_CONTEXT Context,
+    char *First,
+    char *Second,
+    char *Third
     );
 
 VOID
 ClpQuickSortSwap (
-    void *ArrayBase,
-    size_t ElementSize,
-    ssize_t FirstIndex,
-    ssize_t SecondIndex
+    PQUICKSORT_CONTEXT Context,
+    char *First,
+    char *Second
     );
 
 //
@@ -145,57 +232,57 @@ Return Value:
 
 {
 
+    QUICKSORT_CONTEXT Context;
+
     assert(ElementCount < (((size_t)-1) >> 1));
     assert(ElementSize < (((size_t)-1) >> 1));
 
-    if (ElementCount > 1) {
-        ClpQuickSort(ArrayBase,
-                     ElementSize,
-                     0,
-                     ElementCount - 1,
-                     CompareFunction);
-    }
+    ClpInitializeQuickSortContext(&Context,
+                                  ArrayBase,
+                                  ElementSize,
+                                  CompareFunction,
+                                  NULL,
+                                  NULL);
 
+    ClpQuickSortArray(&Context, ArrayBase, ElementCount);
     return;
 }
 
-//
-// --------------------------------------------------------- Internal Functions
-//
-
-VOID
-ClpQuickSort (
+LIBC_API
+void
+qsort_r (
     void *ArrayBase,
+    size_t ElementCount,
     size_t ElementSize,
-    ssize_t StartIndex,
-    ssize_t EndIndex,
-    int (*CompareFunction)(const void *, const void *)
+    int (*CompareFunction)(const void *, const void *, void *),
+    void *Argument
     )
 
 /*++
 
 Routine Description:
 
-    This routine sorts an array of items in place using the QuickSort algorithm.
+    This routine sorts an array of items in place using the QuickSort
+    algorithm, passing an additional argument through to the compare function.
 
 Arguments:
 
     ArrayBase - Supplies a pointer to the array of items that will get pushed
         around.
 
-    ElementSize - Supplies the size of one of the elements.
-
-    StartIndex - Supplies the starting index of the array to sort, inclusive.
+    ElementCount - Supplies the number of elements in the array.
 
-    EndIndex - Supplies the ending index of the array to sort, inclusive.
+    ElementSize - Supplies the size of one of the elements.
 
     CompareFunction - Supplies a pointer to a function that will be used to
         compare elements. The function takes in two pointers that will point
-        within the array. It returns less than zero if the first element is
-        less than the second, zero if the first element is equal to the second,
-        and greater than zero if the first element is greater than the second.
-        The routine must not modify the array itself or inconsistently
-        report comparisons, otherwise the sorting will not come out correctly.
+        within the array, and the argument pointer passed to this routine. It
+        returns less than zero if the first element is less than the second,
+        zero if the first element is equal to the second, and greater than
+        zero if the first element is greater than the second.
+
+    Argument - Supplies an opaque pointer that is passed along to the compare
+        function.
 
 Return Value:
 
@@ -205,206 +292,612 @@ Return Value:
 
 {
 
-    int CompareResult;
-    ssize_t EqualIndex;
-    ssize_t LargerIndex;
-    ssize_t LargestIndex;
-    void *LastElement;
-    ssize_t SmallerIndex;
-    ssize_t SmallestIndex;
-    void *SwapPointer;
+    QUICKSORT_CONTEXT Context;
 
-    if (EndIndex <= StartIndex) {
-        return;
+    assert(ElementCount < (((size_t)-1) >> 1));
+    assert(ElementSize < (((size_t)-1) >> 1));
+
+    ClpInitializeQuickSortContext(&Context,
+                                  ArrayBase,
+                                  ElementSize,
+                                  NULL,
+                                  CompareFunction,
+                                  Argument);
+
+    ClpQuickSortArray(&Context, ArrayBase, ElementCount);
+    return;
+}
+
+VOID
+ClpInitializeQuickSortContext (
+    PQUICKSORT_CONTEXT Context,
+    void *ArrayBase,
+    size_t ElementSize,
+    int (*CompareFunction)(const void *, const void *),
+    int (*CompareFunctionWithArgument)(const void *, const void *, void *),
+    void *Argument
+    )
+
+/*++
+
+Routine Description:
+
+    This routine initializes a sort context, picking the widest swap the
+    array's size and alignment allow.
+
+Arguments:
+
+    Context - Supplies a pointer to the context to initialize.
+
+    ArrayBase - Supplies a pointer to the array that will be sorted.
+
+    ElementSize - Supplies the size of one of the elements.
+
+    CompareFunction - Supplies an optional pointer to the plain compare
+        function.
+
+    CompareFunctionWithArgument - Supplies an optional pointer to the compare
+        function that takes an argument. Exactly one of the two compare
+        functions must be supplied.
+
+    Argument - Supplies the argument to pass to the second form of compare
+        function.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    assert((CompareFunction == NULL) != (CompareFunctionWithArgument == NULL));
+
+    Context->CompareFunction = CompareFunction;
+    Context->CompareFunctionWithArgument = CompareFunctionWithArgument;
+    Context->Argument = Argument;
+    Context->ElementSize = ElementSize;
+    Context->SwapType = QuickSortSwapBytes;
+    if ((((UINTN)ArrayBase | ElementSize) & (sizeof(long) - 1)) == 0) {
+        Context->SwapType = QuickSortSwapWords;
+        if (ElementSize == sizeof(long)) {
+            Context->SwapType = QuickSortSwapWord;
+        }
     }
 
-    LastElement = ArrayBase + (EndIndex * ElementSize);
-    SmallerIndex = StartIndex - 1;
-    SmallestIndex = StartIndex - 1;
-    LargerIndex = EndIndex;
-    LargestIndex = EndIndex;
+    return;
+}
+
+VOID
+ClpQuickSortArray (
+    PQUICKSORT_CONTEXT Context,
+    void *ArrayBase,
+    size_t ElementCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sorts an array (or a piece of one) in place.
+
+Arguments:
+
+    Context - Supplies a pointer to the initialized sort context.
+
+    ArrayBase - Supplies a pointer to the first element to sort. This must
+        have the same alignment the context was initialized with.
+
+    ElementCount - Supplies the number of elements to sort.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG BadAllowed;
+    size_t Count;
+
+    if (ElementCount < 2) {
+        return;
+    }
 
     //
-    // Loop swapping elements that are on the wrong side of the pivot (which is
-    // selected to be the last element). The loop stops when the indices cross.
+    // Allow roughly log2(n) bad partitions before switching to heapsort,
+    // which bounds the worst case at O(n log n).
     //
 
+    BadAllowed = 0;
+    Count = ElementCount;
+    while (Count > 1) {
+        BadAllowed += 1;
+        Count >>= 1;
+    }
+
+    ClpQuickSortLoop(Context,
+                     ArrayBase,
+                     (char *)ArrayBase + (ElementCount * Context->ElementSize),
+                     BadAllowed,
+                     TRUE);
+
+    return;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+VOID
+ClpQuickSortLoop (
+    PQUICKSORT_CONTEXT Context,
+    char *Begin,
+    char *End,
+    ULONG BadAllowed,
+    BOOL Leftmost
+    )
+
+/*++
+
+Routine Description:
+
+    This routine implements the core of the sort. It partitions the range,
+    recurses on the smaller side, and loops on the larger side so that the
+    stack depth stays logarithmic.
+
+Arguments:
+
+    Context - Supplies a pointer to the sort context.
+
+    Begin - Supplies a pointer to the first element of the range.
+
+    End - Supplies a pointer one element beyond the end of the range.
+
+    BadAllowed - Supplies the number of highly unbalanced partitions that
+        are tolerated before falling back to heapsort.
+
+    Leftmost - Supplies a boolean indicating if this range is at the very
+        start of the array. If not, the element just before the range is
+        known to be less than or equal to everything in the range.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    BOOL AlreadyPartitioned;
+    size_t Count;
+    size_t ElementSize;
+    BOOL HighlyUnbalanced;
+    size_t LeftCount;
+    size_t Middle;
+    char *Pivot;
+    size_t RightCount;
+
+    ElementSize = Context->ElementSize;
     while (TRUE) {
+        Count = (End - Begin) / ElementSize;
+        if (Count < QSORT_INSERTION_SORT_THRESHOLD) {
+            ClpQuickSortInsertionSort(Context, Begin, End, Leftmost);
+            return;
+        }
 
         //
-        // Scan along as long as the current value is less than the last value.
+        // Choose a pivot and move it to the beginning of the range. Large
+        // ranges use the median of three medians, which also guarantees that
+        // there are elements on either side of the pivot for the unguarded
+        // scans in the partition routines.
         //
 
-        while (TRUE) {
-            SmallerIndex += 1;
-            if (SmallerIndex == EndIndex) {
-                break;
-            }
-
-            CompareResult =
-                      CompareFunction(ArrayBase + (SmallerIndex * ElementSize),
-                                      LastElement);
-
-            if (CompareResult >= 0) {
-                break;
-            }
+        Middle = (Count / 2) * ElementSize;
+        if (Count > QSORT_NINTHER_THRESHOLD) {
+            ClpQuickSortSort3(Context,
+                              Begin,
+                              Begin + Middle,
+                              End - ElementSize);
+
+            ClpQuickSortSort3(Context,
+                              Begin + ElementSize,
+                              Begin + Middle - ElementSize,
+                              End - (2 * ElementSize));
+
+            ClpQuickSortSort3(Context,
+                              Begin + (2 * ElementSize),
+                              Begin + Middle + ElementSize,
+                              End - (3 * ElementSize));
+
+            ClpQuickSortSort3(Context,
+                              Begin + Middle - ElementSize,
+                              Begin + Middle,
+                              Begin + Middle + ElementSize);
+
+            QSORT_SWAP(Context, Begin, Begin + Middle);
+
+        } else {
+            ClpQuickSortSort3(Context,
+                              Begin + Middle,
+                              Begin,
+                              End - ElementSize);
         }
 
         //
-        // Scan down as long as the current value is greater than the last
-        // value.
+        // If the element before this range is equal to the pivot, then every
+        // element equal to the pivot can be put on the left and never looked
+        // at again. This makes runs of equal elements linear.
         //
 
-        while (TRUE) {
-            LargerIndex -= 1;
-            CompareResult =
-                      CompareFunction(LastElement,
-                                      ArrayBase + (LargerIndex * ElementSize));
+        if ((Leftmost == FALSE) &&
+            (QSORT_LESS(Context, Begin - ElementSize, Begin) == 0)) {
 
-            if (CompareResult >= 0) {
-                break;
-            }
+            Begin = ClpQuickSortPartitionLeft(Context, Begin, End) +
+                    ElementSize;
 
-            if (LargerIndex == StartIndex) {
-                break;
-            }
+            continue;
         }
 
-        //
-        // Stop if the paths crossed, as that means everything's on the correct
-        // side of the pivot if the pivot were here.
-        //
+        Pivot = ClpQuickSortPartitionRight(Context,
+                                           Begin,
+                                           End,
+                                           &AlreadyPartitioned);
 
-        if (SmallerIndex >= LargerIndex) {
-            break;
+        LeftCount = (Pivot - Begin) / ElementSize;
+        RightCount = (End - (Pivot + ElementSize)) / ElementSize;
+        HighlyUnbalanced = FALSE;
+        if ((LeftCount < Count / 8) || (RightCount < Count / 8)) {
+            HighlyUnbalanced = TRUE;
         }
 
         //
-        // Exchange the two, as they're both on the wrong side of the pivot.
+        // If the partition was badly lopsided, shuffle some elements around to
+        // break up whatever pattern caused it. Too many of these and the
+        // input is adversarial, so fall back to heapsort.
         //
 
-        if (SmallerIndex != LargerIndex) {
-            QUICKSORT_SWAP(ArrayBase, ElementSize, SmallerIndex, LargerIndex);
-        }
+        if (HighlyUnbalanced != FALSE) {
+            BadAllowed -= 1;
+            if (BadAllowed == 0) {
+                ClpQuickSortHeapSort(Context, Begin, End);
+                return;
+            }
+
+            ClpQuickSortBreakPatterns(Context, Begin, Pivot);
+            ClpQuickSortBreakPatterns(Context, Pivot + ElementSize, End);
 
         //
-        // Move keys equal to the partitioning element over to the ends of the
-        // arrays. This is the beginning of what's called Bentley-McIlroy 3-way
-        // partitioning, and it helps to handle an array with lots of
-        // elements equal to the pivot. So the array is going to look like this:
-        // | equal | less |  xxx (unsorted)  | greater | equal |
-        // At the end, swap the equals to the center so that it looks like:
-        // | less | equal | greater |
-        // This has the benefit that it always uses N - 1 three way compares,
-        // there's no extra overhead if there are no equal keys, and only one
-        // extra exchange per equal key.
+        // If the partition was balanced and didn't move anything, the range
+        // may well already be sorted. Try to finish it off cheaply.
         //
 
-        CompareResult =
-                      CompareFunction(ArrayBase + (SmallerIndex * ElementSize),
-                                      LastElement);
+        } else if ((AlreadyPartitioned != FALSE) &&
+                   (ClpQuickSortPartialInsertionSort(Context,
+                                                     Begin,
+                                                     Pivot) != FALSE) &&
+                   (ClpQuickSortPartialInsertionSort(Context,
+                                                     Pivot + ElementSize,
+                                                     End) != FALSE)) {
 
-        if (CompareResult == 0) {
-            SmallestIndex += 1;
-            QUICKSORT_SWAP(ArrayBase, ElementSize, SmallestIndex, SmallerIndex);
+            return;
         }
 
-        CompareResult =
-                      CompareFunction(LastElement,
-                                      ArrayBase + (LargerIndex * ElementSize));
+        //
+        // Recurse on the smaller side and loop on the larger one.
+        //
+
+        if (LeftCount < RightCount) {
+            ClpQuickSortLoop(Context, Begin, Pivot, BadAllowed, Leftmost);
+            Begin = Pivot + ElementSize;
+            Leftmost = FALSE;
 
-        if (CompareResult == 0) {
-            LargestIndex -= 1;
-            QUICKSORT_SWAP(ArrayBase, ElementSize, LargerIndex, LargestIndex);
+        } else {
+            ClpQuickSortLoop(Context,
+                             Pivot + ElementSize,
+                             End,
+                             BadAllowed,
+                             FALSE);
+
+            End = Pivot;
         }
     }
 
+    return;
+}
+
+char *
+ClpQuickSortPartitionRight (
+    PQUICKSORT_CONTEXT Context,
+    char *Begin,
+    char *End,
+    PBOOL AlreadyPartitioned
+    )
+
+/*++
+
+Routine Description:
+
+    This routine partitions a range around the pivot at its beginning.
+    Elements less than the pivot end up to its left, and elements greater
+    than or equal to it end up to its right.
+
+Arguments:
+
+    Context - Supplies a pointer to the sort context.
+
+    Begin - Supplies a pointer to the first element of the range, which is
+        the pivot.
+
+    End - Supplies a pointer one element beyond the end of the range.
+
+    AlreadyPartitioned - Supplies a pointer where a boolean will be returned
+        indicating whether the range was already partitioned, meaning no
+        elements needed to be exchanged.
+
+Return Value:
+
+    Returns a pointer to the final position of the pivot.
+
+--*/
+
+{
+
+    size_t ElementSize;
+    char *First;
+    char *Last;
+    char *Pivot;
+
+    ElementSize = Context->ElementSize;
+    First = Begin;
+    Last = End;
+
     //
-    // Put the pivot into place.
+    // Find the first element greater than or equal to the pivot. The pivot
+    // selection guarantees one exists.
     //
 
-    QUICKSORT_SWAP(ArrayBase, ElementSize, SmallerIndex, EndIndex);
+    do {
+        First += ElementSize;
+
+    } while (QSORT_LESS(Context, First, Begin));
 
     //
-    // Move lower equal elements back up to the middle, and remove them from
-    // the partition of things that need to be resorted.
+    // Find the last element less than the pivot. If no elements were less
+    // than the pivot on the left, this scan needs a bounds check.
     //
 
-    LargerIndex = SmallerIndex + 1;
-    SmallerIndex -= 1;
-    for (EqualIndex = StartIndex; EqualIndex < SmallestIndex; EqualIndex += 1) {
-        QUICKSORT_SWAP(ArrayBase,
-                       ElementSize,
-                       EqualIndex,
-                       SmallerIndex);
+    if (First - ElementSize == Begin) {
+        while (First < Last) {
+            Last -= ElementSize;
+            if (QSORT_LESS(Context, Last, Begin)) {
+                break;
+            }
+        }
+
+    } else {
+        do {
+            Last -= ElementSize;
 
-        SmallerIndex -= 1;
+        } while (!QSORT_LESS(Context, Last, Begin));
+    }
+
+    *AlreadyPartitioned = FALSE;
+    if (First >= Last) {
+        *AlreadyPartitioned = TRUE;
     }
 
     //
-    // Move upper equal elements back down to the middle, and remove them from
-    // the partition of things that need to be resorted.
+    // Keep exchanging elements that are on the wrong side. The previous
+    // exchange guarantees the scans stay in bounds.
     //
 
-    for (EqualIndex = EndIndex - 1;
-         EqualIndex > LargestIndex;
-         EqualIndex -= 1) {
+    while (First < Last) {
+        QSORT_SWAP(Context, First, Last);
+        do {
+            First += ElementSize;
+
+        } while (QSORT_LESS(Context, First, Begin));
+
+        do {
+            Last -= ElementSize;
 
-        QUICKSORT_SWAP(ArrayBase,
-                       ElementSize,
-                       LargerIndex,
-                       EqualIndex);
+        } while (!QSORT_LESS(Context, Last, Begin));
+    }
+
+    //
+    // Put the pivot in its final place.
+    //
 
-        LargerIndex += 1;
+    Pivot = First - ElementSize;
+    if (Pivot != Begin) {
+        QSORT_SWAP(Context, Begin, Pivot);
     }
 
+    return Pivot;
+}
+
+char *
+ClpQuickSortPartitionLeft (
+    PQUICKSORT_CONTEXT Context,
+    char *Begin,
+    char *End
+    )
+
+/*++
+
+Routine Description:
+
+    This routine partitions a range around the pivot at its beginning, putting
+    elements equal to the pivot on the left. This is used when the pivot is
+    known to be equal to the element before the range, in which case the
+    whole left side is equal and needs no further sorting.
+
+Arguments:
+
+    Context - Supplies a pointer to the sort context.
+
+    Begin - Supplies a pointer to the first element of the range, which is
+        the pivot.
+
+    End - Supplies a pointer one element beyond the end of the range.
+
+Return Value:
+
+    Returns a pointer to the final position of the pivot.
+
+--*/
+
+{
+
+    size_t ElementSize;
+    char *First;
+    char *Last;
+
+    ElementSize = Context->ElementSize;
+    First = Begin;
+    Last = End;
+
+    //
+    // Find the last element less than or equal to the pivot. The pivot itself
+    // stops the scan.
+    //
+
+    do {
+        Last -= ElementSize;
+
+    } while (QSORT_LESS(Context, Begin, Last));
+
     //
-    // Sort the bottom half and then the top half.
+    // Find the first element greater than the pivot.
     //
 
-    if (SmallerIndex > StartIndex) {
-        ClpQuickSort(ArrayBase,
-                     ElementSize,
-                     StartIndex,
-                     SmallerIndex,
-                     CompareFunction);
+    if (Last + ElementSize == End) {
+        while (First < Last) {
+            First += ElementSize;
+            if (QSORT_LESS(Context, Begin, First)) {
+                break;
+            }
+        }
+
+    } else {
+        do {
+            First += ElementSize;
+
+        } while (!QSORT_LESS(Context, Begin, First));
+    }
+
+    while (First < Last) {
+        QSORT_SWAP(Context, First, Last);
+        do {
+            Last -= ElementSize;
+
+        } while (QSORT_LESS(Context, Begin, Last));
+
+        do {
+            First += ElementSize;
+
+        } while (!QSORT_LESS(Context, Begin, First));
+    }
+
+    if (Last != Begin) {
+        QSORT_SWAP(Context, Begin, Last);
+    }
+
+    return Last;
+}
+
+VOID
+ClpQuickSortBreakPatterns (
+    PQUICKSORT_CONTEXT Context,
+    char *Begin,
+    char *End
+    )
+
+/*++
+
+Routine Description:
+
+    This routine swaps a few elements around in a range after a badly
+    unbalanced partition, so that the next pivot choice is unlikely to hit
+    the same pattern.
+
+Arguments:
+
+    Context - Supplies a pointer to the sort context.
+
+    Begin - Supplies a pointer to the first element of the range.
+
+    End - Supplies a pointer one element beyond the end of the range.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    size_t Count;
+    size_t ElementSize;
+    size_t Quarter;
+
+    ElementSize = Context->ElementSize;
+    Count = (End - Begin) / ElementSize;
+    if (Count < QSORT_INSERTION_SORT_THRESHOLD) {
+        return;
     }
 
-    if (EndIndex > LargerIndex) {
-        ClpQuickSort(ArrayBase,
-                     ElementSize,
-                     LargerIndex,
-                     EndIndex,
-                     CompareFunction);
+    Quarter = (Count / 4) * ElementSize;
+    QSORT_SWAP(Context, Begin, Begin + Quarter);
+    QSORT_SWAP(Context, End - ElementSize, End - Quarter);
+    if (Count > QSORT_NINTHER_THRESHOLD) {
+        QSORT_SWAP(Context,
+                   Begin + ElementSize,
+                   Begin + Quarter + ElementSize);
+
+        QSORT_SWAP(Context,
+                   Begin + (2 * ElementSize),
+                   Begin + Quarter + (2 * ElementSize));
+
+        QSORT_SWAP(Context,
+                   End - (2 * ElementSize),
+                   End - Quarter - ElementSize);
+
+        QSORT_SWAP(Context,
+                   End - (3 * ElementSize),
+                   End - Quarter - (2 * ElementSize));
     }
 
     return;
 }
 
 VOID
-ClpQuickSortSwap (
-    void *ArrayBase,
-    size_t ElementSize,
-    ssize_t FirstIndex,
-    ssize_t SecondIndex
+ClpQuickSortInsertionSort (
+    PQUICKSORT_CONTEXT Context,
+    char *Begin,
+    char *End,
+    BOOL Guarded
     )
 
 /*++
 
 Routine Description:
 
-    This routine swaps two elements in the given array.
+    This routine sorts a small range with an insertion sort.
 
 Arguments:
 
-    ArrayBase - Supplies a pointer to the array of items that will get pushed
-        around.
+    Context - Supplies a pointer to the sort context.
 
-    ElementSize - Supplies the size of one of the elements.
+    Begin - Supplies a pointer to the first element of the range.
 
-    FirstIndex - Supplies the first index of the indices to exchange.
+    End - Supplies a pointer one element beyond the end of the range.
 
-    SecondIndex - Supplies the second index of the indices to exchange.
+    Guarded - Supplies a boolean indicating whether the scan needs to check
+        against the beginning of the range. If FALSE, the element before the
+        range must be less than or equal to every element in the range.
 
 Return Value:
 
@@ -414,17 +907,299 @@ Return Value:
 
 {
 
-    ssize_t ByteIndex;
-    unsigned char *FirstElement;
-    unsigned char *SecondElement;
+    char *Current;
+    size_t ElementSize;
+    char *Sift;
+
+    ElementSize = Context->ElementSize;
+    for (Current = Begin + ElementSize; Current < End; Current += ElementSize) {
+        Sift = Current;
+        while (((Guarded == FALSE) || (Sift != Begin)) &&
+               (QSORT_LESS(Context, Sift, Sift - ElementSize))) {
+
+            QSORT_SWAP(Context, Sift, Sift - ElementSize);
+            Sift -= ElementSize;
+        }
+    }
+
+    return;
+}
+
+BOOL
+ClpQuickSortPartialInsertionSort (
+    PQUICKSORT_CONTEXT Context,
+    char *Begin,
+    char *End
+    )
+
+/*++
+
+Routine Description:
+
+    This routine attempts to insertion sort a range that is probably already
+    sorted, giving up if it turns out to require too many moves.
+
+Arguments:
+
+    Context - Supplies a pointer to the sort context.
+
+    Begin - Supplies a pointer to the first element of the range.
+
+    End - Supplies a pointer one element beyond the end of the range.
+
+Return Value:
+
+    TRUE if the range is now sorted.
+
+    FALSE if the attempt was abandoned. The range is left in some permutation
+    of its original order.
+
+--*/
+
+{
+
+    char *Current;
+    size_t ElementSize;
+    ULONG Moves;
+    char *Sift;
+
+    ElementSize = Context->ElementSize;
+    Moves = 0;
+    for (Current = Begin + ElementSize; Current < End; Current += ElementSize) {
+        Sift = Current;
+        while ((Sift != Begin) &&
+               (QSORT_LESS(Context, Sift, Sift - ElementSize))) {
+
+            QSORT_SWAP(Context, Sift, Sift - ElementSize);
+            Sift -= ElementSize;
+            Moves += 1;
+        }
+
+        if (Moves > QSORT_PARTIAL_INSERTION_SORT_LIMIT) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+VOID
+ClpQuickSortHeapSort (
+    PQUICKSORT_CONTEXT Context,
+    char *Begin,
+    char *End
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sorts a range with heapsort. This is the fallback that
+    guarantees O(n log n) behavior against adversarial inputs.
+
+Arguments:
+
+    Context - Supplies a pointer to the sort context.
+
+    Begin - Supplies a pointer to the first element of the range.
+
+    End - Supplies a pointer one element beyond the end of the range.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    size_t Count;
+    size_t ElementSize;
+    size_t Index;
+
+    ElementSize = Context->ElementSize;
+    Count = (End - Begin) / ElementSize;
+    for (Index = Count / 2; Index > 0; Index -= 1) {
+        ClpQuickSortSiftDown(Context, Begin, Index - 1, Count);
+    }
+
+    for (Index = Count - 1; Index > 0; Index -= 1) {
+        QSORT_SWAP(Context, Begin, Begin + (Index * ElementSize));
+        ClpQuickSortSiftDown(Context, Begin, 0, Index);
+    }
+
+    return;
+}
+
+VOID
+ClpQuickSortSiftDown (
+    PQUICKSORT_CONTEXT Context,
+    char *Base,
+    size_t Root,
+    size_t Count
+    )
+
+/*++
+
+Routine Description:
+
+    This routine moves an element down a max-heap until the heap property is
+    restored.
+
+Arguments:
+
+    Context - Supplies a pointer to the sort context.
+
+    Base - Supplies a pointer to the start of the heap.
+
+    Root - Supplies the index of the element to sift down.
+
+    Count - Supplies the number of elements in the heap.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    size_t Child;
+    size_t ElementSize;
+
+    ElementSize = Context->ElementSize;
+    while (TRUE) {
+        Child = (Root * 2) + 1;
+        if (Child >= Count) {
+            break;
+        }
+
+        if ((Child + 1 < Count) &&
+            (QSORT_LESS(Context,
+                        Base + (Child * ElementSize),
+                        Base + ((Child + 1) * ElementSize)))) {
+
+            Child += 1;
+        }
+
+        if (!QSORT_LESS(Context,
+                        Base + (Root * ElementSize),
+                        Base + (Child * ElementSize))) {
+
+            break;
+        }
+
+        QSORT_SWAP(Context,
+                   Base + (Root * ElementSize),
+                   Base + (Child * ElementSize));
+
+        Root = Child;
+    }
+
+    return;
+}
+
+VOID
+ClpQuickSortSort3 (
+    PQUICKSORT_CONTEXT Context,
+    char *First,
+    char *Second,
+    char *Third
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sorts three elements in place, leaving the median in the
+    second position.
+
+Arguments:
+
+    Context - Supplies a pointer to the sort context.
+
+    First - Supplies a pointer to the element that should end up smallest.
+
+    Second - Supplies a pointer to the element that should end up the median.
+
+    Third - Supplies a pointer to the element that should end up largest.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    if (QSORT_LESS(Context, Second, First)) {
+        QSORT_SWAP(Context, First, Second);
+    }
+
+    if (QSORT_LESS(Context, Third, Second)) {
+        QSORT_SWAP(Context, Second, Third);
+        if (QSORT_LESS(Context, Second, First)) {
+            QSORT_SWAP(Context, First, Second);
+        }
+    }
+
+    return;
+}
+
+VOID
+ClpQuickSortSwap (
+    PQUICKSORT_CONTEXT Context,
+    char *First,
+    char *Second
+    )
+
+/*++
+
+Routine Description:
+
+    This routine swaps two elements, a word at a time if the context allows
+    it.
+
+Arguments:
+
+    Context - Supplies a pointer to the sort context.
+
+    First - Supplies a pointer to the first element to exchange.
+
+    Second - Supplies a pointer to the second element to exchange.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    size_t Index;
+    long *FirstWord;
+    long *SecondWord;
     unsigned char Swap;
+    long SwapWord;
 
-    FirstElement = (unsigned char *)ArrayBase + (ElementSize * FirstIndex);
-    SecondElement = (unsigned char *)ArrayBase + (ElementSize * SecondIndex);
-    for (ByteIndex = 0; ByteIndex < ElementSize; ByteIndex += 1) {
-        Swap = FirstElement[ByteIndex];
-        FirstElement[ByteIndex] = SecondElement[ByteIndex];
-        SecondElement[ByteIndex] = Swap;
+    if (Context->SwapType == QuickSortSwapBytes) {
+        for (Index = 0; Index < Context->ElementSize; Index += 1) {
+            Swap = First[Index];
+            First[Index] = Second[Index];
+            Second[Index] = Swap;
+        }
+
+    } else {
+        FirstWord = (long *)First;
+        SecondWord = (long *)Second;
+        for (Index = 0;
+             Index < Context->ElementSize / sizeof(long);
+             Index += 1) {
+
+            SwapWord = FirstWord[Index];
+            FirstWord[Index] = SecondWord[Index];
+            SecondWord[Index] = SwapWord;
+        }
     }
 
     return;
@@ -0,0 +1,506 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    qsortpar.c
+
+Abstract:
+
+    This module implements a parallel version of the QuickSort routine, which
+    sorts pieces of an array on separate threads and then merges them.
+
+Author:
+
+    agent 18-Oct-2026
+
+Environment:
+
+    User Mode C Library
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include "libcp.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// Define the minimum number of elements each thread is given. Below this the
+// cost of creating threads and merging outweighs the gain.
+//
+
+#define QSORT_PARALLEL_MINIMUM_ELEMENTS 8192
+
+//
+// Define the maximum number of threads a single sort will use.
+//
+
+#define QSORT_PARALLEL_MAX_THREADS 64
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+/*++
+
+Structure Description:
+
+    This structure stores a unit of work for a parallel sort: either sorting
+    one piece of the array in place, or merging two adjacent sorted runs into
+    the other buffer.
+
+Members:
+
+    Context - Stores a pointer to the shared sort context.
+
+    Source - Stores a pointer to the first element to sort, or the first
+        element of the left run to merge.
+
+    Destination - Stores a pointer where the merged runs should go, or NULL
+        if this work item is a sort.
+
+    LeftCount - Stores the number of elements to sort, or the number of
+        elements in the left run.
+
+    RightCount - Stores the number of elements in the right run, which
+        immediately follows the left run. This is unused for sorts.
+
+    Thread - Stores the thread doing the work.
+
+    ThreadCreated - Stores a boolean indicating whether a thread was created
+        for this work item. If not, the calling thread does it.
+
+--*/
+
+typedef struct _QSORT_PARALLEL_WORK {
+    PQUICKSORT_CONTEXT Context;
+    char *Source;
+    char *Destination;
+    size_t LeftCount;
+    size_t RightCount;
+    pthread_t Thread;
+    BOOL ThreadCreated;
+} QSORT_PARALLEL_WORK, *PQSORT_PARALLEL_WORK;
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+VOID
+ClpRunParallelSortWork (
+    PQSORT_PARALLEL_WORK Work,
+    size_t WorkCount
+    );
+
+void *
+ClpParallelSortThread (
+    void *Parameter
+    );
+
+VOID
+ClpMergeSortedRuns (
+    PQUICKSORT_CONTEXT Context,
+    char *Source,
+    char *Destination,
+    size_t LeftCount,
+    size_t RightCount
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+LIBC_API
+void
+qsort_parallel (
+    void *ArrayBase,
+    size_t ElementCount,
+    size_t ElementSize,
+    int (*CompareFunction)(const void *, const void *),
+    unsigned int ThreadCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sorts an array of items in place using multiple threads. The
+    array is split into pieces that are sorted concurrently, and the sorted
+    pieces are then merged. This is a Minoca extension. Small arrays, or
+    cases where memory or threads cannot be had, are sorted by the calling
+    thread with qsort. Unlike qsort, the compare function may be called from
+    several threads at once.
+
+Arguments:
+
+    ArrayBase - Supplies a pointer to the array of items that will get pushed
+        around.
+
+    ElementCount - Supplies the number of elements in the array.
+
+    ElementSize - Supplies the size of one of the elements.
+
+    CompareFunction - Supplies a pointer to a function that will be used to
+        compare elements, with the same semantics as for qsort.
+
+    ThreadCount - Supplies the maximum number of threads to sort with,
+        including the calling thread. Supply 0 to use one thread per online
+        processor.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    QUICKSORT_CONTEXT Context;
+    char *Destination;
+    long ProcessorCount;
+    size_t RunCount;
+    size_t RunIndex;
+    size_t *RunStart;
+    char *Scratch;
+    char *Source;
+    char *Swap;
+    PQSORT_PARALLEL_WORK Work;
+    size_t WorkCount;
+
+    assert(ElementCount < (((size_t)-1) >> 1));
+    assert(ElementSize < (((size_t)-1) >> 1));
+
+    RunStart = NULL;
+    Scratch = NULL;
+    Work = NULL;
+    if (ThreadCount == 0) {
+        ProcessorCount = sysconf(_SC_NPROCESSORS_ONLN);
+        ThreadCount = 1;
+        if (ProcessorCount > 1) {
+            ThreadCount = ProcessorCount;
+        }
+    }
+
+    if (ThreadCount > QSORT_PARALLEL_MAX_THREADS) {
+        ThreadCount = QSORT_PARALLEL_MAX_THREADS;
+    }
+
+    RunCount = ElementCount / QSORT_PARALLEL_MINIMUM_ELEMENTS;
+    if (RunCount > ThreadCount) {
+        RunCount = ThreadCount;
+    }
+
+    if ((RunCount <= 1) || (ElementSize == 0)) {
+        qsort(ArrayBase, ElementCount, ElementSize, CompareFunction);
+        return;
+    }
+
+    Scratch = malloc(ElementCount * ElementSize);
+    RunStart = malloc((RunCount + 1) * sizeof(size_t));
+    Work = malloc(RunCount * sizeof(QSORT_PARALLEL_WORK));
+    if ((Scratch == NULL) || (RunStart == NULL) || (Work == NULL)) {
+        qsort(ArrayBase, ElementCount, ElementSize, CompareFunction);
+        goto ParallelSortEnd;
+    }
+
+    ClpInitializeQuickSortContext(&Context,
+                                  ArrayBase,
+                                  ElementSize,
+                                  CompareFunction,
+                                  NULL,
+                                  NULL);
+
+    //
+    // Carve the array into evenly sized runs and sort each one.
+    //
+
+    for (RunIndex = 0; RunIndex < RunCount; RunIndex += 1) {
+        RunStart[RunIndex] = (ElementCount / RunCount) * RunIndex;
+    }
+
+    RunStart[RunCount] = ElementCount;
+    for (RunIndex = 0; RunIndex < RunCount; RunIndex += 1) {
+        Work[RunIndex].Context = &Context;
+        Work[RunIndex].Source = (char *)ArrayBase +
+                                (RunStart[RunIndex] * ElementSize);
+
+        Work[RunIndex].Destination = NULL;
+        Work[RunIndex].LeftCount = RunStart[RunIndex + 1] - RunStart[RunIndex];
+        Work[RunIndex].RightCount = 0;
+    }
+
+    ClpRunParallelSortWork(Work, RunCount);
+
+    //
+    // Merge adjacent pairs of runs back and forth between the array and the
+    // scratch buffer until there's only one run left. Each pass halves the
+    // number of runs, and the merges within a pass run in parallel.
+    //
+
+    Source = ArrayBase;
+    Destination = Scratch;
+    while (RunCount > 1) {
+        WorkCount = 0;
+        for (RunIndex = 0; RunIndex < RunCount; RunIndex += 2) {
+            Work[WorkCount].Context = &Context;
+            Work[WorkCount].Source = Source +
+                                     (RunStart[RunIndex] * ElementSize);
+
+            Work[WorkCount].Destination = Destination +
+                                          (RunStart[RunIndex] * ElementSize);
+
+            Work[WorkCount].LeftCount = RunStart[RunIndex + 1] -
+                                        RunStart[RunIndex];
+
+            //
+            // An odd run out at the end just gets copied across.
+            //
+
+            Work[WorkCount].RightCount = 0;
+            if (RunIndex + 1 < RunCount) {
+                Work[WorkCount].RightCount = RunStart[RunIndex + 2] -
+                                             RunStart[RunIndex + 1];
+            }
+
+            RunStart[WorkCount] = RunStart[RunIndex];
+            WorkCount += 1;
+        }
+
+        RunStart[WorkCount] = ElementCount;
+        ClpRunParallelSortWork(Work, WorkCount);
+        RunCount = WorkCount;
+        Swap = Source;
+        Source = Destination;
+        Destination = Swap;
+    }
+
+    if (Source != ArrayBase) {
+        memcpy(ArrayBase, Source, ElementCount * ElementSize);
+    }
+
+ParallelSortEnd:
+    if (Scratch != NULL) {
+        free(Scratch);
+    }
+
+    if (RunStart != NULL) {
+        free(RunStart);
+    }
+
+    if (Work != NULL) {
+        free(Work);
+    }
+
+    return;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+VOID
+ClpRunParallelSortWork (
+    PQSORT_PARALLEL_WORK Work,
+    size_t WorkCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine performs a set of independent work items, handing all but
+    the first to new threads and waiting for them all to finish. Any work
+    item that doesn't get a thread is done by the calling thread.
+
+Arguments:
+
+    Work - Supplies a pointer to the array of work items.
+
+    WorkCount - Supplies the number of work items.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    size_t Index;
+    int Status;
+
+    for (Index = 0; Index < WorkCount; Index += 1) {
+        Work[Index].ThreadCreated = FALSE;
+        if (Index != 0) {
+            Status = pthread_create(&(Work[Index].Thread),
+                                    NULL,
+                                    ClpParallelSortThread,
+                                    &(Work[Index]));
+
+            if (Status == 0) {
+                Work[Index].ThreadCreated = TRUE;
+            }
+        }
+    }
+
+    for (Index = 0; Index < WorkCount; Index += 1) {
+        if (Work[Index].ThreadCreated == FALSE) {
+            ClpParallelSortThread(&(Work[Index]));
+        }
+    }
+
+    for (Index = 0; Index < WorkCount; Index += 1) {
+        if (Work[Index].ThreadCreated != FALSE) {
+            pthread_join(Work[Index].Thread, NULL);
+        }
+    }
+
+    return;
+}
+
+void *
+ClpParallelSortThread (
+    void *Parameter
+    )
+
+/*++
+
+Routine Description:
+
+    This routine performs a single parallel sort work item. It is the entry
+    point for the sort worker threads.
+
+Arguments:
+
+    Parameter - Supplies a pointer to the work item.
+
+Return Value:
+
+    NULL always.
+
+--*/
+
+{
+
+    PQSORT_PARALLEL_WORK Work;
+
+    Work = Parameter;
+    if (Work->Destination == NULL) {
+        ClpQuickSortArray(Work->Context, Work->Source, Work->LeftCount);
+
+    } else {
+        ClpMergeSortedRuns(Work->Context,
+                           Work->Source,
+                           Work->Destination,
+                           Work->LeftCount,
+                           Work->RightCount);
+    }
+
+    return NULL;
+}
+
+VOID
+ClpMergeSortedRuns (
+    PQUICKSORT_CONTEXT Context,
+    char *Source,
+    char *Destination,
+    size_t LeftCount,
+    size_t RightCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine merges two adjacent sorted runs into a destination buffer.
+    Ties are taken from the left run first.
+
+Arguments:
+
+    Context - Supplies a pointer to the sort context.
+
+    Source - Supplies a pointer to the left run. The right run immediately
+        follows it.
+
+    Destination - Supplies a pointer where the merged elements will be
+        written. This must not overlap the source.
+
+    LeftCount - Supplies the number of elements in the left run.
+
+    RightCount - Supplies the number of elements in the right run.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    size_t ElementSize;
+    char *Left;
+    char *LeftEnd;
+    char *Right;
+    char *RightEnd;
+
+    ElementSize = Context->ElementSize;
+    Left = Source;
+    LeftEnd = Source + (LeftCount * ElementSize);
+    Right = LeftEnd;
+    RightEnd = Right + (RightCount * ElementSize);
+
+    //
+    // If the runs are already in order, there's nothing to merge.
+    //
+
+    if ((LeftCount == 0) || (RightCount == 0) ||
+        (Context->CompareFunction(Right, LeftEnd - ElementSize) >= 0)) {
+
+        memcpy(Destination, Source, (LeftCount + RightCount) * ElementSize);
+        return;
+    }
+
+    while ((Left < LeftEnd) && (Right < RightEnd)) {
+        if (Context->CompareFunction(Right, Left) < 0) {
+            memcpy(Destination, Right, ElementSize);
+            Right += ElementSize;
+
+        } else {
+            memcpy(Destination, Left, ElementSize);
+            Left += ElementSize;
+        }
+
+        Destination += ElementSize;
+    }
+
+    if (Left < LeftEnd) {
+        memcpy(Destination, Left, LeftEnd - Left);
+
+    } else if (Right < RightEnd) {
+        memcpy(Destination, Right, RightEnd - Right);
+    }
+
+    return;
+}
+
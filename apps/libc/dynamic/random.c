@@ -33,6 +33,7 @@ Module Name:
 #include "libcp.h"
 #include <errno.h>
 #include <stdlib.h>
+#include <sys/random.h>
 
 //
 // ---------------------------------------------------------------- Definitions
@@ -567,6 +568,67 @@ Return Value:
     return 0;
 }
 
+LIBC_API
+ssize_t
+getrandom (
+    void *Buffer,
+    size_t Size,
+    unsigned int Flags
+    )
+
+/*++
+
+Routine Description:
+
+    This routine fills a buffer with random data from the kernel, without
+    needing to open the random device.
+
+Arguments:
+
+    Buffer - Supplies a pointer where the random data will be returned.
+
+    Size - Supplies the number of bytes of random data requested.
+
+    Flags - Supplies a bitfield of flags. See GRND_* definitions.
+
+Return Value:
+
+    Returns the number of bytes returned on success. This may be less than the
+    requested size for very large requests.
+
+    -1 on failure, and errno will be set to contain more information.
+
+--*/
+
+{
+
+    UINTN BytesCompleted;
+    ULONG KernelFlags;
+    KSTATUS Status;
+
+    if ((Flags & ~(GRND_NONBLOCK | GRND_RANDOM)) != 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    KernelFlags = 0;
+    if ((Flags & GRND_NONBLOCK) != 0) {
+        KernelFlags |= SYS_RANDOM_FLAG_NON_BLOCKING;
+    }
+
+    if ((Flags & GRND_RANDOM) != 0) {
+        KernelFlags |= SYS_RANDOM_FLAG_RANDOM;
+    }
+
+    Status = OsGetRandomBytes(Buffer, Size, KernelFlags, &BytesCompleted);
+    if (!KSUCCESS(Status)) {
+        errno = ClConvertKstatusToErrorNumber(Status);
+        return -1;
+    }
+
+    return (ssize_t)BytesCompleted;
+}
+
 //
 // --------------------------------------------------------- Internal Functions
 //
@@ -531,6 +531,11 @@ Return Value:
         goto CompileRegularExpressionEnd;
     }
 
+    Status = ClpCompileRegularExpressionProgram(Result);
+    if (Status != RegexStatusSuccess) {
+        goto CompileRegularExpressionEnd;
+    }
+
 CompileRegularExpressionEnd:
     if (Status != RegexStatusSuccess) {
         if (Result != NULL) {
@@ -582,6 +587,7 @@ Return Value:
         ClpDestroyRegularExpressionEntry(Entry);
     }
 
+    ClpDestroyRegularExpressionProgram(Expression->Program);
     free(Expression);
     return;
 }
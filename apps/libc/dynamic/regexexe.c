@@ -340,6 +340,22 @@ Return Value:
     ULONG StartIndex;
     REGULAR_EXPRESSION_STATUS Status;
 
+    //
+    // Expressions without back references are compiled into an automaton
+    // that runs in linear time. Only fall back to backtracking if that's not
+    // available.
+    //
+
+    if (RegularExpression->Program != NULL) {
+        Status = ClpExecuteRegularExpressionProgram(RegularExpression,
+                                                    String,
+                                                    Match,
+                                                    MatchArraySize,
+                                                    Flags);
+
+        return Status;
+    }
+
     Status = RegexStatusNoMatch;
     INITIALIZE_LIST_HEAD(&(Context.Choices));
     INITIALIZE_LIST_HEAD(&(Context.FreeChoices));
@@ -1333,14 +1349,7 @@ Return Value:
 
 {
 
-    PREGULAR_BRACKET_ENTRY BracketEntry;
-    PREGULAR_BRACKET_EXPRESSION BracketExpression;
     CHAR Character;
-    ULONG CharacterCount;
-    ULONG CharacterIndex;
-    PLIST_ENTRY CurrentEntry;
-    PSTR RegularCharacters;
-    REGULAR_EXPRESSION_STATUS Status;
 
     assert(Entry->Type == RegexEntryBracketExpression);
 
@@ -1353,6 +1362,60 @@ Return Value:
         return RegexStatusNoMatch;
     }
 
+    if (ClpRegularExpressionMatchBracketCharacter(Context->Expression,
+                                                  Entry,
+                                                  Character) == FALSE) {
+
+        return RegexStatusNoMatch;
+    }
+
+    Context->NextInput += 1;
+    return RegexStatusSuccess;
+}
+
+BOOL
+ClpRegularExpressionMatchBracketCharacter (
+    PREGULAR_EXPRESSION Expression,
+    PREGULAR_EXPRESSION_ENTRY Entry,
+    CHAR Character
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines if the given character is matched by a bracket
+    expression.
+
+Arguments:
+
+    Expression - Supplies a pointer to the regular expression.
+
+    Entry - Supplies a pointer to the bracket expression entry.
+
+    Character - Supplies the character to test.
+
+Return Value:
+
+    TRUE if the bracket expression (including its negation) matches the
+    character.
+
+    FALSE if the character does not match.
+
+--*/
+
+{
+
+    PREGULAR_BRACKET_ENTRY BracketEntry;
+    PREGULAR_BRACKET_EXPRESSION BracketExpression;
+    ULONG CharacterCount;
+    ULONG CharacterIndex;
+    PLIST_ENTRY CurrentEntry;
+    PSTR RegularCharacters;
+    REGULAR_EXPRESSION_STATUS Status;
+
+    assert(Entry->Type == RegexEntryBracketExpression);
+
     Status = RegexStatusNoMatch;
     BracketExpression = &(Entry->U.BracketExpression);
     CharacterCount = BracketExpression->RegularCharacters.Size;
@@ -1367,12 +1430,12 @@ Return Value:
          CharacterIndex += 1) {
 
         if ((Character == RegularCharacters[CharacterIndex]) ||
-            (((Context->Expression->Flags & REG_ICASE) != 0) &&
+            (((Expression->Flags & REG_ICASE) != 0) &&
               (tolower(Character) ==
                tolower(RegularCharacters[CharacterIndex])))) {
 
             Status = RegexStatusSuccess;
-            goto RegularExpressionMatchBracketExpressionEnd;
+            goto RegularExpressionMatchBracketCharacterEnd;
         }
     }
 
@@ -1441,7 +1504,7 @@ Return Value:
 
         case BracketExpressionCharacterClassLowercase:
             if ((islower(Character)) ||
-                (((Context->Expression->Flags & REG_ICASE) != 0) &&
+                (((Expression->Flags & REG_ICASE) != 0) &&
                  (isupper(Character)))) {
 
                 Status = RegexStatusSuccess;
@@ -1472,7 +1535,7 @@ Return Value:
 
         case BracketExpressionCharacterClassUppercase:
             if ((isupper(Character)) ||
-                (((Context->Expression->Flags & REG_ICASE) != 0) &&
+                (((Expression->Flags & REG_ICASE) != 0) &&
                  (islower(Character)))) {
 
                 Status = RegexStatusSuccess;
@@ -1498,7 +1561,7 @@ Return Value:
 
             assert(FALSE);
 
-            goto RegularExpressionMatchBracketExpressionEnd;
+            goto RegularExpressionMatchBracketCharacterEnd;
         }
 
         if (Status == RegexStatusSuccess) {
@@ -1506,7 +1569,7 @@ Return Value:
         }
     }
 
-RegularExpressionMatchBracketExpressionEnd:
+RegularExpressionMatchBracketCharacterEnd:
     if ((Entry->Flags & REGULAR_EXPRESSION_NEGATED) != 0) {
         if (Status == RegexStatusNoMatch) {
             Status = RegexStatusSuccess;
@@ -1517,10 +1580,10 @@ Return Value:
     }
 
     if (Status == RegexStatusSuccess) {
-        Context->NextInput += 1;
+        return TRUE;
     }
 
-    return Status;
+    return FALSE;
 }
 
 VOID
@@ -0,0 +1,2571 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    regexnfa.c
+
+Abstract:
+
+    This module implements the linear time execution engine for regular
+    expressions. Expressions without back references are compiled into a
+    Thompson NFA program. Existence of a match is decided by a DFA built
+    lazily from the program and cached across executions, and match positions
+    are recovered with a Pike VM that follows the same leftmost, greedy
+    priority order as the backtracking matcher.
+
+Author:
+
+    agent 18-Oct-2026
+
+Environment:
+
+    User Mode C Library
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#define LIBC_API __DLLEXPORT
+
+#include <minoca/lib/types.h>
+#include <minoca/lib/status.h>
+#include <minoca/lib/rtl.h>
+
+#include <assert.h>
+#include <ctype.h>
+#include <regex.h>
+#include <stdlib.h>
+#include <string.h>
+#include "regexp.h"
+
+//
+// --------------------------------------------------------------------- Macros
+//
+
+//
+// This macro determines if the given byte is in the given program set.
+//
+
+#define REGEX_SET_CONTAINS(_Program, _Set, _Byte)                        \
+    (((_Program)->Sets[((_Set) * REGEX_SET_SIZE) + ((_Byte) >> 3)] &      \
+      (1 << ((_Byte) & 0x7))) != 0)
+
+//
+// This macro adds the given byte to the given set bitmap.
+//
+
+#define REGEX_SET_ADD(_Bitmap, _Byte) \
+    ((_Bitmap)[(_Byte) >> 3] |= (1 << ((_Byte) & 0x7)))
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// Define the number of bytes in a set bitmap, one bit for each byte value.
+//
+
+#define REGEX_SET_SIZE (256 / 8)
+
+//
+// Define the maximum number of instructions in a program. Larger expressions
+// (usually caused by large counted repeats) use the backtracking matcher.
+//
+
+#define REGEX_PROGRAM_MAX_INSTRUCTIONS 4096
+
+//
+// Define the initial capacity of a program's instruction and set arrays.
+//
+
+#define REGEX_PROGRAM_INITIAL_CAPACITY 32
+
+//
+// Define the assertion types for assert instructions.
+//
+
+#define REGEX_ASSERT_BEGIN_LINE 1
+#define REGEX_ASSERT_END_LINE 2
+#define REGEX_ASSERT_START_WORD 3
+#define REGEX_ASSERT_END_WORD 4
+
+//
+// Define the bits describing the context around a position in the input.
+// Assertions are evaluated against these.
+//
+
+#define REGEX_CONTEXT_PREVIOUS_LINE 0x00000001
+#define REGEX_CONTEXT_PREVIOUS_WORD 0x00000002
+#define REGEX_CONTEXT_NEXT_LINE 0x00000004
+#define REGEX_CONTEXT_NEXT_WORD 0x00000008
+
+#define REGEX_CONTEXT_PREVIOUS_MASK \
+    (REGEX_CONTEXT_PREVIOUS_LINE | REGEX_CONTEXT_PREVIOUS_WORD)
+
+//
+// Define the DFA state flag indicating that a new match attempt is started at
+// the position following this state. This is set for all states of
+// unanchored expressions.
+//
+
+#define REGEX_DFA_STATE_SEARCH 0x00000010
+
+//
+// Define the maximum number of DFA states cached before the cache is flushed,
+// and the size of the state hash table.
+//
+
+#define REGEX_DFA_MAX_STATES 256
+#define REGEX_DFA_HASH_SIZE 256
+
+//
+// Define the number of times the DFA cache can be flushed during a single
+// execution before the DFA is abandoned in favor of the Pike VM.
+//
+
+#define REGEX_DFA_MAX_FLUSHES 4
+
+//
+// Define the bit set in a DFA transition if a match ends at the position
+// before the transition.
+//
+
+#define REGEX_DFA_TRANSITION_MATCH 0x80000000
+
+//
+// Define the values for the end of input transitions. Zero means the
+// transition hasn't been computed yet.
+//
+
+#define REGEX_DFA_END_NO_MATCH 1
+#define REGEX_DFA_END_MATCH 2
+
+//
+// Define the number of extra transitions stored per state for the end of the
+// input, one with REG_NOTEOL clear and one with it set.
+//
+
+#define REGEX_DFA_END_TRANSITIONS 2
+
+//
+// Define the value used in the Pike VM stack to indicate an entry that
+// restores a capture slot rather than one that visits an instruction.
+//
+
+#define REGEX_PIKE_RESTORE ((ULONG)-1)
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+typedef enum _REGEX_OPCODE {
+    RegexOpInvalid,
+    RegexOpSet,
+    RegexOpSplit,
+    RegexOpJump,
+    RegexOpSave,
+    RegexOpAssert,
+    RegexOpMatch
+} REGEX_OPCODE, *PREGEX_OPCODE;
+
+/*++
+
+Structure Description:
+
+    This structure defines a single NFA program instruction.
+
+Members:
+
+    Opcode - Stores the type of instruction.
+
+    Argument - Stores the set index for set instructions, the preferred target
+        for split instructions, the target for jumps, the capture slot for
+        saves, and the assertion type for asserts.
+
+    Argument2 - Stores the alternate target for split instructions.
+
+--*/
+
+typedef struct _REGEX_INSTRUCTION {
+    REGEX_OPCODE Opcode;
+    ULONG Argument;
+    ULONG Argument2;
+} REGEX_INSTRUCTION, *PREGEX_INSTRUCTION;
+
+/*++
+
+Structure Description:
+
+    This structure defines a cached lazy DFA state.
+
+Members:
+
+    Hash - Stores the hash of the state's flags and kernel.
+
+    Flags - Stores the previous character context bits and the search flag.
+
+    KernelOffset - Stores the index into the kernel pool where this state's
+        sorted NFA instruction list begins.
+
+    KernelCount - Stores the number of NFA instructions in the kernel.
+
+    NextHash - Stores the index plus one of the next state in the same hash
+        bucket, or zero at the end of the chain.
+
+--*/
+
+typedef struct _REGEX_DFA_STATE {
+    ULONG Hash;
+    ULONG Flags;
+    ULONG KernelOffset;
+    ULONG KernelCount;
+    ULONG NextHash;
+} REGEX_DFA_STATE, *PREGEX_DFA_STATE;
+
+/*++
+
+Structure Description:
+
+    This structure defines the lazily built DFA cache for a program. It is
+    owned by one execution at a time.
+
+Members:
+
+    StateCount - Stores the number of valid states in the cache.
+
+    States - Stores the array of states.
+
+    Transitions - Stores the transition table, which has one row per state.
+        Each row has an entry for every byte class plus the end of input
+        entries. A transition holds the next state index plus one, possibly
+        with the match bit set, or zero if not yet computed.
+
+    Kernels - Stores the pool of kernel instruction lists.
+
+    KernelSize - Stores the number of elements of the kernel pool in use.
+
+    KernelCapacity - Stores the size of the kernel pool in elements.
+
+    HashTable - Stores the heads of the state hash chains, as state indices
+        plus one.
+
+    Dense - Stores the list of instructions visited by a closure.
+
+    DenseCount - Stores the number of valid elements in the dense array.
+
+    Sparse - Stores the index into the dense array for each instruction,
+        making the visited check constant time.
+
+    Stack - Stores the work stack for computing closures, which can hold
+        twice the number of instructions.
+
+    Marks - Stores a marker per instruction used to build sorted kernels.
+
+--*/
+
+typedef struct _REGEX_DFA {
+    ULONG StateCount;
+    PREGEX_DFA_STATE States;
+    PULONG Transitions;
+    PULONG Kernels;
+    ULONG KernelSize;
+    ULONG KernelCapacity;
+    ULONG HashTable[REGEX_DFA_HASH_SIZE];
+    PULONG Dense;
+    ULONG DenseCount;
+    PULONG Sparse;
+    PULONG Stack;
+    PUCHAR Marks;
+} REGEX_DFA, *PREGEX_DFA;
+
+/*++
+
+Structure Description:
+
+    This structure defines a compiled regular expression program.
+
+Members:
+
+    Instructions - Stores the array of instructions.
+
+    InstructionCount - Stores the number of valid instructions.
+
+    InstructionCapacity - Stores the number of elements the instruction array
+        can hold.
+
+    Sets - Stores the array of byte set bitmaps.
+
+    SetCount - Stores the number of valid sets.
+
+    SetCapacity - Stores the number of sets the set array can hold.
+
+    SlotCount - Stores the number of capture slots, two per subexpression
+        including the overall match.
+
+    Flags - Stores the REG_* compile flags of the expression.
+
+    AnchoredStart - Stores a boolean indicating that a match can only begin
+        at the very start of the input.
+
+    Unsupported - Stores a boolean set during compilation if the expression
+        cannot be represented as a program.
+
+    ClassCount - Stores the number of byte equivalence classes.
+
+    ByteClass - Stores the equivalence class of each byte. Bytes in the same
+        class behave identically everywhere in the program.
+
+    DfaBusy - Stores a flag that is set while an execution owns the DFA
+        cache.
+
+    Dfa - Stores a pointer to the DFA cache, allocated on first use.
+
+--*/
+
+struct _REGULAR_EXPRESSION_PROGRAM {
+    PREGEX_INSTRUCTION Instructions;
+    ULONG InstructionCount;
+    ULONG InstructionCapacity;
+    PUCHAR Sets;
+    ULONG SetCount;
+    ULONG SetCapacity;
+    ULONG SlotCount;
+    ULONG Flags;
+    BOOL AnchoredStart;
+    BOOL Unsupported;
+    ULONG ClassCount;
+    UCHAR ByteClass[256];
+    volatile ULONG DfaBusy;
+    PREGEX_DFA Dfa;
+};
+
+/*++
+
+Structure Description:
+
+    This structure defines a list of threads in the Pike VM.
+
+Members:
+
+    Count - Stores the number of instructions in the list.
+
+    Dense - Stores the instructions in priority order.
+
+    Sparse - Stores the index into the dense array of each instruction.
+
+    Captures - Stores the capture slots for each thread, indexed by dense
+        position.
+
+--*/
+
+typedef struct _REGEX_THREAD_LIST {
+    ULONG Count;
+    PULONG Dense;
+    PULONG Sparse;
+    regoff_t *Captures;
+} REGEX_THREAD_LIST, *PREGEX_THREAD_LIST;
+
+/*++
+
+Structure Description:
+
+    This structure defines an entry on the Pike VM closure stack.
+
+Members:
+
+    Instruction - Stores the instruction to visit, or REGEX_PIKE_RESTORE if
+        this entry restores a capture slot.
+
+    Slot - Stores the capture slot to restore.
+
+    Value - Stores the value to restore into the capture slot.
+
+--*/
+
+typedef struct _REGEX_PIKE_STACK_ENTRY {
+    ULONG Instruction;
+    ULONG Slot;
+    regoff_t Value;
+} REGEX_PIKE_STACK_ENTRY, *PREGEX_PIKE_STACK_ENTRY;
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+VOID
+ClpRegexCompileEntry (
+    PREGULAR_EXPRESSION Expression,
+    PREGULAR_EXPRESSION_PROGRAM Program,
+    PREGULAR_EXPRESSION_ENTRY Entry
+    );
+
+VOID
+ClpRegexCompileSingleEntry (
+    PREGULAR_EXPRESSION Expression,
+    PREGULAR_EXPRESSION_PROGRAM Program,
+    PREGULAR_EXPRESSION_ENTRY Entry
+    );
+
+VOID
+ClpRegexCompileChildren (
+    PREGULAR_EXPRESSION Expression,
+    PREGULAR_EXPRESSION_PROGRAM Program,
+    PREGULAR_EXPRESSION_ENTRY Entry
+    );
+
+BOOL
+ClpRegexIsEntryNullable (
+    PREGULAR_EXPRESSION_ENTRY Entry
+    );
+
+BOOL
+ClpRegexAreChildrenNullable (
+    PREGULAR_EXPRESSION_ENTRY Entry
+    );
+
+ULONG
+ClpRegexEmit (
+    PREGULAR_EXPRESSION_PROGRAM Program,
+    REGEX_OPCODE Opcode,
+    ULONG Argument,
+    ULONG Argument2
+    );
+
+ULONG
+ClpRegexCreateSet (
+    PREGULAR_EXPRESSION_PROGRAM Program,
+    PUCHAR Bitmap
+    );
+
+VOID
+ClpRegexComputeByteClasses (
+    PREGULAR_EXPRESSION_PROGRAM Program
+    );
+
+ULONG
+ClpRegexGetPreviousContext (
+    PREGULAR_EXPRESSION_PROGRAM Program,
+    PSTR String,
+    ULONG Position,
+    int Flags
+    );
+
+ULONG
+ClpRegexGetNextContext (
+    PREGULAR_EXPRESSION_PROGRAM Program,
+    PSTR String,
+    ULONG Position,
+    ULONG Length,
+    int Flags
+    );
+
+BOOL
+ClpRegexCheckAssertion (
+    ULONG Assertion,
+    ULONG Context
+    );
+
+BOOL
+ClpRegexDfaSearch (
+    PREGULAR_EXPRESSION_PROGRAM Program,
+    PSTR String,
+    ULONG Length,
+    int Flags,
+    PREGULAR_EXPRESSION_STATUS Status
+    );
+
+PREGEX_DFA
+ClpRegexCreateDfa (
+    PREGULAR_EXPRESSION_PROGRAM Program
+    );
+
+VOID
+ClpRegexFlushDfa (
+    PREGEX_DFA Dfa
+    );
+
+BOOL
+ClpRegexDfaClosure (
+    PREGULAR_EXPRESSION_PROGRAM Program,
+    PREGEX_DFA Dfa,
+    ULONG State,
+    ULONG Context
+    );
+
+ULONG
+ClpRegexDfaFindState (
+    PREGULAR_EXPRESSION_PROGRAM Program,
+    PREGEX_DFA Dfa,
+    ULONG Flags,
+    PULONG Kernel,
+    ULONG KernelCount
+    );
+
+REGULAR_EXPRESSION_STATUS
+ClpRegexPikeSearch (
+    PREGULAR_EXPRESSION_PROGRAM Program,
+    PSTR String,
+    ULONG Length,
+    int Flags,
+    regoff_t *MatchCaptures
+    );
+
+VOID
+ClpRegexPikeAddThread (
+    PREGULAR_EXPRESSION_PROGRAM Program,
+    PREGEX_THREAD_LIST List,
+    PREGEX_PIKE_STACK_ENTRY Stack,
+    ULONG Instruction,
+    regoff_t *Captures,
+    ULONG Position,
+    ULONG Context
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+REGULAR_EXPRESSION_STATUS
+ClpCompileRegularExpressionProgram (
+    PREGULAR_EXPRESSION Expression
+    )
+
+/*++
+
+Routine Description:
+
+    This routine compiles the parsed expression tree into a Thompson NFA
+    program that can be executed in time linear to the input size. Expressions
+    containing back references cannot be represented this way, and are left
+    without a program.
+
+Arguments:
+
+    Expression - Supplies a pointer to the parsed regular expression.
+
+Return Value:
+
+    Success if a program was created or the expression is simply not suitable
+    for one.
+
+    No memory on allocation failure.
+
+--*/
+
+{
+
+    PREGULAR_EXPRESSION_ENTRY BaseEntry;
+    PREGULAR_EXPRESSION_ENTRY First;
+    PREGULAR_EXPRESSION_PROGRAM Program;
+    REGULAR_EXPRESSION_STATUS Status;
+
+    assert(Expression->Program == NULL);
+
+    BaseEntry = &(Expression->BaseEntry);
+    Program = malloc(sizeof(REGULAR_EXPRESSION_PROGRAM));
+    if (Program == NULL) {
+        Status = RegexStatusNoMemory;
+        goto CompileRegularExpressionProgramEnd;
+    }
+
+    memset(Program, 0, sizeof(REGULAR_EXPRESSION_PROGRAM));
+    Program->Flags = Expression->Flags;
+    Program->SlotCount = (Expression->SubexpressionCount + 1) * 2;
+
+    //
+    // The base entry is subexpression zero. Anchors stripped off of basic
+    // expressions during parsing are put back as assertions.
+    //
+
+    ClpRegexEmit(Program, RegexOpSave, 0, 0);
+    if ((BaseEntry->Flags & REGULAR_EXPRESSION_ANCHORED_LEFT) != 0) {
+        ClpRegexEmit(Program, RegexOpAssert, REGEX_ASSERT_BEGIN_LINE, 0);
+    }
+
+    ClpRegexCompileChildren(Expression, Program, BaseEntry);
+    if ((BaseEntry->Flags & REGULAR_EXPRESSION_ANCHORED_RIGHT) != 0) {
+        ClpRegexEmit(Program, RegexOpAssert, REGEX_ASSERT_END_LINE, 0);
+    }
+
+    ClpRegexEmit(Program, RegexOpSave, 1, 0);
+    ClpRegexEmit(Program, RegexOpMatch, 0, 0);
+    if (Program->Unsupported != FALSE) {
+        Status = RegexStatusSuccess;
+        goto CompileRegularExpressionProgramEnd;
+    }
+
+    //
+    // If every match has to begin at the start of the string, then there's
+    // no need to start new match attempts anywhere else.
+    //
+
+    if ((Program->Flags & REG_NEWLINE) == 0) {
+        if ((BaseEntry->Flags & REGULAR_EXPRESSION_ANCHORED_LEFT) != 0) {
+            Program->AnchoredStart = TRUE;
+
+        } else if (LIST_EMPTY(&(BaseEntry->ChildList)) == FALSE) {
+            First = LIST_VALUE(BaseEntry->ChildList.Next,
+                               REGULAR_EXPRESSION_ENTRY,
+                               ListEntry);
+
+            if ((First->Type == RegexEntryStringBegin) &&
+                (First->DuplicateMin != 0)) {
+
+                Program->AnchoredStart = TRUE;
+            }
+        }
+    }
+
+    ClpRegexComputeByteClasses(Program);
+    Expression->Program = Program;
+    Program = NULL;
+    Status = RegexStatusSuccess;
+
+CompileRegularExpressionProgramEnd:
+    if (Program != NULL) {
+        ClpDestroyRegularExpressionProgram(Program);
+    }
+
+    return Status;
+}
+
+VOID
+ClpDestroyRegularExpressionProgram (
+    PREGULAR_EXPRESSION_PROGRAM Program
+    )
+
+/*++
+
+Routine Description:
+
+    This routine destroys a compiled regular expression program.
+
+Arguments:
+
+    Program - Supplies an optional pointer to the program to destroy.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    if (Program == NULL) {
+        return;
+    }
+
+    if (Program->Dfa != NULL) {
+        free(Program->Dfa);
+    }
+
+    if (Program->Instructions != NULL) {
+        free(Program->Instructions);
+    }
+
+    if (Program->Sets != NULL) {
+        free(Program->Sets);
+    }
+
+    free(Program);
+    return;
+}
+
+REGULAR_EXPRESSION_STATUS
+ClpExecuteRegularExpressionProgram (
+    PREGULAR_EXPRESSION Expression,
+    PSTR String,
+    regmatch_t Match[],
+    size_t MatchArraySize,
+    int Flags
+    )
+
+/*++
+
+Routine Description:
+
+    This routine executes a regular expression using its compiled program. A
+    lazily constructed DFA decides whether or not there is a match, and a
+    Pike VM simulation of the NFA recovers the match positions if needed.
+
+Arguments:
+
+    Expression - Supplies a pointer to the regular expression, which must
+        have a program.
+
+    String - Supplies a pointer to the string to check for a match.
+
+    Match - Supplies an optional pointer to an array where the string indices
+        of the match and its subexpressions will be returned.
+
+    MatchArraySize - Supplies the number of elements in the match array.
+
+    Flags - Supplies a bitfield of flags governing the search. See REG_NOTBOL
+        and REG_NOTEOL.
+
+Return Value:
+
+    Success if there was a match.
+
+    No match if there was no match.
+
+    No memory on allocation failure.
+
+--*/
+
+{
+
+    regoff_t *Captures;
+    ULONG Length;
+    size_t MatchIndex;
+    PREGULAR_EXPRESSION_PROGRAM Program;
+    BOOL ReportMatches;
+    REGULAR_EXPRESSION_STATUS Status;
+
+    Program = Expression->Program;
+    Length = strlen(String);
+    ReportMatches = FALSE;
+    if (((Expression->Flags & REG_NOSUB) == 0) && (MatchArraySize != 0)) {
+        ReportMatches = TRUE;
+    }
+
+    //
+    // Run the DFA first. If it says there's no match (the common case when
+    // scanning lots of text) or the caller doesn't care where the match is,
+    // then the answer is complete.
+    //
+
+    if (ClpRegexDfaSearch(Program, String, Length, Flags, &Status) != FALSE) {
+        if ((Status != RegexStatusSuccess) || (ReportMatches == FALSE)) {
+            goto ExecuteRegularExpressionProgramEnd;
+        }
+    }
+
+    Captures = malloc(Program->SlotCount * sizeof(regoff_t));
+    if (Captures == NULL) {
+        Status = RegexStatusNoMemory;
+        goto ExecuteRegularExpressionProgramEnd;
+    }
+
+    Status = ClpRegexPikeSearch(Program, String, Length, Flags, Captures);
+    if ((Status == RegexStatusSuccess) && (ReportMatches != FALSE)) {
+        for (MatchIndex = 0; MatchIndex < MatchArraySize; MatchIndex += 1) {
+            if (MatchIndex * 2 < Program->SlotCount) {
+                Match[MatchIndex].rm_so = Captures[MatchIndex * 2];
+                Match[MatchIndex].rm_eo = Captures[(MatchIndex * 2) + 1];
+
+            } else {
+                Match[MatchIndex].rm_so = -1;
+                Match[MatchIndex].rm_eo = -1;
+            }
+        }
+    }
+
+    free(Captures);
+
+ExecuteRegularExpressionProgramEnd:
+    if ((Status != RegexStatusSuccess) &&
+        ((Expression->Flags & REG_NOSUB) == 0)) {
+
+        for (MatchIndex = 0; MatchIndex < MatchArraySize; MatchIndex += 1) {
+            Match[MatchIndex].rm_so = -1;
+            Match[MatchIndex].rm_eo = -1;
+        }
+    }
+
+    return Status;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+VOID
+ClpRegexCompileEntry (
+    PREGULAR_EXPRESSION Expression,
+    PREGULAR_EXPRESSION_PROGRAM Program,
+    PREGULAR_EXPRESSION_ENTRY Entry
+    )
+
+/*++
+
+Routine Description:
+
+    This routine compiles an expression entry, including its duplication
+    count, into the program.
+
+Arguments:
+
+    Expression - Supplies a pointer to the regular expression.
+
+    Program - Supplies a pointer to the program being built.
+
+    Entry - Supplies a pointer to the entry to compile.
+
+Return Value:
+
+    None. The unsupported flag is set in the program if the entry cannot be
+    represented.
+
+--*/
+
+{
+
+    ULONG Iteration;
+    ULONG Loop;
+    ULONG NextPatch;
+    ULONG Patch;
+    ULONG Split;
+
+    //
+    // The backtracker stops repeating an entry as soon as an iteration
+    // matches the empty string, which affects what the subexpressions
+    // capture. Rather than emulate that, leave such expressions to it.
+    //
+
+    if ((Entry->DuplicateMax != 1) && (Entry->DuplicateMax != 0) &&
+        (ClpRegexIsEntryNullable(Entry) != FALSE)) {
+
+        Program->Unsupported = TRUE;
+        return;
+    }
+
+    for (Iteration = 0; Iteration < Entry->DuplicateMin; Iteration += 1) {
+        ClpRegexCompileSingleEntry(Expression, Program, Entry);
+        if (Program->Unsupported != FALSE) {
+            return;
+        }
+    }
+
+    //
+    // An unbounded repeat loops back to a split that prefers another
+    // iteration.
+    //
+
+    if (Entry->DuplicateMax == (ULONG)-1) {
+        Loop = ClpRegexEmit(Program, RegexOpSplit, 0, 0);
+        ClpRegexCompileSingleEntry(Expression, Program, Entry);
+        ClpRegexEmit(Program, RegexOpJump, Loop, 0);
+        if (Program->Unsupported == FALSE) {
+            Program->Instructions[Loop].Argument = Loop + 1;
+            Program->Instructions[Loop].Argument2 = Program->InstructionCount;
+        }
+
+        return;
+    }
+
+    //
+    // Each optional iteration gets a split that prefers taking it. The
+    // alternate targets all skip to the end, and are chained together through
+    // the second argument until the end is known.
+    //
+
+    Patch = (ULONG)-1;
+    for (Iteration = Entry->DuplicateMin;
+         Iteration < Entry->DuplicateMax;
+         Iteration += 1) {
+
+        Split = ClpRegexEmit(Program, RegexOpSplit, 0, Patch);
+        ClpRegexCompileSingleEntry(Expression, Program, Entry);
+        if (Program->Unsupported != FALSE) {
+            return;
+        }
+
+        Program->Instructions[Split].Argument = Split + 1;
+        Patch = Split;
+    }
+
+    while (Patch != (ULONG)-1) {
+        NextPatch = Program->Instructions[Patch].Argument2;
+        Program->Instructions[Patch].Argument2 = Program->InstructionCount;
+        Patch = NextPatch;
+    }
+
+    return;
+}
+
+VOID
+ClpRegexCompileSingleEntry (
+    PREGULAR_EXPRESSION Expression,
+    PREGULAR_EXPRESSION_PROGRAM Program,
+    PREGULAR_EXPRESSION_ENTRY Entry
+    )
+
+/*++
+
+Routine Description:
+
+    This routine compiles one occurrence of an expression entry into the
+    program.
+
+Arguments:
+
+    Expression - Supplies a pointer to the regular expression.
+
+    Program - Supplies a pointer to the program being built.
+
+    Entry - Supplies a pointer to the entry to compile.
+
+Return Value:
+
+    None. The unsupported flag is set in the program if the entry cannot be
+    represented.
+
+--*/
+
+{
+
+    UCHAR Bitmap[REGEX_SET_SIZE];
+    ULONG Byte;
+    CHAR Character;
+    PLIST_ENTRY CurrentEntry;
+    BOOL IgnoreCase;
+    ULONG Index;
+    PREGULAR_EXPRESSION_ENTRY Option;
+    ULONG NextPatch;
+    ULONG Patch;
+    ULONG Set;
+    ULONG Split;
+    ULONG Subexpression;
+
+    IgnoreCase = FALSE;
+    if ((Expression->Flags & REG_ICASE) != 0) {
+        IgnoreCase = TRUE;
+    }
+
+    switch (Entry->Type) {
+
+    //
+    // Each ordinary character becomes a set, which handles ignoring case the
+    // same way the string compare does.
+    //
+
+    case RegexEntryOrdinaryCharacters:
+        for (Index = 0; Index < Entry->U.String.Size; Index += 1) {
+            Character = Entry->U.String.Data[Index];
+            memset(Bitmap, 0, sizeof(Bitmap));
+            for (Byte = 1; Byte < 256; Byte += 1) {
+                if (((CHAR)Byte == Character) ||
+                    ((IgnoreCase != FALSE) &&
+                     (tolower((CHAR)Byte) == tolower(Character)))) {
+
+                    REGEX_SET_ADD(Bitmap, Byte);
+                }
+            }
+
+            Set = ClpRegexCreateSet(Program, Bitmap);
+            ClpRegexEmit(Program, RegexOpSet, Set, 0);
+        }
+
+        break;
+
+    case RegexEntryAnyCharacter:
+        memset(Bitmap, 0, sizeof(Bitmap));
+        for (Byte = 1; Byte < 256; Byte += 1) {
+            if ((Byte != '\n') || ((Expression->Flags & REG_NEWLINE) == 0)) {
+                REGEX_SET_ADD(Bitmap, Byte);
+            }
+        }
+
+        Set = ClpRegexCreateSet(Program, Bitmap);
+        ClpRegexEmit(Program, RegexOpSet, Set, 0);
+        break;
+
+    case RegexEntryBracketExpression:
+        memset(Bitmap, 0, sizeof(Bitmap));
+        for (Byte = 1; Byte < 256; Byte += 1) {
+            if (ClpRegularExpressionMatchBracketCharacter(Expression,
+                                                          Entry,
+                                                          (CHAR)Byte)) {
+
+                REGEX_SET_ADD(Bitmap, Byte);
+            }
+        }
+
+        Set = ClpRegexCreateSet(Program, Bitmap);
+        ClpRegexEmit(Program, RegexOpSet, Set, 0);
+        break;
+
+    case RegexEntrySubexpression:
+        Subexpression = Entry->U.SubexpressionNumber;
+
+        assert((Subexpression * 2) + 1 < Program->SlotCount);
+
+        ClpRegexEmit(Program, RegexOpSave, Subexpression * 2, 0);
+        ClpRegexCompileChildren(Expression, Program, Entry);
+        ClpRegexEmit(Program, RegexOpSave, (Subexpression * 2) + 1, 0);
+        break;
+
+    //
+    // Each branch option but the last gets a split preferring that option,
+    // and a jump to the end after it. The jumps are chained together through
+    // their argument until the end is known.
+    //
+
+    case RegexEntryBranch:
+        Patch = (ULONG)-1;
+        CurrentEntry = Entry->ChildList.Next;
+        while (CurrentEntry != &(Entry->ChildList)) {
+            Option = LIST_VALUE(CurrentEntry,
+                                REGULAR_EXPRESSION_ENTRY,
+                                ListEntry);
+
+            assert(Option->Type == RegexEntryBranchOption);
+
+            CurrentEntry = CurrentEntry->Next;
+            if (CurrentEntry == &(Entry->ChildList)) {
+                ClpRegexCompileChildren(Expression, Program, Option);
+                break;
+            }
+
+            Split = ClpRegexEmit(Program, RegexOpSplit, 0, 0);
+            ClpRegexCompileChildren(Expression, Program, Option);
+            Patch = ClpRegexEmit(Program, RegexOpJump, Patch, 0);
+            if (Program->Unsupported != FALSE) {
+                return;
+            }
+
+            Program->Instructions[Split].Argument = Split + 1;
+            Program->Instructions[Split].Argument2 = Program->InstructionCount;
+        }
+
+        if (Program->Unsupported != FALSE) {
+            return;
+        }
+
+        while (Patch != (ULONG)-1) {
+            NextPatch = Program->Instructions[Patch].Argument;
+            Program->Instructions[Patch].Argument = Program->InstructionCount;
+            Patch = NextPatch;
+        }
+
+        break;
+
+    case RegexEntryStringBegin:
+        ClpRegexEmit(Program, RegexOpAssert, REGEX_ASSERT_BEGIN_LINE, 0);
+        break;
+
+    case RegexEntryStringEnd:
+        ClpRegexEmit(Program, RegexOpAssert, REGEX_ASSERT_END_LINE, 0);
+        break;
+
+    case RegexEntryStartOfWord:
+        ClpRegexEmit(Program, RegexOpAssert, REGEX_ASSERT_START_WORD, 0);
+        break;
+
+    case RegexEntryEndOfWord:
+        ClpRegexEmit(Program, RegexOpAssert, REGEX_ASSERT_END_WORD, 0);
+        break;
+
+    //
+    // Back references need the backtracker.
+    //
+
+    case RegexEntryBackReference:
+    default:
+        Program->Unsupported = TRUE;
+        break;
+    }
+
+    return;
+}
+
+VOID
+ClpRegexCompileChildren (
+    PREGULAR_EXPRESSION Expression,
+    PREGULAR_EXPRESSION_PROGRAM Program,
+    PREGULAR_EXPRESSION_ENTRY Entry
+    )
+
+/*++
+
+Routine Description:
+
+    This routine compiles the sequence of children of an entry into the
+    program.
+
+Arguments:
+
+    Expression - Supplies a pointer to the regular expression.
+
+    Program - Supplies a pointer to the program being built.
+
+    Entry - Supplies a pointer to the entry whose children should be compiled.
+
+Return Value:
+
+    None. The unsupported flag is set in the program if an entry cannot be
+    represented.
+
+--*/
+
+{
+
+    PREGULAR_EXPRESSION_ENTRY Child;
+    PLIST_ENTRY CurrentEntry;
+
+    CurrentEntry = Entry->ChildList.Next;
+    while (CurrentEntry != &(Entry->ChildList)) {
+        Child = LIST_VALUE(CurrentEntry, REGULAR_EXPRESSION_ENTRY, ListEntry);
+        CurrentEntry = CurrentEntry->Next;
+        ClpRegexCompileEntry(Expression, Program, Child);
+        if (Program->Unsupported != FALSE) {
+            break;
+        }
+    }
+
+    return;
+}
+
+BOOL
+ClpRegexIsEntryNullable (
+    PREGULAR_EXPRESSION_ENTRY Entry
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines whether a single occurrence of the given entry
+    can match the empty string.
+
+Arguments:
+
+    Entry - Supplies a pointer to the entry to examine.
+
+Return Value:
+
+    TRUE if the entry can match without consuming any input.
+
+    FALSE if every match of the entry consumes input.
+
+--*/
+
+{
+
+    PLIST_ENTRY CurrentEntry;
+    PREGULAR_EXPRESSION_ENTRY Option;
+
+    switch (Entry->Type) {
+    case RegexEntryOrdinaryCharacters:
+    case RegexEntryAnyCharacter:
+    case RegexEntryBracketExpression:
+        break;
+
+    case RegexEntrySubexpression:
+        return ClpRegexAreChildrenNullable(Entry);
+
+    case RegexEntryBranch:
+        CurrentEntry = Entry->ChildList.Next;
+        while (CurrentEntry != &(Entry->ChildList)) {
+            Option = LIST_VALUE(CurrentEntry,
+                                REGULAR_EXPRESSION_ENTRY,
+                                ListEntry);
+
+            CurrentEntry = CurrentEntry->Next;
+            if (ClpRegexAreChildrenNullable(Option) != FALSE) {
+                return TRUE;
+            }
+        }
+
+        break;
+
+    default:
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+BOOL
+ClpRegexAreChildrenNullable (
+    PREGULAR_EXPRESSION_ENTRY Entry
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines whether the sequence of children of the given
+    entry can match the empty string.
+
+Arguments:
+
+    Entry - Supplies a pointer to the entry whose children should be examined.
+
+Return Value:
+
+    TRUE if the children can all match without consuming any input.
+
+    FALSE if the sequence always consumes input.
+
+--*/
+
+{
+
+    PREGULAR_EXPRESSION_ENTRY Child;
+    PLIST_ENTRY CurrentEntry;
+
+    CurrentEntry = Entry->ChildList.Next;
+    while (CurrentEntry != &(Entry->ChildList)) {
+        Child = LIST_VALUE(CurrentEntry, REGULAR_EXPRESSION_ENTRY, ListEntry);
+        CurrentEntry = CurrentEntry->Next;
+        if ((Child->DuplicateMin != 0) &&
+            (ClpRegexIsEntryNullable(Child) == FALSE)) {
+
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+ULONG
+ClpRegexEmit (
+    PREGULAR_EXPRESSION_PROGRAM Program,
+    REGEX_OPCODE Opcode,
+    ULONG Argument,
+    ULONG Argument2
+    )
+
+/*++
+
+Routine Description:
+
+    This routine appends an instruction to the program.
+
+Arguments:
+
+    Program - Supplies a pointer to the program being built.
+
+    Opcode - Supplies the instruction type.
+
+    Argument - Supplies the first instruction argument.
+
+    Argument2 - Supplies the second instruction argument.
+
+Return Value:
+
+    Returns the index of the new instruction. If the program is too big or
+    memory could not be allocated, the unsupported flag is set and the
+    returned index should not be used.
+
+--*/
+
+{
+
+    ULONG Index;
+    PVOID NewBuffer;
+    ULONG NewCapacity;
+
+    if (Program->Unsupported != FALSE) {
+        return 0;
+    }
+
+    if (Program->InstructionCount >= Program->InstructionCapacity) {
+        if (Program->InstructionCapacity >= REGEX_PROGRAM_MAX_INSTRUCTIONS) {
+            Program->Unsupported = TRUE;
+            return 0;
+        }
+
+        NewCapacity = Program->InstructionCapacity * 2;
+        if (NewCapacity == 0) {
+            NewCapacity = REGEX_PROGRAM_INITIAL_CAPACITY;
+        }
+
+        NewBuffer = realloc(Program->Instructions,
+                            NewCapacity * sizeof(REGEX_INSTRUCTION));
+
+        if (NewBuffer == NULL) {
+            free(Program->Instructions);
+            Program->Instructions = NULL;
+            Program->InstructionCount = 0;
+            Program->InstructionCapacity = 0;
+            Program->Unsupported = TRUE;
+            return 0;
+        }
+
+        Program->Instructions = NewBuffer;
+        Program->InstructionCapacity = NewCapacity;
+    }
+
+    Index = Program->InstructionCount;
+    Program->Instructions[Index].Opcode = Opcode;
+    Program->Instructions[Index].Argument = Argument;
+    Program->Instructions[Index].Argument2 = Argument2;
+    Program->InstructionCount += 1;
+    return Index;
+}
+
+ULONG
+ClpRegexCreateSet (
+    PREGULAR_EXPRESSION_PROGRAM Program,
+    PUCHAR Bitmap
+    )
+
+/*++
+
+Routine Description:
+
+    This routine adds a byte set to the program, reusing the previous set if
+    it is identical.
+
+Arguments:
+
+    Program - Supplies a pointer to the program being built.
+
+    Bitmap - Supplies the set bitmap, one bit per byte value.
+
+Return Value:
+
+    Returns the index of the set. If memory could not be allocated, the
+    unsupported flag is set in the program.
+
+--*/
+
+{
+
+    ULONG Index;
+    PVOID NewBuffer;
+    ULONG NewCapacity;
+
+    if (Program->Unsupported != FALSE) {
+        return 0;
+    }
+
+    //
+    // Repeats expand into identical copies of the same set, so it's worth
+    // checking the most recent one.
+    //
+
+    if ((Program->SetCount != 0) &&
+        (memcmp(Program->Sets + ((Program->SetCount - 1) * REGEX_SET_SIZE),
+                Bitmap,
+                REGEX_SET_SIZE) == 0)) {
+
+        return Program->SetCount - 1;
+    }
+
+    if (Program->SetCount >= Program->SetCapacity) {
+        NewCapacity = Program->SetCapacity * 2;
+        if (NewCapacity == 0) {
+            NewCapacity = REGEX_PROGRAM_INITIAL_CAPACITY;
+        }
+
+        NewBuffer = realloc(Program->Sets, NewCapacity * REGEX_SET_SIZE);
+        if (NewBuffer == NULL) {
+            free(Program->Sets);
+            Program->Sets = NULL;
+            Program->SetCount = 0;
+            Program->SetCapacity = 0;
+            Program->Unsupported = TRUE;
+            return 0;
+        }
+
+        Program->Sets = NewBuffer;
+        Program->SetCapacity = NewCapacity;
+    }
+
+    Index = Program->SetCount;
+    memcpy(Program->Sets + (Index * REGEX_SET_SIZE), Bitmap, REGEX_SET_SIZE);
+    Program->SetCount += 1;
+    return Index;
+}
+
+VOID
+ClpRegexComputeByteClasses (
+    PREGULAR_EXPRESSION_PROGRAM Program
+    )
+
+/*++
+
+Routine Description:
+
+    This routine partitions the byte values into equivalence classes such
+    that all bytes in a class are treated identically by every set in the
+    program and by the assertions. The DFA has one transition per class
+    rather than per byte.
+
+Arguments:
+
+    Program - Supplies a pointer to the program.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Byte;
+    ULONG ClassCount;
+    USHORT ClassMap[256 * 2];
+    BOOL InSet;
+    ULONG Key;
+    UCHAR NewClass[256];
+    ULONG Set;
+    ULONG Split;
+
+    //
+    // Start by separating the null terminator, newlines, and word characters
+    // from everything else, since those affect assertions.
+    //
+
+    for (Byte = 0; Byte < 256; Byte += 1) {
+        if (Byte == 0) {
+            Program->ByteClass[Byte] = 0;
+
+        } else if (Byte == '\n') {
+            Program->ByteClass[Byte] = 1;
+
+        } else if (REGULAR_EXPRESSION_IS_NAME((CHAR)Byte)) {
+            Program->ByteClass[Byte] = 2;
+
+        } else {
+            Program->ByteClass[Byte] = 3;
+        }
+    }
+
+    ClassCount = 4;
+
+    //
+    // Refine the partition by each set: bytes stay together only if they
+    // were together before and agree on membership in the set.
+    //
+
+    for (Set = 0; Set < Program->SetCount; Set += 1) {
+        memset(ClassMap, 0xFF, sizeof(ClassMap));
+        Split = 0;
+        for (Byte = 0; Byte < 256; Byte += 1) {
+            InSet = REGEX_SET_CONTAINS(Program, Set, Byte);
+            Key = (Program->ByteClass[Byte] * 2) + InSet;
+            if (ClassMap[Key] == 0xFFFF) {
+                ClassMap[Key] = Split;
+                Split += 1;
+            }
+
+            NewClass[Byte] = ClassMap[Key];
+        }
+
+        memcpy(Program->ByteClass, NewClass, sizeof(NewClass));
+        ClassCount = Split;
+    }
+
+    Program->ClassCount = ClassCount;
+    return;
+}
+
+ULONG
+ClpRegexGetPreviousContext (
+    PREGULAR_EXPRESSION_PROGRAM Program,
+    PSTR String,
+    ULONG Position,
+    int Flags
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines the context bits contributed by the character
+    before the given position.
+
+Arguments:
+
+    Program - Supplies a pointer to the program.
+
+    String - Supplies a pointer to the input string.
+
+    Position - Supplies the position in the input.
+
+    Flags - Supplies the execution flags.
+
+Return Value:
+
+    Returns the previous context bits. See REGEX_CONTEXT_* definitions.
+
+--*/
+
+{
+
+    CHAR Character;
+    ULONG Context;
+
+    Context = 0;
+    if (Position == 0) {
+        if ((Flags & REG_NOTBOL) == 0) {
+            Context |= REGEX_CONTEXT_PREVIOUS_LINE;
+        }
+
+    } else {
+        Character = String[Position - 1];
+        if (((Program->Flags & REG_NEWLINE) != 0) && (Character == '\n')) {
+            Context |= REGEX_CONTEXT_PREVIOUS_LINE;
+        }
+
+        if (REGULAR_EXPRESSION_IS_NAME(Character)) {
+            Context |= REGEX_CONTEXT_PREVIOUS_WORD;
+        }
+    }
+
+    return Context;
+}
+
+ULONG
+ClpRegexGetNextContext (
+    PREGULAR_EXPRESSION_PROGRAM Program,
+    PSTR String,
+    ULONG Position,
+    ULONG Length,
+    int Flags
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines the context bits contributed by the character
+    at the given position.
+
+Arguments:
+
+    Program - Supplies a pointer to the program.
+
+    String - Supplies a pointer to the input string.
+
+    Position - Supplies the position in the input.
+
+    Length - Supplies the length of the input, not including the null
+        terminator.
+
+    Flags - Supplies the execution flags.
+
+Return Value:
+
+    Returns the next context bits. See REGEX_CONTEXT_* definitions.
+
+--*/
+
+{
+
+    CHAR Character;
+    ULONG Context;
+
+    Context = 0;
+    if (Position >= Length) {
+        if ((Flags & REG_NOTEOL) == 0) {
+            Context |= REGEX_CONTEXT_NEXT_LINE;
+        }
+
+    } else {
+        Character = String[Position];
+        if (((Program->Flags & REG_NEWLINE) != 0) && (Character == '\n')) {
+            Context |= REGEX_CONTEXT_NEXT_LINE;
+        }
+
+        if (REGULAR_EXPRESSION_IS_NAME(Character)) {
+            Context |= REGEX_CONTEXT_NEXT_WORD;
+        }
+    }
+
+    return Context;
+}
+
+BOOL
+ClpRegexCheckAssertion (
+    ULONG Assertion,
+    ULONG Context
+    )
+
+/*++
+
+Routine Description:
+
+    This routine evaluates a zero-width assertion.
+
+Arguments:
+
+    Assertion - Supplies the assertion type. See REGEX_ASSERT_* definitions.
+
+    Context - Supplies the context bits around the current position.
+
+Return Value:
+
+    TRUE if the assertion holds.
+
+    FALSE if the assertion fails.
+
+--*/
+
+{
+
+    switch (Assertion) {
+    case REGEX_ASSERT_BEGIN_LINE:
+        if ((Context & REGEX_CONTEXT_PREVIOUS_LINE) != 0) {
+            return TRUE;
+        }
+
+        break;
+
+    case REGEX_ASSERT_END_LINE:
+        if ((Context & REGEX_CONTEXT_NEXT_LINE) != 0) {
+            return TRUE;
+        }
+
+        break;
+
+    case REGEX_ASSERT_START_WORD:
+        if (((Context & REGEX_CONTEXT_NEXT_WORD) != 0) &&
+            ((Context & REGEX_CONTEXT_PREVIOUS_WORD) == 0)) {
+
+            return TRUE;
+        }
+
+        break;
+
+    case REGEX_ASSERT_END_WORD:
+        if (((Context & REGEX_CONTEXT_PREVIOUS_WORD) != 0) &&
+            ((Context & REGEX_CONTEXT_NEXT_WORD) == 0)) {
+
+            return TRUE;
+        }
+
+        break;
+
+    default:
+
+        assert(FALSE);
+
+        break;
+    }
+
+    return FALSE;
+}
+
+BOOL
+ClpRegexDfaSearch (
+    PREGULAR_EXPRESSION_PROGRAM Program,
+    PSTR String,
+    ULONG Length,
+    int Flags,
+    PREGULAR_EXPRESSION_STATUS Status
+    )
+
+/*++
+
+Routine Description:
+
+    This routine uses the lazily built DFA to determine whether the program
+    matches anywhere in the input.
+
+Arguments:
+
+    Program - Supplies a pointer to the program.
+
+    String - Supplies a pointer to the input string.
+
+    Length - Supplies the length of the input, not including the null
+        terminator.
+
+    Flags - Supplies the execution flags.
+
+    Status - Supplies a pointer where the result will be returned if the
+        DFA was able to decide.
+
+Return Value:
+
+    TRUE if the DFA decided the outcome.
+
+    FALSE if the DFA could not be used, in which case the caller should run
+    the Pike VM. This happens if another thread is using the DFA cache, on
+    allocation failure, or if the cache thrashes.
+
+--*/
+
+{
+
+    UCHAR Byte;
+    ULONG ByteClass;
+    ULONG Context;
+    BOOL Decided;
+    PREGEX_DFA Dfa;
+    ULONG EndIndex;
+    ULONG FlushCount;
+    ULONG Index;
+    ULONG KernelCount;
+    BOOL Match;
+    ULONG NextFlags;
+    ULONG NextState;
+    ULONG Position;
+    PREGEX_DFA_STATE StateEntry;
+    ULONG State;
+    ULONG Stride;
+    ULONG Transition;
+    PULONG TransitionRow;
+
+    //
+    // The DFA cache is shared by every execution of this expression, so only
+    // one thread gets to use it at a time. Others just use the Pike VM.
+    //
+
+    if (RtlAtomicCompareExchange32(&(Program->DfaBusy), 1, 0) != 0) {
+        return FALSE;
+    }
+
+    Decided = FALSE;
+    Dfa = Program->Dfa;
+    if (Dfa == NULL) {
+        Dfa = ClpRegexCreateDfa(Program);
+        if (Dfa == NULL) {
+            goto DfaSearchEnd;
+        }
+
+        Program->Dfa = Dfa;
+    }
+
+    FlushCount = 0;
+    Stride = Program->ClassCount + REGEX_DFA_END_TRANSITIONS;
+    NextFlags = 0;
+    if (Program->AnchoredStart == FALSE) {
+        NextFlags = REGEX_DFA_STATE_SEARCH;
+    }
+
+    EndIndex = Program->ClassCount;
+    if ((Flags & REG_NOTEOL) != 0) {
+        EndIndex += 1;
+    }
+
+    Context = ClpRegexGetPreviousContext(Program, String, 0, Flags);
+    State = ClpRegexDfaFindState(Program,
+                                 Dfa,
+                                 Context | REGEX_DFA_STATE_SEARCH,
+                                 NULL,
+                                 0);
+
+    if (State == (ULONG)-1) {
+        ClpRegexFlushDfa(Dfa);
+        State = ClpRegexDfaFindState(Program,
+                                     Dfa,
+                                     Context | REGEX_DFA_STATE_SEARCH,
+                                     NULL,
+                                     0);
+
+        if (State == (ULONG)-1) {
+            goto DfaSearchEnd;
+        }
+    }
+
+    Position = 0;
+    while (TRUE) {
+        TransitionRow = &(Dfa->Transitions[State * Stride]);
+
+        //
+        // At the end of the input, the only question is whether a match ends
+        // here.
+        //
+
+        if (Position == Length) {
+            Transition = TransitionRow[EndIndex];
+            if (Transition == 0) {
+                Context = (Dfa->States[State].Flags &
+                           REGEX_CONTEXT_PREVIOUS_MASK) |
+                          ClpRegexGetNextContext(Program,
+                                                 String,
+                                                 Position,
+                                                 Length,
+                                                 Flags);
+
+                Transition = REGEX_DFA_END_NO_MATCH;
+                if (ClpRegexDfaClosure(Program, Dfa, State, Context)) {
+                    Transition = REGEX_DFA_END_MATCH;
+                }
+
+                TransitionRow[EndIndex] = Transition;
+            }
+
+            *Status = RegexStatusNoMatch;
+            if (Transition == REGEX_DFA_END_MATCH) {
+                *Status = RegexStatusSuccess;
+            }
+
+            Decided = TRUE;
+            break;
+        }
+
+        Byte = String[Position];
+        ByteClass = Program->ByteClass[Byte];
+        Transition = TransitionRow[ByteClass];
+
+        //
+        // Compute the transition if this is the first time it's been taken:
+        // follow the closure of the state now that the next character is
+        // known, then step every thread over the character.
+        //
+
+        if (Transition == 0) {
+            StateEntry = &(Dfa->States[State]);
+            Context = (StateEntry->Flags & REGEX_CONTEXT_PREVIOUS_MASK) |
+                      ClpRegexGetNextContext(Program,
+                                             String,
+                                             Position,
+                                             Length,
+                                             Flags);
+
+            Match = ClpRegexDfaClosure(Program, Dfa, State, Context);
+            if (Match != FALSE) {
+                TransitionRow[ByteClass] = REGEX_DFA_TRANSITION_MATCH;
+                *Status = RegexStatusSuccess;
+                Decided = TRUE;
+                break;
+            }
+
+            KernelCount = 0;
+            for (Index = 0; Index < Program->InstructionCount; Index += 1) {
+                Dfa->Marks[Index] = FALSE;
+            }
+
+            for (Index = 0; Index < Dfa->DenseCount; Index += 1) {
+
+                NextState = Dfa->Dense[Index];
+                if ((Program->Instructions[NextState].Opcode == RegexOpSet) &&
+                    (REGEX_SET_CONTAINS(
+                                   Program,
+                                   Program->Instructions[NextState].Argument,
+                                   Byte))) {
+
+                    Dfa->Marks[NextState + 1] = TRUE;
+                }
+            }
+
+            for (Index = 0; Index < Program->InstructionCount; Index += 1) {
+                if (Dfa->Marks[Index] != FALSE) {
+                    Dfa->Stack[KernelCount] = Index;
+                    KernelCount += 1;
+                }
+            }
+
+            Context = ClpRegexGetPreviousContext(Program,
+                                                 String,
+                                                 Position + 1,
+                                                 Flags);
+
+            NextState = ClpRegexDfaFindState(Program,
+                                             Dfa,
+                                             Context | NextFlags,
+                                             Dfa->Stack,
+                                             KernelCount);
+
+            //
+            // If the cache is full, flush it and start over from the new
+            // state. Give up if this keeps happening, as the DFA is not
+            // performing any better than the NFA simulation would.
+            //
+
+            if (NextState == (ULONG)-1) {
+                FlushCount += 1;
+                if (FlushCount > REGEX_DFA_MAX_FLUSHES) {
+                    goto DfaSearchEnd;
+                }
+
+                ClpRegexFlushDfa(Dfa);
+                NextState = ClpRegexDfaFindState(Program,
+                                                 Dfa,
+                                                 Context | NextFlags,
+                                                 Dfa->Stack,
+                                                 KernelCount);
+
+                if (NextState == (ULONG)-1) {
+                    goto DfaSearchEnd;
+                }
+
+            } else {
+                TransitionRow[ByteClass] = NextState + 1;
+            }
+
+            Transition = NextState + 1;
+
+        } else if ((Transition & REGEX_DFA_TRANSITION_MATCH) != 0) {
+            *Status = RegexStatusSuccess;
+            Decided = TRUE;
+            break;
+        }
+
+        State = Transition - 1;
+        Position += 1;
+
+        //
+        // A state with no threads that isn't starting new attempts can never
+        // match.
+        //
+
+        StateEntry = &(Dfa->States[State]);
+        if ((StateEntry->KernelCount == 0) &&
+            ((StateEntry->Flags & REGEX_DFA_STATE_SEARCH) == 0)) {
+
+            *Status = RegexStatusNoMatch;
+            Decided = TRUE;
+            break;
+        }
+    }
+
+DfaSearchEnd:
+    RtlAtomicExchange32(&(Program->DfaBusy), 0);
+    return Decided;
+}
+
+PREGEX_DFA
+ClpRegexCreateDfa (
+    PREGULAR_EXPRESSION_PROGRAM Program
+    )
+
+/*++
+
+Routine Description:
+
+    This routine allocates an empty DFA cache for the given program.
+
+Arguments:
+
+    Program - Supplies a pointer to the program.
+
+Return Value:
+
+    Returns a pointer to the new DFA on success.
+
+    NULL on allocation failure.
+
+--*/
+
+{
+
+    size_t AllocationSize;
+    PUCHAR Buffer;
+    PREGEX_DFA Dfa;
+    ULONG InstructionCount;
+    ULONG KernelCapacity;
+    ULONG Stride;
+
+    //
+    // Allocate the structure along with all of its arrays in one go. The
+    // kernel pool holds a few complete instruction lists' worth.
+    //
+
+    InstructionCount = Program->InstructionCount;
+    Stride = Program->ClassCount + REGEX_DFA_END_TRANSITIONS;
+    KernelCapacity = InstructionCount * 8;
+    if (KernelCapacity < REGEX_DFA_MAX_STATES * 4) {
+        KernelCapacity = REGEX_DFA_MAX_STATES * 4;
+    }
+
+    AllocationSize = sizeof(REGEX_DFA) +
+                     (REGEX_DFA_MAX_STATES * sizeof(REGEX_DFA_STATE)) +
+                     (REGEX_DFA_MAX_STATES * Stride * sizeof(ULONG)) +
+                     (KernelCapacity * sizeof(ULONG)) +
+                     ((InstructionCount + 1) * sizeof(ULONG) * 4) +
+                     (InstructionCount + 1);
+
+    Buffer = malloc(AllocationSize);
+    if (Buffer == NULL) {
+        return NULL;
+    }
+
+    Dfa = (PREGEX_DFA)Buffer;
+    Buffer += sizeof(REGEX_DFA);
+    Dfa->States = (PREGEX_DFA_STATE)Buffer;
+    Buffer += REGEX_DFA_MAX_STATES * sizeof(REGEX_DFA_STATE);
+    Dfa->Transitions = (PULONG)Buffer;
+    Buffer += REGEX_DFA_MAX_STATES * Stride * sizeof(ULONG);
+    Dfa->Kernels = (PULONG)Buffer;
+    Dfa->KernelCapacity = KernelCapacity;
+    Buffer += KernelCapacity * sizeof(ULONG);
+    Dfa->Dense = (PULONG)Buffer;
+    Buffer += (InstructionCount + 1) * sizeof(ULONG);
+    Dfa->Sparse = (PULONG)Buffer;
+    Buffer += (InstructionCount + 1) * sizeof(ULONG);
+    Dfa->Stack = (PULONG)Buffer;
+    Buffer += (InstructionCount + 1) * 2 * sizeof(ULONG);
+    Dfa->Marks = Buffer;
+    ClpRegexFlushDfa(Dfa);
+    return Dfa;
+}
+
+VOID
+ClpRegexFlushDfa (
+    PREGEX_DFA Dfa
+    )
+
+/*++
+
+Routine Description:
+
+    This routine discards all cached states in the DFA.
+
+Arguments:
+
+    Dfa - Supplies a pointer to the DFA to flush.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    Dfa->StateCount = 0;
+    Dfa->KernelSize = 0;
+    memset(Dfa->HashTable, 0, sizeof(Dfa->HashTable));
+    return;
+}
+
+BOOL
+ClpRegexDfaClosure (
+    PREGULAR_EXPRESSION_PROGRAM Program,
+    PREGEX_DFA Dfa,
+    ULONG State,
+    ULONG Context
+    )
+
+/*++
+
+Routine Description:
+
+    This routine computes the set of instructions reachable from a DFA state
+    without consuming input. The result is left in the dense array.
+
+Arguments:
+
+    Program - Supplies a pointer to the program.
+
+    Dfa - Supplies a pointer to the DFA.
+
+    State - Supplies the index of the state whose closure should be computed.
+
+    Context - Supplies the context bits around the current position, used to
+        evaluate assertions.
+
+Return Value:
+
+    TRUE if a match instruction is reachable.
+
+    FALSE if no match ends at this position.
+
+--*/
+
+{
+
+    ULONG Count;
+    ULONG Index;
+    PREGEX_INSTRUCTION Instruction;
+    ULONG InstructionIndex;
+    PULONG Kernel;
+    BOOL Match;
+    ULONG StackSize;
+    PREGEX_DFA_STATE StateEntry;
+
+    Count = 0;
+    Match = FALSE;
+    StackSize = 0;
+    StateEntry = &(Dfa->States[State]);
+    Kernel = &(Dfa->Kernels[StateEntry->KernelOffset]);
+
+    //
+    // Push the kernel in reverse so it's explored in order, with a new match
+    // attempt last.
+    //
+
+    if ((StateEntry->Flags & REGEX_DFA_STATE_SEARCH) != 0) {
+        Dfa->Stack[StackSize] = 0;
+        StackSize += 1;
+    }
+
+    for (Index = StateEntry->KernelCount; Index != 0; Index -= 1) {
+        Dfa->Stack[StackSize] = Kernel[Index - 1];
+        StackSize += 1;
+    }
+
+    while (StackSize != 0) {
+        StackSize -= 1;
+        InstructionIndex = Dfa->Stack[StackSize];
+        while (TRUE) {
+            Index = Dfa->Sparse[InstructionIndex];
+            if ((Index < Count) && (Dfa->Dense[Index] == InstructionIndex)) {
+                break;
+            }
+
+            Dfa->Sparse[InstructionIndex] = Count;
+            Dfa->Dense[Count] = InstructionIndex;
+            Count += 1;
+            Instruction = &(Program->Instructions[InstructionIndex]);
+            if (Instruction->Opcode == RegexOpSplit) {
+
+                assert(StackSize < (Program->InstructionCount + 1) * 2);
+
+                Dfa->Stack[StackSize] = Instruction->Argument2;
+                StackSize += 1;
+                InstructionIndex = Instruction->Argument;
+
+            } else if (Instruction->Opcode == RegexOpJump) {
+                InstructionIndex = Instruction->Argument;
+
+            } else if (Instruction->Opcode == RegexOpSave) {
+                InstructionIndex += 1;
+
+            } else if (Instruction->Opcode == RegexOpAssert) {
+                if (!ClpRegexCheckAssertion(Instruction->Argument, Context)) {
+                    break;
+                }
+
+                InstructionIndex += 1;
+
+            } else {
+                if (Instruction->Opcode == RegexOpMatch) {
+                    Match = TRUE;
+                }
+
+                break;
+            }
+        }
+    }
+
+    Dfa->DenseCount = Count;
+    return Match;
+}
+
+ULONG
+ClpRegexDfaFindState (
+    PREGULAR_EXPRESSION_PROGRAM Program,
+    PREGEX_DFA Dfa,
+    ULONG Flags,
+    PULONG Kernel,
+    ULONG KernelCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine finds or creates the DFA state for the given kernel.
+
+Arguments:
+
+    Program - Supplies a pointer to the program.
+
+    Dfa - Supplies a pointer to the DFA.
+
+    Flags - Supplies the state flags (previous context and search flag).
+
+    Kernel - Supplies the sorted list of NFA instructions in the state.
+
+    KernelCount - Supplies the number of elements in the kernel.
+
+Return Value:
+
+    Returns the index of the state.
+
+    -1 if the cache is full.
+
+--*/
+
+{
+
+    ULONG Bucket;
+    ULONG Hash;
+    ULONG Index;
+    ULONG State;
+    PREGEX_DFA_STATE StateEntry;
+    ULONG Stride;
+
+    //
+    // Hash the state with FNV-1a.
+    //
+
+    Hash = 2166136261U;
+    Hash = (Hash ^ Flags) * 16777619U;
+    for (Index = 0; Index < KernelCount; Index += 1) {
+        Hash = (Hash ^ Kernel[Index]) * 16777619U;
+    }
+
+    Bucket = Hash % REGEX_DFA_HASH_SIZE;
+    State = Dfa->HashTable[Bucket];
+    while (State != 0) {
+        StateEntry = &(Dfa->States[State - 1]);
+        if ((StateEntry->Hash == Hash) &&
+            (StateEntry->Flags == Flags) &&
+            (StateEntry->KernelCount == KernelCount) &&
+            ((KernelCount == 0) ||
+             (memcmp(&(Dfa->Kernels[StateEntry->KernelOffset]),
+                     Kernel,
+                     KernelCount * sizeof(ULONG)) == 0))) {
+
+            return State - 1;
+        }
+
+        State = StateEntry->NextHash;
+    }
+
+    if ((Dfa->StateCount >= REGEX_DFA_MAX_STATES) ||
+        (Dfa->KernelSize + KernelCount > Dfa->KernelCapacity)) {
+
+        return (ULONG)-1;
+    }
+
+    State = Dfa->StateCount;
+    Dfa->StateCount += 1;
+    StateEntry = &(Dfa->States[State]);
+    StateEntry->Hash = Hash;
+    StateEntry->Flags = Flags;
+    StateEntry->KernelOffset = Dfa->KernelSize;
+    StateEntry->KernelCount = KernelCount;
+    StateEntry->NextHash = Dfa->HashTable[Bucket];
+    Dfa->HashTable[Bucket] = State + 1;
+    if (KernelCount != 0) {
+        memcpy(&(Dfa->Kernels[Dfa->KernelSize]),
+               Kernel,
+               KernelCount * sizeof(ULONG));
+
+        Dfa->KernelSize += KernelCount;
+    }
+
+    Stride = Program->ClassCount + REGEX_DFA_END_TRANSITIONS;
+    memset(&(Dfa->Transitions[State * Stride]), 0, Stride * sizeof(ULONG));
+    return State;
+}
+
+REGULAR_EXPRESSION_STATUS
+ClpRegexPikeSearch (
+    PREGULAR_EXPRESSION_PROGRAM Program,
+    PSTR String,
+    ULONG Length,
+    int Flags,
+    regoff_t *MatchCaptures
+    )
+
+/*++
+
+Routine Description:
+
+    This routine simulates the NFA program with a Pike VM, finding the
+    leftmost match and its subexpression positions. Threads are kept in
+    priority order, so the match found is the same one the backtracker would
+    find first.
+
+Arguments:
+
+    Program - Supplies a pointer to the program.
+
+    String - Supplies a pointer to the input string.
+
+    Length - Supplies the length of the input, not including the null
+        terminator.
+
+    Flags - Supplies the execution flags.
+
+    MatchCaptures - Supplies a pointer to an array of capture slots where the
+        match positions will be returned.
+
+Return Value:
+
+    Success if there was a match.
+
+    No match if there was no match.
+
+    No memory on allocation failure.
+
+--*/
+
+{
+
+    size_t AllocationSize;
+    PUCHAR Buffer;
+    UCHAR Byte;
+    regoff_t *Captures;
+    ULONG Context;
+    PREGEX_THREAD_LIST Current;
+    ULONG Index;
+    PREGEX_INSTRUCTION Instruction;
+    ULONG InstructionCount;
+    REGEX_THREAD_LIST Lists[2];
+    BOOL Matched;
+    PREGEX_THREAD_LIST Next;
+    ULONG NextContext;
+    ULONG Position;
+    ULONG SlotCount;
+    PREGEX_PIKE_STACK_ENTRY Stack;
+    PREGEX_THREAD_LIST Swap;
+    ULONG Thread;
+
+    InstructionCount = Program->InstructionCount;
+    SlotCount = Program->SlotCount;
+    AllocationSize = (((InstructionCount * 2) + 2) *
+                      sizeof(REGEX_PIKE_STACK_ENTRY)) +
+                     ((InstructionCount * SlotCount * 2) * sizeof(regoff_t)) +
+                     (SlotCount * sizeof(regoff_t)) +
+                     ((InstructionCount * 4) * sizeof(ULONG));
+
+    Buffer = malloc(AllocationSize);
+    if (Buffer == NULL) {
+        return RegexStatusNoMemory;
+    }
+
+    Stack = (PREGEX_PIKE_STACK_ENTRY)Buffer;
+    Buffer += ((InstructionCount * 2) + 2) * sizeof(REGEX_PIKE_STACK_ENTRY);
+    for (Index = 0; Index < 2; Index += 1) {
+        Lists[Index].Count = 0;
+        Lists[Index].Captures = (regoff_t *)Buffer;
+        Buffer += InstructionCount * SlotCount * sizeof(regoff_t);
+    }
+
+    Captures = (regoff_t *)Buffer;
+    Buffer += SlotCount * sizeof(regoff_t);
+    for (Index = 0; Index < 2; Index += 1) {
+        Lists[Index].Dense = (PULONG)Buffer;
+        Buffer += InstructionCount * sizeof(ULONG);
+        Lists[Index].Sparse = (PULONG)Buffer;
+        Buffer += InstructionCount * sizeof(ULONG);
+    }
+
+    Current = &(Lists[0]);
+    Next = &(Lists[1]);
+    Matched = FALSE;
+    Context = ClpRegexGetPreviousContext(Program, String, 0, Flags);
+    Position = 0;
+    while (TRUE) {
+        Context |= ClpRegexGetNextContext(Program,
+                                          String,
+                                          Position,
+                                          Length,
+                                          Flags);
+
+        //
+        // Start a new match attempt at the lowest priority, unless a match
+        // has already been found (which would be further left).
+        //
+
+        if ((Matched == FALSE) &&
+            ((Position == 0) || (Program->AnchoredStart == FALSE))) {
+
+            for (Index = 0; Index < SlotCount; Index += 1) {
+                Captures[Index] = -1;
+            }
+
+            ClpRegexPikeAddThread(Program,
+                                  Current,
+                                  Stack,
+                                  0,
+                                  Captures,
+                                  Position,
+                                  Context);
+        }
+
+        if (Current->Count == 0) {
+            if ((Matched != FALSE) || (Program->AnchoredStart != FALSE)) {
+                break;
+            }
+        }
+
+        //
+        // Step each thread over the current character in priority order.
+        //
+
+        Next->Count = 0;
+        Byte = String[Position];
+        NextContext = 0;
+        if (Position < Length) {
+            NextContext = ClpRegexGetPreviousContext(Program,
+                                                     String,
+                                                     Position + 1,
+                                                     Flags);
+
+            NextContext |= ClpRegexGetNextContext(Program,
+                                                  String,
+                                                  Position + 1,
+                                                  Length,
+                                                  Flags);
+        }
+
+        for (Thread = 0; Thread < Current->Count; Thread += 1) {
+            Index = Current->Dense[Thread];
+            Instruction = &(Program->Instructions[Index]);
+            if (Instruction->Opcode == RegexOpSet) {
+                if ((Position < Length) &&
+                    (REGEX_SET_CONTAINS(Program,
+                                        Instruction->Argument,
+                                        Byte))) {
+
+                    memcpy(Captures,
+                           &(Current->Captures[Thread * SlotCount]),
+                           SlotCount * sizeof(regoff_t));
+
+                    ClpRegexPikeAddThread(Program,
+                                          Next,
+                                          Stack,
+                                          Index + 1,
+                                          Captures,
+                                          Position + 1,
+                                          NextContext);
+                }
+
+            //
+            // A match cuts off all lower priority threads.
+            //
+
+            } else if (Instruction->Opcode == RegexOpMatch) {
+                memcpy(MatchCaptures,
+                       &(Current->Captures[Thread * SlotCount]),
+                       SlotCount * sizeof(regoff_t));
+
+                Matched = TRUE;
+                break;
+            }
+        }
+
+        if (Position == Length) {
+            break;
+        }
+
+        Swap = Current;
+        Current = Next;
+        Next = Swap;
+        Position += 1;
+        Context = ClpRegexGetPreviousContext(Program, String, Position, Flags);
+    }
+
+    free(Stack);
+    if (Matched != FALSE) {
+        return RegexStatusSuccess;
+    }
+
+    return RegexStatusNoMatch;
+}
+
+VOID
+ClpRegexPikeAddThread (
+    PREGULAR_EXPRESSION_PROGRAM Program,
+    PREGEX_THREAD_LIST List,
+    PREGEX_PIKE_STACK_ENTRY Stack,
+    ULONG Instruction,
+    regoff_t *Captures,
+    ULONG Position,
+    ULONG Context
+    )
+
+/*++
+
+Routine Description:
+
+    This routine adds a thread and everything reachable from it without
+    consuming input to a Pike VM thread list. Instructions already in the list
+    are skipped, as the thread that got there first has higher priority.
+
+Arguments:
+
+    Program - Supplies a pointer to the program.
+
+    List - Supplies a pointer to the list to add to.
+
+    Stack - Supplies a pointer to the work stack, which must be able to hold
+        twice the number of instructions.
+
+    Instruction - Supplies the instruction the thread is at.
+
+    Captures - Supplies the capture slots of the thread. This is used as
+        scratch space, but is restored by the time this routine returns.
+
+    Position - Supplies the current position in the input.
+
+    Context - Supplies the context bits around the current position.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Index;
+    PREGEX_INSTRUCTION Entry;
+    ULONG SlotCount;
+    ULONG StackSize;
+
+    SlotCount = Program->SlotCount;
+    Stack[0].Instruction = Instruction;
+    StackSize = 1;
+    while (StackSize != 0) {
+        StackSize -= 1;
+        Instruction = Stack[StackSize].Instruction;
+        if (Instruction == REGEX_PIKE_RESTORE) {
+            Captures[Stack[StackSize].Slot] = Stack[StackSize].Value;
+            continue;
+        }
+
+        while (TRUE) {
+            Index = List->Sparse[Instruction];
+            if ((Index < List->Count) &&
+                (List->Dense[Index] == Instruction)) {
+
+                break;
+            }
+
+            Index = List->Count;
+            List->Sparse[Instruction] = Index;
+            List->Dense[Index] = Instruction;
+            List->Count += 1;
+            Entry = &(Program->Instructions[Instruction]);
+            if (Entry->Opcode == RegexOpSplit) {
+                Stack[StackSize].Instruction = Entry->Argument2;
+                StackSize += 1;
+                Instruction = Entry->Argument;
+
+            } else if (Entry->Opcode == RegexOpJump) {
+                Instruction = Entry->Argument;
+
+            } else if (Entry->Opcode == RegexOpSave) {
+                Stack[StackSize].Instruction = REGEX_PIKE_RESTORE;
+                Stack[StackSize].Slot = Entry->Argument;
+                Stack[StackSize].Value = Captures[Entry->Argument];
+                StackSize += 1;
+                Captures[Entry->Argument] = Position;
+                Instruction += 1;
+
+            } else if (Entry->Opcode == RegexOpAssert) {
+                if (!ClpRegexCheckAssertion(Entry->Argument, Context)) {
+                    break;
+                }
+
+                Instruction += 1;
+
+            } else {
+
+                //
+                // Only threads sitting on instructions that consume input or
+                // match need to remember their captures.
+                //
+
+                memcpy(&(List->Captures[Index * SlotCount]),
+                       Captures,
+                       SlotCount * sizeof(regoff_t));
+
+                break;
+            }
+        }
+    }
+
+    return;
+}
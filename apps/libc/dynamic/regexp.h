@@ -200,6 +200,9 @@ typedef struct _REGULAR_BRACKET_EXPRESSION {
 typedef struct _REGULAR_EXPRESSION_ENTRY
     REGULAR_EXPRESSION_ENTRY, *PREGULAR_EXPRESSION_ENTRY;
 
+typedef struct _REGULAR_EXPRESSION_PROGRAM
+    REGULAR_EXPRESSION_PROGRAM, *PREGULAR_EXPRESSION_PROGRAM;
+
 /*++
 
 Structure Description:
@@ -270,12 +273,18 @@ Structure Description:
     BaseEntry - Stores the initial subexpression entry, a slightly modified
         subexpression.
 
+    Program - Stores an optional pointer to the automaton compiled from the
+        expression tree. This is NULL if the expression contains back
+        references or is too large, in which case the backtracking matcher
+        is used.
+
 --*/
 
 typedef struct _REGULAR_EXPRESSION {
     ULONG SubexpressionCount;
     ULONG Flags;
     REGULAR_EXPRESSION_ENTRY BaseEntry;
+    PREGULAR_EXPRESSION_PROGRAM Program;
 } REGULAR_EXPRESSION, *PREGULAR_EXPRESSION;
 
 //
@@ -285,3 +294,124 @@ typedef struct _REGULAR_EXPRESSION {
 //
 // -------------------------------------------------------- Function Prototypes
 //
+
+REGULAR_EXPRESSION_STATUS
+ClpCompileRegularExpressionProgram (
+    PREGULAR_EXPRESSION Expression
+    );
+
+/*++
+
+Routine Description:
+
+    This routine compiles the parsed expression tree into a Thompson NFA
+    program that can be executed in time linear to the input size. Expressions
+    containing back references cannot be represented this way, and are left
+    without a program.
+
+Arguments:
+
+    Expression - Supplies a pointer to the parsed regular expression.
+
+Return Value:
+
+    Success if a program was created or the expression is simply not suitable
+    for one.
+
+    No memory on allocation failure.
+
+--*/
+
+VOID
+ClpDestroyRegularExpressionProgram (
+    PREGULAR_EXPRESSION_PROGRAM Program
+    );
+
+/*++
+
+Routine Description:
+
+    This routine destroys a compiled regular expression program.
+
+Arguments:
+
+    Program - Supplies an optional pointer to the program to destroy.
+
+Return Value:
+
+    None.
+
+--*/
+
+REGULAR_EXPRESSION_STATUS
+ClpExecuteRegularExpressionProgram (
+    PREGULAR_EXPRESSION Expression,
+    PSTR String,
+    regmatch_t Match[],
+    size_t MatchArraySize,
+    int Flags
+    );
+
+/*++
+
+Routine Description:
+
+    This routine executes a regular expression using its compiled program. A
+    lazily constructed DFA decides whether or not there is a match, and a
+    Pike VM simulation of the NFA recovers the match positions if needed.
+
+Arguments:
+
+    Expression - Supplies a pointer to the regular expression, which must
+        have a program.
+
+    String - Supplies a pointer to the string to check for a match.
+
+    Match - Supplies an optional pointer to an array where the string indices
+        of the match and its subexpressions will be returned.
+
+    MatchArraySize - Supplies the number of elements in the match array.
+
+    Flags - Supplies a bitfield of flags governing the search. See REG_NOTBOL
+        and REG_NOTEOL.
+
+Return Value:
+
+    Success if there was a match.
+
+    No match if there was no match.
+
+    No memory on allocation failure.
+
+--*/
+
+BOOL
+ClpRegularExpressionMatchBracketCharacter (
+    PREGULAR_EXPRESSION Expression,
+    PREGULAR_EXPRESSION_ENTRY Entry,
+    CHAR Character
+    );
+
+/*++
+
+Routine Description:
+
+    This routine determines if the given character is matched by a bracket
+    expression.
+
+Arguments:
+
+    Expression - Supplies a pointer to the regular expression.
+
+    Entry - Supplies a pointer to the bracket expression entry.
+
+    Character - Supplies the character to test.
+
+Return Value:
+
+    TRUE if the bracket expression (including its negation) matches the
+    character.
+
+    FALSE if the character does not match.
+
+--*/
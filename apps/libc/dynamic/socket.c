@@ -130,6 +130,13 @@ Module Name:
 // ---------------------------------------------------------------- Definitions
 //
 
+//
+// Define the number of messages sendmmsg and recvmmsg hand to the kernel at
+// once. The translated headers for a batch live on the stack.
+//
+
+#define CL_SOCKET_MESSAGE_BATCH 16
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -154,6 +161,16 @@ ClpGetPathFromSocketAddress (
     PUINTN PathSize
     );
 
+int
+ClpPerformMultipleSocketIo (
+    int Socket,
+    struct mmsghdr *Messages,
+    unsigned int MessageCount,
+    int Flags,
+    ULONG Timeout,
+    BOOL Write
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -921,6 +938,54 @@ Return Value:
     return (ssize_t)(Parameters.BytesCompleted);
 }
 
+LIBC_API
+int
+sendmmsg (
+    int Socket,
+    struct mmsghdr *Messages,
+    unsigned int MessageCount,
+    int Flags
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sends several messages out of a socket with a single call
+    into the kernel. Each message is sent as if by sendmsg.
+
+Arguments:
+
+    Socket - Supplies the file descriptor of the socket to send data out of.
+
+    Messages - Supplies an array of messages to send. On return, the msg_len
+        member of each message sent is set to the number of bytes sent.
+
+    MessageCount - Supplies the number of elements in the message array.
+
+    Flags - Supplies a bitfield of flags governing the transmission of the data.
+        See MSG_* definitions.
+
+Return Value:
+
+    Returns the number of messages sent on success. If an error occurs after
+    at least one message was sent, the count is returned and the error is
+    reported by the next call.
+
+    -1 on error, and the errno variable will be set to contain more information.
+
+--*/
+
+{
+
+    return ClpPerformMultipleSocketIo(Socket,
+                                      Messages,
+                                      MessageCount,
+                                      Flags & ~MSG_WAITFORONE,
+                                      SYS_WAIT_TIME_INDEFINITE,
+                                      TRUE);
+}
+
 LIBC_API
 ssize_t
 recv (
@@ -1198,6 +1263,71 @@ Return Value:
     return (ssize_t)(Parameters.BytesCompleted);
 }
 
+LIBC_API
+int
+recvmmsg (
+    int Socket,
+    struct mmsghdr *Messages,
+    unsigned int MessageCount,
+    int Flags,
+    struct timespec *Timeout
+    )
+
+/*++
+
+Routine Description:
+
+    This routine receives several messages from a socket with a single call
+    into the kernel. Each message is received as if by recvmsg.
+
+Arguments:
+
+    Socket - Supplies the file descriptor of the socket to receive data from.
+
+    Messages - Supplies an array of initialized message headers where the
+        received messages will be returned. On return, the msg_len member of
+        each message received is set to the number of bytes received.
+
+    MessageCount - Supplies the number of elements in the message array.
+
+    Flags - Supplies a bitfield of flags governing the reception of the data.
+        See MSG_* definitions. Supply MSG_WAITFORONE to block only for the
+        first message.
+
+    Timeout - Supplies an optional pointer to the maximum amount of time to
+        wait for each message. Supply NULL to wait indefinitely.
+
+Return Value:
+
+    Returns the number of messages received on success. If an error occurs
+    after at least one message was received, the count is returned and the
+    error is reported by the next call.
+
+    -1 on error, and the errno variable will be set to contain more information.
+
+--*/
+
+{
+
+    INT Result;
+    ULONG TimeoutInMilliseconds;
+
+    Result = ClpConvertSpecificTimeoutToSystemTimeout(Timeout,
+                                                      &TimeoutInMilliseconds);
+
+    if (Result != 0) {
+        errno = Result;
+        return -1;
+    }
+
+    return ClpPerformMultipleSocketIo(Socket,
+                                      Messages,
+                                      MessageCount,
+                                      Flags,
+                                      TimeoutInMilliseconds,
+                                      FALSE);
+}
+
 LIBC_API
 int
 shutdown (
@@ -1983,6 +2113,218 @@ Return Value:
     return 0;
 }
 
+int
+ClpPerformMultipleSocketIo (
+    int Socket,
+    struct mmsghdr *Messages,
+    unsigned int MessageCount,
+    int Flags,
+    ULONG Timeout,
+    BOOL Write
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sends or receives several messages on a socket, handing them
+    to the kernel in batches.
+
+Arguments:
+
+    Socket - Supplies the file descriptor of the socket.
+
+    Messages - Supplies the array of messages to send or receive.
+
+    MessageCount - Supplies the number of elements in the message array.
+
+    Flags - Supplies a bitfield of flags governing the transfer. See MSG_*
+        definitions.
+
+    Timeout - Supplies the timeout in milliseconds to use for each message.
+
+    Write - Supplies a boolean indicating whether to send (TRUE) or receive
+        (FALSE) the messages.
+
+Return Value:
+
+    Returns the number of messages processed on success.
+
+    -1 on error, and the errno variable will be set to contain more information.
+
+--*/
+
+{
+
+    NETWORK_ADDRESS Addresses[CL_SOCKET_MESSAGE_BATCH];
+    UINTN BatchCompleted;
+    UINTN BatchCount;
+    UINTN BatchIndex;
+    unsigned int Completed;
+    struct mmsghdr *Current;
+    SOCKET_IO_MESSAGE IoMessages[CL_SOCKET_MESSAGE_BATCH];
+    struct msghdr *Message;
+    SOCKET_IO_PARAMETERS Parameters[CL_SOCKET_MESSAGE_BATCH];
+    PSOCKET_IO_PARAMETERS Parameter;
+    KSTATUS Status;
+    UINTN VectorIndex;
+
+    if ((Messages == NULL) && (MessageCount != 0)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    ASSERT_SOCKET_IO_FLAGS_ARE_EQUIVALENT();
+    ASSERT(MSG_WAITFORONE == SOCKET_IO_WAIT_FOR_ONE);
+
+    Completed = 0;
+    Status = STATUS_SUCCESS;
+    while (Completed < MessageCount) {
+        BatchCount = MessageCount - Completed;
+        if (BatchCount > CL_SOCKET_MESSAGE_BATCH) {
+            BatchCount = CL_SOCKET_MESSAGE_BATCH;
+        }
+
+        //
+        // Translate each message header into the kernel's form. This mirrors
+        // what sendmsg and recvmsg do for a single message.
+        //
+
+        for (BatchIndex = 0; BatchIndex < BatchCount; BatchIndex += 1) {
+            Message = &(Messages[Completed + BatchIndex].msg_hdr);
+            Parameter = &(Parameters[BatchIndex]);
+            Parameter->Size = 0;
+            for (VectorIndex = 0;
+                 VectorIndex < Message->msg_iovlen;
+                 VectorIndex += 1) {
+
+                Parameter->Size += Message->msg_iov[VectorIndex].iov_len;
+            }
+
+            if (Parameter->Size > (UINTN)SSIZE_MAX) {
+                Parameter->Size = (UINTN)SSIZE_MAX;
+            }
+
+            Parameter->BytesCompleted = 0;
+            Parameter->IoFlags = 0;
+            if (Write != FALSE) {
+                Parameter->IoFlags = SYS_IO_FLAG_WRITE;
+            }
+
+            Parameter->SocketIoFlags = Flags;
+            Parameter->TimeoutInMilliseconds = Timeout;
+            Parameter->NetworkAddress = NULL;
+            Parameter->RemotePath = NULL;
+            Parameter->RemotePathSize = 0;
+            if ((Message->msg_name != NULL) && (Message->msg_namelen != 0)) {
+                if (Write != FALSE) {
+                    Status = ClConvertToNetworkAddress(
+                                              Message->msg_name,
+                                              Message->msg_namelen,
+                                              &(Addresses[BatchIndex]),
+                                              &(Parameter->RemotePath),
+                                              &(Parameter->RemotePathSize));
+
+                    if (!KSUCCESS(Status)) {
+                        break;
+                    }
+
+                } else {
+                    Addresses[BatchIndex].Domain = NetDomainInvalid;
+                    ClpGetPathFromSocketAddress(
+                                              Message->msg_name,
+                                              &(Message->msg_namelen),
+                                              &(Parameter->RemotePath),
+                                              &(Parameter->RemotePathSize));
+                }
+
+                Parameter->NetworkAddress = &(Addresses[BatchIndex]);
+            }
+
+            Parameter->ControlData = Message->msg_control;
+            Parameter->ControlDataSize = Message->msg_controllen;
+            IoMessages[BatchIndex].Parameters = Parameter;
+            IoMessages[BatchIndex].VectorArray = (PIO_VECTOR)(Message->msg_iov);
+            IoMessages[BatchIndex].VectorCount = Message->msg_iovlen;
+        }
+
+        //
+        // A bad destination address ends the batch early. Send what came
+        // before it, and fail the call only if it was the very first message.
+        //
+
+        if (BatchIndex != BatchCount) {
+            if (BatchIndex == 0) {
+                if (Completed == 0) {
+                    errno = EINVAL;
+                    return -1;
+                }
+
+                break;
+            }
+
+            BatchCount = BatchIndex;
+        }
+
+        BatchCompleted = 0;
+        Status = OsSocketPerformMultipleIo((HANDLE)(UINTN)Socket,
+                                           IoMessages,
+                                           BatchCount,
+                                           &BatchCompleted);
+
+        for (BatchIndex = 0; BatchIndex < BatchCompleted; BatchIndex += 1) {
+            Current = &(Messages[Completed + BatchIndex]);
+            Message = &(Current->msg_hdr);
+            Parameter = &(Parameters[BatchIndex]);
+            Current->msg_len = (unsigned int)(Parameter->BytesCompleted);
+
+            if (Write != FALSE) {
+                continue;
+            }
+
+            Message->msg_flags = Parameter->SocketIoFlags;
+            Message->msg_controllen = Parameter->ControlDataSize;
+            if ((Message->msg_name != NULL) && (Message->msg_namelen != 0)) {
+                ClConvertFromNetworkAddress(&(Addresses[BatchIndex]),
+                                            Message->msg_name,
+                                            &(Message->msg_namelen),
+                                            Parameter->RemotePath,
+                                            Parameter->RemotePathSize);
+            }
+        }
+
+        Completed += BatchCompleted;
+        if ((!KSUCCESS(Status)) || (BatchCompleted != BatchCount)) {
+            break;
+        }
+
+        //
+        // Once something has arrived, waiting for one means the remaining
+        // batches must not block.
+        //
+
+        if ((Flags & MSG_WAITFORONE) != 0) {
+            Flags |= MSG_DONTWAIT;
+        }
+    }
+
+    if ((Completed == 0) &&
+        (!KSUCCESS(Status)) &&
+        (Status != STATUS_END_OF_FILE)) {
+
+        if (Status == STATUS_NOT_SUPPORTED) {
+            errno = EOPNOTSUPP;
+
+        } else {
+            errno = ClConvertKstatusToErrorNumber(Status);
+        }
+
+        return -1;
+    }
+
+    return Completed;
+}
+
 VOID
 ClpGetPathFromSocketAddress (
     struct sockaddr *Address,
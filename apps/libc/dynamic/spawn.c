@@ -35,6 +35,7 @@ Module Name:
 #include <fcntl.h>
 #include <spawn.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
@@ -42,6 +43,13 @@ Module Name:
 // ---------------------------------------------------------------- Definitions
 //
 
+//
+// Define the internal error value used to indicate that a spawn should be
+// retried with a full fork.
+//
+
+#define POSIX_SPAWN_USE_FORK (-1)
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -195,6 +203,34 @@ typedef struct _POSIX_SPAWN_FILE_ENTRY {
 
 } POSIX_SPAWN_FILE_ENTRY, *PPOSIX_SPAWN_FILE_ENTRY;
 
+/*++
+
+Structure Description:
+
+    This structure stores the state shared between the parent and a vfork
+    child during a spawn. It lives in the parent's stack frame.
+
+Members:
+
+    FileActions - Stores an optional pointer to the file actions to perform.
+
+    Attributes - Stores an optional pointer to the attributes to apply.
+
+    Environment - Stores a pointer to the environment to execute, which is
+        created before the child is forked.
+
+    Error - Stores the error the child encountered, if any. The child shares
+        the parent's memory until it executes, so the parent sees this value.
+
+--*/
+
+typedef struct _POSIX_SPAWN_CONTEXT {
+    PPOSIX_SPAWN_FILE_ACTION FileActions;
+    PPOSIX_SPAWN_ATTRIBUTES Attributes;
+    PPROCESS_ENVIRONMENT Environment;
+    volatile INT Error;
+} POSIX_SPAWN_CONTEXT, *PPOSIX_SPAWN_CONTEXT;
+
 //
 // ----------------------------------------------- Internal Function Prototypes
 //
@@ -210,6 +246,28 @@ ClpPosixSpawn (
     BOOL UsePath
     );
 
+INT
+ClpPosixSpawnShared (
+    pid_t *ChildPid,
+    const char *Path,
+    PPOSIX_SPAWN_FILE_ACTION *FileActions,
+    PPOSIX_SPAWN_ATTRIBUTES *Attributes,
+    char *const Arguments[],
+    char *const Environment[],
+    BOOL UsePath
+    );
+
+__NOINLINE
+INTN
+ClpPosixSpawnVfork (
+    PPOSIX_SPAWN_CONTEXT Context
+    );
+
+PSTR
+ClpFindSpawnPath (
+    const char *File
+    );
+
 INT
 ClpProcessSpawnAttributes (
     PPOSIX_SPAWN_ATTRIBUTES Attributes
@@ -1184,22 +1242,36 @@ Return Value:
 
 {
 
-    volatile int Error;
+    INT Error;
     pid_t Pid;
 
     //
-    // TODO: Use vfork when it is implemented.
+    // Try the quick route first, where the child borrows this process'
+    // address space until it executes the image. Fall back to a full fork if
+    // that cannot do the job.
     //
 
+    Error = ClpPosixSpawnShared(ChildPid,
+                                Path,
+                                FileActions,
+                                Attributes,
+                                Arguments,
+                                Environment,
+                                UsePath);
+
+    if (Error != POSIX_SPAWN_USE_FORK) {
+        return Error;
+    }
+
     Error = 0;
     Pid = fork();
     if (Pid == -1) {
         return errno;
 
     //
-    // In the child, process the attributes and execute the image. With vfork,
-    // the values set in error here will be accessible by the parent, since
-    // vfork temporarily shares the memory of the parent.
+    // In the child, process the attributes and execute the image. The child
+    // has its own copy of memory, so failures are only visible to the parent
+    // through the exit status.
     //
 
     } else if (Pid == 0) {
@@ -1232,7 +1304,6 @@ Return Value:
         // Oops, getting this far means exec didn't succeed. Fail.
         //
 
-        Error = errno;
         _exit(127);
 
     //
@@ -1240,26 +1311,323 @@ Return Value:
     //
 
     } else {
+        if (ChildPid != NULL) {
+            *ChildPid = Pid;
+        }
+    }
+
+    return Error;
+}
+
+INT
+ClpPosixSpawnShared (
+    pid_t *ChildPid,
+    const char *Path,
+    PPOSIX_SPAWN_FILE_ACTION *FileActions,
+    PPOSIX_SPAWN_ATTRIBUTES *Attributes,
+    char *const Arguments[],
+    char *const Environment[],
+    BOOL UsePath
+    )
+
+/*++
+
+Routine Description:
+
+    This routine executes the posix spawn function with a vfork child, which
+    borrows this process' address space until it executes the new image
+    rather than copying the whole address space only to throw it away.
+    Anything that needs memory is prepared here in the parent, since
+    allocations made by the child would leak into the parent's heap.
+
+Arguments:
+
+    ChildPid - Supplies an optional pointer where the child process ID will be
+        returned on success.
+
+    Path - Supplies a pointer to the file path to execute.
+
+    FileActions - Supplies an optional pointer to the file actions to execute
+        in the child.
+
+    Attributes - Supplies an optional pointer to the spawn attributes.
+
+    Arguments - Supplies the arguments to pass to the new child.
+
+    Environment - Supplies the environment to pass to the new child.
+
+    UsePath - Supplies a boolean indicating whether to search the PATH for the
+        executable or just use the path as given.
+
+Return Value:
+
+    0 on success.
+
+    POSIX_SPAWN_USE_FORK if the spawn should be retried with a full fork.
+
+    Returns an error number on failure.
+
+--*/
+
+{
+
+    UINTN ArgumentCount;
+    UINTN ArgumentsLength;
+    POSIX_SPAWN_CONTEXT Context;
+    UINTN EnvironmentCount;
+    UINTN EnvironmentLength;
+    INT Error;
+    PSTR FullPath;
+    INTN Result;
+
+    Context.Attributes = NULL;
+    Context.Environment = NULL;
+    Context.Error = 0;
+    Context.FileActions = NULL;
+    FullPath = NULL;
+    if (Attributes != NULL) {
+        Context.Attributes = *Attributes;
 
         //
-        // If the child had a problem, then with vfork the error variable will
-        // be set, and this routine can return a more detailed status. Reap the
-        // child here.
+        // Resetting the IDs updates identity information cached in this
+        // process' memory, which a vfork child must not touch.
         //
 
-        if (Error != 0) {
-            waitpid(Pid, NULL, 0);
+        if ((Context.Attributes->Flags & POSIX_SPAWN_RESETIDS) != 0) {
+            return POSIX_SPAWN_USE_FORK;
+        }
+    }
+
+    if (FileActions != NULL) {
+        Context.FileActions = *FileActions;
+    }
 
-        } else {
-            if (ChildPid != NULL) {
-                *ChildPid = Pid;
-            }
+    if (UsePath != FALSE) {
+        FullPath = ClpFindSpawnPath(Path);
+        if (FullPath == NULL) {
+            return POSIX_SPAWN_USE_FORK;
+        }
+
+        Path = FullPath;
+    }
+
+    if (Environment == NULL) {
+        Environment = environ;
+    }
+
+    ArgumentCount = 0;
+    ArgumentsLength = 0;
+    while (Arguments[ArgumentCount] != NULL) {
+        ArgumentsLength += strlen(Arguments[ArgumentCount]) + 1;
+        ArgumentCount += 1;
+    }
+
+    EnvironmentCount = 0;
+    EnvironmentLength = 0;
+    if (Environment != NULL) {
+        while (Environment[EnvironmentCount] != NULL) {
+            EnvironmentLength += strlen(Environment[EnvironmentCount]) + 1;
+            EnvironmentCount += 1;
         }
     }
 
+    Context.Environment = OsCreateEnvironment((PSTR)Path,
+                                              strlen(Path) + 1,
+                                              (PSTR *)Arguments,
+                                              ArgumentsLength,
+                                              ArgumentCount,
+                                              (PSTR *)Environment,
+                                              EnvironmentLength,
+                                              EnvironmentCount);
+
+    if (Context.Environment == NULL) {
+        Error = ENOMEM;
+        goto PosixSpawnSharedEnd;
+    }
+
+    Result = ClpPosixSpawnVfork(&Context);
+    if (Result < 0) {
+        Error = ClConvertKstatusToErrorNumber(Result);
+        goto PosixSpawnSharedEnd;
+    }
+
+    //
+    // If the child had a problem before executing the image, reap it here
+    // and return its error.
+    //
+
+    Error = Context.Error;
+    if (Error != 0) {
+        waitpid(Result, NULL, 0);
+        goto PosixSpawnSharedEnd;
+    }
+
+    if (ChildPid != NULL) {
+        *ChildPid = Result;
+    }
+
+PosixSpawnSharedEnd:
+    if (Context.Environment != NULL) {
+        OsDestroyEnvironment(Context.Environment);
+    }
+
+    if (FullPath != NULL) {
+        free(FullPath);
+    }
+
     return Error;
 }
 
+__NOINLINE
+INTN
+ClpPosixSpawnVfork (
+    PPOSIX_SPAWN_CONTEXT Context
+    )
+
+/*++
+
+Routine Description:
+
+    This routine creates a vfork child and runs the child side of a spawn.
+    The child runs on this stack in the parent's memory, so it must never
+    return from this routine, and may only communicate through the context.
+    The kernel preserves the stack below the context, which lives in the
+    caller's frame, so this routine can safely return in the parent.
+
+Arguments:
+
+    Context - Supplies a pointer to the spawn context.
+
+Return Value:
+
+    Returns the process ID of the child in the parent on success.
+
+    Returns a negative status code on failure.
+
+--*/
+
+{
+
+    INT Error;
+    INTN Result;
+    KSTATUS Status;
+
+    Result = OsForkProcess(FORK_FLAG_VFORK, Context);
+    if (Result != 0) {
+        return Result;
+    }
+
+    Error = 0;
+    if (Context->Attributes != NULL) {
+        Error = ClpProcessSpawnAttributes(Context->Attributes);
+    }
+
+    if ((Error == 0) && (Context->FileActions != NULL)) {
+        Error = ClpProcessSpawnFileActions(Context->FileActions);
+    }
+
+    //
+    // Execute the image. If it is not a binary the kernel understands, let
+    // the full fork figure out which interpreter should run it.
+    //
+
+    if (Error == 0) {
+        Status = OsExecuteImage(Context->Environment);
+        if (Status == STATUS_UNKNOWN_IMAGE_FORMAT) {
+            Error = POSIX_SPAWN_USE_FORK;
+
+        } else {
+            Error = ClConvertKstatusToErrorNumber(Status);
+        }
+    }
+
+    Context->Error = Error;
+    _exit(127);
+}
+
+PSTR
+ClpFindSpawnPath (
+    const char *File
+    )
+
+/*++
+
+Routine Description:
+
+    This routine searches the PATH for the given executable the same way the
+    exec*p functions do.
+
+Arguments:
+
+    File - Supplies a pointer to the name of the executable, which will be
+        searched for on the PATH if the string does not contain a slash.
+
+Return Value:
+
+    Returns a pointer to the path of the executable on success. The caller is
+    responsible for freeing this memory.
+
+    NULL if the executable was not found or on allocation failure.
+
+--*/
+
+{
+
+    PSTR CombinedPath;
+    size_t FileLength;
+    PSTR PathCopy;
+    PSTR PathEntry;
+    size_t PathEntryLength;
+    PSTR PathVariable;
+    char *Token;
+
+    PathVariable = getenv("PATH");
+    if ((strchr(File, '/') != NULL) || (PathVariable == NULL) ||
+        (*PathVariable == '\0')) {
+
+        return strdup(File);
+    }
+
+    PathCopy = strdup(PathVariable);
+    if (PathCopy == NULL) {
+        return NULL;
+    }
+
+    CombinedPath = NULL;
+    FileLength = strlen(File);
+    PathEntry = strtok_r(PathCopy, ":", &Token);
+    while (PathEntry != NULL) {
+        PathEntryLength = strlen(PathEntry);
+        if (PathEntryLength == 0) {
+            PathEntry = ".";
+            PathEntryLength = 1;
+        }
+
+        if (PathEntry[PathEntryLength - 1] == '/') {
+            PathEntryLength -= 1;
+        }
+
+        CombinedPath = malloc(PathEntryLength + FileLength + 2);
+        if (CombinedPath == NULL) {
+            break;
+        }
+
+        memcpy(CombinedPath, PathEntry, PathEntryLength);
+        CombinedPath[PathEntryLength] = '/';
+        strcpy(CombinedPath + PathEntryLength + 1, File);
+        if (access(CombinedPath, X_OK) == 0) {
+            break;
+        }
+
+        free(CombinedPath);
+        CombinedPath = NULL;
+        PathEntry = strtok_r(NULL, ":", &Token);
+    }
+
+    free(PathCopy);
+    return CombinedPath;
+}
+
 INT
 ClpProcessSpawnAttributes (
     PPOSIX_SPAWN_ATTRIBUTES Attributes
@@ -1286,8 +1654,7 @@ Return Value:
 
 {
 
-    struct sigaction Action;
-    int Signal;
+    SIGNAL_SET DefaultSignals;
 
     if ((Attributes->Flags & POSIX_SPAWN_SETPGROUP) != 0) {
         if (setpgid(0, Attributes->ProcessGroup) != 0) {
@@ -1317,19 +1684,23 @@ Return Value:
 
     //
     // If desired, reset any signals mentioned in the default mask back to
-    // the default disposition.
+    // the default disposition. Tell the kernel directly rather than going
+    // through sigaction, since a vfork child must not modify the handler
+    // table in its parent's memory. The new image starts with a fresh table.
     //
 
     if ((Attributes->Flags & POSIX_SPAWN_SETSIGDEF) != 0) {
-        memset(&Action, 0, sizeof(Action));
-        Action.sa_handler = SIG_DFL;
-        for (Signal = 1; Signal < NSIG; Signal += 1) {
-            if (sigismember(&(Attributes->DefaultMask), Signal) != 0) {
-                if (sigaction(Signal, &Action, NULL) != 0) {
-                    return errno;
-                }
-            }
-        }
+
+        assert(sizeof(SIGNAL_SET) == sizeof(sigset_t));
+
+        memcpy(&DefaultSignals, &(Attributes->DefaultMask), sizeof(sigset_t));
+        OsSetSignalBehavior(SignalMaskHandled,
+                            SignalMaskOperationClear,
+                            &DefaultSignals);
+
+        OsSetSignalBehavior(SignalMaskIgnored,
+                            SignalMaskOperationClear,
+                            &DefaultSignals);
     }
 
     return 0;
@@ -37,14 +37,53 @@ Module Name:
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__SSE2__)
+
+#include <emmintrin.h>
+
+#endif
+
 //
 // ---------------------------------------------------------------- Definitions
 //
 
+//
+// Define constants used to scan memory a word at a time. Subtracting one from
+// every byte of a word and masking with the inverted word leaves the high bit
+// set in any byte that was zero. Bytes above the first zero byte may also be
+// flagged, which doesn't matter since the routines always finish by scanning
+// the final word a byte at a time.
+//
+
+#define LIBC_WORD_SIZE sizeof(LIBC_WORD)
+#define LIBC_WORD_MASK (LIBC_WORD_SIZE - 1)
+#define LIBC_WORD_ONES ((LIBC_WORD)-1 / 0xFF)
+#define LIBC_WORD_HIGHS (LIBC_WORD_ONES << 7)
+
+#define LIBC_WORD_HAS_ZERO(_Word) \
+    ((((_Word) - LIBC_WORD_ONES) & ~(_Word) & LIBC_WORD_HIGHS) != 0)
+
+//
+// Define the size of an SSE2 register, which is used to scan sixteen bytes at
+// a time when the compiler is targeting a processor that has SSE2. Aligned
+// loads never cross a page boundary, so reading past the end of a string
+// within an aligned block is safe.
+//
+
+#define LIBC_VECTOR_SIZE 16
+#define LIBC_VECTOR_MASK (LIBC_VECTOR_SIZE - 1)
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
 
+//
+// Define the type used to access buffers a word at a time. It is marked as
+// being able to alias anything since the buffers are really arrays of char.
+//
+
+typedef UINTN __attribute__((__may_alias__)) LIBC_WORD;
+
 //
 // ----------------------------------------------- Internal Function Prototypes
 //
@@ -98,15 +137,88 @@ Return Value:
 
 {
 
-    PSTR CharacterBuffer;
+    const unsigned char *Bytes;
+
+#if defined(__SSE2__)
+
+    __m128i Compare;
+    int Match;
+    __m128i Needle;
+
+#else
+
+    LIBC_WORD Pattern;
+    LIBC_WORD Word;
+
+#endif
+
+    Bytes = Buffer;
+    Character = (unsigned char)Character;
+
+#if defined(__SSE2__)
+
+    //
+    // Scan bytes until the buffer is aligned, then compare sixteen bytes at a
+    // time.
+    //
+
+    while ((Size != 0) && (((UINTN)Bytes & LIBC_VECTOR_MASK) != 0)) {
+        if (*Bytes == Character) {
+            return (void *)Bytes;
+        }
+
+        Bytes += 1;
+        Size -= 1;
+    }
+
+    Needle = _mm_set1_epi8(Character);
+    while (Size >= LIBC_VECTOR_SIZE) {
+        Compare = _mm_cmpeq_epi8(*(const __m128i *)Bytes, Needle);
+        Match = _mm_movemask_epi8(Compare);
+
+        if (Match != 0) {
+            return (void *)(Bytes + RtlCountTrailingZeros32(Match));
+        }
+
+        Bytes += LIBC_VECTOR_SIZE;
+        Size -= LIBC_VECTOR_SIZE;
+    }
+
+#else
+
+    //
+    // Scan bytes until the buffer is aligned, then look for a word that
+    // contains the character.
+    //
+
+    while ((Size != 0) && (((UINTN)Bytes & LIBC_WORD_MASK) != 0)) {
+        if (*Bytes == Character) {
+            return (void *)Bytes;
+        }
+
+        Bytes += 1;
+        Size -= 1;
+    }
+
+    Pattern = LIBC_WORD_ONES * Character;
+    while (Size >= LIBC_WORD_SIZE) {
+        Word = *(const LIBC_WORD *)Bytes ^ Pattern;
+        if (LIBC_WORD_HAS_ZERO(Word)) {
+            break;
+        }
+
+        Bytes += LIBC_WORD_SIZE;
+        Size -= LIBC_WORD_SIZE;
+    }
+
+#endif
 
-    CharacterBuffer = (PSTR)Buffer;
     while (Size != 0) {
-        if ((unsigned char)*CharacterBuffer == (unsigned char)Character) {
-            return CharacterBuffer;
+        if (*Bytes == Character) {
+            return (void *)Bytes;
         }
 
-        CharacterBuffer += 1;
+        Bytes += 1;
         Size -= 1;
     }
 
@@ -147,21 +259,51 @@ Return Value:
 
 {
 
-    int Difference;
-    size_t Index;
-    unsigned char *LeftCharacters;
-    unsigned char *RightCharacters;
-
-    LeftCharacters = (unsigned char *)Left;
-    RightCharacters = (unsigned char *)Right;
-    for (Index = 0; Index < Size; Index += 1) {
-        Difference = *LeftCharacters - *RightCharacters;
-        if (Difference != 0) {
-            return Difference;
+    const unsigned char *LeftCharacters;
+    const unsigned char *RightCharacters;
+
+    LeftCharacters = Left;
+    RightCharacters = Right;
+
+    //
+    // If the buffers are aligned the same way, compare the leading bytes and
+    // then skip over equal words. The differing word, if any, is picked apart
+    // below.
+    //
+
+    if ((((UINTN)LeftCharacters ^ (UINTN)RightCharacters) &
+         LIBC_WORD_MASK) == 0) {
+
+        while ((Size != 0) &&
+               (((UINTN)LeftCharacters & LIBC_WORD_MASK) != 0)) {
+
+            if (*LeftCharacters != *RightCharacters) {
+                return *LeftCharacters - *RightCharacters;
+            }
+
+            LeftCharacters += 1;
+            RightCharacters += 1;
+            Size -= 1;
+        }
+
+        while ((Size >= LIBC_WORD_SIZE) &&
+               (*(const LIBC_WORD *)LeftCharacters ==
+                *(const LIBC_WORD *)RightCharacters)) {
+
+            LeftCharacters += LIBC_WORD_SIZE;
+            RightCharacters += LIBC_WORD_SIZE;
+            Size -= LIBC_WORD_SIZE;
+        }
+    }
+
+    while (Size != 0) {
+        if (*LeftCharacters != *RightCharacters) {
+            return *LeftCharacters - *RightCharacters;
         }
 
         LeftCharacters += 1;
         RightCharacters += 1;
+        Size -= 1;
     }
 
     return 0;
@@ -237,14 +379,38 @@ Return Value:
 
     //
     // Copy the bytes backwards if the source begins before the destination
-    // and overlaps.
+    // and overlaps. If the buffers share an alignment, then most of the copy
+    // can go a word at a time. The buffers are then at least a word apart, so
+    // a word read from the source is never clobbered by an earlier write.
     //
 
     if ((Source < Destination) && (Source + ByteCount > Destination)) {
-        DestinationBytes = Destination;
-        SourceBytes = (PCHAR)Source;
+        DestinationBytes = (PCHAR)Destination + ByteCount;
+        SourceBytes = (PCHAR)Source + ByteCount;
+        if ((((UINTN)DestinationBytes ^ (UINTN)SourceBytes) &
+             LIBC_WORD_MASK) == 0) {
+
+            while ((ByteCount != 0) &&
+                   (((UINTN)DestinationBytes & LIBC_WORD_MASK) != 0)) {
+
+                DestinationBytes -= 1;
+                SourceBytes -= 1;
+                *DestinationBytes = *SourceBytes;
+                ByteCount -= 1;
+            }
+
+            while (ByteCount >= LIBC_WORD_SIZE) {
+                DestinationBytes -= LIBC_WORD_SIZE;
+                SourceBytes -= LIBC_WORD_SIZE;
+                *(LIBC_WORD *)DestinationBytes = *(LIBC_WORD *)SourceBytes;
+                ByteCount -= LIBC_WORD_SIZE;
+            }
+        }
+
         while (ByteCount != 0) {
-            DestinationBytes[ByteCount - 1] = SourceBytes[ByteCount - 1];
+            DestinationBytes -= 1;
+            SourceBytes -= 1;
+            *DestinationBytes = *SourceBytes;
             ByteCount -= 1;
         }
 
@@ -484,16 +650,52 @@ Return Value:
 
 {
 
+    const unsigned char *Bytes;
+    LIBC_WORD Pattern;
+    LIBC_WORD Word;
+
+    Bytes = (const unsigned char *)String;
+    Character = (unsigned char)Character;
+
+    //
+    // Scan bytes until the string is aligned, then skip over words that
+    // contain neither the character nor the terminator.
+    //
+
+    while (((UINTN)Bytes & LIBC_WORD_MASK) != 0) {
+        if (*Bytes == Character) {
+            return (char *)Bytes;
+        }
+
+        if (*Bytes == '\0') {
+            return NULL;
+        }
+
+        Bytes += 1;
+    }
+
+    Pattern = LIBC_WORD_ONES * Character;
     while (TRUE) {
-        if (*String == (char)Character) {
-            return (char *)String;
+        Word = *(const LIBC_WORD *)Bytes;
+        if ((LIBC_WORD_HAS_ZERO(Word)) ||
+            (LIBC_WORD_HAS_ZERO(Word ^ Pattern))) {
+
+            break;
         }
 
-        if (*String == '\0') {
+        Bytes += LIBC_WORD_SIZE;
+    }
+
+    while (TRUE) {
+        if (*Bytes == Character) {
+            return (char *)Bytes;
+        }
+
+        if (*Bytes == '\0') {
             break;
         }
 
-        String += 1;
+        Bytes += 1;
     }
 
     return NULL;
@@ -571,7 +773,66 @@ Return Value:
 
 {
 
-    return RtlStringLength((PSTR)String);
+#if defined(__SSE2__)
+
+    int Match;
+    UINTN Offset;
+    const __m128i *Vector;
+    __m128i Zero;
+
+    //
+    // Round down to an aligned block, ignoring any terminators that come
+    // before the string starts, and then scan sixteen bytes at a time.
+    //
+
+    Offset = (UINTN)String & LIBC_VECTOR_MASK;
+    Vector = (const __m128i *)(String - Offset);
+    Zero = _mm_setzero_si128();
+    Match = _mm_movemask_epi8(_mm_cmpeq_epi8(*Vector, Zero)) >> Offset;
+    if (Match != 0) {
+        return RtlCountTrailingZeros32(Match);
+    }
+
+    while (TRUE) {
+        Vector += 1;
+        Match = _mm_movemask_epi8(_mm_cmpeq_epi8(*Vector, Zero));
+        if (Match != 0) {
+            break;
+        }
+    }
+
+    return ((const char *)Vector - String) + RtlCountTrailingZeros32(Match);
+
+#else
+
+    const char *Current;
+
+    //
+    // Scan bytes until the string is aligned, then skip over words that have
+    // no terminator in them.
+    //
+
+    Current = String;
+    while (((UINTN)Current & LIBC_WORD_MASK) != 0) {
+        if (*Current == '\0') {
+            return Current - String;
+        }
+
+        Current += 1;
+    }
+
+    while (!LIBC_WORD_HAS_ZERO(*(const LIBC_WORD *)Current)) {
+        Current += LIBC_WORD_SIZE;
+    }
+
+    while (*Current != '\0') {
+        Current += 1;
+    }
+
+    return Current - String;
+
+#endif
+
 }
 
 LIBC_API
@@ -604,14 +865,14 @@ Return Value:
 
 {
 
-    size_t Size;
+    const char *Terminator;
 
-    Size = 0;
-    while ((Size < MaxLength) && (String[Size] != '\0')) {
-        Size += 1;
+    Terminator = memchr(String, '\0', MaxLength);
+    if (Terminator == NULL) {
+        return MaxLength;
     }
 
-    return Size;
+    return Terminator - String;
 }
 
 LIBC_API
@@ -645,16 +906,10 @@ Return Value:
 
 {
 
-    char *Current;
-
-    Current = DestinationString;
-    while (*SourceString != '\0') {
-        *Current = *SourceString;
-        Current += 1;
-        SourceString += 1;
-    }
+    RtlCopyMemory(DestinationString,
+                  (PVOID)SourceString,
+                  strlen(SourceString) + 1);
 
-    *Current = '\0';
     return DestinationString;
 }
 
@@ -689,17 +944,11 @@ Return Value:
 
 {
 
-    while (TRUE) {
-        *DestinationString = *SourceString;
-        if (*DestinationString == '\0') {
-            break;
-        }
-
-        DestinationString += 1;
-        SourceString += 1;
-    }
+    size_t Length;
 
-    return DestinationString;
+    Length = strlen(SourceString);
+    RtlCopyMemory(DestinationString, (PVOID)SourceString, Length + 1);
+    return DestinationString + Length;
 }
 
 LIBC_API
@@ -1026,6 +1275,45 @@ Return Value:
 
 {
 
+    LIBC_WORD Word;
+
+    //
+    // If the strings share an alignment, compare the leading bytes and then
+    // skip over words that are equal and have no terminator. The word that
+    // stopped the scan is picked apart below.
+    //
+
+    if ((((UINTN)String1 ^ (UINTN)String2) & LIBC_WORD_MASK) == 0) {
+        while ((CharacterCount != 0) &&
+               (((UINTN)String1 & LIBC_WORD_MASK) != 0)) {
+
+            if (*String1 != *String2) {
+                return (unsigned char)*String1 - (unsigned char)*String2;
+            }
+
+            if (*String1 == '\0') {
+                return 0;
+            }
+
+            String1 += 1;
+            String2 += 1;
+            CharacterCount -= 1;
+        }
+
+        while (CharacterCount >= LIBC_WORD_SIZE) {
+            Word = *(const LIBC_WORD *)String1;
+            if ((Word != *(const LIBC_WORD *)String2) ||
+                (LIBC_WORD_HAS_ZERO(Word))) {
+
+                break;
+            }
+
+            String1 += LIBC_WORD_SIZE;
+            String2 += LIBC_WORD_SIZE;
+            CharacterCount -= LIBC_WORD_SIZE;
+        }
+    }
+
     while (CharacterCount != 0) {
         if (*String1 != *String2) {
             return (unsigned char)*String1 - (unsigned char)*String2;
@@ -68,6 +68,13 @@ TestQuickSortCompare (
     const void *Right
     );
 
+int
+TestQuickSortCompareWithArgument (
+    const void *Left,
+    const void *Right,
+    void *Argument
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -103,6 +110,7 @@ Return Value:
 
     PULONG Array;
     ULONG Case;
+    int Direction;
     ULONG Failures;
     ULONG Index;
 
@@ -228,6 +236,53 @@ Return Value:
                                   TEST_QUICKSORT_ARRAY_COUNT,
                                   FALSE);
 
+    Case += 1;
+
+    //
+    // Try an organ pipe: ascending then descending.
+    //
+
+    for (Index = 0; Index < TEST_QUICKSORT_ARRAY_COUNT; Index += 1) {
+        Array[Index] = Index;
+        if (Index >= TEST_QUICKSORT_ARRAY_COUNT / 2) {
+            Array[Index] = TEST_QUICKSORT_ARRAY_COUNT - Index - 1;
+        }
+    }
+
+    Failures += TestQuickSortCase(Case,
+                                  Array,
+                                  TEST_QUICKSORT_ARRAY_COUNT,
+                                  FALSE);
+
+    Case += 1;
+
+    //
+    // Sort in reverse with qsort_r, using the argument to flip the order.
+    //
+
+    Direction = -1;
+    for (Index = 0; Index < TEST_QUICKSORT_ARRAY_COUNT; Index += 1) {
+        Array[Index] = Index;
+    }
+
+    qsort_r(Array,
+            TEST_QUICKSORT_ARRAY_COUNT,
+            sizeof(ULONG),
+            TestQuickSortCompareWithArgument,
+            &Direction);
+
+    for (Index = 0; Index < TEST_QUICKSORT_ARRAY_COUNT; Index += 1) {
+        if (Array[Index] != TEST_QUICKSORT_ARRAY_COUNT - Index - 1) {
+            printf("Error: Test case %d failed. Index %4d had %4d in it.\n",
+                   Case,
+                   Index,
+                   Array[Index]);
+
+            Failures += 1;
+            break;
+        }
+    }
+
     Case += 1;
     return Failures;
 }
@@ -365,3 +420,41 @@ Return Value:
     return 0;
 }
 
+int
+TestQuickSortCompareWithArgument (
+    const void *Left,
+    const void *Right,
+    void *Argument
+    )
+
+/*++
+
+Routine Description:
+
+    This routine compares two test array elements, scaling the result by the
+    integer pointed to by the argument. It is used by the qsort_r test.
+
+Arguments:
+
+    Left - Supplies a pointer into the array of the left side of the comparison.
+
+    Right - Supplies a pointer into the array of the right side of the
+        comparison.
+
+    Argument - Supplies a pointer to an integer to multiply the result by.
+
+Return Value:
+
+    <0 if the left is less than the right.
+
+    0 if the two elements are equal.
+
+    >0 if the left element is greater than the right.
+
+--*/
+
+{
+
+    return TestQuickSortCompare(Left, Right) * *((int *)Argument);
+}
+
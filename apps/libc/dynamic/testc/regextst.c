@@ -536,11 +536,52 @@ REGEX_EXECUTION_TEST_CASE RegexExecutionTestCases[] = {
         {{0, 5}, {2, 4}, {-1, -1}, {-1, -1}, {-1, -1}},
     },
 
+    //
+    // An empty iteration of an inner repeat should not stop the outer repeat.
+    //
+
+    {
+        "(.B*)+", REG_EXTENDED,
+        "ABAB", 0,
+        0,
+        {{0, 4}, {2, 4}, {-1, -1}, {-1, -1}, {-1, -1}},
+    },
+
+    //
+    // A trailing anchor may need to reconsider earlier choices.
+    //
+
+    {
+        "A*\\(AB\\)*$", 0,
+        "AAB", 0,
+        0,
+        {{0, 3}, {1, 3}, {-1, -1}, {-1, -1}, {-1, -1}},
+    },
+
+    //
+    // Nested repeats take exponential time to fail with backtracking, but
+    // not with the NFA.
+    //
+
+    {
+        "(A+)+B", REG_EXTENDED,
+        "AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAC", 0,
+        REG_NOMATCH,
+        {{-1, -1}, {-1, -1}, {-1, -1}, {-1, -1}, {-1, -1}},
+    },
+
+    {
+        "^(A|AA)*$", REG_EXTENDED,
+        "AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAB", 0,
+        REG_NOMATCH,
+        {{-1, -1}, {-1, -1}, {-1, -1}, {-1, -1}, {-1, -1}},
+    },
+
     //
     // TODO: The commented out cases are what other C libraries would see.
-    // This implementation finds shorter versions due to its backtracking
-    // nature. Consider implementing a NFA/DFA regex implementation, which
-    // would then enable these cases.
+    // Both the backtracker and the NFA give alternatives leftmost-first
+    // priority, so this implementation finds shorter versions. Enabling
+    // these cases requires POSIX leftmost-longest submatch rules.
     //
 
 #if 0
@@ -110,6 +110,19 @@ extern "C" {
 
 #define F_CLOSEM 11
 
+//
+// Get the capacity of the buffer backing a pipe, in bytes.
+//
+
+#define F_GETPIPE_SZ 12
+
+//
+// Set the capacity of the buffer backing a pipe. The capacity is rounded up
+// and the resulting size is returned.
+//
+
+#define F_SETPIPE_SZ 13
+
 //
 // There's no need for 64-bit versions, since off_t is always 64 bits.
 //
@@ -787,6 +787,91 @@ Return Value:
 
 --*/
 
+LIBC_API
+void
+qsort_r (
+    void *ArrayBase,
+    size_t ElementCount,
+    size_t ElementSize,
+    int (*CompareFunction)(const void *, const void *, void *),
+    void *Argument
+    );
+
+/*++
+
+Routine Description:
+
+    This routine sorts an array of items in place using the QuickSort
+    algorithm, passing an additional argument through to the compare function.
+
+Arguments:
+
+    ArrayBase - Supplies a pointer to the array of items that will get pushed
+        around.
+
+    ElementCount - Supplies the number of elements in the array.
+
+    ElementSize - Supplies the size of one of the elements.
+
+    CompareFunction - Supplies a pointer to a function that will be used to
+        compare elements. The function takes in two pointers that will point
+        within the array, and the argument pointer passed to this routine. It
+        returns less than zero if the first element is less than the second,
+        zero if the first element is equal to the second, and greater than
+        zero if the first element is greater than the second.
+
+    Argument - Supplies an opaque pointer that is passed along to the compare
+        function.
+
+Return Value:
+
+    None.
+
+--*/
+
+LIBC_API
+void
+qsort_parallel (
+    void *ArrayBase,
+    size_t ElementCount,
+    size_t ElementSize,
+    int (*CompareFunction)(const void *, const void *),
+    unsigned int ThreadCount
+    );
+
+/*++
+
+Routine Description:
+
+    This routine sorts an array of items in place using multiple threads. The
+    array is split into pieces that are sorted concurrently, and the sorted
+    pieces are then merged. This is a Minoca extension. Small arrays, or
+    cases where memory or threads cannot be had, are sorted by the calling
+    thread with qsort. Unlike qsort, the compare function may be called from
+    several threads at once.
+
+Arguments:
+
+    ArrayBase - Supplies a pointer to the array of items that will get pushed
+        around.
+
+    ElementCount - Supplies the number of elements in the array.
+
+    ElementSize - Supplies the size of one of the elements.
+
+    CompareFunction - Supplies a pointer to a function that will be used to
+        compare elements, with the same semantics as for qsort.
+
+    ThreadCount - Supplies the maximum number of threads to sort with,
+        including the calling thread. Supply 0 to use one thread per online
+        processor.
+
+Return Value:
+
+    None.
+
+--*/
+
 LIBC_API
 int
 atoi (
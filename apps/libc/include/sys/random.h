@@ -0,0 +1,112 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU Lesser General Public
+    License version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details.
+
+Module Name:
+
+    random.h
+
+Abstract:
+
+    This header contains definitions for getting random data directly from
+    the kernel.
+
+Author:
+
+    agent 18-Oct-2026
+
+--*/
+
+#ifndef _SYS_RANDOM_H
+#define _SYS_RANDOM_H
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <libcbase.h>
+#include <sys/types.h>
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+#ifdef __cplusplus
+
+extern "C" {
+
+#endif
+
+//
+// Define flags to getrandom.
+//
+
+//
+// Set this flag to fail with EAGAIN rather than block if the random source is
+// not yet available.
+//
+
+#define GRND_NONBLOCK 0x00000001
+
+//
+// Set this flag to draw from the random device rather than urandom. On this
+// system the two are the same.
+//
+
+#define GRND_RANDOM 0x00000002
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// -------------------------------------------------------- Function Prototypes
+//
+
+LIBC_API
+ssize_t
+getrandom (
+    void *Buffer,
+    size_t Size,
+    unsigned int Flags
+    );
+
+/*++
+
+Routine Description:
+
+    This routine fills a buffer with random data from the kernel, without
+    needing to open the random device.
+
+Arguments:
+
+    Buffer - Supplies a pointer where the random data will be returned.
+
+    Size - Supplies the number of bytes of random data requested.
+
+    Flags - Supplies a bitfield of flags. See GRND_* definitions.
+
+Return Value:
+
+    Returns the number of bytes returned on success. This may be less than the
+    requested size for very large requests.
+
+    -1 on failure, and errno will be set to contain more information.
+
+--*/
+
+#ifdef __cplusplus
+
+}
+
+#endif
+#endif
+
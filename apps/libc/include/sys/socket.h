@@ -29,6 +29,7 @@ Module Name:
 
 #include <sys/uio.h>
 #include <sys/ioctl.h>
+#include <time.h>
 
 //
 // --------------------------------------------------------------------- Macros
@@ -240,6 +241,14 @@ extern "C" {
 
 #define MSG_DONTROUTE 0x00000100
 
+//
+// This flag is used by recvmmsg. It requests that the call block only until
+// the first message arrives, and then return whatever further messages are
+// available without blocking.
+//
+
+#define MSG_WAITFORONE 0x00000200
+
 //
 // Define the shutdown types. Read closes the socket for further reading, write
 // closes the socket for further writing, and rdwr closes the socket for both
@@ -583,6 +592,28 @@ struct msghdr {
 
 /*++
 
+Structure Description:
+
+    This structure defines a single message used by the sendmmsg and recvmmsg
+    functions.
+
+Members:
+
+    msg_hdr - Stores the message header, with the same meaning as in sendmsg
+        and recvmsg.
+
+    msg_len - Stores the number of bytes sent or received for this message,
+        set on return.
+
+--*/
+
+struct mmsghdr {
+    struct msghdr msg_hdr;
+    unsigned int msg_len;
+};
+
+/*++
+
 Structure Description:
 
     This structure defines a socket control message, the header for the socket
@@ -1001,6 +1032,44 @@ Return Value:
 
 --*/
 
+LIBC_API
+int
+sendmmsg (
+    int Socket,
+    struct mmsghdr *Messages,
+    unsigned int MessageCount,
+    int Flags
+    );
+
+/*++
+
+Routine Description:
+
+    This routine sends several messages out of a socket with a single call
+    into the kernel. Each message is sent as if by sendmsg.
+
+Arguments:
+
+    Socket - Supplies the file descriptor of the socket to send data out of.
+
+    Messages - Supplies an array of messages to send. On return, the msg_len
+        member of each message sent is set to the number of bytes sent.
+
+    MessageCount - Supplies the number of elements in the message array.
+
+    Flags - Supplies a bitfield of flags governing the transmission of the data.
+        See MSG_* definitions.
+
+Return Value:
+
+    Returns the number of messages sent on success. If an error occurs after
+    at least one message was sent, the count is returned and the error is
+    reported by the next call.
+
+    -1 on error, and the errno variable will be set to contain more information.
+
+--*/
+
 LIBC_API
 ssize_t
 recv (
@@ -1116,6 +1185,50 @@ Return Value:
 
 --*/
 
+LIBC_API
+int
+recvmmsg (
+    int Socket,
+    struct mmsghdr *Messages,
+    unsigned int MessageCount,
+    int Flags,
+    struct timespec *Timeout
+    );
+
+/*++
+
+Routine Description:
+
+    This routine receives several messages from a socket with a single call
+    into the kernel. Each message is received as if by recvmsg.
+
+Arguments:
+
+    Socket - Supplies the file descriptor of the socket to receive data from.
+
+    Messages - Supplies an array of initialized message headers where the
+        received messages will be returned. On return, the msg_len member of
+        each message received is set to the number of bytes received.
+
+    MessageCount - Supplies the number of elements in the message array.
+
+    Flags - Supplies a bitfield of flags governing the reception of the data.
+        See MSG_* definitions. Supply MSG_WAITFORONE to block only for the
+        first message.
+
+    Timeout - Supplies an optional pointer to the maximum amount of time to
+        wait for each message. Supply NULL to wait indefinitely.
+
+Return Value:
+
+    Returns the number of messages received on success. If an error occurs
+    after at least one message was received, the count is returned and the
+    error is reported by the next call.
+
+    -1 on error, and the errno variable will be set to contain more information.
+
+--*/
+
 LIBC_API
 int
 shutdown (
@@ -49,6 +49,7 @@ function build() {
     sources = [
         "env.c",
         "heap.c",
+        "imcache.c",
         "osimag.c",
         "osbase.c",
         "rwlock.c",
@@ -98,7 +99,7 @@ function build() {
         "lib/rtl/base:basertlw",
         "lib/rtl/urtl:urtl",
         "lib/im:imn",
-        "lib/crypto:crypto"
+        "lib/crypto:ucrypto"
     ];
 
     so = {
@@ -0,0 +1,954 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    imcache.c
+
+Abstract:
+
+    This module implements the relocation cache, which saves the relocations
+    applied to the initial set of images in a program so that later runs of
+    the same unchanged images can skip symbol resolution entirely.
+
+Author:
+
+    agent 18-Oct-2026
+
+Environment:
+
+    User
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include "osbasep.h"
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+#define OS_IMAGE_CACHE_ALLOCATION_TAG 0x63497350 // 'cIsO'
+
+//
+// Define the name of the environment variable that points at the directory
+// relocation caches live in. Relocation caching is disabled unless this is
+// set.
+//
+
+#define LD_RELOCATION_CACHE "LD_RELOCATION_CACHE"
+
+#define OS_RELOCATION_CACHE_MAGIC 0x6C655244 // 'leRD'
+#define OS_RELOCATION_CACHE_VERSION 1
+
+//
+// Define the space needed in the cache path for the separator, the 16 digit
+// key, the extension, and a temporary suffix while the file is being written.
+//
+
+#define OS_RELOCATION_CACHE_NAME_SIZE 48
+
+//
+// Define the maximum number of records a cache file is believed to hold.
+//
+
+#define OS_RELOCATION_CACHE_MAX_RECORDS 0x1000000
+
+//
+// Define the FNV-1a hash parameters used to build the cache key and image
+// fingerprints.
+//
+
+#define OS_RELOCATION_CACHE_HASH_BASIS 0xCBF29CE484222325ULL
+#define OS_RELOCATION_CACHE_HASH_PRIME 0x00000100000001B3ULL
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+/*++
+
+Structure Description:
+
+    This structure stores the header at the start of a relocation cache file.
+    It is followed by the identity of each image, in list order, and then by
+    the relocation records.
+
+Members:
+
+    Magic - Stores OS_RELOCATION_CACHE_MAGIC.
+
+    Version - Stores OS_RELOCATION_CACHE_VERSION.
+
+    ImageCount - Stores the number of image identities following the header.
+
+    RecordSize - Stores the size of each relocation record, which guards
+        against reading a file written by a different architecture.
+
+    RecordCount - Stores the number of relocation records in the file.
+
+--*/
+
+typedef struct _OS_RELOCATION_CACHE_HEADER {
+    ULONG Magic;
+    ULONG Version;
+    ULONG ImageCount;
+    ULONG RecordSize;
+    ULONGLONG RecordCount;
+} OS_RELOCATION_CACHE_HEADER, *POS_RELOCATION_CACHE_HEADER;
+
+/*++
+
+Structure Description:
+
+    This structure stores everything about a loaded image that the recorded
+    relocations depend on. A cache is only used if every image matches.
+
+Members:
+
+    Base - Stores the address the image is loaded at.
+
+    Size - Stores the size of the image in memory.
+
+    DeviceId - Stores the device the image file lives on, or zero if the
+        image is identified by its fingerprint.
+
+    FileId - Stores the file identifier of the image file.
+
+    ModificationDate - Stores the modification date of the image file.
+
+    FileSize - Stores the size of the image file.
+
+    Fingerprint - Stores a hash of the image's headers and dynamic symbols,
+        used for images whose file can't be identified.
+
+    TlsOffset - Stores the image's static TLS offset.
+
+    ModuleNumber - Stores the image's module number.
+
+    Flags - Stores the image flags and load flags that affect relocation.
+
+--*/
+
+typedef struct _OS_RELOCATION_CACHE_IMAGE {
+    ULONGLONG Base;
+    ULONGLONG Size;
+    ULONGLONG DeviceId;
+    ULONGLONG FileId;
+    ULONGLONG ModificationDate;
+    ULONGLONG FileSize;
+    ULONGLONG Fingerprint;
+    ULONGLONG TlsOffset;
+    ULONG ModuleNumber;
+    ULONG Flags;
+} OS_RELOCATION_CACHE_IMAGE, *POS_RELOCATION_CACHE_IMAGE;
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+KSTATUS
+OspImGetRelocationCacheImages (
+    POS_RELOCATION_CACHE_IMAGE *Images,
+    PULONG ImageCount,
+    PULONGLONG Key
+    );
+
+KSTATUS
+OspImFingerprintImage (
+    PLOADED_IMAGE Image,
+    PULONGLONG Fingerprint
+    );
+
+ULONGLONG
+OspImHashBuffer (
+    ULONGLONG Hash,
+    PVOID Buffer,
+    UINTN Size
+    );
+
+KSTATUS
+OspImReadRelocationCache (
+    PSTR Path,
+    POS_RELOCATION_CACHE_IMAGE Images,
+    ULONG ImageCount,
+    PIMAGE_RELOCATION_LOG Log
+    );
+
+KSTATUS
+OspImWriteRelocationCache (
+    PSTR Path,
+    POS_RELOCATION_CACHE_IMAGE Images,
+    ULONG ImageCount,
+    PIMAGE_RELOCATION_LOG Log
+    );
+
+KSTATUS
+OspImPerformCacheIo (
+    HANDLE Handle,
+    IO_OFFSET Offset,
+    UINTN Size,
+    ULONG Flags,
+    PVOID Buffer
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+KSTATUS
+OspImRelocateInitialImages (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine relocates the initial set of images loaded into the process.
+    If a relocation cache directory is configured, relocations are replayed
+    from a cache file matching the exact set of images loaded, or recorded
+    into a new cache file if there is no match.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    PSTR Directory;
+    UINTN DirectoryLength;
+    PTHREAD_IDENTITY Identity;
+    ULONG ImageCount;
+    POS_RELOCATION_CACHE_IMAGE Images;
+    ULONGLONG Key;
+    IMAGE_RELOCATION_LOG Log;
+    PSTR Path;
+    UINTN PathSize;
+    KSTATUS Status;
+
+    Images = NULL;
+    Path = NULL;
+    RtlZeroMemory(&Log, sizeof(IMAGE_RELOCATION_LOG));
+    Directory = OspImGetEnvironmentVariable(LD_RELOCATION_CACHE);
+    if ((Directory == NULL) || (*Directory == '\0')) {
+        Status = ImRelocateImages(&OsLoadedImagesHead);
+        goto RelocateInitialImagesEnd;
+    }
+
+    //
+    // Don't let the environment steer relocations in a set-UID or set-GID
+    // program.
+    //
+
+    Identity = &(OsEnvironment->StartData->Identity);
+    if ((Identity->RealUserId != Identity->EffectiveUserId) ||
+        (Identity->RealGroupId != Identity->EffectiveGroupId)) {
+
+        Status = ImRelocateImages(&OsLoadedImagesHead);
+        goto RelocateInitialImagesEnd;
+    }
+
+    Status = OspImGetRelocationCacheImages(&Images, &ImageCount, &Key);
+    if (!KSUCCESS(Status)) {
+        Status = ImRelocateImages(&OsLoadedImagesHead);
+        goto RelocateInitialImagesEnd;
+    }
+
+    DirectoryLength = RtlStringLength(Directory);
+    PathSize = DirectoryLength + OS_RELOCATION_CACHE_NAME_SIZE;
+    Path = OsHeapAllocate(PathSize, OS_IMAGE_CACHE_ALLOCATION_TAG);
+    if (Path == NULL) {
+        Status = ImRelocateImages(&OsLoadedImagesHead);
+        goto RelocateInitialImagesEnd;
+    }
+
+    RtlPrintToString(Path,
+                     PathSize,
+                     CharacterEncodingDefault,
+                     "%s/%016llx.rel",
+                     Directory,
+                     Key);
+
+    //
+    // Try to replay a cache for this exact set of images. Replay checks the
+    // whole log before touching anything, so a mismatch can fall back to a
+    // regular relocation.
+    //
+
+    Status = OspImReadRelocationCache(Path, Images, ImageCount, &Log);
+    if (KSUCCESS(Status)) {
+        Status = ImReplayRelocationLog(&OsLoadedImagesHead, &Log);
+        if (Status != STATUS_VERSION_MISMATCH) {
+            goto RelocateInitialImagesEnd;
+        }
+    }
+
+    if (Log.Records != NULL) {
+        OsHeapFree(Log.Records);
+    }
+
+    RtlZeroMemory(&Log, sizeof(IMAGE_RELOCATION_LOG));
+    Status = ImRelocateImagesWithLog(&OsLoadedImagesHead, &Log);
+    if ((KSUCCESS(Status)) && (KSUCCESS(Log.Status))) {
+        OspImWriteRelocationCache(Path, Images, ImageCount, &Log);
+    }
+
+    ImDestroyRelocationLog(&Log);
+
+RelocateInitialImagesEnd:
+
+    //
+    // Logs read from a file are allocated here rather than by the image
+    // library, which marks them with a capacity of zero.
+    //
+
+    if ((Log.Capacity == 0) && (Log.Records != NULL)) {
+        OsHeapFree(Log.Records);
+    }
+
+    if (Path != NULL) {
+        OsHeapFree(Path);
+    }
+
+    if (Images != NULL) {
+        OsHeapFree(Images);
+    }
+
+    return Status;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+KSTATUS
+OspImGetRelocationCacheImages (
+    POS_RELOCATION_CACHE_IMAGE *Images,
+    PULONG ImageCount,
+    PULONGLONG Key
+    )
+
+/*++
+
+Routine Description:
+
+    This routine gathers the identity of every image on the loaded image list,
+    and computes the cache key from them.
+
+Arguments:
+
+    Images - Supplies a pointer where an array of image identities will be
+        returned on success. The caller is responsible for freeing this
+        memory with the OS heap.
+
+    ImageCount - Supplies a pointer where the number of elements in the image
+        array will be returned.
+
+    Key - Supplies a pointer where the cache key will be returned.
+
+Return Value:
+
+    Status code. Failure means an image couldn't be identified, and the cache
+    shouldn't be used.
+
+--*/
+
+{
+
+    ULONG Count;
+    PLIST_ENTRY CurrentEntry;
+    PLOADED_IMAGE CurrentImage;
+    POS_RELOCATION_CACHE_IMAGE Entry;
+    ULONG Index;
+    FILE_PROPERTIES Properties;
+    KSTATUS Status;
+
+    *Images = NULL;
+    *ImageCount = 0;
+    Count = 0;
+    CurrentEntry = OsLoadedImagesHead.Next;
+    while (CurrentEntry != &OsLoadedImagesHead) {
+        Count += 1;
+        CurrentEntry = CurrentEntry->Next;
+    }
+
+    Entry = OsHeapAllocate(Count * sizeof(OS_RELOCATION_CACHE_IMAGE),
+                           OS_IMAGE_CACHE_ALLOCATION_TAG);
+
+    if (Entry == NULL) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    RtlZeroMemory(Entry, Count * sizeof(OS_RELOCATION_CACHE_IMAGE));
+    *Images = Entry;
+    Index = 0;
+    CurrentEntry = OsLoadedImagesHead.Next;
+    while (CurrentEntry != &OsLoadedImagesHead) {
+        CurrentImage = LIST_VALUE(CurrentEntry, LOADED_IMAGE, ListEntry);
+        CurrentEntry = CurrentEntry->Next;
+        Entry = &((*Images)[Index]);
+        Index += 1;
+        Entry->Base = (UINTN)(CurrentImage->LoadedImageBuffer);
+        Entry->Size = CurrentImage->Size;
+        Entry->TlsOffset = CurrentImage->TlsOffset;
+        Entry->ModuleNumber = CurrentImage->ModuleNumber;
+        Entry->Flags = (CurrentImage->Flags & IMAGE_FLAG_RELOCATED) |
+                       (CurrentImage->LoadFlags & IMAGE_LOAD_FLAG_BIND_NOW);
+
+        //
+        // Libraries loaded from a file have their file identity handy.
+        //
+
+        if ((CurrentImage->File.DeviceId != 0) ||
+            (CurrentImage->File.FileId != 0)) {
+
+            Entry->DeviceId = CurrentImage->File.DeviceId;
+            Entry->FileId = CurrentImage->File.FileId;
+            Entry->ModificationDate = CurrentImage->File.ModificationDate;
+            Entry->FileSize = CurrentImage->File.Size;
+            continue;
+        }
+
+        //
+        // Images mapped by the kernel that are already relocated (the OS
+        // library) only matter for the symbols they export, so they're
+        // identified by a hash of their symbol tables.
+        //
+
+        if ((CurrentImage->Flags & IMAGE_FLAG_RELOCATED) != 0) {
+            Status = OspImFingerprintImage(CurrentImage,
+                                           &(Entry->Fingerprint));
+
+            if (!KSUCCESS(Status)) {
+                return Status;
+            }
+
+            continue;
+        }
+
+        //
+        // The executable was opened by the kernel using the image name,
+        // relative to the same current directory as now.
+        //
+
+        if (CurrentImage != ImPrimaryExecutable) {
+            return STATUS_NOT_SUPPORTED;
+        }
+
+        Status = OsGetFileInformation(INVALID_HANDLE,
+                                      OsEnvironment->ImageName,
+                                      OsEnvironment->ImageNameLength,
+                                      TRUE,
+                                      &Properties);
+
+        if (!KSUCCESS(Status)) {
+            return Status;
+        }
+
+        Entry->DeviceId = Properties.DeviceId;
+        Entry->FileId = Properties.FileId;
+        Entry->ModificationDate = Properties.ModifiedTime.Seconds;
+        Entry->FileSize = Properties.Size;
+    }
+
+    *ImageCount = Count;
+    *Key = OspImHashBuffer(OS_RELOCATION_CACHE_HASH_BASIS,
+                           *Images,
+                           Count * sizeof(OS_RELOCATION_CACHE_IMAGE));
+
+    return STATUS_SUCCESS;
+}
+
+KSTATUS
+OspImFingerprintImage (
+    PLOADED_IMAGE Image,
+    PULONGLONG Fingerprint
+    )
+
+/*++
+
+Routine Description:
+
+    This routine hashes the start of an image, from its headers through its
+    dynamic symbol and string tables. Any change to an exported symbol's value
+    or size changes the fingerprint.
+
+Arguments:
+
+    Image - Supplies a pointer to the loaded image.
+
+    Fingerprint - Supplies a pointer where the fingerprint will be returned.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    STATUS_NOT_SUPPORTED if the image isn't laid out with the symbol table
+    ahead of the string table, in which case the symbol table's extent isn't
+    known.
+
+--*/
+
+{
+
+    PUCHAR End;
+    PUCHAR Start;
+
+    Start = Image->LoadedImageBuffer;
+    End = (PUCHAR)(Image->ExportStringTable) + Image->ExportStringTableSize;
+    if ((Image->ExportSymbolTable == NULL) ||
+        (Image->ExportStringTable == NULL) ||
+        ((PUCHAR)(Image->ExportSymbolTable) < Start) ||
+        (Image->ExportSymbolTable >= Image->ExportStringTable) ||
+        (End > Start + Image->Size)) {
+
+        return STATUS_NOT_SUPPORTED;
+    }
+
+    *Fingerprint = OspImHashBuffer(OS_RELOCATION_CACHE_HASH_BASIS,
+                                   Start,
+                                   End - Start);
+
+    return STATUS_SUCCESS;
+}
+
+ULONGLONG
+OspImHashBuffer (
+    ULONGLONG Hash,
+    PVOID Buffer,
+    UINTN Size
+    )
+
+/*++
+
+Routine Description:
+
+    This routine folds a buffer into an FNV-1a style hash. Whole words are
+    folded in at a time for speed, so the result differs from a true FNV-1a
+    hash.
+
+Arguments:
+
+    Hash - Supplies the hash value to start from.
+
+    Buffer - Supplies a pointer to the buffer to hash. This must be word
+        aligned.
+
+    Size - Supplies the number of bytes to hash.
+
+Return Value:
+
+    Returns the updated hash.
+
+--*/
+
+{
+
+    PUCHAR Byte;
+    UINTN Index;
+    UINTN WordCount;
+    PUINTN Words;
+
+    Words = Buffer;
+    WordCount = Size / sizeof(UINTN);
+    for (Index = 0; Index < WordCount; Index += 1) {
+        Hash ^= Words[Index];
+        Hash *= OS_RELOCATION_CACHE_HASH_PRIME;
+    }
+
+    Byte = (PUCHAR)(Words + WordCount);
+    for (Index = WordCount * sizeof(UINTN); Index < Size; Index += 1) {
+        Hash ^= *Byte;
+        Hash *= OS_RELOCATION_CACHE_HASH_PRIME;
+        Byte += 1;
+    }
+
+    return Hash;
+}
+
+KSTATUS
+OspImReadRelocationCache (
+    PSTR Path,
+    POS_RELOCATION_CACHE_IMAGE Images,
+    ULONG ImageCount,
+    PIMAGE_RELOCATION_LOG Log
+    )
+
+/*++
+
+Routine Description:
+
+    This routine reads a relocation cache file, if it exists and describes
+    the given set of images.
+
+Arguments:
+
+    Path - Supplies a pointer to the path of the cache file.
+
+    Images - Supplies a pointer to the identities of the loaded images.
+
+    ImageCount - Supplies the number of elements in the images array.
+
+    Log - Supplies a pointer to a zeroed relocation log that receives the
+        records on success. The records are allocated from the OS heap, and
+        the log's capacity is left at zero.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    FILE_CONTROL_PARAMETERS_UNION FileControlParameters;
+    POS_RELOCATION_CACHE_IMAGE FileImages;
+    HANDLE Handle;
+    OS_RELOCATION_CACHE_HEADER Header;
+    UINTN ImagesSize;
+    FILE_PROPERTIES Properties;
+    USER_ID RealUserId;
+    PIMAGE_RELOCATION_RECORD Records;
+    UINTN RecordsSize;
+    KSTATUS Status;
+
+    FileImages = NULL;
+    Records = NULL;
+    Status = OsOpen(INVALID_HANDLE,
+                    Path,
+                    RtlStringLength(Path) + 1,
+                    SYS_OPEN_FLAG_READ,
+                    FILE_PERMISSION_NONE,
+                    &Handle);
+
+    if (!KSUCCESS(Status)) {
+        return Status;
+    }
+
+    //
+    // Only trust regular files belonging to this user or the administrator,
+    // since the records get written straight into memory.
+    //
+
+    FileControlParameters.SetFileInformation.FieldsToSet = 0;
+    FileControlParameters.SetFileInformation.FileProperties = &Properties;
+    Status = OsFileControl(Handle,
+                           FileControlCommandGetFileInformation,
+                           &FileControlParameters);
+
+    if (!KSUCCESS(Status)) {
+        goto ReadRelocationCacheEnd;
+    }
+
+    RealUserId = OsEnvironment->StartData->Identity.RealUserId;
+    if ((Properties.Type != IoObjectRegularFile) ||
+        ((Properties.UserId != 0) && (Properties.UserId != RealUserId))) {
+
+        Status = STATUS_ACCESS_DENIED;
+        goto ReadRelocationCacheEnd;
+    }
+
+    Status = OspImPerformCacheIo(Handle,
+                                 0,
+                                 sizeof(OS_RELOCATION_CACHE_HEADER),
+                                 0,
+                                 &Header);
+
+    if (!KSUCCESS(Status)) {
+        goto ReadRelocationCacheEnd;
+    }
+
+    Status = STATUS_VERSION_MISMATCH;
+    if ((Header.Magic != OS_RELOCATION_CACHE_MAGIC) ||
+        (Header.Version != OS_RELOCATION_CACHE_VERSION) ||
+        (Header.ImageCount != ImageCount) ||
+        (Header.RecordSize != sizeof(IMAGE_RELOCATION_RECORD)) ||
+        (Header.RecordCount == 0) ||
+        (Header.RecordCount > OS_RELOCATION_CACHE_MAX_RECORDS)) {
+
+        goto ReadRelocationCacheEnd;
+    }
+
+    ImagesSize = ImageCount * sizeof(OS_RELOCATION_CACHE_IMAGE);
+    RecordsSize = Header.RecordCount * sizeof(IMAGE_RELOCATION_RECORD);
+    if ((ULONGLONG)(Properties.Size) !=
+        sizeof(OS_RELOCATION_CACHE_HEADER) + ImagesSize + RecordsSize) {
+
+        goto ReadRelocationCacheEnd;
+    }
+
+    FileImages = OsHeapAllocate(ImagesSize, OS_IMAGE_CACHE_ALLOCATION_TAG);
+    Records = OsHeapAllocate(RecordsSize, OS_IMAGE_CACHE_ALLOCATION_TAG);
+    if ((FileImages == NULL) || (Records == NULL)) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto ReadRelocationCacheEnd;
+    }
+
+    Status = OspImPerformCacheIo(Handle,
+                                 sizeof(OS_RELOCATION_CACHE_HEADER),
+                                 ImagesSize,
+                                 0,
+                                 FileImages);
+
+    if (!KSUCCESS(Status)) {
+        goto ReadRelocationCacheEnd;
+    }
+
+    if (RtlCompareMemory(FileImages, Images, ImagesSize) == FALSE) {
+        Status = STATUS_VERSION_MISMATCH;
+        goto ReadRelocationCacheEnd;
+    }
+
+    Status = OspImPerformCacheIo(Handle,
+                                 sizeof(OS_RELOCATION_CACHE_HEADER) +
+                                 ImagesSize,
+                                 RecordsSize,
+                                 0,
+                                 Records);
+
+    if (!KSUCCESS(Status)) {
+        goto ReadRelocationCacheEnd;
+    }
+
+    Log->Records = Records;
+    Log->Count = Header.RecordCount;
+    Log->Capacity = 0;
+    Log->Status = STATUS_SUCCESS;
+    Records = NULL;
+
+ReadRelocationCacheEnd:
+    if (Records != NULL) {
+        OsHeapFree(Records);
+    }
+
+    if (FileImages != NULL) {
+        OsHeapFree(FileImages);
+    }
+
+    OsClose(Handle);
+    return Status;
+}
+
+KSTATUS
+OspImWriteRelocationCache (
+    PSTR Path,
+    POS_RELOCATION_CACHE_IMAGE Images,
+    ULONG ImageCount,
+    PIMAGE_RELOCATION_LOG Log
+    )
+
+/*++
+
+Routine Description:
+
+    This routine writes a relocation cache file. The file is written under a
+    temporary name and then renamed into place, so that other processes never
+    see a partially written cache.
+
+Arguments:
+
+    Path - Supplies a pointer to the path of the cache file.
+
+    Images - Supplies a pointer to the identities of the loaded images.
+
+    ImageCount - Supplies the number of elements in the images array.
+
+    Log - Supplies a pointer to the relocation log to save.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    HANDLE Handle;
+    OS_RELOCATION_CACHE_HEADER Header;
+    UINTN ImagesSize;
+    IO_OFFSET Offset;
+    UINTN PathSize;
+    PROCESS_ID ProcessId;
+    KSTATUS Status;
+    PSTR TemporaryPath;
+    UINTN TemporaryPathSize;
+
+    Handle = INVALID_HANDLE;
+    if ((Log->Count == 0) || (Log->Count > OS_RELOCATION_CACHE_MAX_RECORDS)) {
+        return STATUS_NOT_SUPPORTED;
+    }
+
+    PathSize = RtlStringLength(Path) + 1;
+    TemporaryPathSize = PathSize + OS_RELOCATION_CACHE_NAME_SIZE;
+    TemporaryPath = OsHeapAllocate(TemporaryPathSize,
+                                   OS_IMAGE_CACHE_ALLOCATION_TAG);
+
+    if (TemporaryPath == NULL) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    ProcessId = 0;
+    OsGetProcessId(ProcessIdProcess, &ProcessId);
+    TemporaryPathSize = RtlPrintToString(TemporaryPath,
+                                         TemporaryPathSize,
+                                         CharacterEncodingDefault,
+                                         "%s.%x",
+                                         Path,
+                                         ProcessId);
+
+    //
+    // The cache directory may be shared with other users, so never open
+    // something that is already there under the temporary name. If anything
+    // (including a symbolic link) is in the way, just skip writing the cache,
+    // and leave whatever it is alone.
+    //
+
+    Status = OsOpen(INVALID_HANDLE,
+                    TemporaryPath,
+                    TemporaryPathSize,
+                    SYS_OPEN_FLAG_CREATE | SYS_OPEN_FLAG_FAIL_IF_EXISTS |
+                    SYS_OPEN_FLAG_NO_SYMBOLIC_LINK | SYS_OPEN_FLAG_WRITE,
+                    FILE_PERMISSION_USER_READ | FILE_PERMISSION_USER_WRITE,
+                    &Handle);
+
+    if (!KSUCCESS(Status)) {
+        OsHeapFree(TemporaryPath);
+        return Status;
+    }
+
+    RtlZeroMemory(&Header, sizeof(OS_RELOCATION_CACHE_HEADER));
+    Header.Magic = OS_RELOCATION_CACHE_MAGIC;
+    Header.Version = OS_RELOCATION_CACHE_VERSION;
+    Header.ImageCount = ImageCount;
+    Header.RecordSize = sizeof(IMAGE_RELOCATION_RECORD);
+    Header.RecordCount = Log->Count;
+    Status = OspImPerformCacheIo(Handle,
+                                 0,
+                                 sizeof(OS_RELOCATION_CACHE_HEADER),
+                                 SYS_IO_FLAG_WRITE,
+                                 &Header);
+
+    if (!KSUCCESS(Status)) {
+        goto WriteRelocationCacheEnd;
+    }
+
+    Offset = sizeof(OS_RELOCATION_CACHE_HEADER);
+    ImagesSize = ImageCount * sizeof(OS_RELOCATION_CACHE_IMAGE);
+    Status = OspImPerformCacheIo(Handle,
+                                 Offset,
+                                 ImagesSize,
+                                 SYS_IO_FLAG_WRITE,
+                                 Images);
+
+    if (!KSUCCESS(Status)) {
+        goto WriteRelocationCacheEnd;
+    }
+
+    Offset += ImagesSize;
+    Status = OspImPerformCacheIo(Handle,
+                                 Offset,
+                                 Log->Count * sizeof(IMAGE_RELOCATION_RECORD),
+                                 SYS_IO_FLAG_WRITE,
+                                 Log->Records);
+
+    if (!KSUCCESS(Status)) {
+        goto WriteRelocationCacheEnd;
+    }
+
+    OsClose(Handle);
+    Handle = INVALID_HANDLE;
+    Status = OsRename(INVALID_HANDLE,
+                      TemporaryPath,
+                      TemporaryPathSize,
+                      INVALID_HANDLE,
+                      Path,
+                      PathSize);
+
+WriteRelocationCacheEnd:
+    if (Handle != INVALID_HANDLE) {
+        OsClose(Handle);
+    }
+
+    if (!KSUCCESS(Status)) {
+        OsDelete(INVALID_HANDLE, TemporaryPath, TemporaryPathSize, 0);
+    }
+
+    OsHeapFree(TemporaryPath);
+    return Status;
+}
+
+KSTATUS
+OspImPerformCacheIo (
+    HANDLE Handle,
+    IO_OFFSET Offset,
+    UINTN Size,
+    ULONG Flags,
+    PVOID Buffer
+    )
+
+/*++
+
+Routine Description:
+
+    This routine reads from or writes to a relocation cache file, failing if
+    the whole size couldn't be transferred.
+
+Arguments:
+
+    Handle - Supplies the open file handle.
+
+    Offset - Supplies the file offset to perform the I/O at.
+
+    Size - Supplies the number of bytes to transfer.
+
+    Flags - Supplies SYS_IO_FLAG_WRITE to write, or 0 to read.
+
+    Buffer - Supplies a pointer to the data buffer.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    UINTN BytesCompleted;
+    KSTATUS Status;
+
+    BytesCompleted = 0;
+    Status = OsPerformIo(Handle,
+                         Offset,
+                         Size,
+                         Flags,
+                         SYS_WAIT_TIME_INDEFINITE,
+                         Buffer,
+                         &BytesCompleted);
+
+    if ((KSUCCESS(Status)) && (BytesCompleted != Size)) {
+        Status = STATUS_END_OF_FILE;
+    }
+
+    return Status;
+}
+
@@ -2630,6 +2630,59 @@ Return Value:
     return Status;
 }
 
+OS_API
+KSTATUS
+OsGetRandomBytes (
+    PVOID Buffer,
+    UINTN Size,
+    ULONG Flags,
+    PUINTN BytesCompleted
+    )
+
+/*++
+
+Routine Description:
+
+    This routine fills a buffer with random data from the kernel's random
+    source, without needing to open the random device.
+
+Arguments:
+
+    Buffer - Supplies a pointer where the random data will be returned.
+
+    Size - Supplies the number of bytes of random data requested.
+
+    Flags - Supplies a bitfield of flags. See SYS_RANDOM_FLAG_* definitions.
+
+    BytesCompleted - Supplies a pointer where the number of bytes returned
+        will be stored. This may be less than the requested size if the
+        request was larger than SYS_RANDOM_MAX_SIZE.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    STATUS_OPERATION_WOULD_BLOCK if the random source is not yet available and
+    the non-blocking flag was supplied.
+
+    Other error codes on failure.
+
+--*/
+
+{
+
+    SYSTEM_CALL_GET_RANDOM_BYTES Request;
+    KSTATUS Status;
+
+    Request.Buffer = Buffer;
+    Request.Size = Size;
+    Request.Flags = Flags;
+    Request.BytesCompleted = 0;
+    Status = OsSystemCall(SystemCallGetRandomBytes, &Request);
+    *BytesCompleted = Request.BytesCompleted;
+    return Status;
+}
+
 OS_API
 KSTATUS
 OsResetSystem (
@@ -96,6 +96,13 @@ Structure Description:
     ListEntry - Stores pointers to the next and previous threads in the OS
         Library thread list.
 
+    ReadLockCount - Stores the number of read/write locks this thread
+        currently holds for read. Threads already holding a read lock do not
+        defer to pending writers, as doing so could deadlock recursive readers.
+
+    KernelThreadId - Stores the kernel's ID for this thread, or 0 if it has not
+        been queried yet.
+
 --*/
 
 typedef struct _THREAD_CONTROL_BLOCK {
@@ -106,6 +113,8 @@ typedef struct _THREAD_CONTROL_BLOCK {
     UINTN StackGuard;
     UINTN BaseAllocationSize;
     LIST_ENTRY ListEntry;
+    UINTN ReadLockCount;
+    THREAD_ID KernelThreadId;
 } THREAD_CONTROL_BLOCK, *PTHREAD_CONTROL_BLOCK;
 
 //
@@ -348,6 +357,31 @@ Return Value:
 
 --*/
 
+PSTR
+OspImGetEnvironmentVariable (
+    PSTR Variable
+    );
+
+/*++
+
+Routine Description:
+
+    This routine gets an environment variable value for the image library.
+
+Arguments:
+
+    Variable - Supplies a pointer to a null terminated string containing the
+        name of the variable to get.
+
+Return Value:
+
+    Returns a pointer to the value of the environment variable. The image
+    library will not free or modify this value.
+
+    NULL if the given environment variable is not set.
+
+--*/
+
 PUSER_SHARED_DATA
 OspGetUserSharedData (
     VOID
@@ -369,6 +403,28 @@ Return Value:
 
 --*/
 
+PTHREAD_CONTROL_BLOCK
+OspGetThreadControlBlock (
+    VOID
+    );
+
+/*++
+
+Routine Description:
+
+    This routine returns a pointer to the thread control block, a structure
+    unique to each thread.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns a pointer to the current thread's control block.
+
+--*/
+
 //
 // Thread-Local storage functions
 //
@@ -473,3 +529,31 @@ Return Value:
 
 --*/
 
+//
+// Image relocation cache functions
+//
+
+KSTATUS
+OspImRelocateInitialImages (
+    VOID
+    );
+
+/*++
+
+Routine Description:
+
+    This routine relocates the initial set of images loaded into the process.
+    If a relocation cache directory is configured, relocations are replayed
+    from a cache file matching the exact set of images loaded, or recorded
+    into a new cache file if there is no match.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Status code.
+
+--*/
+
@@ -165,11 +165,6 @@ OspImInvalidateInstructionCacheRegion (
     ULONG Size
     );
 
-PSTR
-OspImGetEnvironmentVariable (
-    PSTR Variable
-    );
-
 KSTATUS
 OspImFinalizeSegments (
     HANDLE AddressSpaceHandle,
@@ -432,10 +427,11 @@ Return Value:
     OsSetThreadPointer(Thread);
 
     //
-    // Now that TLS offsets are settled, relocate the images.
+    // Now that TLS offsets are settled, relocate the images, from the
+    // relocation cache if one is configured.
     //
 
-    Status = ImRelocateImages(&OsLoadedImagesHead);
+    Status = OspImRelocateInitialImages();
     if (!KSUCCESS(Status)) {
         RtlDebugPrint("Failed to relocate: %d\n", Status);
         goto DynamicLoaderMainEnd;
@@ -1710,11 +1706,17 @@ Return Value:
 
         //
         // Zero out any region between the end of the file portion and the next
-        // page.
+        // page. Skip this for read-only segments that end with the file
+        // portion: nothing is promised to be there, and writing to the page
+        // would replace the shared page cache page with a private copy in
+        // every process that maps the image.
         //
 
         NextPage = ALIGN_RANGE_UP(SegmentAddress, PageSize);
-        if (NextPage - SegmentAddress != 0) {
+        if ((NextPage - SegmentAddress != 0) &&
+            (((Segment->Flags & IMAGE_MAP_FLAG_WRITE) != 0) ||
+             (MemorySize != 0))) {
+
             RtlZeroMemory((PVOID)SegmentAddress, NextPage - SegmentAddress);
             if ((Segment->Flags & IMAGE_MAP_FLAG_EXECUTE) != 0) {
                 Status = OsFlushCache((PVOID)SegmentAddress,
@@ -197,6 +197,7 @@ Return Value:
                                               OldState);
 
         if (NewState == OldState) {
+            OspGetThreadControlBlock()->ReadLockCount += 1;
             return STATUS_SUCCESS;
         }
     }
@@ -301,6 +302,7 @@ Return Value:
                                               OldState);
 
         if (OldState == OS_RWLOCK_UNLOCKED) {
+            Lock->WriterKernelThreadId = OsGetKernelThreadId();
             Lock->WriterThreadId = OsGetThreadId();
             return 0;
         }
@@ -359,7 +361,14 @@ Return Value:
             return STATUS_PERMISSION_DENIED;
         }
 
+        //
+        // Bump the writer sequence before releasing so that any readers that
+        // waited out this writer can go ahead of the next pending writer.
+        //
+
+        LockInternal->WriterKernelThreadId = 0;
         LockInternal->WriterThreadId = 0;
+        RtlAtomicAdd32(&(LockInternal->WriterSequence), 1);
         LockInternal->State = OS_RWLOCK_UNLOCKED;
 
     //
@@ -381,12 +390,15 @@ Return Value:
 
         if (OldState == 0) {
             return STATUS_PERMISSION_DENIED;
+        }
+
+        OspGetThreadControlBlock()->ReadLockCount -= 1;
 
         //
         // If there are still other readers, don't release the writers.
         //
 
-        } else if (OldState > 1) {
+        if (OldState > 1) {
             return STATUS_SUCCESS;
         }
     }
@@ -440,20 +452,49 @@ Return Value:
 
 {
 
+    BOOL Defer;
     KSTATUS KernelStatus;
     ULONG NewState;
     ULONG OldState;
     ULONG Operation;
+    THREAD_ID Owner;
+    ULONG Sequence;
+    PTHREAD_CONTROL_BLOCK ThreadControlBlock;
     UINTN ThreadId;
+    BOOL Waiting;
 
     ThreadId = OsGetThreadId();
     if (ThreadId == Lock->WriterThreadId) {
         return STATUS_DEADLOCK;
     }
 
+    ThreadControlBlock = OspGetThreadControlBlock();
+    KernelStatus = STATUS_SUCCESS;
+    Sequence = Lock->WriterSequence;
+    Waiting = FALSE;
     while (TRUE) {
         OldState = Lock->State;
-        if (OldState != OS_RWLOCK_WRITE_LOCKED) {
+
+        //
+        // New readers hold off while writers are waiting so that a steady
+        // stream of readers cannot starve writers. Readers that have already
+        // waited out a writer don't defer again, and neither do threads that
+        // already hold a read lock, since the waiting writer may be waiting
+        // on them.
+        //
+
+        Defer = FALSE;
+        if (OldState == OS_RWLOCK_WRITE_LOCKED) {
+            Defer = TRUE;
+
+        } else if ((Lock->PendingWriters != 0) &&
+                   (Lock->WriterSequence == Sequence) &&
+                   (ThreadControlBlock->ReadLockCount == 0)) {
+
+            Defer = TRUE;
+        }
+
+        if (Defer == FALSE) {
             NewState = RtlAtomicCompareExchange32(&(Lock->State),
                                                   OldState + 1,
                                                   OldState);
@@ -467,29 +508,61 @@ Return Value:
                 break;
             }
 
+            continue;
+        }
+
         //
-        // The lock is already acquired for write access.
+        // Spin for a bit in case the holder is about to release the lock.
         //
 
-        } else {
-            Operation = UserLockWait;
-            if ((Lock->Attributes & OS_RWLOCK_SHARED) == 0) {
-                Operation |= USER_LOCK_PRIVATE;
-            }
+        Owner = 0;
+        if (OldState == OS_RWLOCK_WRITE_LOCKED) {
+            Owner = Lock->WriterKernelThreadId;
+        }
+
+        if (OsSpinOnLock(&(Lock->State), OldState, Owner) != FALSE) {
+            continue;
+        }
+
+        //
+        // If the lock is free but a writer is about to take it, there's no
+        // release coming to wake this thread. Just get out of the way.
+        //
+
+        if (OldState == OS_RWLOCK_UNLOCKED) {
+            OsDelayExecution(FALSE, 0);
+            continue;
+        }
+
+        Operation = UserLockWait;
+        if ((Lock->Attributes & OS_RWLOCK_SHARED) == 0) {
+            Operation |= USER_LOCK_PRIVATE;
+        }
 
+        if (Waiting == FALSE) {
             RtlAtomicAdd32(&(Lock->PendingReaders), 1);
-            KernelStatus = OsUserLock(&(Lock->State),
-                                      Operation,
-                                      &OldState,
-                                      TimeoutInMilliseconds);
-
-            RtlAtomicAdd32(&(Lock->PendingReaders), -1);
-            if (KernelStatus == STATUS_TIMEOUT) {
-                return KernelStatus;
-            }
+            Waiting = TRUE;
+        }
+
+        KernelStatus = OsUserLock(&(Lock->State),
+                                  Operation,
+                                  &OldState,
+                                  TimeoutInMilliseconds);
+
+        if (KernelStatus == STATUS_TIMEOUT) {
+            break;
         }
     }
 
+    if (Waiting != FALSE) {
+        RtlAtomicAdd32(&(Lock->PendingReaders), -1);
+    }
+
+    if (KernelStatus == STATUS_TIMEOUT) {
+        return KernelStatus;
+    }
+
+    ThreadControlBlock->ReadLockCount += 1;
     return STATUS_SUCCESS;
 }
 
@@ -524,13 +597,17 @@ Return Value:
     KSTATUS KernelStatus;
     ULONG OldState;
     ULONG Operation;
+    THREAD_ID Owner;
     UINTN ThreadId;
+    BOOL Waiting;
 
     ThreadId = OsGetThreadId();
     if (ThreadId == Lock->WriterThreadId) {
         return STATUS_DEADLOCK;
     }
 
+    KernelStatus = STATUS_SUCCESS;
+    Waiting = FALSE;
     while (TRUE) {
         OldState = Lock->State;
         if (OldState == OS_RWLOCK_UNLOCKED) {
@@ -544,31 +621,55 @@ Return Value:
             //
 
             if (OldState == OS_RWLOCK_UNLOCKED) {
+                Lock->WriterKernelThreadId = OsGetKernelThreadId();
                 Lock->WriterThreadId = ThreadId;
                 break;
             }
 
+            continue;
+        }
+
         //
-        // The lock is already acquired for read or write access.
+        // The lock is already acquired for read or write access. Announce
+        // this writer so that new readers hold off, then spin for a bit
+        // before going to sleep in the kernel.
         //
 
-        } else {
-            Operation = UserLockWait;
-            if ((Lock->Attributes & OS_RWLOCK_SHARED) == 0) {
-                Operation |= USER_LOCK_PRIVATE;
-            }
-
+        if (Waiting == FALSE) {
             RtlAtomicAdd32(&(Lock->PendingWriters), 1);
-            KernelStatus = OsUserLock(&(Lock->State),
-                                      Operation,
-                                      &OldState,
-                                      TimeoutInMilliseconds);
-
-            RtlAtomicAdd32(&(Lock->PendingWriters), -1);
-            if (KernelStatus == STATUS_TIMEOUT) {
-                return KernelStatus;
-            }
+            Waiting = TRUE;
         }
+
+        Owner = 0;
+        if (OldState == OS_RWLOCK_WRITE_LOCKED) {
+            Owner = Lock->WriterKernelThreadId;
+        }
+
+        if (OsSpinOnLock(&(Lock->State), OldState, Owner) != FALSE) {
+            continue;
+        }
+
+        Operation = UserLockWait;
+        if ((Lock->Attributes & OS_RWLOCK_SHARED) == 0) {
+            Operation |= USER_LOCK_PRIVATE;
+        }
+
+        KernelStatus = OsUserLock(&(Lock->State),
+                                  Operation,
+                                  &OldState,
+                                  TimeoutInMilliseconds);
+
+        if (KernelStatus == STATUS_TIMEOUT) {
+            break;
+        }
+    }
+
+    if (Waiting != FALSE) {
+        RtlAtomicAdd32(&(Lock->PendingWriters), -1);
+    }
+
+    if (KernelStatus == STATUS_TIMEOUT) {
+        return KernelStatus;
     }
 
     return STATUS_SUCCESS;
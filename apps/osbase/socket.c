@@ -435,6 +435,57 @@ Return Value:
     return OsSystemCall(SystemCallSocketPerformVectoredIo, &Request);
 }
 
+OS_API
+KSTATUS
+OsSocketPerformMultipleIo (
+    HANDLE Socket,
+    PSOCKET_IO_MESSAGE Messages,
+    UINTN MessageCount,
+    PUINTN MessagesCompleted
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sends or receives several messages on an open socket in a
+    single system call.
+
+Arguments:
+
+    Socket - Supplies a pointer to the socket.
+
+    Messages - Supplies an array of messages to process. Each message carries
+        its own socket I/O parameters, which determine the direction of the
+        transfer and receive the results.
+
+    MessageCount - Supplies the number of elements in the message array. This
+        must not exceed SYS_SOCKET_IO_MAX_MESSAGES.
+
+    MessagesCompleted - Supplies a pointer where the number of messages that
+        were fully processed will be returned.
+
+Return Value:
+
+    Status code. Success is returned if at least one message completed, even if
+    a later message failed.
+
+--*/
+
+{
+
+    SYSTEM_CALL_SOCKET_PERFORM_MULTIPLE_IO Request;
+    KSTATUS Status;
+
+    Request.Socket = Socket;
+    Request.Messages = Messages;
+    Request.MessageCount = MessageCount;
+    Request.MessagesCompleted = 0;
+    Status = OsSystemCall(SystemCallSocketPerformMultipleIo, &Request);
+    *MessagesCompleted = Request.MessagesCompleted;
+    return Status;
+}
+
 OS_API
 KSTATUS
 OsSocketGetSetInformation (
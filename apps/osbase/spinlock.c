@@ -39,6 +39,13 @@ Module Name:
 #define OS_LOCK_LOCKED 1
 #define OS_LOCK_LOCKED_WITH_WAITERS 2
 
+//
+// Define how often, in spin iterations, a spinning thread checks whether the
+// owner of the lock is still running. This must be a power of two.
+//
+
+#define OS_LOCK_OWNER_CHECK_INTERVAL 32
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -51,6 +58,12 @@ Module Name:
 // -------------------------------------------------------------------- Globals
 //
 
+//
+// Store the lock contention statistics for the process.
+//
+
+OS_LOCK_STATISTICS OsLockStatistics;
+
 //
 // ------------------------------------------------------------------ Functions
 //
@@ -120,16 +133,42 @@ Return Value:
     ULONG OriginalValue;
     ULONG SpinCount;
     ULONG SpinIndex;
+    PUSER_SHARED_DATA UserSharedData;
+
+    OriginalValue = RtlAtomicCompareExchange32(&(Lock->Value),
+                                               OS_LOCK_LOCKED,
+                                               OS_LOCK_UNLOCKED);
 
-    SpinCount = Lock->SpinCount;
-    for (SpinIndex = 0; SpinIndex < SpinCount; SpinIndex += 1) {
-        OriginalValue = RtlAtomicCompareExchange32(&(Lock->Value),
-                                                   OS_LOCK_LOCKED,
-                                                   OS_LOCK_UNLOCKED);
+    if (OriginalValue == OS_LOCK_UNLOCKED) {
+        return;
+    }
 
-        if (OriginalValue == OS_LOCK_UNLOCKED) {
-            return;
+    //
+    // On multiprocessor systems, spin for a bit in case the owner is about to
+    // release the lock. Only attempt the atomic when the lock looks free to
+    // avoid bouncing the cache line around. Spinning is pointless on a
+    // uniprocessor system, as the owner cannot run while this thread spins.
+    //
+
+    UserSharedData = OspGetUserSharedData();
+    if (UserSharedData->ProcessorCount > 1) {
+        SpinCount = Lock->SpinCount;
+        for (SpinIndex = 0; SpinIndex < SpinCount; SpinIndex += 1) {
+            if (*((volatile ULONG *)&(Lock->Value)) == OS_LOCK_UNLOCKED) {
+                OriginalValue = RtlAtomicCompareExchange32(&(Lock->Value),
+                                                           OS_LOCK_LOCKED,
+                                                           OS_LOCK_UNLOCKED);
+
+                if (OriginalValue == OS_LOCK_UNLOCKED) {
+                    RtlAtomicAdd32(&(OsLockStatistics.SpinSuccesses), 1);
+                    return;
+                }
+            }
+
+            RtlProcessorYield();
         }
+
+        RtlAtomicAdd32(&(OsLockStatistics.SpinFailures), 1);
     }
 
     //
@@ -236,6 +275,129 @@ Return Value:
     return;
 }
 
+OS_API
+BOOL
+OsSpinOnLock (
+    PULONG Address,
+    ULONG Value,
+    THREAD_ID Owner
+    )
+
+/*++
+
+Routine Description:
+
+    This routine spins briefly waiting for a contended lock value to change,
+    in the hopes of avoiding a trip to the kernel. Spinning stops early if the
+    system has only one processor or the owner of the lock is not running.
+
+Arguments:
+
+    Address - Supplies a pointer to the lock value.
+
+    Value - Supplies the contended value that was observed.
+
+    Owner - Supplies the kernel thread ID (as returned by OsGetKernelThreadId)
+        of the owner of the lock, or 0 if the owner is not known.
+
+Return Value:
+
+    TRUE if the lock value changed while spinning.
+
+    FALSE if the caller should go wait in the kernel.
+
+--*/
+
+{
+
+    BOOL OwnerRunning;
+    ULONG ProcessorCount;
+    ULONG ProcessorIndex;
+    ULONG SpinIndex;
+    PUSER_SHARED_DATA UserSharedData;
+
+    UserSharedData = OspGetUserSharedData();
+    ProcessorCount = UserSharedData->ProcessorCount;
+    if (ProcessorCount <= 1) {
+        return FALSE;
+    }
+
+    for (SpinIndex = 0;
+         SpinIndex < OS_LOCK_ADAPTIVE_SPIN_COUNT;
+         SpinIndex += 1) {
+
+        if (*((volatile ULONG *)Address) != Value) {
+            RtlAtomicAdd32(&(OsLockStatistics.SpinSuccesses), 1);
+            return TRUE;
+        }
+
+        //
+        // Every so often, make sure the owner is still on a processor. If it
+        // has been preempted or has blocked, it won't be releasing the lock
+        // any time soon, and the processor is better spent elsewhere. The
+        // running thread array is only a hint, but that's all this needs.
+        //
+
+        if ((Owner != 0) &&
+            ((SpinIndex & (OS_LOCK_OWNER_CHECK_INTERVAL - 1)) == 0)) {
+
+            OwnerRunning = FALSE;
+            for (ProcessorIndex = 0;
+                 ProcessorIndex < ProcessorCount;
+                 ProcessorIndex += 1) {
+
+                if (UserSharedData->RunningThread[ProcessorIndex].ThreadId ==
+                    Owner) {
+
+                    OwnerRunning = TRUE;
+                    break;
+                }
+            }
+
+            if (OwnerRunning == FALSE) {
+                break;
+            }
+        }
+
+        RtlProcessorYield();
+    }
+
+    RtlAtomicAdd32(&(OsLockStatistics.SpinFailures), 1);
+    return FALSE;
+}
+
+OS_API
+VOID
+OsGetLockStatistics (
+    POS_LOCK_STATISTICS Statistics
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns a snapshot of the lock contention statistics for the
+    current process.
+
+Arguments:
+
+    Statistics - Supplies a pointer where the statistics will be returned.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    Statistics->SpinSuccesses = OsLockStatistics.SpinSuccesses;
+    Statistics->SpinFailures = OsLockStatistics.SpinFailures;
+    Statistics->KernelWaits = OsLockStatistics.KernelWaits;
+    Statistics->KernelWakes = OsLockStatistics.KernelWakes;
+    return;
+}
+
 OS_API
 KSTATUS
 OsUserLock (
@@ -295,6 +457,13 @@ Return Value:
     SYSTEM_CALL_USER_LOCK Parameters;
     KSTATUS Status;
 
+    if ((Operation & USER_LOCK_OPERATION_MASK) == UserLockWait) {
+        RtlAtomicAdd32(&(OsLockStatistics.KernelWaits), 1);
+
+    } else {
+        RtlAtomicAdd32(&(OsLockStatistics.KernelWakes), 1);
+    }
+
     Parameters.Address = Address;
     Parameters.Value = *Value;
     Parameters.Operation = Operation;
@@ -50,11 +50,6 @@ Module Name:
 // ----------------------------------------------- Internal Function Prototypes
 //
 
-PTHREAD_CONTROL_BLOCK
-OspGetThreadControlBlock (
-    VOID
-    );
-
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -286,6 +281,80 @@ Return Value:
     return (UINTN)OspGetThreadControlBlock();
 }
 
+OS_API
+THREAD_ID
+OsGetKernelThreadId (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the kernel's identifier for the currently running
+    thread. The value is queried once and then cached in the thread control
+    block.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns the current thread's kernel thread ID.
+
+--*/
+
+{
+
+    KSTATUS Status;
+    PTHREAD_CONTROL_BLOCK ThreadControlBlock;
+    PROCESS_ID ThreadId;
+
+    ThreadControlBlock = OspGetThreadControlBlock();
+    if (ThreadControlBlock->KernelThreadId == 0) {
+        ThreadId = 0;
+        Status = OsGetProcessId(ProcessIdThread, &ThreadId);
+        if (!KSUCCESS(Status)) {
+            return 0;
+        }
+
+        ThreadControlBlock->KernelThreadId = ThreadId;
+    }
+
+    return ThreadControlBlock->KernelThreadId;
+}
+
+OS_API
+VOID
+OsResetKernelThreadId (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine discards the cached kernel thread ID of the current thread.
+    This must be called in the child of a fork, since the child's thread has
+    a new ID but a copy of the parent's thread control block.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    OspGetThreadControlBlock()->KernelThreadId = 0;
+    return;
+}
+
 OS_API
 KSTATUS
 OsSetThreadPointer (
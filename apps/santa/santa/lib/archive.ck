@@ -565,7 +565,12 @@ class Archive {
             _lz = null;
         }
 
-        _lz = (lzfile.LzFile)(file, mode, 9);
+        //
+        // Archives are written as block archives compressed on every
+        // processor, since this is most of the time spent building a package.
+        //
+
+        _lz = (lzfile.LzFile)(file, mode, 9, 0);
         lzma = BufferedIo(_lz, 0);
         this.lzma = lzma;
         this.cpio = (cpio.CpioArchive)(lzma, mode);
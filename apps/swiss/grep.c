@@ -82,12 +82,31 @@ Module Name:
 #define GREP_HELP 256
 
 //
-// Define the chunk size grep reads in.
+// Define the chunk size grep reads pattern files in.
 //
 
 #define GREP_READ_BLOCK_SIZE 1024
 
-#define GREP_INITIAL_LINE_SIZE 16
+//
+// Define the size of the buffer input files are read into. Lines longer than
+// this cause the buffer to grow.
+//
+
+#define GREP_INPUT_BUFFER_SIZE (64 * 1024)
+
+//
+// Define the maximum size of the dense transition table for the fixed string
+// automaton. Pattern sets larger than this walk the sparse trie instead.
+//
+
+#define GREP_MAX_AUTOMATON_TABLE_SIZE (32 * 1024 * 1024)
+
+//
+// Define the initial number of states allocated for a fixed string
+// automaton.
+//
+
+#define GREP_INITIAL_AUTOMATON_STATES 64
 
 //
 // Define grep options.
@@ -226,6 +245,117 @@ typedef struct _GREP_PATTERN {
 
 /*++
 
+Structure Description:
+
+    This structure defines the buffer that input is read into. Input is read
+    in large blocks and split into lines in place.
+
+Members:
+
+    Data - Stores a pointer to the buffer. One byte beyond the size is
+        allocated so the last line can always be null terminated.
+
+    Size - Stores the size of the buffer, not including the extra byte for
+        the terminator.
+
+    Offset - Stores the offset of the first byte not yet returned as part of
+        a line.
+
+    Length - Stores the number of valid bytes in the buffer.
+
+    EndOfFile - Stores a boolean indicating whether the end of the input has
+        been reached.
+
+--*/
+
+typedef struct _GREP_LINE_BUFFER {
+    PSTR Data;
+    size_t Size;
+    size_t Offset;
+    size_t Length;
+    BOOL EndOfFile;
+} GREP_LINE_BUFFER, *PGREP_LINE_BUFFER;
+
+/*++
+
+Structure Description:
+
+    This structure defines a state in the Aho-Corasick automaton used to
+    search for multiple fixed strings at once. Each state is a node in the
+    trie of patterns. State zero is the root.
+
+Members:
+
+    Child - Stores the index of the first child of this state, or zero if the
+        state has no children.
+
+    Sibling - Stores the index of the next sibling of this state, or zero if
+        this is the last child of its parent.
+
+    Failure - Stores the index of the state for the longest proper suffix of
+        this state's string that is also in the trie.
+
+    Depth - Stores the length of the string this state represents.
+
+    Character - Stores the (folded) character on the edge into this state.
+
+    Terminal - Stores a boolean indicating whether a pattern ends at exactly
+        this state.
+
+    Output - Stores a boolean indicating whether a pattern ends at this state
+        or at any state along its failure chain.
+
+--*/
+
+typedef struct _GREP_AUTOMATON_STATE {
+    ULONG Child;
+    ULONG Sibling;
+    ULONG Failure;
+    ULONG Depth;
+    UCHAR Character;
+    BOOL Terminal;
+    BOOL Output;
+} GREP_AUTOMATON_STATE, *PGREP_AUTOMATON_STATE;
+
+/*++
+
+Structure Description:
+
+    This structure defines an Aho-Corasick automaton matching a set of fixed
+    strings.
+
+Members:
+
+    States - Stores the array of states.
+
+    StateCount - Stores the number of valid states in the array.
+
+    StateCapacity - Stores the number of elements allocated in the array.
+
+    Transitions - Stores an optional dense transition table, indexed by
+        state times the class count plus the class of the input byte. This
+        is NULL if the table would have been too large, in which case the
+        trie and failure links are walked directly.
+
+    ClassCount - Stores the number of byte classes. Class zero is every byte
+        that does not appear in any pattern.
+
+    ClassMap - Stores the class of each input byte. Case folding is built
+        into this map.
+
+--*/
+
+typedef struct _GREP_AUTOMATON {
+    PGREP_AUTOMATON_STATE States;
+    ULONG StateCount;
+    ULONG StateCapacity;
+    PULONG Transitions;
+    ULONG ClassCount;
+    USHORT ClassMap[256];
+} GREP_AUTOMATON, *PGREP_AUTOMATON;
+
+/*++
+
 Structure Description:
 
     This structure defines the context for an instantiation of the grep
@@ -239,12 +369,25 @@ Structure Description:
 
     Options - Stores the application options. See GREP_OPTION_* definitions.
 
+    Automaton - Stores a pointer to the automaton matching all fixed string
+        patterns. This is NULL for regular expressions, and when there is
+        only a single case sensitive fixed string.
+
+    FixedString - Stores a pointer to the only fixed string pattern if the
+        automaton is not used.
+
+    FixedStringLength - Stores the length of the single fixed string, not
+        including the null terminator.
+
 --*/
 
 typedef struct _GREP_CONTEXT {
     LIST_ENTRY InputList;
     LIST_ENTRY PatternList;
     ULONG Options;
+    PGREP_AUTOMATON Automaton;
+    PSTR FixedString;
+    size_t FixedStringLength;
 } GREP_CONTEXT, *PGREP_CONTEXT;
 
 //
@@ -268,6 +411,36 @@ GrepCompileRegularExpressions (
     PGREP_CONTEXT Context
     );
 
+INT
+GrepCompileFixedStrings (
+    PGREP_CONTEXT Context
+    );
+
+INT
+GrepAddAutomatonState (
+    PGREP_AUTOMATON Automaton,
+    ULONG Parent,
+    UCHAR Character
+    );
+
+ULONG
+GrepFindAutomatonChild (
+    PGREP_AUTOMATON Automaton,
+    ULONG State,
+    UCHAR Character
+    );
+
+INT
+GrepBuildAutomatonTransitions (
+    PGREP_AUTOMATON Automaton,
+    PULONG Queue
+    );
+
+VOID
+GrepDestroyAutomaton (
+    PGREP_AUTOMATON Automaton
+    );
+
 INT
 GrepAddInputFile (
     PGREP_CONTEXT Context,
@@ -284,30 +457,38 @@ INT
 GrepProcessInputEntry (
     PGREP_CONTEXT Context,
     PGREP_INPUT Input,
-    PSTR *Buffer,
-    size_t *BufferSize
+    PGREP_LINE_BUFFER Buffer
     );
 
 INT
 GrepReadLine (
     PGREP_CONTEXT Context,
     PGREP_INPUT Input,
-    PSTR *Buffer,
-    size_t *BufferSize
+    PGREP_LINE_BUFFER Buffer,
+    PSTR *Line,
+    size_t *LineLength
+    );
+
+BOOL
+GrepMatchLine (
+    PGREP_CONTEXT Context,
+    PSTR Input,
+    size_t InputLength
     );
 
 BOOL
 GrepMatchPattern (
     PGREP_CONTEXT Context,
     PSTR Input,
+    size_t InputLength,
     PGREP_PATTERN Pattern
     );
 
 BOOL
-GrepMatchFixedString (
+GrepMatchFixedStrings (
     PGREP_CONTEXT Context,
     PSTR Input,
-    PGREP_PATTERN Pattern
+    size_t InputLength
     );
 
 //
@@ -562,7 +743,13 @@ Return Value:
         ReadFromStandardIn = FALSE;
     }
 
-    Status = GrepCompileRegularExpressions(&Context);
+    if ((Context.Options & GREP_OPTION_FIXED_STRINGS) != 0) {
+        Status = GrepCompileFixedStrings(&Context);
+
+    } else {
+        Status = GrepCompileRegularExpressions(&Context);
+    }
+
     if (Status != 0) {
         goto MainEnd;
     }
@@ -663,6 +850,10 @@ Return Value:
         free(Pattern);
     }
 
+    if (Context.Automaton != NULL) {
+        GrepDestroyAutomaton(Context.Automaton);
+    }
+
     return Status;
 }
 
@@ -1038,18 +1229,15 @@ Return Value:
     INT Status;
 
     //
-    // Skip this if they're just fixed strings and not regular expressions.
+    // Figure out the compile flags. Matching the whole line needs the match
+    // offsets, otherwise only whether or not there was a match is needed.
     //
 
-    if ((Context->Options & GREP_OPTION_FIXED_STRINGS) != 0) {
-        return 0;
+    CompileFlags = 0;
+    if ((Context->Options & GREP_OPTION_FULL_LINE_ONLY) == 0) {
+        CompileFlags |= REG_NOSUB;
     }
 
-    //
-    // Figure out the compile flags.
-    //
-
-    CompileFlags = REG_NOSUB;
     if ((Context->Options & GREP_OPTION_EXTENDED_EXPRESSIONS) != 0) {
         CompileFlags |= REG_EXTENDED;
     }
@@ -1102,26 +1290,23 @@ Return Value:
 }
 
 INT
-GrepAddInputFile (
-    PGREP_CONTEXT Context,
-    PSTR Path,
-    ULONG RecursionLevel
+GrepCompileFixedStrings (
+    PGREP_CONTEXT Context
     )
 
 /*++
 
 Routine Description:
 
-    This routine adds a file to the list of files grep should process.
+    This routine prepares the fixed string patterns for searching. A single
+    case sensitive pattern is searched for directly. Otherwise an
+    Aho-Corasick automaton is built so that every pattern is searched for in a
+    single pass over each line.
 
 Arguments:
 
     Context - Supplies a pointer to the application context.
 
-    Path - Supplies a pointer to the file path to add.
-
-    RecursionLevel - Supplies the recursion depth of this function.
-
 Return Value:
 
     0 on success.
@@ -1132,186 +1317,629 @@ Return Value:
 
 {
 
-    PSTR AppendedPath;
-    ULONG AppendedPathSize;
-    DIR *Directory;
-    struct dirent *Entry;
-    PGREP_INPUT InputEntry;
-    struct stat Stat;
+    PGREP_AUTOMATON Automaton;
+    UCHAR Character;
+    PLIST_ENTRY CurrentEntry;
+    BOOL IgnoreCase;
+    ULONG Next;
+    PGREP_PATTERN Pattern;
+    ULONG PatternCount;
+    PUCHAR PatternString;
+    PULONG Queue;
+    ULONG State;
     INT Status;
-    INT TotalStatus;
 
-    Directory = NULL;
-    InputEntry = NULL;
-    TotalStatus = 0;
-    Status = SwStat(Path, TRUE, &Stat);
-    if (Status != 0) {
-        Status = errno;
-        SwPrintError(Status, Path, "Unable to stat");
-        goto AddInputFileEnd;
+    Automaton = NULL;
+    Queue = NULL;
+    IgnoreCase = FALSE;
+    if ((Context->Options & GREP_OPTION_IGNORE_CASE) != 0) {
+        IgnoreCase = TRUE;
     }
 
-    if (S_ISDIR(Stat.st_mode)) {
-
-        //
-        // Skip it unless recursive mode is on.
-        //
+    PatternCount = 0;
+    CurrentEntry = Context->PatternList.Next;
+    while (CurrentEntry != &(Context->PatternList)) {
+        PatternCount += 1;
+        CurrentEntry = CurrentEntry->Next;
+    }
 
-        if ((Context->Options & GREP_OPTION_RECURSIVE) == 0) {
-            Status = 0;
-            goto AddInputFileEnd;
-        }
+    if ((PatternCount == 1) && (IgnoreCase == FALSE)) {
+        Pattern = LIST_VALUE(Context->PatternList.Next,
+                             GREP_PATTERN,
+                             ListEntry);
 
-        if (RecursionLevel >= GREP_MAX_RECURSION_DEPTH) {
-            SwPrintError(Status, Path, "Max recursion depth reached");
-            Status = ELOOP;
-            goto AddInputFileEnd;
-        }
+        Context->FixedString = Pattern->Pattern;
+        Context->FixedStringLength = strlen(Pattern->Pattern);
+        Status = 0;
+        goto CompileFixedStringsEnd;
+    }
 
-        Directory = opendir(Path);
-        if (Directory == NULL) {
-            Status = errno;
-            SwPrintError(Status, Path, "Unable to open directory");
-            goto AddInputFileEnd;
-        }
+    Automaton = malloc(sizeof(GREP_AUTOMATON));
+    if (Automaton == NULL) {
+        Status = ENOMEM;
+        goto CompileFixedStringsEnd;
+    }
 
-        //
-        // Loop through all entries in the directory.
-        //
+    memset(Automaton, 0, sizeof(GREP_AUTOMATON));
+    Automaton->StateCapacity = GREP_INITIAL_AUTOMATON_STATES;
+    Automaton->States = malloc(Automaton->StateCapacity *
+                               sizeof(GREP_AUTOMATON_STATE));
 
-        while (TRUE) {
-            errno = 0;
-            Entry = readdir(Directory);
-            if (Entry == NULL) {
-                Status = errno;
-                if (Status != 0) {
-                    SwPrintError(Status, Path, "Unable to read directory");
-                    goto AddInputFileEnd;
-                }
+    if (Automaton->States == NULL) {
+        Status = ENOMEM;
+        goto CompileFixedStringsEnd;
+    }
 
-                break;
-            }
+    memset(&(Automaton->States[0]), 0, sizeof(GREP_AUTOMATON_STATE));
+    Automaton->StateCount = 1;
 
-            if ((strcmp(Entry->d_name, ".") == 0) ||
-                (strcmp(Entry->d_name, "..") == 0)) {
+    //
+    // Add each pattern to the trie, folding case if needed. Each distinct
+    // character gets its own byte class.
+    //
 
-                continue;
+    Automaton->ClassCount = 1;
+    CurrentEntry = Context->PatternList.Next;
+    while (CurrentEntry != &(Context->PatternList)) {
+        Pattern = LIST_VALUE(CurrentEntry, GREP_PATTERN, ListEntry);
+        CurrentEntry = CurrentEntry->Next;
+        State = 0;
+        PatternString = (PUCHAR)(Pattern->Pattern);
+        while (*PatternString != '\0') {
+            Character = *PatternString;
+            if (IgnoreCase != FALSE) {
+                Character = tolower(Character);
             }
 
-            Status = SwAppendPath(Path,
-                                  strlen(Path) + 1,
-                                  Entry->d_name,
-                                  strlen(Entry->d_name) + 1,
-                                  &AppendedPath,
-                                  &AppendedPathSize);
-
-            if (Status == FALSE) {
-                Status = ENOMEM;
-                goto AddInputFileEnd;
+            if (Automaton->ClassMap[Character] == 0) {
+                Automaton->ClassMap[Character] = Automaton->ClassCount;
+                Automaton->ClassCount += 1;
             }
 
-            Status = GrepAddInputFile(Context,
-                                      AppendedPath,
-                                      RecursionLevel + 1);
+            Next = GrepFindAutomatonChild(Automaton, State, Character);
+            if (Next == 0) {
+                Status = GrepAddAutomatonState(Automaton, State, Character);
+                if (Status != 0) {
+                    goto CompileFixedStringsEnd;
+                }
 
-            free(AppendedPath);
-            if (Status != 0) {
-                TotalStatus = Status;
+                Next = Automaton->StateCount - 1;
             }
+
+            State = Next;
+            PatternString += 1;
         }
 
+        Automaton->States[State].Terminal = TRUE;
+        Automaton->States[State].Output = TRUE;
+    }
+
     //
-    // This is not a directory, add it as an input.
+    // With case folding, the upper case version of each character maps to
+    // the same class as its lower case version.
     //
 
-    } else {
-        InputEntry = malloc(sizeof(GREP_INPUT));
-        if (InputEntry == NULL) {
-            Status = ENOMEM;
-            goto AddInputFileEnd;
+    if (IgnoreCase != FALSE) {
+        for (Next = 0; Next < 256; Next += 1) {
+            Character = tolower(Next);
+            Automaton->ClassMap[Next] = Automaton->ClassMap[Character];
         }
+    }
 
-        memset(InputEntry, 0, sizeof(GREP_INPUT));
-        InputEntry->FileName = strdup(Path);
-        if (InputEntry->FileName == NULL) {
-            Status = ENOMEM;
-            goto AddInputFileEnd;
-        }
+    //
+    // Compute the failure links breadth first, so that a state's failure
+    // state (which is always shallower) is done before the state itself.
+    //
 
-        InputEntry->Binary = FALSE;
-        INSERT_BEFORE(&(InputEntry->ListEntry), &(Context->InputList));
-        InputEntry = NULL;
+    Queue = malloc(Automaton->StateCount * sizeof(ULONG));
+    if (Queue == NULL) {
+        Status = ENOMEM;
+        goto CompileFixedStringsEnd;
     }
 
+    Status = GrepBuildAutomatonTransitions(Automaton, Queue);
+    if (Status != 0) {
+        goto CompileFixedStringsEnd;
+    }
+
+    Context->Automaton = Automaton;
+    Automaton = NULL;
     Status = 0;
 
-AddInputFileEnd:
-    if (Directory != NULL) {
-        closedir(Directory);
+CompileFixedStringsEnd:
+    if (Queue != NULL) {
+        free(Queue);
     }
 
-    if (TotalStatus != 0) {
-        Status = TotalStatus;
+    if (Automaton != NULL) {
+        GrepDestroyAutomaton(Automaton);
     }
 
     return Status;
 }
 
 INT
-GrepProcessInput (
-    PGREP_CONTEXT Context
+GrepAddAutomatonState (
+    PGREP_AUTOMATON Automaton,
+    ULONG Parent,
+    UCHAR Character
     )
 
 /*++
 
 Routine Description:
 
-    This routine compiles all regular expression patterns if appropriate.
+    This routine adds a new state to the fixed string automaton trie.
 
 Arguments:
 
-    Context - Supplies a pointer to the application context.
+    Automaton - Supplies a pointer to the automaton.
+
+    Parent - Supplies the index of the parent state.
+
+    Character - Supplies the folded character on the edge from the parent to
+        the new state.
 
 Return Value:
 
-    0 on success.
+    0 on success. The new state is the last state in the array.
 
-    Non-zero on failure.
+    ENOMEM on allocation failure.
 
 --*/
 
 {
 
-    PLIST_ENTRY CurrentEntry;
-    BOOL FileOpened;
-    PGREP_INPUT Input;
-    PSTR LineBuffer;
-    size_t LineBufferSize;
-    INT Status;
-    INT TotalStatus;
+    PGREP_AUTOMATON_STATE NewState;
+    PGREP_AUTOMATON_STATE NewStates;
+    ULONG State;
 
-    LineBuffer = NULL;
-    LineBufferSize = 0;
-    TotalStatus = 1;
+    if (Automaton->StateCount == Automaton->StateCapacity) {
+        NewStates = realloc(Automaton->States,
+                            Automaton->StateCapacity * 2 *
+                            sizeof(GREP_AUTOMATON_STATE));
 
-    //
-    // Just loop through each input.
-    //
+        if (NewStates == NULL) {
+            return ENOMEM;
+        }
 
-    CurrentEntry = Context->InputList.Next;
-    while (CurrentEntry != &(Context->InputList)) {
-        Input = LIST_VALUE(CurrentEntry, GREP_INPUT, ListEntry);
-        CurrentEntry = CurrentEntry->Next;
-        FileOpened = FALSE;
-        if (Input->File == NULL) {
-            Input->File = fopen(Input->FileName, "rb");
-            if (Input->File == NULL) {
-                if ((Context->Options &
-                     GREP_OPTION_SUPPRESS_BLAND_ERRORS) == 0) {
+        Automaton->States = NewStates;
+        Automaton->StateCapacity *= 2;
+    }
 
-                    Status = errno;
-                    SwPrintError(Status, Input->FileName, "Unable to open");
-                    TotalStatus = 2;
+    State = Automaton->StateCount;
+    Automaton->StateCount += 1;
+    NewState = &(Automaton->States[State]);
+    memset(NewState, 0, sizeof(GREP_AUTOMATON_STATE));
+    NewState->Character = Character;
+    NewState->Depth = Automaton->States[Parent].Depth + 1;
+    NewState->Sibling = Automaton->States[Parent].Child;
+    Automaton->States[Parent].Child = State;
+    return 0;
+}
+
+ULONG
+GrepFindAutomatonChild (
+    PGREP_AUTOMATON Automaton,
+    ULONG State,
+    UCHAR Character
+    )
+
+/*++
+
+Routine Description:
+
+    This routine finds the trie child of the given state for a character.
+
+Arguments:
+
+    Automaton - Supplies a pointer to the automaton.
+
+    State - Supplies the index of the parent state.
+
+    Character - Supplies the folded character to look up.
+
+Return Value:
+
+    Returns the index of the child state on success.
+
+    0 if the state has no child for the given character. The root is never
+    a child, so this is unambiguous.
+
+--*/
+
+{
+
+    ULONG Child;
+
+    Child = Automaton->States[State].Child;
+    while (Child != 0) {
+        if (Automaton->States[Child].Character == Character) {
+            break;
+        }
+
+        Child = Automaton->States[Child].Sibling;
+    }
+
+    return Child;
+}
+
+INT
+GrepBuildAutomatonTransitions (
+    PGREP_AUTOMATON Automaton,
+    PULONG Queue
+    )
+
+/*++
+
+Routine Description:
+
+    This routine computes the failure links and output flags of every state
+    in the fixed string automaton, and builds the dense transition table if
+    it is small enough.
+
+Arguments:
+
+    Automaton - Supplies a pointer to the automaton, whose trie has been
+        fully built.
+
+    Queue - Supplies a pointer to scratch space big enough to hold an index
+        for every state.
+
+Return Value:
+
+    0 on success.
+
+    ENOMEM on allocation failure.
+
+--*/
+
+{
+
+    ULONG Child;
+    ULONG Class;
+    ULONG ClassCount;
+    ULONG Failure;
+    ULONG Head;
+    ULONG Next;
+    PGREP_AUTOMATON_STATE States;
+    ULONG State;
+    size_t TableSize;
+    ULONG Tail;
+    PULONG Transitions;
+
+    States = Automaton->States;
+    Head = 0;
+    Tail = 0;
+    Queue[Tail] = 0;
+    Tail += 1;
+    while (Head != Tail) {
+        State = Queue[Head];
+        Head += 1;
+        Child = States[State].Child;
+        while (Child != 0) {
+            Queue[Tail] = Child;
+            Tail += 1;
+            if (State == 0) {
+                States[Child].Failure = 0;
+
+            } else {
+                Failure = States[State].Failure;
+                while (TRUE) {
+                    Next = GrepFindAutomatonChild(Automaton,
+                                                  Failure,
+                                                  States[Child].Character);
+
+                    if ((Next != 0) || (Failure == 0)) {
+                        break;
+                    }
+
+                    Failure = States[Failure].Failure;
+                }
+
+                States[Child].Failure = Next;
+                if (States[Next].Output != FALSE) {
+                    States[Child].Output = TRUE;
+                }
+            }
+
+            Child = States[Child].Sibling;
+        }
+    }
+
+    assert(Tail == Automaton->StateCount);
+
+    //
+    // Build the dense table if it fits. The queue holds the states in
+    // breadth first order, so the failure state's row is always complete
+    // before it's needed.
+    //
+
+    ClassCount = Automaton->ClassCount;
+    TableSize = (size_t)(Automaton->StateCount) * ClassCount * sizeof(ULONG);
+    if ((TableSize / ClassCount / sizeof(ULONG) != Automaton->StateCount) ||
+        (TableSize > GREP_MAX_AUTOMATON_TABLE_SIZE)) {
+
+        return 0;
+    }
+
+    Transitions = malloc(TableSize);
+    if (Transitions == NULL) {
+        return ENOMEM;
+    }
+
+    for (Head = 0; Head < Tail; Head += 1) {
+        State = Queue[Head];
+        if (State == 0) {
+            memset(Transitions, 0, ClassCount * sizeof(ULONG));
+
+        } else {
+            memcpy(&(Transitions[State * ClassCount]),
+                   &(Transitions[States[State].Failure * ClassCount]),
+                   ClassCount * sizeof(ULONG));
+        }
+
+        Child = States[State].Child;
+        while (Child != 0) {
+            Class = Automaton->ClassMap[States[Child].Character];
+            Transitions[State * ClassCount + Class] = Child;
+            Child = States[Child].Sibling;
+        }
+    }
+
+    Automaton->Transitions = Transitions;
+    return 0;
+}
+
+VOID
+GrepDestroyAutomaton (
+    PGREP_AUTOMATON Automaton
+    )
+
+/*++
+
+Routine Description:
+
+    This routine destroys a fixed string automaton.
+
+Arguments:
+
+    Automaton - Supplies a pointer to the automaton to destroy.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    if (Automaton->Transitions != NULL) {
+        free(Automaton->Transitions);
+    }
+
+    if (Automaton->States != NULL) {
+        free(Automaton->States);
+    }
+
+    free(Automaton);
+    return;
+}
+
+INT
+GrepAddInputFile (
+    PGREP_CONTEXT Context,
+    PSTR Path,
+    ULONG RecursionLevel
+    )
+
+/*++
+
+Routine Description:
+
+    This routine adds a file to the list of files grep should process.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Path - Supplies a pointer to the file path to add.
+
+    RecursionLevel - Supplies the recursion depth of this function.
+
+Return Value:
+
+    0 on success.
+
+    Non-zero on failure.
+
+--*/
+
+{
+
+    PSTR AppendedPath;
+    ULONG AppendedPathSize;
+    DIR *Directory;
+    struct dirent *Entry;
+    PGREP_INPUT InputEntry;
+    struct stat Stat;
+    INT Status;
+    INT TotalStatus;
+
+    Directory = NULL;
+    InputEntry = NULL;
+    TotalStatus = 0;
+    Status = SwStat(Path, TRUE, &Stat);
+    if (Status != 0) {
+        Status = errno;
+        SwPrintError(Status, Path, "Unable to stat");
+        goto AddInputFileEnd;
+    }
+
+    if (S_ISDIR(Stat.st_mode)) {
+
+        //
+        // Skip it unless recursive mode is on.
+        //
+
+        if ((Context->Options & GREP_OPTION_RECURSIVE) == 0) {
+            Status = 0;
+            goto AddInputFileEnd;
+        }
+
+        if (RecursionLevel >= GREP_MAX_RECURSION_DEPTH) {
+            SwPrintError(Status, Path, "Max recursion depth reached");
+            Status = ELOOP;
+            goto AddInputFileEnd;
+        }
+
+        Directory = opendir(Path);
+        if (Directory == NULL) {
+            Status = errno;
+            SwPrintError(Status, Path, "Unable to open directory");
+            goto AddInputFileEnd;
+        }
+
+        //
+        // Loop through all entries in the directory.
+        //
+
+        while (TRUE) {
+            errno = 0;
+            Entry = readdir(Directory);
+            if (Entry == NULL) {
+                Status = errno;
+                if (Status != 0) {
+                    SwPrintError(Status, Path, "Unable to read directory");
+                    goto AddInputFileEnd;
+                }
+
+                break;
+            }
+
+            if ((strcmp(Entry->d_name, ".") == 0) ||
+                (strcmp(Entry->d_name, "..") == 0)) {
+
+                continue;
+            }
+
+            Status = SwAppendPath(Path,
+                                  strlen(Path) + 1,
+                                  Entry->d_name,
+                                  strlen(Entry->d_name) + 1,
+                                  &AppendedPath,
+                                  &AppendedPathSize);
+
+            if (Status == FALSE) {
+                Status = ENOMEM;
+                goto AddInputFileEnd;
+            }
+
+            Status = GrepAddInputFile(Context,
+                                      AppendedPath,
+                                      RecursionLevel + 1);
+
+            free(AppendedPath);
+            if (Status != 0) {
+                TotalStatus = Status;
+            }
+        }
+
+    //
+    // This is not a directory, add it as an input.
+    //
+
+    } else {
+        InputEntry = malloc(sizeof(GREP_INPUT));
+        if (InputEntry == NULL) {
+            Status = ENOMEM;
+            goto AddInputFileEnd;
+        }
+
+        memset(InputEntry, 0, sizeof(GREP_INPUT));
+        InputEntry->FileName = strdup(Path);
+        if (InputEntry->FileName == NULL) {
+            Status = ENOMEM;
+            goto AddInputFileEnd;
+        }
+
+        InputEntry->Binary = FALSE;
+        INSERT_BEFORE(&(InputEntry->ListEntry), &(Context->InputList));
+        InputEntry = NULL;
+    }
+
+    Status = 0;
+
+AddInputFileEnd:
+    if (Directory != NULL) {
+        closedir(Directory);
+    }
+
+    if (TotalStatus != 0) {
+        Status = TotalStatus;
+    }
+
+    return Status;
+}
+
+INT
+GrepProcessInput (
+    PGREP_CONTEXT Context
+    )
+
+/*++
+
+Routine Description:
+
+    This routine compiles all regular expression patterns if appropriate.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+Return Value:
+
+    0 on success.
+
+    Non-zero on failure.
+
+--*/
+
+{
+
+    GREP_LINE_BUFFER Buffer;
+    PLIST_ENTRY CurrentEntry;
+    BOOL FileOpened;
+    PGREP_INPUT Input;
+    INT Status;
+    INT TotalStatus;
+
+    TotalStatus = 1;
+    memset(&Buffer, 0, sizeof(GREP_LINE_BUFFER));
+    Buffer.Size = GREP_INPUT_BUFFER_SIZE;
+    Buffer.Data = malloc(Buffer.Size + 1);
+    if (Buffer.Data == NULL) {
+        return ENOMEM;
+    }
+
+    //
+    // Just loop through each input.
+    //
+
+    CurrentEntry = Context->InputList.Next;
+    while (CurrentEntry != &(Context->InputList)) {
+        Input = LIST_VALUE(CurrentEntry, GREP_INPUT, ListEntry);
+        CurrentEntry = CurrentEntry->Next;
+        FileOpened = FALSE;
+        if (Input->File == NULL) {
+            Input->File = fopen(Input->FileName, "rb");
+            if (Input->File == NULL) {
+                if ((Context->Options &
+                     GREP_OPTION_SUPPRESS_BLAND_ERRORS) == 0) {
+
+                    Status = errno;
+                    SwPrintError(Status, Input->FileName, "Unable to open");
+                    TotalStatus = 2;
                     continue;
                 }
             }
@@ -1319,11 +1947,7 @@ Return Value:
             FileOpened = TRUE;
         }
 
-        Status = GrepProcessInputEntry(Context,
-                                       Input,
-                                       &LineBuffer,
-                                       &LineBufferSize);
-
+        Status = GrepProcessInputEntry(Context, Input, &Buffer);
         if (FileOpened != FALSE) {
             fclose(Input->File);
             Input->File = NULL;
@@ -1339,10 +1963,7 @@ Return Value:
         }
     }
 
-    if (LineBuffer != NULL) {
-        free(LineBuffer);
-    }
-
+    free(Buffer.Data);
     return TotalStatus;
 }
 
@@ -1350,15 +1971,14 @@ INT
 GrepProcessInputEntry (
     PGREP_CONTEXT Context,
     PGREP_INPUT Input,
-    PSTR *Buffer,
-    size_t *BufferSize
+    PGREP_LINE_BUFFER Buffer
     )
 
 /*++
 
 Routine Description:
 
-    This routine compiles all regular expression patterns if appropriate.
+    This routine searches a single input, printing the selected lines.
 
 Arguments:
 
@@ -1366,12 +1986,7 @@ Routine Description:
 
     Input - Supplies a pointer to the input entry.
 
-    Buffer - Supplies a pointer that on input contains a buffer. On output,
-        returns a potentially reallocated buffer.
-
-    BufferSize - Supplies a pointer that on input contains the size of the
-        input buffer. On output, returns the potentially expanded size of the
-        buffer.
+    Buffer - Supplies a pointer to the line buffer to read the input into.
 
 Return Value:
 
@@ -1385,22 +2000,25 @@ Return Value:
 
 {
 
-    PLIST_ENTRY CurrentEntry;
+    PSTR Line;
+    size_t LineLength;
     ULONG LineNumber;
     BOOL Match;
     ULONG MatchCount;
-    PGREP_PATTERN Pattern;
     INT Status;
 
     LineNumber = 1;
     MatchCount = 0;
+    Buffer->Offset = 0;
+    Buffer->Length = 0;
+    Buffer->EndOfFile = FALSE;
 
     //
-    // Loop across every line.
+    // Loop across every line. A line is selected if any pattern matches it.
     //
 
     while (TRUE) {
-        Status = GrepReadLine(Context, Input, Buffer, BufferSize);
+        Status = GrepReadLine(Context, Input, Buffer, &Line, &LineLength);
         if (Status == EOF) {
             Status = 0;
             break;
@@ -1409,79 +2027,63 @@ Return Value:
             goto ProcessInputEntryEnd;
         }
 
-        CurrentEntry = Context->PatternList.Next;
-        while (CurrentEntry != &(Context->PatternList)) {
-            Pattern = LIST_VALUE(CurrentEntry, GREP_PATTERN, ListEntry);
-            CurrentEntry = CurrentEntry->Next;
-            Match = GrepMatchPattern(Context, *Buffer, Pattern);
-            if (Match != FALSE) {
-                MatchCount += 1;
-            }
-
-            //
-            // If it didn't match, keep going.
-            //
-
-            if (Match == FALSE) {
-                continue;
-            }
-
-            if ((Context->Options & GREP_OPTION_QUIET) != 0) {
-                continue;
-            }
-
-            //
-            // If there are more than one file elements and the file name was
-            // not already printed, precede the match with the file name.
-            //
+        Match = GrepMatchLine(Context, Line, LineLength);
+        if (Match == FALSE) {
+            LineNumber += 1;
+            continue;
+        }
 
-            if ((Context->Options & GREP_OPTION_PRINT_FILE_NAMES) != 0) {
-                if ((Context->Options &
-                     GREP_OPTION_SUPPRESS_MATCH_PRINT) != 0) {
+        MatchCount += 1;
+        if ((Context->Options & GREP_OPTION_QUIET) != 0) {
+            break;
+        }
 
-                    printf("%s\n", Input->FileName);
-                    break;
+        //
+        // When only listing the files that match, print the name and stop.
+        //
 
-                } else {
-                    printf("%s:", Input->FileName);
-                }
-            }
+        if ((Context->Options & GREP_OPTION_SUPPRESS_MATCH_PRINT) != 0) {
+            printf("%s\n", Input->FileName);
+            break;
+        }
 
-            //
-            // With line counts only, just keep going.
-            //
+        //
+        // With line counts only, just keep going.
+        //
 
-            if ((Context->Options & GREP_OPTION_LINE_COUNT) != 0) {
-                continue;
-            }
+        if ((Context->Options & GREP_OPTION_LINE_COUNT) != 0) {
+            LineNumber += 1;
+            continue;
+        }
 
-            if (Input->Binary != FALSE) {
-                printf("Binary file %s matches.\n", Input->FileName);
-                break;
-            }
+        if (Input->Binary != FALSE) {
+            printf("Binary file %s matches.\n", Input->FileName);
+            break;
+        }
 
-            //
-            // If a line number is desired, print that too.
-            //
+        //
+        // If there are more than one file elements, precede the match with
+        // the file name.
+        //
 
-            if ((Context->Options & GREP_OPTION_PRINT_LINE_NUMBERS) != 0) {
-                printf("%d:", LineNumber);
-            }
+        if ((Context->Options & GREP_OPTION_PRINT_FILE_NAMES) != 0) {
+            printf("%s:", Input->FileName);
+        }
 
-            //
-            // Print the line itself.
-            //
+        //
+        // If a line number is desired, print that too.
+        //
 
-            printf("%s\n", *Buffer);
+        if ((Context->Options & GREP_OPTION_PRINT_LINE_NUMBERS) != 0) {
+            printf("%d:", LineNumber);
         }
 
-        LineNumber += 1;
-        if ((MatchCount != 0) &&
-            ((Input->Binary != FALSE) ||
-             ((Context->Options & GREP_OPTION_SUPPRESS_MATCH_PRINT) != 0))) {
+        //
+        // Print the line itself.
+        //
 
-            break;
-        }
+        printf("%s\n", Line);
+        LineNumber += 1;
     }
 
     //
@@ -1492,6 +2094,10 @@ Return Value:
         ((Context->Options & GREP_OPTION_QUIET) == 0) &&
         ((Context->Options & GREP_OPTION_SUPPRESS_MATCH_PRINT) == 0)) {
 
+        if ((Context->Options & GREP_OPTION_PRINT_FILE_NAMES) != 0) {
+            printf("%s:", Input->FileName);
+        }
+
         printf("%d\n", MatchCount);
     }
 
@@ -1509,15 +2115,19 @@ INT
 GrepReadLine (
     PGREP_CONTEXT Context,
     PGREP_INPUT Input,
-    PSTR *Buffer,
-    size_t *BufferSize
+    PGREP_LINE_BUFFER Buffer,
+    PSTR *Line,
+    size_t *LineLength
     )
 
 /*++
 
 Routine Description:
 
-    This routine reads a new line into the given buffer.
+    This routine returns the next line of input. Input is read in large
+    blocks, and lines are split out of the buffer in place. Both newlines and
+    null characters terminate a line. A null character also marks the input
+    as binary.
 
 Arguments:
 
@@ -1525,14 +2135,14 @@ Routine Description:
 
     Input - Supplies a pointer to the input to read from.
 
-    Buffer - Supplies a pointer that on input contains a buffer. On output,
-        returns the buffer containing the line, which may be reallocated from
-        the original.
+    Buffer - Supplies a pointer to the line buffer the input is read into.
 
-    BufferSize - Supplies a pointer that on input contains the size of the
-        input buffer. On output, returns the potentially expanded size of the
-        buffer. Note that this returns the size of the allocation, not the
-        length of the string. The string is null terminated.
+    Line - Supplies a pointer where a pointer to the null terminated line is
+        returned on success. The line lives in the buffer, and is only valid
+        until the next call to read a line.
+
+    LineLength - Supplies a pointer where the length of the line is returned
+        on success, not including the null terminator.
 
 Return Value:
 
@@ -1546,113 +2156,133 @@ Return Value:
 
 {
 
-    INT Character;
-    size_t CharacterCount;
-    PSTR NewBuffer;
-    INT Status;
-    PSTR String;
-    size_t StringSize;
-
-    CharacterCount = 0;
-    String = *Buffer;
-    StringSize = *BufferSize;
-
-    //
-    // Loop reading characters.
-    //
+    size_t Available;
+    ssize_t BytesRead;
+    PSTR End;
+    size_t Length;
+    PSTR NewData;
+    PSTR Null;
+    PSTR Start;
 
     while (TRUE) {
 
         //
-        // Ensure that the string is big enough to take two more characters.
+        // Skip over any null terminators at the beginning.
         //
 
-        if (CharacterCount + 2 > StringSize) {
-            if (StringSize == 0) {
-                StringSize = GREP_INITIAL_LINE_SIZE;
+        while ((Buffer->Offset < Buffer->Length) &&
+               (Buffer->Data[Buffer->Offset] == '\0')) {
+
+            Input->Binary = TRUE;
+            Buffer->Offset += 1;
+        }
+
+        Start = Buffer->Data + Buffer->Offset;
+        Available = Buffer->Length - Buffer->Offset;
+        if (Available != 0) {
+            End = memchr(Start, '\n', Available);
+            if (End != NULL) {
+                Length = End - Start;
 
             } else {
-                StringSize *= 2;
+                Length = Available;
+            }
+
+            Null = memchr(Start, '\0', Length);
+            if (Null != NULL) {
+                Input->Binary = TRUE;
+                End = Null;
+                Length = End - Start;
             }
 
-            assert(StringSize >= CharacterCount + 2);
+            //
+            // Return the line if it's terminated, or if it's the last bit of
+            // input. The buffer always has room for a terminator at the end.
+            //
 
-            NewBuffer = realloc(String, StringSize);
-            if (NewBuffer == NULL) {
-                Status = ENOMEM;
-                goto ReadLineEnd;
+            if (End != NULL) {
+                Buffer->Offset += Length + 1;
+                break;
+            }
+
+            if (Buffer->EndOfFile != FALSE) {
+                Buffer->Offset += Length;
+                break;
             }
 
-            String = NewBuffer;
+        } else if (Buffer->EndOfFile != FALSE) {
+            return EOF;
         }
 
         //
-        // Get a new character. If it's the end of the file, terminate this
-        // line, or if this line is empty, return EOF overall.
+        // Move the partial line to the front of the buffer, and double the
+        // buffer if the line fills all of it.
         //
 
-        Character = fgetc(Input->File);
-        if (Character == EOF) {
-            if (CharacterCount != 0) {
-                break;
+        if (Buffer->Offset != 0) {
+            if (Available != 0) {
+                memmove(Buffer->Data, Start, Available);
             }
 
-            Status = EOF;
-            goto ReadLineEnd;
+            Buffer->Offset = 0;
+            Buffer->Length = Available;
+        }
 
-        } else {
-            if (Character == '\0') {
-                Input->Binary = TRUE;
+        if (Buffer->Length == Buffer->Size) {
+            NewData = realloc(Buffer->Data, (Buffer->Size * 2) + 1);
+            if (NewData == NULL) {
+                return ENOMEM;
             }
 
-            //
-            // Skip over any null terminators at the beginning.
-            //
+            Buffer->Data = NewData;
+            Buffer->Size *= 2;
+        }
 
-            if ((Character == '\0') && (CharacterCount == 0)) {
-                continue;
-            }
+        do {
+            BytesRead = read(fileno(Input->File),
+                             Buffer->Data + Buffer->Length,
+                             Buffer->Size - Buffer->Length);
 
-            if ((Character == '\n') || (Character == '\0')) {
-                break;
+        } while ((BytesRead < 0) && (errno == EINTR));
 
-            } else {
-                String[CharacterCount] = Character;
-                CharacterCount += 1;
-            }
+        if (BytesRead < 0) {
+            return errno;
+        }
+
+        if (BytesRead == 0) {
+            Buffer->EndOfFile = TRUE;
         }
+
+        Buffer->Length += BytesRead;
     }
 
     //
     // Kill a CR at the end of the line.
     //
 
-    if ((CharacterCount != 0) && (String[CharacterCount - 1] == '\r')) {
-        CharacterCount -= 1;
+    if ((Length != 0) && (Start[Length - 1] == '\r')) {
+        Length -= 1;
     }
 
-    String[CharacterCount] = '\0';
-    Status = 0;
-
-ReadLineEnd:
-    *Buffer = String;
-    *BufferSize = StringSize;
-    return Status;
+    Start[Length] = '\0';
+    *Line = Start;
+    *LineLength = Length;
+    return 0;
 }
 
 BOOL
-GrepMatchPattern (
+GrepMatchLine (
     PGREP_CONTEXT Context,
     PSTR Input,
-    PGREP_PATTERN Pattern
+    size_t InputLength
     )
 
 /*++
 
 Routine Description:
 
-    This routine determines if the given input line matches a grep pattern,
-    and prints out match information if it does.
+    This routine determines if the given input line is selected by the
+    pattern list.
 
 Arguments:
 
@@ -1660,41 +2290,35 @@ Routine Description:
 
     Input - Supplies a pointer to the null terminated input line.
 
-    Pattern - Supplies a pointer to the pattern to match against.
+    InputLength - Supplies the length of the input line, not including the
+        null terminator.
 
 Return Value:
 
-    TRUE if the pattern matched the input.
+    TRUE if the line is selected.
 
-    FALSE if there was no matched.
+    FALSE if the line is not selected.
 
 --*/
 
 {
 
-    regmatch_t ExpressionMatch;
+    PLIST_ENTRY CurrentEntry;
     BOOL Match;
-    INT Status;
+    PGREP_PATTERN Pattern;
 
     Match = FALSE;
-
-    //
-    // First figure out if the pattern matched.
-    //
-
     if ((Context->Options & GREP_OPTION_FIXED_STRINGS) != 0) {
-        Match = GrepMatchFixedString(Context, Input, Pattern);
+        Match = GrepMatchFixedStrings(Context, Input, InputLength);
 
     } else {
-        Status = regexec(&(Pattern->Expression), Input, 1, &ExpressionMatch, 0);
-        if (Status == 0) {
-            Match = TRUE;
-            if ((Context->Options & GREP_OPTION_FULL_LINE_ONLY) != 0) {
-                if ((ExpressionMatch.rm_so != 0) ||
-                    (Input[ExpressionMatch.rm_eo - 1] != '\0')) {
-
-                    Match = FALSE;
-                }
+        CurrentEntry = Context->PatternList.Next;
+        while (CurrentEntry != &(Context->PatternList)) {
+            Pattern = LIST_VALUE(CurrentEntry, GREP_PATTERN, ListEntry);
+            CurrentEntry = CurrentEntry->Next;
+            Match = GrepMatchPattern(Context, Input, InputLength, Pattern);
+            if (Match != FALSE) {
+                break;
             }
         }
     }
@@ -1707,9 +2331,10 @@ Return Value:
 }
 
 BOOL
-GrepMatchFixedString (
+GrepMatchPattern (
     PGREP_CONTEXT Context,
     PSTR Input,
+    size_t InputLength,
     PGREP_PATTERN Pattern
     )
 
@@ -1717,7 +2342,8 @@ GrepMatchFixedString (
 
 Routine Description:
 
-    This routine attempts to match against a fixed string pattern.
+    This routine determines if the given input line matches a regular
+    expression pattern.
 
 Arguments:
 
@@ -1725,6 +2351,9 @@ Routine Description:
 
     Input - Supplies a pointer to the null terminated input line.
 
+    InputLength - Supplies the length of the input line, not including the
+        null terminator.
+
     Pattern - Supplies a pointer to the pattern to match against.
 
 Return Value:
@@ -1737,68 +2366,202 @@ Return Value:
 
 {
 
-    ULONG BeginIndex;
-    BOOL IgnoreCase;
+    regmatch_t ExpressionMatch;
     BOOL Match;
-    PSTR PatternString;
-    ULONG SearchIndex;
+    INT Status;
 
-    IgnoreCase = FALSE;
-    if ((Context->Options & GREP_OPTION_IGNORE_CASE) != 0) {
-        IgnoreCase = TRUE;
+    Match = FALSE;
+    Status = regexec(&(Pattern->Expression), Input, 1, &ExpressionMatch, 0);
+    if (Status == 0) {
+        Match = TRUE;
+        if ((Context->Options & GREP_OPTION_FULL_LINE_ONLY) != 0) {
+            if ((ExpressionMatch.rm_so != 0) ||
+                (ExpressionMatch.rm_eo != InputLength)) {
+
+                Match = FALSE;
+            }
+        }
     }
 
-    Match = FALSE;
-    PatternString = Pattern->Pattern;
-    SearchIndex = 0;
-    BeginIndex = 0;
-    while (Input[BeginIndex] != '\0') {
-        SearchIndex = 0;
+    return Match;
+}
 
-        //
-        // This seems like a mess, but isn't so bad. Loop as long as:
-        // 1. The pattern hasn't ended, AND
-        // 2. Either:
-        //    a. The pattern matches the input, OR
-        //    b. "Ignore case" is on and the lowercase versions of the pattern
-        //       and inputs match.
-        //
-        // See, not so bad.
-        //
+BOOL
+GrepMatchFixedStrings (
+    PGREP_CONTEXT Context,
+    PSTR Input,
+    size_t InputLength
+    )
+
+/*++
+
+Routine Description:
+
+    This routine attempts to match an input line against the fixed string
+    patterns.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Input - Supplies a pointer to the null terminated input line.
+
+    InputLength - Supplies the length of the input line, not including the
+        null terminator.
+
+Return Value:
+
+    TRUE if any pattern matched the input.
 
-        while ((PatternString[SearchIndex] != '\0') &&
-               ((Input[BeginIndex + SearchIndex] ==
-                 PatternString[SearchIndex]) ||
-                ((IgnoreCase != FALSE) &&
-                 (tolower(Input[BeginIndex + SearchIndex]) ==
-                  tolower(PatternString[SearchIndex]))))) {
+    FALSE if there was no matched.
+
+--*/
+
+{
+
+    PGREP_AUTOMATON Automaton;
+    ULONG Child;
+    USHORT Class;
+    PUSHORT ClassMap;
+    PUCHAR Current;
+    PUCHAR End;
+    BOOL FullLine;
+    PSTR Last;
+    PSTR Pattern;
+    size_t PatternLength;
+    PSTR Search;
+    ULONG State;
+    PGREP_AUTOMATON_STATE States;
+    PULONG Transitions;
+
+    FullLine = FALSE;
+    if ((Context->Options & GREP_OPTION_FULL_LINE_ONLY) != 0) {
+        FullLine = TRUE;
+    }
 
-            SearchIndex += 1;
+    //
+    // Search for a single pattern by looking for its first character with
+    // memchr, which the C library can scan for a word or more at a time, and
+    // then comparing the rest.
+    //
+
+    Automaton = Context->Automaton;
+    if (Automaton == NULL) {
+        Pattern = Context->FixedString;
+        PatternLength = Context->FixedStringLength;
+        if (FullLine != FALSE) {
+            if ((InputLength == PatternLength) &&
+                (memcmp(Input, Pattern, PatternLength) == 0)) {
+
+                return TRUE;
+            }
+
+            return FALSE;
         }
 
-        if (PatternString[SearchIndex] == '\0') {
-            Match = TRUE;
-            break;
+        if (PatternLength == 0) {
+            return TRUE;
+        }
+
+        if (PatternLength > InputLength) {
+            return FALSE;
+        }
+
+        Search = Input;
+        Last = Input + InputLength - PatternLength;
+        while (TRUE) {
+            Search = memchr(Search, *Pattern, Last + 1 - Search);
+            if (Search == NULL) {
+                return FALSE;
+            }
+
+            if (memcmp(Search + 1, Pattern + 1, PatternLength - 1) == 0) {
+                return TRUE;
+            }
+
+            Search += 1;
         }
+    }
+
+    //
+    // Run the automaton over the line. Without the full line option, stop as
+    // soon as any pattern ends. With it, the line matches only if the state
+    // at the end of the line is a pattern as long as the line itself, since
+    // the automaton always sits in the state for the longest suffix of the
+    // input that's in the trie.
+    //
 
-        BeginIndex += 1;
+    States = Automaton->States;
+    ClassMap = Automaton->ClassMap;
+    Transitions = Automaton->Transitions;
+    State = 0;
+    if ((FullLine == FALSE) && (States[0].Output != FALSE)) {
+        return TRUE;
     }
 
+    Current = (PUCHAR)Input;
+    End = Current + InputLength;
+    if (Transitions != NULL) {
+        while (Current < End) {
+            State = Transitions[(State * Automaton->ClassCount) +
+                                ClassMap[*Current]];
+
+            if ((FullLine == FALSE) && (States[State].Output != FALSE)) {
+                return TRUE;
+            }
+
+            Current += 1;
+        }
+
     //
-    // If there's a match and it's required to use up the whole line, see that
-    // it does. That case could have been optimized by stopping the loop above
-    // early, but it's expected to be an uncommonly used flag, so adding the
-    // extra compare in every loop iteration seemed worse.
+    // Without the dense table, walk the trie, following failure links until
+    // a state with an edge for the character is found. Edges are compared
+    // by class so that case folding is handled by the class map.
     //
 
-    if ((Match != FALSE) &&
-        ((Context->Options & GREP_OPTION_FULL_LINE_ONLY) != 0)) {
+    } else {
+        while (Current < End) {
+            Class = ClassMap[*Current];
+            if (Class == 0) {
+                State = 0;
+
+            } else {
+                while (TRUE) {
+                    Child = States[State].Child;
+                    while ((Child != 0) &&
+                           (ClassMap[States[Child].Character] != Class)) {
+
+                        Child = States[Child].Sibling;
+                    }
+
+                    if (Child != 0) {
+                        State = Child;
+                        break;
+                    }
+
+                    if (State == 0) {
+                        break;
+                    }
+
+                    State = States[State].Failure;
+                }
+            }
+
+            if ((FullLine == FALSE) && (States[State].Output != FALSE)) {
+                return TRUE;
+            }
 
-        if ((BeginIndex != 0) || (Input[BeginIndex + SearchIndex] != '\0')) {
-            Match = FALSE;
+            Current += 1;
         }
     }
 
-    return Match;
+    if ((FullLine != FALSE) &&
+        (States[State].Terminal != FALSE) &&
+        (States[State].Depth == InputLength)) {
+
+        return TRUE;
+    }
+
+    return FALSE;
 }
 
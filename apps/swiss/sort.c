@@ -49,7 +49,8 @@ Module Name:
 #define SORT_VERSION_MINOR 0
 
 #define SORT_USAGE                                                             \
-    "usage: sort [-m][-o output][-bdfinru][-t char][-k keydef]... [file...]\n" \
+    "usage: sort [-m][-o output][-bdfinru][-S size][-t char][-k keydef]... \n" \
+    "            [file...]\n"                                                  \
     "       sort -c [-bdfinru][-t char][-k keydef][file]\n\n"                  \
     "The sort utility either sorts all lines in a file, merges line of all \n" \
     "the named (presorted) files together, or checks to see if a single \n"    \
@@ -84,10 +85,17 @@ Module Name:
     "        flag meaning to that specific field.\n"                           \
     "  -t, --field-separator <character> -- Use the given character as a \n"   \
     "        field separator.\n"                                               \
+    "  -S, --buffer-size <size> -- Use at most about this much memory to \n"   \
+    "        hold lines. Larger inputs are sorted in runs spilled to \n"       \
+    "        temporary files and then merged. The size is in kilobytes, \n"    \
+    "        or may have a suffix of b, K, M, or G.\n"                         \
+    "  --parallel <count> -- Sort using the given number of threads. The \n"   \
+    "        default is the number of processors, up to 8.\n"                  \
     "  file -- Supplies the input file to sort. If no file is supplied or \n"  \
     "        the file is -, then use stdin.\n\n"
 
-#define SORT_OPTIONS_STRING "cmo:udfinrbk:t:"
+#define SORT_OPTIONS_STRING "cmo:udfinrbk:t:S:"
+#define SORT_PARALLEL_OPTION 256
 
 //
 // Set this option to ignore leading blanks in comparisons.
@@ -148,6 +156,58 @@ Module Name:
 #define SORT_INITIAL_ELEMENT_COUNT 32
 #define SORT_INITIAL_STRING_SIZE 32
 
+//
+// Define the size of the block each input is read in.
+//
+
+#define SORT_READ_BUFFER_SIZE (64 * 1024)
+
+//
+// Define the default and minimum amount of memory used to hold lines before
+// spilling a sorted run to a temporary file.
+//
+
+#define SORT_DEFAULT_BUFFER_SIZE (64 * 1024 * 1024)
+#define SORT_MINIMUM_BUFFER_SIZE 1024
+
+//
+// Define the approximate bookkeeping cost of each line held in memory, beyond
+// the line itself: the string structure, its array slot, and the allocator
+// headers of the two allocations.
+//
+
+#define SORT_LINE_OVERHEAD \
+    (sizeof(SORT_STRING) + sizeof(PVOID) + (4 * sizeof(PVOID)))
+
+//
+// Define the maximum number of threads used by default, and the maximum that
+// can be requested.
+//
+
+#define SORT_DEFAULT_MAX_THREADS 8
+#define SORT_MAX_THREADS 64
+
+//
+// Define the minimum number of lines each thread sorts. Below this it's not
+// worth creating threads.
+//
+
+#define SORT_MINIMUM_CHUNK_LINES 4096
+
+//
+// Define the maximum number of runs merged at once. More runs than this are
+// merged in several passes to bound the number of open files.
+//
+
+#define SORT_MAX_MERGE_INPUTS 32
+
+//
+// Define the number of runs at which some are merged together while the
+// input is still being read, to bound the number of open temporary files.
+//
+
+#define SORT_MAX_OPEN_RUNS (SORT_MAX_MERGE_INPUTS * 2)
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -212,12 +272,18 @@ Structure Description:
 
     Capacity - Supplies the size of the buffer allocation.
 
+    Sequence - Supplies the position of the line among the lines being sorted
+        in memory, which breaks ties between lines with equal keys when only
+        unique lines are being output. Lines read back from sorted files
+        leave this zero.
+
 --*/
 
 typedef struct _SORT_STRING {
     PSTR Data;
     UINTN Size;
     UINTN Capacity;
+    UINTN Sequence;
 } SORT_STRING, *PSORT_STRING;
 
 /*++
@@ -233,11 +299,21 @@ Structure Description:
 
     Line - Stores a pointer to the string containing the most recent line.
 
+    Buffer - Stores a pointer to the block of input read from the file, which
+        is split into lines.
+
+    Offset - Stores the offset of the next unconsumed byte in the buffer.
+
+    Length - Stores the number of valid bytes in the buffer.
+
 --*/
 
 typedef struct _SORT_INPUT {
     FILE *File;
     PSORT_STRING Line;
+    PSTR Buffer;
+    UINTN Offset;
+    UINTN Length;
 } SORT_INPUT, *PSORT_INPUT;
 
 /*++
@@ -294,6 +370,11 @@ Structure Description:
     Separator - Stores the field separator character, or -1 if none was
         supplied.
 
+    BufferSize - Stores the approximate number of bytes of lines to hold in
+        memory before spilling a sorted run to a temporary file.
+
+    ThreadCount - Stores the number of threads to sort with.
+
 --*/
 
 typedef struct _SORT_CONTEXT {
@@ -302,8 +383,65 @@ typedef struct _SORT_CONTEXT {
     ULONG Options;
     PSTR Output;
     INT Separator;
+    UINTN BufferSize;
+    ULONG ThreadCount;
 } SORT_CONTEXT, *PSORT_CONTEXT;
 
+/*++
+
+Structure Description:
+
+    This structure defines the state of a k-way merge. The merge sources are
+    kept in a binary min-heap ordered by their current lines, with ties going
+    to the lower numbered source.
+
+Members:
+
+    Lines - Stores the array of current lines for each source. A source
+        whose line is NULL is drained.
+
+    Heap - Stores the heap of source indices. The winning source is at the
+        top.
+
+    Count - Stores the number of sources in the heap.
+
+--*/
+
+typedef struct _SORT_MERGE {
+    PSORT_STRING *Lines;
+    PULONG Heap;
+    ULONG Count;
+} SORT_MERGE, *PSORT_MERGE;
+
+/*++
+
+Structure Description:
+
+    This structure defines a portion of the line array sorted by one thread.
+
+Members:
+
+    Lines - Stores a pointer to the first line in the chunk.
+
+    Count - Stores the number of lines in the chunk.
+
+    Next - Stores the index of the next line to be merged out of the chunk.
+
+    Thread - Stores the thread sorting the chunk.
+
+    ThreadCreated - Stores a boolean indicating whether the thread was
+        created. If not, the chunk is sorted by the calling thread.
+
+--*/
+
+typedef struct _SORT_CHUNK {
+    PVOID *Lines;
+    UINTN Count;
+    UINTN Next;
+    pthread_t Thread;
+    BOOL ThreadCreated;
+} SORT_CHUNK, *PSORT_CHUNK;
+
 //
 // ----------------------------------------------- Internal Function Prototypes
 //
@@ -317,15 +455,101 @@ SortCheckFile (
 INT
 SortMergeSortedFiles (
     PSORT_CONTEXT Context,
+    PSORT_ARRAY Inputs,
+    FILE *Output
+    );
+
+INT
+SortSortInputs (
+    PSORT_CONTEXT Context,
+    FILE *Output
+    );
+
+INT
+SortSpillRun (
+    PSORT_CONTEXT Context,
+    PSORT_ARRAY Lines,
+    PSORT_ARRAY Runs
+    );
+
+INT
+SortMergeRuns (
+    PSORT_CONTEXT Context,
+    PSORT_ARRAY Runs,
+    FILE *Output
+    );
+
+INT
+SortCombineRuns (
+    PSORT_CONTEXT Context,
+    PSORT_ARRAY Runs
+    );
+
+INT
+SortWriteLines (
+    PSORT_CONTEXT Context,
+    PSORT_ARRAY Lines,
     FILE *Output
     );
 
+PVOID
+SortChunkThread (
+    PVOID Parameter
+    );
+
+INT
+SortInitializeMerge (
+    PSORT_MERGE Merge,
+    ULONG SourceCount
+    );
+
+VOID
+SortBuildMergeHeap (
+    PSORT_MERGE Merge,
+    ULONG SourceCount
+    );
+
+VOID
+SortUpdateMergeHeap (
+    PSORT_MERGE Merge
+    );
+
+VOID
+SortSiftMergeHeap (
+    PSORT_MERGE Merge,
+    ULONG Index
+    );
+
+BOOL
+SortIsMergeSourceLess (
+    PSORT_MERGE Merge,
+    ULONG Left,
+    ULONG Right
+    );
+
+VOID
+SortDestroyMerge (
+    PSORT_MERGE Merge
+    );
+
+INT
+SortParseSize (
+    PSTR Argument,
+    PUINTN Size
+    );
+
 INT
 SortCompareLines (
     const VOID *LeftPointer,
     const VOID *RightPointer
     );
 
+INT
+SortCompareKeys (
+    const VOID *LeftPointer,
+    const VOID *RightPointer
+    );
+
 INT
 SortReadLine (
     PSORT_CONTEXT Context,
@@ -359,9 +583,10 @@ SortArrayAddElement (
     );
 
 INT
-SortStringAddCharacter (
+SortStringAddCharacters (
     PSORT_STRING String,
-    CHAR Character
+    PSTR Characters,
+    UINTN Count
     );
 
 PSORT_STRING
@@ -426,6 +651,8 @@ struct option SortLongOptions[] = {
     {"ignore-leading-blanks", no_argument, 0, 'b'},
     {"key", required_argument, 0, 'k'},
     {"field-separator", required_argument, 0, 't'},
+    {"buffer-size", required_argument, 0, 'S'},
+    {"parallel", required_argument, 0, SORT_PARALLEL_OPTION},
     {"help", no_argument, 0, 'h'},
     {"version", no_argument, 0, 'V'},
     {NULL, 0, 0, 0}
@@ -462,28 +689,31 @@ Return Value:
 
 {
 
+    PSTR AfterScan;
     PSTR Argument;
     ULONG ArgumentIndex;
     SORT_CONTEXT Context;
-    PSORT_INPUT Input;
-    ULONG InputIndex;
-    PSORT_STRING InputLine;
-    SORT_ARRAY InputLines;
-    SORT_STRING InputString;
     PSORT_KEY Key;
     UINTN KeyIndex;
-    UINTN LineIndex;
     INT Option;
     FILE *Output;
-    PSORT_STRING PreviousLine;
+    INT ProcessorCount;
     INT Status;
+    LONG ThreadCount;
 
-    Input = NULL;
-    InputLine = NULL;
     memset(&Context, 0, sizeof(SORT_CONTEXT));
-    memset(&InputString, 0, sizeof(SORT_STRING));
-    memset(&InputLines, 0, sizeof(SORT_ARRAY));
     Context.Separator = -1;
+    Context.BufferSize = SORT_DEFAULT_BUFFER_SIZE;
+    ProcessorCount = SwGetProcessorCount(TRUE);
+    if (ProcessorCount < 1) {
+        ProcessorCount = 1;
+    }
+
+    Context.ThreadCount = ProcessorCount;
+    if (Context.ThreadCount > SORT_DEFAULT_MAX_THREADS) {
+        Context.ThreadCount = SORT_DEFAULT_MAX_THREADS;
+    }
+
     Output = NULL;
 
     //
@@ -629,6 +859,43 @@ Return Value:
 
             break;
 
+        case 'S':
+            Argument = optarg;
+
+            assert(Argument != NULL);
+
+            Status = SortParseSize(Argument, &(Context.BufferSize));
+            if (Status != 0) {
+                SwPrintError(0, Argument, "Invalid buffer size");
+                return 2;
+            }
+
+            if (Context.BufferSize < SORT_MINIMUM_BUFFER_SIZE) {
+                Context.BufferSize = SORT_MINIMUM_BUFFER_SIZE;
+            }
+
+            break;
+
+        case SORT_PARALLEL_OPTION:
+            Argument = optarg;
+
+            assert(Argument != NULL);
+
+            ThreadCount = strtol(Argument, &AfterScan, 10);
+            if ((AfterScan == Argument) || (*AfterScan != '\0') ||
+                (ThreadCount < 1)) {
+
+                SwPrintError(0, Argument, "Invalid thread count");
+                return 2;
+            }
+
+            if (ThreadCount > SORT_MAX_THREADS) {
+                ThreadCount = SORT_MAX_THREADS;
+            }
+
+            Context.ThreadCount = ThreadCount;
+            break;
+
         case 'V':
             SwPrintVersion(SORT_VERSION_MAJOR, SORT_VERSION_MINOR);
             return 1;
@@ -729,344 +996,1293 @@ Return Value:
         goto MainEnd;
 
     } else if ((Context.Options & SORT_OPTION_MERGE_ONLY) != 0) {
-        Status = SortMergeSortedFiles(&Context, Output);
+        Status = SortMergeSortedFiles(&Context, &(Context.Input), Output);
         goto MainEnd;
     }
 
     //
-    // This is the real sort, not merge or check. Read in all inputs.
+    // This is the real sort, not merge or check.
     //
 
-    for (InputIndex = 0; InputIndex < Context.Input.Size; InputIndex += 1) {
-        Input = Context.Input.Data[InputIndex];
-        while (TRUE) {
-            Status = SortReadLine(&Context,
-                                  Input,
-                                  &InputString,
-                                  &InputLine);
-
-            if (Status != 0) {
-                SwPrintError(Status, NULL, "Failed to read line");
-                goto MainEnd;
-            }
+    Status = SortSortInputs(&Context, Output);
 
-            if (InputLine == NULL) {
-                break;
-            }
+MainEnd:
+    SortContext = NULL;
+    if ((Output != NULL) && (Output != stdout)) {
+        fclose(Output);
+    }
 
-            Status = SortArrayAddElement(&InputLines, InputLine);
-            if (Status != 0) {
-                SortDestroyString(InputLine);
-                goto MainEnd;
-            }
+    SortDestroyArray(&(Context.Input),
+                     (PSORT_DESTROY_ARRAY_ELEMENT_ROUTINE)SortDestroyInput);
 
-            InputLine = NULL;
-        }
+    SortDestroyArray(&(Context.Key), free);
+    if ((Status != 0) && (Status != 1)) {
+        SwPrintError(Status, NULL, "Sort exiting abnormally");
     }
 
-    if (InputLines.Size == 0) {
-        Status = 0;
-        goto MainEnd;
-    }
+    return Status;
+}
 
-    //
-    // Do it, sort the arrays.
-    //
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+INT
+SortCheckFile (
+    PSORT_CONTEXT Context,
+    PSORT_INPUT Input
+    )
 
-    qsort(InputLines.Data, InputLines.Size, sizeof(PVOID), SortCompareLines);
+/*++
 
-    //
-    // Write all the lines to the output.
-    //
+Routine Description:
+
+    This routine checks a file to see if it is sorted (and optionally unique).
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Input - Supplies a pointer to the input to check.
+
+Return Value:
+
+    0 if the file is sorted.
+
+    1 if the file is not sorted.
+
+    >1 error number if an error occurred.
+
+--*/
+
+{
+
+    INT Comparison;
+    PSORT_STRING Line;
+    PSORT_STRING PreviousLine;
+    INT Status;
+    SORT_STRING WorkingBuffer;
 
+    memset(&WorkingBuffer, 0, sizeof(SORT_STRING));
+    Line = NULL;
     PreviousLine = NULL;
-    for (LineIndex = 0; LineIndex < InputLines.Size; LineIndex += 1) {
-        InputLine = InputLines.Data[LineIndex];
+    while (TRUE) {
+        Status = SortReadLine(Context,
+                              Input,
+                              &WorkingBuffer,
+                              &Line);
 
-        //
-        // If the unique flag is off, this is the first line, or the lines
-        // aren't equal then print the line.
-        //
+        if (Status != 0) {
+            SwPrintError(Status, NULL, "Failed to read file");
+            goto CheckFileEnd;
+        }
+
+        if (Line == NULL) {
+            break;
+        }
+
+        if (PreviousLine != NULL) {
+            Comparison = SortCompareKeys(&PreviousLine, &Line);
+            if (Comparison > 1) {
+                Status = 1;
+                goto CheckFileEnd;
+            }
+
+            if (((Context->Options & SORT_OPTION_UNIQUE) != 0) &&
+                (Comparison == 0)) {
+
+                Status = 1;
+                goto CheckFileEnd;
+            }
+
+            SortDestroyString(PreviousLine);
+        }
+
+        PreviousLine = Line;
+        Line = NULL;
+    }
+
+    Status = 0;
+
+CheckFileEnd:
+    if (WorkingBuffer.Data != NULL) {
+        free(WorkingBuffer.Data);
+    }
+
+    if (Line != NULL) {
+        SortDestroyString(Line);
+    }
+
+    if (PreviousLine != NULL) {
+        SortDestroyString(PreviousLine);
+    }
+
+    return Status;
+}
+
+INT
+SortMergeSortedFiles (
+    PSORT_CONTEXT Context,
+    PSORT_ARRAY Inputs,
+    FILE *Output
+    )
+
+/*++
+
+Routine Description:
+
+    This routine merges several files that are already in order.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Inputs - Supplies a pointer to the array of inputs to merge.
+
+    Output - Supplies a pointer to the output file to write to.
+
+Return Value:
+
+    0 on success.
+
+    Non-zero on failure.
+
+--*/
+
+{
+
+    PSORT_INPUT Input;
+    UINTN InputIndex;
+    SORT_MERGE Merge;
+    PSORT_STRING PreviousWinner;
+    INT Status;
+    PSORT_INPUT Winner;
+    SORT_STRING WorkingBuffer;
+
+    PreviousWinner = NULL;
+    memset(&WorkingBuffer, 0, sizeof(SORT_STRING));
+    Status = SortInitializeMerge(&Merge, Inputs->Size);
+    if (Status != 0) {
+        goto MergeSortedFilesEnd;
+    }
+
+    //
+    // Prime all the inputs by reading their first lines.
+    //
+
+    for (InputIndex = 0; InputIndex < Inputs->Size; InputIndex += 1) {
+        Input = Inputs->Data[InputIndex];
+        Status = SortReadLine(Context,
+                              Input,
+                              &WorkingBuffer,
+                              &(Input->Line));
+
+        if (Status != 0) {
+            SwPrintError(Status, NULL, "Failed to read file");
+            goto MergeSortedFilesEnd;
+        }
+
+        Merge.Lines[InputIndex] = Input->Line;
+    }
+
+    SortBuildMergeHeap(&Merge, Inputs->Size);
+
+    //
+    // Loop getting the winning line until all files are drained.
+    //
+
+    while (Merge.Count != 0) {
+        Winner = Inputs->Data[Merge.Heap[0]];
+
+        //
+        // Print the line.
+        //
+
+        if (((Context->Options & SORT_OPTION_UNIQUE) == 0) ||
+            (PreviousWinner == NULL) ||
+            (SortCompareKeys(&(Winner->Line), &PreviousWinner) != 0)) {
+
+            fputs(Winner->Line->Data, Output);
+            fputc('\n', Output);
+        }
+
+        //
+        // Set the new previous winner, and read a new line from that winning
+        // file.
+        //
+
+        if (PreviousWinner != NULL) {
+            SortDestroyString(PreviousWinner);
+        }
+
+        PreviousWinner = Winner->Line;
+        Status = SortReadLine(Context,
+                              Winner,
+                              &WorkingBuffer,
+                              &(Winner->Line));
+
+        if (Status != 0) {
+            SwPrintError(Status, NULL, "Failed to read file");
+            goto MergeSortedFilesEnd;
+        }
+
+        Merge.Lines[Merge.Heap[0]] = Winner->Line;
+        SortUpdateMergeHeap(&Merge);
+    }
+
+    Status = 0;
+
+MergeSortedFilesEnd:
+    if (PreviousWinner != NULL) {
+        SortDestroyString(PreviousWinner);
+    }
+
+    if (WorkingBuffer.Data != NULL) {
+        free(WorkingBuffer.Data);
+    }
+
+    SortDestroyMerge(&Merge);
+    return Status;
+}
+
+INT
+SortSortInputs (
+    PSORT_CONTEXT Context,
+    FILE *Output
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sorts all the inputs and writes them to the output. Lines
+    are read into memory until the buffer size is reached, at which point
+    they're sorted and spilled as a run to a temporary file. If anything was
+    spilled, the runs are merged into the output at the end.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Output - Supplies a pointer to the output file to write to.
+
+Return Value:
+
+    0 on success.
+
+    Non-zero on failure.
+
+--*/
+
+{
+
+    PSORT_INPUT Input;
+    UINTN InputIndex;
+    PSORT_STRING InputLine;
+    SORT_ARRAY InputLines;
+    SORT_STRING InputString;
+    UINTN MemoryUsed;
+    SORT_ARRAY Runs;
+    INT Status;
+
+    InputLine = NULL;
+    MemoryUsed = 0;
+    memset(&InputString, 0, sizeof(SORT_STRING));
+    memset(&InputLines, 0, sizeof(SORT_ARRAY));
+    memset(&Runs, 0, sizeof(SORT_ARRAY));
+    for (InputIndex = 0; InputIndex < Context->Input.Size; InputIndex += 1) {
+        Input = Context->Input.Data[InputIndex];
+        while (TRUE) {
+            Status = SortReadLine(Context,
+                                  Input,
+                                  &InputString,
+                                  &InputLine);
+
+            if (Status != 0) {
+                SwPrintError(Status, NULL, "Failed to read line");
+                goto SortInputsEnd;
+            }
+
+            if (InputLine == NULL) {
+                break;
+            }
+
+            InputLine->Sequence = InputLines.Size;
+            Status = SortArrayAddElement(&InputLines, InputLine);
+            if (Status != 0) {
+                SortDestroyString(InputLine);
+                goto SortInputsEnd;
+            }
+
+            MemoryUsed += InputLine->Capacity + SORT_LINE_OVERHEAD;
+            InputLine = NULL;
+            if (MemoryUsed >= Context->BufferSize) {
+                Status = SortSpillRun(Context, &InputLines, &Runs);
+                if (Status != 0) {
+                    goto SortInputsEnd;
+                }
+
+                MemoryUsed = 0;
+                if (Runs.Size >= SORT_MAX_OPEN_RUNS) {
+                    Status = SortCombineRuns(Context, &Runs);
+                    if (Status != 0) {
+                        goto SortInputsEnd;
+                    }
+                }
+            }
+        }
+    }
+
+    //
+    // If it all fit in memory, sort it and write it straight out.
+    //
+
+    if (Runs.Size == 0) {
+        Status = SortWriteLines(Context, &InputLines, Output);
+        goto SortInputsEnd;
+    }
+
+    if (InputLines.Size != 0) {
+        Status = SortSpillRun(Context, &InputLines, &Runs);
+        if (Status != 0) {
+            goto SortInputsEnd;
+        }
+    }
+
+    Status = SortMergeRuns(Context, &Runs, Output);
+
+SortInputsEnd:
+    if (InputString.Data != NULL) {
+        free(InputString.Data);
+    }
+
+    SortDestroyArray(&InputLines,
+                     (PSORT_DESTROY_ARRAY_ELEMENT_ROUTINE)SortDestroyString);
+
+    SortDestroyArray(&Runs,
+                     (PSORT_DESTROY_ARRAY_ELEMENT_ROUTINE)SortDestroyInput);
+
+    return Status;
+}
+
+INT
+SortSpillRun (
+    PSORT_CONTEXT Context,
+    PSORT_ARRAY Lines,
+    PSORT_ARRAY Runs
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sorts the lines held in memory and writes them out to a new
+    temporary file, then frees the lines.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Lines - Supplies a pointer to the array of lines to spill. On success,
+        this array is emptied.
+
+    Runs - Supplies a pointer to the array of run inputs to add the new run
+        to.
+
+Return Value:
+
+    0 on success.
+
+    Non-zero on failure.
+
+--*/
+
+{
+
+    UINTN LineIndex;
+    PSORT_INPUT Run;
+    INT Status;
+
+    Run = malloc(sizeof(SORT_INPUT));
+    if (Run == NULL) {
+        Status = ENOMEM;
+        goto SpillRunEnd;
+    }
+
+    memset(Run, 0, sizeof(SORT_INPUT));
+    Run->File = tmpfile();
+    if (Run->File == NULL) {
+        Status = errno;
+        SwPrintError(Status, NULL, "Failed to create temporary file");
+        goto SpillRunEnd;
+    }
+
+    Status = SortWriteLines(Context, Lines, Run->File);
+    if (Status != 0) {
+        goto SpillRunEnd;
+    }
+
+    if ((fflush(Run->File) != 0) || (ferror(Run->File) != 0)) {
+        Status = errno;
+        if (Status == 0) {
+            Status = EIO;
+        }
+
+        SwPrintError(Status, NULL, "Failed to write temporary file");
+        goto SpillRunEnd;
+    }
+
+    rewind(Run->File);
+    Status = SortArrayAddElement(Runs, Run);
+    if (Status != 0) {
+        goto SpillRunEnd;
+    }
+
+    Run = NULL;
+
+    //
+    // Free the lines, but keep the array around for the next run.
+    //
+
+    for (LineIndex = 0; LineIndex < Lines->Size; LineIndex += 1) {
+        SortDestroyString(Lines->Data[LineIndex]);
+    }
+
+    Lines->Size = 0;
+
+SpillRunEnd:
+    if (Run != NULL) {
+        SortDestroyInput(Run);
+    }
+
+    return Status;
+}
+
+INT
+SortMergeRuns (
+    PSORT_CONTEXT Context,
+    PSORT_ARRAY Runs,
+    FILE *Output
+    )
+
+/*++
+
+Routine Description:
+
+    This routine merges the sorted runs spilled to temporary files into the
+    output. If there are too many runs to merge at once, groups of runs are
+    first merged into larger runs.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Runs - Supplies a pointer to the array of run inputs.
+
+    Output - Supplies a pointer to the output file to write to.
+
+Return Value:
+
+    0 on success.
+
+    Non-zero on failure.
+
+--*/
+
+{
+
+    INT Status;
+
+    while (Runs->Size > SORT_MAX_MERGE_INPUTS) {
+        Status = SortCombineRuns(Context, Runs);
+        if (Status != 0) {
+            return Status;
+        }
+    }
+
+    Status = SortMergeSortedFiles(Context, Runs, Output);
+    return Status;
+}
+
+INT
+SortCombineRuns (
+    PSORT_CONTEXT Context,
+    PSORT_ARRAY Runs
+    )
+
+/*++
+
+Routine Description:
+
+    This routine merges the oldest group of runs into a single new run, which
+    takes their place at the beginning of the run array. Runs stay in input
+    order so that merges, which break ties in favor of the earlier run, keep
+    the first of a group of equal lines.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Runs - Supplies a pointer to the array of run inputs, which must have
+        more than the maximum number of merge inputs. The merged runs are
+        destroyed and removed from the array.
+
+Return Value:
+
+    0 on success.
+
+    Non-zero on failure.
+
+--*/
+
+{
+
+    SORT_ARRAY Group;
+    UINTN RunIndex;
+    PSORT_INPUT Run;
+    INT Status;
+
+    assert(Runs->Size > SORT_MAX_MERGE_INPUTS);
+
+    Run = malloc(sizeof(SORT_INPUT));
+    if (Run == NULL) {
+        Status = ENOMEM;
+        goto CombineRunsEnd;
+    }
+
+    memset(Run, 0, sizeof(SORT_INPUT));
+    Run->File = tmpfile();
+    if (Run->File == NULL) {
+        Status = errno;
+        SwPrintError(Status, NULL, "Failed to create temporary file");
+        goto CombineRunsEnd;
+    }
+
+    Group.Data = Runs->Data;
+    Group.Size = SORT_MAX_MERGE_INPUTS;
+    Group.Capacity = SORT_MAX_MERGE_INPUTS;
+    Status = SortMergeSortedFiles(Context, &Group, Run->File);
+    if (Status != 0) {
+        goto CombineRunsEnd;
+    }
+
+    if ((fflush(Run->File) != 0) || (ferror(Run->File) != 0)) {
+        Status = errno;
+        if (Status == 0) {
+            Status = EIO;
+        }
+
+        SwPrintError(Status, NULL, "Failed to write temporary file");
+        goto CombineRunsEnd;
+    }
+
+    rewind(Run->File);
+
+    //
+    // Destroy the merged runs, put the new larger run in the first slot, and
+    // slide the rest down behind it.
+    //
+
+    for (RunIndex = 0; RunIndex < SORT_MAX_MERGE_INPUTS; RunIndex += 1) {
+        SortDestroyInput(Runs->Data[RunIndex]);
+    }
+
+    Runs->Size -= SORT_MAX_MERGE_INPUTS;
+    memmove(Runs->Data + 1,
+            Runs->Data + SORT_MAX_MERGE_INPUTS,
+            Runs->Size * sizeof(PVOID));
+
+    Runs->Data[0] = Run;
+    Runs->Size += 1;
+    Run = NULL;
+    Status = 0;
+
+CombineRunsEnd:
+    if (Run != NULL) {
+        SortDestroyInput(Run);
+    }
+
+    return Status;
+}
+
+INT
+SortWriteLines (
+    PSORT_CONTEXT Context,
+    PSORT_ARRAY Lines,
+    FILE *Output
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sorts an array of lines and writes them out. The C library's
+    parallel sort is used if available. Otherwise the array is split into
+    chunks that are sorted in parallel, and the sorted chunks are merged as
+    they're written.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Lines - Supplies a pointer to the array of lines to sort.
+
+    Output - Supplies a pointer to the output file to write to.
+
+Return Value:
+
+    0 on success.
+
+    Non-zero on failure.
+
+--*/
+
+{
+
+    PSORT_CHUNK Chunk;
+    UINTN ChunkCount;
+    UINTN ChunkIndex;
+    PSORT_CHUNK Chunks;
+    UINTN ChunkSize;
+    PSORT_STRING Line;
+    SORT_MERGE Merge;
+    PSORT_STRING PreviousLine;
+    BOOL Sorted;
+    INT Status;
+
+    Chunks = NULL;
+    memset(&Merge, 0, sizeof(SORT_MERGE));
+    if (Lines->Size == 0) {
+        return 0;
+    }
+
+    ChunkCount = Lines->Size / SORT_MINIMUM_CHUNK_LINES;
+    if (ChunkCount > Context->ThreadCount) {
+        ChunkCount = Context->ThreadCount;
+    }
+
+    if (ChunkCount == 0) {
+        ChunkCount = 1;
+    }
+
+    //
+    // Let the C library sort the whole array across threads if it knows how,
+    // leaving one already sorted chunk to write out.
+    //
+
+    Sorted = FALSE;
+    if (ChunkCount > 1) {
+        Status = SwSortParallel(Lines->Data,
+                                Lines->Size,
+                                sizeof(PVOID),
+                                SortCompareLines,
+                                Context->ThreadCount);
+
+        if (Status == 0) {
+            ChunkCount = 1;
+            Sorted = TRUE;
+        }
+    }
+
+    Chunks = malloc(ChunkCount * sizeof(SORT_CHUNK));
+    if (Chunks == NULL) {
+        Status = ENOMEM;
+        goto WriteLinesEnd;
+    }
+
+    Status = SortInitializeMerge(&Merge, ChunkCount);
+    if (Status != 0) {
+        goto WriteLinesEnd;
+    }
+
+    //
+    // Carve up the lines and kick off a thread for every chunk but the first,
+    // which this thread sorts. If a thread can't be created, this thread
+    // sorts that chunk too.
+    //
+
+    ChunkSize = Lines->Size / ChunkCount;
+    for (ChunkIndex = 0; ChunkIndex < ChunkCount; ChunkIndex += 1) {
+        Chunk = &(Chunks[ChunkIndex]);
+        Chunk->Lines = Lines->Data + (ChunkIndex * ChunkSize);
+        Chunk->Count = ChunkSize;
+        if (ChunkIndex == ChunkCount - 1) {
+            Chunk->Count = Lines->Size - (ChunkIndex * ChunkSize);
+        }
+
+        Chunk->Next = 0;
+        Chunk->ThreadCreated = FALSE;
+        if (ChunkIndex != 0) {
+            Status = pthread_create(&(Chunk->Thread),
+                                    NULL,
+                                    SortChunkThread,
+                                    Chunk);
+
+            if (Status == 0) {
+                Chunk->ThreadCreated = TRUE;
+            }
+        }
+    }
+
+    for (ChunkIndex = 0; ChunkIndex < ChunkCount; ChunkIndex += 1) {
+        Chunk = &(Chunks[ChunkIndex]);
+        if ((Chunk->ThreadCreated == FALSE) && (Sorted == FALSE)) {
+            SortChunkThread(Chunk);
+        }
+    }
+
+    for (ChunkIndex = 0; ChunkIndex < ChunkCount; ChunkIndex += 1) {
+        Chunk = &(Chunks[ChunkIndex]);
+        if (Chunk->ThreadCreated != FALSE) {
+            pthread_join(Chunk->Thread, NULL);
+        }
+
+        Merge.Lines[ChunkIndex] = Chunk->Lines[0];
+        Chunk->Next = 1;
+    }
+
+    //
+    // Merge the sorted chunks into the output.
+    //
+
+    SortBuildMergeHeap(&Merge, ChunkCount);
+    PreviousLine = NULL;
+    while (Merge.Count != 0) {
+        Chunk = &(Chunks[Merge.Heap[0]]);
+        Line = Merge.Lines[Merge.Heap[0]];
+
+        //
+        // If the unique flag is off, this is the first line, or the lines
+        // aren't equal then print the line.
+        //
+
+        if (((Context->Options & SORT_OPTION_UNIQUE) == 0) ||
+            (PreviousLine == NULL) ||
+            (SortCompareKeys(&PreviousLine, &Line) != 0)) {
+
+            fputs(Line->Data, Output);
+            fputc('\n', Output);
+        }
+
+        PreviousLine = Line;
+        Line = NULL;
+        if (Chunk->Next < Chunk->Count) {
+            Line = Chunk->Lines[Chunk->Next];
+            Chunk->Next += 1;
+        }
+
+        Merge.Lines[Merge.Heap[0]] = Line;
+        SortUpdateMergeHeap(&Merge);
+    }
+
+    Status = 0;
+
+WriteLinesEnd:
+    SortDestroyMerge(&Merge);
+    if (Chunks != NULL) {
+        free(Chunks);
+    }
+
+    return Status;
+}
+
+PVOID
+SortChunkThread (
+    PVOID Parameter
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sorts a single chunk of lines. It is the entry point for
+    the sort worker threads. The C library sort isn't stable, but the
+    comparison routine only reports lines as equal if they're identical, or
+    if their keys match when unique lines are output. In that case ties go
+    by input order, so the order of the result is fully determined.
+
+Arguments:
+
+    Parameter - Supplies a pointer to the chunk to sort.
+
+Return Value:
+
+    NULL always.
+
+--*/
+
+{
+
+    PSORT_CHUNK Chunk;
+
+    Chunk = Parameter;
+    qsort(Chunk->Lines, Chunk->Count, sizeof(PVOID), SortCompareLines);
+    return NULL;
+}
+
+INT
+SortInitializeMerge (
+    PSORT_MERGE Merge,
+    ULONG SourceCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine allocates the state for a k-way merge.
+
+Arguments:
+
+    Merge - Supplies a pointer to the merge state to initialize.
+
+    SourceCount - Supplies the number of sources being merged.
+
+Return Value:
+
+    0 on success.
+
+    ENOMEM on allocation failure.
+
+--*/
+
+{
+
+    memset(Merge, 0, sizeof(SORT_MERGE));
+    if (SourceCount == 0) {
+        return 0;
+    }
+
+    Merge->Lines = malloc(SourceCount * sizeof(PSORT_STRING));
+    Merge->Heap = malloc(SourceCount * sizeof(ULONG));
+    if ((Merge->Lines == NULL) || (Merge->Heap == NULL)) {
+        SortDestroyMerge(Merge);
+        return ENOMEM;
+    }
+
+    memset(Merge->Lines, 0, SourceCount * sizeof(PSORT_STRING));
+    return 0;
+}
+
+VOID
+SortBuildMergeHeap (
+    PSORT_MERGE Merge,
+    ULONG SourceCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine builds the merge heap out of every source that has a line.
+
+Arguments:
+
+    Merge - Supplies a pointer to the merge state, whose current lines have
+        been filled in.
+
+    SourceCount - Supplies the number of sources being merged.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Index;
+    ULONG Source;
+
+    Merge->Count = 0;
+    for (Source = 0; Source < SourceCount; Source += 1) {
+        if (Merge->Lines[Source] != NULL) {
+            Merge->Heap[Merge->Count] = Source;
+            Merge->Count += 1;
+        }
+    }
+
+    Index = Merge->Count / 2;
+    while (Index != 0) {
+        Index -= 1;
+        SortSiftMergeHeap(Merge, Index);
+    }
+
+    return;
+}
+
+VOID
+SortUpdateMergeHeap (
+    PSORT_MERGE Merge
+    )
+
+/*++
+
+Routine Description:
+
+    This routine restores the merge heap after the current line of the
+    winning source has changed. If the source is drained, it is removed from
+    the heap.
+
+Arguments:
+
+    Merge - Supplies a pointer to the merge state.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    assert(Merge->Count != 0);
+
+    if (Merge->Lines[Merge->Heap[0]] == NULL) {
+        Merge->Count -= 1;
+        Merge->Heap[0] = Merge->Heap[Merge->Count];
+    }
+
+    SortSiftMergeHeap(Merge, 0);
+    return;
+}
+
+VOID
+SortSiftMergeHeap (
+    PSORT_MERGE Merge,
+    ULONG Index
+    )
+
+/*++
+
+Routine Description:
+
+    This routine moves a merge heap entry down until it's no greater than its
+    children.
+
+Arguments:
+
+    Merge - Supplies a pointer to the merge state.
+
+    Index - Supplies the heap index of the entry to move down.
 
-        if (((Context.Options & SORT_OPTION_UNIQUE) == 0) ||
-            (PreviousLine == NULL) ||
-            (SortCompareLines(&PreviousLine, &InputLine) != 0)) {
+Return Value:
 
-            fprintf(Output, "%s\n", InputLine->Data);
-        }
+    None.
 
-        PreviousLine = InputLine;
-    }
+--*/
 
-    Status = 0;
+{
 
-MainEnd:
-    SortContext = NULL;
-    if ((Output != NULL) && (Output != stdout)) {
-        fclose(Output);
+    ULONG Child;
+    ULONG Source;
+
+    if (Index >= Merge->Count) {
+        return;
     }
 
-    SortDestroyArray(&(Context.Input),
-                     (PSORT_DESTROY_ARRAY_ELEMENT_ROUTINE)SortDestroyInput);
+    Source = Merge->Heap[Index];
+    while (TRUE) {
+        Child = (Index * 2) + 1;
+        if (Child >= Merge->Count) {
+            break;
+        }
 
-    SortDestroyArray(&(Context.Key), free);
-    if (InputString.Data != NULL) {
-        free(InputString.Data);
-    }
+        if ((Child + 1 < Merge->Count) &&
+            (SortIsMergeSourceLess(Merge,
+                                   Merge->Heap[Child + 1],
+                                   Merge->Heap[Child]) != FALSE)) {
 
-    SortDestroyArray(&InputLines,
-                     (PSORT_DESTROY_ARRAY_ELEMENT_ROUTINE)SortDestroyString);
+            Child += 1;
+        }
 
-    if ((Status != 0) && (Status != 1)) {
-        SwPrintError(Status, NULL, "Sort exiting abnormally");
+        if (SortIsMergeSourceLess(Merge, Merge->Heap[Child], Source) == FALSE) {
+            break;
+        }
+
+        Merge->Heap[Index] = Merge->Heap[Child];
+        Index = Child;
     }
 
-    return Status;
+    Merge->Heap[Index] = Source;
+    return;
 }
 
-//
-// --------------------------------------------------------- Internal Functions
-//
-
-INT
-SortCheckFile (
-    PSORT_CONTEXT Context,
-    PSORT_INPUT Input
+BOOL
+SortIsMergeSourceLess (
+    PSORT_MERGE Merge,
+    ULONG Left,
+    ULONG Right
     )
 
 /*++
 
 Routine Description:
 
-    This routine checks a file to see if it is sorted (and optionally unique).
+    This routine determines whether one merge source's current line sorts
+    before another's. Ties go to the lower numbered source, so that the
+    merge keeps the order of the inputs for equal lines.
 
 Arguments:
 
-    Context - Supplies a pointer to the application context.
+    Merge - Supplies a pointer to the merge state.
 
-    Input - Supplies a pointer to the input to check.
+    Left - Supplies the index of the left source.
 
-Return Value:
+    Right - Supplies the index of the right source.
 
-    0 if the file is sorted.
+Return Value:
 
-    1 if the file is not sorted.
+    TRUE if the left source wins.
 
-    >1 error number if an error occurred.
+    FALSE if the right source wins.
 
 --*/
 
 {
 
     INT Comparison;
-    PSORT_STRING Line;
-    PSORT_STRING PreviousLine;
-    INT Status;
-    SORT_STRING WorkingBuffer;
 
-    memset(&WorkingBuffer, 0, sizeof(SORT_STRING));
-    Line = NULL;
-    PreviousLine = NULL;
-    while (TRUE) {
-        Status = SortReadLine(Context,
-                              Input,
-                              &WorkingBuffer,
-                              &Line);
+    Comparison = SortCompareLines(&(Merge->Lines[Left]),
+                                  &(Merge->Lines[Right]));
 
-        if (Status != 0) {
-            SwPrintError(Status, NULL, "Failed to read file");
-            goto CheckFileEnd;
-        }
+    if (Comparison < 0) {
+        return TRUE;
 
-        if (Line == NULL) {
-            break;
-        }
+    } else if (Comparison > 0) {
+        return FALSE;
+    }
 
-        if (PreviousLine != NULL) {
-            Comparison = SortCompareLines(&PreviousLine, &Line);
-            if (Comparison > 1) {
-                Status = 1;
-                goto CheckFileEnd;
-            }
+    if (Left < Right) {
+        return TRUE;
+    }
 
-            if (((Context->Options & SORT_OPTION_UNIQUE) != 0) &&
-                (Comparison == 0)) {
+    return FALSE;
+}
 
-                Status = 1;
-                goto CheckFileEnd;
-            }
+VOID
+SortDestroyMerge (
+    PSORT_MERGE Merge
+    )
 
-            SortDestroyString(PreviousLine);
-        }
+/*++
 
-        PreviousLine = Line;
-        Line = NULL;
-    }
+Routine Description:
 
-    Status = 0;
+    This routine frees the state for a k-way merge. The lines themselves are
+    not freed.
 
-CheckFileEnd:
-    if (WorkingBuffer.Data != NULL) {
-        free(WorkingBuffer.Data);
-    }
+Arguments:
 
-    if (Line != NULL) {
-        SortDestroyString(Line);
+    Merge - Supplies a pointer to the merge state.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    if (Merge->Lines != NULL) {
+        free(Merge->Lines);
+        Merge->Lines = NULL;
     }
 
-    if (PreviousLine != NULL) {
-        SortDestroyString(PreviousLine);
+    if (Merge->Heap != NULL) {
+        free(Merge->Heap);
+        Merge->Heap = NULL;
     }
 
-    return Status;
+    Merge->Count = 0;
+    return;
 }
 
 INT
-SortMergeSortedFiles (
-    PSORT_CONTEXT Context,
-    FILE *Output
+SortParseSize (
+    PSTR Argument,
+    PUINTN Size
     )
 
 /*++
 
 Routine Description:
 
-    This routine merges several files that are already in order.
+    This routine parses a buffer size argument.
 
 Arguments:
 
-    Context - Supplies a pointer to the application context.
+    Argument - Supplies a pointer to the argument string. This is a number
+        optionally followed by a suffix: b for bytes, or K, M, or G for
+        kilobytes, megabytes, or gigabytes. With no suffix, the number is in
+        kilobytes.
 
-    Output - Supplies a pointer to the output file to write to.
+    Size - Supplies a pointer where the size in bytes is returned on
+        success.
 
 Return Value:
 
     0 on success.
 
-    Non-zero on failure.
+    EINVAL if the argument is not valid.
 
 --*/
 
 {
 
-    INT Comparison;
-    PSORT_INPUT Input;
-    UINTN InputIndex;
-    PSORT_STRING PreviousWinner;
-    INT Status;
-    PSORT_INPUT Winner;
-    SORT_STRING WorkingBuffer;
+    PSTR AfterScan;
+    ULONGLONG Multiplier;
+    ULONGLONG Value;
 
-    PreviousWinner = NULL;
-    memset(&WorkingBuffer, 0, sizeof(SORT_STRING));
+    Value = strtoull(Argument, &AfterScan, 10);
+    if ((AfterScan == Argument) || (!isdigit(*Argument))) {
+        return EINVAL;
+    }
+
+    switch (*AfterScan) {
+    case 'b':
+        Multiplier = 1;
+        break;
+
+    case '\0':
+    case 'k':
+    case 'K':
+        Multiplier = 1024ULL;
+        break;
+
+    case 'm':
+    case 'M':
+        Multiplier = 1024ULL * 1024ULL;
+        break;
+
+    case 'g':
+    case 'G':
+        Multiplier = 1024ULL * 1024ULL * 1024ULL;
+        break;
+
+    default:
+        return EINVAL;
+    }
+
+    if ((*AfterScan != '\0') && (*(AfterScan + 1) != '\0')) {
+        return EINVAL;
+    }
 
     //
-    // Prime all the inputs by reading their first lines.
+    // Clip the size to what can be addressed.
     //
 
-    for (InputIndex = 0; InputIndex < Context->Input.Size; InputIndex += 1) {
-        Input = Context->Input.Data[InputIndex];
-        Status = SortReadLine(Context,
-                              Input,
-                              &WorkingBuffer,
-                              &(Input->Line));
+    if (Value > (MAX_UINTN / Multiplier)) {
+        Value = MAX_UINTN;
 
-        if (Status != 0) {
-            SwPrintError(Status, NULL, "Failed to read file");
-            goto MergeSortedFilesEnd;
-        }
+    } else {
+        Value *= Multiplier;
     }
 
-    //
-    // Loop getting the winning line until all files are drained.
-    //
+    *Size = (UINTN)Value;
+    return 0;
+}
 
-    while (TRUE) {
-        Winner = NULL;
-        for (InputIndex = 0;
-             InputIndex < Context->Input.Size;
-             InputIndex += 1) {
-
-            Input = Context->Input.Data[InputIndex];
-            if (Input->Line == NULL) {
-                continue;
-            }
+INT
+SortCompareLines (
+    const VOID *LeftPointer,
+    const VOID *RightPointer
+    )
 
-            if (Winner == NULL) {
-                Winner = Input;
+/*++
 
-            } else {
+Routine Description:
 
-                //
-                // If this input's line is less than the current winner, set it
-                // to the new winner.
-                //
+    This routine compares two sort string elements for ordering. Lines whose
+    keys compare equal are ordered by the bytes of the whole line, the POSIX
+    last-resort comparison. This makes the order a total one, so the output
+    doesn't depend on how the input was split into runs and chunks, which
+    varies with the buffer size and thread count. Uniqueness is decided by
+    the keys alone, and the first line of each group of equal keys is the
+    one kept, so with the unique option, ties are instead broken by input
+    order.
 
-                Comparison = SortCompareLines(&(Input->Line), &(Winner->Line));
-                if (Comparison < 0) {
-                    Winner = Input;
-                }
-            }
-        }
+Arguments:
 
-        //
-        // If there is no winner, then all files must be drained. Stop.
-        //
+    LeftPointer - Supplies a pointer containing a pointer to the left string
+        of the comparison.
 
-        if (Winner == NULL) {
-            break;
-        }
+    RightPointer - Supplies a pointer containing a pointer to the right string
+        of the comparison.
 
-        //
-        // Print the line.
-        //
+Return Value:
 
-        if (((Context->Options & SORT_OPTION_UNIQUE) == 0) ||
-            (PreviousWinner == NULL) ||
-            (SortCompareLines(&(Winner->Line), &PreviousWinner) != 0)) {
+    1 if Left > Right.
 
-            fprintf(Output, "%s\n", Winner->Line->Data);
-        }
+    0 if Left == Right.
 
-        //
-        // Set the new previous winner, and read a new line from that winning
-        // file.
-        //
+    -1 if Left < Right.
 
-        if (PreviousWinner != NULL) {
-            SortDestroyString(PreviousWinner);
+--*/
+
+{
+
+    UINTN Index;
+    PSORT_STRING Left;
+    UCHAR LeftCharacter;
+    INT Result;
+    PSORT_STRING Right;
+    UCHAR RightCharacter;
+    UINTN Size;
+
+    Result = SortCompareKeys(LeftPointer, RightPointer);
+    if (Result != 0) {
+        return Result;
+    }
+
+    Left = *(PSORT_STRING *)LeftPointer;
+    Right = *(PSORT_STRING *)RightPointer;
+    if ((SortContext->Options & SORT_OPTION_UNIQUE) != 0) {
+        if (Left->Sequence < Right->Sequence) {
+            return -1;
+
+        } else if (Left->Sequence > Right->Sequence) {
+            return 1;
         }
 
-        PreviousWinner = Winner->Line;
-        if (Winner->Line != NULL) {
-            Status = SortReadLine(Context,
-                                  Winner,
-                                  &WorkingBuffer,
-                                  &(Winner->Line));
+        return 0;
+    }
+    Size = Left->Size;
+    if (Size > Right->Size) {
+        Size = Right->Size;
+    }
 
-            if (Status != 0) {
-                SwPrintError(Status, NULL, "Failed to read file");
-                goto MergeSortedFilesEnd;
+    for (Index = 0; Index < Size; Index += 1) {
+        LeftCharacter = Left->Data[Index];
+        RightCharacter = Right->Data[Index];
+        if (LeftCharacter != RightCharacter) {
+            Result = -1;
+            if (LeftCharacter > RightCharacter) {
+                Result = 1;
             }
+
+            break;
         }
     }
 
-    Status = 0;
+    if (Result == 0) {
+        if (Left->Size < Right->Size) {
+            Result = -1;
 
-MergeSortedFilesEnd:
-    if (PreviousWinner != NULL) {
-        SortDestroyString(PreviousWinner);
+        } else if (Left->Size > Right->Size) {
+            Result = 1;
+        }
     }
 
-    if (WorkingBuffer.Data != NULL) {
-        free(WorkingBuffer.Data);
+    if ((SortContext->Options & SORT_OPTION_REVERSE) != 0) {
+        Result = -Result;
     }
 
-    return Status;
+    return Result;
 }
 
 INT
-SortCompareLines (
+SortCompareKeys (
     const VOID *LeftPointer,
     const VOID *RightPointer
     )
@@ -1075,7 +2291,7 @@ SortCompareLines (
 
 Routine Description:
 
-    This routine compares two sort string elements.
+    This routine compares the keys of two sort string elements.
 
 Arguments:
 
@@ -1174,7 +2390,7 @@ Return Value:
                     Result = -Result;
                 }
 
-                goto CompareLinesEnd;
+                goto CompareKeysEnd;
 
             } else if (LeftValue > RightValue) {
                 Result = 1;
@@ -1182,7 +2398,7 @@ Return Value:
                     Result = -Result;
                 }
 
-                goto CompareLinesEnd;
+                goto CompareKeysEnd;
             }
 
         //
@@ -1256,7 +2472,7 @@ Return Value:
                         Result = -Result;
                     }
 
-                    goto CompareLinesEnd;
+                    goto CompareKeysEnd;
 
                 } else if (LeftCharacter > RightCharacter) {
                     Result = 1;
@@ -1264,7 +2480,7 @@ Return Value:
                         Result = -Result;
                     }
 
-                    goto CompareLinesEnd;
+                    goto CompareKeysEnd;
                 }
 
                 LeftStartIndex += 1;
@@ -1279,7 +2495,7 @@ Return Value:
 
     Result = 0;
 
-CompareLinesEnd:
+CompareKeysEnd:
     return Result;
 }
 
@@ -1316,68 +2532,123 @@ Return Value:
 
 {
 
-    INT Character;
+    UINTN Available;
+    BOOL Found;
+    UINTN Length;
+    PSTR Line;
+    PSTR NewLine;
     PSORT_STRING NewString;
     INT Result;
 
     Holding->Size = 0;
+    Found = FALSE;
+    Line = NULL;
     NewString = NULL;
-    Character = fgetc(Input->File);
-    if (Character == EOF) {
-        Result = 0;
-        goto ReadLineEnd;
+    if (Input->Buffer == NULL) {
+        Input->Buffer = malloc(SORT_READ_BUFFER_SIZE);
+        if (Input->Buffer == NULL) {
+            Result = ENOMEM;
+            goto ReadLineEnd;
+        }
     }
 
     //
-    // Loop reading characters and shoving them into the holding buffer.
+    // Loop finding the end of the line in the buffer, refilling it a block
+    // at a time as needed. Lines that span blocks are put together in the
+    // holding buffer.
     //
 
     while (TRUE) {
-        if (Character == EOF) {
-            break;
+        if (Input->Offset == Input->Length) {
+            Input->Offset = 0;
+            Input->Length = fread(Input->Buffer,
+                                  1,
+                                  SORT_READ_BUFFER_SIZE,
+                                  Input->File);
+
+            if (Input->Length == 0) {
+                if (ferror(Input->File) != 0) {
+                    Result = errno;
+                    if (Result == 0) {
+                        Result = EIO;
+                    }
 
-        } else if (Character == '\n') {
+                    goto ReadLineEnd;
+                }
 
-            //
-            // Peel off a carriage return too if it's there.
-            //
+                //
+                // At the end of the file, return nothing if there's no
+                // partial line.
+                //
 
-            if ((Holding->Size != 0) &&
-                (Holding->Data[Holding->Size - 1] == '\r')) {
+                if (Found == FALSE) {
+                    Result = 0;
+                    goto ReadLineEnd;
+                }
 
-                Holding->Size -= 1;
+                Line = Holding->Data;
+                Length = Holding->Size;
+                break;
             }
+        }
+
+        Found = TRUE;
+        Line = Input->Buffer + Input->Offset;
+        Available = Input->Length - Input->Offset;
+        NewLine = memchr(Line, '\n', Available);
+        if (NewLine != NULL) {
+            Length = NewLine - Line;
+            Input->Offset += Length + 1;
+
+        } else {
+            Length = Available;
+            Input->Offset += Length;
+        }
 
+        //
+        // If the whole line was in the buffer, create the string directly
+        // from there.
+        //
+
+        if ((NewLine != NULL) && (Holding->Size == 0)) {
             break;
         }
 
-        Result = SortStringAddCharacter(Holding, (CHAR)Character);
+        Result = SortStringAddCharacters(Holding, Line, Length);
         if (Result != 0) {
             goto ReadLineEnd;
         }
 
-        Character = fgetc(Input->File);
+        if (NewLine != NULL) {
+            Line = Holding->Data;
+            Length = Holding->Size;
+            break;
+        }
     }
 
     //
-    // Terminate the string.
+    // Peel off a carriage return too if it's there.
     //
 
-    Result = SortStringAddCharacter(Holding, '\0');
-    if (Result != 0) {
-        goto ReadLineEnd;
+    if ((Length != 0) && (Line[Length - 1] == '\r')) {
+        Length -= 1;
     }
 
     //
-    // Create a new string that's well sized.
+    // Create a new string that's well sized, and terminate it.
     //
 
-    NewString = SortCreateString(Holding->Data, Holding->Size);
+    NewString = SortCreateString(NULL, Length + 1);
     if (NewString == NULL) {
         Result = ENOMEM;
         goto ReadLineEnd;
     }
 
+    if (Length != 0) {
+        memcpy(NewString->Data, Line, Length);
+    }
+
+    NewString->Data[Length] = '\0';
     Result = 0;
 
 ReadLineEnd:
@@ -1714,22 +2985,25 @@ Return Value:
 }
 
 INT
-SortStringAddCharacter (
+SortStringAddCharacters (
     PSORT_STRING String,
-    CHAR Character
+    PSTR Characters,
+    UINTN Count
     )
 
 /*++
 
 Routine Description:
 
-    This routine adds a character to the given string.
+    This routine adds several characters to the given string.
 
 Arguments:
 
-    String - Supplies a pointer to the string to add a character to.
+    String - Supplies a pointer to the string to add the characters to.
+
+    Characters - Supplies a pointer to the characters to add.
 
-    Character - Supplies the character to add.
+    Count - Supplies the number of characters to add.
 
 Return Value:
 
@@ -1744,15 +3018,17 @@ Return Value:
     PVOID NewBuffer;
     UINTN NewCapacity;
 
-    if (String->Size == String->Capacity) {
-        if (String->Capacity == 0) {
+    if (String->Size + Count > String->Capacity) {
+        NewCapacity = String->Capacity;
+        if (NewCapacity == 0) {
             NewCapacity = SORT_INITIAL_STRING_SIZE;
+        }
 
-        } else {
-            NewCapacity = String->Capacity * 2;
+        while (NewCapacity < String->Size + Count) {
+            NewCapacity *= 2;
         }
 
-        NewBuffer = realloc(String->Data, NewCapacity * sizeof(PVOID));
+        NewBuffer = realloc(String->Data, NewCapacity);
         if (NewBuffer == NULL) {
             return ENOMEM;
         }
@@ -1761,8 +3037,11 @@ Return Value:
         String->Capacity = NewCapacity;
     }
 
-    String->Data[String->Size] = Character;
-    String->Size += 1;
+    if (Count != 0) {
+        memcpy(String->Data + String->Size, Characters, Count);
+    }
+
+    String->Size += Count;
     return 0;
 }
 
@@ -1946,6 +3225,10 @@ Return Value:
         SortDestroyString(Input->Line);
     }
 
+    if (Input->Buffer != NULL) {
+        free(Input->Buffer);
+    }
+
     free(Input);
     return;
 }
@@ -3482,6 +3482,49 @@ Return Value:
     return;
 }
 
+int
+SwSortParallel (
+    void *ArrayBase,
+    size_t ElementCount,
+    size_t ElementSize,
+    int (*CompareFunction)(const void *, const void *),
+    unsigned int ThreadCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sorts an array in place using multiple threads, if the
+    operating system's C library supports it.
+
+Arguments:
+
+    ArrayBase - Supplies a pointer to the array to sort.
+
+    ElementCount - Supplies the number of elements in the array.
+
+    ElementSize - Supplies the size of each element in bytes.
+
+    CompareFunction - Supplies a pointer to the qsort style compare function.
+        This may be called from several threads at once.
+
+    ThreadCount - Supplies the maximum number of threads to use.
+
+Return Value:
+
+    0 if the array was sorted.
+
+    ENOSYS if parallel sorting is not supported, in which case the array is
+    untouched.
+
+--*/
+
+{
+
+    return ENOSYS;
+}
+
 int
 SwResetSystem (
     SWISS_REBOOT_TYPE RebootType
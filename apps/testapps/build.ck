@@ -43,6 +43,8 @@ function build() {
         "perftest",
         "sigtest",
         "socktest",
+        "sorttest",
+        "thrdtest",
         "utmrtest"
     ];
 
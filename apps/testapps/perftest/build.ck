@@ -38,6 +38,7 @@ function build() {
     sources = [
         "copy.c",
         "create.c",
+        "datagram.c",
         "dlopen.c",
         "dup.c",
         "getppid.c",
@@ -51,10 +52,15 @@ function build() {
         "perftest.c",
         "pipeio.c",
         "pthread.c",
+        "random.c",
         "read.c",
+        "regex.c",
         "rename.c",
         "signal.c",
+        "spawn.c",
         "stat.c",
+        "string.c",
+        "unixsock.c",
         "write.c"
     ];
 
@@ -0,0 +1,333 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    datagram.c
+
+Abstract:
+
+    This module implements the datagram rate performance benchmark tests,
+    comparing one datagram per system call against the batched sendmmsg() and
+    recvmmsg() calls.
+
+Author:
+
+    agent 18-Oct-2026
+
+Environment:
+
+    User
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "perftest.h"
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// Define the size of each datagram sent by the test.
+//
+
+#define PT_DATAGRAM_SIZE 64
+
+//
+// Define the number of datagrams handed to each sendmmsg and recvmmsg call.
+//
+
+#define PT_DATAGRAM_BATCH_SIZE 32
+
+//
+// Define how long a receive waits before assuming the datagrams it expected
+// were dropped, in seconds.
+//
+
+#define PT_DATAGRAM_RECEIVE_TIMEOUT 1
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+int
+DatagramCreateSockets (
+    int *Sender,
+    int *Receiver
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+void
+DatagramMain (
+    PPT_TEST_INFORMATION Test,
+    PPT_TEST_RESULT Result
+    )
+
+/*++
+
+Routine Description:
+
+    This routine performs the datagram rate performance benchmark tests.
+
+Arguments:
+
+    Test - Supplies a pointer to the performance test being executed.
+
+    Result - Supplies a pointer to a performance test result structure that
+        receives the tests results.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    int Batch;
+    char Buffers[PT_DATAGRAM_BATCH_SIZE][PT_DATAGRAM_SIZE];
+    ssize_t BytesCompleted;
+    int Count;
+    int Index;
+    unsigned long long Iterations;
+    struct mmsghdr Messages[PT_DATAGRAM_BATCH_SIZE];
+    int Receiver;
+    int Sender;
+    int Status;
+    struct iovec Vectors[PT_DATAGRAM_BATCH_SIZE];
+
+    Iterations = 0;
+    Receiver = -1;
+    Sender = -1;
+    Result->Type = PtResultIterations;
+    Result->Status = 0;
+    switch (Test->TestType) {
+    case PtTestDatagram:
+        Batch = 0;
+        break;
+
+    case PtTestDatagramBatch:
+        Batch = 1;
+        break;
+
+    default:
+        fprintf(stderr, "Unknown datagram test type %d\n", Test->TestType);
+        Result->Status = EINVAL;
+        goto MainEnd;
+    }
+
+    Status = DatagramCreateSockets(&Sender, &Receiver);
+    if (Status != 0) {
+        Result->Status = Status;
+        goto MainEnd;
+    }
+
+    memset(Buffers, 0, sizeof(Buffers));
+    memset(Messages, 0, sizeof(Messages));
+    for (Index = 0; Index < PT_DATAGRAM_BATCH_SIZE; Index += 1) {
+        Vectors[Index].iov_base = Buffers[Index];
+        Vectors[Index].iov_len = PT_DATAGRAM_SIZE;
+        Messages[Index].msg_hdr.msg_iov = &(Vectors[Index]);
+        Messages[Index].msg_hdr.msg_iovlen = 1;
+    }
+
+    //
+    // Start the test. This snaps resource usage and starts the clock ticking.
+    //
+
+    Status = PtStartTimedTest(Test->Duration);
+    if (Status != 0) {
+        Result->Status = errno;
+        goto MainEnd;
+    }
+
+    //
+    // Measure the datagram rate over the loopback interface by sending a
+    // batch of datagrams and then receiving them. Datagrams can legitimately
+    // be dropped, so a receive timeout just moves on to the next batch.
+    //
+
+    while (PtIsTimedTestRunning() != 0) {
+        if (Batch != 0) {
+            Count = sendmmsg(Sender, Messages, PT_DATAGRAM_BATCH_SIZE, 0);
+
+        } else {
+            BytesCompleted = send(Sender, Buffers[0], PT_DATAGRAM_SIZE, 0);
+            Count = 1;
+            if (BytesCompleted < 0) {
+                Count = -1;
+            }
+        }
+
+        if (Count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            Result->Status = errno;
+            break;
+        }
+
+        if (Batch != 0) {
+            Count = recvmmsg(Receiver,
+                             Messages,
+                             Count,
+                             MSG_WAITFORONE,
+                             NULL);
+
+        } else {
+            BytesCompleted = recv(Receiver, Buffers[0], PT_DATAGRAM_SIZE, 0);
+            Count = 1;
+            if (BytesCompleted < 0) {
+                Count = -1;
+            }
+        }
+
+        if (Count < 0) {
+            if ((errno == EINTR) || (errno == EAGAIN) ||
+                (errno == EWOULDBLOCK)) {
+
+                continue;
+            }
+
+            Result->Status = errno;
+            break;
+        }
+
+        Iterations += Count;
+    }
+
+    Status = PtFinishTimedTest(Result);
+    if ((Status != 0) && (Result->Status == 0)) {
+        Result->Status = errno;
+    }
+
+MainEnd:
+    if (Sender >= 0) {
+        close(Sender);
+    }
+
+    if (Receiver >= 0) {
+        close(Receiver);
+    }
+
+    Result->Data.Iterations = Iterations;
+    return;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+int
+DatagramCreateSockets (
+    int *Sender,
+    int *Receiver
+    )
+
+/*++
+
+Routine Description:
+
+    This routine creates a pair of UDP sockets on the loopback interface, with
+    the sender connected to the receiver.
+
+Arguments:
+
+    Sender - Supplies a pointer where the sending socket will be returned.
+
+    Receiver - Supplies a pointer where the receiving socket will be returned.
+
+Return Value:
+
+    0 on success.
+
+    Returns an error number on failure.
+
+--*/
+
+{
+
+    struct sockaddr_in Address;
+    socklen_t AddressLength;
+    int Status;
+    struct timeval Timeout;
+
+    *Receiver = socket(AF_INET, SOCK_DGRAM, 0);
+    if (*Receiver < 0) {
+        return errno;
+    }
+
+    *Sender = socket(AF_INET, SOCK_DGRAM, 0);
+    if (*Sender < 0) {
+        return errno;
+    }
+
+    memset(&Address, 0, sizeof(Address));
+    Address.sin_family = AF_INET;
+    Address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    Address.sin_port = 0;
+    Status = bind(*Receiver, (struct sockaddr *)&Address, sizeof(Address));
+    if (Status != 0) {
+        return errno;
+    }
+
+    AddressLength = sizeof(Address);
+    Status = getsockname(*Receiver,
+                         (struct sockaddr *)&Address,
+                         &AddressLength);
+
+    if (Status != 0) {
+        return errno;
+    }
+
+    Status = connect(*Sender, (struct sockaddr *)&Address, sizeof(Address));
+    if (Status != 0) {
+        return errno;
+    }
+
+    Timeout.tv_sec = PT_DATAGRAM_RECEIVE_TIMEOUT;
+    Timeout.tv_usec = 0;
+    Status = setsockopt(*Receiver,
+                        SOL_SOCKET,
+                        SO_RCVTIMEO,
+                        &Timeout,
+                        sizeof(Timeout));
+
+    if (Status != 0) {
+        return errno;
+    }
+
+    return 0;
+}
+
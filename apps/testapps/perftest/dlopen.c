@@ -13,8 +13,8 @@ Module Name:
 
 Abstract:
 
-    This module implements the performance benchmark tests for the dlopen() and
-    dlclose() C library calls.
+    This module implements the performance benchmark tests for the dlopen(),
+    dlsym(), and dlclose() C library calls.
 
 Author:
 
@@ -101,6 +101,21 @@ Return Value:
 // -------------------------------------------------------------------- Globals
 //
 
+//
+// Store the symbols looked up by the dlsym test. These are a mix of symbols
+// from the stub library, symbols from the C library, and a symbol that
+// doesn't exist anywhere and so gets checked against every image.
+//
+
+char *DlsymTestSymbols[] = {
+    "PtLibraryInitialize",
+    "malloc",
+    "PtIsLibraryInitialized",
+    "strlen",
+    "pthread_mutex_lock",
+    "PtMissingSymbol"
+};
+
 //
 // ------------------------------------------------------------------ Functions
 //
@@ -132,6 +147,7 @@ Return Value:
 
 {
 
+    void *GlobalHandle;
     void *Handle;
     int Initialized;
     unsigned long long Iterations;
@@ -141,7 +157,10 @@ Return Value:
     PPT_IS_LIBRARY_INITIALIZED_ROUTINE PtIsLibraryInitialized;
     PPT_LIBRARY_INITIALIZE_ROUTINE PtLibraryInitialize;
     int Status;
+    size_t SymbolCount;
 
+    GlobalHandle = NULL;
+    Handle = NULL;
     Iterations = 0;
     Result->Type = PtResultIterations;
     Result->Status = 0;
@@ -176,6 +195,25 @@ Return Value:
                 LibraryNameLength - (LastSlash - LibraryName));
     }
 
+    //
+    // The symbol lookup test keeps the stub library loaded in the global
+    // scope and looks up symbols through the whole program.
+    //
+
+    if (Test->TestType == PtTestDlsym) {
+        Handle = dlopen(LibraryName, RTLD_NOW | RTLD_GLOBAL);
+        GlobalHandle = dlopen(NULL, RTLD_NOW);
+        if ((Handle == NULL) || (GlobalHandle == NULL)) {
+            fprintf(stderr,
+                    "Failed to open %s: %s\n",
+                    LibraryName,
+                    dlerror());
+
+            Result->Status = ENOENT;
+            goto MainEnd;
+        }
+    }
+
     //
     // Start the test. This snaps resource usage and starts the clock ticking.
     //
@@ -186,6 +224,21 @@ Return Value:
         goto MainEnd;
     }
 
+    //
+    // Measure the cost of symbol lookup by counting the number of symbols
+    // that can be resolved. Missing symbols are expected to come back NULL.
+    //
+
+    if (Test->TestType == PtTestDlsym) {
+        SymbolCount = sizeof(DlsymTestSymbols) / sizeof(DlsymTestSymbols[0]);
+        while (PtIsTimedTestRunning() != 0) {
+            dlsym(GlobalHandle, DlsymTestSymbols[Iterations % SymbolCount]);
+            Iterations += 1;
+        }
+
+        goto TimedTestEnd;
+    }
+
     //
     // Measure the performance of the dlopen(), dlsym(), and dlclose() C
     // library routines by counting the number of times a library can be opened,
@@ -235,12 +288,23 @@ Return Value:
         Iterations += 1;
     }
 
+TimedTestEnd:
     Status = PtFinishTimedTest(Result);
     if ((Status != 0) && (Result->Status == 0)) {
         Result->Status = errno;
     }
 
 MainEnd:
+    if (Test->TestType == PtTestDlsym) {
+        if (GlobalHandle != NULL) {
+            dlclose(GlobalHandle);
+        }
+
+        if (Handle != NULL) {
+            dlclose(Handle);
+        }
+    }
+
     if (LibraryName != NULL) {
         free(LibraryName);
     }
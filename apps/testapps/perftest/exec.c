@@ -31,10 +31,12 @@ Module Name:
 //
 
 #include <assert.h>
+#include <dirent.h>
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <sys/wait.h>
 #include <time.h>
 #include <unistd.h>
@@ -66,10 +68,24 @@ Module Name:
 #define EXEC_MAX_DURATION_STRING_LENGTH 32
 #define EXEC_MAX_ITERATIONS_STRING_LENGTH 32
 
+//
+// Define the environment variable that enables the dynamic loader's
+// relocation cache, and the format of the cache directory the test uses.
+//
+
+#define EXEC_RELOCATION_CACHE_VARIABLE "LD_RELOCATION_CACHE"
+#define EXEC_RELOCATION_CACHE_FORMAT "perftest_relcache_%d"
+#define EXEC_MAX_PATH_LENGTH 256
+
 //
 // ----------------------------------------------- Internal Function Prototypes
 //
 
+void
+ExecRemoveCacheDirectory (
+    char *Path
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -107,6 +123,8 @@ Return Value:
 
     char *Arguments[EXEC_LOOP_ARGUMENT_COUNT + 1];
     ssize_t BytesRead;
+    char CacheDirectory[EXEC_MAX_PATH_LENGTH];
+    int CacheDirectoryCreated;
     pid_t Child;
     int CollectionActive;
     char DurationString[EXEC_MAX_DURATION_STRING_LENGTH];
@@ -116,8 +134,31 @@ Return Value:
     int Status;
     pid_t WaitedChild;
 
+    CacheDirectoryCreated = 0;
     CollectionActive = 0;
 
+    //
+    // The relocation cache variant points the dynamic loader at a private
+    // cache directory. The first exec fills the cache, and every exec after
+    // that replays it, so the iteration rate reflects exec-to-main latency
+    // with cached relocations.
+    //
+
+    if (Test->TestType == PtTestExecRelocationCache) {
+        snprintf(CacheDirectory,
+                 sizeof(CacheDirectory),
+                 EXEC_RELOCATION_CACHE_FORMAT,
+                 getpid());
+
+        Status = mkdir(CacheDirectory, S_IRWXU);
+        if (Status != 0) {
+            Result->Status = errno;
+            goto MainEnd;
+        }
+
+        CacheDirectoryCreated = 1;
+    }
+
     //
     // Create a communication pipe for the child to write its results into.
     //
@@ -164,6 +205,12 @@ Return Value:
 
         close(PipeDescriptors[0]);
         close(PipeDescriptors[1]);
+        if (CacheDirectoryCreated != 0) {
+            Status = setenv(EXEC_RELOCATION_CACHE_VARIABLE, CacheDirectory, 1);
+            if (Status != 0) {
+                exit(errno);
+            }
+        }
 
         //
         // Build the arguments to re-execute this application.
@@ -258,6 +305,10 @@ Return Value:
         }
     }
 
+    if (CacheDirectoryCreated != 0) {
+        ExecRemoveCacheDirectory(CacheDirectory);
+    }
+
     return;
 }
 
@@ -397,3 +448,56 @@ Return Value:
 // --------------------------------------------------------- Internal Functions
 //
 
+void
+ExecRemoveCacheDirectory (
+    char *Path
+    )
+
+/*++
+
+Routine Description:
+
+    This routine removes the relocation cache directory created for the test,
+    along with any cache files the dynamic loader left in it.
+
+Arguments:
+
+    Path - Supplies a pointer to the path of the cache directory.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    DIR *Directory;
+    struct dirent *Entry;
+    char FilePath[EXEC_MAX_PATH_LENGTH];
+
+    Directory = opendir(Path);
+    if (Directory != NULL) {
+        while (1) {
+            Entry = readdir(Directory);
+            if (Entry == NULL) {
+                break;
+            }
+
+            if ((strcmp(Entry->d_name, ".") == 0) ||
+                (strcmp(Entry->d_name, "..") == 0)) {
+
+                continue;
+            }
+
+            snprintf(FilePath, sizeof(FilePath), "%s/%s", Path, Entry->d_name);
+            unlink(FilePath);
+        }
+
+        closedir(Directory);
+    }
+
+    rmdir(Path);
+    return;
+}
+
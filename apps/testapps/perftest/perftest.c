@@ -211,6 +211,20 @@ PT_TEST_INFORMATION PerformanceTests[PtTestTypeCount] = {
      PtResultIterations,
      EXEC_TEST_DEFAULT_DURATION},
 
+    {EXEC_RELOCATION_CACHE_TEST_NAME,
+     EXEC_RELOCATION_CACHE_TEST_DESCRIPTION,
+     ExecMain,
+     PtTestExecRelocationCache,
+     PtResultIterations,
+     EXEC_RELOCATION_CACHE_TEST_DEFAULT_DURATION},
+
+    {SPAWN_TEST_NAME,
+     SPAWN_TEST_DESCRIPTION,
+     SpawnMain,
+     PtTestSpawn,
+     PtResultIterations,
+     SPAWN_TEST_DEFAULT_DURATION},
+
     {OPEN_TEST_NAME,
      OPEN_TEST_DESCRIPTION,
      OpenMain,
@@ -281,6 +295,13 @@ PT_TEST_INFORMATION PerformanceTests[PtTestTypeCount] = {
      PtResultIterations,
      DLOPEN_TEST_DEFAULT_DURATION},
 
+    {DLSYM_TEST_NAME,
+     DLSYM_TEST_DESCRIPTION,
+     DlopenMain,
+     PtTestDlsym,
+     PtResultIterations,
+     DLSYM_TEST_DEFAULT_DURATION},
+
     {MMAP_PRIVATE_TEST_NAME,
      MMAP_PRIVATE_TEST_DESCRIPTION,
      MmapMain,
@@ -413,6 +434,146 @@ PT_TEST_INFORMATION PerformanceTests[PtTestTypeCount] = {
      PtTestSignalRestart,
      PtResultIterations,
      SIGNAL_RESTART_DEFAULT_DURATION},
+
+    {REGEX_TEST_NAME,
+     REGEX_TEST_DESCRIPTION,
+     RegexMain,
+     PtTestRegex,
+     PtResultBytes,
+     REGEX_TEST_DEFAULT_DURATION},
+
+    {REGEX_BACKTRACK_TEST_NAME,
+     REGEX_BACKTRACK_TEST_DESCRIPTION,
+     RegexMain,
+     PtTestRegexBacktrack,
+     PtResultBytes,
+     REGEX_BACKTRACK_TEST_DEFAULT_DURATION},
+
+    {DATAGRAM_TEST_NAME,
+     DATAGRAM_TEST_DESCRIPTION,
+     DatagramMain,
+     PtTestDatagram,
+     PtResultIterations,
+     DATAGRAM_TEST_DEFAULT_DURATION},
+
+    {DATAGRAM_BATCH_TEST_NAME,
+     DATAGRAM_BATCH_TEST_DESCRIPTION,
+     DatagramMain,
+     PtTestDatagramBatch,
+     PtResultIterations,
+     DATAGRAM_BATCH_TEST_DEFAULT_DURATION},
+
+    {PIPE_STREAM_SMALL_TEST_NAME,
+     PIPE_STREAM_SMALL_TEST_DESCRIPTION,
+     PipeIoMain,
+     PtTestPipeStreamSmall,
+     PtResultBytes,
+     PIPE_STREAM_SMALL_TEST_DEFAULT_DURATION},
+
+    {PIPE_STREAM_TEST_NAME,
+     PIPE_STREAM_TEST_DESCRIPTION,
+     PipeIoMain,
+     PtTestPipeStream,
+     PtResultBytes,
+     PIPE_STREAM_TEST_DEFAULT_DURATION},
+
+    {PIPE_STREAM_LARGE_TEST_NAME,
+     PIPE_STREAM_LARGE_TEST_DESCRIPTION,
+     PipeIoMain,
+     PtTestPipeStreamLarge,
+     PtResultBytes,
+     PIPE_STREAM_LARGE_TEST_DEFAULT_DURATION},
+
+    {UNIX_STREAM_TEST_NAME,
+     UNIX_STREAM_TEST_DESCRIPTION,
+     UnixSocketMain,
+     PtTestUnixStream,
+     PtResultIterations,
+     UNIX_STREAM_TEST_DEFAULT_DURATION},
+
+    {UNIX_DATAGRAM_TEST_NAME,
+     UNIX_DATAGRAM_TEST_DESCRIPTION,
+     UnixSocketMain,
+     PtTestUnixDatagram,
+     PtResultIterations,
+     UNIX_DATAGRAM_TEST_DEFAULT_DURATION},
+
+    {UNIX_LATENCY_TEST_NAME,
+     UNIX_LATENCY_TEST_DESCRIPTION,
+     UnixSocketMain,
+     PtTestUnixLatency,
+     PtResultIterations,
+     UNIX_LATENCY_TEST_DEFAULT_DURATION},
+
+    {GETRANDOM_TEST_NAME,
+     GETRANDOM_TEST_DESCRIPTION,
+     RandomMain,
+     PtTestGetRandom,
+     PtResultBytes,
+     GETRANDOM_TEST_DEFAULT_DURATION},
+
+    {GETRANDOM_SMALL_TEST_NAME,
+     GETRANDOM_SMALL_TEST_DESCRIPTION,
+     RandomMain,
+     PtTestGetRandomSmall,
+     PtResultIterations,
+     GETRANDOM_SMALL_TEST_DEFAULT_DURATION},
+
+    {GETRANDOM_CONTENDED_TEST_NAME,
+     GETRANDOM_CONTENDED_TEST_DESCRIPTION,
+     RandomMain,
+     PtTestGetRandomContended,
+     PtResultIterations,
+     GETRANDOM_CONTENDED_TEST_DEFAULT_DURATION},
+
+    {RANDOM_DEVICE_TEST_NAME,
+     RANDOM_DEVICE_TEST_DESCRIPTION,
+     RandomMain,
+     PtTestRandomDevice,
+     PtResultBytes,
+     RANDOM_DEVICE_TEST_DEFAULT_DURATION},
+
+    {MEMCPY_TEST_NAME,
+     MEMCPY_TEST_DESCRIPTION,
+     StringMain,
+     PtTestMemcpy,
+     PtResultBytes,
+     MEMCPY_TEST_DEFAULT_DURATION},
+
+    {MEMSET_TEST_NAME,
+     MEMSET_TEST_DESCRIPTION,
+     StringMain,
+     PtTestMemset,
+     PtResultBytes,
+     MEMSET_TEST_DEFAULT_DURATION},
+
+    {MEMCMP_TEST_NAME,
+     MEMCMP_TEST_DESCRIPTION,
+     StringMain,
+     PtTestMemcmp,
+     PtResultBytes,
+     MEMCMP_TEST_DEFAULT_DURATION},
+
+    {MEMCHR_TEST_NAME,
+     MEMCHR_TEST_DESCRIPTION,
+     StringMain,
+     PtTestMemchr,
+     PtResultBytes,
+     MEMCHR_TEST_DEFAULT_DURATION},
+
+    {STRLEN_TEST_NAME,
+     STRLEN_TEST_DESCRIPTION,
+     StringMain,
+     PtTestStrlen,
+     PtResultBytes,
+     STRLEN_TEST_DEFAULT_DURATION},
+
+    {STRCMP_TEST_NAME,
+     STRCMP_TEST_DESCRIPTION,
+     StringMain,
+     PtTestStrcmp,
+     PtResultBytes,
+     STRCMP_TEST_DEFAULT_DURATION},
 };
 
 //
@@ -498,6 +659,16 @@ Return Value:
         return ExecLoop(ArgumentCount, Arguments);
     }
 
+    //
+    // Children of the spawn test exit immediately.
+    //
+
+    if ((ArgumentCount == SPAWN_CHILD_ARGUMENT_COUNT) &&
+        (strcasecmp(Arguments[1], SPAWN_TEST_NAME) == 0)) {
+
+        return 0;
+    }
+
     Duration = 0;
     Failures = 0;
     ProcessCount = PT_DEFAULT_PROCESS_COUNT;
@@ -41,6 +41,14 @@ Module Name:
 #define FORK_TEST_DESCRIPTION "Benchmarks the fork() C library routine."
 #define EXEC_TEST_NAME "exec"
 #define EXEC_TEST_DESCRIPTION "Benchmarks the exec() C library routine."
+#define EXEC_RELOCATION_CACHE_TEST_NAME "exec_relcache"
+#define EXEC_RELOCATION_CACHE_TEST_DESCRIPTION \
+    "Benchmarks exec() with the dynamic loader's relocation cache enabled."
+
+#define SPAWN_TEST_NAME "spawn"
+#define SPAWN_TEST_DESCRIPTION \
+    "Benchmarks process creation with the posix_spawn() C library routine."
+
 #define OPEN_TEST_NAME "open"
 #define OPEN_TEST_DESCRIPTION \
     "Benchmarks the open() and close() C library routines."
@@ -69,6 +77,10 @@ Module Name:
 #define DLOPEN_TEST_DESCRIPTION \
     "Benchmarks the dlopen() and dlclose() C library routines."
 
+#define DLSYM_TEST_NAME "dlsym"
+#define DLSYM_TEST_DESCRIPTION \
+    "Benchmarks symbol lookup through the global scope with dlsym()."
+
 #define MMAP_PRIVATE_TEST_NAME "mmap_private"
 #define MMAP_PRIVATE_TEST_DESCRIPTION \
     "Benchmarks the mmap() and munmap() C library routines with MAP_PRIVATE."
@@ -145,12 +157,94 @@ Module Name:
 #define SIGNAL_RESTART_DESCRIPTION \
     "Benchmarks how many system call restarts can be made."
 
+#define REGEX_TEST_NAME "regex"
+#define REGEX_TEST_DESCRIPTION \
+    "Benchmarks regexec() throughput on expressions without back references."
+
+#define REGEX_BACKTRACK_TEST_NAME "regex_backtrack"
+#define REGEX_BACKTRACK_TEST_DESCRIPTION \
+    "Benchmarks regexec() throughput on expressions with back references."
+
+#define DATAGRAM_TEST_NAME "udp"
+#define DATAGRAM_TEST_DESCRIPTION \
+    "Benchmarks loopback UDP datagrams with one send() and recv() each."
+
+#define DATAGRAM_BATCH_TEST_NAME "udp_batch"
+#define DATAGRAM_BATCH_TEST_DESCRIPTION \
+    "Benchmarks loopback UDP datagrams batched with sendmmsg() and recvmmsg()."
+
+#define PIPE_STREAM_SMALL_TEST_NAME "pipe_stream_4k"
+#define PIPE_STREAM_SMALL_TEST_DESCRIPTION \
+    "Benchmarks streaming between processes through a 4KB pipe buffer."
+
+#define PIPE_STREAM_TEST_NAME "pipe_stream"
+#define PIPE_STREAM_TEST_DESCRIPTION \
+    "Benchmarks streaming between processes through the default pipe buffer."
+
+#define PIPE_STREAM_LARGE_TEST_NAME "pipe_stream_1m"
+#define PIPE_STREAM_LARGE_TEST_DESCRIPTION \
+    "Benchmarks streaming between processes through a 1MB pipe buffer."
+
+#define UNIX_STREAM_TEST_NAME "unix_stream"
+#define UNIX_STREAM_TEST_DESCRIPTION \
+    "Benchmarks small message rate over a Unix domain stream socket."
+
+#define UNIX_DATAGRAM_TEST_NAME "unix_dgram"
+#define UNIX_DATAGRAM_TEST_DESCRIPTION \
+    "Benchmarks small message rate over a Unix domain datagram socket."
+
+#define UNIX_LATENCY_TEST_NAME "unix_latency"
+#define UNIX_LATENCY_TEST_DESCRIPTION \
+    "Benchmarks round trips between processes over a Unix domain socket."
+
+#define GETRANDOM_TEST_NAME "getrandom"
+#define GETRANDOM_TEST_DESCRIPTION \
+    "Benchmarks bulk random data throughput from the getrandom() call."
+
+#define GETRANDOM_SMALL_TEST_NAME "getrandom_small"
+#define GETRANDOM_SMALL_TEST_DESCRIPTION \
+    "Benchmarks the rate of small getrandom() requests."
+
+#define GETRANDOM_CONTENDED_TEST_NAME "getrandom_contended"
+#define GETRANDOM_CONTENDED_TEST_DESCRIPTION \
+    "Benchmarks small getrandom() requests while other threads also request."
+
+#define RANDOM_DEVICE_TEST_NAME "urandom"
+#define RANDOM_DEVICE_TEST_DESCRIPTION \
+    "Benchmarks bulk random data throughput from reading /dev/urandom."
+
+#define MEMCPY_TEST_NAME "memcpy"
+#define MEMCPY_TEST_DESCRIPTION \
+    "Benchmarks memcpy() throughput across sizes and alignments."
+
+#define MEMSET_TEST_NAME "memset"
+#define MEMSET_TEST_DESCRIPTION \
+    "Benchmarks memset() throughput across sizes and alignments."
+
+#define MEMCMP_TEST_NAME "memcmp"
+#define MEMCMP_TEST_DESCRIPTION \
+    "Benchmarks memcmp() throughput across sizes and alignments."
+
+#define MEMCHR_TEST_NAME "memchr"
+#define MEMCHR_TEST_DESCRIPTION \
+    "Benchmarks memchr() throughput across sizes and alignments."
+
+#define STRLEN_TEST_NAME "strlen"
+#define STRLEN_TEST_DESCRIPTION \
+    "Benchmarks strlen() throughput across sizes and alignments."
+
+#define STRCMP_TEST_NAME "strcmp"
+#define STRCMP_TEST_DESCRIPTION \
+    "Benchmarks strcmp() throughput across sizes and alignments."
+
 //
 // Default test durations, in seconds.
 //
 
 #define FORK_TEST_DEFAULT_DURATION 60
 #define EXEC_TEST_DEFAULT_DURATION 60
+#define EXEC_RELOCATION_CACHE_TEST_DEFAULT_DURATION 60
+#define SPAWN_TEST_DEFAULT_DURATION 60
 #define OPEN_TEST_DEFAULT_DURATION 30
 #define CREATE_TEST_DEFAULT_DURATION 30
 #define DUP_TEST_DEFAULT_DURATION 30
@@ -161,6 +255,7 @@ Module Name:
 #define WRITE_TEST_DEFAULT_DURATION 60
 #define COPY_TEST_DEFAULT_DURATION 60
 #define DLOPEN_TEST_DEFAULT_DURATION 30
+#define DLSYM_TEST_DEFAULT_DURATION 30
 #define MMAP_PRIVATE_TEST_DEFAULT_DURATION 30
 #define MMAP_SHARED_TEST_DEFAULT_DURATION 30
 #define MMAP_ANON_TEST_DEFAULT_DURATION 30
@@ -180,6 +275,26 @@ Module Name:
 #define SIGNAL_IGNORED_DEFAULT_DURATION 30
 #define SIGNAL_HANDLED_DEFAULT_DURATION 30
 #define SIGNAL_RESTART_DEFAULT_DURATION 30
+#define REGEX_TEST_DEFAULT_DURATION 30
+#define REGEX_BACKTRACK_TEST_DEFAULT_DURATION 30
+#define DATAGRAM_TEST_DEFAULT_DURATION 30
+#define DATAGRAM_BATCH_TEST_DEFAULT_DURATION 30
+#define PIPE_STREAM_SMALL_TEST_DEFAULT_DURATION 30
+#define PIPE_STREAM_TEST_DEFAULT_DURATION 30
+#define PIPE_STREAM_LARGE_TEST_DEFAULT_DURATION 30
+#define UNIX_STREAM_TEST_DEFAULT_DURATION 30
+#define UNIX_DATAGRAM_TEST_DEFAULT_DURATION 30
+#define UNIX_LATENCY_TEST_DEFAULT_DURATION 30
+#define GETRANDOM_TEST_DEFAULT_DURATION 30
+#define GETRANDOM_SMALL_TEST_DEFAULT_DURATION 30
+#define GETRANDOM_CONTENDED_TEST_DEFAULT_DURATION 30
+#define RANDOM_DEVICE_TEST_DEFAULT_DURATION 30
+#define MEMCPY_TEST_DEFAULT_DURATION 30
+#define MEMSET_TEST_DEFAULT_DURATION 30
+#define MEMCMP_TEST_DEFAULT_DURATION 30
+#define MEMCHR_TEST_DEFAULT_DURATION 30
+#define STRLEN_TEST_DEFAULT_DURATION 30
+#define STRCMP_TEST_DEFAULT_DURATION 30
 
 //
 // Define the number of variables supplied to an iteration of the execute test
@@ -188,6 +303,12 @@ Module Name:
 
 #define EXEC_LOOP_ARGUMENT_COUNT 5
 
+//
+// Define the number of arguments supplied to a child of the spawn test.
+//
+
+#define SPAWN_CHILD_ARGUMENT_COUNT 2
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -196,6 +317,8 @@ typedef enum _PT_TEST_TYPE {
     PtTestAll,
     PtTestFork,
     PtTestExec,
+    PtTestExecRelocationCache,
+    PtTestSpawn,
     PtTestOpen,
     PtTestCreate,
     PtTestDup,
@@ -206,6 +329,7 @@ typedef enum _PT_TEST_TYPE {
     PtTestWrite,
     PtTestCopy,
     PtTestDlopen,
+    PtTestDlsym,
     PtTestMmapPrivate,
     PtTestMmapShared,
     PtTestMmapAnon,
@@ -225,6 +349,26 @@ typedef enum _PT_TEST_TYPE {
     PtTestSignalIgnored,
     PtTestSignalHandled,
     PtTestSignalRestart,
+    PtTestRegex,
+    PtTestRegexBacktrack,
+    PtTestDatagram,
+    PtTestDatagramBatch,
+    PtTestPipeStreamSmall,
+    PtTestPipeStream,
+    PtTestPipeStreamLarge,
+    PtTestUnixStream,
+    PtTestUnixDatagram,
+    PtTestUnixLatency,
+    PtTestGetRandom,
+    PtTestGetRandomSmall,
+    PtTestGetRandomContended,
+    PtTestRandomDevice,
+    PtTestMemcpy,
+    PtTestMemset,
+    PtTestMemcmp,
+    PtTestMemchr,
+    PtTestStrlen,
+    PtTestStrcmp,
     PtTestTypeCount
 } PT_TEST_TYPE, *PPT_TEST_TYPE;
 
@@ -596,6 +740,31 @@ Return Value:
 
 --*/
 
+void
+SpawnMain (
+    PPT_TEST_INFORMATION Test,
+    PPT_TEST_RESULT Result
+    );
+
+/*++
+
+Routine Description:
+
+    This routine performs the spawn performance benchmark test.
+
+Arguments:
+
+    Test - Supplies a pointer to the performance test being executed.
+
+    Result - Supplies a pointer to a performance test result structure that
+        receives the tests results.
+
+Return Value:
+
+    None.
+
+--*/
+
 void
 OpenMain (
     PPT_TEST_INFORMATION Test,
@@ -831,7 +1000,8 @@ DlopenMain (
 
 Routine Description:
 
-    This routine performs the dynamic library open performance benchmark test.
+    This routine performs the dynamic library open and symbol lookup
+    performance benchmark tests.
 
 Arguments:
 
@@ -1021,3 +1191,129 @@ Return Value:
 
 --*/
 
+void
+RegexMain (
+    PPT_TEST_INFORMATION Test,
+    PPT_TEST_RESULT Result
+    );
+
+/*++
+
+Routine Description:
+
+    This routine performs the regular expression performance benchmark tests.
+
+Arguments:
+
+    Test - Supplies a pointer to the performance test being executed.
+
+    Result - Supplies a pointer to a performance test result structure that
+        receives the tests results.
+
+Return Value:
+
+    None.
+
+--*/
+
+void
+DatagramMain (
+    PPT_TEST_INFORMATION Test,
+    PPT_TEST_RESULT Result
+    );
+
+/*++
+
+Routine Description:
+
+    This routine performs the datagram rate performance benchmark tests.
+
+Arguments:
+
+    Test - Supplies a pointer to the performance test being executed.
+
+    Result - Supplies a pointer to a performance test result structure that
+        receives the tests results.
+
+Return Value:
+
+    None.
+
+--*/
+
+void
+UnixSocketMain (
+    PPT_TEST_INFORMATION Test,
+    PPT_TEST_RESULT Result
+    );
+
+/*++
+
+Routine Description:
+
+    This routine performs the Unix domain socket performance benchmark tests.
+
+Arguments:
+
+    Test - Supplies a pointer to the performance test being executed.
+
+    Result - Supplies a pointer to a performance test result structure that
+        receives the tests results.
+
+Return Value:
+
+    None.
+
+--*/
+
+void
+RandomMain (
+    PPT_TEST_INFORMATION Test,
+    PPT_TEST_RESULT Result
+    );
+
+/*++
+
+Routine Description:
+
+    This routine performs the random data performance benchmark tests.
+
+Arguments:
+
+    Test - Supplies a pointer to the performance test being executed.
+
+    Result - Supplies a pointer to a performance test result structure that
+        receives the tests results.
+
+Return Value:
+
+    None.
+
+--*/
+
+void
+StringMain (
+    PPT_TEST_INFORMATION Test,
+    PPT_TEST_RESULT Result
+    );
+
+/*++
+
+Routine Description:
+
+    This routine performs the string and memory routine performance benchmark
+    tests.
+
+Arguments:
+
+    Test - Supplies a pointer to the performance test being executed.
+
+    Result - Supplies a pointer to a performance test result structure that
+        receives the tests results.
+
+Return Value:
+
+    None.
+
+--*/
+
@@ -31,7 +31,10 @@ Module Name:
 
 #include <stdlib.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <signal.h>
+#include <stdio.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 #include "perftest.h"
@@ -42,6 +45,20 @@ Module Name:
 
 #define PT_PIPE_IO_BUFFER_SIZE 4096
 
+//
+// Define the size of each read and write in the pipe streaming tests.
+//
+
+#define PT_PIPE_STREAM_CHUNK_SIZE (64 * 1024)
+
+//
+// Define the pipe buffer sizes swept by the pipe streaming tests. Zero leaves
+// the system default in place.
+//
+
+#define PT_PIPE_STREAM_SMALL_SIZE 4096
+#define PT_PIPE_STREAM_LARGE_SIZE (1024 * 1024)
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -50,6 +67,12 @@ Module Name:
 // ----------------------------------------------- Internal Function Prototypes
 //
 
+void
+PipeIoStream (
+    PPT_TEST_INFORMATION Test,
+    PPT_TEST_RESULT Result
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -92,6 +115,11 @@ Return Value:
     int PipeDescriptors[2];
     int Status;
 
+    if (Test->TestType != PtTestPipeIo) {
+        PipeIoStream(Test, Result);
+        return;
+    }
+
     Iterations = 0;
     PipeCreated = 0;
     Result->Type = PtResultIterations;
@@ -193,3 +221,172 @@ Return Value:
 // --------------------------------------------------------- Internal Functions
 //
 
+void
+PipeIoStream (
+    PPT_TEST_INFORMATION Test,
+    PPT_TEST_RESULT Result
+    )
+
+/*++
+
+Routine Description:
+
+    This routine performs the pipe streaming performance benchmark tests,
+    which measure how fast a child process can push data through a pipe to
+    its parent for a given pipe buffer size.
+
+Arguments:
+
+    Test - Supplies a pointer to the performance test being executed.
+
+    Result - Supplies a pointer to a performance test result structure that
+        receives the tests results.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    char *Buffer;
+    ssize_t BytesCompleted;
+    pid_t Child;
+    int PipeDescriptors[2];
+    int PipeSize;
+    int Status;
+    unsigned long long TotalBytes;
+
+    Buffer = NULL;
+    Child = -1;
+    PipeDescriptors[0] = -1;
+    PipeDescriptors[1] = -1;
+    TotalBytes = 0;
+    Result->Type = PtResultBytes;
+    Result->Status = 0;
+    switch (Test->TestType) {
+    case PtTestPipeStreamSmall:
+        PipeSize = PT_PIPE_STREAM_SMALL_SIZE;
+        break;
+
+    case PtTestPipeStream:
+        PipeSize = 0;
+        break;
+
+    case PtTestPipeStreamLarge:
+        PipeSize = PT_PIPE_STREAM_LARGE_SIZE;
+        break;
+
+    default:
+        fprintf(stderr, "Unknown pipe test type %d\n", Test->TestType);
+        Result->Status = EINVAL;
+        goto StreamEnd;
+    }
+
+    Buffer = malloc(PT_PIPE_STREAM_CHUNK_SIZE);
+    if (Buffer == NULL) {
+        Result->Status = ENOMEM;
+        goto StreamEnd;
+    }
+
+    Status = pipe(PipeDescriptors);
+    if (Status != 0) {
+        Result->Status = errno;
+        goto StreamEnd;
+    }
+
+    if (PipeSize != 0) {
+        Status = fcntl(PipeDescriptors[1], F_SETPIPE_SZ, PipeSize);
+        if (Status < 0) {
+            Result->Status = errno;
+            goto StreamEnd;
+        }
+    }
+
+    //
+    // The child writes as fast as it can until the parent closes the read
+    // end out from under it.
+    //
+
+    Child = fork();
+    if (Child < 0) {
+        Result->Status = errno;
+        goto StreamEnd;
+    }
+
+    if (Child == 0) {
+        close(PipeDescriptors[0]);
+        while (1) {
+            BytesCompleted = write(PipeDescriptors[1],
+                                   Buffer,
+                                   PT_PIPE_STREAM_CHUNK_SIZE);
+
+            if ((BytesCompleted < 0) && (errno != EINTR)) {
+                break;
+            }
+        }
+
+        exit(0);
+    }
+
+    close(PipeDescriptors[1]);
+    PipeDescriptors[1] = -1;
+
+    //
+    // Start the test. This snaps resource usage and starts the clock ticking.
+    //
+
+    Status = PtStartTimedTest(Test->Duration);
+    if (Status != 0) {
+        Result->Status = errno;
+        goto StreamEnd;
+    }
+
+    while (PtIsTimedTestRunning() != 0) {
+        BytesCompleted = read(PipeDescriptors[0],
+                              Buffer,
+                              PT_PIPE_STREAM_CHUNK_SIZE);
+
+        if (BytesCompleted <= 0) {
+            if ((BytesCompleted < 0) && (errno == EINTR)) {
+                continue;
+            }
+
+            Result->Status = EIO;
+            if (BytesCompleted < 0) {
+                Result->Status = errno;
+            }
+
+            break;
+        }
+
+        TotalBytes += BytesCompleted;
+    }
+
+    Status = PtFinishTimedTest(Result);
+    if ((Status != 0) && (Result->Status == 0)) {
+        Result->Status = errno;
+    }
+
+StreamEnd:
+    if (PipeDescriptors[0] >= 0) {
+        close(PipeDescriptors[0]);
+    }
+
+    if (PipeDescriptors[1] >= 0) {
+        close(PipeDescriptors[1]);
+    }
+
+    if (Child > 0) {
+        waitpid(Child, NULL, 0);
+    }
+
+    if (Buffer != NULL) {
+        free(Buffer);
+    }
+
+    Result->Data.Bytes = TotalBytes;
+    return;
+}
+
@@ -0,0 +1,291 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    random.c
+
+Abstract:
+
+    This module implements the random data performance benchmark tests, which
+    measure how quickly applications can get random bytes from the kernel.
+
+Author:
+
+    agent 18-Oct-2026
+
+Environment:
+
+    User
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/random.h>
+#include <unistd.h>
+
+#include "perftest.h"
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// Define the size of each request in the bulk tests, and in the small request
+// tests, which look like a nonce or key being pulled for a TLS handshake.
+//
+
+#define PT_RANDOM_LARGE_SIZE 4096
+#define PT_RANDOM_SMALL_SIZE 32
+
+//
+// Define the number of background threads pulling random data during the
+// contended test.
+//
+
+#define PT_RANDOM_THREAD_COUNT 4
+
+#define PT_RANDOM_DEVICE_PATH "/dev/urandom"
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+void *
+RandomStartRoutine (
+    void *Parameter
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+pthread_mutex_t RandomMutex = PTHREAD_MUTEX_INITIALIZER;
+volatile int RandomReadyThreadCount;
+volatile int RandomStopThreads;
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+void
+RandomMain (
+    PPT_TEST_INFORMATION Test,
+    PPT_TEST_RESULT Result
+    )
+
+/*++
+
+Routine Description:
+
+    This routine performs the random data performance benchmark tests.
+
+Arguments:
+
+    Test - Supplies a pointer to the performance test being executed.
+
+    Result - Supplies a pointer to a performance test result structure that
+        receives the tests results.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    char Buffer[PT_RANDOM_LARGE_SIZE];
+    ssize_t BytesCompleted;
+    int Descriptor;
+    unsigned long long Iterations;
+    size_t Size;
+    int Status;
+    int ThreadCount;
+    int ThreadIndex;
+    pthread_t Threads[PT_RANDOM_THREAD_COUNT];
+    unsigned long long TotalBytes;
+
+    Descriptor = -1;
+    Iterations = 0;
+    ThreadCount = 0;
+    TotalBytes = 0;
+    Result->Type = PtResultBytes;
+    Result->Status = 0;
+    RandomReadyThreadCount = 0;
+    RandomStopThreads = 0;
+    switch (Test->TestType) {
+    case PtTestGetRandom:
+        Size = PT_RANDOM_LARGE_SIZE;
+        break;
+
+    case PtTestGetRandomSmall:
+        Size = PT_RANDOM_SMALL_SIZE;
+        Result->Type = PtResultIterations;
+        break;
+
+    case PtTestGetRandomContended:
+        Size = PT_RANDOM_SMALL_SIZE;
+        Result->Type = PtResultIterations;
+        for (ThreadIndex = 0;
+             ThreadIndex < PT_RANDOM_THREAD_COUNT;
+             ThreadIndex += 1) {
+
+            Status = pthread_create(&(Threads[ThreadIndex]),
+                                    NULL,
+                                    RandomStartRoutine,
+                                    NULL);
+
+            if (Status != 0) {
+                Result->Status = Status;
+                goto MainEnd;
+            }
+
+            ThreadCount += 1;
+        }
+
+        //
+        // Wait until all threads are spun up.
+        //
+
+        while (RandomReadyThreadCount != PT_RANDOM_THREAD_COUNT) {
+            sleep(1);
+        }
+
+        break;
+
+    case PtTestRandomDevice:
+        Size = PT_RANDOM_LARGE_SIZE;
+        Descriptor = open(PT_RANDOM_DEVICE_PATH, O_RDONLY);
+        if (Descriptor < 0) {
+            Result->Status = errno;
+            goto MainEnd;
+        }
+
+        break;
+
+    default:
+        fprintf(stderr, "Unknown random test type %d\n", Test->TestType);
+        Result->Status = EINVAL;
+        goto MainEnd;
+    }
+
+    //
+    // Start the test. This snaps resource usage and starts the clock ticking.
+    //
+
+    Status = PtStartTimedTest(Test->Duration);
+    if (Status != 0) {
+        Result->Status = errno;
+        goto MainEnd;
+    }
+
+    while (PtIsTimedTestRunning() != 0) {
+        if (Descriptor >= 0) {
+            BytesCompleted = read(Descriptor, Buffer, Size);
+
+        } else {
+            BytesCompleted = getrandom(Buffer, Size, 0);
+        }
+
+        if (BytesCompleted <= 0) {
+            if ((BytesCompleted < 0) && (errno == EINTR)) {
+                continue;
+            }
+
+            Result->Status = EIO;
+            if (BytesCompleted < 0) {
+                Result->Status = errno;
+            }
+
+            break;
+        }
+
+        TotalBytes += BytesCompleted;
+        Iterations += 1;
+    }
+
+    Status = PtFinishTimedTest(Result);
+    if ((Status != 0) && (Result->Status == 0)) {
+        Result->Status = errno;
+    }
+
+MainEnd:
+    RandomStopThreads = 1;
+    for (ThreadIndex = 0; ThreadIndex < ThreadCount; ThreadIndex += 1) {
+        pthread_join(Threads[ThreadIndex], NULL);
+    }
+
+    if (Descriptor >= 0) {
+        close(Descriptor);
+    }
+
+    if (Result->Type == PtResultBytes) {
+        Result->Data.Bytes = TotalBytes;
+
+    } else {
+        Result->Data.Iterations = Iterations;
+    }
+
+    return;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+void *
+RandomStartRoutine (
+    void *Parameter
+    )
+
+/*++
+
+Routine Description:
+
+    This routine implements the start routine for a background thread in the
+    contended test. It pulls small amounts of random data in a loop until the
+    main thread tells it to stop.
+
+Arguments:
+
+    Parameter - Supplies an unused parameter.
+
+Return Value:
+
+    NULL always.
+
+--*/
+
+{
+
+    char Buffer[PT_RANDOM_SMALL_SIZE];
+
+    pthread_mutex_lock(&RandomMutex);
+    RandomReadyThreadCount += 1;
+    pthread_mutex_unlock(&RandomMutex);
+    while (RandomStopThreads == 0) {
+        getrandom(Buffer, sizeof(Buffer), 0);
+    }
+
+    return NULL;
+}
+
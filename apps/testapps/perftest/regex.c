@@ -0,0 +1,422 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    regex.c
+
+Abstract:
+
+    This module implements the performance benchmark tests for the regcomp()
+    and regexec() C library calls.
+
+Author:
+
+    agent 18-Oct-2026
+
+Environment:
+
+    User
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <errno.h>
+#include <regex.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "perftest.h"
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// Define the size of the synthetic text corpus searched by the test.
+//
+
+#define PT_REGEX_CORPUS_SIZE (4 * 1024 * 1024)
+
+//
+// Define the maximum length of a line in the corpus, including the null
+// terminator.
+//
+
+#define PT_REGEX_MAX_LINE 96
+
+//
+// Define the number of words in a corpus line, before the length cap.
+//
+
+#define PT_REGEX_LINE_WORDS 12
+
+//
+// Define the number of match slots requested from regexec.
+//
+
+#define PT_REGEX_MATCH_COUNT 4
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+/*++
+
+Structure Description:
+
+    This structure describes a pattern used in the regular expression test.
+
+Members:
+
+    Pattern - Stores the regular expression string.
+
+    Flags - Stores the regcomp flags to compile the pattern with.
+
+--*/
+
+typedef struct _PT_REGEX_PATTERN {
+    const char *Pattern;
+    int Flags;
+} PT_REGEX_PATTERN, *PPT_REGEX_PATTERN;
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+char *
+RegexCreateCorpus (
+    size_t *LineCount
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// Store the words used to build the synthetic corpus.
+//
+
+const char *RegexCorpusWords[] = {
+    "the",
+    "quick",
+    "brown",
+    "fox",
+    "jumps",
+    "over",
+    "lazy",
+    "dog",
+    "kernel",
+    "thread",
+    "process",
+    "memory",
+    "page",
+    "file",
+    "system",
+    "device",
+    "driver",
+    "interrupt",
+    "timer",
+    "socket",
+    "buffer",
+    "error",
+    "warning",
+    "status",
+    "Minoca",
+    "0x1F00",
+    "12345",
+    "foo_bar",
+    "a",
+    "an",
+    "of",
+    "to",
+};
+
+//
+// Store the patterns used by the automaton friendly test. None of these use
+// back-references.
+//
+
+PT_REGEX_PATTERN RegexPatterns[] = {
+    {"interrupt", REG_EXTENDED | REG_NOSUB},
+    {"(driver|socket|timer) (error|warning)", REG_EXTENDED},
+    {"^[a-z]+ [0-9]+", REG_EXTENDED},
+    {"minoca.*status", REG_EXTENDED | REG_ICASE},
+    {"\\<page\\> [a-z_]*\\>$", REG_EXTENDED},
+    {"(a|an|the) [a-z]* (fox|dog)", 0},
+    {"0x[0-9A-Fa-f]+ [^ ]+ [^ ]+", REG_EXTENDED},
+};
+
+//
+// Store the patterns used by the backtracking test. These all contain
+// back-references.
+//
+
+PT_REGEX_PATTERN RegexBacktrackPatterns[] = {
+    {"\\(..\\).*\\1", 0},
+    {"\\([a-z]*\\) \\1", 0},
+    {"\\(the\\|of\\) .* \\1 ", 0},
+};
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+void
+RegexMain (
+    PPT_TEST_INFORMATION Test,
+    PPT_TEST_RESULT Result
+    )
+
+/*++
+
+Routine Description:
+
+    This routine performs the regular expression performance benchmark tests.
+
+Arguments:
+
+    Test - Supplies a pointer to the performance test being executed.
+
+    Result - Supplies a pointer to a performance test result structure that
+        receives the tests results.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    char *Corpus;
+    size_t ExpressionCount;
+    regex_t *Expressions;
+    size_t Index;
+    char *Line;
+    size_t LineCount;
+    size_t LineIndex;
+    size_t LineLength;
+    regmatch_t Match[PT_REGEX_MATCH_COUNT];
+    PPT_REGEX_PATTERN Patterns;
+    size_t PatternCount;
+    int Status;
+    unsigned long long TotalBytes;
+
+    Corpus = NULL;
+    ExpressionCount = 0;
+    Expressions = NULL;
+    TotalBytes = 0;
+    Result->Type = PtResultBytes;
+    Result->Status = 0;
+    switch (Test->TestType) {
+    case PtTestRegex:
+        Patterns = RegexPatterns;
+        PatternCount = sizeof(RegexPatterns) / sizeof(RegexPatterns[0]);
+        break;
+
+    case PtTestRegexBacktrack:
+        Patterns = RegexBacktrackPatterns;
+        PatternCount = sizeof(RegexBacktrackPatterns) /
+                       sizeof(RegexBacktrackPatterns[0]);
+
+        break;
+
+    default:
+        fprintf(stderr, "Unknown regex test type %d\n", Test->TestType);
+        Result->Status = EINVAL;
+        goto MainEnd;
+    }
+
+    Corpus = RegexCreateCorpus(&LineCount);
+    if (Corpus == NULL) {
+        Result->Status = ENOMEM;
+        goto MainEnd;
+    }
+
+    Expressions = malloc(sizeof(regex_t) * PatternCount);
+    if (Expressions == NULL) {
+        Result->Status = ENOMEM;
+        goto MainEnd;
+    }
+
+    //
+    // Compile all the patterns up front. The test measures execution
+    // throughput, not compilation.
+    //
+
+    for (Index = 0; Index < PatternCount; Index += 1) {
+        Status = regcomp(&(Expressions[Index]),
+                         Patterns[Index].Pattern,
+                         Patterns[Index].Flags);
+
+        if (Status != 0) {
+            fprintf(stderr,
+                    "Failed to compile regex \"%s\": %d\n",
+                    Patterns[Index].Pattern,
+                    Status);
+
+            Result->Status = EINVAL;
+            goto MainEnd;
+        }
+
+        ExpressionCount += 1;
+    }
+
+    //
+    // Start the test. This snaps resource usage and starts the clock ticking.
+    //
+
+    Status = PtStartTimedTest(Test->Duration);
+    if (Status != 0) {
+        Result->Status = errno;
+        goto MainEnd;
+    }
+
+    //
+    // Measure the throughput of regexec by running every pattern over every
+    // line of the corpus, counting the bytes of text searched.
+    //
+
+    Line = Corpus;
+    LineIndex = 0;
+    while (PtIsTimedTestRunning() != 0) {
+        LineLength = strlen(Line);
+        for (Index = 0; Index < ExpressionCount; Index += 1) {
+            regexec(&(Expressions[Index]),
+                    Line,
+                    PT_REGEX_MATCH_COUNT,
+                    Match,
+                    0);
+
+            TotalBytes += LineLength;
+        }
+
+        LineIndex += 1;
+        if (LineIndex == LineCount) {
+            LineIndex = 0;
+            Line = Corpus;
+
+        } else {
+            Line += LineLength + 1;
+        }
+    }
+
+    Status = PtFinishTimedTest(Result);
+    if ((Status != 0) && (Result->Status == 0)) {
+        Result->Status = errno;
+    }
+
+MainEnd:
+    for (Index = 0; Index < ExpressionCount; Index += 1) {
+        regfree(&(Expressions[Index]));
+    }
+
+    if (Expressions != NULL) {
+        free(Expressions);
+    }
+
+    if (Corpus != NULL) {
+        free(Corpus);
+    }
+
+    Result->Data.Bytes = TotalBytes;
+    return;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+char *
+RegexCreateCorpus (
+    size_t *LineCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine creates a deterministic synthetic text corpus of null
+    terminated lines built from a fixed word list.
+
+Arguments:
+
+    LineCount - Supplies a pointer where the number of lines in the corpus is
+        returned.
+
+Return Value:
+
+    Returns a pointer to the corpus on success. The caller is responsible for
+    freeing this memory.
+
+    NULL on allocation failure.
+
+--*/
+
+{
+
+    char *Corpus;
+    char *Current;
+    char *End;
+    char *LineStart;
+    size_t Lines;
+    unsigned int Seed;
+    const char *Word;
+    size_t WordCount;
+    size_t WordIndex;
+    size_t WordLength;
+
+    Corpus = malloc(PT_REGEX_CORPUS_SIZE);
+    if (Corpus == NULL) {
+        return NULL;
+    }
+
+    //
+    // Use a simple linear congruential generator so that every run searches
+    // exactly the same text.
+    //
+
+    Seed = 0x12345678;
+    WordCount = sizeof(RegexCorpusWords) / sizeof(RegexCorpusWords[0]);
+    Current = Corpus;
+    End = Corpus + PT_REGEX_CORPUS_SIZE;
+    Lines = 0;
+    while ((End - Current) > PT_REGEX_MAX_LINE) {
+        LineStart = Current;
+        for (WordIndex = 0; WordIndex < PT_REGEX_LINE_WORDS; WordIndex += 1) {
+            Seed = (Seed * 1103515245) + 12345;
+            Word = RegexCorpusWords[(Seed >> 16) % WordCount];
+            WordLength = strlen(Word);
+            if ((Current - LineStart) + WordLength + 2 > PT_REGEX_MAX_LINE) {
+                break;
+            }
+
+            if (WordIndex != 0) {
+                *Current = ' ';
+                Current += 1;
+            }
+
+            memcpy(Current, Word, WordLength);
+            Current += WordLength;
+        }
+
+        *Current = '\0';
+        Current += 1;
+        Lines += 1;
+    }
+
+    *LineCount = Lines;
+    return Corpus;
+}
+
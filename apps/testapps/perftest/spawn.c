@@ -0,0 +1,167 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    spawn.c
+
+Abstract:
+
+    This module implements the performance benchmark test for the
+    posix_spawn() C library routine.
+
+Author:
+
+    agent 18-Oct-2026
+
+Environment:
+
+    User
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <errno.h>
+#include <spawn.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "perftest.h"
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+void
+SpawnMain (
+    PPT_TEST_INFORMATION Test,
+    PPT_TEST_RESULT Result
+    )
+
+/*++
+
+Routine Description:
+
+    This routine performs the spawn performance benchmark test.
+
+Arguments:
+
+    Test - Supplies a pointer to the performance test being executed.
+
+    Result - Supplies a pointer to a performance test result structure that
+        receives the tests results.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    char *Arguments[SPAWN_CHILD_ARGUMENT_COUNT + 1];
+    pid_t Child;
+    unsigned long long Iterations;
+    int Status;
+
+    Iterations = 0;
+    Result->Type = PtResultIterations;
+    Result->Status = 0;
+
+    //
+    // The child is this application, which exits as soon as it sees the
+    // spawn test name as its only argument.
+    //
+
+    Arguments[0] = PtProgramPath;
+    Arguments[1] = SPAWN_TEST_NAME;
+    Arguments[SPAWN_CHILD_ARGUMENT_COUNT] = NULL;
+
+    //
+    // Start the test. This snaps resource usage and starts the clock ticking.
+    //
+
+    Status = PtStartTimedTest(Test->Duration);
+    if (Status != 0) {
+        Result->Status = errno;
+        goto MainEnd;
+    }
+
+    //
+    // Measure the performance of the posix_spawn() C library routine by
+    // counting the number of times a spawned child can be waited on during the
+    // given duration. Unlike the fork test, this includes loading a new image,
+    // which is what shells and build tools pay for every command they run.
+    //
+
+    while (PtIsTimedTestRunning() != 0) {
+        Status = posix_spawn(&Child,
+                             PtProgramPath,
+                             NULL,
+                             NULL,
+                             Arguments,
+                             environ);
+
+        if (Status != 0) {
+            Result->Status = Status;
+            break;
+        }
+
+        Child = waitpid(Child, &Status, 0);
+        if (Child == -1) {
+            if (PtIsTimedTestRunning() == 0) {
+                break;
+            }
+
+            Result->Status = errno;
+            break;
+        }
+
+        if (Status != 0) {
+            Result->Status = WEXITSTATUS(Status);
+            break;
+        }
+
+        Iterations += 1;
+    }
+
+    Status = PtFinishTimedTest(Result);
+    if ((Status != 0) && (Result->Status == 0)) {
+        Result->Status = errno;
+    }
+
+MainEnd:
+    Result->Data.Iterations = Iterations;
+    return;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
@@ -0,0 +1,257 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    string.c
+
+Abstract:
+
+    This module implements the performance benchmark tests for the C library
+    string and memory routines.
+
+Author:
+
+    agent 18-Oct-2026
+
+Environment:
+
+    User
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "perftest.h"
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// Define the number of different alignments each operation is run at. The
+// two buffers are offset by different amounts so that both matching and
+// mismatched alignments get measured.
+//
+
+#define PT_STRING_ALIGNMENT_COUNT 8
+
+//
+// Define the size of each buffer, which is enough for the largest operation
+// at the largest offset, plus a terminator.
+//
+
+#define PT_STRING_MAX_SIZE 65536
+#define PT_STRING_BUFFER_SIZE \
+    (PT_STRING_MAX_SIZE + PT_STRING_ALIGNMENT_COUNT + 1)
+
+#define PT_STRING_FILL_CHARACTER 'a'
+#define PT_STRING_MISSING_CHARACTER 'z'
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// Store the sizes each operation is run at, from tiny keys to large blocks.
+//
+
+size_t StringTestSizes[] = {
+    7,
+    16,
+    63,
+    256,
+    1024,
+    4096,
+    PT_STRING_MAX_SIZE
+};
+
+//
+// Store the buffers and a sink for results, which are global so that the
+// compiler can't decide the operations are unused.
+//
+
+char *StringLeft;
+char *StringRight;
+volatile size_t StringSink;
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+void
+StringMain (
+    PPT_TEST_INFORMATION Test,
+    PPT_TEST_RESULT Result
+    )
+
+/*++
+
+Routine Description:
+
+    This routine performs the string and memory routine performance benchmark
+    tests.
+
+Arguments:
+
+    Test - Supplies a pointer to the performance test being executed.
+
+    Result - Supplies a pointer to a performance test result structure that
+        receives the tests results.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    unsigned long long Iterations;
+    char *Left;
+    size_t LeftOffset;
+    char *Right;
+    size_t RightOffset;
+    size_t Size;
+    size_t SizeCount;
+    int Status;
+    unsigned long long TotalBytes;
+
+    Iterations = 0;
+    TotalBytes = 0;
+    Result->Type = PtResultBytes;
+    Result->Status = 0;
+    switch (Test->TestType) {
+    case PtTestMemcpy:
+    case PtTestMemset:
+    case PtTestMemcmp:
+    case PtTestMemchr:
+    case PtTestStrlen:
+    case PtTestStrcmp:
+        break;
+
+    default:
+        fprintf(stderr, "Unknown string test type %d\n", Test->TestType);
+        Result->Status = EINVAL;
+        goto MainEnd;
+    }
+
+    StringLeft = malloc(PT_STRING_BUFFER_SIZE);
+    StringRight = malloc(PT_STRING_BUFFER_SIZE);
+    if ((StringLeft == NULL) || (StringRight == NULL)) {
+        Result->Status = ENOMEM;
+        goto MainEnd;
+    }
+
+    memset(StringLeft, PT_STRING_FILL_CHARACTER, PT_STRING_BUFFER_SIZE);
+    memset(StringRight, PT_STRING_FILL_CHARACTER, PT_STRING_BUFFER_SIZE);
+    SizeCount = sizeof(StringTestSizes) / sizeof(StringTestSizes[0]);
+
+    //
+    // Start the test. This snaps resource usage and starts the clock ticking.
+    //
+
+    Status = PtStartTimedTest(Test->Duration);
+    if (Status != 0) {
+        Result->Status = errno;
+        goto MainEnd;
+    }
+
+    while (PtIsTimedTestRunning() != 0) {
+
+        //
+        // Cycle through every size at one pair of alignments before moving
+        // on to the next pair.
+        //
+
+        Size = StringTestSizes[Iterations % SizeCount];
+        LeftOffset = (Iterations / SizeCount) % PT_STRING_ALIGNMENT_COUNT;
+        RightOffset = (LeftOffset * 3) % PT_STRING_ALIGNMENT_COUNT;
+        Left = StringLeft + LeftOffset;
+        Right = StringRight + RightOffset;
+        switch (Test->TestType) {
+        case PtTestMemcpy:
+            memcpy(Left, Right, Size);
+            break;
+
+        case PtTestMemset:
+            memset(Left, PT_STRING_FILL_CHARACTER, Size);
+            break;
+
+        case PtTestMemcmp:
+            StringSink += memcmp(Left, Right, Size);
+            break;
+
+        case PtTestMemchr:
+            StringSink += (memchr(Left, PT_STRING_MISSING_CHARACTER, Size) ==
+                           NULL);
+
+            break;
+
+        case PtTestStrlen:
+            Left[Size] = '\0';
+            StringSink += strlen(Left);
+            Left[Size] = PT_STRING_FILL_CHARACTER;
+            break;
+
+        case PtTestStrcmp:
+            Left[Size] = '\0';
+            Right[Size] = '\0';
+            StringSink += strcmp(Left, Right);
+            Left[Size] = PT_STRING_FILL_CHARACTER;
+            Right[Size] = PT_STRING_FILL_CHARACTER;
+            break;
+
+        default:
+            break;
+        }
+
+        TotalBytes += Size;
+        Iterations += 1;
+    }
+
+    Status = PtFinishTimedTest(Result);
+    if ((Status != 0) && (Result->Status == 0)) {
+        Result->Status = errno;
+    }
+
+MainEnd:
+    if (StringLeft != NULL) {
+        free(StringLeft);
+        StringLeft = NULL;
+    }
+
+    if (StringRight != NULL) {
+        free(StringRight);
+        StringRight = NULL;
+    }
+
+    Result->Data.Bytes = TotalBytes;
+    return;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
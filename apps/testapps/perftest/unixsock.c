@@ -0,0 +1,319 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    unixsock.c
+
+Abstract:
+
+    This module implements the Unix domain socket performance benchmark tests,
+    which measure small message rate and round trip latency.
+
+Author:
+
+    agent 18-Oct-2026
+
+Environment:
+
+    User
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "perftest.h"
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// Define the size of each message sent by the tests. This is meant to look
+// like a typical small local RPC request.
+//
+
+#define PT_UNIX_SOCKET_MESSAGE_SIZE 64
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+int
+UnixSocketTransfer (
+    int Socket,
+    char *Buffer,
+    size_t Size,
+    int Send
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+void
+UnixSocketMain (
+    PPT_TEST_INFORMATION Test,
+    PPT_TEST_RESULT Result
+    )
+
+/*++
+
+Routine Description:
+
+    This routine performs the Unix domain socket performance benchmark tests.
+
+Arguments:
+
+    Test - Supplies a pointer to the performance test being executed.
+
+    Result - Supplies a pointer to a performance test result structure that
+        receives the tests results.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    char Buffer[PT_UNIX_SOCKET_MESSAGE_SIZE];
+    pid_t Child;
+    unsigned long long Iterations;
+    int Sockets[2];
+    int Status;
+    int Type;
+
+    Child = -1;
+    Iterations = 0;
+    Sockets[0] = -1;
+    Sockets[1] = -1;
+    Result->Type = PtResultIterations;
+    Result->Status = 0;
+    switch (Test->TestType) {
+    case PtTestUnixStream:
+    case PtTestUnixLatency:
+        Type = SOCK_STREAM;
+        break;
+
+    case PtTestUnixDatagram:
+        Type = SOCK_DGRAM;
+        break;
+
+    default:
+        fprintf(stderr, "Unknown Unix socket test type %d\n", Test->TestType);
+        Result->Status = EINVAL;
+        goto MainEnd;
+    }
+
+    Status = socketpair(AF_UNIX, Type, 0, Sockets);
+    if (Status != 0) {
+        Result->Status = errno;
+        goto MainEnd;
+    }
+
+    memset(Buffer, 0, sizeof(Buffer));
+
+    //
+    // For the latency test, a child process echoes every message back until
+    // the parent closes its end of the connection.
+    //
+
+    if (Test->TestType == PtTestUnixLatency) {
+        Child = fork();
+        if (Child < 0) {
+            Result->Status = errno;
+            goto MainEnd;
+        }
+
+        if (Child == 0) {
+            close(Sockets[0]);
+            while (1) {
+                Status = UnixSocketTransfer(Sockets[1],
+                                            Buffer,
+                                            sizeof(Buffer),
+                                            0);
+
+                if (Status != 0) {
+                    break;
+                }
+
+                Status = UnixSocketTransfer(Sockets[1],
+                                            Buffer,
+                                            sizeof(Buffer),
+                                            1);
+
+                if (Status != 0) {
+                    break;
+                }
+            }
+
+            exit(0);
+        }
+
+        close(Sockets[1]);
+        Sockets[1] = -1;
+    }
+
+    //
+    // Start the test. This snaps resource usage and starts the clock ticking.
+    //
+
+    Status = PtStartTimedTest(Test->Duration);
+    if (Status != 0) {
+        Result->Status = errno;
+        goto MainEnd;
+    }
+
+    //
+    // The rate tests send a message and receive it within the same process,
+    // which exercises the per-message cost of the socket. The latency test
+    // sends a message and waits for the child to send it back.
+    //
+
+    while (PtIsTimedTestRunning() != 0) {
+        Status = UnixSocketTransfer(Sockets[0], Buffer, sizeof(Buffer), 1);
+        if (Status != 0) {
+            Result->Status = Status;
+            break;
+        }
+
+        if (Test->TestType == PtTestUnixLatency) {
+            Status = UnixSocketTransfer(Sockets[0],
+                                        Buffer,
+                                        sizeof(Buffer),
+                                        0);
+
+        } else {
+            Status = UnixSocketTransfer(Sockets[1],
+                                        Buffer,
+                                        sizeof(Buffer),
+                                        0);
+        }
+
+        if (Status != 0) {
+            Result->Status = Status;
+            break;
+        }
+
+        Iterations += 1;
+    }
+
+    Status = PtFinishTimedTest(Result);
+    if ((Status != 0) && (Result->Status == 0)) {
+        Result->Status = errno;
+    }
+
+MainEnd:
+    if (Sockets[0] >= 0) {
+        close(Sockets[0]);
+    }
+
+    if (Sockets[1] >= 0) {
+        close(Sockets[1]);
+    }
+
+    if (Child > 0) {
+        waitpid(Child, NULL, 0);
+    }
+
+    Result->Data.Iterations = Iterations;
+    return;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+int
+UnixSocketTransfer (
+    int Socket,
+    char *Buffer,
+    size_t Size,
+    int Send
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sends or receives a complete message on the given socket,
+    retrying partial transfers and interrupted calls.
+
+Arguments:
+
+    Socket - Supplies the socket to transfer on.
+
+    Buffer - Supplies a pointer to the message buffer.
+
+    Size - Supplies the size of the message in bytes.
+
+    Send - Supplies a non-zero value to send the message, or zero to receive
+        it.
+
+Return Value:
+
+    0 on success.
+
+    Returns an error number on failure. EPIPE is returned if the other end of
+    the connection was closed.
+
+--*/
+
+{
+
+    ssize_t BytesCompleted;
+    size_t Offset;
+
+    Offset = 0;
+    while (Offset < Size) {
+        if (Send != 0) {
+            BytesCompleted = send(Socket, Buffer + Offset, Size - Offset, 0);
+
+        } else {
+            BytesCompleted = recv(Socket, Buffer + Offset, Size - Offset, 0);
+        }
+
+        if (BytesCompleted < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            return errno;
+        }
+
+        if (BytesCompleted == 0) {
+            return EPIPE;
+        }
+
+        Offset += BytesCompleted;
+    }
+
+    return 0;
+}
+
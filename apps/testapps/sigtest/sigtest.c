@@ -37,8 +37,10 @@ Module Name:
 #include <fcntl.h>
 #include <getopt.h>
 #include <pthread.h>
+#include <spawn.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/wait.h>
 #include <ucontext.h>
 #include <unistd.h>
@@ -65,6 +67,8 @@ Module Name:
 
 #define SIGNAL_TEST_CONTEXT_STACK_SIZE 16384
 
+#define SIGNAL_TEST_SYSTEM_EXIT_STATUS 5
+
 //
 // ---------------------------------------------------------------- Definitions
 //
@@ -80,7 +84,7 @@ Module Name:
     "  -p, --threads <count> -- Set the number of threads to spin up to \n"    \
     "      simultaneously run the test.\n"                                     \
     "  -t, --test -- Set the test to perform. Valid values are all, \n"        \
-    "      waitpid, sigchld, quickwait, nested, and context.\n"                \
+    "      waitpid, sigchld, quickwait, nested, context, and spawn.\n"         \
     "  --debug -- Print lots of information about what's happening.\n"         \
     "  --quiet -- Print only errors.\n"                                        \
     "  --help -- Print this help text and exit.\n"                             \
@@ -105,6 +109,7 @@ typedef enum _SIGNAL_TEST_TYPE {
     SignalTestQuickWait,
     SignalTestNested,
     SignalTestContext,
+    SignalTestSpawn,
 } SIGNAL_TEST_TYPE, *PSIGNAL_TEST_TYPE;
 
 typedef enum _SIGNAL_TEST_WAIT_TYPE {
@@ -137,6 +142,22 @@ RunQuickWaitTest (
     ULONG ChildCount
     );
 
+ULONG
+RunSpawnTest (
+    ULONG Iterations,
+    ULONG ChildCount
+    );
+
+ULONG
+TestSpawnSignals (
+    VOID
+    );
+
+ULONG
+TestSystemSignals (
+    VOID
+    );
+
 ULONG
 TestWaitpid (
     BOOL BurnTimeInChild,
@@ -205,6 +226,11 @@ TestMakecontext (
     INT Identifier
     );
 
+VOID
+TestSpawnSignalHandler (
+    int Signal
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -376,6 +402,9 @@ Return Value:
             } else if (strcasecmp(optarg, "context") == 0) {
                 Test = SignalTestContext;
 
+            } else if (strcasecmp(optarg, "spawn") == 0) {
+                Test = SignalTestSpawn;
+
             } else {
                 PRINT_ERROR("Invalid test: %s.\n", optarg);
                 Status = 1;
@@ -462,6 +491,10 @@ Return Value:
         Failures += RunSetContextTest();
     }
 
+    if ((Test == SignalTestAll) || (Test == SignalTestSpawn)) {
+        Failures += RunSpawnTest(Iterations, ChildProcessCount);
+    }
+
     //
     // Wait for any children.
     //
@@ -753,6 +786,432 @@ Return Value:
     return Failures;
 }
 
+ULONG
+RunSpawnTest (
+    ULONG Iterations,
+    ULONG ChildCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine runs the spawn test, which launches batches of processes
+    with posix_spawn and system and makes sure the parent comes out of each
+    launch intact.
+
+Arguments:
+
+    Iterations - Supplies the number of times to run the test.
+
+    ChildCount - Supplies the number of child processes to spawn at once.
+
+Return Value:
+
+    Returns the number of failures in the test.
+
+--*/
+
+{
+
+    PSTR Arguments[4];
+    pid_t Child;
+    LONG ChildIndex;
+    pid_t *Children;
+    CHAR Command[64];
+    ssize_t CompleteSize;
+    ULONG Failures;
+    posix_spawn_file_actions_t FileActions;
+    ULONG Iteration;
+    CHAR Output[64];
+    int *Pipes;
+    ULONG Percent;
+    int Result;
+    ssize_t Size;
+    volatile ULONG StackCheck;
+    int Status;
+
+    Failures = 0;
+    PRINT("Running spawn test with %d iterations and %d children.\n",
+          Iterations,
+          ChildCount);
+
+    assert(ChildCount != 0);
+
+    Percent = Iterations / 100;
+    if (Percent == 0) {
+        Percent = 1;
+    }
+
+    Pipes = NULL;
+    Children = malloc(sizeof(pid_t) * ChildCount);
+    if (Children == NULL) {
+        Failures += 1;
+        goto RunSpawnTestEnd;
+    }
+
+    Pipes = malloc(sizeof(int) * 2 * ChildCount);
+    if (Pipes == NULL) {
+        Failures += 1;
+        goto RunSpawnTestEnd;
+    }
+
+    Arguments[0] = "sh";
+    Arguments[1] = "-c";
+    Arguments[2] = Command;
+    Arguments[3] = NULL;
+    for (Iteration = 0; Iteration < Iterations; Iteration += 1) {
+        memset(Children, 0, sizeof(pid_t) * ChildCount);
+
+        //
+        // The spawned children borrow this process' address space until they
+        // execute, so make sure this stack comes back unchanged.
+        //
+
+        StackCheck = Iteration ^ 0x5A5A5A5A;
+
+        //
+        // Spawn a batch of shells, each of which prints its index to a pipe
+        // and exits with it.
+        //
+
+        for (ChildIndex = 0; ChildIndex < ChildCount; ChildIndex += 1) {
+            if (pipe(&(Pipes[ChildIndex * 2])) != 0) {
+                PRINT_ERROR("Failed to create pipe: %s.\n", strerror(errno));
+                Failures += 1;
+                continue;
+            }
+
+            snprintf(Command,
+                     sizeof(Command),
+                     "echo spawn%d; exit %d",
+                     (int)ChildIndex,
+                     (int)(ChildIndex & 0x7F));
+
+            posix_spawn_file_actions_init(&FileActions);
+            posix_spawn_file_actions_adddup2(&FileActions,
+                                             Pipes[(ChildIndex * 2) + 1],
+                                             STDOUT_FILENO);
+
+            posix_spawn_file_actions_addclose(&FileActions,
+                                              Pipes[ChildIndex * 2]);
+
+            posix_spawn_file_actions_addclose(&FileActions,
+                                              Pipes[(ChildIndex * 2) + 1]);
+
+            Result = posix_spawnp(&Child,
+                                  "sh",
+                                  &FileActions,
+                                  NULL,
+                                  Arguments,
+                                  environ);
+
+            posix_spawn_file_actions_destroy(&FileActions);
+            close(Pipes[(ChildIndex * 2) + 1]);
+            if (Result != 0) {
+                PRINT_ERROR("Failed to spawn: %s.\n", strerror(Result));
+                close(Pipes[ChildIndex * 2]);
+                Failures += 1;
+                continue;
+            }
+
+            Children[ChildIndex] = Child;
+        }
+
+        if (StackCheck != (Iteration ^ 0x5A5A5A5A)) {
+            PRINT_ERROR("Stack changed while spawning: %x\n", StackCheck);
+            Failures += 1;
+        }
+
+        //
+        // Reap the children backwards, checking their output and status.
+        //
+
+        for (ChildIndex = ChildCount - 1; ChildIndex >= 0; ChildIndex -= 1) {
+            if (Children[ChildIndex] == 0) {
+                continue;
+            }
+
+            CompleteSize = 0;
+            while (CompleteSize < sizeof(Output) - 1) {
+                Size = read(Pipes[ChildIndex * 2],
+                            Output + CompleteSize,
+                            sizeof(Output) - 1 - CompleteSize);
+
+                if (Size < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+
+                    break;
+                }
+
+                if (Size == 0) {
+                    break;
+                }
+
+                CompleteSize += Size;
+            }
+
+            close(Pipes[ChildIndex * 2]);
+            Output[CompleteSize] = '\0';
+            snprintf(Command, sizeof(Command), "spawn%d\n", (int)ChildIndex);
+            if (strcmp(Output, Command) != 0) {
+                PRINT_ERROR("Child %d printed '%s'.\n",
+                            (int)ChildIndex,
+                            Output);
+
+                Failures += 1;
+            }
+
+            Child = waitpid(Children[ChildIndex], &Status, 0);
+            if (Child == -1) {
+                PRINT_ERROR("Failed to wait for child %d: %s.\n",
+                            Children[ChildIndex],
+                            strerror(errno));
+
+                Failures += 1;
+                continue;
+            }
+
+            if ((!WIFEXITED(Status)) ||
+                (WEXITSTATUS(Status) != (ChildIndex & 0x7F))) {
+
+                PRINT_ERROR("Child returned with invalid status %x\n", Status);
+                Failures += 1;
+            }
+        }
+
+        //
+        // A program that does not exist either fails the spawn or produces
+        // a child that exits with 127.
+        //
+
+        Arguments[0] = "/sigtest/does/not/exist";
+        Result = posix_spawn(&Child,
+                             Arguments[0],
+                             NULL,
+                             NULL,
+                             Arguments,
+                             environ);
+
+        Arguments[0] = "sh";
+        if (Result == 0) {
+            if ((waitpid(Child, &Status, 0) != Child) ||
+                (!WIFEXITED(Status)) ||
+                (WEXITSTATUS(Status) != 127)) {
+
+                PRINT_ERROR("Missing program returned status %x\n", Status);
+                Failures += 1;
+            }
+
+        } else if (Result != ENOENT) {
+            PRINT_ERROR("Missing program failed with %s.\n", strerror(Result));
+            Failures += 1;
+        }
+
+        Failures += TestSpawnSignals();
+        Failures += TestSystemSignals();
+        if ((Iteration % Percent) == 0) {
+            PRINT("s");
+        }
+    }
+
+    PRINT("\n");
+
+RunSpawnTestEnd:
+    if (Children != NULL) {
+        free(Children);
+    }
+
+    if (Pipes != NULL) {
+        free(Pipes);
+    }
+
+    return Failures;
+}
+
+ULONG
+TestSpawnSignals (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine spawns a shell that sends itself a signal which the parent
+    both handles and blocks. The spawn attributes reset the signal to its
+    default action and clear the mask, so the child should die from it. The
+    parent's handler and mask must be untouched afterwards.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns the number of failures in the test.
+
+--*/
+
+{
+
+    struct sigaction Action;
+    PSTR Arguments[4];
+    posix_spawnattr_t Attributes;
+    pid_t Child;
+    sigset_t DefaultSignals;
+    sigset_t EmptyMask;
+    ULONG Failures;
+    sigset_t Mask;
+    struct sigaction OriginalAction;
+    sigset_t OriginalMask;
+    int Result;
+    int Status;
+
+    Failures = 0;
+    memset(&Action, 0, sizeof(struct sigaction));
+    Action.sa_handler = TestSpawnSignalHandler;
+    sigaction(SIGUSR1, &Action, &OriginalAction);
+    sigemptyset(&Mask);
+    sigaddset(&Mask, SIGUSR1);
+    sigprocmask(SIG_BLOCK, &Mask, &OriginalMask);
+    sigemptyset(&DefaultSignals);
+    sigaddset(&DefaultSignals, SIGUSR1);
+    sigemptyset(&EmptyMask);
+    posix_spawnattr_init(&Attributes);
+    posix_spawnattr_setflags(&Attributes,
+                             POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK);
+
+    posix_spawnattr_setsigdefault(&Attributes, &DefaultSignals);
+    posix_spawnattr_setsigmask(&Attributes, &EmptyMask);
+    Arguments[0] = "sh";
+    Arguments[1] = "-c";
+    Arguments[2] = "kill -s USR1 $$; exit 0";
+    Arguments[3] = NULL;
+    Result = posix_spawnp(&Child, "sh", NULL, &Attributes, Arguments, environ);
+    posix_spawnattr_destroy(&Attributes);
+    if (Result != 0) {
+        PRINT_ERROR("Failed to spawn: %s.\n", strerror(Result));
+        Failures += 1;
+
+    } else {
+        if (waitpid(Child, &Status, 0) != Child) {
+            PRINT_ERROR("Failed to wait for child: %s.\n", strerror(errno));
+            Failures += 1;
+
+        } else if ((!WIFSIGNALED(Status)) || (WTERMSIG(Status) != SIGUSR1)) {
+            PRINT_ERROR("Signaled child returned status %x\n", Status);
+            Failures += 1;
+        }
+    }
+
+    sigaction(SIGUSR1, NULL, &Action);
+    if (Action.sa_handler != TestSpawnSignalHandler) {
+        PRINT_ERROR("Spawn changed the parent's signal handler.\n");
+        Failures += 1;
+    }
+
+    sigprocmask(SIG_SETMASK, NULL, &Mask);
+    if (sigismember(&Mask, SIGUSR1) == 0) {
+        PRINT_ERROR("Spawn changed the parent's signal mask.\n");
+        Failures += 1;
+    }
+
+    sigprocmask(SIG_SETMASK, &OriginalMask, NULL);
+    sigaction(SIGUSR1, &OriginalAction, NULL);
+    return Failures;
+}
+
+ULONG
+TestSystemSignals (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine runs a command with system, and makes sure the exit status
+    comes back and that the interrupt, quit, and child signal dispositions are
+    put back the way they were.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns the number of failures in the test.
+
+--*/
+
+{
+
+    struct sigaction Action;
+    CHAR Command[32];
+    ULONG Failures;
+    sigset_t Mask;
+    struct sigaction OriginalInterrupt;
+    sigset_t OriginalMask;
+    struct sigaction OriginalQuit;
+    int Status;
+
+    Failures = 0;
+    if (system(NULL) == 0) {
+        PRINT_ERROR("system(NULL) reported no shell.\n");
+        Failures += 1;
+    }
+
+    //
+    // Give the two signals different dispositions, so that mixing them up
+    // on restore gets noticed.
+    //
+
+    memset(&Action, 0, sizeof(struct sigaction));
+    Action.sa_handler = TestSpawnSignalHandler;
+    sigaction(SIGINT, &Action, &OriginalInterrupt);
+    Action.sa_handler = SIG_DFL;
+    sigaction(SIGQUIT, &Action, &OriginalQuit);
+    sigprocmask(SIG_SETMASK, NULL, &OriginalMask);
+    snprintf(Command,
+             sizeof(Command),
+             "exit %d",
+             SIGNAL_TEST_SYSTEM_EXIT_STATUS);
+
+    Status = system(Command);
+    if ((Status == -1) ||
+        (!WIFEXITED(Status)) ||
+        (WEXITSTATUS(Status) != SIGNAL_TEST_SYSTEM_EXIT_STATUS)) {
+
+        PRINT_ERROR("system returned status %x\n", Status);
+        Failures += 1;
+    }
+
+    sigaction(SIGINT, NULL, &Action);
+    if (Action.sa_handler != TestSpawnSignalHandler) {
+        PRINT_ERROR("system did not restore SIGINT.\n");
+        Failures += 1;
+    }
+
+    sigaction(SIGQUIT, NULL, &Action);
+    if (Action.sa_handler != SIG_DFL) {
+        PRINT_ERROR("system did not restore SIGQUIT.\n");
+        Failures += 1;
+    }
+
+    sigprocmask(SIG_SETMASK, NULL, &Mask);
+    if (sigismember(&Mask, SIGCHLD) != sigismember(&OriginalMask, SIGCHLD)) {
+        PRINT_ERROR("system did not restore the SIGCHLD mask.\n");
+        Failures += 1;
+    }
+
+    sigaction(SIGINT, &OriginalInterrupt, NULL);
+    sigaction(SIGQUIT, &OriginalQuit, NULL);
+    return Failures;
+}
+
 ULONG
 TestWaitpid (
     BOOL BurnTimeInChild,
@@ -1955,3 +2414,31 @@ Return Value:
     return;
 }
 
+VOID
+TestSpawnSignalHandler (
+    int Signal
+    )
+
+/*++
+
+Routine Description:
+
+    This routine implements a signal handler that does nothing. It is
+    installed by the spawn tests so that handled dispositions can be told
+    apart from the defaults.
+
+Arguments:
+
+    Signal - Supplies the signal number that fired.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    return;
+}
+
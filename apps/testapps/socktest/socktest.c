@@ -35,15 +35,32 @@ Module Name:
 #include <arpa/inet.h>
 #include <errno.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
 //
 // ---------------------------------------------------------------- Definitions
 //
 
+//
+// Define the amount of data pushed through the loopback throughput test.
+//
+
+#define LOOPBACK_THROUGHPUT_CHUNK_SIZE (64 * 1024)
+#define LOOPBACK_THROUGHPUT_CHUNK_COUNT 4096
+
+//
+// Define the number of round trips timed by the loopback latency test.
+//
+
+#define LOOPBACK_LATENCY_ITERATIONS 10000
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -58,6 +75,34 @@ TestTransmitThroughput (
     ULONG ChunkCount
     );
 
+ULONG
+TestLoopbackThroughput (
+    ULONG ChunkSize,
+    ULONG ChunkCount
+    );
+
+ULONG
+TestLoopbackLatency (
+    ULONG Iterations
+    );
+
+int
+TestCreateLoopbackPair (
+    int *ServerSocket,
+    int *ClientSocket,
+    pid_t *Child
+    );
+
+int
+TestWaitForChild (
+    pid_t Child
+    );
+
+double
+TestGetElapsedSeconds (
+    struct timespec *Start
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -76,7 +121,9 @@ main (
 
 Routine Description:
 
-    This routine implements the socket test program.
+    This routine implements the socket test program. By default it
+    benchmarks TCP over the loopback interface. Supply "remote" to instead
+    blast data at a remote test host.
 
 Arguments:
 
@@ -95,7 +142,21 @@ Return Value:
 
 {
 
-    return TestTransmitThroughput(64 * 1024, 16);
+    ULONG Failures;
+
+    if ((ArgumentCount > 1) && (strcmp(Arguments[1], "remote") == 0)) {
+        return TestTransmitThroughput(64 * 1024, 16);
+    }
+
+    Failures = TestLoopbackThroughput(LOOPBACK_THROUGHPUT_CHUNK_SIZE,
+                                      LOOPBACK_THROUGHPUT_CHUNK_COUNT);
+
+    Failures += TestLoopbackLatency(LOOPBACK_LATENCY_ITERATIONS);
+    if (Failures != 0) {
+        return 1;
+    }
+
+    return 0;
 }
 
 //
@@ -233,3 +294,402 @@ Return Value:
     return Errors;
 }
 
+ULONG
+TestLoopbackThroughput (
+    ULONG ChunkSize,
+    ULONG ChunkCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine measures TCP throughput over the loopback interface. A child
+    process sends the data while this process receives and times it.
+
+Arguments:
+
+    ChunkSize - Supplies the size of each buffer passed to the send() function.
+
+    ChunkCount - Supplies the number of chunks that will be sent.
+
+Return Value:
+
+    Returns the number of failures that occurred in the test.
+
+--*/
+
+{
+
+    ssize_t BytesReceived;
+    int BytesSent;
+    pid_t Child;
+    int ClientSocket;
+    ULONG Errors;
+    ULONG LoopIndex;
+    double Seconds;
+    int ServerSocket;
+    struct timespec Start;
+    PCHAR TestBuffer;
+    ULONGLONG TotalBytes;
+
+    Errors = 0;
+    TotalBytes = 0;
+    TestBuffer = malloc(ChunkSize);
+    if (TestBuffer == NULL) {
+        printf("Failed to allocate %d bytes.\n", ChunkSize);
+        return 1;
+    }
+
+    memset(TestBuffer, 0xA5, ChunkSize);
+    clock_gettime(CLOCK_MONOTONIC, &Start);
+    if (TestCreateLoopbackPair(&ServerSocket, &ClientSocket, &Child) != 0) {
+        Errors += 1;
+        goto TestLoopbackThroughputEnd;
+    }
+
+    //
+    // The child sends everything and exits, closing its end.
+    //
+
+    if (Child == 0) {
+        for (LoopIndex = 0; LoopIndex < ChunkCount; LoopIndex += 1) {
+            BytesSent = send(ClientSocket, TestBuffer, ChunkSize, 0);
+            if (BytesSent != ChunkSize) {
+                printf("Error: send() returned %d, errno %d.\n",
+                       BytesSent,
+                       errno);
+
+                exit(1);
+            }
+        }
+
+        close(ClientSocket);
+        exit(0);
+    }
+
+    //
+    // Receive until the sender hangs up.
+    //
+
+    while (TRUE) {
+        BytesReceived = recv(ServerSocket, TestBuffer, ChunkSize, 0);
+        if (BytesReceived <= 0) {
+            if (BytesReceived < 0) {
+                printf("Error: recv() failed, errno %d.\n", errno);
+                Errors += 1;
+            }
+
+            break;
+        }
+
+        TotalBytes += BytesReceived;
+    }
+
+    Seconds = TestGetElapsedSeconds(&Start);
+    close(ServerSocket);
+    Errors += TestWaitForChild(Child);
+    if (TotalBytes != (ULONGLONG)ChunkSize * ChunkCount) {
+        printf("Error: Received %llu of %llu bytes.\n",
+               TotalBytes,
+               (ULONGLONG)ChunkSize * ChunkCount);
+
+        Errors += 1;
+    }
+
+    if (Seconds != 0) {
+        printf("Loopback throughput: %llu bytes in %.3f seconds, "
+               "%.1f MB/s.\n",
+               TotalBytes,
+               Seconds,
+               (double)TotalBytes / Seconds / (1024.0 * 1024.0));
+    }
+
+TestLoopbackThroughputEnd:
+    free(TestBuffer);
+    printf("TestLoopbackThroughput done. %d errors found.\n", Errors);
+    return Errors;
+}
+
+ULONG
+TestLoopbackLatency (
+    ULONG Iterations
+    )
+
+/*++
+
+Routine Description:
+
+    This routine measures the round trip latency of small TCP messages over
+    the loopback interface. A child process echoes back each byte sent.
+
+Arguments:
+
+    Iterations - Supplies the number of round trips to time.
+
+Return Value:
+
+    Returns the number of failures that occurred in the test.
+
+--*/
+
+{
+
+    CHAR Byte;
+    pid_t Child;
+    int ClientSocket;
+    ULONG Errors;
+    ULONG LoopIndex;
+    int One;
+    double Seconds;
+    int ServerSocket;
+    struct timespec Start;
+
+    Errors = 0;
+    if (TestCreateLoopbackPair(&ServerSocket, &ClientSocket, &Child) != 0) {
+        Errors += 1;
+        goto TestLoopbackLatencyEnd;
+    }
+
+    //
+    // Small messages must not sit in the send queue waiting to be coalesced.
+    //
+
+    One = 1;
+    setsockopt(ServerSocket, IPPROTO_TCP, TCP_NODELAY, &One, sizeof(One));
+    setsockopt(ClientSocket, IPPROTO_TCP, TCP_NODELAY, &One, sizeof(One));
+
+    //
+    // The child echoes bytes until the connection closes.
+    //
+
+    if (Child == 0) {
+        while (recv(ClientSocket, &Byte, 1, 0) == 1) {
+            if (send(ClientSocket, &Byte, 1, 0) != 1) {
+                exit(1);
+            }
+        }
+
+        close(ClientSocket);
+        exit(0);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &Start);
+    for (LoopIndex = 0; LoopIndex < Iterations; LoopIndex += 1) {
+        Byte = (CHAR)LoopIndex;
+        if ((send(ServerSocket, &Byte, 1, 0) != 1) ||
+            (recv(ServerSocket, &Byte, 1, 0) != 1)) {
+
+            printf("Error: Round trip %d failed, errno %d.\n",
+                   LoopIndex,
+                   errno);
+
+            Errors += 1;
+            break;
+        }
+
+        if (Byte != (CHAR)LoopIndex) {
+            printf("Error: Round trip %d echoed %d.\n", LoopIndex, Byte);
+            Errors += 1;
+            break;
+        }
+    }
+
+    Seconds = TestGetElapsedSeconds(&Start);
+    close(ServerSocket);
+    Errors += TestWaitForChild(Child);
+    if ((LoopIndex != 0) && (Seconds != 0)) {
+        printf("Loopback latency: %d round trips in %.3f seconds, "
+               "%.1f us each.\n",
+               LoopIndex,
+               Seconds,
+               Seconds * 1000000.0 / LoopIndex);
+    }
+
+TestLoopbackLatencyEnd:
+    printf("TestLoopbackLatency done. %d errors found.\n", Errors);
+    return Errors;
+}
+
+int
+TestCreateLoopbackPair (
+    int *ServerSocket,
+    int *ClientSocket,
+    pid_t *Child
+    )
+
+/*++
+
+Routine Description:
+
+    This routine forks and creates a connected pair of TCP sockets over the
+    loopback address. The parent gets the accepted server socket and the
+    child gets the connected client socket.
+
+Arguments:
+
+    ServerSocket - Supplies a pointer where the accepted socket is returned in
+        the parent. Set to -1 in the child.
+
+    ClientSocket - Supplies a pointer where the connected socket is returned in
+        the child. Set to -1 in the parent.
+
+    Child - Supplies a pointer where the child's process ID is returned in the
+        parent. Set to zero in the child.
+
+Return Value:
+
+    0 on success.
+
+    -1 on failure.
+
+--*/
+
+{
+
+    struct sockaddr_in Address;
+    socklen_t AddressLength;
+    int ListeningSocket;
+    int Result;
+
+    *ServerSocket = -1;
+    *ClientSocket = -1;
+    *Child = -1;
+    Result = -1;
+    ListeningSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if (ListeningSocket == -1) {
+        printf("socket() failed. Errno = %d.\n", errno);
+        return -1;
+    }
+
+    memset(&Address, 0, sizeof(Address));
+    Address.sin_family = AF_INET;
+    Address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    Address.sin_port = 0;
+    AddressLength = sizeof(Address);
+    if ((bind(ListeningSocket,
+              (struct sockaddr *)&Address,
+              sizeof(Address)) != 0) ||
+        (getsockname(ListeningSocket,
+                     (struct sockaddr *)&Address,
+                     &AddressLength) != 0) ||
+        (listen(ListeningSocket, 1) != 0)) {
+
+        printf("Failed to set up loopback listener. Errno = %d.\n", errno);
+        goto CreateLoopbackPairEnd;
+    }
+
+    //
+    // Flush output so the child does not print a second copy when it exits.
+    //
+
+    fflush(stdout);
+    *Child = fork();
+    if (*Child < 0) {
+        printf("fork() failed. Errno = %d.\n", errno);
+        goto CreateLoopbackPairEnd;
+    }
+
+    if (*Child == 0) {
+        close(ListeningSocket);
+        ListeningSocket = -1;
+        *ClientSocket = socket(AF_INET, SOCK_STREAM, 0);
+        if ((*ClientSocket == -1) ||
+            (connect(*ClientSocket,
+                     (struct sockaddr *)&Address,
+                     sizeof(Address)) != 0)) {
+
+            printf("Failed to connect over loopback. Errno = %d.\n", errno);
+            exit(1);
+        }
+
+    } else {
+        *ServerSocket = accept(ListeningSocket, NULL, NULL);
+        if (*ServerSocket == -1) {
+            printf("accept() failed. Errno = %d.\n", errno);
+            TestWaitForChild(*Child);
+            goto CreateLoopbackPairEnd;
+        }
+    }
+
+    Result = 0;
+
+CreateLoopbackPairEnd:
+    if (ListeningSocket != -1) {
+        close(ListeningSocket);
+    }
+
+    return Result;
+}
+
+int
+TestWaitForChild (
+    pid_t Child
+    )
+
+/*++
+
+Routine Description:
+
+    This routine waits for a test child process to exit.
+
+Arguments:
+
+    Child - Supplies the ID of the child process.
+
+Return Value:
+
+    0 if the child exited successfully.
+
+    1 if the child failed.
+
+--*/
+
+{
+
+    int Status;
+
+    if (waitpid(Child, &Status, 0) != Child) {
+        printf("waitpid() failed. Errno = %d.\n", errno);
+        return 1;
+    }
+
+    if ((!WIFEXITED(Status)) || (WEXITSTATUS(Status) != 0)) {
+        printf("Child process failed with status 0x%x.\n", Status);
+        return 1;
+    }
+
+    return 0;
+}
+
+double
+TestGetElapsedSeconds (
+    struct timespec *Start
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the number of seconds elapsed since the given
+    monotonic clock time.
+
+Arguments:
+
+    Start - Supplies a pointer to the starting time.
+
+Return Value:
+
+    Returns the elapsed time in seconds.
+
+--*/
+
+{
+
+    struct timespec End;
+
+    clock_gettime(CLOCK_MONOTONIC, &End);
+    return (double)(End.tv_sec - Start->tv_sec) +
+           ((double)(End.tv_nsec - Start->tv_nsec) / 1000000000.0);
+}
+
@@ -0,0 +1,946 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    sorttest.c
+
+Abstract:
+
+    This module implements the tests used to verify that the sort utility
+    produces the same output no matter how its input gets split up across
+    buffers and threads, and that the unique option keeps the first line of
+    each group of equal keys.
+
+Author:
+
+    agent 18-Oct-2026
+
+Environment:
+
+    User Mode
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <minoca/lib/minocaos.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+//
+// --------------------------------------------------------------------- Macros
+//
+
+#define DEBUG_PRINT(...)                \
+    if (SortTestVerbose != FALSE) {     \
+        printf(__VA_ARGS__);            \
+    }
+
+#define PRINT_ERROR(...) printf(__VA_ARGS__)
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+#define SORT_TEST_USAGE                                                        \
+    "Usage: sorttest [sort_command]\n"                                         \
+    "This utility runs the given sort command (or sort if none is \n"          \
+    "supplied) with several key options, buffer sizes, and thread counts, \n"  \
+    "and verifies that the output never changes, and that -u keeps the \n"  \
+    "first of each group of lines with equal keys.\n"
+
+//
+// Define the default command used to invoke the sort utility.
+//
+
+#define SORT_TEST_DEFAULT_COMMAND "sort"
+
+//
+// Define the names of the files the test works with.
+//
+
+#define SORT_TEST_INPUT_FILE "sorttest.in"
+#define SORT_TEST_REFERENCE_FILE "sorttest.ref"
+#define SORT_TEST_OUTPUT_FILE "sorttest.out"
+
+//
+// Define the number of lines in the generated input. This is large enough to
+// spill across several buffers at the smaller buffer sizes.
+//
+
+#define SORT_TEST_LINE_COUNT 20000
+
+//
+// Define the number of lines in the input for the parallel test. This is
+// large enough that sort hands the whole buffer to the C library's parallel
+// sort with every thread it is given.
+//
+
+#define SORT_TEST_PARALLEL_LINE_COUNT 100000
+
+//
+// Define the options used by the unique test, which looks only at the first
+// field. Every line has a different second field, so the output shows which
+// line of each group was kept.
+//
+
+#define SORT_TEST_UNIQUE_OPTIONS "-u -k1,1"
+
+//
+// Define the number of distinct numeric keys. It is kept small so that most
+// lines tie with many others on their keys.
+//
+
+#define SORT_TEST_KEY_COUNT 10
+
+//
+// Define the size of the command line buffer.
+//
+
+#define SORT_TEST_COMMAND_SIZE 1024
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+ULONG
+RunAllSortTests (
+    PSTR SortCommand
+    );
+
+ULONG
+RunSortBufferTest (
+    PSTR SortCommand,
+    PSTR Options
+    );
+
+ULONG
+RunSortParallelTest (
+    PSTR SortCommand,
+    PSTR Options
+    );
+
+ULONG
+RunSortUniqueTest (
+    PSTR SortCommand
+    );
+
+INT
+SortTestGenerateInput (
+    PSTR Path,
+    ULONG LineCount
+    );
+
+INT
+SortTestGenerateUniqueInput (
+    PSTR Path,
+    PSTR ReferencePath,
+    ULONG LineCount
+    );
+
+INT
+SortTestRun (
+    PSTR SortCommand,
+    PSTR Options,
+    PSTR BufferSize,
+    ULONG ThreadCount,
+    PSTR OutputPath
+    );
+
+INT
+SortTestCompareFiles (
+    PSTR LeftPath,
+    PSTR RightPath
+    );
+
+ULONG
+SortTestRandom (
+    VOID
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// Set this to TRUE to enable more verbose debug output.
+//
+
+BOOL SortTestVerbose = TRUE;
+
+//
+// Store the key options to test. Each of these leaves plenty of lines whose
+// keys compare equal but whose contents differ.
+//
+
+PSTR SortTestOptions[] = {
+    "-n",
+    "-f",
+    "-k2,2",
+    "-d -k2,2",
+    "-k2,2f -k1,1n",
+    "-rn",
+    "-n -u",
+    "-f -u",
+    "-k2,2f -u",
+};
+
+//
+// Store the buffer sizes to try. The first one is large enough to hold the
+// whole input, and is used to produce the reference output.
+//
+
+PSTR SortTestBufferSizes[] = {
+    "64M",
+    "1M",
+    "64K",
+    "16K",
+};
+
+//
+// Store the thread counts to try.
+//
+
+ULONG SortTestThreadCounts[] = {
+    1,
+    3,
+    8
+};
+
+//
+// Store the thread counts to compare against a single thread in the parallel
+// test.
+//
+
+ULONG SortTestParallelThreadCounts[] = {
+    2,
+    4,
+    8,
+    16
+};
+
+//
+// Store the words that make up the second field of each line. These differ
+// only in case and punctuation so that -f and -d consider many of them equal.
+//
+
+PSTR SortTestWords[] = {
+    "apple",
+    "Apple",
+    "APPLE",
+    "a-pple",
+    "app.le",
+    "banana",
+    "Banana",
+    "ba_nana",
+    "cherry",
+    "CHERRY",
+};
+
+//
+// Store the state of the random number generator. It is seeded with a
+// constant so every run generates the same input.
+//
+
+ULONG SortTestRandomState = 0x12345678;
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+int
+main (
+    int ArgumentCount,
+    char **Arguments
+    )
+
+/*++
+
+Routine Description:
+
+    This routine implements the sort test program.
+
+Arguments:
+
+    ArgumentCount - Supplies the number of elements in the arguments array.
+
+    Arguments - Supplies an array of strings. The array count is bounded by the
+        previous parameter, and the strings are null-terminated.
+
+Return Value:
+
+    0 on success.
+
+    Non-zero on failure.
+
+--*/
+
+{
+
+    ULONG Failures;
+    PSTR SortCommand;
+
+    SortCommand = SORT_TEST_DEFAULT_COMMAND;
+    if (ArgumentCount > 2) {
+        printf(SORT_TEST_USAGE);
+        return 1;
+    }
+
+    if (ArgumentCount == 2) {
+        SortCommand = Arguments[1];
+    }
+
+    Failures = RunAllSortTests(SortCommand);
+    if (Failures == 0) {
+        return 0;
+    }
+
+    return 1;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+ULONG
+RunAllSortTests (
+    PSTR SortCommand
+    )
+
+/*++
+
+Routine Description:
+
+    This routine executes all sort tests.
+
+Arguments:
+
+    SortCommand - Supplies the command used to invoke the sort utility.
+
+Return Value:
+
+    Returns the number of failures in the test suite.
+
+--*/
+
+{
+
+    ULONG Failures;
+    ULONG OptionIndex;
+    ULONG OptionCount;
+
+    Failures = 0;
+    if (SortTestGenerateInput(SORT_TEST_INPUT_FILE, SORT_TEST_LINE_COUNT) !=
+        0) {
+
+        PRINT_ERROR("Failed to generate sort input: %s.\n", strerror(errno));
+        Failures += 1;
+        goto RunAllSortTestsEnd;
+    }
+
+    OptionCount = sizeof(SortTestOptions) / sizeof(SortTestOptions[0]);
+    for (OptionIndex = 0; OptionIndex < OptionCount; OptionIndex += 1) {
+        Failures += RunSortBufferTest(SortCommand,
+                                      SortTestOptions[OptionIndex]);
+    }
+
+    if (Failures != 0) {
+        PRINT_ERROR("*** %d failures in sort buffer test. ***\n", Failures);
+    }
+
+    if (SortTestGenerateInput(SORT_TEST_INPUT_FILE,
+                              SORT_TEST_PARALLEL_LINE_COUNT) != 0) {
+
+        PRINT_ERROR("Failed to generate sort input: %s.\n", strerror(errno));
+        Failures += 1;
+        goto RunAllSortTestsEnd;
+    }
+
+    for (OptionIndex = 0; OptionIndex < OptionCount; OptionIndex += 1) {
+        Failures += RunSortParallelTest(SortCommand,
+                                        SortTestOptions[OptionIndex]);
+    }
+
+    if (Failures != 0) {
+        PRINT_ERROR("*** %d failures in sort parallel test. ***\n", Failures);
+    }
+
+    Failures += RunSortUniqueTest(SortCommand);
+    if (Failures != 0) {
+        PRINT_ERROR("*** %d failures in sort unique test. ***\n", Failures);
+    }
+
+RunAllSortTestsEnd:
+    unlink(SORT_TEST_INPUT_FILE);
+    unlink(SORT_TEST_REFERENCE_FILE);
+    unlink(SORT_TEST_OUTPUT_FILE);
+    if (Failures == 0) {
+        DEBUG_PRINT("All sort tests pass.\n");
+    }
+
+    return Failures;
+}
+
+ULONG
+RunSortBufferTest (
+    PSTR SortCommand,
+    PSTR Options
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sorts the input file with the given options across every
+    combination of buffer size and thread count, and verifies that each run
+    produces exactly the same output as a single threaded run that holds the
+    whole input in one buffer.
+
+Arguments:
+
+    SortCommand - Supplies the command used to invoke the sort utility.
+
+    Options - Supplies the key options to pass to sort.
+
+Return Value:
+
+    Returns the number of failures in the test.
+
+--*/
+
+{
+
+    ULONG BufferCount;
+    ULONG BufferIndex;
+    ULONG Failures;
+    ULONG ThreadCount;
+    ULONG ThreadIndex;
+
+    DEBUG_PRINT("Testing sort %s\n", Options);
+    Failures = 0;
+    if (SortTestRun(SortCommand,
+                    Options,
+                    SortTestBufferSizes[0],
+                    1,
+                    SORT_TEST_REFERENCE_FILE) != 0) {
+
+        PRINT_ERROR("sort %s failed to produce reference output.\n", Options);
+        return 1;
+    }
+
+    BufferCount = sizeof(SortTestBufferSizes) / sizeof(SortTestBufferSizes[0]);
+    ThreadCount = sizeof(SortTestThreadCounts) /
+                  sizeof(SortTestThreadCounts[0]);
+
+    for (BufferIndex = 0; BufferIndex < BufferCount; BufferIndex += 1) {
+        for (ThreadIndex = 0; ThreadIndex < ThreadCount; ThreadIndex += 1) {
+            if (SortTestRun(SortCommand,
+                            Options,
+                            SortTestBufferSizes[BufferIndex],
+                            SortTestThreadCounts[ThreadIndex],
+                            SORT_TEST_OUTPUT_FILE) != 0) {
+
+                PRINT_ERROR("sort %s -S %s --parallel=%d failed.\n",
+                            Options,
+                            SortTestBufferSizes[BufferIndex],
+                            SortTestThreadCounts[ThreadIndex]);
+
+                Failures += 1;
+                continue;
+            }
+
+            if (SortTestCompareFiles(SORT_TEST_REFERENCE_FILE,
+                                     SORT_TEST_OUTPUT_FILE) != 0) {
+
+                PRINT_ERROR("sort %s -S %s --parallel=%d output differs.\n",
+                            Options,
+                            SortTestBufferSizes[BufferIndex],
+                            SortTestThreadCounts[ThreadIndex]);
+
+                Failures += 1;
+            }
+        }
+    }
+
+    return Failures;
+}
+
+ULONG
+RunSortParallelTest (
+    PSTR SortCommand,
+    PSTR Options
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sorts the input file with the given options on a single
+    thread and then on several threads, and verifies that the output is the
+    same every time.
+
+Arguments:
+
+    SortCommand - Supplies the command used to invoke the sort utility.
+
+    Options - Supplies the key options to pass to sort.
+
+Return Value:
+
+    Returns the number of failures in the test.
+
+--*/
+
+{
+
+    ULONG Failures;
+    ULONG ThreadCount;
+    ULONG ThreadIndex;
+
+    DEBUG_PRINT("Testing sort --parallel %s\n", Options);
+    Failures = 0;
+    if (SortTestRun(SortCommand,
+                    Options,
+                    SortTestBufferSizes[0],
+                    1,
+                    SORT_TEST_REFERENCE_FILE) != 0) {
+
+        PRINT_ERROR("sort %s --parallel=1 failed.\n", Options);
+        return 1;
+    }
+
+    ThreadCount = sizeof(SortTestParallelThreadCounts) /
+                  sizeof(SortTestParallelThreadCounts[0]);
+
+    for (ThreadIndex = 0; ThreadIndex < ThreadCount; ThreadIndex += 1) {
+        if (SortTestRun(SortCommand,
+                        Options,
+                        SortTestBufferSizes[0],
+                        SortTestParallelThreadCounts[ThreadIndex],
+                        SORT_TEST_OUTPUT_FILE) != 0) {
+
+            PRINT_ERROR("sort %s --parallel=%d failed.\n",
+                        Options,
+                        SortTestParallelThreadCounts[ThreadIndex]);
+
+            Failures += 1;
+            continue;
+        }
+
+        if (SortTestCompareFiles(SORT_TEST_REFERENCE_FILE,
+                                 SORT_TEST_OUTPUT_FILE) != 0) {
+
+            PRINT_ERROR("sort %s --parallel=%d differs from --parallel=1.\n",
+                        Options,
+                        SortTestParallelThreadCounts[ThreadIndex]);
+
+            Failures += 1;
+        }
+    }
+
+    return Failures;
+}
+
+ULONG
+RunSortUniqueTest (
+    PSTR SortCommand
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sorts an input full of lines with equal keys with the unique
+    option across every combination of buffer size and thread count, and
+    verifies that each run keeps the first input line of each group of equal
+    keys.
+
+Arguments:
+
+    SortCommand - Supplies the command used to invoke the sort utility.
+
+Return Value:
+
+    Returns the number of failures in the test.
+
+--*/
+
+{
+
+    ULONG BufferCount;
+    ULONG BufferIndex;
+    ULONG Failures;
+    ULONG ThreadCount;
+    ULONG ThreadIndex;
+
+    DEBUG_PRINT("Testing sort %s keeps the first line\n",
+                SORT_TEST_UNIQUE_OPTIONS);
+
+    Failures = 0;
+    if (SortTestGenerateUniqueInput(SORT_TEST_INPUT_FILE,
+                                    SORT_TEST_REFERENCE_FILE,
+                                    SORT_TEST_PARALLEL_LINE_COUNT) != 0) {
+
+        PRINT_ERROR("Failed to generate sort input: %s.\n", strerror(errno));
+        return 1;
+    }
+
+    BufferCount = sizeof(SortTestBufferSizes) / sizeof(SortTestBufferSizes[0]);
+    ThreadCount = sizeof(SortTestThreadCounts) /
+                  sizeof(SortTestThreadCounts[0]);
+
+    for (BufferIndex = 0; BufferIndex < BufferCount; BufferIndex += 1) {
+        for (ThreadIndex = 0; ThreadIndex < ThreadCount; ThreadIndex += 1) {
+            if (SortTestRun(SortCommand,
+                            SORT_TEST_UNIQUE_OPTIONS,
+                            SortTestBufferSizes[BufferIndex],
+                            SortTestThreadCounts[ThreadIndex],
+                            SORT_TEST_OUTPUT_FILE) != 0) {
+
+                PRINT_ERROR("sort %s -S %s --parallel=%d failed.\n",
+                            SORT_TEST_UNIQUE_OPTIONS,
+                            SortTestBufferSizes[BufferIndex],
+                            SortTestThreadCounts[ThreadIndex]);
+
+                Failures += 1;
+                continue;
+            }
+
+            if (SortTestCompareFiles(SORT_TEST_REFERENCE_FILE,
+                                     SORT_TEST_OUTPUT_FILE) != 0) {
+
+                PRINT_ERROR("sort %s -S %s --parallel=%d didn't keep the "
+                            "first lines.\n",
+                            SORT_TEST_UNIQUE_OPTIONS,
+                            SortTestBufferSizes[BufferIndex],
+                            SortTestThreadCounts[ThreadIndex]);
+
+                Failures += 1;
+            }
+        }
+    }
+
+    return Failures;
+}
+
+INT
+SortTestGenerateInput (
+    PSTR Path,
+    ULONG LineCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine writes out a sort input file full of lines that tie on their
+    keys but differ in their contents.
+
+Arguments:
+
+    Path - Supplies the path of the file to create.
+
+    LineCount - Supplies the number of lines to write.
+
+Return Value:
+
+    0 on success.
+
+    -1 on failure, and errno will be set to contain more information.
+
+--*/
+
+{
+
+    FILE *File;
+    ULONG LineIndex;
+    INT Status;
+    ULONG WordCount;
+
+    File = fopen(Path, "w");
+    if (File == NULL) {
+        return -1;
+    }
+
+    Status = 0;
+    WordCount = sizeof(SortTestWords) / sizeof(SortTestWords[0]);
+    for (LineIndex = 0; LineIndex < LineCount; LineIndex += 1) {
+        if (fprintf(File,
+                    "%d %s %x\n",
+                    SortTestRandom() % SORT_TEST_KEY_COUNT,
+                    SortTestWords[SortTestRandom() % WordCount],
+                    SortTestRandom() % 0x1000) < 0) {
+
+            Status = -1;
+            break;
+        }
+    }
+
+    if (fclose(File) != 0) {
+        Status = -1;
+    }
+
+    return Status;
+}
+
+INT
+SortTestGenerateUniqueInput (
+    PSTR Path,
+    PSTR ReferencePath,
+    ULONG LineCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine writes out a sort input file whose lines share a handful of
+    keys but are otherwise all different, along with the output expected from
+    sorting it with the unique option: the first line with each key, in key
+    order.
+
+Arguments:
+
+    Path - Supplies the path of the input file to create.
+
+    ReferencePath - Supplies the path of the expected output file to create.
+
+    LineCount - Supplies the number of lines to write.
+
+Return Value:
+
+    0 on success.
+
+    -1 on failure, and errno will be set to contain more information.
+
+--*/
+
+{
+
+    FILE *File;
+    ULONG FirstLine[SORT_TEST_KEY_COUNT];
+    ULONG Key;
+    ULONG LineIndex;
+    INT Status;
+
+    File = fopen(Path, "w");
+    if (File == NULL) {
+        return -1;
+    }
+
+    Status = 0;
+    for (Key = 0; Key < SORT_TEST_KEY_COUNT; Key += 1) {
+        FirstLine[Key] = LineCount;
+    }
+
+    for (LineIndex = 0; LineIndex < LineCount; LineIndex += 1) {
+        Key = SortTestRandom() % SORT_TEST_KEY_COUNT;
+        if (FirstLine[Key] == LineCount) {
+            FirstLine[Key] = LineIndex;
+        }
+
+        if (fprintf(File, "%d %d\n", Key, LineIndex) < 0) {
+            Status = -1;
+            break;
+        }
+    }
+
+    if (fclose(File) != 0) {
+        Status = -1;
+    }
+
+    if (Status != 0) {
+        return Status;
+    }
+
+    File = fopen(ReferencePath, "w");
+    if (File == NULL) {
+        return -1;
+    }
+
+    for (Key = 0; Key < SORT_TEST_KEY_COUNT; Key += 1) {
+        if (FirstLine[Key] == LineCount) {
+            continue;
+        }
+
+        if (fprintf(File, "%d %d\n", Key, FirstLine[Key]) < 0) {
+            Status = -1;
+            break;
+        }
+    }
+
+    if (fclose(File) != 0) {
+        Status = -1;
+    }
+
+    return Status;
+}
+
+INT
+SortTestRun (
+    PSTR SortCommand,
+    PSTR Options,
+    PSTR BufferSize,
+    ULONG ThreadCount,
+    PSTR OutputPath
+    )
+
+/*++
+
+Routine Description:
+
+    This routine runs the sort utility on the input file.
+
+Arguments:
+
+    SortCommand - Supplies the command used to invoke the sort utility.
+
+    Options - Supplies the key options to pass to sort.
+
+    BufferSize - Supplies the buffer size argument to pass to sort.
+
+    ThreadCount - Supplies the number of threads sort should use.
+
+    OutputPath - Supplies the path of the file to write the output to.
+
+Return Value:
+
+    Returns the exit status of the command.
+
+--*/
+
+{
+
+    CHAR Command[SORT_TEST_COMMAND_SIZE];
+
+    snprintf(Command,
+             sizeof(Command),
+             "%s %s -S %s --parallel=%d -o %s %s",
+             SortCommand,
+             Options,
+             BufferSize,
+             ThreadCount,
+             OutputPath,
+             SORT_TEST_INPUT_FILE);
+
+    return system(Command);
+}
+
+INT
+SortTestCompareFiles (
+    PSTR LeftPath,
+    PSTR RightPath
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines whether or not two files have the same contents.
+
+Arguments:
+
+    LeftPath - Supplies the path of the first file.
+
+    RightPath - Supplies the path of the second file.
+
+Return Value:
+
+    0 if the files are identical.
+
+    Non-zero if the files differ or could not be read.
+
+--*/
+
+{
+
+    INT LeftCharacter;
+    FILE *LeftFile;
+    INT RightCharacter;
+    FILE *RightFile;
+    INT Status;
+
+    Status = -1;
+    RightFile = NULL;
+    LeftFile = fopen(LeftPath, "r");
+    if (LeftFile == NULL) {
+        goto CompareFilesEnd;
+    }
+
+    RightFile = fopen(RightPath, "r");
+    if (RightFile == NULL) {
+        goto CompareFilesEnd;
+    }
+
+    while (TRUE) {
+        LeftCharacter = fgetc(LeftFile);
+        RightCharacter = fgetc(RightFile);
+        if (LeftCharacter != RightCharacter) {
+            goto CompareFilesEnd;
+        }
+
+        if (LeftCharacter == EOF) {
+            break;
+        }
+    }
+
+    Status = 0;
+
+CompareFilesEnd:
+    if (LeftFile != NULL) {
+        fclose(LeftFile);
+    }
+
+    if (RightFile != NULL) {
+        fclose(RightFile);
+    }
+
+    return Status;
+}
+
+ULONG
+SortTestRandom (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the next value from a simple linear congruential
+    generator. The C library's generator is not used so that the input is the
+    same on every system.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns a pseudo-random value between 0 and 0x7FFF.
+
+--*/
+
+{
+
+    SortTestRandomState = (SortTestRandomState * 1103515245) + 12345;
+    return (SortTestRandomState >> 16) & 0x7FFF;
+}
+
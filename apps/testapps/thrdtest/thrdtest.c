@@ -0,0 +1,898 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    thrdtest.c
+
+Abstract:
+
+    This module implements the tests used to verify that thread creation,
+    joining, and detaching hold up under stress, including when thread stacks
+    are recycled from the C library's stack cache.
+
+Author:
+
+    agent 18-Oct-2026
+
+Environment:
+
+    User Mode
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <minoca/lib/minocaos.h>
+#include <assert.h>
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+//
+// --------------------------------------------------------------------- Macros
+//
+
+#define DEBUG_PRINT(...)                                  \
+    if (ThreadTestVerbosity >= TestVerbosityDebug) {      \
+        printf(__VA_ARGS__);                              \
+    }
+
+#define PRINT(...)                                        \
+    if (ThreadTestVerbosity >= TestVerbosityNormal) {     \
+        printf(__VA_ARGS__);                              \
+    }
+
+#define PRINT_ERROR(...) fprintf(stderr, "thrdtest: " __VA_ARGS__)
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+#define THREAD_TEST_VERSION_MAJOR 1
+#define THREAD_TEST_VERSION_MINOR 0
+
+#define THREAD_TEST_USAGE                                                      \
+    "Usage: thrdtest [options] \n"                                             \
+    "This utility hammers on thread creation and destruction. Options are:\n"  \
+    "  -i, --iterations <count> -- Set the number of operations to perform.\n" \
+    "  -p, --threads <count> -- Set the number of threads to run at once.\n"   \
+    "  -t, --test -- Set the test to perform. Valid values are all, \n"        \
+    "      join, detach, and stack.\n"                                         \
+    "  --debug -- Print lots of information about what's happening.\n"         \
+    "  --quiet -- Print only errors.\n"                                        \
+    "  --help -- Print this help text and exit.\n"                             \
+    "  --version -- Print the test version and exit.\n"                        \
+
+#define THREAD_TEST_OPTIONS_STRING "i:p:t:"
+
+#define DEFAULT_OPERATION_COUNT 200
+#define DEFAULT_THREAD_COUNT 8
+
+//
+// Define the number of bytes of stack each test thread scribbles on and then
+// checks.
+//
+
+#define THREAD_TEST_STACK_PATTERN_SIZE 4096
+
+//
+// Define how long to wait for detached threads before giving up.
+//
+
+#define THREAD_TEST_DETACH_TIMEOUT 30
+
+//
+// Define the size of the stack supplied by the stack test.
+//
+
+#define THREAD_TEST_SUPPLIED_STACK_SIZE (256 * 1024)
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+typedef enum _TEST_VERBOSITY {
+    TestVerbosityQuiet,
+    TestVerbosityNormal,
+    TestVerbosityDebug
+} TEST_VERBOSITY, *PTEST_VERBOSITY;
+
+typedef enum _THREAD_TEST_TYPE {
+    ThreadTestAll,
+    ThreadTestJoin,
+    ThreadTestDetach,
+    ThreadTestStack,
+} THREAD_TEST_TYPE, *PTHREAD_TEST_TYPE;
+
+/*++
+
+Structure Description:
+
+    This structure describes the work handed to one test thread.
+
+Members:
+
+    Identifier - Stores a value unique to this thread within its batch.
+
+    StackAddress - Stores the address of a local variable of the thread,
+        filled in by the thread.
+
+    Failures - Stores the number of failures the thread saw.
+
+--*/
+
+typedef struct _THREAD_TEST_WORK {
+    UINTN Identifier;
+    PVOID StackAddress;
+    ULONG Failures;
+} THREAD_TEST_WORK, *PTHREAD_TEST_WORK;
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+ULONG
+RunJoinTest (
+    ULONG Iterations,
+    ULONG ThreadCount
+    );
+
+ULONG
+RunDetachTest (
+    ULONG Iterations,
+    ULONG ThreadCount
+    );
+
+ULONG
+RunStackTest (
+    ULONG Iterations
+    );
+
+PVOID
+TestThreadWork (
+    PVOID Parameter
+    );
+
+PVOID
+TestThreadDetachedWork (
+    PVOID Parameter
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// Higher levels here print out more stuff.
+//
+
+TEST_VERBOSITY ThreadTestVerbosity = TestVerbosityNormal;
+
+struct option ThreadTestLongOptions[] = {
+    {"iterations", required_argument, 0, 'i'},
+    {"threads", required_argument, 0, 'p'},
+    {"test", required_argument, 0, 't'},
+    {"debug", no_argument, 0, 'd'},
+    {"quiet", no_argument, 0, 'q'},
+    {"help", no_argument, 0, 'h'},
+    {"version", no_argument, 0, 'V'},
+    {NULL, 0, 0, 0},
+};
+
+//
+// Store the key each test thread sets. A recycled stack carries the key
+// data with it, so a new thread must never see a stale value.
+//
+
+pthread_key_t ThreadTestKey;
+
+//
+// Store the state shared with detached threads, which nobody joins.
+//
+
+pthread_mutex_t ThreadTestDetachMutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t ThreadTestDetachCondition = PTHREAD_COND_INITIALIZER;
+ULONG ThreadTestDetachedDone;
+ULONG ThreadTestDetachedFailures;
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+int
+main (
+    int ArgumentCount,
+    char **Arguments
+    )
+
+/*++
+
+Routine Description:
+
+    This routine implements the thread test program.
+
+Arguments:
+
+    ArgumentCount - Supplies the number of elements in the arguments array.
+
+    Arguments - Supplies an array of strings. The array count is bounded by the
+        previous parameter, and the strings are null-terminated.
+
+Return Value:
+
+    0 on success.
+
+    Non-zero on failure.
+
+--*/
+
+{
+
+    PSTR AfterScan;
+    INT Failures;
+    INT Iterations;
+    INT Option;
+    INT Status;
+    THREAD_TEST_TYPE Test;
+    INT Threads;
+
+    Failures = 0;
+    Iterations = DEFAULT_OPERATION_COUNT;
+    Test = ThreadTestAll;
+    Threads = DEFAULT_THREAD_COUNT;
+    Status = 0;
+    setvbuf(stdout, NULL, _IONBF, 0);
+    setvbuf(stderr, NULL, _IONBF, 0);
+
+    //
+    // Process the control arguments.
+    //
+
+    while (TRUE) {
+        Option = getopt_long(ArgumentCount,
+                             Arguments,
+                             THREAD_TEST_OPTIONS_STRING,
+                             ThreadTestLongOptions,
+                             NULL);
+
+        if (Option == -1) {
+            break;
+        }
+
+        if ((Option == '?') || (Option == ':')) {
+            Status = 1;
+            goto MainEnd;
+        }
+
+        switch (Option) {
+        case 'i':
+            Iterations = strtol(optarg, &AfterScan, 0);
+            if ((Iterations < 0) || (AfterScan == optarg)) {
+                PRINT_ERROR("Invalid iteration count %s.\n", optarg);
+                Status = 1;
+                goto MainEnd;
+            }
+
+            break;
+
+        case 'p':
+            Threads = strtol(optarg, &AfterScan, 0);
+            if ((Threads <= 0) || (AfterScan == optarg)) {
+                PRINT_ERROR("Invalid thread count %s.\n", optarg);
+                Status = 1;
+                goto MainEnd;
+            }
+
+            break;
+
+        case 't':
+            if (strcasecmp(optarg, "all") == 0) {
+                Test = ThreadTestAll;
+
+            } else if (strcasecmp(optarg, "join") == 0) {
+                Test = ThreadTestJoin;
+
+            } else if (strcasecmp(optarg, "detach") == 0) {
+                Test = ThreadTestDetach;
+
+            } else if (strcasecmp(optarg, "stack") == 0) {
+                Test = ThreadTestStack;
+
+            } else {
+                PRINT_ERROR("Invalid test: %s.\n", optarg);
+                Status = 1;
+                goto MainEnd;
+            }
+
+            break;
+
+        case 'd':
+            ThreadTestVerbosity = TestVerbosityDebug;
+            break;
+
+        case 'q':
+            ThreadTestVerbosity = TestVerbosityQuiet;
+            break;
+
+        case 'V':
+            printf("Minoca thread test version %d.%d\n",
+                   THREAD_TEST_VERSION_MAJOR,
+                   THREAD_TEST_VERSION_MINOR);
+
+            return 1;
+
+        case 'h':
+            printf(THREAD_TEST_USAGE);
+            return 1;
+
+        default:
+
+            assert(FALSE);
+
+            Status = 1;
+            goto MainEnd;
+        }
+    }
+
+    Status = pthread_key_create(&ThreadTestKey, NULL);
+    if (Status != 0) {
+        PRINT_ERROR("Failed to create key: %s.\n", strerror(Status));
+        goto MainEnd;
+    }
+
+    //
+    // Run the tests.
+    //
+
+    if ((Test == ThreadTestAll) || (Test == ThreadTestJoin)) {
+        Failures += RunJoinTest(Iterations, Threads);
+    }
+
+    if ((Test == ThreadTestAll) || (Test == ThreadTestDetach)) {
+        Failures += RunDetachTest(Iterations, Threads);
+    }
+
+    if ((Test == ThreadTestAll) || (Test == ThreadTestStack)) {
+        Failures += RunStackTest(Iterations);
+    }
+
+    pthread_key_delete(ThreadTestKey);
+
+MainEnd:
+    if (Status != 0) {
+        PRINT_ERROR("Error: %d.\n", Status);
+    }
+
+    if (Failures != 0) {
+        PRINT_ERROR("\n   *** %d failures in thread test ***\n", Failures);
+        return Failures;
+    }
+
+    return Status;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+ULONG
+RunJoinTest (
+    ULONG Iterations,
+    ULONG ThreadCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine runs the join test, which creates batches of threads with
+    assorted stack sizes, joins them, and checks their results.
+
+Arguments:
+
+    Iterations - Supplies the number of times to run the test.
+
+    ThreadCount - Supplies the number of threads to run at once.
+
+Return Value:
+
+    Returns the number of failures in the test.
+
+--*/
+
+{
+
+    pthread_attr_t Attribute;
+    ULONG Failures;
+    ULONG Iteration;
+    ULONG OtherIndex;
+    ULONG Percent;
+    PVOID ReturnValue;
+    int Status;
+    size_t StackSize;
+    ULONG ThreadIndex;
+    pthread_t *Threads;
+    PTHREAD_TEST_WORK Work;
+
+    Failures = 0;
+    PRINT("Running join test with %d iterations and %d threads.\n",
+          Iterations,
+          ThreadCount);
+
+    Percent = Iterations / 100;
+    if (Percent == 0) {
+        Percent = 1;
+    }
+
+    Threads = calloc(ThreadCount, sizeof(pthread_t));
+    Work = calloc(ThreadCount, sizeof(THREAD_TEST_WORK));
+    if ((Threads == NULL) || (Work == NULL)) {
+        Failures += 1;
+        goto RunJoinTestEnd;
+    }
+
+    for (Iteration = 0; Iteration < Iterations; Iteration += 1) {
+
+        //
+        // Mix a few stack sizes so that some creations hit the stack cache
+        // and some miss it.
+        //
+
+        pthread_attr_init(&Attribute);
+        StackSize = (64 * 1024) << (Iteration % 3);
+        pthread_attr_setstacksize(&Attribute, StackSize);
+        for (ThreadIndex = 0; ThreadIndex < ThreadCount; ThreadIndex += 1) {
+            Work[ThreadIndex].Identifier = (Iteration << 8) | ThreadIndex;
+            Work[ThreadIndex].StackAddress = NULL;
+            Work[ThreadIndex].Failures = 0;
+            Status = pthread_create(&(Threads[ThreadIndex]),
+                                    &Attribute,
+                                    TestThreadWork,
+                                    &(Work[ThreadIndex]));
+
+            if (Status != 0) {
+                PRINT_ERROR("Failed to create thread: %s.\n",
+                            strerror(Status));
+
+                Failures += 1;
+                Threads[ThreadIndex] = 0;
+            }
+        }
+
+        pthread_attr_destroy(&Attribute);
+
+        //
+        // Join the threads backwards, for added flavor.
+        //
+
+        ThreadIndex = ThreadCount;
+        while (ThreadIndex != 0) {
+            ThreadIndex -= 1;
+            if (Threads[ThreadIndex] == 0) {
+                continue;
+            }
+
+            Status = pthread_join(Threads[ThreadIndex], &ReturnValue);
+            if (Status != 0) {
+                PRINT_ERROR("Failed to join thread: %s.\n", strerror(Status));
+                Failures += 1;
+                continue;
+            }
+
+            if (ReturnValue != (PVOID)(Work[ThreadIndex].Identifier)) {
+                PRINT_ERROR("Thread %x returned %p.\n",
+                            (UINT)(Work[ThreadIndex].Identifier),
+                            ReturnValue);
+
+                Failures += 1;
+            }
+
+            Failures += Work[ThreadIndex].Failures;
+        }
+
+        //
+        // Threads that were alive at the same time must not have shared a
+        // stack.
+        //
+
+        for (ThreadIndex = 0; ThreadIndex < ThreadCount; ThreadIndex += 1) {
+            for (OtherIndex = ThreadIndex + 1;
+                 OtherIndex < ThreadCount;
+                 OtherIndex += 1) {
+
+                if ((Work[ThreadIndex].StackAddress != NULL) &&
+                    (Work[ThreadIndex].StackAddress ==
+                     Work[OtherIndex].StackAddress)) {
+
+                    PRINT_ERROR("Threads %d and %d shared a stack at %p.\n",
+                                ThreadIndex,
+                                OtherIndex,
+                                Work[ThreadIndex].StackAddress);
+
+                    Failures += 1;
+                }
+            }
+        }
+
+        if ((Iteration % Percent) == 0) {
+            PRINT("j");
+        }
+    }
+
+    PRINT("\n");
+
+RunJoinTestEnd:
+    if (Threads != NULL) {
+        free(Threads);
+    }
+
+    if (Work != NULL) {
+        free(Work);
+    }
+
+    return Failures;
+}
+
+ULONG
+RunDetachTest (
+    ULONG Iterations,
+    ULONG ThreadCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine runs the detach test, which creates batches of detached
+    threads, half created detached and half detached afterwards. A detached
+    thread caches its own stack while still running on it, so creating new
+    threads while old ones are exiting is exactly the case to hammer on.
+
+Arguments:
+
+    Iterations - Supplies the number of times to run the test.
+
+    ThreadCount - Supplies the number of threads to run at once.
+
+Return Value:
+
+    Returns the number of failures in the test.
+
+--*/
+
+{
+
+    pthread_attr_t Attribute;
+    ULONG Created;
+    struct timespec Deadline;
+    ULONG Failures;
+    ULONG Iteration;
+    ULONG Percent;
+    int Status;
+    pthread_t Thread;
+    ULONG ThreadIndex;
+
+    Failures = 0;
+    PRINT("Running detach test with %d iterations and %d threads.\n",
+          Iterations,
+          ThreadCount);
+
+    Percent = Iterations / 100;
+    if (Percent == 0) {
+        Percent = 1;
+    }
+
+    ThreadTestDetachedDone = 0;
+    ThreadTestDetachedFailures = 0;
+    Created = 0;
+    pthread_attr_init(&Attribute);
+    pthread_attr_setdetachstate(&Attribute, PTHREAD_CREATE_DETACHED);
+    for (Iteration = 0; Iteration < Iterations; Iteration += 1) {
+        for (ThreadIndex = 0; ThreadIndex < ThreadCount; ThreadIndex += 1) {
+            if ((ThreadIndex & 0x1) == 0) {
+                Status = pthread_create(&Thread,
+                                        &Attribute,
+                                        TestThreadDetachedWork,
+                                        (PVOID)(UINTN)ThreadIndex);
+
+            } else {
+                Status = pthread_create(&Thread,
+                                        NULL,
+                                        TestThreadDetachedWork,
+                                        (PVOID)(UINTN)ThreadIndex);
+
+                if (Status == 0) {
+                    Status = pthread_detach(Thread);
+                    if (Status != 0) {
+                        PRINT_ERROR("Failed to detach thread: %s.\n",
+                                    strerror(Status));
+
+                        Failures += 1;
+                        Status = 0;
+                    }
+                }
+            }
+
+            if (Status != 0) {
+                PRINT_ERROR("Failed to create thread: %s.\n",
+                            strerror(Status));
+
+                Failures += 1;
+                continue;
+            }
+
+            Created += 1;
+        }
+
+        if ((Iteration % Percent) == 0) {
+            PRINT("d");
+        }
+    }
+
+    pthread_attr_destroy(&Attribute);
+    PRINT("\n");
+
+    //
+    // Nobody can join detached threads, so wait for them all to check in.
+    //
+
+    clock_gettime(CLOCK_REALTIME, &Deadline);
+    Deadline.tv_sec += THREAD_TEST_DETACH_TIMEOUT;
+    pthread_mutex_lock(&ThreadTestDetachMutex);
+    while (ThreadTestDetachedDone != Created) {
+        Status = pthread_cond_timedwait(&ThreadTestDetachCondition,
+                                        &ThreadTestDetachMutex,
+                                        &Deadline);
+
+        if (Status == ETIMEDOUT) {
+            PRINT_ERROR("Only %d of %d detached threads finished.\n",
+                        ThreadTestDetachedDone,
+                        Created);
+
+            Failures += 1;
+            break;
+        }
+    }
+
+    Failures += ThreadTestDetachedFailures;
+    pthread_mutex_unlock(&ThreadTestDetachMutex);
+    return Failures;
+}
+
+ULONG
+RunStackTest (
+    ULONG Iterations
+    )
+
+/*++
+
+Routine Description:
+
+    This routine runs the stack test, which creates threads on stacks
+    supplied by the caller. The thread must run on the supplied stack, and
+    the stack must still be usable after the thread is gone, since only the
+    caller may free it.
+
+Arguments:
+
+    Iterations - Supplies the number of times to run the test.
+
+Return Value:
+
+    Returns the number of failures in the test.
+
+--*/
+
+{
+
+    pthread_attr_t Attribute;
+    ULONG Failures;
+    ULONG Iteration;
+    ULONG Percent;
+    PVOID ReturnValue;
+    PUCHAR Stack;
+    int Status;
+    pthread_t Thread;
+    THREAD_TEST_WORK Work;
+
+    Failures = 0;
+    PRINT("Running stack test with %d iterations.\n", Iterations);
+    Percent = Iterations / 100;
+    if (Percent == 0) {
+        Percent = 1;
+    }
+
+    Stack = mmap(NULL,
+                 THREAD_TEST_SUPPLIED_STACK_SIZE,
+                 PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS,
+                 -1,
+                 0);
+
+    if (Stack == MAP_FAILED) {
+        PRINT_ERROR("Failed to map stack: %s.\n", strerror(errno));
+        return 1;
+    }
+
+    for (Iteration = 0; Iteration < Iterations; Iteration += 1) {
+        pthread_attr_init(&Attribute);
+        pthread_attr_setstack(&Attribute,
+                              Stack,
+                              THREAD_TEST_SUPPLIED_STACK_SIZE);
+
+        Work.Identifier = Iteration;
+        Work.StackAddress = NULL;
+        Work.Failures = 0;
+        Status = pthread_create(&Thread, &Attribute, TestThreadWork, &Work);
+        pthread_attr_destroy(&Attribute);
+        if (Status != 0) {
+            PRINT_ERROR("Failed to create thread: %s.\n", strerror(Status));
+            Failures += 1;
+            continue;
+        }
+
+        Status = pthread_join(Thread, &ReturnValue);
+        if (Status != 0) {
+            PRINT_ERROR("Failed to join thread: %s.\n", strerror(Status));
+            Failures += 1;
+            continue;
+        }
+
+        Failures += Work.Failures;
+        if (ReturnValue != (PVOID)(Work.Identifier)) {
+            PRINT_ERROR("Thread returned %p.\n", ReturnValue);
+            Failures += 1;
+        }
+
+        if (((PUCHAR)(Work.StackAddress) < Stack) ||
+            ((PUCHAR)(Work.StackAddress) >=
+             Stack + THREAD_TEST_SUPPLIED_STACK_SIZE)) {
+
+            PRINT_ERROR("Thread ran at %p, outside supplied stack %p.\n",
+                        Work.StackAddress,
+                        Stack);
+
+            Failures += 1;
+        }
+
+        //
+        // The supplied stack belongs to this routine, and must not have been
+        // unmapped when the thread exited.
+        //
+
+        memset(Stack, Iteration & 0xFF, THREAD_TEST_SUPPLIED_STACK_SIZE);
+        if ((Iteration % Percent) == 0) {
+            PRINT("s");
+        }
+    }
+
+    PRINT("\n");
+    munmap(Stack, THREAD_TEST_SUPPLIED_STACK_SIZE);
+    return Failures;
+}
+
+PVOID
+TestThreadWork (
+    PVOID Parameter
+    )
+
+/*++
+
+Routine Description:
+
+    This routine implements the body of a joinable test thread. It makes sure
+    it starts with no key data, scribbles over a chunk of its stack, yields,
+    and makes sure nobody else scribbled over it.
+
+Arguments:
+
+    Parameter - Supplies a pointer to the thread's work structure.
+
+Return Value:
+
+    Returns the work identifier.
+
+--*/
+
+{
+
+    ULONG Index;
+    UCHAR Pattern[THREAD_TEST_STACK_PATTERN_SIZE];
+    UCHAR Value;
+    PTHREAD_TEST_WORK Work;
+
+    Work = Parameter;
+    Work->StackAddress = Pattern;
+    if (pthread_getspecific(ThreadTestKey) != NULL) {
+        PRINT_ERROR("New thread %x inherited key data %p.\n",
+                    (UINT)(Work->Identifier),
+                    pthread_getspecific(ThreadTestKey));
+
+        Work->Failures += 1;
+    }
+
+    pthread_setspecific(ThreadTestKey, Work);
+    Value = (UCHAR)(Work->Identifier);
+    memset(Pattern, Value, sizeof(Pattern));
+    sched_yield();
+    for (Index = 0; Index < sizeof(Pattern); Index += 1) {
+        if (Pattern[Index] != Value) {
+            PRINT_ERROR("Thread %x stack corrupted at %p.\n",
+                        (UINT)(Work->Identifier),
+                        &(Pattern[Index]));
+
+            Work->Failures += 1;
+            break;
+        }
+    }
+
+    if (pthread_getspecific(ThreadTestKey) != Work) {
+        PRINT_ERROR("Thread %x lost its key data.\n", (UINT)(Work->Identifier));
+        Work->Failures += 1;
+    }
+
+    DEBUG_PRINT("Thread %x ran at %p\n", (UINT)(Work->Identifier), Pattern);
+    return (PVOID)(Work->Identifier);
+}
+
+PVOID
+TestThreadDetachedWork (
+    PVOID Parameter
+    )
+
+/*++
+
+Routine Description:
+
+    This routine implements the body of a detached test thread. It does the
+    same stack and key checks as a joinable thread, and reports to the shared
+    counters when it is done.
+
+Arguments:
+
+    Parameter - Supplies the thread index.
+
+Return Value:
+
+    NULL always.
+
+--*/
+
+{
+
+    THREAD_TEST_WORK Work;
+
+    Work.Identifier = (UINTN)Parameter;
+    Work.StackAddress = NULL;
+    Work.Failures = 0;
+    TestThreadWork(&Work);
+    pthread_mutex_lock(&ThreadTestDetachMutex);
+    ThreadTestDetachedDone += 1;
+    ThreadTestDetachedFailures += Work.Failures;
+    pthread_cond_signal(&ThreadTestDetachCondition);
+    pthread_mutex_unlock(&ThreadTestDetachMutex);
+
+    //
+    // The key data points at this stack, which is about to go away.
+    //
+
+    pthread_setspecific(ThreadTestKey, NULL);
+    return NULL;
+}
+
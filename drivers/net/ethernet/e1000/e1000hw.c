@@ -2697,7 +2697,9 @@ Return Value:
     ULONG Flags;
     ULONG NewTail;
     PNET_PACKET_BUFFER Packet;
+    NET_PACKET_LIST PacketList;
 
+    NET_INITIALIZE_PACKET_LIST(&PacketList);
     KeAcquireQueuedLock(Device->RxListLock);
     DescriptorIndex = Device->RxListBegin;
     Descriptor = &(Device->RxDescriptors[DescriptorIndex]);
@@ -2761,7 +2763,7 @@ Return Value:
         }
 
         Packet->Flags = Flags;
-        NetProcessReceivedPacket(Device->NetworkLink, Packet);
+        NET_ADD_PACKET_TO_LIST(Packet, &PacketList);
         Descriptor->Status = 0;
         DescriptorIndex += 1;
         if (DescriptorIndex == E1000_RX_RING_SIZE) {
@@ -2771,6 +2773,16 @@ Return Value:
         Descriptor = &(Device->RxDescriptors[DescriptorIndex]);
     }
 
+    //
+    // Hand the frames up as one batch so that the networking core can
+    // coalesce segments from the same flow. The descriptors are not given
+    // back to the hardware until the tail is written below.
+    //
+
+    if (NET_PACKET_LIST_EMPTY(&PacketList) == FALSE) {
+        NetProcessReceivedPackets(Device->NetworkLink, &PacketList);
+    }
+
     //
     // Write the new tail if there is one.
     //
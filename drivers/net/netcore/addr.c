@@ -354,23 +354,27 @@ Return Value:
 
     //
     // All network devices respond to the network device information requests.
+    // Software links, like loopback, have no device behind them.
     //
 
-    Status = IoRegisterDeviceInformation(Link->Properties.Device,
-                                         &NetNetworkDeviceInformationUuid,
-                                         TRUE);
+    if (Link->Properties.Device != NULL) {
+        Status = IoRegisterDeviceInformation(Link->Properties.Device,
+                                             &NetNetworkDeviceInformationUuid,
+                                             TRUE);
 
-    if (!KSUCCESS(Status)) {
-        goto AddLinkEnd;
-    }
+        if (!KSUCCESS(Status)) {
+            goto AddLinkEnd;
+        }
 
-    //
-    // With success a sure thing, take a reference on the OS device that
-    // registered the link with netcore. Its device context and driver need to
-    // remain available as long as netcore can access the device link interface.
-    //
+        //
+        // With success a sure thing, take a reference on the OS device that
+        // registered the link with netcore. Its device context and driver
+        // need to remain available as long as netcore can access the device
+        // link interface.
+        //
 
-    IoDeviceAddReference(Link->Properties.Device);
+        IoDeviceAddReference(Link->Properties.Device);
+    }
 
     //
     // Add the link to the global list. It is all ready to send and receive
@@ -388,9 +392,11 @@ Return Value:
 AddLinkEnd:
     if (!KSUCCESS(Status)) {
         if (Link != NULL) {
-            IoRegisterDeviceInformation(Link->Properties.Device,
-                                        &NetNetworkDeviceInformationUuid,
-                                        FALSE);
+            if (Link->Properties.Device != NULL) {
+                IoRegisterDeviceInformation(Link->Properties.Device,
+                                            &NetNetworkDeviceInformationUuid,
+                                            FALSE);
+            }
 
             //
             // If some network layer entries have initialized already, call
@@ -614,6 +620,16 @@ Return Value:
                                          ListEntry);
 
                 CurrentEntry = CurrentEntry->Next;
+
+                //
+                // Statically configured addresses, like the loopback
+                // address, are already usable and need no assignment.
+                //
+
+                if (LinkAddress->State == NetLinkAddressConfiguredStatic) {
+                    continue;
+                }
+
                 Network = LinkAddress->Network;
                 Network->Interface.ConfigureLinkAddress(Link,
                                                         LinkAddress,
@@ -850,9 +866,11 @@ Return Value:
     // information requests.
     //
 
-    IoRegisterDeviceInformation(Link->Properties.Device,
-                                &NetNetworkDeviceInformationUuid,
-                                FALSE);
+    if (Link->Properties.Device != NULL) {
+        IoRegisterDeviceInformation(Link->Properties.Device,
+                                    &NetNetworkDeviceInformationUuid,
+                                    FALSE);
+    }
 
     //
     // If the link is still up, then send out the notice that is is actually
@@ -1040,12 +1058,15 @@ Return Value:
     PNET_LINK Link;
     PNET_LINK_ADDRESS_ENTRY LinkAddress;
     PLIST_ENTRY LinkAddressList;
+    BOOL LoopbackAddress;
+    BOOL LoopbackLink;
     KSTATUS Status;
 
     ASSERT(KeGetRunLevel() == RunLevelLow);
     ASSERT(RemoteAddress->Domain < NetDomainSocketNetworkCount);
 
     Domain = RemoteAddress->Domain;
+    LoopbackAddress = NetpIsLoopbackAddress(RemoteAddress);
     KeAcquireSharedExclusiveLockShared(NetLinkListLock);
     if (LIST_EMPTY(&NetLinkList)) {
         Status = STATUS_NO_NETWORK_CONNECTION;
@@ -1067,6 +1088,22 @@ Return Value:
             continue;
         }
 
+        //
+        // Loopback addresses are only reachable over the loopback link, and
+        // the loopback link reaches nothing else.
+        //
+
+        LoopbackLink = FALSE;
+        if ((Link->Properties.Capabilities &
+             NET_LINK_CAPABILITY_LOOPBACK) != 0) {
+
+            LoopbackLink = TRUE;
+        }
+
+        if (LoopbackLink != LoopbackAddress) {
+            continue;
+        }
+
         //
         // If the domain's link address list is empty, try another link.
         //
@@ -3791,7 +3828,10 @@ Return Value:
     KeReleaseSharedExclusiveLockShared(NetPluginListLock);
     Link->DataLinkEntry->Interface.DestroyLink(Link);
     Link->Properties.Interface.DestroyLink(Link->Properties.DeviceContext);
-    IoDeviceReleaseReference(Link->Properties.Device);
+    if (Link->Properties.Device != NULL) {
+        IoDeviceReleaseReference(Link->Properties.Device);
+    }
+
     MmFreePagedPool(Link);
     return;
 }
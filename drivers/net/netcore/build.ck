@@ -47,13 +47,16 @@ function build() {
         "ipv6/ip6.c",
         "ipv6/mld.c",
         "ipv6/ndp.c",
+        "loopback.c",
         "mcast.c",
         "netcore.c",
         "netlink/netlink.c",
         "netlink/genctrl.c",
         "netlink/generic.c",
+        "offload.c",
         "raw.c",
         "tcp.c",
+        "tcpbuf.c",
         "tcpcong.c",
         "udp.c"
     ];
@@ -1036,6 +1036,7 @@ Return Value:
     PNET_LINK Link;
     PNET_LINK_ADDRESS_ENTRY LinkAddress;
     PIP4_ADDRESS LocalAddress;
+    BOOL Loopback;
     ULONG MaxFragmentLength;
     ULONG MaxPacketSize;
     PNET_SOCKET_LINK_OVERRIDE MulticastInterface;
@@ -1044,6 +1045,7 @@ Return Value:
     ULONG PacketFlags;
     PNETWORK_ADDRESS PhysicalNetworkAddress;
     NETWORK_ADDRESS PhysicalNetworkAddressBuffer;
+    PLIST_ENTRY PreviousEntry;
     NET_RECEIVE_CONTEXT ReceiveContext;
     PIP4_ADDRESS RemoteAddress;
     PNET_DATA_LINK_SEND Send;
@@ -1107,6 +1109,19 @@ Return Value:
 
     ASSERT((Link != NULL) && (LinkAddress != NULL));
 
+    //
+    // Traffic over the loopback link or to this link's own address never
+    // leaves the machine. It needs no physical address and is handed straight
+    // back to the receive path once the headers are on.
+    //
+
+    Loopback = FALSE;
+    if (((Link->Properties.Capabilities & NET_LINK_CAPABILITY_LOOPBACK) != 0) ||
+        (RemoteAddress->Address == LocalAddress->Address)) {
+
+        Loopback = TRUE;
+    }
+
     //
     // Figure out the physical network address for the given IP destination
     // address. This answer is the same for every packet. Use the cached
@@ -1120,7 +1135,9 @@ Return Value:
         PhysicalNetworkAddress = &PhysicalNetworkAddressBuffer;
     }
 
-    if (PhysicalNetworkAddress->Domain == NetDomainInvalid) {
+    if ((Loopback == FALSE) &&
+        (PhysicalNetworkAddress->Domain == NetDomainInvalid)) {
+
         Status = NetpIp4TranslateNetworkAddress(Socket,
                                                 Destination,
                                                 Link,
@@ -1143,14 +1160,45 @@ Return Value:
         Packet = LIST_VALUE(CurrentEntry, NET_PACKET_BUFFER, ListEntry);
         CurrentEntry = CurrentEntry->Next;
 
+        //
+        // Segmentation offload packets are allowed to exceed the maximum
+        // packet size. If the link cannot split them up in hardware, split
+        // them here and let the loop pick up the individual segments.
+        //
+
+        if ((Packet->Flags & NET_PACKET_FLAG_SEGMENTATION_OFFLOAD) != 0) {
+            if ((Link->Properties.Capabilities &
+                 NET_LINK_CAPABILITY_TRANSMIT_TCP_SEGMENTATION_OFFLOAD) == 0) {
+
+                PreviousEntry = Packet->ListEntry.Previous;
+                Status = NetSegmentPacket(Link,
+                                          Socket->Network,
+                                          Source,
+                                          Destination,
+                                          Packet,
+                                          PacketList);
+
+                if (!KSUCCESS(Status)) {
+                    goto Ip4SendEnd;
+                }
+
+                CurrentEntry = PreviousEntry->Next;
+                continue;
+            }
+
+            RtlAtomicAdd64(
+                        &(Link->OffloadStatistics.SegmentationHardwarePackets),
+                        1);
+
         //
         // If the socket is supposed to include the IP header in its
         // packets, but this packet is too large, then fail without sending any
         // packets.
         //
 
-        if ((Packet->DataSize > MaxPacketSize) &&
-            ((Socket->Flags & NET_SOCKET_FLAG_NETWORK_HEADER_INCLUDED) != 0)) {
+        } else if ((Packet->DataSize > MaxPacketSize) &&
+                   ((Socket->Flags &
+                     NET_SOCKET_FLAG_NETWORK_HEADER_INCLUDED) != 0)) {
 
             Status = STATUS_MESSAGE_TOO_LONG;
             goto Ip4SendEnd;
@@ -1418,6 +1466,16 @@ Return Value:
         }
     }
 
+    //
+    // Local traffic skips the data link layer entirely. The loopback path
+    // takes ownership of the packets on success.
+    //
+
+    if (Loopback != FALSE) {
+        Status = NetLoopbackPackets(Link, Socket->Network, PacketList);
+        goto Ip4SendEnd;
+    }
+
     //
     // The packets are all ready to go, send them down the link.
     //
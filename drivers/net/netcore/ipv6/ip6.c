@@ -901,6 +901,7 @@ Return Value:
     ULONG PacketFlags;
     PNETWORK_ADDRESS PhysicalNetworkAddress;
     NETWORK_ADDRESS PhysicalNetworkAddressBuffer;
+    PLIST_ENTRY PreviousEntry;
     NET_RECEIVE_CONTEXT ReceiveContext;
     PIP6_ADDRESS RemoteAddress;
     PNET_DATA_LINK_SEND Send;
@@ -1000,14 +1001,45 @@ Return Value:
         Packet = LIST_VALUE(CurrentEntry, NET_PACKET_BUFFER, ListEntry);
         CurrentEntry = CurrentEntry->Next;
 
+        //
+        // Segmentation offload packets are allowed to exceed the maximum
+        // packet size. If the link cannot split them up in hardware, split
+        // them here and let the loop pick up the individual segments.
+        //
+
+        if ((Packet->Flags & NET_PACKET_FLAG_SEGMENTATION_OFFLOAD) != 0) {
+            if ((Link->Properties.Capabilities &
+                 NET_LINK_CAPABILITY_TRANSMIT_TCP_SEGMENTATION_OFFLOAD) == 0) {
+
+                PreviousEntry = Packet->ListEntry.Previous;
+                Status = NetSegmentPacket(Link,
+                                          Socket->Network,
+                                          Source,
+                                          Destination,
+                                          Packet,
+                                          PacketList);
+
+                if (!KSUCCESS(Status)) {
+                    goto Ip6SendEnd;
+                }
+
+                CurrentEntry = PreviousEntry->Next;
+                continue;
+            }
+
+            RtlAtomicAdd64(
+                        &(Link->OffloadStatistics.SegmentationHardwarePackets),
+                        1);
+
         //
         // If the socket is supposed to include the IP header in its
         // packets, but this packet is too large, then fail without sending any
         // packets.
         //
 
-        if ((Packet->DataSize > MaxPacketSize) &&
-            ((Socket->Flags & NET_SOCKET_FLAG_NETWORK_HEADER_INCLUDED) != 0)) {
+        } else if ((Packet->DataSize > MaxPacketSize) &&
+                   ((Socket->Flags &
+                     NET_SOCKET_FLAG_NETWORK_HEADER_INCLUDED) != 0)) {
 
             Status = STATUS_MESSAGE_TOO_LONG;
             goto Ip6SendEnd;
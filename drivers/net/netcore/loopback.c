@@ -0,0 +1,615 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    loopback.c
+
+Abstract:
+
+    This module implements the software loopback link and the in-kernel
+    delivery path for traffic that never needs to leave the machine. Packets
+    are handed straight back to the network layer's receive routine, marked as
+    having been checksum verified, without going through address translation
+    or a device.
+
+Author:
+
+    agent 18-Oct-2026
+
+Environment:
+
+    Kernel
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <minoca/kernel/driver.h>
+#include "netcore.h"
+#include <minoca/net/ip4.h>
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// Define the loopback link's address and subnet mask, in host order.
+//
+
+#define NET_LOOPBACK_IP4_ADDRESS 0x7F000001
+#define NET_LOOPBACK_IP4_SUBNET 0xFF000000
+
+//
+// Define the largest frame the loopback link accepts. The data link layer
+// still clamps sockets to its own limit, and TCP segmentation offload is what
+// actually produces large packets on this link.
+//
+
+#define NET_LOOPBACK_MAX_PACKET_SIZE 0x10000
+
+//
+// Define the speed reported for the loopback link. There is no wire, so this
+// is purely informational.
+//
+
+#define NET_LOOPBACK_LINK_SPEED (10ULL * NET_SPEED_1000_MBPS)
+
+//
+// Define the set of capabilities advertised by the loopback link. Nothing
+// ever touches a wire, so checksums never need to be computed, and TCP may
+// hand down segmentation offload packets that are delivered whole.
+//
+
+#define NET_LOOPBACK_CAPABILITIES                         \
+    (NET_LINK_CAPABILITY_CHECKSUM_MASK |                  \
+     NET_LINK_CAPABILITY_TRANSMIT_TCP_SEGMENTATION_OFFLOAD | \
+     NET_LINK_CAPABILITY_LOOPBACK)
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+/*++
+
+Structure Description:
+
+    This structure defines a batch of packets waiting to be delivered back up
+    the stack.
+
+Members:
+
+    ListEntry - Stores pointers to the next and previous batches in the
+        loopback queue.
+
+    Link - Stores a pointer to the link the packets are received on. A
+        reference is held on the link while the batch is queued.
+
+    Network - Stores an optional pointer to the network layer that should
+        receive the packets. If this is NULL, the packets carry a data link
+        header and go through the link's data link layer.
+
+    PacketList - Stores the list of packets in the batch.
+
+--*/
+
+typedef struct _NET_LOOPBACK_BATCH {
+    LIST_ENTRY ListEntry;
+    PNET_LINK Link;
+    PNET_NETWORK_ENTRY Network;
+    NET_PACKET_LIST PacketList;
+} NET_LOOPBACK_BATCH, *PNET_LOOPBACK_BATCH;
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+KSTATUS
+NetpLoopbackSend (
+    PVOID DeviceContext,
+    PNET_PACKET_LIST PacketList
+    );
+
+KSTATUS
+NetpLoopbackGetSetInformation (
+    PVOID DeviceContext,
+    NET_LINK_INFORMATION_TYPE InformationType,
+    PVOID Data,
+    PUINTN DataSize,
+    BOOL Set
+    );
+
+VOID
+NetpLoopbackDestroyLink (
+    PVOID DeviceContext
+    );
+
+VOID
+NetpLoopbackWorker (
+    PVOID Parameter
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// Store a pointer to the loopback link.
+//
+
+PNET_LINK NetLoopbackLink;
+
+//
+// Store the queue of batches waiting to be delivered, the lock protecting it,
+// and the work item that drains it.
+//
+
+LIST_ENTRY NetLoopbackQueue;
+PQUEUED_LOCK NetLoopbackLock;
+PWORK_ITEM NetLoopbackWorkItem;
+BOOL NetLoopbackWorkQueued;
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+NET_API
+KSTATUS
+NetLoopbackPackets (
+    PNET_LINK Link,
+    PNET_NETWORK_ENTRY Network,
+    PNET_PACKET_LIST PacketList
+    )
+
+/*++
+
+Routine Description:
+
+    This routine hands a list of packets destined for this machine back to the
+    receive path of the given link without sending them to the device. The
+    packets are delivered asynchronously, in order, as if the hardware had
+    received them and verified their checksums. Delivery never happens in the
+    context of the sender, so it is safe to call this with socket locks held.
+
+Arguments:
+
+    Link - Supplies a pointer to the link the packets should be received on.
+
+    Network - Supplies an optional pointer to the network layer that should
+        receive the packets. Supply NULL if the packets already carry a data
+        link header and should be parsed by the link's data link layer.
+
+    PacketList - Supplies a pointer to the list of packets to deliver. On
+        success, the packets are moved out of this list and owned by the
+        loopback path.
+
+Return Value:
+
+    STATUS_SUCCESS if the packets were queued for delivery.
+
+    STATUS_INSUFFICIENT_RESOURCES if the packets could not be queued. The
+    packets remain on the supplied list and are still owned by the caller.
+
+--*/
+
+{
+
+    PNET_LOOPBACK_BATCH Batch;
+    BOOL QueueWork;
+    KSTATUS Status;
+
+    ASSERT(KeGetRunLevel() == RunLevelLow);
+
+    if (NET_PACKET_LIST_EMPTY(PacketList) != FALSE) {
+        return STATUS_SUCCESS;
+    }
+
+    //
+    // A single record carries the whole list, rather than one per packet.
+    //
+
+    Batch = MmAllocatePagedPool(sizeof(NET_LOOPBACK_BATCH),
+                                NET_CORE_ALLOCATION_TAG);
+
+    if (Batch == NULL) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    NetLinkAddReference(Link);
+    Batch->Link = Link;
+    Batch->Network = Network;
+    NET_INITIALIZE_PACKET_LIST(&(Batch->PacketList));
+    NET_APPEND_PACKET_LIST(PacketList, &(Batch->PacketList));
+    QueueWork = FALSE;
+    KeAcquireQueuedLock(NetLoopbackLock);
+    INSERT_BEFORE(&(Batch->ListEntry), &NetLoopbackQueue);
+    if (NetLoopbackWorkQueued == FALSE) {
+        NetLoopbackWorkQueued = TRUE;
+        QueueWork = TRUE;
+    }
+
+    KeReleaseQueuedLock(NetLoopbackLock);
+    if (QueueWork != FALSE) {
+        Status = KeQueueWorkItem(NetLoopbackWorkItem);
+
+        //
+        // The work item is only ever queued by whoever flipped the flag, so
+        // this should not fail.
+        //
+
+        ASSERT(KSUCCESS(Status));
+    }
+
+    return STATUS_SUCCESS;
+}
+
+VOID
+NetpLoopbackInitialize (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine creates the software loopback link and configures it with
+    the IPv4 loopback address.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    NETWORK_DEVICE_INFORMATION Information;
+    PIP4_ADDRESS Ip4Address;
+    NET_LINK_PROPERTIES Properties;
+    KSTATUS Status;
+
+    INITIALIZE_LIST_HEAD(&NetLoopbackQueue);
+    NetLoopbackWorkQueued = FALSE;
+    NetLoopbackLock = KeCreateQueuedLock();
+    if (NetLoopbackLock == NULL) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto LoopbackInitializeEnd;
+    }
+
+    NetLoopbackWorkItem = KeCreateWorkItem(NULL,
+                                           WorkPriorityNormal,
+                                           NetpLoopbackWorker,
+                                           NULL,
+                                           NET_CORE_ALLOCATION_TAG);
+
+    if (NetLoopbackWorkItem == NULL) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto LoopbackInitializeEnd;
+    }
+
+    //
+    // The loopback link borrows Ethernet framing so that it can use the
+    // standard data link layer, but the network layers recognize the link and
+    // never actually hand it frames. There is no device behind it.
+    //
+
+    RtlZeroMemory(&Properties, sizeof(NET_LINK_PROPERTIES));
+    Properties.Version = NET_LINK_PROPERTIES_VERSION;
+    Properties.TransmitAlignment = 1;
+    Properties.Device = NULL;
+    Properties.DeviceContext = NULL;
+    Properties.PacketSizeInformation.MaxPacketSize = NET_LOOPBACK_MAX_PACKET_SIZE;
+    Properties.DataLinkType = NetDomainEthernet;
+    Properties.MaxPhysicalAddress = MAX_ULONGLONG;
+    Properties.PhysicalAddress.Domain = NetDomainEthernet;
+    Properties.Interface.Send = NetpLoopbackSend;
+    Properties.Interface.GetSetInformation = NetpLoopbackGetSetInformation;
+    Properties.Interface.DestroyLink = NetpLoopbackDestroyLink;
+    Properties.Capabilities = NET_LOOPBACK_CAPABILITIES;
+    Status = NetAddLink(&Properties, &NetLoopbackLink);
+    if (!KSUCCESS(Status)) {
+        goto LoopbackInitializeEnd;
+    }
+
+    //
+    // Statically assign the loopback address before bringing the link up so
+    // that DHCP is never started on it.
+    //
+
+    RtlZeroMemory(&Information, sizeof(NETWORK_DEVICE_INFORMATION));
+    Information.Version = NETWORK_DEVICE_INFORMATION_VERSION;
+    Information.Flags = NETWORK_DEVICE_FLAG_CONFIGURED;
+    Information.Domain = NetDomainIp4;
+    Information.ConfigurationMethod = NetworkAddressConfigurationStatic;
+    Ip4Address = (PIP4_ADDRESS)&(Information.Address);
+    Ip4Address->Domain = NetDomainIp4;
+    Ip4Address->Address = CPU_TO_NETWORK32(NET_LOOPBACK_IP4_ADDRESS);
+    Ip4Address = (PIP4_ADDRESS)&(Information.Subnet);
+    Ip4Address->Domain = NetDomainIp4;
+    Ip4Address->Address = CPU_TO_NETWORK32(NET_LOOPBACK_IP4_SUBNET);
+    Status = NetGetSetNetworkDeviceInformation(NetLoopbackLink,
+                                               NULL,
+                                               &Information,
+                                               TRUE);
+
+    if (!KSUCCESS(Status)) {
+        goto LoopbackInitializeEnd;
+    }
+
+    NetSetLinkState(NetLoopbackLink, TRUE, NET_LOOPBACK_LINK_SPEED);
+
+LoopbackInitializeEnd:
+    if (!KSUCCESS(Status)) {
+        RtlDebugPrint("Net: Failed to create loopback link: %d\n", Status);
+        if (NetLoopbackLink != NULL) {
+            NetRemoveLink(NetLoopbackLink);
+            NetLoopbackLink = NULL;
+        }
+    }
+
+    return;
+}
+
+BOOL
+NetpIsLoopbackAddress (
+    PNETWORK_ADDRESS Address
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines whether or not the given address is a loopback
+    address, which is always routed over the loopback link.
+
+Arguments:
+
+    Address - Supplies a pointer to the address to check.
+
+Return Value:
+
+    TRUE if the address is a loopback address.
+
+    FALSE otherwise.
+
+--*/
+
+{
+
+    PIP4_ADDRESS Ip4Address;
+
+    if (Address->Domain == NetDomainIp4) {
+        Ip4Address = (PIP4_ADDRESS)Address;
+        return IP4_IS_LOOPBACK_ADDRESS(Ip4Address->Address);
+    }
+
+    return FALSE;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+KSTATUS
+NetpLoopbackSend (
+    PVOID DeviceContext,
+    PNET_PACKET_LIST PacketList
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sends data through the loopback link. The network layers
+    deliver their traffic for the loopback link directly, so this only sees
+    frames built by the data link layer itself. They are turned around and
+    parsed by the data link layer on the way back up.
+
+Arguments:
+
+    DeviceContext - Supplies a pointer to the device context, which is unused.
+
+    PacketList - Supplies a pointer to a list of network packets to send.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    return NetLoopbackPackets(NetLoopbackLink, NULL, PacketList);
+}
+
+KSTATUS
+NetpLoopbackGetSetInformation (
+    PVOID DeviceContext,
+    NET_LINK_INFORMATION_TYPE InformationType,
+    PVOID Data,
+    PUINTN DataSize,
+    BOOL Set
+    )
+
+/*++
+
+Routine Description:
+
+    This routine gets or sets the network link information for the loopback
+    link. The loopback link has no settings beyond its fixed capabilities.
+
+Arguments:
+
+    DeviceContext - Supplies a pointer to the device context, which is unused.
+
+    InformationType - Supplies the type of information being queried or set.
+
+    Data - Supplies a pointer to the data buffer where the data is either
+        returned for a get operation or given for a set operation.
+
+    DataSize - Supplies a pointer that on input contains the size of the data
+        buffer. On output, contains the required size of the data buffer.
+
+    Set - Supplies a boolean indicating if this is a get operation (FALSE) or a
+        set operation (TRUE).
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    PULONG Flags;
+
+    switch (InformationType) {
+    case NetLinkInformationChecksumOffload:
+        if (*DataSize != sizeof(ULONG)) {
+            return STATUS_INVALID_PARAMETER;
+        }
+
+        if (Set != FALSE) {
+            return STATUS_NOT_SUPPORTED;
+        }
+
+        Flags = (PULONG)Data;
+        *Flags = NET_LOOPBACK_CAPABILITIES & NET_LINK_CAPABILITY_CHECKSUM_MASK;
+        break;
+
+    default:
+        return STATUS_NOT_SUPPORTED;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+VOID
+NetpLoopbackDestroyLink (
+    PVOID DeviceContext
+    )
+
+/*++
+
+Routine Description:
+
+    This routine notifies the loopback layer that the networking core is done
+    with the link. There is no device state to tear down.
+
+Arguments:
+
+    DeviceContext - Supplies a pointer to the device context, which is unused.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    return;
+}
+
+VOID
+NetpLoopbackWorker (
+    PVOID Parameter
+    )
+
+/*++
+
+Routine Description:
+
+    This routine drains the loopback queue, handing each packet back up the
+    stack on the link it was sent over.
+
+Arguments:
+
+    Parameter - Supplies an unused parameter.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PNET_LOOPBACK_BATCH Batch;
+    LIST_ENTRY Batches;
+    PNET_PACKET_BUFFER Packet;
+    NET_RECEIVE_CONTEXT ReceiveContext;
+
+    ASSERT(KeGetRunLevel() == RunLevelLow);
+
+    INITIALIZE_LIST_HEAD(&Batches);
+    while (TRUE) {
+
+        //
+        // Grab everything queued so far. If nothing is left, let the next
+        // sender queue the work item again. This is decided under the lock so
+        // that a batch cannot be stranded.
+        //
+
+        KeAcquireQueuedLock(NetLoopbackLock);
+        if (LIST_EMPTY(&NetLoopbackQueue) != FALSE) {
+            NetLoopbackWorkQueued = FALSE;
+            KeReleaseQueuedLock(NetLoopbackLock);
+            break;
+        }
+
+        MOVE_LIST(&NetLoopbackQueue, &Batches);
+        INITIALIZE_LIST_HEAD(&NetLoopbackQueue);
+        KeReleaseQueuedLock(NetLoopbackLock);
+        while (LIST_EMPTY(&Batches) == FALSE) {
+            Batch = LIST_VALUE(Batches.Next, NET_LOOPBACK_BATCH, ListEntry);
+            LIST_REMOVE(&(Batch->ListEntry));
+            RtlZeroMemory(&ReceiveContext, sizeof(NET_RECEIVE_CONTEXT));
+            ReceiveContext.Link = Batch->Link;
+            ReceiveContext.Network = Batch->Network;
+            while (NET_PACKET_LIST_EMPTY(&(Batch->PacketList)) == FALSE) {
+                Packet = LIST_VALUE(Batch->PacketList.Head.Next,
+                                    NET_PACKET_BUFFER,
+                                    ListEntry);
+
+                NET_REMOVE_PACKET_FROM_LIST(Packet, &(Batch->PacketList));
+
+                //
+                // The data never left memory, so treat every checksum as
+                // verified, whether or not it was ever computed.
+                //
+
+                Packet->Flags &= ~NET_PACKET_FLAG_SEGMENTATION_OFFLOAD;
+                Packet->Flags |= NET_PACKET_FLAG_CHECKSUM_OFFLOAD_MASK;
+                if (Batch->Network != NULL) {
+                    ReceiveContext.Packet = Packet;
+                    Batch->Network->Interface.ProcessReceivedData(
+                                                              &ReceiveContext);
+
+                } else {
+                    NetProcessReceivedPacket(Batch->Link, Packet);
+                }
+
+                NetFreeBuffer(Packet);
+            }
+
+            NetLinkReleaseReference(Batch->Link);
+            MmFreePagedPool(Batch);
+        }
+    }
+
+    return;
+}
+
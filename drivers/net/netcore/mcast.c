@@ -584,7 +584,11 @@ Return Value:
                   sizeof(NETWORK_ADDRESS));
 
     Link = Socket->MulticastInterface.LinkInformation.Link;
-    Request->InterfaceId = IoGetDeviceNumericId(Link->Properties.Device);
+    Request->InterfaceId = 0;
+    if (Link->Properties.Device != NULL) {
+        Request->InterfaceId = IoGetDeviceNumericId(Link->Properties.Device);
+    }
+
     NetpReleaseSocketMulticastLock(Socket);
 
 GetSocketMulticastInterface:
@@ -387,6 +387,14 @@ Return Value:
     //
 
     NetpNetlinkGenericInitialize(1);
+    NetpTcpNetlinkInitialize();
+
+    //
+    // Create the loopback link last, as adding a link relies on the data
+    // link and network layers above being registered.
+    //
+
+    NetpLoopbackInitialize();
 
 DriverEntryEnd:
     if (!KSUCCESS(Status)) {
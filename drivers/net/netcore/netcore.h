@@ -539,3 +539,71 @@ Return Value:
 
 --*/
 
+VOID
+NetpTcpNetlinkInitialize (
+    VOID
+    );
+
+/*++
+
+Routine Description:
+
+    This routine initializes the generic netlink TCP family, which exposes the
+    system-wide TCP buffer limits.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    None.
+
+--*/
+
+VOID
+NetpLoopbackInitialize (
+    VOID
+    );
+
+/*++
+
+Routine Description:
+
+    This routine creates the software loopback link and configures it with
+    the IPv4 loopback address.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    None.
+
+--*/
+
+BOOL
+NetpIsLoopbackAddress (
+    PNETWORK_ADDRESS Address
+    );
+
+/*++
+
+Routine Description:
+
+    This routine determines whether or not the given address is a loopback
+    address, which is always routed over the loopback link.
+
+Arguments:
+
+    Address - Supplies a pointer to the address to check.
+
+Return Value:
+
+    TRUE if the address is a loopback address.
+
+    FALSE otherwise.
+
+--*/
+
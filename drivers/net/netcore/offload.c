@@ -0,0 +1,981 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    offload.c
+
+Abstract:
+
+    This module implements generic segmentation offload and receive
+    coalescing for TCP. Segmentation offload packets carry several segments'
+    worth of data behind one set of headers and are either split by capable
+    hardware or split here right before going out a link. Receive coalescing
+    merges in-order segments of the same flow that arrive in a batch into a
+    single packet before the protocol layers see them.
+
+Author:
+
+    agent 18-Oct-2026
+
+Environment:
+
+    Kernel
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <minoca/kernel/driver.h>
+#include "netcore.h"
+#include <minoca/net/ip4.h>
+#include <minoca/net/ip6.h>
+#include "ethernet.h"
+#include "tcp.h"
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// Define the offset of the type field in an ethernet header.
+//
+
+#define NET_COALESCE_ETHERNET_TYPE_OFFSET (2 * ETHERNET_ADDRESS_SIZE)
+
+//
+// Define the set of TCP header flags that prevent a segment from being
+// coalesced with its neighbors.
+//
+
+#define NET_COALESCE_TCP_EXCLUDED_FLAGS \
+    (TCP_HEADER_FLAG_FIN |              \
+     TCP_HEADER_FLAG_SYN |              \
+     TCP_HEADER_FLAG_RESET |            \
+     TCP_HEADER_FLAG_URGENT)
+
+//
+// Define the packet flags that indicate a checksum was found to be bad by the
+// hardware.
+//
+
+#define NET_COALESCE_CHECKSUM_FAILED_FLAGS \
+    (NET_PACKET_FLAG_IP_CHECKSUM_FAILED |  \
+     NET_PACKET_FLAG_TCP_CHECKSUM_FAILED)
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+/*++
+
+Structure Description:
+
+    This structure describes the parsed headers of a received TCP segment that
+    is a candidate for coalescing.
+
+Members:
+
+    Packet - Stores a pointer to the received packet.
+
+    NetworkProtocol - Stores the ethernet type of the network layer, either
+        IPv4 or IPv6.
+
+    NetworkHeader - Stores a pointer to the network layer header.
+
+    NetworkHeaderSize - Stores the size of the network layer header, in bytes.
+
+    TcpHeader - Stores a pointer to the TCP header.
+
+    TcpHeaderSize - Stores the size of the TCP header including options, in
+        bytes.
+
+    Payload - Stores a pointer to the TCP payload.
+
+    PayloadSize - Stores the size of the TCP payload, in bytes.
+
+    SequenceNumber - Stores the sequence number of the segment, in host order.
+
+--*/
+
+typedef struct _NET_COALESCE_SEGMENT {
+    PNET_PACKET_BUFFER Packet;
+    ULONG NetworkProtocol;
+    PVOID NetworkHeader;
+    ULONG NetworkHeaderSize;
+    PTCP_HEADER TcpHeader;
+    ULONG TcpHeaderSize;
+    PUCHAR Payload;
+    ULONG PayloadSize;
+    ULONG SequenceNumber;
+} NET_COALESCE_SEGMENT, *PNET_COALESCE_SEGMENT;
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+BOOL
+NetpParseCoalesceSegment (
+    PNET_PACKET_BUFFER Packet,
+    PNET_COALESCE_SEGMENT Segment
+    );
+
+BOOL
+NetpValidateCoalesceChecksums (
+    PNET_COALESCE_SEGMENT Segment
+    );
+
+BOOL
+NetpCanCoalesceSegments (
+    PNET_COALESCE_SEGMENT First,
+    PNET_COALESCE_SEGMENT Previous,
+    PNET_COALESCE_SEGMENT Next,
+    ULONG TotalPayloadSize
+    );
+
+PNET_PACKET_BUFFER
+NetpCreateCoalescedPacket (
+    PNET_COALESCE_SEGMENT First,
+    PNET_PACKET_BUFFER Last,
+    ULONG TotalPayloadSize
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+NET_API
+VOID
+NetProcessReceivedPackets (
+    PNET_LINK Link,
+    PNET_PACKET_LIST PacketList
+    )
+
+/*++
+
+Routine Description:
+
+    This routine is called by the low level NIC driver to pass a batch of
+    received packets onto the core networking library for dispatching.
+    In-order TCP segments belonging to the same flow are coalesced into a
+    single packet before being handed to the protocol layers.
+
+Arguments:
+
+    Link - Supplies a pointer to the link that received the packets.
+
+    PacketList - Supplies a pointer to the list of received packets, in the
+        order they came off the wire. The packet structures may be used as
+        scratch space while this routine executes, but will not be accessed
+        after this routine returns. The list itself is not modified.
+
+Return Value:
+
+    None. When the function returns, the memory associated with the packets
+    may be reclaimed and reused.
+
+--*/
+
+{
+
+    PNET_PACKET_BUFFER Coalesced;
+    ULONG CoalescedCount;
+    PLIST_ENTRY CurrentEntry;
+    NET_COALESCE_SEGMENT First;
+    PLIST_ENTRY LastEntry;
+    NET_COALESCE_SEGMENT Next;
+    PNET_PACKET_BUFFER Packet;
+    NET_COALESCE_SEGMENT Previous;
+    ULONG TotalPayloadSize;
+
+    //
+    // Only ethernet framing is understood by the coalescing code. Everything
+    // else goes up one packet at a time.
+    //
+
+    CurrentEntry = PacketList->Head.Next;
+    if (Link->Properties.DataLinkType != NetDomainEthernet) {
+        while (CurrentEntry != &(PacketList->Head)) {
+            Packet = LIST_VALUE(CurrentEntry, NET_PACKET_BUFFER, ListEntry);
+            CurrentEntry = CurrentEntry->Next;
+            NetProcessReceivedPacket(Link, Packet);
+        }
+
+        return;
+    }
+
+    while (CurrentEntry != &(PacketList->Head)) {
+        Packet = LIST_VALUE(CurrentEntry, NET_PACKET_BUFFER, ListEntry);
+        CurrentEntry = CurrentEntry->Next;
+
+        //
+        // Packets that aren't plain TCP data segments go straight up.
+        //
+
+        if ((NetpParseCoalesceSegment(Packet, &First) == FALSE) ||
+            (NetpValidateCoalesceChecksums(&First) == FALSE)) {
+
+            NetProcessReceivedPacket(Link, Packet);
+            continue;
+        }
+
+        //
+        // Gather up as many following segments of the same flow as can be
+        // merged with this one.
+        //
+
+        CoalescedCount = 1;
+        TotalPayloadSize = First.PayloadSize;
+        LastEntry = &(Packet->ListEntry);
+        RtlCopyMemory(&Previous, &First, sizeof(NET_COALESCE_SEGMENT));
+        while (CurrentEntry != &(PacketList->Head)) {
+            Packet = LIST_VALUE(CurrentEntry, NET_PACKET_BUFFER, ListEntry);
+            if ((NetpParseCoalesceSegment(Packet, &Next) == FALSE) ||
+                (NetpCanCoalesceSegments(&First,
+                                         &Previous,
+                                         &Next,
+                                         TotalPayloadSize) == FALSE) ||
+                (NetpValidateCoalesceChecksums(&Next) == FALSE)) {
+
+                break;
+            }
+
+            CoalescedCount += 1;
+            TotalPayloadSize += Next.PayloadSize;
+            LastEntry = CurrentEntry;
+            CurrentEntry = CurrentEntry->Next;
+            RtlCopyMemory(&Previous, &Next, sizeof(NET_COALESCE_SEGMENT));
+        }
+
+        Coalesced = NULL;
+        if (CoalescedCount > 1) {
+            Packet = LIST_VALUE(LastEntry, NET_PACKET_BUFFER, ListEntry);
+            Coalesced = NetpCreateCoalescedPacket(&First,
+                                                  Packet,
+                                                  TotalPayloadSize);
+        }
+
+        //
+        // If nothing was merged or the merged packet could not be built, send
+        // the segments up individually.
+        //
+
+        if (Coalesced == NULL) {
+            CurrentEntry = &(First.Packet->ListEntry);
+            while (CurrentEntry != LastEntry->Next) {
+                Packet = LIST_VALUE(CurrentEntry, NET_PACKET_BUFFER, ListEntry);
+                CurrentEntry = CurrentEntry->Next;
+                NetProcessReceivedPacket(Link, Packet);
+            }
+
+            continue;
+        }
+
+        RtlAtomicAdd64(&(Link->OffloadStatistics.ReceiveCoalescedPackets), 1);
+        RtlAtomicAdd64(&(Link->OffloadStatistics.ReceiveCoalescedSegments),
+                       CoalescedCount);
+
+        NetProcessReceivedPacket(Link, Coalesced);
+        NetFreeBuffer(Coalesced);
+    }
+
+    return;
+}
+
+NET_API
+KSTATUS
+NetSegmentPacket (
+    PNET_LINK Link,
+    PNET_NETWORK_ENTRY Network,
+    PNETWORK_ADDRESS Source,
+    PNETWORK_ADDRESS Destination,
+    PNET_PACKET_BUFFER Packet,
+    PNET_PACKET_LIST PacketList
+    )
+
+/*++
+
+Routine Description:
+
+    This routine splits a TCP segmentation offload packet into individual
+    segments of at most the packet's segment size, for links that cannot
+    perform the segmentation in hardware. Each new segment gets a copy of the
+    TCP header with the sequence number, flags, and checksum fixed up.
+
+Arguments:
+
+    Link - Supplies a pointer to the link the segments will be sent over.
+
+    Network - Supplies a pointer to the network entry, used to compute the
+        pseudo-header checksums.
+
+    Source - Supplies a pointer to the source address of the packet.
+
+    Destination - Supplies a pointer to the destination address of the packet.
+
+    Packet - Supplies a pointer to the segmentation offload packet. The data
+        offset must point at the TCP header. On success, this packet is
+        removed from the list and freed.
+
+    PacketList - Supplies a pointer to the list containing the packet. On
+        success, the new segments are inserted in place of the original
+        packet.
+
+Return Value:
+
+    Status code. On failure, the packet list is left unchanged.
+
+--*/
+
+{
+
+    ULONG FooterSize;
+    PTCP_HEADER Header;
+    ULONG HeaderSize;
+    ULONG PacketFlags;
+    PUCHAR Payload;
+    ULONG PayloadRemaining;
+    ULONG PayloadSize;
+    PNET_PACKET_BUFFER Segment;
+    NET_PACKET_LIST SegmentList;
+    ULONG SequenceNumber;
+    KSTATUS Status;
+    PTCP_HEADER TcpHeader;
+    ULONG TcpHeaderSize;
+
+    ASSERT((Packet->Flags & NET_PACKET_FLAG_SEGMENTATION_OFFLOAD) != 0);
+    ASSERT(Packet->SegmentSize != 0);
+
+    NET_INITIALIZE_PACKET_LIST(&SegmentList);
+    TcpHeader = (PTCP_HEADER)(Packet->Buffer + Packet->DataOffset);
+    TcpHeaderSize = ((TcpHeader->HeaderLength & TCP_HEADER_LENGTH_MASK) >>
+                     TCP_HEADER_LENGTH_SHIFT) * sizeof(ULONG);
+
+    ASSERT((TcpHeaderSize >= sizeof(TCP_HEADER)) &&
+           (TcpHeaderSize <= (Packet->FooterOffset - Packet->DataOffset)));
+
+    Payload = (PUCHAR)TcpHeader + TcpHeaderSize;
+    PayloadRemaining = Packet->FooterOffset - Packet->DataOffset -
+                       TcpHeaderSize;
+
+    HeaderSize = Packet->DataOffset;
+    FooterSize = Packet->DataSize - Packet->FooterOffset;
+    SequenceNumber = NETWORK_TO_CPU32(TcpHeader->SequenceNumber);
+    PacketFlags = Packet->Flags & ~(NET_PACKET_FLAG_SEGMENTATION_OFFLOAD |
+                                    NET_PACKET_FLAG_TCP_CHECKSUM_OFFLOAD);
+
+    while (PayloadRemaining != 0) {
+        PayloadSize = Packet->SegmentSize;
+        if (PayloadSize > PayloadRemaining) {
+            PayloadSize = PayloadRemaining;
+        }
+
+        Status = NetAllocateBuffer(HeaderSize,
+                                   TcpHeaderSize + PayloadSize,
+                                   FooterSize,
+                                   Link,
+                                   0,
+                                   &Segment);
+
+        if (!KSUCCESS(Status)) {
+            goto SegmentPacketEnd;
+        }
+
+        NET_ADD_PACKET_TO_LIST(Segment, &SegmentList);
+        Segment->Flags |= PacketFlags;
+        Header = (PTCP_HEADER)(Segment->Buffer + Segment->DataOffset);
+        RtlCopyMemory(Header, TcpHeader, TcpHeaderSize);
+        RtlCopyMemory((PUCHAR)Header + TcpHeaderSize, Payload, PayloadSize);
+
+        //
+        // Only the last segment carries the FIN and PUSH flags of the
+        // original packet.
+        //
+
+        Header->SequenceNumber = CPU_TO_NETWORK32(SequenceNumber);
+        if (PayloadSize != PayloadRemaining) {
+            Header->Flags &= ~(TCP_HEADER_FLAG_FIN | TCP_HEADER_FLAG_PUSH);
+        }
+
+        Header->Checksum = 0;
+        if ((Link->Properties.Capabilities &
+             NET_LINK_CAPABILITY_TRANSMIT_TCP_CHECKSUM_OFFLOAD) == 0) {
+
+            Header->Checksum = NetChecksumPseudoHeaderAndData(
+                                                 Network,
+                                                 Header,
+                                                 TcpHeaderSize + PayloadSize,
+                                                 Source,
+                                                 Destination,
+                                                 SOCKET_INTERNET_PROTOCOL_TCP);
+
+        } else {
+            Segment->Flags |= NET_PACKET_FLAG_TCP_CHECKSUM_OFFLOAD;
+        }
+
+        Payload += PayloadSize;
+        PayloadRemaining -= PayloadSize;
+        SequenceNumber += PayloadSize;
+    }
+
+    RtlAtomicAdd64(&(Link->OffloadStatistics.SegmentationSoftwareSegments),
+                   SegmentList.Count);
+
+    //
+    // Swap the segments in for the original packet.
+    //
+
+    while (NET_PACKET_LIST_EMPTY(&SegmentList) == FALSE) {
+        Segment = LIST_VALUE(SegmentList.Head.Next,
+                             NET_PACKET_BUFFER,
+                             ListEntry);
+
+        NET_REMOVE_PACKET_FROM_LIST(Segment, &SegmentList);
+        NET_INSERT_PACKET_BEFORE(Segment, Packet, PacketList);
+    }
+
+    NET_REMOVE_PACKET_FROM_LIST(Packet, PacketList);
+    NetFreeBuffer(Packet);
+    Status = STATUS_SUCCESS;
+
+SegmentPacketEnd:
+    if (!KSUCCESS(Status)) {
+        NetDestroyBufferList(&SegmentList);
+    }
+
+    return Status;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+BOOL
+NetpParseCoalesceSegment (
+    PNET_PACKET_BUFFER Packet,
+    PNET_COALESCE_SEGMENT Segment
+    )
+
+/*++
+
+Routine Description:
+
+    This routine parses the headers of a received ethernet frame to determine
+    whether it is a TCP data segment eligible for coalescing.
+
+Arguments:
+
+    Packet - Supplies a pointer to the received packet.
+
+    Segment - Supplies a pointer where the parsed segment information is
+        returned.
+
+Return Value:
+
+    TRUE if the packet is a coalescing candidate.
+
+    FALSE if the packet must be processed on its own.
+
+--*/
+
+{
+
+    PUCHAR Data;
+    USHORT FragmentOffset;
+    PIP4_HEADER Ip4Header;
+    PIP6_HEADER Ip6Header;
+    ULONG Length;
+    ULONG NetworkLength;
+    ULONG VersionClassFlow;
+
+    if ((Packet->Flags & NET_COALESCE_CHECKSUM_FAILED_FLAGS) != 0) {
+        return FALSE;
+    }
+
+    Data = Packet->Buffer + Packet->DataOffset;
+    Length = Packet->FooterOffset - Packet->DataOffset;
+    if (Length < (ETHERNET_HEADER_SIZE + sizeof(IP4_HEADER) +
+                  sizeof(TCP_HEADER))) {
+
+        return FALSE;
+    }
+
+    Segment->Packet = Packet;
+    Segment->NetworkProtocol =
+              NETWORK_TO_CPU16(*((PUSHORT)(Data +
+                                           NET_COALESCE_ETHERNET_TYPE_OFFSET)));
+
+    Data += ETHERNET_HEADER_SIZE;
+    Length -= ETHERNET_HEADER_SIZE;
+    Segment->NetworkHeader = Data;
+
+    //
+    // Only option-less, unfragmented IPv4 headers are coalesced.
+    //
+
+    if (Segment->NetworkProtocol == IP4_PROTOCOL_NUMBER) {
+        Ip4Header = (PIP4_HEADER)Data;
+        if ((Ip4Header->VersionAndHeaderLength !=
+             (IP4_VERSION | (sizeof(IP4_HEADER) / sizeof(ULONG)))) ||
+            (Ip4Header->Protocol != SOCKET_INTERNET_PROTOCOL_TCP)) {
+
+            return FALSE;
+        }
+
+        FragmentOffset = NETWORK_TO_CPU16(Ip4Header->FragmentOffset);
+        FragmentOffset &= ~(IP4_FLAG_DO_NOT_FRAGMENT <<
+                            IP4_FRAGMENT_FLAGS_SHIFT);
+
+        if (FragmentOffset != 0) {
+            return FALSE;
+        }
+
+        Segment->NetworkHeaderSize = sizeof(IP4_HEADER);
+        NetworkLength = NETWORK_TO_CPU16(Ip4Header->TotalLength);
+
+    //
+    // Only IPv6 headers directly followed by TCP are coalesced.
+    //
+
+    } else if (Segment->NetworkProtocol == IP6_PROTOCOL_NUMBER) {
+        if (Length < (sizeof(IP6_HEADER) + sizeof(TCP_HEADER))) {
+            return FALSE;
+        }
+
+        Ip6Header = (PIP6_HEADER)Data;
+        VersionClassFlow = NETWORK_TO_CPU32(Ip6Header->VersionClassFlow);
+        if ((((VersionClassFlow & IP6_VERSION_MASK) >> IP6_VERSION_SHIFT) !=
+             IP6_VERSION) ||
+            (Ip6Header->NextHeader != SOCKET_INTERNET_PROTOCOL_TCP)) {
+
+            return FALSE;
+        }
+
+        Segment->NetworkHeaderSize = sizeof(IP6_HEADER);
+        NetworkLength = NETWORK_TO_CPU16(Ip6Header->PayloadLength) +
+                        sizeof(IP6_HEADER);
+
+    } else {
+        return FALSE;
+    }
+
+    //
+    // The length in the network header is the truth, as the frame may have
+    // been padded to the minimum ethernet size.
+    //
+
+    if ((NetworkLength > Length) ||
+        (NetworkLength < (Segment->NetworkHeaderSize + sizeof(TCP_HEADER)))) {
+
+        return FALSE;
+    }
+
+    Segment->TcpHeader = (PTCP_HEADER)(Data + Segment->NetworkHeaderSize);
+    Segment->TcpHeaderSize =
+             ((Segment->TcpHeader->HeaderLength & TCP_HEADER_LENGTH_MASK) >>
+              TCP_HEADER_LENGTH_SHIFT) * sizeof(ULONG);
+
+    if ((Segment->TcpHeaderSize < sizeof(TCP_HEADER)) ||
+        ((Segment->NetworkHeaderSize + Segment->TcpHeaderSize) >=
+         NetworkLength)) {
+
+        return FALSE;
+    }
+
+    //
+    // Only plain acknowledging data segments are coalesced.
+    //
+
+    if (((Segment->TcpHeader->Flags & NET_COALESCE_TCP_EXCLUDED_FLAGS) != 0) ||
+        ((Segment->TcpHeader->Flags & TCP_HEADER_FLAG_ACKNOWLEDGE) == 0)) {
+
+        return FALSE;
+    }
+
+    Segment->Payload = (PUCHAR)(Segment->TcpHeader) + Segment->TcpHeaderSize;
+    Segment->PayloadSize = NetworkLength - Segment->NetworkHeaderSize -
+                           Segment->TcpHeaderSize;
+
+    Segment->SequenceNumber =
+                         NETWORK_TO_CPU32(Segment->TcpHeader->SequenceNumber);
+
+    return TRUE;
+}
+
+BOOL
+NetpValidateCoalesceChecksums (
+    PNET_COALESCE_SEGMENT Segment
+    )
+
+/*++
+
+Routine Description:
+
+    This routine validates the network and TCP checksums of a segment about to
+    be coalesced, unless the hardware already did. Once validated, the packet
+    is marked as such so that the checksums are not computed again.
+
+Arguments:
+
+    Segment - Supplies a pointer to the parsed segment.
+
+Return Value:
+
+    TRUE if the checksums are valid.
+
+    FALSE if a checksum is bad. The packet should be sent up on its own so the
+    normal receive path can account for it.
+
+--*/
+
+{
+
+    USHORT Checksum;
+    NETWORK_ADDRESS Destination;
+    PIP4_ADDRESS Ip4Address;
+    PIP4_HEADER Ip4Header;
+    PIP6_ADDRESS Ip6Address;
+    PIP6_HEADER Ip6Header;
+    ULONG Length;
+    PNET_NETWORK_ENTRY Network;
+    PNET_PACKET_BUFFER Packet;
+    NETWORK_ADDRESS Source;
+
+    Packet = Segment->Packet;
+    if (Segment->NetworkProtocol == IP4_PROTOCOL_NUMBER) {
+        if ((Packet->Flags & NET_PACKET_FLAG_IP_CHECKSUM_OFFLOAD) == 0) {
+            Checksum = NetChecksumData(Segment->NetworkHeader,
+                                       Segment->NetworkHeaderSize);
+
+            if (Checksum != 0) {
+                return FALSE;
+            }
+
+            Packet->Flags |= NET_PACKET_FLAG_IP_CHECKSUM_OFFLOAD;
+        }
+    }
+
+    if ((Packet->Flags & NET_PACKET_FLAG_TCP_CHECKSUM_OFFLOAD) != 0) {
+        return TRUE;
+    }
+
+    RtlZeroMemory(&Source, sizeof(NETWORK_ADDRESS));
+    RtlZeroMemory(&Destination, sizeof(NETWORK_ADDRESS));
+    if (Segment->NetworkProtocol == IP4_PROTOCOL_NUMBER) {
+        Ip4Header = Segment->NetworkHeader;
+        Ip4Address = (PIP4_ADDRESS)&Source;
+        Ip4Address->Domain = NetDomainIp4;
+        Ip4Address->Address = Ip4Header->SourceAddress;
+        Ip4Address = (PIP4_ADDRESS)&Destination;
+        Ip4Address->Domain = NetDomainIp4;
+        Ip4Address->Address = Ip4Header->DestinationAddress;
+
+    } else {
+
+        ASSERT(Segment->NetworkProtocol == IP6_PROTOCOL_NUMBER);
+
+        Ip6Header = Segment->NetworkHeader;
+        Ip6Address = (PIP6_ADDRESS)&Source;
+        Ip6Address->Domain = NetDomainIp6;
+        RtlCopyMemory(Ip6Address->Address,
+                      Ip6Header->SourceAddress,
+                      IP6_ADDRESS_SIZE);
+
+        Ip6Address = (PIP6_ADDRESS)&Destination;
+        Ip6Address->Domain = NetDomainIp6;
+        RtlCopyMemory(Ip6Address->Address,
+                      Ip6Header->DestinationAddress,
+                      IP6_ADDRESS_SIZE);
+    }
+
+    Network = NetGetNetworkEntry(Segment->NetworkProtocol);
+    if (Network == NULL) {
+        return FALSE;
+    }
+
+    Length = Segment->TcpHeaderSize + Segment->PayloadSize;
+    Checksum = NetChecksumPseudoHeaderAndData(Network,
+                                              Segment->TcpHeader,
+                                              Length,
+                                              &Source,
+                                              &Destination,
+                                              SOCKET_INTERNET_PROTOCOL_TCP);
+
+    if (Checksum != 0) {
+        return FALSE;
+    }
+
+    Packet->Flags |= NET_PACKET_FLAG_TCP_CHECKSUM_OFFLOAD;
+    return TRUE;
+}
+
+BOOL
+NetpCanCoalesceSegments (
+    PNET_COALESCE_SEGMENT First,
+    PNET_COALESCE_SEGMENT Previous,
+    PNET_COALESCE_SEGMENT Next,
+    ULONG TotalPayloadSize
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines whether or not the given segment can be appended
+    to a run of coalesced segments.
+
+Arguments:
+
+    First - Supplies a pointer to the first segment in the run. Its headers
+        are the ones the coalesced packet will carry.
+
+    Previous - Supplies a pointer to the last segment currently in the run.
+
+    Next - Supplies a pointer to the candidate segment.
+
+    TotalPayloadSize - Supplies the number of payload bytes already in the run.
+
+Return Value:
+
+    TRUE if the next segment continues the run.
+
+    FALSE if the run ends before the next segment.
+
+--*/
+
+{
+
+    PIP4_HEADER FirstIp4;
+    PIP6_HEADER FirstIp6;
+    PTCP_HEADER FirstTcp;
+    PIP4_HEADER NextIp4;
+    PIP6_HEADER NextIp6;
+    PTCP_HEADER NextTcp;
+
+    if ((Next->NetworkProtocol != First->NetworkProtocol) ||
+        (Next->TcpHeaderSize != First->TcpHeaderSize)) {
+
+        return FALSE;
+    }
+
+    //
+    // A pushed segment or a short segment always ends a run, and a segment
+    // can't be larger than the first one, which sets the size that would have
+    // been used on the wire.
+    //
+
+    if (((Previous->TcpHeader->Flags & TCP_HEADER_FLAG_PUSH) != 0) ||
+        (Previous->PayloadSize != First->PayloadSize) ||
+        (Next->PayloadSize > First->PayloadSize)) {
+
+        return FALSE;
+    }
+
+    //
+    // The data must pick up exactly where the previous segment left off.
+    //
+
+    if (Next->SequenceNumber !=
+        (Previous->SequenceNumber + Previous->PayloadSize)) {
+
+        return FALSE;
+    }
+
+    if ((First->TcpHeaderSize + TotalPayloadSize + Next->PayloadSize) >
+        NET_SEGMENTATION_OFFLOAD_MAX_SIZE) {
+
+        return FALSE;
+    }
+
+    //
+    // The network headers must describe the same flow with the same
+    // attributes.
+    //
+
+    if (First->NetworkProtocol == IP4_PROTOCOL_NUMBER) {
+        FirstIp4 = First->NetworkHeader;
+        NextIp4 = Next->NetworkHeader;
+        if ((FirstIp4->SourceAddress != NextIp4->SourceAddress) ||
+            (FirstIp4->DestinationAddress != NextIp4->DestinationAddress) ||
+            (FirstIp4->Type != NextIp4->Type) ||
+            (FirstIp4->TimeToLive != NextIp4->TimeToLive)) {
+
+            return FALSE;
+        }
+
+    } else {
+        FirstIp6 = First->NetworkHeader;
+        NextIp6 = Next->NetworkHeader;
+        if ((FirstIp6->VersionClassFlow != NextIp6->VersionClassFlow) ||
+            (FirstIp6->HopLimit != NextIp6->HopLimit) ||
+            (RtlCompareMemory(FirstIp6->SourceAddress,
+                              NextIp6->SourceAddress,
+                              IP6_ADDRESS_SIZE) == FALSE) ||
+            (RtlCompareMemory(FirstIp6->DestinationAddress,
+                              NextIp6->DestinationAddress,
+                              IP6_ADDRESS_SIZE) == FALSE)) {
+
+            return FALSE;
+        }
+    }
+
+    //
+    // Everything in the TCP header but the sequence number, checksum, and push
+    // flag must match, including the options.
+    //
+
+    FirstTcp = First->TcpHeader;
+    NextTcp = Next->TcpHeader;
+    if ((FirstTcp->SourcePort != NextTcp->SourcePort) ||
+        (FirstTcp->DestinationPort != NextTcp->DestinationPort) ||
+        (FirstTcp->AcknowledgmentNumber != NextTcp->AcknowledgmentNumber) ||
+        (FirstTcp->WindowSize != NextTcp->WindowSize) ||
+        ((FirstTcp->Flags & ~TCP_HEADER_FLAG_PUSH) !=
+         (NextTcp->Flags & ~TCP_HEADER_FLAG_PUSH))) {
+
+        return FALSE;
+    }
+
+    if (First->TcpHeaderSize > sizeof(TCP_HEADER)) {
+        if (RtlCompareMemory(FirstTcp + 1,
+                             NextTcp + 1,
+                             First->TcpHeaderSize - sizeof(TCP_HEADER)) ==
+            FALSE) {
+
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+PNET_PACKET_BUFFER
+NetpCreateCoalescedPacket (
+    PNET_COALESCE_SEGMENT First,
+    PNET_PACKET_BUFFER Last,
+    ULONG TotalPayloadSize
+    )
+
+/*++
+
+Routine Description:
+
+    This routine builds a single packet out of a run of coalescable segments.
+    The new packet carries the first segment's headers, fixed up to describe
+    the combined payload.
+
+Arguments:
+
+    First - Supplies a pointer to the first segment of the run.
+
+    Last - Supplies a pointer to the last packet of the run.
+
+    TotalPayloadSize - Supplies the combined TCP payload size of the run.
+
+Return Value:
+
+    Returns a pointer to the new packet on success. The caller is responsible
+    for freeing it.
+
+    NULL on allocation failure.
+
+--*/
+
+{
+
+    PUCHAR Buffer;
+    PLIST_ENTRY CurrentEntry;
+    ULONG HeaderSize;
+    PIP4_HEADER Ip4Header;
+    PIP6_HEADER Ip6Header;
+    NET_COALESCE_SEGMENT Next;
+    PNET_PACKET_BUFFER NewPacket;
+    PNET_PACKET_BUFFER Packet;
+    BOOL Parsed;
+    KSTATUS Status;
+    PTCP_HEADER TcpHeader;
+
+    HeaderSize = ETHERNET_HEADER_SIZE + First->NetworkHeaderSize +
+                 First->TcpHeaderSize;
+
+    Status = NetAllocateBuffer(0,
+                               HeaderSize + TotalPayloadSize,
+                               0,
+                               NULL,
+                               0,
+                               &NewPacket);
+
+    if (!KSUCCESS(Status)) {
+        return NULL;
+    }
+
+    //
+    // Copy the headers from the first segment, then append the payloads of
+    // the whole run.
+    //
+
+    Packet = First->Packet;
+    Buffer = NewPacket->Buffer + NewPacket->DataOffset;
+    RtlCopyMemory(Buffer, Packet->Buffer + Packet->DataOffset, HeaderSize);
+    Buffer += HeaderSize;
+    CurrentEntry = &(Packet->ListEntry);
+    while (TRUE) {
+        Packet = LIST_VALUE(CurrentEntry, NET_PACKET_BUFFER, ListEntry);
+        Parsed = NetpParseCoalesceSegment(Packet, &Next);
+
+        ASSERT(Parsed != FALSE);
+
+        RtlCopyMemory(Buffer, Next.Payload, Next.PayloadSize);
+        Buffer += Next.PayloadSize;
+        if (Packet == Last) {
+            break;
+        }
+
+        CurrentEntry = CurrentEntry->Next;
+    }
+
+    ASSERT(Buffer == (PUCHAR)NewPacket->Buffer + NewPacket->FooterOffset);
+
+    //
+    // Fix up the lengths. The checksums were all validated on the way in, so
+    // mark the packet as such rather than recomputing the TCP checksum. The
+    // push flag comes from the last segment.
+    //
+
+    Buffer = NewPacket->Buffer + NewPacket->DataOffset + ETHERNET_HEADER_SIZE;
+    if (First->NetworkProtocol == IP4_PROTOCOL_NUMBER) {
+        Ip4Header = (PIP4_HEADER)Buffer;
+        Ip4Header->TotalLength = CPU_TO_NETWORK16(First->NetworkHeaderSize +
+                                                  First->TcpHeaderSize +
+                                                  TotalPayloadSize);
+
+        Ip4Header->HeaderChecksum = 0;
+        Ip4Header->HeaderChecksum = NetChecksumData(Ip4Header,
+                                                    sizeof(IP4_HEADER));
+
+    } else {
+        Ip6Header = (PIP6_HEADER)Buffer;
+        Ip6Header->PayloadLength = CPU_TO_NETWORK16(First->TcpHeaderSize +
+                                                    TotalPayloadSize);
+    }
+
+    TcpHeader = (PTCP_HEADER)(Buffer + First->NetworkHeaderSize);
+    TcpHeader->Flags |= Next.TcpHeader->Flags & TCP_HEADER_FLAG_PUSH;
+    NewPacket->Flags = NET_PACKET_FLAG_IP_CHECKSUM_OFFLOAD |
+                       NET_PACKET_FLAG_TCP_CHECKSUM_OFFLOAD;
+
+    return NewPacket;
+}
+
@@ -56,11 +56,6 @@ Module Name:
 // ------------------------------------------------------ Data Type Definitions
 //
 
-typedef enum _TCP_TIMER_STATE {
-    TcpTimerNotQueued,
-    TcpTimerQueued,
-} TPC_TIMER_STATE, *PTCP_TIMER_STATE;
-
 /*++
 
 Structure Description:
@@ -192,6 +187,17 @@ NetpTcpWorkerThread (
     PVOID Parameter
     );
 
+VOID
+NetpTcpServiceSocket (
+    PTCP_SOCKET Socket,
+    PULONGLONG CurrentTime
+    );
+
+ULONGLONG
+NetpTcpGetNextTimerDueTime (
+    PTCP_SOCKET Socket
+    );
+
 VOID
 NetpTcpProcessPacket (
     PTCP_SOCKET Socket,
@@ -284,6 +290,21 @@ NetpTcpCreatePacket (
     PTCP_SEND_SEGMENT Segment
     );
 
+PTCP_SEND_SEGMENT
+NetpTcpGetSegmentationRun (
+    PTCP_SOCKET Socket,
+    PTCP_SEND_SEGMENT FirstSegment,
+    ULONG WindowBegin,
+    ULONG WindowEnd
+    );
+
+PNET_PACKET_BUFFER
+NetpTcpCreateSegmentationPacket (
+    PTCP_SOCKET Socket,
+    PTCP_SEND_SEGMENT FirstSegment,
+    PTCP_SEND_SEGMENT LastSegment
+    );
+
 VOID
 NetpTcpFreeSentSegments (
     PTCP_SOCKET Socket,
@@ -314,8 +335,7 @@ NetpTcpShutdownReceive (
 
 KSTATUS
 NetpTcpCloseOutSocket (
-    PTCP_SOCKET Socket,
-    BOOL InsideWorker
+    PTCP_SOCKET Socket
     );
 
 VOID
@@ -348,13 +368,33 @@ NetpTcpTimerReleaseReference (
     );
 
 VOID
-NetpTcpQueueTcpTimer (
-    VOID
+NetpTcpArmTimer (
+    PTCP_SOCKET Socket,
+    ULONGLONG DueTime
     );
 
 VOID
-NetpTcpArmKeepAliveTimer (
-    ULONGLONG DueTime
+NetpTcpCancelTimer (
+    PTCP_SOCKET Socket
+    );
+
+VOID
+NetpTcpInsertTimerWheelSocket (
+    PTCP_TIMER_WHEEL Wheel,
+    PTCP_SOCKET Socket
+    );
+
+VOID
+NetpTcpAdvanceTimerWheel (
+    PTCP_TIMER_WHEEL Wheel,
+    ULONGLONG TargetTick,
+    PLIST_ENTRY ExpiredList
+    );
+
+VOID
+NetpTcpQueueTimerWheel (
+    PTCP_TIMER_WHEEL Wheel,
+    ULONGLONG DueTick
     );
 
 KSTATUS
@@ -382,27 +422,13 @@ NetpTcpFreeSegment (
 //
 
 //
-// Store a pointer to the global TCP timer.
-//
-
-PKTIMER NetTcpTimer;
-ULONGLONG NetTcpTimerPeriod;
-volatile ULONG NetTcpTimerReferenceCount;
-volatile ULONG NetTcpTimerState = TcpTimerNotQueued;
-
-//
-// Store a pointer to the global TCP keep alive timer.
-//
-
-PQUEUED_LOCK NetTcpKeepAliveTimerLock;
-PKTIMER NetTcpKeepAliveTimer;
-
-//
-// Store the global list of sockets.
+// Store the array of timer wheels, one per processor up to a limit, and the
+// length of a wheel tick in time counter ticks.
 //
 
-LIST_ENTRY NetTcpSocketList;
-PQUEUED_LOCK NetTcpSocketListLock;
+PTCP_TIMER_WHEEL NetTcpTimerWheels;
+ULONG NetTcpTimerWheelCount;
+ULONGLONG NetTcpTimerWheelTickLength;
 
 //
 // Store the TCP debug flags, which print out a bunch more information.
@@ -572,7 +598,15 @@ Return Value:
 
 {
 
+    ULONGLONG CurrentTick;
+    ULONG Level;
+    ULONG Slot;
     KSTATUS Status;
+    PTCP_TIMER_WHEEL Wheel;
+    ULONG WheelCount;
+    ULONG WheelIndex;
+
+    WheelCount = 0;
 
     //
     // Allow debugging to get more verbose, but leave it alone if some
@@ -587,53 +621,77 @@ Return Value:
         NetTcpDebugPrintSequenceNumbers = NetGetGlobalDebugFlag();
     }
 
-    INITIALIZE_LIST_HEAD(&NetTcpSocketList);
-
     //
-    // Create the global periodic timer and list lock.
+    // Create a timer wheel and worker thread for each processor, so that
+    // sockets created on different processors do not contend on the same
+    // wheel lock.
     //
 
-    ASSERT(NetTcpSocketListLock == NULL);
+    ASSERT(NetTcpTimerWheels == NULL);
 
-    NetTcpSocketListLock = KeCreateQueuedLock();
-    if (NetTcpSocketListLock == NULL) {
-        Status = STATUS_INSUFFICIENT_RESOURCES;
-        goto TcpInitializeEnd;
+    NetTcpTimerWheelTickLength =
+                  KeConvertMicrosecondsToTimeTicks(TCP_TIMER_WHEEL_RESOLUTION);
+
+    if (NetTcpTimerWheelTickLength == 0) {
+        NetTcpTimerWheelTickLength = 1;
     }
 
-    ASSERT(NetTcpTimer == NULL);
+    WheelCount = KeGetActiveProcessorCount();
+    if (WheelCount == 0) {
+        WheelCount = 1;
 
-    NetTcpTimer = KeCreateTimer(TCP_ALLOCATION_TAG);
-    if (NetTcpTimer == NULL) {
-        Status = STATUS_INSUFFICIENT_RESOURCES;
-        goto TcpInitializeEnd;
+    } else if (WheelCount > TCP_TIMER_WHEEL_MAX_COUNT) {
+        WheelCount = TCP_TIMER_WHEEL_MAX_COUNT;
     }
 
-    ASSERT(NetTcpKeepAliveTimerLock == NULL);
+    NetTcpTimerWheels = MmAllocatePagedPool(
+                                       sizeof(TCP_TIMER_WHEEL) * WheelCount,
+                                       TCP_ALLOCATION_TAG);
 
-    NetTcpKeepAliveTimerLock = KeCreateQueuedLock();
-    if (NetTcpKeepAliveTimerLock == NULL) {
+    if (NetTcpTimerWheels == NULL) {
         Status = STATUS_INSUFFICIENT_RESOURCES;
         goto TcpInitializeEnd;
     }
 
-    NetTcpTimerPeriod = KeConvertMicrosecondsToTimeTicks(TCP_TIMER_PERIOD);
+    RtlZeroMemory(NetTcpTimerWheels, sizeof(TCP_TIMER_WHEEL) * WheelCount);
+    CurrentTick = HlQueryTimeCounter() / NetTcpTimerWheelTickLength;
+    for (WheelIndex = 0; WheelIndex < WheelCount; WheelIndex += 1) {
+        Wheel = &(NetTcpTimerWheels[WheelIndex]);
+        Wheel->CurrentTick = CurrentTick;
+        Wheel->ArmedTick = MAX_ULONGLONG;
+        for (Level = 0; Level < TCP_TIMER_WHEEL_LEVELS; Level += 1) {
+            for (Slot = 0; Slot < TCP_TIMER_WHEEL_SLOTS; Slot += 1) {
+                INITIALIZE_LIST_HEAD(&(Wheel->Slots[Level][Slot]));
+            }
+        }
 
-    ASSERT(NetTcpKeepAliveTimer == NULL);
+        Wheel->Lock = KeCreateQueuedLock();
+        if (Wheel->Lock == NULL) {
+            Status = STATUS_INSUFFICIENT_RESOURCES;
+            goto TcpInitializeEnd;
+        }
 
-    NetTcpKeepAliveTimer = KeCreateTimer(TCP_ALLOCATION_TAG);
-    if (NetTcpKeepAliveTimer == NULL) {
-        Status = STATUS_INSUFFICIENT_RESOURCES;
-        goto TcpInitializeEnd;
+        Wheel->Timer = KeCreateTimer(TCP_ALLOCATION_TAG);
+        if (Wheel->Timer == NULL) {
+            Status = STATUS_INSUFFICIENT_RESOURCES;
+            goto TcpInitializeEnd;
+        }
     }
 
     //
-    // Create the worker thread.
+    // Only publish the wheels once they are all initialized, then create the
+    // worker threads.
     //
 
-    Status = PsCreateKernelThread(NetpTcpWorkerThread, NULL, "TcpWorkerThread");
-    if (!KSUCCESS(Status)) {
-        goto TcpInitializeEnd;
+    NetTcpTimerWheelCount = WheelCount;
+    for (WheelIndex = 0; WheelIndex < WheelCount; WheelIndex += 1) {
+        Status = PsCreateKernelThread(NetpTcpWorkerThread,
+                                      &(NetTcpTimerWheels[WheelIndex]),
+                                      "TcpWorkerThread");
+
+        if (!KSUCCESS(Status)) {
+            goto TcpInitializeEnd;
+        }
     }
 
     //
@@ -650,24 +708,25 @@ Return Value:
 
         ASSERT(FALSE);
 
-        if (NetTcpSocketListLock != NULL) {
-            KeDestroyQueuedLock(NetTcpSocketListLock);
-            NetTcpSocketListLock = NULL;
-        }
+        //
+        // Once published, worker threads may be waiting on the wheels, so only
+        // tear them down if they were never published.
+        //
 
-        if (NetTcpTimer != NULL) {
-            KeDestroyTimer(NetTcpTimer);
-            NetTcpTimer = NULL;
-        }
+        if ((NetTcpTimerWheels != NULL) && (NetTcpTimerWheelCount == 0)) {
+            for (WheelIndex = 0; WheelIndex < WheelCount; WheelIndex += 1) {
+                Wheel = &(NetTcpTimerWheels[WheelIndex]);
+                if (Wheel->Lock != NULL) {
+                    KeDestroyQueuedLock(Wheel->Lock);
+                }
 
-        if (NetTcpKeepAliveTimerLock != NULL) {
-            KeDestroyQueuedLock(NetTcpKeepAliveTimerLock);
-            NetTcpKeepAliveTimerLock = NULL;
-        }
+                if (Wheel->Timer != NULL) {
+                    KeDestroyTimer(Wheel->Timer);
+                }
+            }
 
-        if (NetTcpKeepAliveTimer != NULL) {
-            KeDestroyTimer(NetTcpKeepAliveTimer);
-            NetTcpKeepAliveTimer = NULL;
+            MmFreePagedPool(NetTcpTimerWheels);
+            NetTcpTimerWheels = NULL;
         }
     }
 
@@ -755,13 +814,8 @@ Return Value:
     INITIALIZE_LIST_HEAD(&(TcpSocket->IncomingConnectionList));
     NetpTcpSetState(TcpSocket, TcpStateInitialized);
     TcpSocket->RetryWaitPeriod = TCP_INITIAL_RETRY_WAIT_PERIOD;
-    TcpSocket->ReceiveWindowTotalSize = TCP_DEFAULT_WINDOW_SIZE;
-    TcpSocket->ReceiveWindowFreeSize = TcpSocket->ReceiveWindowTotalSize;
-    TcpSocket->ReceiveWindowScale = TCP_DEFAULT_WINDOW_SCALE;
     TcpSocket->ReceiveTimeout = WAIT_TIME_INDEFINITE;
     TcpSocket->ReceiveMinimum = TCP_DEFAULT_RECEIVE_MINIMUM;
-    TcpSocket->SendBufferTotalSize = TCP_DEFAULT_SEND_BUFFER_SIZE;
-    TcpSocket->SendBufferFreeSize = TcpSocket->SendBufferTotalSize;
     TcpSocket->SendInitialSequence = (ULONG)HlQueryTimeCounter();
     TcpSocket->SendUnacknowledgedSequence = TcpSocket->SendInitialSequence;
     TcpSocket->SendNextBufferSequence = TcpSocket->SendInitialSequence;
@@ -785,6 +839,7 @@ Return Value:
 
     ASSERT(TcpSocket->Flags == 0);
 
+    NetpTcpInitializeSocketBuffers(TcpSocket);
     NetpTcpCongestionInitializeSocket(TcpSocket);
 
     //
@@ -827,9 +882,16 @@ Return Value:
     ASSERT(TcpSocket->NetSocket.KernelSocket.IoState == NULL);
 
     TcpSocket->NetSocket.KernelSocket.IoState = IoState;
-    KeAcquireQueuedLock(NetTcpSocketListLock);
-    INSERT_BEFORE(&(TcpSocket->ListEntry), &NetTcpSocketList);
-    KeReleaseQueuedLock(NetTcpSocketListLock);
+
+    //
+    // Service the socket's timers on the wheel belonging to the processor that
+    // created it. Sockets spawned from incoming connections end up on the
+    // processor that received the SYN.
+    //
+
+    TcpSocket->TimerWheel = &(NetTcpTimerWheels[KeGetCurrentProcessorNumber() %
+                                                NetTcpTimerWheelCount]);
+
     Status = STATUS_SUCCESS;
 
 TcpCreateSocketEnd:
@@ -839,6 +901,7 @@ Return Value:
                 KeDestroyQueuedLock(TcpSocket->Lock);
             }
 
+            NetpTcpChargeSocketBuffers(TcpSocket, 0, 0, TRUE);
             MmFreePagedPool(TcpSocket);
             TcpSocket = NULL;
         }
@@ -892,7 +955,7 @@ Return Value:
     TcpSocket = (PTCP_SOCKET)Socket;
 
     ASSERT(TcpSocket->State == TcpStateClosed);
-    ASSERT(TcpSocket->ListEntry.Next == NULL);
+    ASSERT(TcpSocket->TimerState == TcpTimerNotQueued);
     ASSERT(LIST_EMPTY(&(TcpSocket->ReceivedSegmentList)) != FALSE);
     ASSERT(LIST_EMPTY(&(TcpSocket->OutgoingSegmentList)) != FALSE);
     ASSERT(TcpSocket->TimerReferenceCount == 0);
@@ -901,6 +964,7 @@ Return Value:
         Socket->Network->Interface.DestroySocket(Socket);
     }
 
+    NetpTcpChargeSocketBuffers(TcpSocket, 0, 0, TRUE);
     KeDestroyQueuedLock(TcpSocket->Lock);
     TcpSocket->Lock = NULL;
     TcpSocket->State = TcpStateInvalid;
@@ -1391,7 +1455,7 @@ Return Value:
             TcpSocket->Flags |= TCP_SOCKET_FLAG_CONNECT_INTERRUPTED;
 
         } else {
-            NetpTcpCloseOutSocket(TcpSocket, FALSE);
+            NetpTcpCloseOutSocket(TcpSocket);
         }
     }
 
@@ -1497,7 +1561,7 @@ Return Value:
     //
 
     if (CloseOutSocket != FALSE) {
-        Status = NetpTcpCloseOutSocket(TcpSocket, FALSE);
+        Status = NetpTcpCloseOutSocket(TcpSocket);
 
         ASSERT(TcpSocket->NetSocket.KernelSocket.ReferenceCount >= 1);
 
@@ -1519,7 +1583,7 @@ Return Value:
             if (TcpSocket->LingerTimeout == 0) {
                 NetpTcpSendControlPacket(TcpSocket, TCP_HEADER_FLAG_RESET);
                 TcpSocket->Flags |= TCP_SOCKET_FLAG_CONNECTION_RESET;
-                Status = NetpTcpCloseOutSocket(TcpSocket, FALSE);
+                Status = NetpTcpCloseOutSocket(TcpSocket);
                 KeReleaseQueuedLock(TcpSocket->Lock);
 
             //
@@ -1549,7 +1613,7 @@ Return Value:
                                                  TCP_HEADER_FLAG_RESET);
 
                         TcpSocket->Flags |= TCP_SOCKET_FLAG_CONNECTION_RESET;
-                        Status = NetpTcpCloseOutSocket(TcpSocket, FALSE);
+                        Status = NetpTcpCloseOutSocket(TcpSocket);
                     }
 
                     KeReleaseQueuedLock(TcpSocket->Lock);
@@ -2719,6 +2783,17 @@ Return Value:
 
             TcpSocket->ReceiveUnreadSequence = ExpectedSequence;
 
+            //
+            // Feed the consumed data into the window auto-tuning, which may
+            // open up more space before the window update decision below.
+            //
+
+            if (TcpSocket->ReceiveWindowFreeSize > OriginalFreeSize) {
+                NetpTcpAutoTuneReceiveWindow(
+                            TcpSocket,
+                            TcpSocket->ReceiveWindowFreeSize - OriginalFreeSize);
+            }
+
             //
             // If there is enough free space for a new segment, consider
             // sending a window update. If the original free window size could
@@ -3005,6 +3080,17 @@ Return Value:
                     SizeOption = SOCKET_OPTION_MAX_ULONG;
                 }
 
+                //
+                // Keep the size within the system-wide limits.
+                //
+
+                if (SizeOption > NetTcpBufferLimits.SendMaximum) {
+                    SizeOption = NetTcpBufferLimits.SendMaximum;
+
+                } else if (SizeOption < NetTcpBufferLimits.SendMinimum) {
+                    SizeOption = NetTcpBufferLimits.SendMinimum;
+                }
+
                 KeAcquireQueuedLock(TcpSocket->Lock);
 
                 //
@@ -3039,6 +3125,16 @@ Return Value:
                     }
                 }
 
+                //
+                // An explicitly sized buffer is no longer auto-tuned.
+                //
+
+                TcpSocket->Flags |= TCP_SOCKET_FLAG_SEND_BUFFER_LOCKED;
+                NetpTcpChargeSocketBuffers(TcpSocket,
+                                           TcpSocket->SendBufferTotalSize,
+                                           TcpSocket->ReceiveWindowTotalSize,
+                                           TRUE);
+
                 KeReleaseQueuedLock(TcpSocket->Lock);
 
             } else {
@@ -3118,6 +3214,17 @@ Return Value:
 
                 ASSERT(SizeOption <= SOCKET_OPTION_MAX_ULONG);
 
+                //
+                // Keep the size within the system-wide limits.
+                //
+
+                if (SizeOption > NetTcpBufferLimits.ReceiveMaximum) {
+                    SizeOption = NetTcpBufferLimits.ReceiveMaximum;
+
+                } else if (SizeOption < NetTcpBufferLimits.ReceiveMinimum) {
+                    SizeOption = NetTcpBufferLimits.ReceiveMinimum;
+                }
+
                 KeAcquireQueuedLock(TcpSocket->Lock);
 
                 //
@@ -3221,6 +3328,19 @@ Return Value:
                                              TcpSocket->ReceiveWindowTotalSize;
                 }
 
+                //
+                // An explicitly sized window is no longer auto-tuned.
+                //
+
+                if (KSUCCESS(Status)) {
+                    TcpSocket->Flags |= TCP_SOCKET_FLAG_RECEIVE_BUFFER_LOCKED;
+                    NetpTcpChargeSocketBuffers(
+                                            TcpSocket,
+                                            TcpSocket->SendBufferTotalSize,
+                                            TcpSocket->ReceiveWindowTotalSize,
+                                            TRUE);
+                }
+
                 KeReleaseQueuedLock(TcpSocket->Lock);
 
             } else {
@@ -3284,7 +3404,7 @@ Return Value:
 
                             TcpSocket->KeepAliveTime = DueTime;
                             TcpSocket->KeepAliveProbeCount = 0;
-                            NetpTcpArmKeepAliveTimer(DueTime);
+                            NetpTcpArmTimer(TcpSocket, DueTime);
                         }
 
                         TcpSocket->Flags |= TCP_SOCKET_FLAG_KEEP_ALIVE;
@@ -3691,11 +3811,14 @@ NetpTcpWorkerThread (
 
 Routine Description:
 
-    This routine implements periodic maintenance work required by TCP.
+    This routine services the sockets queued in one TCP timer wheel. It sleeps
+    until the earliest deadline in the wheel, collects every socket whose
+    deadline has passed, and runs its retransmit, acknowledge, keep alive and
+    time-wait processing.
 
 Arguments:
 
-    Parameter - Supplies an unused parameter.
+    Parameter - Supplies a pointer to the timer wheel this thread services.
 
 Return Value:
 
@@ -3705,334 +3828,473 @@ Return Value:
 
 {
 
-    PLIST_ENTRY CurrentEntry;
-    PTCP_SOCKET CurrentSocket;
     ULONGLONG CurrentTime;
-    PULONG Flags;
-    PIO_OBJECT_STATE IoState;
-    ULONGLONG KeepAliveTime;
-    BOOL KeepAliveTimeout;
+    ULONGLONG DueTick;
+    ULONGLONG DueTime;
+    LIST_ENTRY ExpiredList;
     PSOCKET KernelSocket;
-    BOOL LinkUp;
-    ULONGLONG RecentTime;
-    PVOID SignalingObject;
-    PVOID WaitObjectArray[2];
-    BOOL WithAcknowledge;
-
-    ASSERT(2 < BUILTIN_WAIT_BLOCK_ENTRY_COUNT);
-
-    KeepAliveTime = MAX_ULONGLONG;
-    WaitObjectArray[0] = NetTcpTimer;
-    WaitObjectArray[1] = NetTcpKeepAliveTimer;
-    while ((NetTcpTimer != NULL) && (NetTcpKeepAliveTimer != NULL)) {
-
-        //
-        // Sleep until the periodic or keep alive timer fires again.
-        //
+    BOOL ReleaseReference;
+    PTCP_SOCKET Socket;
+    PTCP_TIMER_WHEEL Wheel;
 
-        ObWaitOnObjects(WaitObjectArray,
-                        2,
-                        0,
-                        WAIT_TIME_INDEFINITE,
-                        NULL,
-                        &SignalingObject);
+    Wheel = Parameter;
+    while (TRUE) {
 
         //
-        // If the keep alive timer signaled, then check the keep alive states.
+        // Sleep until the wheel's next deadline.
         //
 
-        KeepAliveTimeout = FALSE;
-        if (SignalingObject == NetTcpKeepAliveTimer) {
-            KeepAliveTimeout = TRUE;
-            KeepAliveTime = MAX_ULONGLONG;
-            KeSignalTimer(NetTcpKeepAliveTimer, SignalOptionUnsignal);
+        ObWaitOnObject(Wheel->Timer, 0, WAIT_TIME_INDEFINITE);
+        KeSignalTimer(Wheel->Timer, SignalOptionUnsignal);
 
         //
-        // If the TCP timer signaled, determine whether or not work needs to be
-        // done. Start by setting the timer state to "not queued" as it just
-        // expired. Next, check the timer reference count. If there are no
-        // references, then no sockets need processing. If there are
-        // references, then at least one socket is hanging around. Attempt to
-        // queue the timer for the next round of work.
+        // Advance the wheel up to the current time, pulling off every socket
+        // that has come due, and queue the timer for the next deadline. Any
+        // socket that gets armed while the expired list is being processed
+        // lands back in the wheel and re-arms the timer if needed.
         //
-        // Sockets may be racing to increment the timer reference count from 0
-        // to 1 and queue the timer. The timer state variable synchronizes
-        // this. If the increment comes before the setting of the state to
-        // "not queued", the socket will see that the timer is already queued
-        // and the worker will see the timer reference and requeue the timer.
-        // If the increment comes after the setting of the state to "not
-        // queued" but before the worker checks the reference count, then the
-        // worker and socket will race to requeue the timer by performing
-        // atomic compare-exchanges on the timer state. If the increment comes
-        // after the setting of the state to "not queued" and after the worker
-        // sees the reference as 0, then the socket is free and clear to win
-        // the compare-exchange and queue the timer.
-        //
-
-        } else {
-
-            ASSERT(SignalingObject == NetTcpTimer);
 
-            KeSignalTimer(NetTcpTimer, SignalOptionUnsignal);
-            RtlAtomicExchange32(&NetTcpTimerState, TcpTimerNotQueued);
-            if (NetTcpTimerReferenceCount == 0) {
-                continue;
-            }
+        INITIALIZE_LIST_HEAD(&ExpiredList);
+        KeAcquireQueuedLock(Wheel->Lock);
+        Wheel->ArmedTick = MAX_ULONGLONG;
+        NetpTcpAdvanceTimerWheel(Wheel,
+                                 HlQueryTimeCounter() /
+                                 NetTcpTimerWheelTickLength,
+                                 &ExpiredList);
 
-            NetpTcpQueueTcpTimer();
-        }
+        NetpTcpQueueTimerWheel(Wheel, MAX_ULONGLONG);
+        KeReleaseQueuedLock(Wheel->Lock);
 
         //
-        // Loop through every socket.
+        // Service each expired socket. The wheel's reference on the socket
+        // keeps it alive until it is either requeued or released here.
         //
 
         CurrentTime = 0;
-        KeAcquireQueuedLock(NetTcpSocketListLock);
-        CurrentEntry = NetTcpSocketList.Next;
-        while (CurrentEntry != &NetTcpSocketList) {
-            CurrentSocket = LIST_VALUE(CurrentEntry, TCP_SOCKET, ListEntry);
-            CurrentEntry = CurrentEntry->Next;
-            KernelSocket = &(CurrentSocket->NetSocket.KernelSocket);
+        while (LIST_EMPTY(&ExpiredList) == FALSE) {
+            Socket = LIST_VALUE(ExpiredList.Next, TCP_SOCKET, TimerListEntry);
+            LIST_REMOVE(&(Socket->TimerListEntry));
+            KernelSocket = &(Socket->NetSocket.KernelSocket);
 
             ASSERT(KernelSocket->ReferenceCount >= 1);
 
+            KeAcquireQueuedLock(Socket->Lock);
+            DueTime = 0;
+            if (Socket->State != TcpStateClosed) {
+                NetpTcpServiceSocket(Socket, &CurrentTime);
+                DueTime = NetpTcpGetNextTimerDueTime(Socket);
+            }
+
             //
-            // Check the link state for all bound sockets. If the link is down,
-            // then close the socket.
+            // Requeue the socket at its next deadline, taking into account
+            // anyone who armed the timer while the socket was being serviced.
+            // Never requeue into the tick that was just processed, as that
+            // would spin if the recent time counter has not caught up.
             //
 
-            if (CurrentSocket->NetSocket.Link != NULL) {
-                NetGetLinkState(CurrentSocket->NetSocket.Link, &LinkUp, NULL);
-                if (LinkUp == FALSE) {
-                    IoSocketAddReference(KernelSocket);
-                    KeAcquireQueuedLock(CurrentSocket->Lock);
-                    NetpTcpCloseOutSocket(CurrentSocket, TRUE);
-                    KeReleaseQueuedLock(CurrentSocket->Lock);
-                    IoSocketReleaseReference(KernelSocket);
-                    continue;
-                }
+            ReleaseReference = FALSE;
+            KeAcquireQueuedLock(Wheel->Lock);
+
+            ASSERT(Socket->TimerState == TcpTimerExpired);
+
+            DueTick = MAX_ULONGLONG;
+            if (DueTime != 0) {
+                DueTick = (DueTime + NetTcpTimerWheelTickLength - 1) /
+                          NetTcpTimerWheelTickLength;
             }
 
-            //
-            // If the socket is not waiting on anything, move on. Manipulation
-            // of any of these criteria require manipulating the TCP timer
-            // reference count.
-            //
+            if ((Socket->TimerDueTick != 0) &&
+                (Socket->TimerDueTick < DueTick)) {
 
-            Flags = &(CurrentSocket->Flags);
-            if ((LIST_EMPTY(&(CurrentSocket->OutgoingSegmentList))) &&
-                ((*Flags & TCP_SOCKET_FLAG_SEND_ACKNOWLEDGE) == 0) &&
-                (((*Flags & TCP_SOCKET_FLAG_SEND_FINAL_SEQUENCE_VALID) == 0) ||
-                 ((*Flags & TCP_SOCKET_FLAG_SEND_FIN_WITH_DATA) != 0)) &&
-                (CurrentSocket->State != TcpStateTimeWait) &&
-                (TCP_IS_SYN_RETRY_STATE(CurrentSocket->State) == FALSE) &&
-                (((*Flags & TCP_SOCKET_FLAG_SEND_FIN_WITH_DATA) != 0) ||
-                 (TCP_IS_FIN_RETRY_STATE(CurrentSocket->State) == FALSE)) &&
-                ((KeepAliveTimeout == FALSE) ||
-                 ((*Flags & TCP_SOCKET_FLAG_KEEP_ALIVE) == 0) ||
-                 (TCP_IS_KEEP_ALIVE_STATE(CurrentSocket->State) == FALSE))) {
-
-                continue;
+                DueTick = Socket->TimerDueTick;
             }
 
-            IoSocketAddReference(KernelSocket);
-            KeAcquireQueuedLock(CurrentSocket->Lock);
-            NetpTcpSendPendingSegments(CurrentSocket, &CurrentTime);
+            if ((Socket->State == TcpStateClosed) ||
+                (DueTick == MAX_ULONGLONG)) {
 
-            //
-            // If the media was disconnected, close out the socket and move on.
-            //
+                Socket->TimerState = TcpTimerNotQueued;
+                Socket->TimerDueTick = 0;
+
+                ASSERT(Wheel->SocketCount != 0);
+
+                Wheel->SocketCount -= 1;
+                ReleaseReference = TRUE;
+
+            } else {
+                if (DueTick < Wheel->CurrentTick) {
+                    DueTick = Wheel->CurrentTick;
+                }
 
-            IoState = CurrentSocket->NetSocket.KernelSocket.IoState;
-            if ((IoState->Events & POLL_EVENT_DISCONNECTED) != 0) {
-                NetpTcpCloseOutSocket(CurrentSocket, TRUE);
-                KeReleaseQueuedLock(CurrentSocket->Lock);
+                Socket->TimerDueTick = DueTick;
+                NetpTcpInsertTimerWheelSocket(Wheel, Socket);
+                Socket->TimerState = TcpTimerQueued;
+                if (DueTick < Wheel->ArmedTick) {
+                    NetpTcpQueueTimerWheel(Wheel, DueTick);
+                }
+            }
+
+            KeReleaseQueuedLock(Wheel->Lock);
+            KeReleaseQueuedLock(Socket->Lock);
+            if (ReleaseReference != FALSE) {
                 IoSocketReleaseReference(KernelSocket);
-                continue;
             }
+        }
+    }
 
-            //
-            // If the socket is in the time wait state and the timer has
-            // expired then close out the socket.
-            //
+    return;
+}
 
-            if (CurrentSocket->State == TcpStateTimeWait) {
-                if (KeGetRecentTimeCounter() > CurrentSocket->TimeoutEnd) {
+VOID
+NetpTcpServiceSocket (
+    PTCP_SOCKET Socket,
+    PULONGLONG CurrentTime
+    )
 
-                    ASSERT(CurrentSocket->TimeoutEnd != 0);
+/*++
 
-                    if (NetTcpDebugPrintSequenceNumbers != FALSE) {
-                        RtlDebugPrint("TCP: Time-wait finished.\n");
-                    }
+Routine Description:
 
-                    NetpTcpCloseOutSocket(CurrentSocket, TRUE);
-                }
+    This routine performs the timer driven work for a TCP socket: checking the
+    link, retransmitting unacknowledged data, resending SYNs and FINs, sending
+    delayed acknowledges and keep alive probes, and finishing time-wait. This
+    routine assumes the socket lock is already held.
 
-            //
-            // If the socket is waiting for a SYN to be ACK'd, then resend the
-            // SYN if the retry has been reached. If the timeout has been
-            // reached then send a reset and signal the error event to wake up
-            // connect or accept.
-            //
+Arguments:
 
-            } else if (TCP_IS_SYN_RETRY_STATE(CurrentSocket->State)) {
-                RecentTime = KeGetRecentTimeCounter();
-                if (RecentTime > CurrentSocket->TimeoutEnd) {
-                    NetpTcpSendControlPacket(CurrentSocket,
-                                             TCP_HEADER_FLAG_RESET);
+    Socket - Supplies a pointer to the socket to service.
 
-                    NET_SOCKET_SET_LAST_ERROR(&(CurrentSocket->NetSocket),
-                                              STATUS_TIMEOUT);
+    CurrentTime - Supplies a pointer to an approximate current time counter
+        value, which may be zero if not yet known. This is updated if a more
+        recent time is queried.
 
-                    IoSetIoObjectState(IoState, POLL_EVENT_ERROR, TRUE);
-                    NetpTcpSetState(CurrentSocket, TcpStateInitialized);
+Return Value:
 
-                } else if (RecentTime >= CurrentSocket->RetryTime) {
-                    WithAcknowledge = FALSE;
-                    if (CurrentSocket->State == TcpStateSynReceived) {
-                        WithAcknowledge = TRUE;
-                    }
+    None.
 
-                    NetpTcpSendSyn(CurrentSocket, WithAcknowledge);
-                    TCP_UPDATE_RETRY_TIME(CurrentSocket);
-                }
+--*/
 
-            //
-            // If the socket is waiting for a FIN to be ACK'd, then resend the
-            // FIN if the retry time has been reached. If the timeout has
-            // expired, send a reset and close the socket.
-            //
+{
+
+    PULONG Flags;
+    PIO_OBJECT_STATE IoState;
+    BOOL LinkUp;
+    ULONGLONG RecentTime;
+    BOOL WithAcknowledge;
 
-            } else if (((*Flags & TCP_SOCKET_FLAG_SEND_FIN_WITH_DATA) == 0) &&
-                       TCP_IS_FIN_RETRY_STATE(CurrentSocket->State)) {
+    //
+    // Check the link state for bound sockets. If the link is down, then close
+    // the socket.
+    //
 
-                RecentTime = KeGetRecentTimeCounter();
-                if (RecentTime > CurrentSocket->TimeoutEnd) {
-                    NetpTcpSendControlPacket(CurrentSocket,
-                                             TCP_HEADER_FLAG_RESET);
+    if (Socket->NetSocket.Link != NULL) {
+        NetGetLinkState(Socket->NetSocket.Link, &LinkUp, NULL);
+        if (LinkUp == FALSE) {
+            NetpTcpCloseOutSocket(Socket);
+            return;
+        }
+    }
 
-                    *Flags |= TCP_SOCKET_FLAG_CONNECTION_RESET;
-                    NET_SOCKET_SET_LAST_ERROR(&(CurrentSocket->NetSocket),
-                                              STATUS_DESTINATION_UNREACHABLE);
+    //
+    // If the socket is not waiting on anything, move on. Manipulation of any
+    // of these criteria require manipulating the TCP timer reference count
+    // or arming the socket's timer.
+    //
 
-                    IoSetIoObjectState(IoState, POLL_EVENT_ERROR, TRUE);
-                    NetpTcpCloseOutSocket(CurrentSocket, TRUE);
+    Flags = &(Socket->Flags);
+    if ((LIST_EMPTY(&(Socket->OutgoingSegmentList))) &&
+        ((*Flags & TCP_SOCKET_FLAG_SEND_ACKNOWLEDGE) == 0) &&
+        (((*Flags & TCP_SOCKET_FLAG_SEND_FINAL_SEQUENCE_VALID) == 0) ||
+         ((*Flags & TCP_SOCKET_FLAG_SEND_FIN_WITH_DATA) != 0)) &&
+        (Socket->State != TcpStateTimeWait) &&
+        (TCP_IS_SYN_RETRY_STATE(Socket->State) == FALSE) &&
+        (((*Flags & TCP_SOCKET_FLAG_SEND_FIN_WITH_DATA) != 0) ||
+         (TCP_IS_FIN_RETRY_STATE(Socket->State) == FALSE)) &&
+        (((*Flags & TCP_SOCKET_FLAG_KEEP_ALIVE) == 0) ||
+         (TCP_IS_KEEP_ALIVE_STATE(Socket->State) == FALSE))) {
 
-                } else if (RecentTime >= CurrentSocket->RetryTime) {
-                    NetpTcpSendControlPacket(CurrentSocket,
-                                             TCP_HEADER_FLAG_FIN);
+        return;
+    }
 
-                    TCP_UPDATE_RETRY_TIME(CurrentSocket);
-                }
+    NetpTcpSendPendingSegments(Socket, CurrentTime);
 
-            //
-            // If the socket is in the keep alive state and the keep alive
-            // timer woke up the thread, then check on that timeout.
-            //
+    //
+    // If the media was disconnected, close out the socket and move on.
+    //
 
-            } else if ((KeepAliveTimeout != FALSE) &&
-                       ((*Flags & TCP_SOCKET_FLAG_KEEP_ALIVE) != 0) &&
-                       TCP_IS_KEEP_ALIVE_STATE(CurrentSocket->State)) {
+    IoState = Socket->NetSocket.KernelSocket.IoState;
+    if ((IoState->Events & POLL_EVENT_DISCONNECTED) != 0) {
+        NetpTcpCloseOutSocket(Socket);
+        return;
+    }
 
-                //
-                // If too many probes have been sent without a response then
-                // this socket is dead. Be nice, send a reset and then close it
-                // out.
-                //
+    //
+    // If the socket is in the time wait state and the timer has expired then
+    // close out the socket.
+    //
 
-                if (CurrentSocket->KeepAliveProbeCount >
-                    CurrentSocket->KeepAliveProbeLimit) {
+    if (Socket->State == TcpStateTimeWait) {
+        if (KeGetRecentTimeCounter() > Socket->TimeoutEnd) {
 
-                    NetpTcpSendControlPacket(CurrentSocket,
-                                             TCP_HEADER_FLAG_RESET);
+            ASSERT(Socket->TimeoutEnd != 0);
 
-                    *Flags |= TCP_SOCKET_FLAG_CONNECTION_RESET;
-                    NET_SOCKET_SET_LAST_ERROR(&(CurrentSocket->NetSocket),
-                                              STATUS_DESTINATION_UNREACHABLE);
+            if (NetTcpDebugPrintSequenceNumbers != FALSE) {
+                RtlDebugPrint("TCP: Time-wait finished.\n");
+            }
 
-                    IoSetIoObjectState(IoState, POLL_EVENT_ERROR, TRUE);
-                    NetpTcpCloseOutSocket(CurrentSocket, TRUE);
+            NetpTcpCloseOutSocket(Socket);
+            return;
+        }
 
-                //
-                // Otherwise, if the keep alive time has been reached, then
-                // send another ping and then re-arm the keep alive time.
-                //
+    //
+    // If the socket is waiting for a SYN to be ACK'd, then resend the SYN if
+    // the retry has been reached. If the timeout has been reached then send a
+    // reset and signal the error event to wake up connect or accept.
+    //
 
-                } else {
-                    RecentTime = KeGetRecentTimeCounter();
-                    if (RecentTime >= CurrentSocket->KeepAliveTime) {
-                        NetpTcpSendControlPacket(CurrentSocket,
-                                                 TCP_HEADER_FLAG_KEEP_ALIVE);
-
-                        CurrentSocket->KeepAliveProbeCount += 1;
-                        CurrentSocket->KeepAliveTime = RecentTime;
-                        CurrentSocket->KeepAliveTime +=
-                                               CurrentSocket->KeepAlivePeriod *
-                                               HlQueryTimeCounterFrequency();
-                    }
+    } else if (TCP_IS_SYN_RETRY_STATE(Socket->State)) {
+        RecentTime = KeGetRecentTimeCounter();
+        if (RecentTime > Socket->TimeoutEnd) {
+            NetpTcpSendControlPacket(Socket, TCP_HEADER_FLAG_RESET);
+            NET_SOCKET_SET_LAST_ERROR(&(Socket->NetSocket), STATUS_TIMEOUT);
+            IoSetIoObjectState(IoState, POLL_EVENT_ERROR, TRUE);
+            NetpTcpSetState(Socket, TcpStateInitialized);
 
-                    if (CurrentSocket->KeepAliveTime < KeepAliveTime) {
-                        KeepAliveTime = CurrentSocket->KeepAliveTime;
-                    }
-                }
+        } else if (RecentTime >= Socket->RetryTime) {
+            WithAcknowledge = FALSE;
+            if (Socket->State == TcpStateSynReceived) {
+                WithAcknowledge = TRUE;
             }
 
+            NetpTcpSendSyn(Socket, WithAcknowledge);
+            TCP_UPDATE_RETRY_TIME(Socket);
+        }
+
+    //
+    // If the socket is waiting for a FIN to be ACK'd, then resend the FIN if
+    // the retry time has been reached. If the timeout has expired, send a
+    // reset and close the socket.
+    //
+
+    } else if (((*Flags & TCP_SOCKET_FLAG_SEND_FIN_WITH_DATA) == 0) &&
+               TCP_IS_FIN_RETRY_STATE(Socket->State)) {
+
+        RecentTime = KeGetRecentTimeCounter();
+        if (RecentTime > Socket->TimeoutEnd) {
+            NetpTcpSendControlPacket(Socket, TCP_HEADER_FLAG_RESET);
+            *Flags |= TCP_SOCKET_FLAG_CONNECTION_RESET;
+            NET_SOCKET_SET_LAST_ERROR(&(Socket->NetSocket),
+                                      STATUS_DESTINATION_UNREACHABLE);
+
+            IoSetIoObjectState(IoState, POLL_EVENT_ERROR, TRUE);
+            NetpTcpCloseOutSocket(Socket);
+            return;
+
+        } else if (RecentTime >= Socket->RetryTime) {
+            NetpTcpSendControlPacket(Socket, TCP_HEADER_FLAG_FIN);
+            TCP_UPDATE_RETRY_TIME(Socket);
+        }
+
+    //
+    // If the socket is in the keep alive state and the keep alive time has
+    // been reached, then either probe the remote host or give up on it.
+    //
+
+    } else if (((*Flags & TCP_SOCKET_FLAG_KEEP_ALIVE) != 0) &&
+               TCP_IS_KEEP_ALIVE_STATE(Socket->State) &&
+               (Socket->KeepAliveTime != 0)) {
+
+        RecentTime = KeGetRecentTimeCounter();
+        if (RecentTime >= Socket->KeepAliveTime) {
+
             //
-            // If an acknowledge needs to be sent and it wasn't already sent
-            // above, then send just an acknowledge along.
+            // If too many probes have been sent without a response then this
+            // socket is dead. Be nice, send a reset and then close it out.
             //
 
-            if ((*Flags & TCP_SOCKET_FLAG_SEND_ACKNOWLEDGE) != 0) {
-                *Flags &= ~TCP_SOCKET_FLAG_SEND_ACKNOWLEDGE;
-                NetpTcpTimerReleaseReference(CurrentSocket);
-                NetpTcpSendControlPacket(CurrentSocket, 0);
+            if (Socket->KeepAliveProbeCount > Socket->KeepAliveProbeLimit) {
+                NetpTcpSendControlPacket(Socket, TCP_HEADER_FLAG_RESET);
+                *Flags |= TCP_SOCKET_FLAG_CONNECTION_RESET;
+                NET_SOCKET_SET_LAST_ERROR(&(Socket->NetSocket),
+                                          STATUS_DESTINATION_UNREACHABLE);
+
+                IoSetIoObjectState(IoState, POLL_EVENT_ERROR, TRUE);
+                NetpTcpCloseOutSocket(Socket);
+                return;
             }
 
-            KeReleaseQueuedLock(CurrentSocket->Lock);
-            IoSocketReleaseReference(KernelSocket);
-        }
+            //
+            // Otherwise send another ping and then re-arm the keep alive time.
+            //
 
-        KeReleaseQueuedLock(NetTcpSocketListLock);
+            NetpTcpSendControlPacket(Socket, TCP_HEADER_FLAG_KEEP_ALIVE);
+            Socket->KeepAliveProbeCount += 1;
+            Socket->KeepAliveTime = RecentTime;
+            Socket->KeepAliveTime += Socket->KeepAlivePeriod *
+                                     HlQueryTimeCounterFrequency();
+        }
+    }
 
-        //
-        // If the keep alive timer needs to be re-armed, then do so with the
-        // next lowest time.
-        //
+    //
+    // If an acknowledge needs to be sent and it wasn't already sent above,
+    // then send just an acknowledge along.
+    //
 
-        if ((KeepAliveTimeout != FALSE) && (KeepAliveTime != MAX_ULONGLONG)) {
-            NetpTcpArmKeepAliveTimer(KeepAliveTime);
-        }
+    if ((*Flags & TCP_SOCKET_FLAG_SEND_ACKNOWLEDGE) != 0) {
+        *Flags &= ~TCP_SOCKET_FLAG_SEND_ACKNOWLEDGE;
+        NetpTcpTimerReleaseReference(Socket);
+        NetpTcpSendControlPacket(Socket, 0);
     }
 
     return;
 }
 
-VOID
-NetpTcpProcessPacket (
-    PTCP_SOCKET Socket,
-    PNET_RECEIVE_CONTEXT ReceiveContext,
-    PTCP_HEADER Header
+ULONGLONG
+NetpTcpGetNextTimerDueTime (
+    PTCP_SOCKET Socket
     )
 
 /*++
 
 Routine Description:
 
-    This routine is called to process a valid received packet. This routine
-    assumes the socket lock is already held.
+    This routine determines when a socket next needs to be serviced by its
+    timer wheel, based on its state, its unacknowledged segments and its keep
+    alive settings. This routine assumes the socket lock is already held.
 
 Arguments:
 
-    Socket - Supplies a pointer to the TCP socket.
-
-    ReceiveContext - Supplies a pointer to the receive context that stores the
-        link, packet, network, protocol, and source and destination addresses.
-
-    Header - Supplies a pointer to the TCP header.
+    Socket - Supplies a pointer to the socket.
 
 Return Value:
 
-    None.
+    Returns the time counter value at which the socket should next be
+    serviced.
+
+    0 if the socket does not currently need any timer service.
+
+--*/
+
+{
+
+    PLIST_ENTRY CurrentEntry;
+    ULONGLONG DueTime;
+    ULONG Flags;
+    ULONGLONG NextTime;
+    ULONGLONG RecentTime;
+    PTCP_SEND_SEGMENT Segment;
+
+    if (Socket->State == TcpStateClosed) {
+        return 0;
+    }
+
+    Flags = Socket->Flags;
+    RecentTime = KeGetRecentTimeCounter();
+    NextTime = MAX_ULONGLONG;
+    if ((Flags & TCP_SOCKET_FLAG_SEND_ACKNOWLEDGE) != 0) {
+        NextTime = RecentTime +
+                   KeConvertMicrosecondsToTimeTicks(TCP_TIMER_SERVICE_DELAY);
+    }
+
+    //
+    // The time-wait, SYN and FIN retry, and keep alive deadlines are mutually
+    // exclusive by state. The time-wait and SYN/FIN timeouts fire once the
+    // recent time is strictly greater than the timeout end.
+    //
+
+    DueTime = MAX_ULONGLONG;
+    if (Socket->State == TcpStateTimeWait) {
+        DueTime = Socket->TimeoutEnd + 1;
+
+    } else if ((TCP_IS_SYN_RETRY_STATE(Socket->State)) ||
+               (((Flags & TCP_SOCKET_FLAG_SEND_FIN_WITH_DATA) == 0) &&
+                (TCP_IS_FIN_RETRY_STATE(Socket->State)))) {
+
+        DueTime = Socket->TimeoutEnd + 1;
+        if ((Socket->RetryTime != 0) && (Socket->RetryTime < DueTime)) {
+            DueTime = Socket->RetryTime;
+        }
+
+    } else if (((Flags & TCP_SOCKET_FLAG_KEEP_ALIVE) != 0) &&
+               (TCP_IS_KEEP_ALIVE_STATE(Socket->State)) &&
+               (Socket->KeepAliveTime != 0)) {
+
+        DueTime = Socket->KeepAliveTime;
+    }
+
+    if (DueTime < NextTime) {
+        NextTime = DueTime;
+    }
+
+    //
+    // Each segment that has been sent is due for retransmission once its
+    // timeout interval passes. If the first unsent segment is stuck behind a
+    // zero window, the window probe is due at the retry time.
+    //
+
+    CurrentEntry = Socket->OutgoingSegmentList.Next;
+    while (CurrentEntry != &(Socket->OutgoingSegmentList)) {
+        Segment = LIST_VALUE(CurrentEntry, TCP_SEND_SEGMENT, Header.ListEntry);
+        CurrentEntry = CurrentEntry->Next;
+        if (Segment->SendAttemptCount == 0) {
+            if ((Socket->SendWindowSize == 0) && (Socket->RetryTime != 0)) {
+                DueTime = Socket->RetryTime + 1;
+                if (DueTime < NextTime) {
+                    NextTime = DueTime;
+                }
+            }
+
+            break;
+        }
+
+        DueTime = Segment->LastSendTime + Segment->TimeoutInterval;
+        if (DueTime < NextTime) {
+            NextTime = DueTime;
+        }
+    }
+
+    //
+    // If the socket holds timer references but has no specific deadline, fall
+    // back to servicing it periodically.
+    //
+
+    if ((NextTime == MAX_ULONGLONG) && (Socket->TimerReferenceCount != 0)) {
+        NextTime = RecentTime +
+                   KeConvertMicrosecondsToTimeTicks(TCP_TIMER_PERIOD);
+    }
+
+    if (NextTime == MAX_ULONGLONG) {
+        return 0;
+    }
+
+    return NextTime;
+}
+
+VOID
+NetpTcpProcessPacket (
+    PTCP_SOCKET Socket,
+    PNET_RECEIVE_CONTEXT ReceiveContext,
+    PTCP_HEADER Header
+    )
+
+/*++
+
+Routine Description:
+
+    This routine is called to process a valid received packet. This routine
+    assumes the socket lock is already held.
+
+Arguments:
+
+    Socket - Supplies a pointer to the TCP socket.
+
+    ReceiveContext - Supplies a pointer to the receive context that stores the
+        link, packet, network, protocol, and source and destination addresses.
+
+    Header - Supplies a pointer to the TCP header.
+
+Return Value:
+
+    None.
 
 --*/
 
@@ -4200,7 +4462,7 @@ Return Value:
                     NET_SOCKET_SET_LAST_ERROR(&(Socket->NetSocket),
                                               STATUS_CONNECTION_RESET);
 
-                    NetpTcpCloseOutSocket(Socket, FALSE);
+                    NetpTcpCloseOutSocket(Socket);
                 }
 
                 return;
@@ -4235,7 +4497,7 @@ Return Value:
                 NET_SOCKET_SET_LAST_ERROR(&(Socket->NetSocket),
                                           STATUS_CONNECTION_RESET);
 
-                NetpTcpCloseOutSocket(Socket, FALSE);
+                NetpTcpCloseOutSocket(Socket);
             }
 
             return;
@@ -4334,7 +4596,7 @@ Return Value:
         NET_SOCKET_SET_LAST_ERROR(&(Socket->NetSocket),
                                   STATUS_CONNECTION_RESET);
 
-        NetpTcpCloseOutSocket(Socket, FALSE);
+        NetpTcpCloseOutSocket(Socket);
         return;
     }
 
@@ -4353,7 +4615,7 @@ Return Value:
         NET_SOCKET_SET_LAST_ERROR(&(Socket->NetSocket),
                                   STATUS_CONNECTION_RESET);
 
-        NetpTcpCloseOutSocket(Socket, FALSE);
+        NetpTcpCloseOutSocket(Socket);
         return;
     }
 
@@ -4582,7 +4844,7 @@ Return Value:
 
     //
     // If the socket is in a keep alive state then update the keep alive time
-    // and arm the keep alive timer. The remote side is still alive!
+    // and arm the socket timer. The remote side is still alive!
     //
 
     if (((Socket->Flags & TCP_SOCKET_FLAG_KEEP_ALIVE) != 0) &&
@@ -4594,7 +4856,7 @@ Return Value:
 
         Socket->KeepAliveTime = DueTime;
         Socket->KeepAliveProbeCount = 0;
-        NetpTcpArmKeepAliveTimer(DueTime);
+        NetpTcpArmTimer(Socket, DueTime);
     }
 
     return;
@@ -4804,7 +5066,7 @@ Return Value:
 
         ASSERT(LockHeld != FALSE);
 
-        NetpTcpCloseOutSocket(NewTcpSocket, FALSE);
+        NetpTcpCloseOutSocket(NewTcpSocket);
     }
 
     if (LockHeld != FALSE) {
@@ -4918,8 +5180,17 @@ Return Value:
     Header->NonUrgentOffset = NonUrgentOffset;
     Header->Checksum = 0;
     PacketSize = sizeof(TCP_HEADER) + OptionsLength + DataLength;
-    if ((Socket->NetSocket.Link->Properties.Capabilities &
-         NET_LINK_CAPABILITY_TRANSMIT_TCP_CHECKSUM_OFFLOAD) == 0) {
+
+    //
+    // Segmentation offload packets get their checksums computed per segment
+    // when they are split up, either by the hardware or by the network layer.
+    //
+
+    if ((Packet->Flags & NET_PACKET_FLAG_SEGMENTATION_OFFLOAD) != 0) {
+        Packet->Flags |= NET_PACKET_FLAG_TCP_CHECKSUM_OFFLOAD;
+
+    } else if ((Socket->NetSocket.Link->Properties.Capabilities &
+                NET_LINK_CAPABILITY_TRANSMIT_TCP_CHECKSUM_OFFLOAD) == 0) {
 
         Checksum = NetChecksumPseudoHeaderAndData(Socket->NetSocket.Network,
                                                   Header,
@@ -5229,7 +5500,7 @@ Return Value:
             NET_SOCKET_SET_LAST_ERROR(&(Socket->NetSocket),
                                       STATUS_CONNECTION_RESET);
 
-            NetpTcpCloseOutSocket(Socket, FALSE);
+            NetpTcpCloseOutSocket(Socket);
             return STATUS_CONNECTION_RESET;
         }
     }
@@ -5491,7 +5762,7 @@ Return Value:
                0);
 
         if (AcknowledgeNumber == Socket->SendFinalSequence + 1) {
-            NetpTcpCloseOutSocket(Socket, FALSE);
+            NetpTcpCloseOutSocket(Socket);
             return STATUS_CONNECTION_CLOSED;
         }
     }
@@ -5638,6 +5909,10 @@ Return Value:
             if (Socket->ReceiveWindowTotalSize > MAX_USHORT) {
                 Socket->ReceiveWindowTotalSize = MAX_USHORT;
                 Socket->ReceiveWindowFreeSize = MAX_USHORT;
+                NetpTcpChargeSocketBuffers(Socket,
+                                           Socket->SendBufferTotalSize,
+                                           Socket->ReceiveWindowTotalSize,
+                                           TRUE);
             }
 
             Socket->ReceiveWindowScale = 0;
@@ -6009,7 +6284,9 @@ Return Value:
     // The exception is if a FIN came in with this data packet and all the
     // expected data has been seen; the caller will handle sending an ACK in
     // response to the FIN. If the received data came with a PUSH, then always
-    // acknowledge right away, as there's probably not more data coming.
+    // acknowledge right away, as there's probably not more data coming. A
+    // packet coalesced from several segments counts as more than one packet,
+    // so it is also acknowledged right away.
     //
 
     if ((DataMissing != FALSE) ||
@@ -6019,6 +6296,7 @@ Return Value:
         if ((DataMissing == FALSE) &&
             ((Header->Flags & TCP_HEADER_FLAG_PUSH) == 0) &&
             (Length >= Socket->ReceiveMaxSegmentSize) &&
+            (Length < (2 * Socket->ReceiveMaxSegmentSize)) &&
             ((Socket->Flags & TCP_SOCKET_FLAG_SEND_ACKNOWLEDGE) == 0)) {
 
             Socket->Flags |= TCP_SOCKET_FLAG_SEND_ACKNOWLEDGE;
@@ -6487,18 +6765,18 @@ Return Value:
     ULONGLONG LocalCurrentTime;
     PNET_PACKET_BUFFER Packet;
     NET_PACKET_LIST PacketList;
+    PTCP_SEND_SEGMENT RunSegment;
     PTCP_SEND_SEGMENT Segment;
     ULONG SegmentBegin;
+    BOOL SegmentationOffload;
     KSTATUS Status;
     ULONG WindowBegin;
     ULONG WindowEnd;
     ULONG WindowSize;
 
     //
-    // The connection may have been reset locally and be waiting on the lock to
-    // close out the socket. The close routine releases the socket lock briefly
-    // in order to acquire the socket list lock. If this is the case, don't
-    // bother to send any more packets.
+    // The connection may have been reset locally and be waiting to be closed
+    // out. If this is the case, don't bother to send any more packets.
     //
 
     if ((Socket->Flags & TCP_SOCKET_FLAG_CONNECTION_RESET) != 0) {
@@ -6561,6 +6839,13 @@ Return Value:
         LocalCurrentTime = *CurrentTime;
     }
 
+    SegmentationOffload = FALSE;
+    if ((Socket->NetSocket.Link->Properties.Capabilities &
+         NET_LINK_CAPABILITY_TRANSMIT_TCP_SEGMENTATION_OFFLOAD) != 0) {
+
+        SegmentationOffload = TRUE;
+    }
+
     FirstSegment = NULL;
     LastSegment = NULL;
     NET_INITIALIZE_PACKET_LIST(&PacketList);
@@ -6605,7 +6890,28 @@ Return Value:
 
             ASSERT(Segment->Offset == 0);
 
-            Packet = NetpTcpCreatePacket(Socket, Segment);
+            //
+            // If the link can split large packets up itself, send as many
+            // new segments as possible in a single packet.
+            //
+
+            RunSegment = Segment;
+            if (SegmentationOffload != FALSE) {
+                RunSegment = NetpTcpGetSegmentationRun(Socket,
+                                                       Segment,
+                                                       WindowBegin,
+                                                       WindowEnd);
+            }
+
+            if (RunSegment != Segment) {
+                Packet = NetpTcpCreateSegmentationPacket(Socket,
+                                                         Segment,
+                                                         RunSegment);
+
+            } else {
+                Packet = NetpTcpCreatePacket(Socket, Segment);
+            }
+
             if (Packet == NULL) {
                 break;
             }
@@ -6615,27 +6921,38 @@ Return Value:
                 FirstSegment = Segment;
             }
 
-            LastSegment = Segment;
-
             //
-            // Update the next pointer and record the send time.
+            // Update the next pointer and record the send time for every
+            // segment that went out in the packet.
             //
 
-            Socket->SendNextNetworkSequence = Segment->SequenceNumber +
-                                              Segment->Length;
+            while (TRUE) {
+                Socket->SendNextNetworkSequence = Segment->SequenceNumber +
+                                                  Segment->Length;
 
-            if ((Segment->Flags & TCP_SEND_SEGMENT_FLAG_FIN) != 0) {
-                Socket->SendNextNetworkSequence += 1;
-                if (Socket->State == TcpStateCloseWait) {
-                    NetpTcpSetState(Socket, TcpStateLastAcknowledge);
+                if ((Segment->Flags & TCP_SEND_SEGMENT_FLAG_FIN) != 0) {
+                    Socket->SendNextNetworkSequence += 1;
+                    if (Socket->State == TcpStateCloseWait) {
+                        NetpTcpSetState(Socket, TcpStateLastAcknowledge);
 
-                } else {
-                    NetpTcpSetState(Socket, TcpStateFinWait1);
+                    } else {
+                        NetpTcpSetState(Socket, TcpStateFinWait1);
+                    }
                 }
+
+                NetpTcpGetTransmitTimeoutInterval(Socket, Segment);
+                Segment->SendAttemptCount += 1;
+                if (Segment == RunSegment) {
+                    break;
+                }
+
+                Segment = LIST_VALUE(Segment->Header.ListEntry.Next,
+                                     TCP_SEND_SEGMENT,
+                                     Header.ListEntry);
             }
 
-            NetpTcpGetTransmitTimeoutInterval(Socket, Segment);
-            Segment->SendAttemptCount += 1;
+            LastSegment = Segment;
+            CurrentEntry = Segment->Header.ListEntry.Next;
 
         //
         // This segment has been sent before. Check to see if enough
@@ -6908,6 +7225,203 @@ Return Value:
     return Packet;
 }
 
+PTCP_SEND_SEGMENT
+NetpTcpGetSegmentationRun (
+    PTCP_SOCKET Socket,
+    PTCP_SEND_SEGMENT FirstSegment,
+    ULONG WindowBegin,
+    ULONG WindowEnd
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines how many unsent segments, starting with the given
+    one, can go out together in a single segmentation offload packet. The
+    segments must be contiguous, inside the send window, and all but the last
+    must be the same size as the first, which becomes the size used on the
+    wire. Only the last segment may carry a FIN or PUSH. This routine assumes
+    the socket lock is already held.
+
+Arguments:
+
+    Socket - Supplies a pointer to the socket involved.
+
+    FirstSegment - Supplies a pointer to the first unsent segment.
+
+    WindowBegin - Supplies the first sequence number in the send window.
+
+    WindowEnd - Supplies the sequence number just beyond the send window.
+
+Return Value:
+
+    Returns a pointer to the last segment that can be sent in the same packet
+    as the first. This is the first segment itself if no others can join it.
+
+--*/
+
+{
+
+    PTCP_SEND_SEGMENT LastSegment;
+    PLIST_ENTRY NextEntry;
+    PTCP_SEND_SEGMENT NextSegment;
+    ULONG RunFlags;
+    ULONG TotalLength;
+
+    RunFlags = TCP_SEND_SEGMENT_FLAG_FIN |
+               TCP_SEND_SEGMENT_FLAG_SYN |
+               TCP_SEND_SEGMENT_FLAG_RESET |
+               TCP_SEND_SEGMENT_FLAG_PUSH |
+               TCP_SEND_SEGMENT_FLAG_URGENT;
+
+    LastSegment = FirstSegment;
+    TotalLength = FirstSegment->Length;
+    while ((LastSegment->Flags & RunFlags) == 0) {
+        NextEntry = LastSegment->Header.ListEntry.Next;
+        if (NextEntry == &(Socket->OutgoingSegmentList)) {
+            break;
+        }
+
+        NextSegment = LIST_VALUE(NextEntry, TCP_SEND_SEGMENT, Header.ListEntry);
+        if ((NextSegment->SendAttemptCount != 0) ||
+            (NextSegment->Length > FirstSegment->Length) ||
+            (LastSegment->Length != FirstSegment->Length) ||
+            ((NextSegment->Flags & TCP_SEND_SEGMENT_FLAG_URGENT) != 0)) {
+
+            break;
+        }
+
+        if (NextSegment->SequenceNumber !=
+            (LastSegment->SequenceNumber + LastSegment->Length)) {
+
+            break;
+        }
+
+        if ((NextSegment->SequenceNumber - WindowBegin) >=
+            (WindowEnd - WindowBegin)) {
+
+            break;
+        }
+
+        if ((TotalLength + NextSegment->Length + sizeof(TCP_HEADER)) >
+            NET_SEGMENTATION_OFFLOAD_MAX_SIZE) {
+
+            break;
+        }
+
+        TotalLength += NextSegment->Length;
+        LastSegment = NextSegment;
+    }
+
+    return LastSegment;
+}
+
+PNET_PACKET_BUFFER
+NetpTcpCreateSegmentationPacket (
+    PTCP_SOCKET Socket,
+    PTCP_SEND_SEGMENT FirstSegment,
+    PTCP_SEND_SEGMENT LastSegment
+    )
+
+/*++
+
+Routine Description:
+
+    This routine creates a single segmentation offload packet carrying the
+    data of a run of contiguous, unsent segments. The link or network layer
+    splits it back into segments the size of the first one.
+
+Arguments:
+
+    Socket - Supplies a pointer to the socket involved.
+
+    FirstSegment - Supplies a pointer to the first segment of the run.
+
+    LastSegment - Supplies a pointer to the last segment of the run.
+
+Return Value:
+
+    Returns a pointer to the newly allocated packet buffer on success, or NULL
+    on failure.
+
+--*/
+
+{
+
+    PUCHAR Buffer;
+    USHORT HeaderFlags;
+    PNET_PACKET_BUFFER Packet;
+    PTCP_SEND_SEGMENT Segment;
+    PNET_PACKET_SIZE_INFORMATION SizeInformation;
+    KSTATUS Status;
+    ULONG TotalLength;
+
+    Packet = NULL;
+    TotalLength = LastSegment->SequenceNumber + LastSegment->Length -
+                  FirstSegment->SequenceNumber;
+
+    SizeInformation = &(Socket->NetSocket.PacketSizeInformation);
+    Status = NetAllocateBuffer(SizeInformation->HeaderSize,
+                               TotalLength,
+                               SizeInformation->FooterSize,
+                               Socket->NetSocket.Link,
+                               0,
+                               &Packet);
+
+    if (!KSUCCESS(Status)) {
+
+        ASSERT(Packet == NULL);
+
+        goto TcpCreateSegmentationPacketEnd;
+    }
+
+    //
+    // Copy each segment's data in, back to back.
+    //
+
+    Buffer = Packet->Buffer + Packet->DataOffset;
+    Segment = FirstSegment;
+    while (TRUE) {
+        RtlCopyMemory(Buffer, Segment + 1, Segment->Length);
+        Buffer += Segment->Length;
+        if (Segment == LastSegment) {
+            break;
+        }
+
+        Segment = LIST_VALUE(Segment->Header.ListEntry.Next,
+                             TCP_SEND_SEGMENT,
+                             Header.ListEntry);
+    }
+
+    //
+    // The header carries the flags of the last segment, and only the last
+    // wire segment will get them when the packet is split.
+    //
+
+    HeaderFlags = LastSegment->Flags & TCP_SEND_SEGMENT_HEADER_FLAG_MASK;
+    Packet->Flags |= NET_PACKET_FLAG_SEGMENTATION_OFFLOAD;
+    Packet->SegmentSize = FirstSegment->Length;
+
+    ASSERT(Packet->DataOffset >= sizeof(TCP_HEADER));
+
+    Packet->DataOffset -= sizeof(TCP_HEADER);
+    NetpTcpFillOutHeader(Socket,
+                         Packet,
+                         FirstSegment->SequenceNumber,
+                         HeaderFlags,
+                         0,
+                         0,
+                         TotalLength);
+
+    RtlAtomicAdd64(
+           &(Socket->NetSocket.Link->OffloadStatistics.SegmentationPackets),
+           1);
+
+TcpCreateSegmentationPacketEnd:
+    return Packet;
+}
+
 VOID
 NetpTcpFreeSentSegments (
     PTCP_SOCKET Socket,
@@ -7430,7 +7944,7 @@ Return Value:
     case TcpStateCloseWait:
         if (LIST_EMPTY(&(TcpSocket->ReceivedSegmentList)) == FALSE) {
             NetpTcpSendControlPacket(TcpSocket, TCP_HEADER_FLAG_RESET);
-            NetpTcpCloseOutSocket(TcpSocket, FALSE);
+            NetpTcpCloseOutSocket(TcpSocket);
             *ResetSent = TRUE;
         }
 
@@ -7448,8 +7962,7 @@ Return Value:
 
 KSTATUS
 NetpTcpCloseOutSocket (
-    PTCP_SOCKET Socket,
-    BOOL InsideWorker
+    PTCP_SOCKET Socket
     )
 
 /*++
@@ -7457,17 +7970,12 @@ NetpTcpCloseOutSocket (
 Routine Description:
 
     This routine sets the socket to the closed state. This routine assumes the
-    socket lock is already held, and WILL briefly release it unless inside
-    the TCP worker thread.
+    socket lock is already held.
 
 Arguments:
 
     Socket - Supplies a pointer to the socket to destroy.
 
-    InsideWorker - Supplies a boolean indicating that this routine is being
-        called from inside the TCP worker thread and that all locks are already
-        held.
-
 Return Value:
 
     Status code.
@@ -7476,82 +7984,27 @@ Return Value:
 
 {
 
-    BOOL CloseSocket;
     PIO_OBJECT_STATE IoState;
     KSTATUS Status;
 
     ASSERT(KeGetRunLevel() == RunLevelLow);
 
-    CloseSocket = FALSE;
     IoState = Socket->NetSocket.KernelSocket.IoState;
     Status = STATUS_SUCCESS;
 
     //
-    // Check to see if the socket needs to be closed. Be careful as the state
-    // can change once the lock is releaed.
+    // Close out the socket if it is not already in the closed state.
     //
 
     if (Socket->State != TcpStateClosed) {
-        CloseSocket = TRUE;
-        if (InsideWorker == FALSE) {
-
-            //
-            // Release the socket lock to prevent a deadlock (the TCP worker
-            // thread acquires the socket list lock, then the socket). This
-            // shouldn't be a problem for callers since closing out the socket
-            // is pretty much the last thing done to a socket. Then acquire the
-            // socket list lock and the socket lock (now in the right order)
-            // and remove the socket from being observable by the worker
-            // thread.
-            //
-
-            KeReleaseQueuedLock(Socket->Lock);
-            KeAcquireQueuedLock(NetTcpSocketListLock);
-            KeAcquireQueuedLock(Socket->Lock);
-
-            //
-            // While the lock was released, the socket may have been closed.
-            // Prepare to bail out on the rest of the work.
-            //
-
-            if (Socket->State == TcpStateClosed) {
-                CloseSocket = FALSE;
-
-            //
-            // While the lock is held, remove the socket from the global list.
-            //
-
-            } else {
-                LIST_REMOVE(&(Socket->ListEntry));
-                Socket->ListEntry.Next = NULL;
-            }
-
-            KeReleaseQueuedLock(NetTcpSocketListLock);
-        }
-    }
-
-    //
-    // Close out the socket if it was deteremined to not be in the closed state
-    // after all the lock ordering checks above.
-    //
-
-    if (CloseSocket != FALSE) {
-
-        ASSERT(Socket->State != TcpStateClosed);
 
         //
-        // Be careful as the socket may have been removed from the global list
-        // above in the case where the global lock was not held upon entrance
-        // into this routine.
+        // Pull the socket out of its timer wheel so that the wheel does not
+        // hold on to it. If the wheel worker is servicing the socket right
+        // now, it will notice the closed state and drop it.
         //
 
-        if (Socket->ListEntry.Next != NULL) {
-
-            ASSERT(InsideWorker != FALSE);
-
-            LIST_REMOVE(&(Socket->ListEntry));
-            Socket->ListEntry.Next = NULL;
-        }
+        NetpTcpCancelTimer(Socket);
 
         //
         // Leave the socket lock held to prevent late senders from getting
@@ -7730,6 +8183,15 @@ Return Value:
     NewTcpSocket->ReceiveWindowScale = ListeningSocket->ReceiveWindowScale;
     NewTcpSocket->ReceiveTimeout = ListeningSocket->ReceiveTimeout;
     NewTcpSocket->ReceiveMinimum = ListeningSocket->ReceiveMinimum;
+    NewTcpSocket->Flags |= ListeningSocket->Flags &
+                           (TCP_SOCKET_FLAG_SEND_BUFFER_LOCKED |
+                            TCP_SOCKET_FLAG_RECEIVE_BUFFER_LOCKED);
+
+    NetpTcpChargeSocketBuffers(NewTcpSocket,
+                               NewTcpSocket->SendBufferTotalSize,
+                               NewTcpSocket->ReceiveWindowTotalSize,
+                               TRUE);
+
     if ((ListeningSocket->Flags & TCP_SOCKET_FLAG_LINGER_ENABLED) != 0) {
         NewTcpSocket->Flags |= TCP_SOCKET_FLAG_LINGER_ENABLED;
     }
@@ -8270,8 +8732,8 @@ NetpTcpTimerAddReference (
 
 Routine Description:
 
-    This routine increments the reference count on the TCP timer, ensuring that
-    it runs.
+    This routine increments the socket's timer reference count, ensuring that
+    its timer wheel services it shortly.
 
 Arguments:
 
@@ -8286,44 +8748,178 @@ Return Value:
 
 {
 
-    ULONG OldReferenceCount;
+    ULONGLONG DueTime;
+
+    Socket->TimerReferenceCount += 1;
+
+    ASSERT((Socket->TimerReferenceCount > 0) &&
+           (Socket->TimerReferenceCount < TCP_TIMER_MAX_REFERENCE));
 
     //
-    // Increment the reference count in the socket. If it's already got
-    // references, no action is needed on the global count.
+    // Whatever took the reference needs attention soon, even if the socket is
+    // already queued for some later deadline. The wheel works out the precise
+    // deadlines once it services the socket.
     //
 
-    Socket->TimerReferenceCount += 1;
+    DueTime = KeGetRecentTimeCounter() +
+              KeConvertMicrosecondsToTimeTicks(TCP_TIMER_SERVICE_DELAY);
+
+    NetpTcpArmTimer(Socket, DueTime);
+    return;
+}
+
+ULONG
+NetpTcpTimerReleaseReference (
+    PTCP_SOCKET Socket
+    )
+
+/*++
+
+Routine Description:
+
+    This routine decrements the socket's timer reference count. The socket is
+    dropped from its timer wheel the next time it is serviced if it no longer
+    has any deadlines.
+
+Arguments:
+
+    Socket - Supplies a pointer to the socket that is releasing the timer
+        reference. This routine assumes the TCP lock is already held.
+
+Return Value:
+
+    Returns the socket's new timer reference count.
+
+--*/
+
+{
 
     ASSERT((Socket->TimerReferenceCount > 0) &&
            (Socket->TimerReferenceCount < TCP_TIMER_MAX_REFERENCE));
 
-    if (Socket->TimerReferenceCount > 1) {
+    Socket->TimerReferenceCount -= 1;
+    return Socket->TimerReferenceCount;
+}
+
+VOID
+NetpTcpArmTimer (
+    PTCP_SOCKET Socket,
+    ULONGLONG DueTime
+    )
+
+/*++
+
+Routine Description:
+
+    This routine makes sure the socket is serviced by its timer wheel no later
+    than the given time. If the socket is already due earlier, nothing
+    changes. This routine assumes the socket lock is already held.
+
+Arguments:
+
+    Socket - Supplies a pointer to the socket.
+
+    DueTime - Supplies the time counter value by which the socket needs to be
+        serviced.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONGLONG CurrentTick;
+    ULONGLONG DueTick;
+    PTCP_TIMER_WHEEL Wheel;
+
+    ASSERT(KeGetRunLevel() == RunLevelLow);
+
+    if (Socket->State == TcpStateClosed) {
         return;
     }
 
     //
-    // This is the first reference the socket is taking on the global timer.
-    // Incremement the reference count of the global timer, and maybe queue it.
+    // Avoid the wheel lock if the socket is already queued for an earlier
+    // tick. If the worker is racing to expire the socket, it recomputes the
+    // deadlines under the socket lock once this caller is done.
     //
 
-    OldReferenceCount = RtlAtomicAdd32(&NetTcpTimerReferenceCount, 1);
+    DueTick = (DueTime + NetTcpTimerWheelTickLength - 1) /
+              NetTcpTimerWheelTickLength;
 
-    ASSERT(OldReferenceCount < TCP_TIMER_MAX_REFERENCE);
+    if ((Socket->TimerState == TcpTimerQueued) &&
+        (Socket->TimerDueTick <= DueTick)) {
 
-    if (OldReferenceCount == 0) {
-        if (NetTcpDebugPrintSequenceNumbers != FALSE) {
-            RtlDebugPrint("TCP: Enabled periodic timer.\n");
+        return;
+    }
+
+    Wheel = Socket->TimerWheel;
+    KeAcquireQueuedLock(Wheel->Lock);
+    switch (Socket->TimerState) {
+
+    //
+    // The wheel takes a reference on the socket while it is queued. An empty
+    // wheel's worker may have been asleep for a long time, so catch the wheel
+    // up to the present rather than making the worker walk every idle tick.
+    //
+
+    case TcpTimerNotQueued:
+        if (Wheel->SocketCount == 0) {
+            CurrentTick = HlQueryTimeCounter() / NetTcpTimerWheelTickLength;
+            if (CurrentTick > Wheel->CurrentTick) {
+                Wheel->CurrentTick = CurrentTick;
+            }
+        }
+
+        IoSocketAddReference(&(Socket->NetSocket.KernelSocket));
+        Wheel->SocketCount += 1;
+        Socket->TimerDueTick = DueTick;
+        NetpTcpInsertTimerWheelSocket(Wheel, Socket);
+        Socket->TimerState = TcpTimerQueued;
+        break;
+
+    case TcpTimerQueued:
+        if (DueTick < Socket->TimerDueTick) {
+            LIST_REMOVE(&(Socket->TimerListEntry));
+            Socket->TimerDueTick = DueTick;
+            NetpTcpInsertTimerWheelSocket(Wheel, Socket);
+        }
+
+        break;
+
+    //
+    // The worker is servicing the socket. Just record the request, the worker
+    // honors it when it requeues the socket.
+    //
+
+    case TcpTimerExpired:
+        if ((Socket->TimerDueTick == 0) || (DueTick < Socket->TimerDueTick)) {
+            Socket->TimerDueTick = DueTick;
         }
 
-        NetpTcpQueueTcpTimer();
+        break;
+
+    default:
+
+        ASSERT(FALSE);
+
+        break;
+    }
+
+    if ((Socket->TimerState == TcpTimerQueued) &&
+        (Socket->TimerDueTick < Wheel->ArmedTick)) {
+
+        NetpTcpQueueTimerWheel(Wheel, Socket->TimerDueTick);
     }
 
+    KeReleaseQueuedLock(Wheel->Lock);
     return;
 }
 
-ULONG
-NetpTcpTimerReleaseReference (
+VOID
+NetpTcpCancelTimer (
     PTCP_SOCKET Socket
     )
 
@@ -8331,58 +8927,71 @@ NetpTcpTimerReleaseReference (
 
 Routine Description:
 
-    This routine decrements the reference count on the TCP timer, canceling it
-    if no one else is using it.
+    This routine removes a socket from its timer wheel. This routine assumes
+    the socket lock is already held, and that the caller holds its own
+    reference on the socket.
 
 Arguments:
 
-    Socket - Supplies an optional pointer to the socket that is releasing the
-        timer reference.
+    Socket - Supplies a pointer to the socket.
 
 Return Value:
 
-    Returns the old reference count on the TCP timer. The return value should
-    only be observed if the socket parameter is NULL.
+    None.
 
 --*/
 
 {
 
-    ULONG OldReferenceCount;
+    BOOL ReleaseReference;
+    PTCP_TIMER_WHEEL Wheel;
 
-    if (Socket != NULL) {
+    ReleaseReference = FALSE;
+    Wheel = Socket->TimerWheel;
+    KeAcquireQueuedLock(Wheel->Lock);
 
-        ASSERT((Socket->TimerReferenceCount > 0) &&
-               (Socket->TimerReferenceCount < TCP_TIMER_MAX_REFERENCE));
+    //
+    // A socket being serviced by the worker is left alone. The worker owns
+    // the wheel's reference and drops it once it sees the socket is closed.
+    //
 
-        Socket->TimerReferenceCount -= 1;
-        if (Socket->TimerReferenceCount != 0) {
-            return Socket->TimerReferenceCount;
-        }
-    }
+    if (Socket->TimerState == TcpTimerQueued) {
+        LIST_REMOVE(&(Socket->TimerListEntry));
+        Socket->TimerState = TcpTimerNotQueued;
+        Socket->TimerDueTick = 0;
+
+        ASSERT(Wheel->SocketCount != 0);
 
-    OldReferenceCount = RtlAtomicAdd32(&NetTcpTimerReferenceCount, (ULONG)-1);
+        Wheel->SocketCount -= 1;
+        ReleaseReference = TRUE;
+    }
 
-    ASSERT((OldReferenceCount != 0) &&
-           (OldReferenceCount < TCP_TIMER_MAX_REFERENCE));
+    KeReleaseQueuedLock(Wheel->Lock);
+    if (ReleaseReference != FALSE) {
+        IoSocketReleaseReference(&(Socket->NetSocket.KernelSocket));
+    }
 
-    return OldReferenceCount;
+    return;
 }
 
 VOID
-NetpTcpQueueTcpTimer (
-    VOID
+NetpTcpInsertTimerWheelSocket (
+    PTCP_TIMER_WHEEL Wheel,
+    PTCP_SOCKET Socket
     )
 
 /*++
 
 Routine Description:
 
-    This routine queues the TCP timer.
+    This routine inserts a socket into the appropriate slot of a timer wheel
+    based on its due tick. This routine assumes the wheel lock is held.
 
 Arguments:
 
-    None.
+    Wheel - Supplies a pointer to the timer wheel.
+
+    Socket - Supplies a pointer to the socket to insert.
 
 Return Value:
 
@@ -8392,55 +9001,165 @@ Return Value:
 
 {
 
-    ULONGLONG DueTime;
-    ULONG OldState;
-    KSTATUS Status;
+    ULONGLONG Delta;
+    ULONGLONG DueTick;
+    ULONG Level;
+    ULONGLONG Range;
+    ULONG Shift;
+    ULONG Slot;
 
-    ASSERT(KeGetRunLevel() == RunLevelLow);
+    //
+    // Sockets that are already due go in the slot processed next. Otherwise
+    // pick the lowest level whose span covers the distance to the deadline.
+    // Deadlines beyond the top level are parked at its far edge and
+    // re-cascaded when that slot comes around.
+    //
+
+    DueTick = Socket->TimerDueTick;
+    if (DueTick < Wheel->CurrentTick) {
+        DueTick = Wheel->CurrentTick;
+    }
+
+    Delta = DueTick - Wheel->CurrentTick;
+    Level = 0;
+    Shift = TCP_TIMER_WHEEL_SLOT_SHIFT;
+    while (Level < TCP_TIMER_WHEEL_LEVELS - 1) {
+        Range = 1ULL << Shift;
+        if (Delta < Range) {
+            break;
+        }
+
+        Level += 1;
+        Shift += TCP_TIMER_WHEEL_SLOT_SHIFT;
+    }
+
+    Range = 1ULL << Shift;
+    if (Delta >= Range) {
+        DueTick = Wheel->CurrentTick + Range - 1;
+    }
+
+    Shift = Level * TCP_TIMER_WHEEL_SLOT_SHIFT;
+    Slot = (DueTick >> Shift) & TCP_TIMER_WHEEL_SLOT_MASK;
+    INSERT_BEFORE(&(Socket->TimerListEntry), &(Wheel->Slots[Level][Slot]));
+    return;
+}
+
+VOID
+NetpTcpAdvanceTimerWheel (
+    PTCP_TIMER_WHEEL Wheel,
+    ULONGLONG TargetTick,
+    PLIST_ENTRY ExpiredList
+    )
+
+/*++
+
+Routine Description:
+
+    This routine advances a timer wheel through the given tick, cascading
+    higher levels down as their slots come around and moving every socket
+    that comes due onto the expired list. This routine assumes the wheel lock
+    is held.
+
+Arguments:
+
+    Wheel - Supplies a pointer to the timer wheel.
+
+    TargetTick - Supplies the last tick to process, usually the current time.
+
+    ExpiredList - Supplies a pointer to the head of a list that receives the
+        expired sockets. Each expired socket keeps the wheel's reference.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Level;
+    LIST_ENTRY List;
+    PLIST_ENTRY SlotList;
+    ULONG Slot;
+    PTCP_SOCKET Socket;
 
     //
-    // Attempt to queue the timer. The TCP worker may race with sockets adding
-    // the first reference to the timer and then trying to queue it.
+    // If the wheel is empty, there is nothing to walk through.
     //
 
-    OldState = RtlAtomicCompareExchange32(&NetTcpTimerState,
-                                          TcpTimerQueued,
-                                          TcpTimerNotQueued);
+    if ((Wheel->SocketCount == 0) && (Wheel->CurrentTick <= TargetTick)) {
+        Wheel->CurrentTick = TargetTick + 1;
+        return;
+    }
+
+    while (Wheel->CurrentTick <= TargetTick) {
 
-    if (OldState == TcpTimerNotQueued) {
-        DueTime = KeGetRecentTimeCounter();
-        DueTime += NetTcpTimerPeriod;
-        Status = KeQueueTimer(NetTcpTimer,
-                              TimerQueueSoftWake,
-                              DueTime,
-                              0,
-                              0,
-                              NULL);
+        //
+        // When the lowest level wraps, pull the next slot of each higher
+        // level down, stopping at the first level that did not wrap.
+        //
 
-        if (!KSUCCESS(Status)) {
-            RtlDebugPrint("Error: Failed to queue TCP timer: %d\n", Status);
+        if ((Wheel->CurrentTick & TCP_TIMER_WHEEL_SLOT_MASK) == 0) {
+            for (Level = 1; Level < TCP_TIMER_WHEEL_LEVELS; Level += 1) {
+                Slot = (Wheel->CurrentTick >>
+                        (Level * TCP_TIMER_WHEEL_SLOT_SHIFT)) &
+                       TCP_TIMER_WHEEL_SLOT_MASK;
+
+                SlotList = &(Wheel->Slots[Level][Slot]);
+                if (LIST_EMPTY(SlotList) == FALSE) {
+                    MOVE_LIST(SlotList, &List);
+                    INITIALIZE_LIST_HEAD(SlotList);
+                    while (LIST_EMPTY(&List) == FALSE) {
+                        Socket = LIST_VALUE(List.Next,
+                                            TCP_SOCKET,
+                                            TimerListEntry);
+
+                        LIST_REMOVE(&(Socket->TimerListEntry));
+                        NetpTcpInsertTimerWheelSocket(Wheel, Socket);
+                    }
+                }
+
+                if (Slot != 0) {
+                    break;
+                }
+            }
+        }
+
+        Slot = Wheel->CurrentTick & TCP_TIMER_WHEEL_SLOT_MASK;
+        SlotList = &(Wheel->Slots[0][Slot]);
+        while (LIST_EMPTY(SlotList) == FALSE) {
+            Socket = LIST_VALUE(SlotList->Next, TCP_SOCKET, TimerListEntry);
+            LIST_REMOVE(&(Socket->TimerListEntry));
+            Socket->TimerState = TcpTimerExpired;
+            Socket->TimerDueTick = 0;
+            INSERT_BEFORE(&(Socket->TimerListEntry), ExpiredList);
         }
+
+        Wheel->CurrentTick += 1;
     }
 
     return;
 }
 
 VOID
-NetpTcpArmKeepAliveTimer (
-    ULONGLONG DueTime
+NetpTcpQueueTimerWheel (
+    PTCP_TIMER_WHEEL Wheel,
+    ULONGLONG DueTick
     )
 
 /*++
 
 Routine Description:
 
-    This routine arms or re-arms the keep alive timer to the given due time if
-    it is less than the current due time.
+    This routine queues the timer wheel's timer. This routine assumes the wheel
+    lock is held.
 
 Arguments:
 
-    DueTime - Supplies the value of the time tick counter when the keep alive
-        timer should expire.
+    Wheel - Supplies a pointer to the timer wheel.
+
+    DueTick - Supplies the wheel tick at which the timer should fire. Supply
+        MAX_ULONGLONG to have the next deadline found by scanning the wheel.
 
 Return Value:
 
@@ -8450,38 +9169,59 @@ Return Value:
 
 {
 
-    ULONGLONG CurrentDueTime;
+    ULONGLONG DueTime;
+    ULONG Slot;
     KSTATUS Status;
 
     ASSERT(KeGetRunLevel() == RunLevelLow);
 
     //
-    // If the timer's current due time is 0 (not queued) or greater than the
-    // requested due time, cancel the timer and re-queue it.
+    // Find the next occupied slot in the lowest level. If there is none
+    // before the lowest level wraps, wake up at the wrap to cascade the
+    // higher levels down. Nothing needs to happen for an empty wheel.
     //
 
-    KeAcquireQueuedLock(NetTcpKeepAliveTimerLock);
-    CurrentDueTime = KeGetTimerDueTime(NetTcpKeepAliveTimer);
-    if ((CurrentDueTime == 0) || (CurrentDueTime > DueTime)) {
-        if (NetTcpDebugPrintSequenceNumbers != FALSE) {
-            RtlDebugPrint("TCP: Arming keep alive timer.\n");
+    if (DueTick == MAX_ULONGLONG) {
+        if (Wheel->SocketCount == 0) {
+            return;
         }
 
-        KeCancelTimer(NetTcpKeepAliveTimer);
-        Status = KeQueueTimer(NetTcpKeepAliveTimer,
-                              TimerQueueSoftWake,
-                              DueTime,
-                              0,
-                              0,
-                              NULL);
+        DueTick = Wheel->CurrentTick;
+        while (TRUE) {
+            Slot = DueTick & TCP_TIMER_WHEEL_SLOT_MASK;
+            if (LIST_EMPTY(&(Wheel->Slots[0][Slot])) == FALSE) {
+                break;
+            }
 
-        if (!KSUCCESS(Status)) {
-            RtlDebugPrint("Error: Failed to queue TCP keep alive timer: %d\n",
-                          Status);
+            DueTick += 1;
+            if ((DueTick & TCP_TIMER_WHEEL_SLOT_MASK) == 0) {
+                break;
+            }
         }
+
+    } else if (DueTick < Wheel->CurrentTick) {
+        DueTick = Wheel->CurrentTick;
+    }
+
+    if (DueTick >= Wheel->ArmedTick) {
+        return;
+    }
+
+    Wheel->ArmedTick = DueTick;
+    DueTime = DueTick * NetTcpTimerWheelTickLength;
+    KeCancelTimer(Wheel->Timer);
+    Status = KeQueueTimer(Wheel->Timer,
+                          TimerQueueSoftWake,
+                          DueTime,
+                          0,
+                          0,
+                          NULL);
+
+    if (!KSUCCESS(Status)) {
+        RtlDebugPrint("Error: Failed to queue TCP timer: %d\n", Status);
+        Wheel->ArmedTick = MAX_ULONGLONG;
     }
 
-    KeReleaseQueuedLock(NetTcpKeepAliveTimerLock);
     return;
 }
 
@@ -127,11 +127,45 @@ Module Name:
 #define TCP_ROUND_TRIP_SAMPLE_DENOMINATOR 16
 
 //
-// Define TCP's periodic timer interval, in microseconds.
+// Define the interval, in microseconds, at which a socket that holds timer
+// references but has no specific deadline is serviced.
 //
 
 #define TCP_TIMER_PERIOD (250 * MICROSECONDS_PER_MILLISECOND)
 
+//
+// Define the delay, in microseconds, between a socket taking a timer
+// reference and the timer wheel first servicing it. This doubles as the
+// delayed acknowledgement time.
+//
+
+#define TCP_TIMER_SERVICE_DELAY (40 * MICROSECONDS_PER_MILLISECOND)
+
+//
+// Define the length of a single timer wheel tick, in microseconds.
+//
+
+#define TCP_TIMER_WHEEL_RESOLUTION (10 * MICROSECONDS_PER_MILLISECOND)
+
+//
+// Define the shape of the hierarchical timer wheel. Each level has 64 slots,
+// and each slot in a level spans all the slots of the level below it. With a
+// 10 millisecond tick, four levels cover roughly 46 hours, and anything
+// further out is parked in the last slot and re-cascaded.
+//
+
+#define TCP_TIMER_WHEEL_LEVELS 4
+#define TCP_TIMER_WHEEL_SLOT_SHIFT 6
+#define TCP_TIMER_WHEEL_SLOTS (1 << TCP_TIMER_WHEEL_SLOT_SHIFT)
+#define TCP_TIMER_WHEEL_SLOT_MASK (TCP_TIMER_WHEEL_SLOTS - 1)
+
+//
+// Define the maximum number of timer wheels, and therefore TCP worker
+// threads. One wheel is created per processor up to this limit.
+//
+
+#define TCP_TIMER_WHEEL_MAX_COUNT 16
+
 //
 // Define the length in seconds of the default timeout. This is used as a
 // timeout in the time-wait state and when waiting for a SYN or FIN to be
@@ -172,6 +206,39 @@ Module Name:
 
 #define TCP_DEFAULT_SEND_BUFFER_SIZE (16 * _1KB)
 
+//
+// Define the default lower and upper limits for the send buffer size. Sockets
+// that have not had their send buffer size set explicitly grow their buffers
+// automatically up to the maximum.
+//
+
+#define TCP_DEFAULT_SEND_BUFFER_MINIMUM (4 * _1KB)
+#define TCP_DEFAULT_SEND_BUFFER_MAXIMUM (4 * _1MB)
+
+//
+// Define the default lower and upper limits for the receive window size.
+// Sockets that have not had their receive buffer size set explicitly tune
+// their windows automatically up to the maximum.
+//
+
+#define TCP_DEFAULT_RECEIVE_BUFFER_MINIMUM (4 * _1KB)
+#define TCP_DEFAULT_RECEIVE_BUFFER_MAXIMUM (6 * _1MB)
+
+//
+// Define the default limit on the total amount of send and receive buffer
+// space all TCP sockets together may grow into through auto-tuning.
+//
+
+#define TCP_DEFAULT_BUFFER_MEMORY_LIMIT (64ULL * _1MB)
+
+//
+// Define the factor by which buffers are sized relative to the amount of data
+// measured in flight over one round trip. The extra room lets the connection
+// keep growing rather than settling at its current rate.
+//
+
+#define TCP_BUFFER_AUTO_TUNE_FACTOR 2
+
 //
 // Define the default send minimum size, in bytes.
 //
@@ -342,6 +409,8 @@ Module Name:
 #define TCP_SOCKET_FLAG_NO_DELAY                     0x00000400
 #define TCP_SOCKET_FLAG_WINDOW_SCALING               0x00000800
 #define TCP_SOCKET_FLAG_CONNECT_INTERRUPTED          0x00001000
+#define TCP_SOCKET_FLAG_SEND_BUFFER_LOCKED           0x00002000
+#define TCP_SOCKET_FLAG_RECEIVE_BUFFER_LOCKED        0x00004000
 
 //
 // ------------------------------------------------------ Data Type Definitions
@@ -417,6 +486,48 @@ typedef enum _TCP_STATE {
     TcpStateClosed
 } TCP_STATE, *PTCP_STATE;
 
+typedef enum _TCP_TIMER_STATE {
+    TcpTimerNotQueued,
+    TcpTimerQueued,
+    TcpTimerExpired
+} TCP_TIMER_STATE, *PTCP_TIMER_STATE;
+
+/*++
+
+Structure Description:
+
+    This structure defines a hierarchical timing wheel used to schedule TCP
+    socket timers. A socket sits in at most one slot, keyed by the earliest of
+    its pending deadlines.
+
+Members:
+
+    Lock - Stores a pointer to the lock protecting the wheel and the timer
+        fields of every socket assigned to it.
+
+    Timer - Stores a pointer to the timer that wakes the wheel's worker thread.
+
+    CurrentTick - Stores the next wheel tick to be processed.
+
+    ArmedTick - Stores the wheel tick the timer is currently queued for, or
+        MAX_ULONGLONG if the timer is not queued.
+
+    SocketCount - Stores the number of sockets queued in or being serviced by
+        the wheel.
+
+    Slots - Stores the list heads for each slot of each level of the wheel.
+
+--*/
+
+typedef struct _TCP_TIMER_WHEEL {
+    PQUEUED_LOCK Lock;
+    PKTIMER Timer;
+    ULONGLONG CurrentTick;
+    ULONGLONG ArmedTick;
+    ULONG SocketCount;
+    LIST_ENTRY Slots[TCP_TIMER_WHEEL_LEVELS][TCP_TIMER_WHEEL_SLOTS];
+} TCP_TIMER_WHEEL, *PTCP_TIMER_WHEEL;
+
 /*++
 
 Structure Description:
@@ -427,8 +538,18 @@ Structure Description:
 
     NetSocket - Stores the common core networking parameters.
 
-    ListEntry - Stores pointers to the previous and next sockets on the global
-        list.
+    TimerWheel - Stores a pointer to the timer wheel that services this
+        socket.
+
+    TimerListEntry - Stores pointers to the previous and next sockets in the
+        same timer wheel slot. Protected by the timer wheel lock.
+
+    TimerState - Stores whether the socket is queued in its timer wheel, being
+        serviced by the wheel worker, or neither. Protected by the timer wheel
+        lock.
+
+    TimerDueTick - Stores the timer wheel tick at which the socket is next due
+        for service. Protected by the timer wheel lock.
 
     State - Stores the connection state of the socket.
 
@@ -438,9 +559,8 @@ Structure Description:
     Flags - Stores a bitmask of TCP flags. See TCP_SOCKET_FLAG_* for
         definitions.
 
-    TimerReferenceCount - Supplies the reference count on the global TCP timer.
-        If this value is non-zero, there is a single reference on the global
-        TCP timer.
+    TimerReferenceCount - Supplies the number of pending conditions that need
+        the socket to be periodically serviced by its timer wheel.
 
     SendInitialSequence - Stores the random offset that the sequence numbers
         started at for this socket.
@@ -600,11 +720,24 @@ Structure Description:
     SegmentAllocationSize - Stores the allocation size for each of the send and
         receive TCP segments, including enough size for the header and data.
 
+    BufferCharge - Stores the number of bytes of send buffer and receive
+        window space charged against the global TCP buffer memory limit.
+
+    ReceiveAutoTuneTime - Stores the time counter value when the current
+        receive auto-tuning measurement period began, or zero if no period has
+        started.
+
+    ReceiveAutoTuneBytes - Stores the number of bytes the user has read from
+        the socket during the current receive auto-tuning measurement period.
+
 --*/
 
 typedef struct _TCP_SOCKET {
     NET_SOCKET NetSocket;
-    LIST_ENTRY ListEntry;
+    PTCP_TIMER_WHEEL TimerWheel;
+    LIST_ENTRY TimerListEntry;
+    TCP_TIMER_STATE TimerState;
+    ULONGLONG TimerDueTick;
     TCP_STATE State;
     TCP_STATE PreviousState;
     ULONG Flags;
@@ -657,10 +790,54 @@ typedef struct _TCP_SOCKET {
     ULONG ShutdownTypes;
     LONG OutOfBandData;
     ULONG SegmentAllocationSize;
+    ULONGLONG BufferCharge;
+    ULONGLONG ReceiveAutoTuneTime;
+    ULONG ReceiveAutoTuneBytes;
 } TCP_SOCKET, *PTCP_SOCKET;
 
 /*++
 
+Structure Description:
+
+    This structure stores the system-wide limits on TCP socket buffer sizes.
+
+Members:
+
+    SendMinimum - Stores the smallest send buffer size a socket may have, in
+        bytes.
+
+    SendDefault - Stores the send buffer size new sockets start with, in bytes.
+
+    SendMaximum - Stores the largest send buffer size a socket may have, in
+        bytes.
+
+    ReceiveMinimum - Stores the smallest receive window a socket may have, in
+        bytes.
+
+    ReceiveDefault - Stores the receive window new sockets start with, in
+        bytes.
+
+    ReceiveMaximum - Stores the largest receive window a socket may have, in
+        bytes.
+
+    MemoryLimit - Stores the number of bytes of buffer space all sockets
+        together may grow into through auto-tuning. Explicitly sized and
+        default sized buffers are always granted, but count against the limit.
+
+--*/
+
+typedef struct _TCP_BUFFER_LIMITS {
+    ULONG SendMinimum;
+    ULONG SendDefault;
+    ULONG SendMaximum;
+    ULONG ReceiveMinimum;
+    ULONG ReceiveDefault;
+    ULONG ReceiveMaximum;
+    ULONGLONG MemoryLimit;
+} TCP_BUFFER_LIMITS, *PTCP_BUFFER_LIMITS;
+
+/*++
+
 Structure Description:
 
     This structure stores information about an incoming TCP connection.
@@ -833,6 +1010,14 @@ typedef struct _TCP_HEADER {
 
 extern BOOL NetTcpDebugPrintCongestionControl;
 
+//
+// Store the system-wide buffer limits and the amount of buffer space currently
+// charged against them.
+//
+
+extern TCP_BUFFER_LIMITS NetTcpBufferLimits;
+extern volatile ULONGLONG NetTcpBufferMemoryUsage;
+
 //
 // -------------------------------------------------------- Function Prototypes
 //
@@ -1056,3 +1241,114 @@ Return Value:
 
 --*/
 
+//
+// Buffer sizing routines
+//
+
+VOID
+NetpTcpInitializeSocketBuffers (
+    PTCP_SOCKET Socket
+    );
+
+/*++
+
+Routine Description:
+
+    This routine sets up the send buffer and receive window of a new socket
+    from the system-wide defaults and charges them against the global limit.
+
+Arguments:
+
+    Socket - Supplies a pointer to the new socket.
+
+Return Value:
+
+    None.
+
+--*/
+
+BOOL
+NetpTcpChargeSocketBuffers (
+    PTCP_SOCKET Socket,
+    ULONG SendBufferSize,
+    ULONG ReceiveWindowSize,
+    BOOL Force
+    );
+
+/*++
+
+Routine Description:
+
+    This routine updates the amount of buffer space the given socket has
+    charged against the global TCP buffer memory limit. The caller is
+    responsible for actually applying the new sizes on success.
+
+Arguments:
+
+    Socket - Supplies a pointer to the socket being resized.
+
+    SendBufferSize - Supplies the new total send buffer size, in bytes.
+
+    ReceiveWindowSize - Supplies the new total receive window size, in bytes.
+
+    Force - Supplies a boolean indicating whether the charge should be taken
+        even if it pushes usage over the limit (TRUE) or whether the request
+        should fail instead (FALSE). Shrinking always succeeds.
+
+Return Value:
+
+    TRUE if the charge was taken.
+
+    FALSE if growing the buffers would exceed the global limit.
+
+--*/
+
+VOID
+NetpTcpAutoTuneReceiveWindow (
+    PTCP_SOCKET Socket,
+    ULONG BytesConsumed
+    );
+
+/*++
+
+Routine Description:
+
+    This routine accounts for data the user read out of the socket and, once
+    per round trip, grows the receive window to track the measured
+    bandwidth-delay product. This routine assumes the socket lock is held.
+
+Arguments:
+
+    Socket - Supplies a pointer to the socket.
+
+    BytesConsumed - Supplies the number of bytes just removed from the receive
+        buffer.
+
+Return Value:
+
+    None.
+
+--*/
+
+VOID
+NetpTcpAutoTuneSendBuffer (
+    PTCP_SOCKET Socket
+    );
+
+/*++
+
+Routine Description:
+
+    This routine grows the send buffer so that it can keep the congestion
+    window full. This routine assumes the socket lock is held.
+
+Arguments:
+
+    Socket - Supplies a pointer to the socket.
+
+Return Value:
+
+    None.
+
+--*/
+
@@ -0,0 +1,909 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    tcpbuf.c
+
+Abstract:
+
+    This module implements TCP send and receive buffer sizing. Sockets that
+    have not had their buffer sizes set explicitly grow their receive window
+    to track the measured bandwidth-delay product and their send buffer to
+    keep the congestion window full, all within system-wide limits that can
+    be adjusted at runtime over generic netlink.
+
+Author:
+
+    agent 18-Oct-2026
+
+Environment:
+
+    Kernel
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+//
+// Protocol drivers are supposed to be able to stand on their own (ie be able to
+// be implemented outside the core net library). For the builtin ones, avoid
+// including netcore.h, but still redefine those functions that would otherwise
+// generate imports.
+//
+
+#define NET_API __DLLEXPORT
+
+#include <minoca/kernel/driver.h>
+#include <minoca/net/netdrv.h>
+#include <minoca/net/netlink.h>
+#include "tcp.h"
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+KSTATUS
+NetpTcpNetlinkGetBufferLimits (
+    PNET_SOCKET Socket,
+    PNET_PACKET_BUFFER Packet,
+    PNETLINK_GENERIC_COMMAND_INFORMATION Command
+    );
+
+KSTATUS
+NetpTcpNetlinkSetBufferLimits (
+    PNET_SOCKET Socket,
+    PNET_PACKET_BUFFER Packet,
+    PNETLINK_GENERIC_COMMAND_INFORMATION Command
+    );
+
+KSTATUS
+NetpTcpNetlinkGetValue (
+    PVOID Attributes,
+    ULONG AttributesLength,
+    USHORT Type,
+    PVOID Value,
+    USHORT ValueSize
+    );
+
+BOOL
+NetpTcpValidateBufferLimits (
+    PTCP_BUFFER_LIMITS Limits
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// Store the system-wide buffer limits. Readers take a snapshot of individual
+// fields without the lock; writers serialize on the lock below.
+//
+
+TCP_BUFFER_LIMITS NetTcpBufferLimits = {
+    TCP_DEFAULT_SEND_BUFFER_MINIMUM,
+    TCP_DEFAULT_SEND_BUFFER_SIZE,
+    TCP_DEFAULT_SEND_BUFFER_MAXIMUM,
+    TCP_DEFAULT_RECEIVE_BUFFER_MINIMUM,
+    TCP_DEFAULT_WINDOW_SIZE,
+    TCP_DEFAULT_RECEIVE_BUFFER_MAXIMUM,
+    TCP_DEFAULT_BUFFER_MEMORY_LIMIT
+};
+
+//
+// Store the total number of bytes of buffer space charged by all TCP sockets.
+//
+
+volatile ULONGLONG NetTcpBufferMemoryUsage;
+
+//
+// Store the lock serializing updates to the buffer limits.
+//
+
+PQUEUED_LOCK NetTcpBufferLimitsLock;
+
+NETLINK_GENERIC_COMMAND NetTcpNetlinkCommands[] = {
+    {
+        NETLINK_TCP_COMMAND_GET_BUFFER_LIMITS,
+        0,
+        NetpTcpNetlinkGetBufferLimits
+    },
+
+    {
+        NETLINK_TCP_COMMAND_SET_BUFFER_LIMITS,
+        0,
+        NetpTcpNetlinkSetBufferLimits
+    },
+};
+
+NETLINK_GENERIC_FAMILY_PROPERTIES NetTcpNetlinkFamilyProperties = {
+    NETLINK_GENERIC_FAMILY_PROPERTIES_VERSION,
+    0,
+    sizeof(NETLINK_GENERIC_TCP_NAME),
+    NETLINK_GENERIC_TCP_NAME,
+    NetTcpNetlinkCommands,
+    sizeof(NetTcpNetlinkCommands) / sizeof(NetTcpNetlinkCommands[0]),
+    NULL,
+    0
+};
+
+PNETLINK_GENERIC_FAMILY NetTcpNetlinkFamily = NULL;
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+VOID
+NetpTcpNetlinkInitialize (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine initializes the generic netlink TCP family, which exposes the
+    system-wide TCP buffer limits. Failure is not fatal; the limits simply
+    stay at their defaults.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    KSTATUS Status;
+
+    NetTcpBufferLimitsLock = KeCreateQueuedLock();
+    if (NetTcpBufferLimitsLock == NULL) {
+        return;
+    }
+
+    Status = NetlinkGenericRegisterFamily(&NetTcpNetlinkFamilyProperties,
+                                          &NetTcpNetlinkFamily);
+
+    if (!KSUCCESS(Status)) {
+        RtlDebugPrint("TCP: Failed to register netlink family: %d\n", Status);
+    }
+
+    return;
+}
+
+VOID
+NetpTcpInitializeSocketBuffers (
+    PTCP_SOCKET Socket
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sets up the send buffer and receive window of a new socket
+    from the system-wide defaults and charges them against the global limit.
+
+Arguments:
+
+    Socket - Supplies a pointer to the new socket.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Granularity;
+    ULONG ReceiveMaximum;
+    ULONG ReceiveSize;
+    ULONG Scale;
+
+    //
+    // Pick a window scale large enough that the receive window can grow all
+    // the way to the system maximum. The scale is fixed once the SYN goes
+    // out, so it cannot be raised later when auto-tuning wants more room.
+    //
+
+    ReceiveMaximum = NetTcpBufferLimits.ReceiveMaximum;
+    Scale = TCP_DEFAULT_WINDOW_SCALE;
+    while ((Scale < TCP_MAXIMUM_WINDOW_SCALE) &&
+           (((ULONGLONG)TCP_WINDOW_MASK << Scale) < ReceiveMaximum)) {
+
+        Scale += 1;
+    }
+
+    Granularity = 1 << Scale;
+    ReceiveSize = ALIGN_RANGE_DOWN(NetTcpBufferLimits.ReceiveDefault,
+                                   Granularity);
+
+    if (ReceiveSize == 0) {
+        ReceiveSize = Granularity;
+    }
+
+    Socket->ReceiveWindowScale = Scale;
+    Socket->ReceiveWindowTotalSize = ReceiveSize;
+    Socket->ReceiveWindowFreeSize = ReceiveSize;
+    Socket->SendBufferTotalSize = NetTcpBufferLimits.SendDefault;
+    Socket->SendBufferFreeSize = Socket->SendBufferTotalSize;
+    Socket->ReceiveAutoTuneTime = 0;
+    Socket->ReceiveAutoTuneBytes = 0;
+    NetpTcpChargeSocketBuffers(Socket,
+                               Socket->SendBufferTotalSize,
+                               Socket->ReceiveWindowTotalSize,
+                               TRUE);
+
+    return;
+}
+
+BOOL
+NetpTcpChargeSocketBuffers (
+    PTCP_SOCKET Socket,
+    ULONG SendBufferSize,
+    ULONG ReceiveWindowSize,
+    BOOL Force
+    )
+
+/*++
+
+Routine Description:
+
+    This routine updates the amount of buffer space the given socket has
+    charged against the global TCP buffer memory limit. The caller is
+    responsible for actually applying the new sizes on success.
+
+Arguments:
+
+    Socket - Supplies a pointer to the socket being resized.
+
+    SendBufferSize - Supplies the new total send buffer size, in bytes.
+
+    ReceiveWindowSize - Supplies the new total receive window size, in bytes.
+
+    Force - Supplies a boolean indicating whether the charge should be taken
+        even if it pushes usage over the limit (TRUE) or whether the request
+        should fail instead (FALSE). Shrinking always succeeds.
+
+Return Value:
+
+    TRUE if the charge was taken.
+
+    FALSE if growing the buffers would exceed the global limit.
+
+--*/
+
+{
+
+    ULONGLONG Charge;
+    ULONGLONG Delta;
+    ULONGLONG NewUsage;
+    ULONGLONG OldUsage;
+
+    Charge = (ULONGLONG)SendBufferSize + ReceiveWindowSize;
+    if (Charge == Socket->BufferCharge) {
+        return TRUE;
+    }
+
+    //
+    // Shrinking and forced charges simply adjust the usage. Adding the two's
+    // complement of the delta subtracts it.
+    //
+
+    if ((Charge < Socket->BufferCharge) || (Force != FALSE)) {
+        Delta = Charge - Socket->BufferCharge;
+        RtlAtomicAdd64(&NetTcpBufferMemoryUsage, Delta);
+        Socket->BufferCharge = Charge;
+        return TRUE;
+    }
+
+    //
+    // Growth on behalf of auto-tuning only succeeds if it fits under the
+    // limit.
+    //
+
+    Delta = Charge - Socket->BufferCharge;
+    OldUsage = NetTcpBufferMemoryUsage;
+    while (TRUE) {
+        NewUsage = OldUsage + Delta;
+        if (NewUsage > NetTcpBufferLimits.MemoryLimit) {
+            return FALSE;
+        }
+
+        NewUsage = RtlAtomicCompareExchange64(&NetTcpBufferMemoryUsage,
+                                              NewUsage,
+                                              OldUsage);
+
+        if (NewUsage == OldUsage) {
+            break;
+        }
+
+        OldUsage = NewUsage;
+    }
+
+    Socket->BufferCharge = Charge;
+    return TRUE;
+}
+
+VOID
+NetpTcpAutoTuneReceiveWindow (
+    PTCP_SOCKET Socket,
+    ULONG BytesConsumed
+    )
+
+/*++
+
+Routine Description:
+
+    This routine accounts for data the user read out of the socket and, once
+    per round trip, grows the receive window to track the measured
+    bandwidth-delay product. This routine assumes the socket lock is held.
+
+Arguments:
+
+    Socket - Supplies a pointer to the socket.
+
+    BytesConsumed - Supplies the number of bytes just removed from the receive
+        buffer.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONGLONG CurrentTime;
+    ULONGLONG Elapsed;
+    ULONG Granularity;
+    ULONGLONG Limit;
+    ULONGLONG RoundTripTime;
+    ULONGLONG Target;
+
+    if (((Socket->Flags & TCP_SOCKET_FLAG_RECEIVE_BUFFER_LOCKED) != 0) ||
+        (Socket->State != TcpStateEstablished)) {
+
+        return;
+    }
+
+    CurrentTime = KeGetRecentTimeCounter();
+    if (Socket->ReceiveAutoTuneTime == 0) {
+        Socket->ReceiveAutoTuneTime = CurrentTime;
+        Socket->ReceiveAutoTuneBytes = BytesConsumed;
+        return;
+    }
+
+    Socket->ReceiveAutoTuneBytes += BytesConsumed;
+
+    //
+    // Wait until a full round trip has gone by. Without an estimate yet there
+    // is nothing to measure against.
+    //
+
+    RoundTripTime = Socket->RoundTripTime / TCP_ROUND_TRIP_SAMPLE_DENOMINATOR;
+    if (RoundTripTime == 0) {
+        return;
+    }
+
+    Elapsed = CurrentTime - Socket->ReceiveAutoTuneTime;
+    if (Elapsed < RoundTripTime) {
+        return;
+    }
+
+    //
+    // The bytes read in one round trip approximate the bandwidth-delay
+    // product. If the period stretched well past a round trip then the
+    // application or the sender was idle, and the sample says nothing about
+    // what the path can carry.
+    //
+
+    Target = 0;
+    if (Elapsed < (RoundTripTime * 2)) {
+        Target = (ULONGLONG)Socket->ReceiveAutoTuneBytes *
+                 TCP_BUFFER_AUTO_TUNE_FACTOR;
+    }
+
+    Socket->ReceiveAutoTuneTime = CurrentTime;
+    Socket->ReceiveAutoTuneBytes = 0;
+    if (Target <= Socket->ReceiveWindowTotalSize) {
+        return;
+    }
+
+    //
+    // The window can never grow beyond what the negotiated scale can
+    // advertise.
+    //
+
+    Limit = (ULONGLONG)TCP_WINDOW_MASK << Socket->ReceiveWindowScale;
+    if (Limit > NetTcpBufferLimits.ReceiveMaximum) {
+        Limit = NetTcpBufferLimits.ReceiveMaximum;
+    }
+
+    if (Target > Limit) {
+        Target = Limit;
+    }
+
+    Granularity = 1 << Socket->ReceiveWindowScale;
+    Target = ALIGN_RANGE_DOWN(Target, Granularity);
+    if (Target <= Socket->ReceiveWindowTotalSize) {
+        return;
+    }
+
+    if (NetpTcpChargeSocketBuffers(Socket,
+                                   Socket->SendBufferTotalSize,
+                                   (ULONG)Target,
+                                   FALSE) == FALSE) {
+
+        return;
+    }
+
+    if (NetTcpDebugPrintCongestionControl != FALSE) {
+        RtlDebugPrint("TCP %x: Receive window %d -> %I64d.\n",
+                      Socket,
+                      Socket->ReceiveWindowTotalSize,
+                      Target);
+    }
+
+    Socket->ReceiveWindowFreeSize += (ULONG)Target -
+                                     Socket->ReceiveWindowTotalSize;
+
+    Socket->ReceiveWindowTotalSize = (ULONG)Target;
+    return;
+}
+
+VOID
+NetpTcpAutoTuneSendBuffer (
+    PTCP_SOCKET Socket
+    )
+
+/*++
+
+Routine Description:
+
+    This routine grows the send buffer so that it can keep the congestion
+    window full. This routine assumes the socket lock is held.
+
+Arguments:
+
+    Socket - Supplies a pointer to the socket.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG InFlight;
+    ULONGLONG Target;
+
+    if ((Socket->Flags & TCP_SOCKET_FLAG_SEND_BUFFER_LOCKED) != 0) {
+        return;
+    }
+
+    //
+    // The most that can be in flight is bounded by both the congestion window
+    // and the peer's receive window. Leave room for the application to queue
+    // the next window's worth while the current one is outstanding.
+    //
+
+    InFlight = Socket->CongestionWindowSize;
+    if (InFlight > Socket->SendWindowSize) {
+        InFlight = Socket->SendWindowSize;
+    }
+
+    Target = (ULONGLONG)InFlight * TCP_BUFFER_AUTO_TUNE_FACTOR;
+    if (Target > NetTcpBufferLimits.SendMaximum) {
+        Target = NetTcpBufferLimits.SendMaximum;
+    }
+
+    if (Target <= Socket->SendBufferTotalSize) {
+        return;
+    }
+
+    if (NetpTcpChargeSocketBuffers(Socket,
+                                   (ULONG)Target,
+                                   Socket->ReceiveWindowTotalSize,
+                                   FALSE) == FALSE) {
+
+        return;
+    }
+
+    Socket->SendBufferFreeSize += (ULONG)Target - Socket->SendBufferTotalSize;
+    Socket->SendBufferTotalSize = (ULONG)Target;
+    return;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+KSTATUS
+NetpTcpNetlinkGetBufferLimits (
+    PNET_SOCKET Socket,
+    PNET_PACKET_BUFFER Packet,
+    PNETLINK_GENERIC_COMMAND_INFORMATION Command
+    )
+
+/*++
+
+Routine Description:
+
+    This routine is called to process a TCP netlink request for the current
+    buffer limits. It replies with the limits and the current usage.
+
+Arguments:
+
+    Socket - Supplies a pointer to the socket that received the packet.
+
+    Packet - Supplies a pointer to a structure describing the incoming packet.
+        This structure may be used as a scratch space while this routine
+        executes and the packet travels up the stack, but will not be accessed
+        after this routine returns.
+
+    Command - Supplies a pointer to the command information.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    TCP_BUFFER_LIMITS Limits;
+    ULONG PacketLength;
+    ULONG PayloadLength;
+    PNET_PACKET_BUFFER Reply;
+    KSTATUS Status;
+    ULONGLONG Usage;
+
+    Reply = NULL;
+    KeAcquireQueuedLock(NetTcpBufferLimitsLock);
+    RtlCopyMemory(&Limits, &NetTcpBufferLimits, sizeof(TCP_BUFFER_LIMITS));
+    KeReleaseQueuedLock(NetTcpBufferLimitsLock);
+    Usage = RtlAtomicOr64(&NetTcpBufferMemoryUsage, 0);
+    PayloadLength = (NETLINK_ATTRIBUTE_SIZE(sizeof(ULONG)) * 6) +
+                    (NETLINK_ATTRIBUTE_SIZE(sizeof(ULONGLONG)) * 2);
+
+    PacketLength = NETLINK_HEADER_LENGTH + NETLINK_GENERIC_HEADER_LENGTH +
+                   PayloadLength;
+
+    Status = NetAllocateBuffer(0, PacketLength, 0, NULL, 0, &Reply);
+    if (!KSUCCESS(Status)) {
+        goto NetlinkGetBufferLimitsEnd;
+    }
+
+    Status = NetlinkGenericAppendHeaders(NetTcpNetlinkFamily,
+                                         Reply,
+                                         PayloadLength,
+                                         Command->Message.SequenceNumber,
+                                         0,
+                                         NETLINK_TCP_COMMAND_BUFFER_LIMITS,
+                                         0);
+
+    if (!KSUCCESS(Status)) {
+        goto NetlinkGetBufferLimitsEnd;
+    }
+
+    NetlinkAppendAttribute(Reply,
+                           NETLINK_TCP_ATTRIBUTE_SEND_BUFFER_MINIMUM,
+                           &(Limits.SendMinimum),
+                           sizeof(ULONG));
+
+    NetlinkAppendAttribute(Reply,
+                           NETLINK_TCP_ATTRIBUTE_SEND_BUFFER_DEFAULT,
+                           &(Limits.SendDefault),
+                           sizeof(ULONG));
+
+    NetlinkAppendAttribute(Reply,
+                           NETLINK_TCP_ATTRIBUTE_SEND_BUFFER_MAXIMUM,
+                           &(Limits.SendMaximum),
+                           sizeof(ULONG));
+
+    NetlinkAppendAttribute(Reply,
+                           NETLINK_TCP_ATTRIBUTE_RECEIVE_BUFFER_MINIMUM,
+                           &(Limits.ReceiveMinimum),
+                           sizeof(ULONG));
+
+    NetlinkAppendAttribute(Reply,
+                           NETLINK_TCP_ATTRIBUTE_RECEIVE_BUFFER_DEFAULT,
+                           &(Limits.ReceiveDefault),
+                           sizeof(ULONG));
+
+    NetlinkAppendAttribute(Reply,
+                           NETLINK_TCP_ATTRIBUTE_RECEIVE_BUFFER_MAXIMUM,
+                           &(Limits.ReceiveMaximum),
+                           sizeof(ULONG));
+
+    NetlinkAppendAttribute(Reply,
+                           NETLINK_TCP_ATTRIBUTE_MEMORY_LIMIT,
+                           &(Limits.MemoryLimit),
+                           sizeof(ULONGLONG));
+
+    Status = NetlinkAppendAttribute(Reply,
+                                    NETLINK_TCP_ATTRIBUTE_MEMORY_USAGE,
+                                    &Usage,
+                                    sizeof(ULONGLONG));
+
+    if (!KSUCCESS(Status)) {
+        goto NetlinkGetBufferLimitsEnd;
+    }
+
+    Status = NetlinkGenericSendCommand(NetTcpNetlinkFamily,
+                                       Reply,
+                                       Command->Message.SourceAddress);
+
+NetlinkGetBufferLimitsEnd:
+    if (Reply != NULL) {
+        NetFreeBuffer(Reply);
+    }
+
+    return Status;
+}
+
+KSTATUS
+NetpTcpNetlinkSetBufferLimits (
+    PNET_SOCKET Socket,
+    PNET_PACKET_BUFFER Packet,
+    PNETLINK_GENERIC_COMMAND_INFORMATION Command
+    )
+
+/*++
+
+Routine Description:
+
+    This routine is called to process a TCP netlink request to change the
+    buffer limits. Attributes not present in the message keep their current
+    values. New limits apply to sockets created afterwards and to any further
+    auto-tuning of existing sockets.
+
+Arguments:
+
+    Socket - Supplies a pointer to the socket that received the packet.
+
+    Packet - Supplies a pointer to a structure describing the incoming packet.
+        This structure may be used as a scratch space while this routine
+        executes and the packet travels up the stack, but will not be accessed
+        after this routine returns.
+
+    Command - Supplies a pointer to the command information.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    PVOID Attributes;
+    ULONG AttributesLength;
+    TCP_BUFFER_LIMITS Limits;
+    KSTATUS Status;
+
+    Status = PsCheckPermission(PERMISSION_NET_ADMINISTRATOR);
+    if (!KSUCCESS(Status)) {
+        return Status;
+    }
+
+    Attributes = Packet->Buffer + Packet->DataOffset;
+    AttributesLength = Packet->FooterOffset - Packet->DataOffset;
+    KeAcquireQueuedLock(NetTcpBufferLimitsLock);
+    RtlCopyMemory(&Limits, &NetTcpBufferLimits, sizeof(TCP_BUFFER_LIMITS));
+    Status = NetpTcpNetlinkGetValue(Attributes,
+                                    AttributesLength,
+                                    NETLINK_TCP_ATTRIBUTE_SEND_BUFFER_MINIMUM,
+                                    &(Limits.SendMinimum),
+                                    sizeof(ULONG));
+
+    if (!KSUCCESS(Status)) {
+        goto NetlinkSetBufferLimitsEnd;
+    }
+
+    Status = NetpTcpNetlinkGetValue(Attributes,
+                                    AttributesLength,
+                                    NETLINK_TCP_ATTRIBUTE_SEND_BUFFER_DEFAULT,
+                                    &(Limits.SendDefault),
+                                    sizeof(ULONG));
+
+    if (!KSUCCESS(Status)) {
+        goto NetlinkSetBufferLimitsEnd;
+    }
+
+    Status = NetpTcpNetlinkGetValue(Attributes,
+                                    AttributesLength,
+                                    NETLINK_TCP_ATTRIBUTE_SEND_BUFFER_MAXIMUM,
+                                    &(Limits.SendMaximum),
+                                    sizeof(ULONG));
+
+    if (!KSUCCESS(Status)) {
+        goto NetlinkSetBufferLimitsEnd;
+    }
+
+    Status = NetpTcpNetlinkGetValue(
+                                 Attributes,
+                                 AttributesLength,
+                                 NETLINK_TCP_ATTRIBUTE_RECEIVE_BUFFER_MINIMUM,
+                                 &(Limits.ReceiveMinimum),
+                                 sizeof(ULONG));
+
+    if (!KSUCCESS(Status)) {
+        goto NetlinkSetBufferLimitsEnd;
+    }
+
+    Status = NetpTcpNetlinkGetValue(
+                                 Attributes,
+                                 AttributesLength,
+                                 NETLINK_TCP_ATTRIBUTE_RECEIVE_BUFFER_DEFAULT,
+                                 &(Limits.ReceiveDefault),
+                                 sizeof(ULONG));
+
+    if (!KSUCCESS(Status)) {
+        goto NetlinkSetBufferLimitsEnd;
+    }
+
+    Status = NetpTcpNetlinkGetValue(
+                                 Attributes,
+                                 AttributesLength,
+                                 NETLINK_TCP_ATTRIBUTE_RECEIVE_BUFFER_MAXIMUM,
+                                 &(Limits.ReceiveMaximum),
+                                 sizeof(ULONG));
+
+    if (!KSUCCESS(Status)) {
+        goto NetlinkSetBufferLimitsEnd;
+    }
+
+    Status = NetpTcpNetlinkGetValue(Attributes,
+                                    AttributesLength,
+                                    NETLINK_TCP_ATTRIBUTE_MEMORY_LIMIT,
+                                    &(Limits.MemoryLimit),
+                                    sizeof(ULONGLONG));
+
+    if (!KSUCCESS(Status)) {
+        goto NetlinkSetBufferLimitsEnd;
+    }
+
+    if (NetpTcpValidateBufferLimits(&Limits) == FALSE) {
+        Status = STATUS_INVALID_PARAMETER;
+        goto NetlinkSetBufferLimitsEnd;
+    }
+
+    RtlCopyMemory(&NetTcpBufferLimits, &Limits, sizeof(TCP_BUFFER_LIMITS));
+
+NetlinkSetBufferLimitsEnd:
+    KeReleaseQueuedLock(NetTcpBufferLimitsLock);
+    return Status;
+}
+
+KSTATUS
+NetpTcpNetlinkGetValue (
+    PVOID Attributes,
+    ULONG AttributesLength,
+    USHORT Type,
+    PVOID Value,
+    USHORT ValueSize
+    )
+
+/*++
+
+Routine Description:
+
+    This routine reads an optional fixed size integer attribute.
+
+Arguments:
+
+    Attributes - Supplies a pointer to the start of the attributes.
+
+    AttributesLength - Supplies the length of the attributes, in bytes.
+
+    Type - Supplies the attribute type to look for.
+
+    Value - Supplies a pointer where the attribute value is copied if the
+        attribute is present. This is left untouched otherwise.
+
+    ValueSize - Supplies the expected size of the attribute data, in bytes.
+
+Return Value:
+
+    STATUS_SUCCESS if the attribute was read or is not present.
+
+    STATUS_DATA_LENGTH_MISMATCH if the attribute is the wrong size.
+
+--*/
+
+{
+
+    PVOID Data;
+    USHORT DataLength;
+    KSTATUS Status;
+
+    Status = NetlinkGetAttribute(Attributes,
+                                 AttributesLength,
+                                 Type,
+                                 &Data,
+                                 &DataLength);
+
+    if (!KSUCCESS(Status)) {
+        return STATUS_SUCCESS;
+    }
+
+    if (DataLength != ValueSize) {
+        return STATUS_DATA_LENGTH_MISMATCH;
+    }
+
+    RtlCopyMemory(Value, Data, ValueSize);
+    return STATUS_SUCCESS;
+}
+
+BOOL
+NetpTcpValidateBufferLimits (
+    PTCP_BUFFER_LIMITS Limits
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines whether or not a set of buffer limits is
+    internally consistent.
+
+Arguments:
+
+    Limits - Supplies a pointer to the proposed limits.
+
+Return Value:
+
+    TRUE if the limits are valid.
+
+    FALSE if the limits are out of order or out of range.
+
+--*/
+
+{
+
+    if ((Limits->SendMinimum == 0) ||
+        (Limits->SendMinimum > Limits->SendDefault) ||
+        (Limits->SendDefault > Limits->SendMaximum) ||
+        (Limits->SendMaximum > SOCKET_OPTION_MAX_ULONG)) {
+
+        return FALSE;
+    }
+
+    if ((Limits->ReceiveMinimum < TCP_MINIMUM_WINDOW_SIZE) ||
+        (Limits->ReceiveMinimum > Limits->ReceiveDefault) ||
+        (Limits->ReceiveDefault > Limits->ReceiveMaximum) ||
+        (Limits->ReceiveMaximum > TCP_MAXIMUM_WINDOW_SIZE)) {
+
+        return FALSE;
+    }
+
+    if (Limits->MemoryLimit == 0) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
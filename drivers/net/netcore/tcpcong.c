@@ -340,6 +340,12 @@ Return Value:
                                   Socket->CongestionWindowSize);
                 }
             }
+
+            //
+            // Let the send buffer keep pace with the larger window.
+            //
+
+            NetpTcpAutoTuneSendBuffer(Socket);
         }
 
     //
@@ -48,6 +48,14 @@ Module Name:
 
 #define SPECIAL_URANDOM_BUFFER_SIZE 2048
 
+//
+// Define how many bytes a per-processor generator can hand out, and how many
+// seconds it can run, before it pulls a fresh key from the Fortuna pools.
+//
+
+#define SPECIAL_RANDOM_RESEED_BYTES (1024 * 1024)
+#define SPECIAL_RANDOM_RESEED_INTERVAL 60
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -63,6 +71,34 @@ typedef enum _SPECIAL_DEVICE_TYPE {
 
 /*++
 
+Structure Description:
+
+    This structure defines a per-processor random generator. It is only ever
+    touched by its own processor at dispatch level, so it needs no lock.
+
+Members:
+
+    Context - Stores the ChaCha20 context generating the output.
+
+    BytesGenerated - Stores the number of bytes generated since the last
+        reseed.
+
+    ReseedTime - Stores the recent time counter value at the last reseed.
+
+    Seeded - Stores a boolean indicating whether or not the generator has
+        been keyed from the Fortuna pools yet.
+
+--*/
+
+typedef struct _SPECIAL_RANDOM_GENERATOR {
+    CHACHA20_CONTEXT Context;
+    UINTN BytesGenerated;
+    ULONGLONG ReseedTime;
+    BOOL Seeded;
+} SPECIAL_RANDOM_GENERATOR, *PSPECIAL_RANDOM_GENERATOR;
+
+/*++
+
 Structure Description:
 
     This structure defines the context for a pseudo-random device.
@@ -78,6 +114,14 @@ Structure Description:
     InterfaceRegistered - Stores a pointer indicating whether or not the
         interface has been registered.
 
+    Generators - Stores an array of per-processor generators, which are
+        keyed from the Fortuna context and produce the actual output.
+
+    GeneratorCount - Stores the number of elements in the generators array.
+
+    ReseedInterval - Stores the number of time counter ticks a generator can
+        go before reseeding.
+
 --*/
 
 typedef struct _SPECIAL_PSEUDO_RANDOM_DEVICE {
@@ -85,6 +129,9 @@ typedef struct _SPECIAL_PSEUDO_RANDOM_DEVICE {
     KSPIN_LOCK Lock;
     INTERFACE_PSEUDO_RANDOM_SOURCE Interface;
     BOOL InterfaceRegistered;
+    PSPECIAL_RANDOM_GENERATOR Generators;
+    ULONG GeneratorCount;
+    ULONGLONG ReseedInterval;
 } SPECIAL_PSEUDO_RANDOM_DEVICE, *PSPECIAL_PSEUDO_RANDOM_DEVICE;
 
 /*++
@@ -212,6 +259,13 @@ SpecialPseudoRandomGetBytes (
     UINTN Length
     );
 
+VOID
+SpecialPseudoRandomGenerate (
+    PSPECIAL_PSEUDO_RANDOM_DEVICE PseudoRandom,
+    PVOID Data,
+    UINTN Length
+    );
+
 VOID
 SpecialDeviceAddReference (
     PSPECIAL_DEVICE Device
@@ -334,6 +388,7 @@ Return Value:
     UINTN AllocationSize;
     PSPECIAL_DEVICE Context;
     SPECIAL_DEVICE_TYPE DeviceType;
+    ULONG GeneratorCount;
     PSPECIAL_PSEUDO_RANDOM_DEVICE PseudoRandom;
     KSTATUS Status;
 
@@ -381,12 +436,15 @@ Return Value:
 
     //
     // The urandom special device must be created non-paged as entropy can be
-    // added from dispatch level.
+    // added from dispatch level. The per-processor generators come along in
+    // the same allocation.
     //
 
     if (DeviceType == SpecialDevicePseudoRandom) {
+        GeneratorCount = KeGetActiveProcessorCount();
         AllocationSize = sizeof(SPECIAL_DEVICE) +
-                         sizeof(SPECIAL_PSEUDO_RANDOM_DEVICE);
+                         sizeof(SPECIAL_PSEUDO_RANDOM_DEVICE) +
+                         (GeneratorCount * sizeof(SPECIAL_RANDOM_GENERATOR));
 
         Context = MmAllocateNonPagedPool(AllocationSize,
                                          SPECIAL_DEVICE_ALLOCATION_TAG);
@@ -404,6 +462,13 @@ Return Value:
                             HlQueryTimeCounterFrequency());
 
         KeInitializeSpinLock(&(PseudoRandom->Lock));
+        PseudoRandom->Generators =
+                                  (PSPECIAL_RANDOM_GENERATOR)(PseudoRandom + 1);
+
+        PseudoRandom->GeneratorCount = GeneratorCount;
+        PseudoRandom->ReseedInterval = HlQueryTimeCounterFrequency() *
+                                       SPECIAL_RANDOM_RESEED_INTERVAL;
+
         RtlCopyMemory(&(PseudoRandom->Interface),
                       &SpecialPseudoRandomInterfaceTemplate,
                       sizeof(INTERFACE_PSEUDO_RANDOM_SOURCE));
@@ -1117,9 +1182,7 @@ Return Value:
 
         } else {
             OldRunLevel = KeRaiseRunLevel(RunLevelDispatch);
-            KeAcquireSpinLock(&(PseudoRandom->Lock));
-            CyFortunaGetRandomBytes(Fortuna, Buffer, Size);
-            KeReleaseSpinLock(&(PseudoRandom->Lock));
+            SpecialPseudoRandomGenerate(PseudoRandom, Buffer, Size);
             KeLowerRunLevel(OldRunLevel);
             Status = MmCopyIoBufferData(IoBuffer,
                                         Buffer,
@@ -1287,13 +1350,98 @@ Return Value:
 
     PseudoRandom = Device->U.PseudoRandom;
     OldRunLevel = KeRaiseRunLevel(RunLevelDispatch);
-    KeAcquireSpinLock(&(PseudoRandom->Lock));
-    CyFortunaGetRandomBytes(&(PseudoRandom->FortunaContext), Data, Length);
-    KeReleaseSpinLock(&(PseudoRandom->Lock));
+    SpecialPseudoRandomGenerate(PseudoRandom, Data, Length);
     KeLowerRunLevel(OldRunLevel);
     return;
 }
 
+VOID
+SpecialPseudoRandomGenerate (
+    PSPECIAL_PSEUDO_RANDOM_DEVICE PseudoRandom,
+    PVOID Data,
+    UINTN Length
+    )
+
+/*++
+
+Routine Description:
+
+    This routine generates random data from the current processor's ChaCha20
+    generator, reseeding it from the Fortuna pools when it has produced enough
+    data or has gone long enough. After every request the generator is rekeyed
+    from its own output so that a later compromise of its state cannot
+    recover data already handed out. This routine must be called at dispatch
+    level.
+
+Arguments:
+
+    PseudoRandom - Supplies a pointer to the pseudo-random device.
+
+    Data - Supplies a pointer where the random data will be returned. This
+        buffer must be non-paged.
+
+    Length - Supplies the number of bytes of random data to return.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONGLONG CurrentTime;
+    PSPECIAL_RANDOM_GENERATOR Generator;
+    UCHAR Key[CHACHA20_KEY_SIZE];
+    ULONG Processor;
+
+    ASSERT(KeGetRunLevel() == RunLevelDispatch);
+
+    //
+    // Processors that came online after the device was created go straight
+    // to the shared Fortuna context.
+    //
+
+    Processor = KeGetCurrentProcessorNumber();
+    if (Processor >= PseudoRandom->GeneratorCount) {
+        KeAcquireSpinLock(&(PseudoRandom->Lock));
+        CyFortunaGetRandomBytes(&(PseudoRandom->FortunaContext), Data, Length);
+        KeReleaseSpinLock(&(PseudoRandom->Lock));
+        return;
+    }
+
+    Generator = &(PseudoRandom->Generators[Processor]);
+    CurrentTime = KeGetRecentTimeCounter();
+    if ((Generator->Seeded == FALSE) ||
+        (Generator->BytesGenerated >= SPECIAL_RANDOM_RESEED_BYTES) ||
+        ((CurrentTime - Generator->ReseedTime) >=
+         PseudoRandom->ReseedInterval)) {
+
+        KeAcquireSpinLock(&(PseudoRandom->Lock));
+        CyFortunaGetRandomBytes(&(PseudoRandom->FortunaContext),
+                                Key,
+                                sizeof(Key));
+
+        KeReleaseSpinLock(&(PseudoRandom->Lock));
+        CyChaCha20Initialize(&(Generator->Context), Key, NULL, 0);
+        Generator->BytesGenerated = 0;
+        Generator->ReseedTime = CurrentTime;
+        Generator->Seeded = TRUE;
+    }
+
+    CyChaCha20Crypt(&(Generator->Context), NULL, Data, Length);
+    Generator->BytesGenerated += Length;
+
+    //
+    // Replace the key with fresh key stream, forgetting the old one.
+    //
+
+    CyChaCha20Crypt(&(Generator->Context), NULL, Key, sizeof(Key));
+    CyChaCha20Initialize(&(Generator->Context), Key, NULL, 0);
+    RtlZeroMemory(Key, sizeof(Key));
+    return;
+}
+
 VOID
 SpecialDeviceAddReference (
     PSPECIAL_DEVICE Device
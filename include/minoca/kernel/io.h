@@ -6316,6 +6316,32 @@ Return Value:
 
 --*/
 
+INTN
+IoSysSocketPerformMultipleIo (
+    PVOID SystemCallParameter
+    );
+
+/*++
+
+Routine Description:
+
+    This routine handles the system call that sends or receives several
+    messages on a socket, looking up the socket only once.
+
+Arguments:
+
+    SystemCallParameter - Supplies a pointer to the parameters supplied with
+        the system call. This structure will be a stack-local copy of the
+        actual parameters passed from user-mode.
+
+Return Value:
+
+    STATUS_SUCCESS or positive integer on success.
+
+    Error status code on failure.
+
+--*/
+
 INTN
 IoSysSocketGetSetInformation (
     PVOID SystemCallParameter
@@ -7499,6 +7525,45 @@ Return Value:
 
 --*/
 
+KSTATUS
+IoGetSetStreamBufferSize (
+    PSTREAM_BUFFER StreamBuffer,
+    BOOL Set,
+    PULONG Size
+    );
+
+/*++
+
+Routine Description:
+
+    This routine gets or sets the capacity of a stream buffer. Data already in
+    the buffer is preserved across a resize.
+
+Arguments:
+
+    StreamBuffer - Supplies a pointer to the stream buffer.
+
+    Set - Supplies a boolean indicating whether to get the current capacity
+        (FALSE) or set a new one (TRUE).
+
+    Size - Supplies a pointer that on input contains the requested capacity
+        when setting. The requested size is rounded up to a whole number of
+        pages. On output, returns the resulting capacity in bytes.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    STATUS_INVALID_PARAMETER if the requested size is larger than the maximum
+    allowed.
+
+    STATUS_RESOURCE_IN_USE if the buffer currently holds more data than would
+    fit in the requested capacity.
+
+    STATUS_INSUFFICIENT_RESOURCES on allocation failure.
+
+--*/
+
 PIO_OBJECT_STATE
 IoStreamBufferGetIoObjectState (
     PSTREAM_BUFFER StreamBuffer
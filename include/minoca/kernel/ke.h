@@ -171,6 +171,19 @@ Module Name:
 
 #define DPC_FLAG_QUEUED_ON_PROCESSOR 0x00000001
 
+//
+// Define the number of free kernel stacks each processor keeps for itself.
+//
+
+#define PROCESSOR_KERNEL_STACK_CACHE_SIZE 4
+
+//
+// Define the number of processors whose running thread is published in the
+// user shared data page.
+//
+
+#define USER_SHARED_DATA_MAX_PROCESSORS 64
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -647,6 +660,13 @@ Structure Description:
 
     CpuVersion - Stores the processor identification information for this CPU.
 
+    KernelStackCache - Stores an array of free default-sized kernel stacks
+        that this processor can hand out without touching the global cache.
+        This is only accessed by the owning processor at dispatch level.
+
+    KernelStackCacheCount - Stores the number of valid entries in the kernel
+        stack cache.
+
 --*/
 
 typedef struct _PROCESSOR_BLOCK PROCESSOR_BLOCK, *PPROCESSOR_BLOCK;
@@ -682,6 +702,8 @@ struct _PROCESSOR_BLOCK {
     PVOID SwapPage;
     UINTN NmiCount;
     PROCESSOR_IDENTIFICATION CpuVersion;
+    PVOID KernelStackCache[PROCESSOR_KERNEL_STACK_CACHE_SIZE];
+    ULONG KernelStackCacheCount;
 };
 
 /*++
@@ -931,6 +953,27 @@ struct _DPC {
 
 /*++
 
+Structure Description:
+
+    This structure describes the thread running on a processor, as published
+    to user mode in the user shared data page.
+
+Members:
+
+    ProcessId - Stores the ID of the process owning the running thread.
+
+    ThreadId - Stores the ID of the running thread. Thread IDs are allocated
+        system-wide, so this alone identifies the thread.
+
+--*/
+
+typedef struct _USER_SHARED_PROCESSOR {
+    volatile PROCESS_ID ProcessId;
+    volatile THREAD_ID ThreadId;
+} USER_SHARED_PROCESSOR, *PUSER_SHARED_PROCESSOR;
+
+/*++
+
 Structure Description:
 
     This structure defines the contents of the user shared data page, which is
@@ -974,6 +1017,15 @@ Structure Description:
     ProcessorFeatures - Stores a bitfield of architecture-specific feature
         flags.
 
+    ProcessorCount - Stores the number of valid entries in the running thread
+        array.
+
+    RunningThread - Stores the process and thread IDs of the thread currently
+        running on each processor. User mode locks use this to decide whether
+        it is worth spinning while the owner of a lock finishes with it. The
+        values are only a hint, as they may change at any time. Only IDs are
+        published here, never addresses.
+
 --*/
 
 typedef struct _USER_SHARED_DATA {
@@ -988,6 +1040,8 @@ typedef struct _USER_SHARED_DATA {
     volatile ULONGLONG TickCount;
     volatile ULONGLONG TickCount2;
     ULONG ProcessorFeatures;
+    ULONG ProcessorCount;
+    USER_SHARED_PROCESSOR RunningThread[USER_SHARED_DATA_MAX_PROCESSORS];
 } USER_SHARED_DATA, *PUSER_SHARED_DATA;
 
 //
@@ -2809,6 +2863,32 @@ Return Value:
 
 --*/
 
+INTN
+KeSysGetRandomBytes (
+    PVOID SystemCallParameter
+    );
+
+/*++
+
+Routine Description:
+
+    This routine implements the system call for getting random bytes directly
+    from the system's random source, without going through a device handle.
+
+Arguments:
+
+    SystemCallParameter - Supplies a pointer to the parameters supplied with
+        the system call. This structure will be a stack-local copy of the
+        actual parameters passed from user-mode.
+
+Return Value:
+
+    STATUS_SUCCESS or positive integer on success.
+
+    Error status code on failure.
+
+--*/
+
 INTN
 KeSysDelayExecution (
     PVOID SystemCallParameter
@@ -208,6 +208,14 @@ Module Name:
 
 #define SOCKET_IO_DONT_ROUTE 0x00000100
 
+//
+// This flag is used by multiple message I/O. It requests that only the first
+// message block, and that the remaining messages be processed only if they
+// can complete without blocking.
+//
+
+#define SOCKET_IO_WAIT_FOR_ONE 0x00000200
+
 //
 // Define common internet protocol numbers, as defined by the IANA.
 //
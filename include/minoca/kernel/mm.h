@@ -3955,6 +3955,38 @@ Return Value:
 
 --*/
 
+VOID
+MmGetResidentPageCounts (
+    PADDRESS_SPACE AddressSpace,
+    PUINTN SharedPages,
+    PUINTN PrivatePages
+    );
+
+/*++
+
+Routine Description:
+
+    This routine counts the pages currently mapped into the given address
+    space, split by whether or not the physical page can also be mapped by
+    other processes. This routine must be called at low level.
+
+Arguments:
+
+    AddressSpace - Supplies a pointer to the address space to examine.
+
+    SharedPages - Supplies a pointer where the number of mapped pages that may
+        be shared with other processes (page cache pages and pages inherited
+        from a parent) will be returned.
+
+    PrivatePages - Supplies a pointer where the number of mapped pages owned
+        solely by this address space will be returned.
+
+Return Value:
+
+    None.
+
+--*/
+
 KSTATUS
 MmUserModeDebuggerWrite (
     PVOID KernelBuffer,
@@ -436,6 +436,7 @@ Module Name:
 #define THREAD_FLAG_FREE_USER_STACK 0x0004
 #define THREAD_FLAG_EXITING         0x0008
 #define THREAD_FLAG_RESTORE_SIGNALS 0x0010
+#define THREAD_FLAG_SUPPLIED_STACK  0x0020
 
 //
 // Define thread FPU flags.
@@ -463,7 +464,7 @@ Module Name:
 #define PS_GROUP_ALLOCATION_TAG 0x70477350 // 'pGsP'
 #define PS_UTS_ALLOCATION_TAG 0x74557350 // 'tUsP'
 
-#define PROCESS_INFORMATION_VERSION 1
+#define PROCESS_INFORMATION_VERSION 2
 
 #define PROCESS_DEBUG_MODULE_CHANGE_VERSION 1
 
@@ -531,6 +532,14 @@ Module Name:
 
 #define FORK_FLAG_REALM_UTS 0x00000001
 
+//
+// Set this flag to have the child process borrow the parent's address space
+// rather than receiving a copy of it. The calling thread is suspended until
+// the child executes a new image or exits.
+//
+
+#define FORK_FLAG_VFORK 0x00000002
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -1358,6 +1367,17 @@ Structure Description:
     ProcessGroup - Stores a pointer directly to the process group this process
         belongs to.
 
+    AddressSpace - Stores a pointer to the address space the process is
+        currently running in.
+
+    VforkAddressSpace - Stores a pointer to the process' own address space
+        while it runs in its parent's address space after a vfork. This is
+        NULL for all other processes.
+
+    VforkEvent - Stores an optional pointer to the event a vfork parent waits
+        on. It is signaled when the child stops borrowing the parent's
+        address space by executing an image or exiting.
+
     HandleTable - Stores a pointer to the handle table for this process.
 
     Paths - Stores the path root information for this process.
@@ -1457,6 +1477,8 @@ struct _KPROCESS {
     PROCESS_IDENTIFIERS Identifiers;
     PPROCESS_GROUP ProcessGroup;
     PADDRESS_SPACE AddressSpace;
+    PADDRESS_SPACE VforkAddressSpace;
+    PVOID VforkEvent;
     PHANDLE_TABLE HandleTable;
     PROCESS_PATHS Paths;
     PPROCESS_ENVIRONMENT Environment;
@@ -1782,6 +1804,15 @@ Structure Description:
 
     ImageSize - Stores the size, in bytes, of the process's main image.
 
+    SharedResidentSet - Stores the number of pages mapped in the process that
+        may also be mapped by other processes, such as clean page cache pages
+        backing file mappings and pages still inherited from a parent across
+        fork.
+
+    PrivateResidentSet - Stores the number of pages mapped in the process that
+        belong to it alone, such as anonymous memory and pages of private file
+        mappings that have been written to.
+
     StartTime - Stores the process start time as a system time.
 
     ResourceUsage - Stores the resource usage of the process.
@@ -1822,6 +1853,8 @@ typedef struct _PROCESS_INFORMATION {
     ULONG Flags;
     PROCESS_STATE State;
     UINTN ImageSize;
+    UINTN SharedResidentSet;
+    UINTN PrivateResidentSet;
     ULONGLONG StartTime;
     RESOURCE_USAGE ResourceUsage;
     RESOURCE_USAGE ChildResourceUsage;
@@ -153,6 +153,28 @@ Module Name:
 #define SYS_IO_FLAG_WRITE 0x00000001
 #define SYS_IO_FLAG_MASK  0x00000001
 
+//
+// Define the maximum number of messages that can be handed to a single
+// multiple socket I/O system call.
+//
+
+#define SYS_SOCKET_IO_MAX_MESSAGES 1024
+
+//
+// Define flags for the get random bytes system call.
+//
+
+#define SYS_RANDOM_FLAG_NON_BLOCKING 0x00000001
+#define SYS_RANDOM_FLAG_RANDOM       0x00000002
+#define SYS_RANDOM_FLAG_MASK         0x00000003
+
+//
+// Define the maximum number of bytes returned by a single get random bytes
+// system call.
+//
+
+#define SYS_RANDOM_MAX_SIZE (32 * 1024 * 1024)
+
 //
 // Define flush flags.
 //
@@ -357,6 +379,8 @@ typedef enum _SYSTEM_CALL_NUMBER {
     SystemCallSetITimer,
     SystemCallSetResourceLimit,
     SystemCallSetBreak,
+    SystemCallSocketPerformMultipleIo,
+    SystemCallGetRandomBytes,
     SystemCallCount
 } SYSTEM_CALL_NUMBER, *PSYSTEM_CALL_NUMBER;
 
@@ -410,6 +434,8 @@ typedef enum _FILE_CONTROL_COMMAND {
     FileControlCommandSetDirectoryFlag,
     FileControlCommandCloseFrom,
     FileControlCommandGetPath,
+    FileControlCommandGetPipeSize,
+    FileControlCommandSetPipeSize,
     FileControlCommandCount
 } FILE_CONTROL_COMMAND, *PFILE_CONTROL_COMMAND;
 
@@ -1176,6 +1202,64 @@ typedef struct _SYSTEM_CALL_SOCKET_PERFORM_VECTORED_IO {
 
 /*++
 
+Structure Description:
+
+    This structure defines a single message within a multiple socket I/O
+    system call.
+
+Members:
+
+    Parameters - Stores a required pointer to the socket I/O parameters for
+        this message. The bytes completed and returned flags are written back
+        to this structure.
+
+    VectorArray - Stores a pointer to an array of I/O vectors describing the
+        message data.
+
+    VectorCount - Stores the number of elements in the vector array.
+
+--*/
+
+typedef struct _SOCKET_IO_MESSAGE {
+    PSOCKET_IO_PARAMETERS Parameters;
+    PIO_VECTOR VectorArray;
+    UINTN VectorCount;
+} SOCKET_IO_MESSAGE, *PSOCKET_IO_MESSAGE;
+
+/*++
+
+Structure Description:
+
+    This structure defines the system call parameters for sending or receiving
+    several messages on a socket in a single call.
+
+Members:
+
+    Socket - Stores the socket to use.
+
+    Messages - Stores a pointer to the array of messages to send or receive.
+        Whether each message is a send or a receive is determined by the I/O
+        flags in its parameters.
+
+    MessageCount - Stores the number of elements in the message array. This
+        must not exceed SYS_SOCKET_IO_MAX_MESSAGES.
+
+    MessagesCompleted - Stores the number of messages that were fully
+        processed, returned by the kernel. If this is non-zero, the system
+        call succeeds even if a later message failed.
+
+--*/
+
+typedef struct _SYSTEM_CALL_SOCKET_PERFORM_MULTIPLE_IO {
+    HANDLE Socket;
+    PSOCKET_IO_MESSAGE Messages;
+    UINTN MessageCount;
+    UINTN MessagesCompleted;
+} SYSCALL_STRUCT SYSTEM_CALL_SOCKET_PERFORM_MULTIPLE_IO,
+    *PSYSTEM_CALL_SOCKET_PERFORM_MULTIPLE_IO;
+
+/*++
+
 Structure Description:
 
     This structure defines the parameters of a file lock.
@@ -1245,6 +1329,9 @@ Structure Description:
     Owner - Stores the ID of the process to receive signals on asynchronous
         I/O events.
 
+    PipeSize - Stores the requested capacity of a pipe's buffer on input for
+        set operations. On output, returns the pipe's buffer capacity.
+
 --*/
 
 typedef union _FILE_CONTROL_PARAMETERS_UNION {
@@ -1254,6 +1341,7 @@ typedef union _FILE_CONTROL_PARAMETERS_UNION {
     ULONG Flags;
     FILE_PATH FilePath;
     PROCESS_ID Owner;
+    ULONG PipeSize;
 } FILE_CONTROL_PARAMETERS_UNION, *PFILE_CONTROL_PARAMETERS_UNION;
 
 /*++
@@ -2512,6 +2600,34 @@ typedef struct _SYSTEM_CALL_SET_RESOURCE_LIMIT {
 
 /*++
 
+Structure Description:
+
+    This structure defines the system call parameters for getting random
+    bytes directly from the kernel's random source.
+
+Members:
+
+    Buffer - Stores a pointer to the user mode buffer where the random data
+        will be returned.
+
+    Size - Stores the number of bytes requested. Requests larger than
+        SYS_RANDOM_MAX_SIZE are truncated.
+
+    Flags - Stores a bitfield of flags. See SYS_RANDOM_FLAG_* definitions.
+
+    BytesCompleted - Stores the number of bytes returned by the kernel.
+
+--*/
+
+typedef struct _SYSTEM_CALL_GET_RANDOM_BYTES {
+    PVOID Buffer;
+    UINTN Size;
+    ULONG Flags;
+    UINTN BytesCompleted;
+} SYSCALL_STRUCT SYSTEM_CALL_GET_RANDOM_BYTES, *PSYSTEM_CALL_GET_RANDOM_BYTES;
+
+/*++
+
 Structure Description:
 
     This structure defines a union of all possible system call parameter
@@ -2589,6 +2705,8 @@ typedef union _SYSTEM_CALL_PARAMETER_UNION {
     SYSTEM_CALL_SET_ITIMER SetITimer;
     SYSTEM_CALL_SET_RESOURCE_LIMIT SetResourceLimit;
     SYSTEM_CALL_SET_BREAK SetBreak;
+    SYSTEM_CALL_SOCKET_PERFORM_MULTIPLE_IO SocketPerformMultipleIo;
+    SYSTEM_CALL_GET_RANDOM_BYTES GetRandomBytes;
 } SYSCALL_STRUCT SYSTEM_CALL_PARAMETER_UNION, *PSYSTEM_CALL_PARAMETER_UNION;
 
 typedef
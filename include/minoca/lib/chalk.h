@@ -478,6 +478,9 @@ Structure Description:
     Flags - Stores a bitfield of flags governing the operation of the
         interpreter See CK_CONFIGURATION_* definitions.
 
+    NurserySize - Stores the number of bytes to allocate before triggering a
+        collection of the young generation.
+
 --*/
 
 typedef struct _CK_CONFIGURATION {
@@ -492,6 +495,7 @@ typedef struct _CK_CONFIGURATION {
     UINTN MinimumHeapSize;
     ULONG HeapGrowthPercent;
     ULONG Flags;
+    UINTN NurserySize;
 } CK_CONFIGURATION, *PCK_CONFIGURATION;
 
 /*++
@@ -84,12 +84,48 @@ Module Name:
 #define FORTUNA_HASH_KEY_SIZE 32
 #define FORTUNA_POOL_COUNT 23
 
+//
+// Define ChaCha20 stream cipher parameters.
+//
+
+#define CHACHA20_KEY_SIZE 32
+#define CHACHA20_NONCE_SIZE 12
+#define CHACHA20_BLOCK_SIZE 64
+#define CHACHA20_STATE_SIZE 16
+
 //
 // Define big integer parameters.
 //
 
 #define BIG_INTEGER_MODULO_COUNT 3
 
+//
+// Big integers are made up of native word sized components on 64-bit
+// machines where the compiler can hold the double-width products.
+//
+
+#if defined(__amd64) && defined(__SIZEOF_INT128__)
+
+#define BIG_INTEGER_COMPONENT_SIZE 8
+
+#else
+
+#define BIG_INTEGER_COMPONENT_SIZE 4
+
+#endif
+
+//
+// Define the processor acceleration features the library can use. These are
+// used with CyGetHardwareSupport and CySetHardwareSupport.
+//
+
+#define CRYPTO_HARDWARE_AES 0x00000001
+#define CRYPTO_HARDWARE_SHA1 0x00000002
+#define CRYPTO_HARDWARE_SHA256 0x00000004
+
+#define CRYPTO_HARDWARE_ALL \
+    (CRYPTO_HARDWARE_AES | CRYPTO_HARDWARE_SHA1 | CRYPTO_HARDWARE_SHA256)
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -307,6 +343,30 @@ typedef struct _FORTUNA_CONTEXT {
     ULONGLONG LastReseedTime;
 } FORTUNA_CONTEXT, *PFORTUNA_CONTEXT;
 
+/*++
+
+Structure Description:
+
+    This structure stores the context for the ChaCha20 stream cipher.
+
+Members:
+
+    State - Stores the cipher state: the constants, key, block counter, and
+        nonce.
+
+    KeyStream - Stores the most recently generated block of key stream.
+
+    KeyStreamSize - Stores the number of bytes at the end of the key stream
+        block that have not yet been used.
+
+--*/
+
+typedef struct _CHACHA20_CONTEXT {
+    ULONG State[CHACHA20_STATE_SIZE];
+    UCHAR KeyStream[CHACHA20_BLOCK_SIZE];
+    UINTN KeyStreamSize;
+} CHACHA20_CONTEXT, *PCHACHA20_CONTEXT;
+
 //
 // Define functions called by the big integer library.
 //
@@ -384,8 +444,19 @@ Return Value:
 
 --*/
 
+#if BIG_INTEGER_COMPONENT_SIZE == 8
+
+typedef ULONGLONG BIG_INTEGER_COMPONENT, *PBIG_INTEGER_COMPONENT;
+typedef unsigned __int128 BIG_INTEGER_LONG_COMPONENT,
+                          *PBIG_INTEGER_LONG_COMPONENT;
+
+#else
+
 typedef ULONG BIG_INTEGER_COMPONENT, *PBIG_INTEGER_COMPONENT;
 typedef ULONGLONG BIG_INTEGER_LONG_COMPONENT, *PBIG_INTEGER_LONG_COMPONENT;
+
+#endif
+
 typedef struct _BIG_INTEGER BIG_INTEGER, *PBIG_INTEGER;
 
 /*++
@@ -453,6 +524,14 @@ Structure Description:
 
     NormalizedMod - Stores the normalized modulo values.
 
+    MontgomeryRSquared - Stores R^2 modulo each modulus, where R is the radix
+        raised to the number of components in the modulus. This is used to
+        convert values into Montgomery form. It is NULL for even moduli, which
+        fall back to Barrett reduction.
+
+    MontgomeryInverse - Stores the negative inverse of the lowest component of
+        each odd modulus, modulo the radix.
+
     ExponentTable - Stores an array of pointers to integers representing
         pre-computed exponentiations of the working value.
 
@@ -476,6 +555,8 @@ typedef struct _BIG_INTEGER_CONTEXT {
     PBIG_INTEGER Modulus[BIG_INTEGER_MODULO_COUNT];
     PBIG_INTEGER Mu[BIG_INTEGER_MODULO_COUNT];
     PBIG_INTEGER NormalizedMod[BIG_INTEGER_MODULO_COUNT];
+    PBIG_INTEGER MontgomeryRSquared[BIG_INTEGER_MODULO_COUNT];
+    BIG_INTEGER_COMPONENT MontgomeryInverse[BIG_INTEGER_MODULO_COUNT];
     PBIG_INTEGER *ExponentTable;
     ULONG WindowSize;
     INTN ActiveCount;
@@ -1412,6 +1493,124 @@ Return Value:
 
 --*/
 
+CRYPTO_API
+VOID
+CyChaCha20Initialize (
+    PCHACHA20_CONTEXT Context,
+    PCUCHAR Key,
+    PCUCHAR Nonce,
+    ULONG Counter
+    );
+
+/*++
+
+Routine Description:
+
+    This routine initializes a ChaCha20 context with a key, nonce, and initial
+    block counter.
+
+Arguments:
+
+    Context - Supplies a pointer to the context to initialize.
+
+    Key - Supplies a pointer to the key, which must be CHACHA20_KEY_SIZE bytes.
+
+    Nonce - Supplies an optional pointer to the nonce, which must be
+        CHACHA20_NONCE_SIZE bytes. If NULL, a nonce of zero is used.
+
+    Counter - Supplies the initial block counter value.
+
+Return Value:
+
+    None.
+
+--*/
+
+CRYPTO_API
+VOID
+CyChaCha20Crypt (
+    PCHACHA20_CONTEXT Context,
+    PCUCHAR Input,
+    PUCHAR Output,
+    UINTN Size
+    );
+
+/*++
+
+Routine Description:
+
+    This routine encrypts or decrypts data with ChaCha20, which is the same
+    operation in both directions. Successive calls continue the key stream
+    where the previous call left off.
+
+Arguments:
+
+    Context - Supplies a pointer to the initialized context.
+
+    Input - Supplies an optional pointer to the data to encrypt or decrypt.
+        This may be the same as the output buffer. If NULL, the raw key stream
+        is returned, which is useful for generating random data.
+
+    Output - Supplies a pointer where the output will be returned.
+
+    Size - Supplies the number of bytes to process.
+
+Return Value:
+
+    None.
+
+--*/
+
+CRYPTO_API
+ULONG
+CyGetHardwareSupport (
+    VOID
+    );
+
+/*++
+
+Routine Description:
+
+    This routine returns the set of processor acceleration features that the
+    crypto library is currently using.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns a mask of CRYPTO_HARDWARE_* flags. These are the features that
+    are both supported by the processor and enabled.
+
+--*/
+
+CRYPTO_API
+ULONG
+CySetHardwareSupport (
+    ULONG Mask
+    );
+
+/*++
+
+Routine Description:
+
+    This routine sets which processor acceleration features the crypto library
+    is allowed to use. Features not supported by the processor are never used
+    regardless of the mask. The hardware paths use the processor's vector
+    registers, so environments that do not preserve that state across context
+    switches (such as the kernel) must not enable them.
+
+Arguments:
+
+    Mask - Supplies a mask of CRYPTO_HARDWARE_* flags to allow.
+
+Return Value:
+
+    Returns the mask of features that are now in use.
+
+--*/
+
 CRYPTO_API
 KSTATUS
 CyRsaInitializeContext (
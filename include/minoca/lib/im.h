@@ -168,6 +168,13 @@ typedef enum _IMAGE_LOAD_STATE {
     ImageLoadDelete,
 } IMAGE_LOAD_STATE, *PIMAGE_LOAD_STATE;
 
+typedef enum _IMAGE_RELOCATION_RECORD_TYPE {
+    ImageRelocationRecordInvalid,
+    ImageRelocationRecordImage,
+    ImageRelocationRecordStore,
+    ImageRelocationRecordCopy
+} IMAGE_RELOCATION_RECORD_TYPE, *PIMAGE_RELOCATION_RECORD_TYPE;
+
 typedef struct _LOADED_IMAGE LOADED_IMAGE, *PLOADED_IMAGE;
 
 typedef
@@ -274,6 +281,68 @@ typedef struct _IMAGE_BUFFER {
 
 /*++
 
+Structure Description:
+
+    This structure stores a single modification made to an image while it was
+    being relocated. Replaying the records reproduces the relocated image
+    without repeating the symbol lookups that went into it.
+
+Members:
+
+    Place - Stores the address that was modified. For image records, this is
+        the loaded base address of the image whose records follow.
+
+    Value - Stores the native address sized value written for store records,
+        the address the data was copied from for copy records, or the size
+        of the image for image records.
+
+    Size - Stores the number of bytes copied for copy records. This is zero
+        for other record types.
+
+    Type - Stores the record type. See IMAGE_RELOCATION_RECORD_TYPE. This is
+        kept as a fixed size field so records can be saved to a file.
+
+--*/
+
+typedef struct _IMAGE_RELOCATION_RECORD {
+    ULONGLONG Place;
+    ULONGLONG Value;
+    ULONG Size;
+    ULONG Type;
+} IMAGE_RELOCATION_RECORD, *PIMAGE_RELOCATION_RECORD;
+
+/*++
+
+Structure Description:
+
+    This structure stores the set of modifications made while relocating a
+    list of images.
+
+Members:
+
+    Records - Stores a pointer to the array of relocation records.
+
+    Count - Stores the number of valid records in the array.
+
+    Capacity - Stores the number of records the array can hold before it has
+        to be reallocated. This is zero if the array was supplied by the
+        caller rather than allocated by the image library.
+
+    Status - Stores the status of the recording. This is set to a failing
+        status if a record could not be saved, in which case the log is
+        incomplete and must not be replayed.
+
+--*/
+
+typedef struct _IMAGE_RELOCATION_LOG {
+    PIMAGE_RELOCATION_RECORD Records;
+    UINTN Count;
+    UINTN Capacity;
+    KSTATUS Status;
+} IMAGE_RELOCATION_LOG, *PIMAGE_RELOCATION_LOG;
+
+/*++
+
 Structure Description:
 
     This structure stores information about a segment or region of an
@@ -522,6 +591,9 @@ Structure Description:
     ScopeCapacity - Stores the maximum number of elements that can be put in
         the scope tree before it will have to be reallocated.
 
+    SymbolCache - Stores an optional pointer to a cache of symbols recently
+        resolved through this image's scope.
+
 --*/
 
 struct _LOADED_IMAGE {
@@ -568,6 +640,7 @@ struct _LOADED_IMAGE {
     PLOADED_IMAGE *Scope;
     UINTN ScopeSize;
     UINTN ScopeCapacity;
+    PVOID SymbolCache;
 };
 
 /*++
@@ -1347,6 +1420,89 @@ Return Value:
 
 --*/
 
+KSTATUS
+ImRelocateImagesWithLog (
+    PLIST_ENTRY ListHead,
+    PIMAGE_RELOCATION_LOG Log
+    );
+
+/*++
+
+Routine Description:
+
+    This routine relocates all images that have not yet been relocated on the
+    given list, recording every modification made along the way so that it
+    can later be replayed with ImReplayRelocationLog.
+
+Arguments:
+
+    ListHead - Supplies a pointer to the head of the list of loaded images to
+        apply relocations for.
+
+    Log - Supplies a pointer to a zeroed relocation log where the records
+        will be appended. The caller must destroy the log when finished with
+        it. If recording fails the relocations are still applied, but the
+        log's status is set to a failing code.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+KSTATUS
+ImReplayRelocationLog (
+    PLIST_ENTRY ListHead,
+    PIMAGE_RELOCATION_LOG Log
+    );
+
+/*++
+
+Routine Description:
+
+    This routine relocates all images that have not yet been relocated on the
+    given list by replaying a previously recorded relocation log rather than
+    processing each image's relocation tables. The log is checked against the
+    images before anything is modified.
+
+Arguments:
+
+    ListHead - Supplies a pointer to the head of the list of loaded images to
+        apply relocations for.
+
+    Log - Supplies a pointer to the relocation log to replay.
+
+Return Value:
+
+    Status code.
+
+    STATUS_VERSION_MISMATCH if the log does not describe the images on the
+    list. No images have been modified in this case.
+
+--*/
+
+VOID
+ImDestroyRelocationLog (
+    PIMAGE_RELOCATION_LOG Log
+    );
+
+/*++
+
+Routine Description:
+
+    This routine frees the records allocated within a relocation log. The log
+    structure itself is not freed.
+
+Arguments:
+
+    Log - Supplies a pointer to the relocation log to destroy.
+
+Return Value:
+
+    None.
+
+--*/
+
 VOID
 ImImageAddReference (
     PLOADED_IMAGE Image
@@ -49,6 +49,25 @@ Module Name:
 
 #define LZMA_HEADER_SIZE (LZMA_HEADER_MAGIC_SIZE + LZMA_PROPERTIES_SIZE)
 
+//
+// Define the magic values at the beginning and end of a block archive. A block
+// archive consists of a block header, followed by a series of independently
+// compressed LZMA streams (each with its own file header and footer), followed
+// by an index with one entry per block, and finally a block trailer.
+//
+
+#define LZMA_BLOCK_HEADER_MAGIC 0x424D5A4C
+#define LZMA_BLOCK_TRAILER_MAGIC 0x584D5A4C
+#define LZMA_BLOCK_VERSION 1
+
+//
+// Define the bounds and default for the uncompressed size of each block.
+//
+
+#define LZMA_MINIMUM_BLOCK_SIZE (1 << 16)
+#define LZMA_MAXIMUM_BLOCK_SIZE (1 << 30)
+#define LZMA_DEFAULT_BLOCK_SIZE (1 << 22)
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -311,6 +330,97 @@ typedef struct _LZMA_ENCODER_PROPERTIES {
     INT ThreadCount;
 } LZMA_ENCODER_PROPERTIES, *PLZMA_ENCODER_PROPERTIES;
 
+/*++
+
+Structure Description:
+
+    This structure stores the header at the beginning of an LZMA block archive.
+
+Members:
+
+    Magic - Stores the constant LZMA_BLOCK_HEADER_MAGIC.
+
+    Version - Stores the block archive format version, currently
+        LZMA_BLOCK_VERSION.
+
+    BlockSize - Stores the uncompressed size of each block. Every block except
+        the last is exactly this size.
+
+    Flags - Stores a bitfield of flags. None are currently defined, so this
+        must be zero.
+
+--*/
+
+typedef struct _LZMA_BLOCK_HEADER {
+    ULONG Magic;
+    ULONG Version;
+    ULONG BlockSize;
+    ULONG Flags;
+} PACKED LZMA_BLOCK_HEADER, *PLZMA_BLOCK_HEADER;
+
+/*++
+
+Structure Description:
+
+    This structure stores a single block archive index entry, describing where
+    one compressed block lives.
+
+Members:
+
+    Offset - Stores the offset in bytes from the beginning of the archive to
+        the compressed block.
+
+    CompressedSize - Stores the size of the compressed block in bytes,
+        including its LZMA file header and footer.
+
+    UncompressedSize - Stores the size of the block's data once decompressed.
+
+    UncompressedCrc32 - Stores the CRC32 of the block's uncompressed data.
+
+    Reserved - Stores a reserved value that must be zero.
+
+--*/
+
+typedef struct _LZMA_BLOCK_INDEX_ENTRY {
+    ULONGLONG Offset;
+    ULONGLONG CompressedSize;
+    ULONGLONG UncompressedSize;
+    ULONG UncompressedCrc32;
+    ULONG Reserved;
+} PACKED LZMA_BLOCK_INDEX_ENTRY, *PLZMA_BLOCK_INDEX_ENTRY;
+
+/*++
+
+Structure Description:
+
+    This structure stores the trailer at the very end of an LZMA block archive.
+    Since it is at a fixed offset from the end, seekable readers can locate
+    the index without decompressing anything.
+
+Members:
+
+    IndexOffset - Stores the offset in bytes from the beginning of the archive
+        to the first index entry.
+
+    BlockCount - Stores the number of blocks (and therefore index entries) in
+        the archive.
+
+    IndexCrc32 - Stores the CRC32 of the index entries.
+
+    Reserved - Stores a reserved value that must be zero.
+
+    Magic - Stores the constant LZMA_BLOCK_TRAILER_MAGIC.
+
+--*/
+
+typedef struct _LZMA_BLOCK_TRAILER {
+    ULONGLONG IndexOffset;
+    ULONG BlockCount;
+    ULONG IndexCrc32;
+    ULONG Reserved;
+    ULONG Magic;
+} PACKED LZMA_BLOCK_TRAILER, *PLZMA_BLOCK_TRAILER;
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -501,3 +611,208 @@ Return Value:
 
 --*/
 
+VOID
+LzLzmaInitializeBlockHeader (
+    PLZMA_BLOCK_HEADER Header,
+    ULONG BlockSize
+    );
+
+/*++
+
+Routine Description:
+
+    This routine initializes a block archive header. It also initializes the
+    library's shared tables, so it must be called once before blocks are
+    encoded on multiple threads.
+
+Arguments:
+
+    Header - Supplies a pointer to the header to initialize.
+
+    BlockSize - Supplies the uncompressed size of each block.
+
+Return Value:
+
+    None.
+
+--*/
+
+LZ_STATUS
+LzLzmaValidateBlockHeader (
+    PLZMA_BLOCK_HEADER Header
+    );
+
+/*++
+
+Routine Description:
+
+    This routine validates a block archive header.
+
+Arguments:
+
+    Header - Supplies a pointer to the header read from the archive.
+
+Return Value:
+
+    LzSuccess if the header is valid.
+
+    LzErrorMagic if this is not a block archive.
+
+    LzErrorUnsupported if the version or flags are not understood.
+
+--*/
+
+LZ_STATUS
+LzLzmaEncodeBlock (
+    PLZ_REALLOCATE Reallocate,
+    PLZMA_ENCODER_PROPERTIES Properties,
+    PCVOID Input,
+    UINTN InputSize,
+    PVOID *Output,
+    PUINTN OutputSize,
+    PULONG UncompressedCrc32
+    );
+
+/*++
+
+Routine Description:
+
+    This routine compresses a single block of a block archive as a complete,
+    independent LZMA stream. This routine shares no state with other calls, so
+    multiple blocks can be encoded simultaneously on different threads as long
+    as the reallocate routine is thread safe.
+
+Arguments:
+
+    Reallocate - Supplies a pointer to the function used to allocate and free
+        memory.
+
+    Properties - Supplies an optional pointer to the encoder properties. If
+        NULL, default properties are used.
+
+    Input - Supplies a pointer to the uncompressed block data.
+
+    InputSize - Supplies the size of the uncompressed data in bytes.
+
+    Output - Supplies a pointer where a pointer to the compressed block will
+        be returned on success. The caller is responsible for freeing this
+        buffer with the reallocate routine.
+
+    OutputSize - Supplies a pointer where the size of the compressed block will
+        be returned on success.
+
+    UncompressedCrc32 - Supplies a pointer where the CRC32 of the input data
+        will be returned on success.
+
+Return Value:
+
+    LZ Status code.
+
+--*/
+
+LZ_STATUS
+LzLzmaDecodeBlock (
+    PLZ_REALLOCATE Reallocate,
+    PCVOID Input,
+    UINTN InputSize,
+    PVOID Output,
+    UINTN OutputSize,
+    ULONG UncompressedCrc32
+    );
+
+/*++
+
+Routine Description:
+
+    This routine decompresses a single block of a block archive. Like encoding,
+    blocks can be decoded simultaneously on different threads.
+
+Arguments:
+
+    Reallocate - Supplies a pointer to the function used to allocate and free
+        memory.
+
+    Input - Supplies a pointer to the compressed block.
+
+    InputSize - Supplies the size of the compressed block in bytes.
+
+    Output - Supplies a pointer where the uncompressed data will be returned.
+
+    OutputSize - Supplies the exact uncompressed size of the block, as
+        recorded in the index.
+
+    UncompressedCrc32 - Supplies the expected CRC32 of the uncompressed data,
+        as recorded in the index.
+
+Return Value:
+
+    LZ Status code.
+
+--*/
+
+VOID
+LzLzmaInitializeBlockTrailer (
+    PLZMA_BLOCK_TRAILER Trailer,
+    PLZMA_BLOCK_INDEX_ENTRY Index,
+    ULONG BlockCount,
+    ULONGLONG IndexOffset
+    );
+
+/*++
+
+Routine Description:
+
+    This routine initializes the trailer for a completed block archive.
+
+Arguments:
+
+    Trailer - Supplies a pointer to the trailer to initialize.
+
+    Index - Supplies a pointer to the array of index entries that will be
+        written to the archive.
+
+    BlockCount - Supplies the number of entries in the index.
+
+    IndexOffset - Supplies the offset in bytes where the index is written.
+
+Return Value:
+
+    None.
+
+--*/
+
+LZ_STATUS
+LzLzmaValidateBlockIndex (
+    PLZMA_BLOCK_HEADER Header,
+    PLZMA_BLOCK_TRAILER Trailer,
+    PLZMA_BLOCK_INDEX_ENTRY Index
+    );
+
+/*++
+
+Routine Description:
+
+    This routine validates the index of a block archive against its header and
+    trailer. It ensures the blocks are contiguous, lie between the header and
+    the index, and have the sizes promised by the header.
+
+Arguments:
+
+    Header - Supplies a pointer to the validated archive header.
+
+    Trailer - Supplies a pointer to the archive trailer.
+
+    Index - Supplies a pointer to the index entries, the number of which is
+        specified in the trailer.
+
+Return Value:
+
+    LzSuccess if the index is valid.
+
+    LzErrorMagic if the trailer magic is wrong.
+
+    LzErrorCrc if the index does not match its checksum.
+
+    LzErrorCorruptData if the index entries are inconsistent.
+
+--*/
@@ -67,6 +67,13 @@ extern "C" {
 
 #define OS_LOCK_DEFAULT_SPIN_COUNT 500
 
+//
+// Define the number of times a contended lock is polled before giving up and
+// waiting in the kernel, assuming the owner stays running.
+//
+
+#define OS_LOCK_ADAPTIVE_SPIN_COUNT 1000
+
 //
 // Set this flag when initializing a read-write lock to indicate the lock
 // should be shared across processes.
@@ -183,6 +190,10 @@ Structure Description:
     State - Stores the state of the lock. 0 is unlocked, -1 is locked for
         write, and any other value contains a count of readers.
 
+    WriterKernelThreadId - Stores the kernel thread ID of the thread that has
+        this lock for writing, if any. This is used as a hint for adaptive
+        spinning.
+
     WriterThreadId - Stores the thread ID of the thread that has this lock for
         writing, if any.
 
@@ -190,20 +201,62 @@ Structure Description:
         for read access.
 
     PendingWriters - Stores the number of threads waiting to acquire the lock
-        for write access.
+        for write access. New readers hold off while this is non-zero so that
+        writers are not starved.
+
+    Attributes - Stores the flags the lock was initialized with. See
+        OS_RWLOCK_* definitions.
+
+    WriterSequence - Stores a counter incremented each time a writer releases
+        the lock. A reader that has already waited out a writer is let in
+        ahead of other pending writers, so that readers are not starved
+        either.
 
 --*/
 
 typedef struct _OS_RWLOCK {
     ULONG State;
+    THREAD_ID WriterKernelThreadId;
     UINTN WriterThreadId;
     ULONG PendingReaders;
     ULONG PendingWriters;
     ULONG Attributes;
+    ULONG WriterSequence;
 } OS_RWLOCK, *POS_RWLOCK;
 
 /*++
 
+Structure Description:
+
+    This structure stores the process-wide contention statistics for the OS
+    library and C library locks.
+
+Members:
+
+    SpinSuccesses - Stores the number of times a contended lock was released
+        while the acquiring thread was spinning on it.
+
+    SpinFailures - Stores the number of times a thread gave up spinning on a
+        contended lock, either because the owner was not running or because
+        the spin budget ran out.
+
+    KernelWaits - Stores the number of times a thread went into the kernel to
+        wait on a lock.
+
+    KernelWakes - Stores the number of times a thread went into the kernel to
+        wake waiters on a lock.
+
+--*/
+
+typedef struct _OS_LOCK_STATISTICS {
+    ULONG SpinSuccesses;
+    ULONG SpinFailures;
+    ULONG KernelWaits;
+    ULONG KernelWakes;
+} OS_LOCK_STATISTICS, *POS_LOCK_STATISTICS;
+
+/*++
+
 Structure Description:
 
     This structure defines a thread local storage index entry, the format of
@@ -1972,6 +2025,45 @@ Return Value:
 
 --*/
 
+OS_API
+KSTATUS
+OsGetRandomBytes (
+    PVOID Buffer,
+    UINTN Size,
+    ULONG Flags,
+    PUINTN BytesCompleted
+    );
+
+/*++
+
+Routine Description:
+
+    This routine fills a buffer with random data from the kernel's random
+    source, without needing to open the random device.
+
+Arguments:
+
+    Buffer - Supplies a pointer where the random data will be returned.
+
+    Size - Supplies the number of bytes of random data requested.
+
+    Flags - Supplies a bitfield of flags. See SYS_RANDOM_FLAG_* definitions.
+
+    BytesCompleted - Supplies a pointer where the number of bytes returned
+        will be stored. This may be less than the requested size if the
+        request was larger than SYS_RANDOM_MAX_SIZE.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    STATUS_OPERATION_WOULD_BLOCK if the random source is not yet available and
+    the non-blocking flag was supplied.
+
+    Other error codes on failure.
+
+--*/
+
 OS_API
 KSTATUS
 OsResetSystem (
@@ -2998,6 +3090,43 @@ Return Value:
 
 --*/
 
+OS_API
+KSTATUS
+OsSocketPerformMultipleIo (
+    HANDLE Socket,
+    PSOCKET_IO_MESSAGE Messages,
+    UINTN MessageCount,
+    PUINTN MessagesCompleted
+    );
+
+/*++
+
+Routine Description:
+
+    This routine sends or receives several messages on an open socket in a
+    single system call.
+
+Arguments:
+
+    Socket - Supplies a pointer to the socket.
+
+    Messages - Supplies an array of messages to process. Each message carries
+        its own socket I/O parameters, which determine the direction of the
+        transfer and receive the results.
+
+    MessageCount - Supplies the number of elements in the message array. This
+        must not exceed SYS_SOCKET_IO_MAX_MESSAGES.
+
+    MessagesCompleted - Supplies a pointer where the number of messages that
+        were fully processed will be returned.
+
+Return Value:
+
+    Status code. Success is returned if at least one message completed, even if
+    a later message failed.
+
+--*/
+
 OS_API
 KSTATUS
 OsSocketGetSetInformation (
@@ -3896,6 +4025,62 @@ Return Value:
 
 --*/
 
+OS_API
+BOOL
+OsSpinOnLock (
+    PULONG Address,
+    ULONG Value,
+    THREAD_ID Owner
+    );
+
+/*++
+
+Routine Description:
+
+    This routine spins briefly waiting for a contended lock value to change,
+    in the hopes of avoiding a trip to the kernel. Spinning stops early if the
+    system has only one processor or the owner of the lock is not running.
+
+Arguments:
+
+    Address - Supplies a pointer to the lock value.
+
+    Value - Supplies the contended value that was observed.
+
+    Owner - Supplies the kernel thread ID (as returned by OsGetKernelThreadId)
+        of the owner of the lock, or 0 if the owner is not known.
+
+Return Value:
+
+    TRUE if the lock value changed while spinning.
+
+    FALSE if the caller should go wait in the kernel.
+
+--*/
+
+OS_API
+VOID
+OsGetLockStatistics (
+    POS_LOCK_STATISTICS Statistics
+    );
+
+/*++
+
+Routine Description:
+
+    This routine returns a snapshot of the lock contention statistics for the
+    current process.
+
+Arguments:
+
+    Statistics - Supplies a pointer where the statistics will be returned.
+
+Return Value:
+
+    None.
+
+--*/
+
 OS_API
 VOID
 OsRwLockInitialize (
@@ -4202,6 +4387,54 @@ Return Value:
 
 --*/
 
+OS_API
+THREAD_ID
+OsGetKernelThreadId (
+    VOID
+    );
+
+/*++
+
+Routine Description:
+
+    This routine returns the kernel's identifier for the currently running
+    thread. The value is queried once and then cached in the thread control
+    block.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns the current thread's kernel thread ID.
+
+--*/
+
+OS_API
+VOID
+OsResetKernelThreadId (
+    VOID
+    );
+
+/*++
+
+Routine Description:
+
+    This routine discards the cached kernel thread ID of the current thread.
+    This must be called in the child of a fork, since the child's thread has
+    a new ID but a copy of the parent's thread control block.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    None.
+
+--*/
+
 OS_API
 KSTATUS
 OsSetThreadPointer (
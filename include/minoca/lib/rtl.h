@@ -5107,6 +5107,29 @@ Return Value:
 
 --*/
 
+RTL_API
+VOID
+RtlProcessorYield (
+    VOID
+    );
+
+/*++
+
+Routine Description:
+
+    This routine executes a short processor yield in hardware. It is meant to
+    be called in the body of a spin loop.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    None.
+
+--*/
+
 RTL_API
 VOID
 RtlRedBlackTreeInitialize (
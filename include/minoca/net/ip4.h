@@ -37,6 +37,15 @@ Module Name:
 #define IP4_IS_MULTICAST_ADDRESS(_Ip4Address) \
     (((_Ip4Address) & 0x000000F0) == 0x000000E0)
 
+//
+// This macro determines whether or not the given IPv4 address is in the
+// 127.0.0.0/8 loopback range. The address is treated as being in network byte
+// order.
+//
+
+#define IP4_IS_LOOPBACK_ADDRESS(_Ip4Address) \
+    (((_Ip4Address) & 0x000000FF) == 0x0000007F)
+
 //
 // ---------------------------------------------------------------- Definitions
 //
@@ -226,6 +226,7 @@ Module Name:
 #define NET_PACKET_FLAG_ROUTER_ALERT         0x00000200
 #define NET_PACKET_FLAG_LINK_LOCAL_HOP_LIMIT 0x00000400
 #define NET_PACKET_FLAG_MAX_HOP_LIMIT        0x00000800
+#define NET_PACKET_FLAG_SEGMENTATION_OFFLOAD 0x00001000
 
 #define NET_PACKET_FLAG_CHECKSUM_OFFLOAD_MASK \
     (NET_PACKET_FLAG_IP_CHECKSUM_OFFLOAD |    \
@@ -236,14 +237,16 @@ Module Name:
 // Define the network link capabilities.
 //
 
-#define NET_LINK_CAPABILITY_TRANSMIT_IP_CHECKSUM_OFFLOAD  0x00000001
-#define NET_LINK_CAPABILITY_TRANSMIT_UDP_CHECKSUM_OFFLOAD 0x00000002
-#define NET_LINK_CAPABILITY_TRANSMIT_TCP_CHECKSUM_OFFLOAD 0x00000004
-#define NET_LINK_CAPABILITY_RECEIVE_IP_CHECKSUM_OFFLOAD   0x00000008
-#define NET_LINK_CAPABILITY_RECEIVE_UDP_CHECKSUM_OFFLOAD  0x00000010
-#define NET_LINK_CAPABILITY_RECEIVE_TCP_CHECKSUM_OFFLOAD  0x00000020
-#define NET_LINK_CAPABILITY_PROMISCUOUS_MODE              0x00000040
-#define NET_LINK_CAPABILITY_MULTICAST_ALL                 0x00000080
+#define NET_LINK_CAPABILITY_TRANSMIT_IP_CHECKSUM_OFFLOAD      0x00000001
+#define NET_LINK_CAPABILITY_TRANSMIT_UDP_CHECKSUM_OFFLOAD     0x00000002
+#define NET_LINK_CAPABILITY_TRANSMIT_TCP_CHECKSUM_OFFLOAD     0x00000004
+#define NET_LINK_CAPABILITY_RECEIVE_IP_CHECKSUM_OFFLOAD       0x00000008
+#define NET_LINK_CAPABILITY_RECEIVE_UDP_CHECKSUM_OFFLOAD      0x00000010
+#define NET_LINK_CAPABILITY_RECEIVE_TCP_CHECKSUM_OFFLOAD      0x00000020
+#define NET_LINK_CAPABILITY_PROMISCUOUS_MODE                  0x00000040
+#define NET_LINK_CAPABILITY_MULTICAST_ALL                     0x00000080
+#define NET_LINK_CAPABILITY_TRANSMIT_TCP_SEGMENTATION_OFFLOAD 0x00000100
+#define NET_LINK_CAPABILITY_LOOPBACK                          0x00000200
 
 #define NET_LINK_CAPABILITY_CHECKSUM_TRANSMIT_MASK       \
     (NET_LINK_CAPABILITY_TRANSMIT_IP_CHECKSUM_OFFLOAD |  \
@@ -259,6 +262,14 @@ Module Name:
     (NET_LINK_CAPABILITY_CHECKSUM_TRANSMIT_MASK | \
      NET_LINK_CAPABILITY_CHECKSUM_RECEIVE_MASK)
 
+//
+// Define the maximum number of bytes of network layer payload a segmentation
+// offload packet or a coalesced receive packet can carry. This keeps the
+// total length within the 16-bit IP length fields.
+//
+
+#define NET_SEGMENTATION_OFFLOAD_MAX_SIZE 0xF000
+
 //
 // Define the network packet size information flags.
 //
@@ -444,6 +455,11 @@ Structure Description:
         beginning of the footer data (ie the location to store the first byte
         of new footer).
 
+    SegmentSize - Stores the maximum number of transport payload bytes to put
+        in each segment on the wire. This is only valid if the segmentation
+        offload flag is set, in which case the packet carries several
+        transport segments' worth of data behind a single set of headers.
+
 --*/
 
 typedef struct _NET_PACKET_BUFFER {
@@ -456,6 +472,7 @@ typedef struct _NET_PACKET_BUFFER {
     ULONG DataSize;
     ULONG DataOffset;
     ULONG FooterOffset;
+    ULONG SegmentSize;
 } NET_PACKET_BUFFER, *PNET_PACKET_BUFFER;
 
 /*++
@@ -684,6 +701,40 @@ typedef struct _NET_DATA_LINK_ENTRY NET_DATA_LINK_ENTRY, *PNET_DATA_LINK_ENTRY;
 
 /*++
 
+Structure Description:
+
+    This structure defines the segmentation and receive coalescing counters
+    for a network link.
+
+Members:
+
+    SegmentationPackets - Stores the number of segmentation offload packets
+        built by the transport layer for this link.
+
+    SegmentationHardwarePackets - Stores the number of segmentation offload
+        packets handed to the link for the hardware to split.
+
+    SegmentationSoftwareSegments - Stores the number of wire segments produced
+        by splitting segmentation offload packets in software.
+
+    ReceiveCoalescedPackets - Stores the number of packets passed up the stack
+        that were built by coalescing several received segments.
+
+    ReceiveCoalescedSegments - Stores the number of received segments that
+        were merged into coalesced packets.
+
+--*/
+
+typedef struct _NET_LINK_OFFLOAD_STATISTICS {
+    volatile ULONGLONG SegmentationPackets;
+    volatile ULONGLONG SegmentationHardwarePackets;
+    volatile ULONGLONG SegmentationSoftwareSegments;
+    volatile ULONGLONG ReceiveCoalescedPackets;
+    volatile ULONGLONG ReceiveCoalescedSegments;
+} NET_LINK_OFFLOAD_STATISTICS, *PNET_LINK_OFFLOAD_STATISTICS;
+
+/*++
+
 Structure Description:
 
     This structure defines a network link, something that can actually send
@@ -728,6 +779,9 @@ Structure Description:
     MulticastGroupList - Stores a list of the multicast groups to which this
         link belongs.
 
+    OffloadStatistics - Stores the segmentation offload and receive
+        coalescing counters for the link.
+
 --*/
 
 typedef struct _NET_LINK {
@@ -743,6 +797,7 @@ typedef struct _NET_LINK {
     PKEVENT AddressTranslationEvent;
     RED_BLACK_TREE AddressTranslationTree;
     LIST_ENTRY MulticastGroupList;
+    NET_LINK_OFFLOAD_STATISTICS OffloadStatistics;
 } NET_LINK, *PNET_LINK;
 
 typedef
@@ -2809,6 +2864,122 @@ Return Value:
 
 --*/
 
+NET_API
+VOID
+NetProcessReceivedPackets (
+    PNET_LINK Link,
+    PNET_PACKET_LIST PacketList
+    );
+
+/*++
+
+Routine Description:
+
+    This routine is called by the low level NIC driver to pass a batch of
+    received packets onto the core networking library for dispatching.
+    In-order TCP segments belonging to the same flow are coalesced into a
+    single packet before being handed to the protocol layers.
+
+Arguments:
+
+    Link - Supplies a pointer to the link that received the packets.
+
+    PacketList - Supplies a pointer to the list of received packets, in the
+        order they came off the wire. The packet structures may be used as
+        scratch space while this routine executes, but will not be accessed
+        after this routine returns. The list itself is not modified.
+
+Return Value:
+
+    None. When the function returns, the memory associated with the packets
+    may be reclaimed and reused.
+
+--*/
+
+NET_API
+KSTATUS
+NetLoopbackPackets (
+    PNET_LINK Link,
+    PNET_NETWORK_ENTRY Network,
+    PNET_PACKET_LIST PacketList
+    );
+
+/*++
+
+Routine Description:
+
+    This routine hands a list of packets destined for this machine back to the
+    receive path of the given link without sending them to the device. The
+    packets are delivered asynchronously, in order, as if the hardware had
+    received them and verified their checksums. Delivery never happens in the
+    context of the sender, so it is safe to call this with socket locks held.
+
+Arguments:
+
+    Link - Supplies a pointer to the link the packets should be received on.
+
+    Network - Supplies an optional pointer to the network layer that should
+        receive the packets. Supply NULL if the packets already carry a data
+        link header and should be parsed by the link's data link layer.
+
+    PacketList - Supplies a pointer to the list of packets to deliver. On
+        success, the packets are moved out of this list and owned by the
+        loopback path.
+
+Return Value:
+
+    STATUS_SUCCESS if the packets were queued for delivery.
+
+    STATUS_INSUFFICIENT_RESOURCES if the packets could not be queued. The
+    packets remain on the supplied list and are still owned by the caller.
+
+--*/
+
+NET_API
+KSTATUS
+NetSegmentPacket (
+    PNET_LINK Link,
+    PNET_NETWORK_ENTRY Network,
+    PNETWORK_ADDRESS Source,
+    PNETWORK_ADDRESS Destination,
+    PNET_PACKET_BUFFER Packet,
+    PNET_PACKET_LIST PacketList
+    );
+
+/*++
+
+Routine Description:
+
+    This routine splits a TCP segmentation offload packet into individual
+    segments of at most the packet's segment size, for links that cannot
+    perform the segmentation in hardware. Each new segment gets a copy of the
+    TCP header with the sequence number, flags, and checksum fixed up.
+
+Arguments:
+
+    Link - Supplies a pointer to the link the segments will be sent over.
+
+    Network - Supplies a pointer to the network entry, used to compute the
+        pseudo-header checksums.
+
+    Source - Supplies a pointer to the source address of the packet.
+
+    Destination - Supplies a pointer to the destination address of the packet.
+
+    Packet - Supplies a pointer to the segmentation offload packet. The data
+        offset must point at the TCP header. On success, this packet is
+        removed from the list and freed.
+
+    PacketList - Supplies a pointer to the list containing the packet. On
+        success, the new segments are inserted in place of the original
+        packet.
+
+Return Value:
+
+    Status code. On failure, the packet list is left unchanged.
+
+--*/
+
 NET_API
 BOOL
 NetGetGlobalDebugFlag (
@@ -209,6 +209,7 @@ Module Name:
 
 #define NETLINK_GENERIC_CONTROL_NAME "nlctrl"
 #define NETLINK_GENERIC_80211_NAME   "nl80211"
+#define NETLINK_GENERIC_TCP_NAME     "nltcp"
 
 //
 // Define the generic control command values.
@@ -293,6 +294,30 @@ Module Name:
 
 #define NETLINK_80211_MULTICAST_SCAN_NAME "scan"
 
+//
+// Define the generic TCP command values.
+//
+
+#define NETLINK_TCP_COMMAND_GET_BUFFER_LIMITS 1
+#define NETLINK_TCP_COMMAND_SET_BUFFER_LIMITS 2
+#define NETLINK_TCP_COMMAND_BUFFER_LIMITS 3
+#define NETLINK_TCP_COMMAND_MAX 255
+
+//
+// Define the generic TCP attributes. The buffer sizes are 32-bit values and
+// the memory limit and usage are 64-bit values, all in bytes. The memory usage
+// is read only.
+//
+
+#define NETLINK_TCP_ATTRIBUTE_SEND_BUFFER_MINIMUM 1
+#define NETLINK_TCP_ATTRIBUTE_SEND_BUFFER_DEFAULT 2
+#define NETLINK_TCP_ATTRIBUTE_SEND_BUFFER_MAXIMUM 3
+#define NETLINK_TCP_ATTRIBUTE_RECEIVE_BUFFER_MINIMUM 4
+#define NETLINK_TCP_ATTRIBUTE_RECEIVE_BUFFER_DEFAULT 5
+#define NETLINK_TCP_ATTRIBUTE_RECEIVE_BUFFER_MAXIMUM 6
+#define NETLINK_TCP_ATTRIBUTE_MEMORY_LIMIT 7
+#define NETLINK_TCP_ATTRIBUTE_MEMORY_USAGE 8
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
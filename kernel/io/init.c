@@ -34,6 +34,7 @@ Module Name:
 #include <minoca/lib/bconf.h>
 #include "iop.h"
 #include "pagecach.h"
+#include "unsocket.h"
 
 //
 // ---------------------------------------------------------------- Definitions
@@ -343,6 +344,15 @@ Return Value:
         goto InitializeEnd;
     }
 
+    //
+    // Initialize Unix domain socket support.
+    //
+
+    Status = IopInitializeUnixSocketSupport();
+    if (!KSUCCESS(Status)) {
+        goto InitializeEnd;
+    }
+
     //
     // Initialize the device database.
     //
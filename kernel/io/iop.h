@@ -3210,6 +3210,36 @@ Return Value:
 
 --*/
 
+KSTATUS
+IopGetSetPipeSize (
+    PIO_HANDLE Handle,
+    BOOL Set,
+    PULONG Size
+    );
+
+/*++
+
+Routine Description:
+
+    This routine gets or sets the capacity of the buffer backing a pipe.
+
+Arguments:
+
+    Handle - Supplies a pointer to an I/O handle to the pipe.
+
+    Set - Supplies a boolean indicating whether to get the current capacity
+        (FALSE) or set a new one (TRUE).
+
+    Size - Supplies a pointer that on input contains the requested capacity
+        when setting. On output, returns the resulting capacity in bytes.
+
+Return Value:
+
+    Status code. STATUS_INVALID_PARAMETER is returned if the handle does not
+    refer to a pipe.
+
+--*/
+
 KSTATUS
 IopInitializeTerminalSupport (
     VOID
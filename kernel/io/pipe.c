@@ -826,6 +826,54 @@ Return Value:
     return Status;
 }
 
+KSTATUS
+IopGetSetPipeSize (
+    PIO_HANDLE Handle,
+    BOOL Set,
+    PULONG Size
+    )
+
+/*++
+
+Routine Description:
+
+    This routine gets or sets the capacity of the buffer backing a pipe.
+
+Arguments:
+
+    Handle - Supplies a pointer to an I/O handle to the pipe.
+
+    Set - Supplies a boolean indicating whether to get the current capacity
+        (FALSE) or set a new one (TRUE).
+
+    Size - Supplies a pointer that on input contains the requested capacity
+        when setting. On output, returns the resulting capacity in bytes.
+
+Return Value:
+
+    Status code. STATUS_INVALID_PARAMETER is returned if the handle does not
+    refer to a pipe.
+
+--*/
+
+{
+
+    PFILE_OBJECT FileObject;
+    PPIPE Pipe;
+
+    FileObject = Handle->FileObject;
+    if (FileObject->Properties.Type != IoObjectPipe) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    Pipe = FileObject->SpecialIo;
+    if (Pipe == NULL) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    return IoGetSetStreamBufferSize(Pipe->StreamBuffer, Set, Size);
+}
+
 //
 // --------------------------------------------------------- Internal Functions
 //
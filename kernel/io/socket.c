@@ -1849,6 +1849,213 @@ Return Value:
     return Status;
 }
 
+INTN
+IoSysSocketPerformMultipleIo (
+    PVOID SystemCallParameter
+    )
+
+/*++
+
+Routine Description:
+
+    This routine handles the system call that sends or receives several
+    messages on a socket, looking up the socket only once.
+
+Arguments:
+
+    SystemCallParameter - Supplies a pointer to the parameters supplied with
+        the system call. This structure will be a stack-local copy of the
+        actual parameters passed from user-mode.
+
+Return Value:
+
+    STATUS_SUCCESS or positive integer on success.
+
+    Error status code on failure.
+
+--*/
+
+{
+
+    UINTN Completed;
+    BOOL ForcedNonBlocking;
+    PIO_BUFFER IoBuffer;
+    PIO_HANDLE IoHandle;
+    SOCKET_IO_PARAMETERS IoParameters;
+    SOCKET_IO_MESSAGE Message;
+    UINTN MessageIndex;
+    PSYSTEM_CALL_SOCKET_PERFORM_MULTIPLE_IO Parameters;
+    PKPROCESS Process;
+    KSTATUS Status;
+    BOOL WaitForOne;
+    BOOL Write;
+
+    Completed = 0;
+    Parameters = (PSYSTEM_CALL_SOCKET_PERFORM_MULTIPLE_IO)SystemCallParameter;
+    Process = PsGetCurrentProcess();
+    Status = STATUS_SUCCESS;
+
+    ASSERT(SYS_WAIT_TIME_INDEFINITE == WAIT_TIME_INDEFINITE);
+
+    IoHandle = ObGetHandleValue(Process->HandleTable, Parameters->Socket, NULL);
+    if (IoHandle == NULL) {
+        Status = STATUS_INVALID_HANDLE;
+        goto SysSocketPerformMultipleIoEnd;
+    }
+
+    if (Parameters->MessageCount > SYS_SOCKET_IO_MAX_MESSAGES) {
+        Status = STATUS_INVALID_PARAMETER;
+        goto SysSocketPerformMultipleIoEnd;
+    }
+
+    //
+    // Process each message in turn with the single handle reference. Stop at
+    // the first message that fails. Errors after the first message are not
+    // reported, as the caller needs to learn how many messages went through;
+    // a persistent error will be hit again by the next call.
+    //
+
+    for (MessageIndex = 0;
+         MessageIndex < Parameters->MessageCount;
+         MessageIndex += 1) {
+
+        Status = MmCopyFromUserMode(&Message,
+                                    &(Parameters->Messages[MessageIndex]),
+                                    sizeof(SOCKET_IO_MESSAGE));
+
+        if (!KSUCCESS(Status)) {
+            break;
+        }
+
+        Status = MmCopyFromUserMode(&IoParameters,
+                                    Message.Parameters,
+                                    sizeof(SOCKET_IO_PARAMETERS));
+
+        if (!KSUCCESS(Status)) {
+            break;
+        }
+
+        IoParameters.BytesCompleted = 0;
+        IoParameters.IoFlags &= SYS_IO_FLAG_MASK;
+        Write = ((IoParameters.IoFlags & SYS_IO_FLAG_WRITE) != 0);
+
+        //
+        // Only the first message is allowed to block if the caller asked to
+        // wait for just one. The flag is internal to this call, so strip it
+        // before the protocol sees it.
+        //
+
+        WaitForOne = FALSE;
+        if ((IoParameters.SocketIoFlags & SOCKET_IO_WAIT_FOR_ONE) != 0) {
+            WaitForOne = TRUE;
+            IoParameters.SocketIoFlags &= ~SOCKET_IO_WAIT_FOR_ONE;
+        }
+
+        ForcedNonBlocking = FALSE;
+        if ((WaitForOne != FALSE) &&
+            (Completed != 0) &&
+            ((IoParameters.SocketIoFlags & SOCKET_IO_NON_BLOCKING) == 0)) {
+
+            ForcedNonBlocking = TRUE;
+            IoParameters.SocketIoFlags |= SOCKET_IO_NON_BLOCKING;
+        }
+
+        //
+        // Non-blocking handles always have a timeout of zero.
+        //
+
+        if ((IoHandle->OpenFlags & OPEN_FLAG_NON_BLOCKING) != 0) {
+            IoParameters.TimeoutInMilliseconds = 0;
+        }
+
+        Status = MmCreateIoBufferFromVector(Message.VectorArray,
+                                            FALSE,
+                                            Message.VectorCount,
+                                            &IoBuffer);
+
+        if (!KSUCCESS(Status)) {
+            break;
+        }
+
+        if (Write != FALSE) {
+            Status = IoSocketSendData(FALSE, IoHandle, &IoParameters, IoBuffer);
+
+            //
+            // Send a pipe signal if the returning status was "broken pipe".
+            //
+
+            if (Status == STATUS_BROKEN_PIPE) {
+
+                ASSERT(Process != PsGetKernelProcess());
+
+                PsSignalProcess(Process, SIGNAL_BROKEN_PIPE, NULL);
+            }
+
+        } else {
+            Status = IoSocketReceiveData(FALSE,
+                                         IoHandle,
+                                         &IoParameters,
+                                         IoBuffer);
+        }
+
+        MmFreeIoBuffer(IoBuffer);
+
+        //
+        // An interrupted socket cannot be restarted if a timeout has been
+        // set. Once a message has completed the interruption is simply
+        // reported as a short count.
+        //
+
+        if ((Status == STATUS_INTERRUPTED) && (Completed == 0)) {
+            Status = IopConvertInterruptedSocketStatus(
+                                                  IoHandle,
+                                                  IoParameters.BytesCompleted,
+                                                  Write);
+        }
+
+        if (ForcedNonBlocking != FALSE) {
+            IoParameters.SocketIoFlags &= ~SOCKET_IO_NON_BLOCKING;
+        }
+
+        MmCopyToUserMode(Message.Parameters,
+                         &IoParameters,
+                         sizeof(SOCKET_IO_PARAMETERS));
+
+        //
+        // An end of file still completes the message (with zero bytes), but
+        // nothing more is coming, so stop here.
+        //
+
+        if (Status == STATUS_END_OF_FILE) {
+            Completed += 1;
+            break;
+        }
+
+        if (!KSUCCESS(Status)) {
+            break;
+        }
+
+        Completed += 1;
+    }
+
+    if ((Completed != 0) && (Status != STATUS_END_OF_FILE)) {
+        Status = STATUS_SUCCESS;
+    }
+
+SysSocketPerformMultipleIoEnd:
+    Parameters->MessagesCompleted = Completed;
+
+    //
+    // Release the reference that was added when the handle was looked up.
+    //
+
+    if (IoHandle != NULL) {
+        IoIoHandleReleaseReference(IoHandle);
+    }
+
+    return Status;
+}
+
 INTN
 IoSysSocketGetSetInformation (
     PVOID SystemCallParameter
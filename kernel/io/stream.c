@@ -36,7 +36,13 @@ Module Name:
 // ---------------------------------------------------------------- Definitions
 //
 
-#define DEFAULT_STREAM_BUFFER_SIZE 8192
+#define DEFAULT_STREAM_BUFFER_SIZE _64KB
+
+//
+// Define the largest capacity a stream buffer can be resized to.
+//
+
+#define MAXIMUM_STREAM_BUFFER_SIZE _1MB
 
 //
 // ------------------------------------------------------ Data Type Definitions
@@ -46,28 +52,44 @@ Module Name:
 
 Structure Description:
 
-    This structure describes characteristics about a data stream buffer.
+    This structure describes characteristics about a data stream buffer. The
+    buffer is a ring whose capacity is a power of two. The read and write
+    positions run freely and are masked to get buffer offsets, so the whole
+    capacity is usable and the amount of data is always their difference.
+    Readers and writers are each serialized amongst themselves, but a reader
+    and a writer never contend with each other: each only advances its own
+    position, publishing it after the data copy completes.
 
 Members:
 
     Flags - Stores a bitfield of flags governing the state of the stream buffer.
         See STREAM_BUFFER_FLAG_* definitions.
 
-    Size - Stores the size of the buffer, in bytes.
+    Capacity - Stores the size of the buffer, in bytes. This is always a power
+        of two.
 
     Buffer - Stores a pointer to the actual stream buffer.
 
-    NextReadOffset - Stores the offset from the beginning of the buffer where
-        the next read should occur (points to the first unread byte).
+    ReadPosition - Stores the total number of bytes ever read from the buffer.
+        This is only modified by readers.
 
-    NextWriteOffset - Stores the offset from the beginning of the buffer where
-        the next write should occur (points to the first unused offset).
+    WritePosition - Stores the total number of bytes ever written to the
+        buffer. This is only modified by writers.
 
     AtomicWriteSize - Stores the number of bytes that can always be written
         to the stream atomically (without interleaving).
 
-    Lock - Stores a pointer to a lock ensuring only one party is accessing the
-        buffer at once.
+    ReadLock - Stores a pointer to a lock ensuring only one reader is accessing
+        the buffer at once.
+
+    WriteLock - Stores a pointer to a lock ensuring only one writer is
+        accessing the buffer at once. When both locks are needed, the write
+        lock is acquired first.
+
+    EventLock - Stores a pointer to a lock serializing changes to the I/O
+        object state made by the reader and writer, so that a set and a clear
+        racing with each other cannot leave the event and the event mask out
+        of sync.
 
     IoState - Stores a pointer to the I/O object state.
 
@@ -75,12 +97,14 @@ Structure Description:
 
 struct _STREAM_BUFFER {
     ULONG Flags;
-    ULONG Size;
+    ULONG Capacity;
     PVOID Buffer;
-    ULONG NextReadOffset;
-    ULONG NextWriteOffset;
+    volatile ULONG ReadPosition;
+    volatile ULONG WritePosition;
     ULONG AtomicWriteSize;
-    PQUEUED_LOCK Lock;
+    PQUEUED_LOCK ReadLock;
+    PQUEUED_LOCK WriteLock;
+    PQUEUED_LOCK EventLock;
     PIO_OBJECT_STATE IoState;
 };
 
@@ -88,6 +112,34 @@ struct _STREAM_BUFFER {
 // ----------------------------------------------- Internal Function Prototypes
 //
 
+ULONG
+IopGetStreamBufferCapacity (
+    ULONG Size,
+    ULONG AtomicWriteSize
+    );
+
+KSTATUS
+IopCopyStreamBufferData (
+    PSTREAM_BUFFER StreamBuffer,
+    PIO_BUFFER IoBuffer,
+    UINTN IoBufferOffset,
+    ULONG Position,
+    ULONG Size,
+    BOOL ToIoBuffer
+    );
+
+VOID
+IopSignalStreamBufferEvent (
+    PSTREAM_BUFFER StreamBuffer,
+    ULONG Event
+    );
+
+VOID
+IopClearStreamBufferEvent (
+    PSTREAM_BUFFER StreamBuffer,
+    ULONG Event
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -119,7 +171,7 @@ Routine Description:
         buffer. See STREAM_BUFFER_FLAG_* definitions.
 
     BufferSize - Supplies the size of the buffer. Supply zero to use a default
-        system value.
+        system value. The size is rounded up to a whole number of pages.
 
     AtomicWriteSize - Supplies the number of bytes that can always be written
         to the stream atomically (without interleaving).
@@ -143,18 +195,12 @@ Return Value:
 
     if (BufferSize == 0) {
         BufferSize = DEFAULT_STREAM_BUFFER_SIZE;
-
-    //
-    // Bump up the internal buffer size since one byte of the buffer is always
-    // wasted.
-    //
-
-    } else {
-        BufferSize += 1;
     }
 
-    if (BufferSize < AtomicWriteSize) {
-        BufferSize = AtomicWriteSize + 1;
+    if ((BufferSize > MAXIMUM_STREAM_BUFFER_SIZE) ||
+        (AtomicWriteSize > MAXIMUM_STREAM_BUFFER_SIZE)) {
+
+        return NULL;
     }
 
     //
@@ -170,10 +216,17 @@ Return Value:
     }
 
     RtlZeroMemory(StreamBuffer, sizeof(STREAM_BUFFER));
-    StreamBuffer->Size = BufferSize;
+    StreamBuffer->Capacity = IopGetStreamBufferCapacity(BufferSize,
+                                                        AtomicWriteSize);
+
     StreamBuffer->AtomicWriteSize = AtomicWriteSize;
-    StreamBuffer->Lock = KeCreateQueuedLock();
-    if (StreamBuffer->Lock == NULL) {
+    StreamBuffer->ReadLock = KeCreateQueuedLock();
+    StreamBuffer->WriteLock = KeCreateQueuedLock();
+    StreamBuffer->EventLock = KeCreateQueuedLock();
+    if ((StreamBuffer->ReadLock == NULL) ||
+        (StreamBuffer->WriteLock == NULL) ||
+        (StreamBuffer->EventLock == NULL)) {
+
         Status = STATUS_INSUFFICIENT_RESOURCES;
         goto CreateStreamBufferEnd;
     }
@@ -182,7 +235,7 @@ Return Value:
     // Create the buffer itself.
     //
 
-    StreamBuffer->Buffer = MmAllocatePagedPool(BufferSize,
+    StreamBuffer->Buffer = MmAllocatePagedPool(StreamBuffer->Capacity,
                                                FI_ALLOCATION_TAG);
 
     if (StreamBuffer->Buffer == NULL) {
@@ -204,15 +257,7 @@ Return Value:
 CreateStreamBufferEnd:
     if (!KSUCCESS(Status)) {
         if (StreamBuffer != NULL) {
-            if (StreamBuffer->Lock != NULL) {
-                KeDestroyQueuedLock(StreamBuffer->Lock);
-            }
-
-            if (StreamBuffer->Buffer != NULL) {
-                MmFreePagedPool(StreamBuffer->Buffer);
-            }
-
-            MmFreePagedPool(StreamBuffer);
+            IoDestroyStreamBuffer(StreamBuffer);
             StreamBuffer = NULL;
         }
     }
@@ -244,8 +289,16 @@ Return Value:
 
 {
 
-    if (StreamBuffer->Lock != NULL) {
-        KeDestroyQueuedLock(StreamBuffer->Lock);
+    if (StreamBuffer->ReadLock != NULL) {
+        KeDestroyQueuedLock(StreamBuffer->ReadLock);
+    }
+
+    if (StreamBuffer->WriteLock != NULL) {
+        KeDestroyQueuedLock(StreamBuffer->WriteLock);
+    }
+
+    if (StreamBuffer->EventLock != NULL) {
+        KeDestroyQueuedLock(StreamBuffer->EventLock);
     }
 
     StreamBuffer->IoState = NULL;
@@ -304,15 +357,14 @@ Return Value:
 {
 
     ULONG BytesAvailable;
-    ULONG BytesReadHere;
     ULONG BytesToRead;
     ULONG EventsMask;
-    ULONG NextWriteOffset;
+    ULONG FreeSpace;
+    ULONG ReadPosition;
     ULONG ReturnedEvents;
     KSTATUS Status;
 
     *BytesRead = 0;
-    BytesReadHere = 0;
     EventsMask = POLL_EVENT_IN | POLL_ERROR_EVENTS;
 
     ASSERT(KeGetRunLevel() == RunLevelLow);
@@ -322,7 +374,7 @@ Return Value:
     //
 
     Status = STATUS_SUCCESS;
-    while (BytesReadHere == 0) {
+    while (*BytesRead == 0) {
 
         //
         // Unless in non-blocking mode, wait for either the read or error
@@ -345,37 +397,45 @@ Return Value:
         }
 
         //
-        // Multiple threads might have come out of waiting. Acquire the lock.
+        // Multiple readers might have come out of waiting. Acquire the read
+        // lock. Writers are not held off by this.
         //
 
-        KeAcquireQueuedLock(StreamBuffer->Lock);
+        KeAcquireQueuedLock(StreamBuffer->ReadLock);
+        ReadPosition = StreamBuffer->ReadPosition;
+        BytesAvailable = StreamBuffer->WritePosition - ReadPosition;
 
         //
-        // Start over if there's nothing to read.
+        // Make sure the data is not read before the write position that
+        // covers it.
         //
 
-        if (StreamBuffer->NextReadOffset == StreamBuffer->NextWriteOffset) {
+        RtlMemoryBarrier();
 
-            //
-            // If the IN flag is set, then that would mean this routine is
-            // busy spinning. Poor form.
-            //
-
-            ASSERT((NonBlocking != FALSE) ||
-                   ((StreamBuffer->IoState->Events & POLL_ERROR_EVENTS) != 0) ||
-                   ((StreamBuffer->IoState->Events & POLL_EVENT_IN) == 0));
+        //
+        // Start over if there's nothing to read.
+        //
 
-            KeReleaseQueuedLock(StreamBuffer->Lock);
+        if (BytesAvailable == 0) {
 
             //
             // If the error event is set, error out.
             //
 
             if ((ReturnedEvents & POLL_ERROR_EVENTS) != 0) {
+                KeReleaseQueuedLock(StreamBuffer->ReadLock);
                 Status = STATUS_END_OF_FILE;
                 break;
             }
 
+            //
+            // The read event may have been left set by a batched wakeup.
+            // Clear it so that blocking readers actually block.
+            //
+
+            IopClearStreamBufferEvent(StreamBuffer, POLL_EVENT_IN);
+            KeReleaseQueuedLock(StreamBuffer->ReadLock);
+
             //
             // Blocking reads loop back to wait on the event, non-blocking
             // reads exit now.
@@ -383,133 +443,66 @@ Return Value:
 
             if (NonBlocking == FALSE) {
                 continue;
-
-            } else {
-                if (*BytesRead == 0) {
-                    Status = STATUS_TRY_AGAIN;
-                }
-
-                break;
             }
+
+            Status = STATUS_TRY_AGAIN;
+            break;
         }
 
         //
-        // Now read the buffer, at least going to the end of the buffer.
-        // Wraparounds will be handled later on.
+        // Copy straight out of the ring into the caller's buffer, wrapping
+        // around the end if needed.
         //
 
-        NextWriteOffset = StreamBuffer->NextWriteOffset;
-
-        ASSERT(NextWriteOffset < StreamBuffer->Size);
-
-        if (NextWriteOffset > StreamBuffer->NextReadOffset) {
-            BytesAvailable = NextWriteOffset - StreamBuffer->NextReadOffset;
-
-        } else {
-            BytesAvailable = StreamBuffer->Size - StreamBuffer->NextReadOffset;
-        }
-
         BytesToRead = BytesAvailable;
         if (ByteCount < BytesToRead) {
             BytesToRead = ByteCount;
         }
 
-        Status = MmCopyIoBufferData(
-                           IoBuffer,
-                           StreamBuffer->Buffer + StreamBuffer->NextReadOffset,
-                           *BytesRead,
-                           BytesToRead,
-                           TRUE);
+        Status = IopCopyStreamBufferData(StreamBuffer,
+                                         IoBuffer,
+                                         0,
+                                         ReadPosition,
+                                         BytesToRead,
+                                         TRUE);
 
         if (!KSUCCESS(Status)) {
-            KeReleaseQueuedLock(StreamBuffer->Lock);
-            return Status;
+            KeReleaseQueuedLock(StreamBuffer->ReadLock);
+            break;
         }
 
         //
-        // Update the read offset so that it always contains a valid value.
+        // Finish reading the data before handing the space back to writers.
         //
 
-        if (StreamBuffer->NextReadOffset + BytesToRead == StreamBuffer->Size) {
-            StreamBuffer->NextReadOffset = 0;
-
-        } else {
-            StreamBuffer->NextReadOffset += BytesToRead;
-        }
-
-        ASSERT(StreamBuffer->NextReadOffset < StreamBuffer->Size);
-
-        *BytesRead += BytesToRead;
-        BytesReadHere += BytesToRead;
-        ByteCount -= BytesToRead;
+        RtlMemoryBarrier();
+        StreamBuffer->ReadPosition = ReadPosition + BytesToRead;
+        *BytesRead = BytesToRead;
 
         //
-        // The first copy is done, but it's possible that the eligible read
-        // content wraps around. Grab the rest of that data if so.
+        // Adjust the events, unless the error events are set, as this is
+        // probably a disconnected pipe with some data left in it. If the
+        // buffer was drained, clear the read event. The write event must be
+        // set whenever an atomic write fits, since that is exactly when
+        // writers clear it. Setting an event that is already set is free, so
+        // writers are only woken once, when the space crosses that size.
         //
 
-        if ((ByteCount != 0) &&
-            (StreamBuffer->NextReadOffset != NextWriteOffset)) {
-
-            ASSERT(StreamBuffer->NextReadOffset == 0);
-            ASSERT(NextWriteOffset > StreamBuffer->NextReadOffset);
-
-            BytesAvailable = NextWriteOffset - StreamBuffer->NextReadOffset;
-            BytesToRead = BytesAvailable;
-            if (ByteCount < BytesToRead) {
-                BytesToRead = ByteCount;
-            }
-
-            //
-            // Don't break out of the loop on failure right away, as the
-            // I/O state events need to be adjusted for the successful first
-            // copy that happened.
-            //
-
-            Status = MmCopyIoBufferData(
-                           IoBuffer,
-                           StreamBuffer->Buffer + StreamBuffer->NextReadOffset,
-                           *BytesRead,
-                           BytesToRead,
-                           TRUE);
-
-            if (KSUCCESS(Status)) {
-                StreamBuffer->NextReadOffset += BytesToRead;
-
-                ASSERT(StreamBuffer->NextReadOffset < StreamBuffer->Size);
-
-                *BytesRead += BytesToRead;
-                BytesReadHere += BytesToRead;
-                ByteCount -= BytesToRead;
+        if ((ReturnedEvents & POLL_ERROR_EVENTS) == 0) {
+            if (BytesToRead == BytesAvailable) {
+                IopClearStreamBufferEvent(StreamBuffer, POLL_EVENT_IN);
             }
-        }
 
-        //
-        // Signal the write event (since more space was just made), and signal
-        // the read event if there is still data left to be read. Don't do
-        // this if the error events are set, as this is probably a disconnected
-        // pipe with some data left in it.
-        //
+            FreeSpace = StreamBuffer->Capacity -
+                        (StreamBuffer->WritePosition -
+                         StreamBuffer->ReadPosition);
 
-        if ((ReturnedEvents & POLL_ERROR_EVENTS) == 0) {
-            IoSetIoObjectState(StreamBuffer->IoState, POLL_EVENT_OUT, TRUE);
-            if (StreamBuffer->NextReadOffset != StreamBuffer->NextWriteOffset) {
-                IoSetIoObjectState(StreamBuffer->IoState, POLL_EVENT_IN, TRUE);
-
-            } else {
-                IoSetIoObjectState(StreamBuffer->IoState, POLL_EVENT_IN, FALSE);
+            if (FreeSpace >= StreamBuffer->AtomicWriteSize) {
+                IopSignalStreamBufferEvent(StreamBuffer, POLL_EVENT_OUT);
             }
         }
 
-        KeReleaseQueuedLock(StreamBuffer->Lock);
-
-        //
-        // If that second copy failed, now's the time to break out.
-        //
-
-        if (!KSUCCESS(Status)) {
-            return Status;
-        }
+        KeReleaseQueuedLock(StreamBuffer->ReadLock);
     }
 
     return Status;
@@ -560,13 +553,12 @@ Return Value:
 
 {
 
-    ULONG BytesAvailable;
     ULONG BytesToWrite;
     ULONG EventsMask;
-    ULONG NextReadOffset;
+    ULONG FreeSpace;
     ULONG ReturnedEvents;
     KSTATUS Status;
-    ULONG TotalBytesAvailable;
+    ULONG WritePosition;
 
     *BytesWritten = 0;
     EventsMask = POLL_EVENT_OUT | POLL_ERROR_EVENTS;
@@ -593,52 +585,21 @@ Return Value:
         }
 
         //
-        // Multiple threads might have come out of waiting since read and
-        // write aren't synchronized.
+        // Multiple writers might have come out of waiting. Acquire the write
+        // lock. Readers are not held off by this.
         //
 
-        KeAcquireQueuedLock(StreamBuffer->Lock);
+        KeAcquireQueuedLock(StreamBuffer->WriteLock);
+        WritePosition = StreamBuffer->WritePosition;
+        FreeSpace = StreamBuffer->Capacity -
+                    (WritePosition - StreamBuffer->ReadPosition);
 
         //
-        // Figure out how much room there is.
+        // Make sure the space is not overwritten before the read position
+        // that frees it.
         //
 
-        NextReadOffset = StreamBuffer->NextReadOffset;
-
-        ASSERT(NextReadOffset < StreamBuffer->Size);
-
-        if (NextReadOffset <= StreamBuffer->NextWriteOffset) {
-
-            //
-            // The total available is the entire buffer (minus one) minus the
-            // distance between the read and write pointers.
-            //
-
-            TotalBytesAvailable = (StreamBuffer->Size - 1) -
-                                  (StreamBuffer->NextWriteOffset -
-                                   NextReadOffset);
-
-            //
-            // The first copy goes from the next write offset to the end, but
-            // if the read offset is right at zero then the padding byte is at
-            // the end there.
-            //
-
-            BytesAvailable = StreamBuffer->Size - StreamBuffer->NextWriteOffset;
-            if (NextReadOffset == 0) {
-                BytesAvailable -= 1;
-            }
-
-        } else {
-
-            //
-            // The total available space is the distance between the write
-            // catching up to the read, minus the one buffer byte.
-            //
-
-            BytesAvailable = NextReadOffset - StreamBuffer->NextWriteOffset - 1;
-            TotalBytesAvailable = BytesAvailable;
-        }
+        RtlMemoryBarrier();
 
         //
         // Start over if the buffer is full. The stream stipulates that it will
@@ -646,11 +607,11 @@ Return Value:
         // interleaving.
         //
 
-        if ((TotalBytesAvailable < ByteCount) &&
-            (TotalBytesAvailable < StreamBuffer->AtomicWriteSize)) {
+        if ((FreeSpace < ByteCount) &&
+            (FreeSpace < StreamBuffer->AtomicWriteSize)) {
 
-            IoSetIoObjectState(StreamBuffer->IoState, POLL_EVENT_OUT, FALSE);
-            KeReleaseQueuedLock(StreamBuffer->Lock);
+            IopClearStreamBufferEvent(StreamBuffer, POLL_EVENT_OUT);
+            KeReleaseQueuedLock(StreamBuffer->WriteLock);
             if (NonBlocking == FALSE) {
                 continue;
 
@@ -664,116 +625,175 @@ Return Value:
         }
 
         //
-        // Now write to the buffer, at least going to the end of the buffer.
-        // Wraparounds will be handled later on.
+        // Copy straight from the caller's buffer into the ring, wrapping
+        // around the end if needed.
         //
 
-        ASSERT(BytesAvailable != 0);
+        ASSERT(FreeSpace != 0);
 
-        BytesToWrite = BytesAvailable;
+        BytesToWrite = FreeSpace;
         if (ByteCount < BytesToWrite) {
             BytesToWrite = ByteCount;
         }
 
-        Status = MmCopyIoBufferData(
-                          IoBuffer,
-                          StreamBuffer->Buffer + StreamBuffer->NextWriteOffset,
-                          *BytesWritten,
-                          BytesToWrite,
-                          FALSE);
+        Status = IopCopyStreamBufferData(StreamBuffer,
+                                         IoBuffer,
+                                         *BytesWritten,
+                                         WritePosition,
+                                         BytesToWrite,
+                                         FALSE);
 
         if (!KSUCCESS(Status)) {
-            KeReleaseQueuedLock(StreamBuffer->Lock);
-            return Status;
+            KeReleaseQueuedLock(StreamBuffer->WriteLock);
+            break;
         }
 
         //
-        // Update the next write pointer in a manner that ensures its value is
-        // always valid.
+        // Finish writing the data before publishing it to readers.
         //
 
-        if (StreamBuffer->NextWriteOffset + BytesToWrite ==
-            StreamBuffer->Size) {
-
-            StreamBuffer->NextWriteOffset = 0;
-
-        } else {
-            StreamBuffer->NextWriteOffset += BytesToWrite;
-        }
-
+        RtlMemoryBarrier();
+        StreamBuffer->WritePosition = WritePosition + BytesToWrite;
         *BytesWritten += BytesToWrite;
         ByteCount -= BytesToWrite;
-        TotalBytesAvailable -= BytesToWrite;
+        FreeSpace -= BytesToWrite;
 
         //
-        // The first copy is done, but it's possible that the eligible space
-        // wraps around. Write the remainder if so.
+        // Signal the read event if it is not already set. Readers that are
+        // already awake pick up the new data without another wakeup. Clear
+        // the write event if the buffer is now too full for another atomic
+        // write.
         //
 
-        if ((ByteCount != 0) &&
-            (((StreamBuffer->NextWriteOffset + 1) % StreamBuffer->Size) !=
-                                                             NextReadOffset)) {
+        IopSignalStreamBufferEvent(StreamBuffer, POLL_EVENT_IN);
+        if (FreeSpace < StreamBuffer->AtomicWriteSize) {
+            IopClearStreamBufferEvent(StreamBuffer, POLL_EVENT_OUT);
+        }
 
-            ASSERT(StreamBuffer->NextWriteOffset == 0);
-            ASSERT(NextReadOffset > StreamBuffer->NextWriteOffset + 1);
+        KeReleaseQueuedLock(StreamBuffer->WriteLock);
+    }
 
-            BytesAvailable = NextReadOffset - StreamBuffer->NextWriteOffset - 1;
-            BytesToWrite = BytesAvailable;
-            if (ByteCount < BytesToWrite) {
-                BytesToWrite = ByteCount;
-            }
+    return Status;
+}
 
-            //
-            // Don't break out of the loop on failure right away, as the
-            // I/O state events need to be adjusted for the successful first
-            // copy that happened.
-            //
+KSTATUS
+IoGetSetStreamBufferSize (
+    PSTREAM_BUFFER StreamBuffer,
+    BOOL Set,
+    PULONG Size
+    )
 
-            Status = MmCopyIoBufferData(
-                          IoBuffer,
-                          StreamBuffer->Buffer + StreamBuffer->NextWriteOffset,
-                          *BytesWritten,
-                          BytesToWrite,
-                          FALSE);
+/*++
 
-            if (KSUCCESS(Status)) {
-                StreamBuffer->NextWriteOffset += BytesToWrite;
+Routine Description:
 
-                ASSERT(StreamBuffer->NextWriteOffset < StreamBuffer->Size);
+    This routine gets or sets the capacity of a stream buffer. Data already in
+    the buffer is preserved across a resize.
 
-                *BytesWritten += BytesToWrite;
-                ByteCount -= BytesToWrite;
-                TotalBytesAvailable -= BytesToWrite;
-            }
-        }
+Arguments:
 
-        //
-        // Signal the read event (since there's now stuff to read), and signal
-        // the write event if there is still space left.
-        //
+    StreamBuffer - Supplies a pointer to the stream buffer.
 
-        IoSetIoObjectState(StreamBuffer->IoState, POLL_EVENT_IN, TRUE);
+    Set - Supplies a boolean indicating whether to get the current capacity
+        (FALSE) or set a new one (TRUE).
 
-        ASSERT(TotalBytesAvailable < StreamBuffer->Size);
+    Size - Supplies a pointer that on input contains the requested capacity
+        when setting. The requested size is rounded up to a whole number of
+        pages. On output, returns the resulting capacity in bytes.
 
-        if (TotalBytesAvailable >= StreamBuffer->AtomicWriteSize) {
-            IoSetIoObjectState(StreamBuffer->IoState, POLL_EVENT_OUT, TRUE);
+Return Value:
 
-        } else {
-            IoSetIoObjectState(StreamBuffer->IoState, POLL_EVENT_OUT, FALSE);
-        }
+    STATUS_SUCCESS on success.
 
-        KeReleaseQueuedLock(StreamBuffer->Lock);
+    STATUS_INVALID_PARAMETER if the requested size is larger than the maximum
+    allowed.
 
-        //
-        // If that second copy failed, now is the time to exit.
-        //
+    STATUS_RESOURCE_IN_USE if the buffer currently holds more data than would
+    fit in the requested capacity.
 
-        if (!KSUCCESS(Status)) {
-            return Status;
-        }
+    STATUS_INSUFFICIENT_RESOURCES on allocation failure.
+
+--*/
+
+{
+
+    ULONG BytesAvailable;
+    ULONG Capacity;
+    ULONG FirstSize;
+    PVOID NewBuffer;
+    ULONG Offset;
+    PVOID OldBuffer;
+    KSTATUS Status;
+
+    if (Set == FALSE) {
+        *Size = StreamBuffer->Capacity;
+        return STATUS_SUCCESS;
+    }
+
+    if (*Size > MAXIMUM_STREAM_BUFFER_SIZE) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    Capacity = IopGetStreamBufferCapacity(*Size,
+                                          StreamBuffer->AtomicWriteSize);
+
+    if (Capacity == StreamBuffer->Capacity) {
+        *Size = Capacity;
+        return STATUS_SUCCESS;
+    }
+
+    NewBuffer = MmAllocatePagedPool(Capacity, FI_ALLOCATION_TAG);
+    if (NewBuffer == NULL) {
+        return STATUS_INSUFFICIENT_RESOURCES;
     }
 
+    //
+    // Hold off both ends while the contents move.
+    //
+
+    KeAcquireQueuedLock(StreamBuffer->WriteLock);
+    KeAcquireQueuedLock(StreamBuffer->ReadLock);
+    BytesAvailable = StreamBuffer->WritePosition - StreamBuffer->ReadPosition;
+    if (BytesAvailable > Capacity) {
+        OldBuffer = NewBuffer;
+        Status = STATUS_RESOURCE_IN_USE;
+        goto GetSetStreamBufferSizeEnd;
+    }
+
+    //
+    // Copy the unread data to the start of the new buffer.
+    //
+
+    Offset = StreamBuffer->ReadPosition & (StreamBuffer->Capacity - 1);
+    FirstSize = StreamBuffer->Capacity - Offset;
+    if (FirstSize > BytesAvailable) {
+        FirstSize = BytesAvailable;
+    }
+
+    RtlCopyMemory(NewBuffer, StreamBuffer->Buffer + Offset, FirstSize);
+    RtlCopyMemory(NewBuffer + FirstSize,
+                  StreamBuffer->Buffer,
+                  BytesAvailable - FirstSize);
+
+    OldBuffer = StreamBuffer->Buffer;
+    StreamBuffer->Buffer = NewBuffer;
+    StreamBuffer->Capacity = Capacity;
+    StreamBuffer->ReadPosition = 0;
+    StreamBuffer->WritePosition = BytesAvailable;
+    if ((Capacity - BytesAvailable) >= StreamBuffer->AtomicWriteSize) {
+        IopSignalStreamBufferEvent(StreamBuffer, POLL_EVENT_OUT);
+
+    } else {
+        IopClearStreamBufferEvent(StreamBuffer, POLL_EVENT_OUT);
+    }
+
+    *Size = Capacity;
+    Status = STATUS_SUCCESS;
+
+GetSetStreamBufferSizeEnd:
+    KeReleaseQueuedLock(StreamBuffer->ReadLock);
+    KeReleaseQueuedLock(StreamBuffer->WriteLock);
+    MmFreePagedPool(OldBuffer);
     return Status;
 }
 
@@ -801,59 +821,42 @@ Return Value:
 
 {
 
-    ULONG TotalBytesAvailable;
-
-    KeAcquireQueuedLock(StreamBuffer->Lock);
-
-    //
-    // Figure out how much space there is.
-    //
-
-    if (StreamBuffer->NextReadOffset <= StreamBuffer->NextWriteOffset) {
-
-        //
-        // The total available is the entire buffer (minus one) minus the
-        // distance between the read and write pointers.
-        //
-
-        TotalBytesAvailable = (StreamBuffer->Size - 1) -
-                              (StreamBuffer->NextWriteOffset -
-                               StreamBuffer->NextReadOffset);
-
-    } else {
-
-        //
-        // The total available space is the distance between the write
-        // catching up to the read, minus the one buffer byte.
-        //
+    ULONG BytesAvailable;
+    PIO_OBJECT_STATE IoState;
 
-        TotalBytesAvailable = StreamBuffer->NextReadOffset -
-                              StreamBuffer->NextWriteOffset - 1;
-    }
+    IoState = StreamBuffer->IoState;
+    KeAcquireQueuedLock(StreamBuffer->WriteLock);
+    KeAcquireQueuedLock(StreamBuffer->ReadLock);
+    KeAcquireQueuedLock(StreamBuffer->EventLock);
+    BytesAvailable = StreamBuffer->WritePosition - StreamBuffer->ReadPosition;
 
     //
     // Signal the write event if there's space to be written.
     //
 
-    if (TotalBytesAvailable >= StreamBuffer->AtomicWriteSize) {
-        IoSetIoObjectState(StreamBuffer->IoState, POLL_EVENT_OUT, TRUE);
+    if ((StreamBuffer->Capacity - BytesAvailable) >=
+        StreamBuffer->AtomicWriteSize) {
+
+        IoSetIoObjectState(IoState, POLL_EVENT_OUT, TRUE);
 
     } else {
-        IoSetIoObjectState(StreamBuffer->IoState, POLL_EVENT_OUT, FALSE);
+        IoSetIoObjectState(IoState, POLL_EVENT_OUT, FALSE);
     }
 
     //
     // Signal the read event if there's data in there.
     //
 
-    if (TotalBytesAvailable != StreamBuffer->Size - 1) {
-        IoSetIoObjectState(StreamBuffer->IoState, POLL_EVENT_IN, TRUE);
+    if (BytesAvailable != 0) {
+        IoSetIoObjectState(IoState, POLL_EVENT_IN, TRUE);
 
     } else {
-        IoSetIoObjectState(StreamBuffer->IoState, POLL_EVENT_IN, FALSE);
+        IoSetIoObjectState(IoState, POLL_EVENT_IN, FALSE);
     }
 
-    KeReleaseQueuedLock(StreamBuffer->Lock);
+    KeReleaseQueuedLock(StreamBuffer->EventLock);
+    KeReleaseQueuedLock(StreamBuffer->ReadLock);
+    KeReleaseQueuedLock(StreamBuffer->WriteLock);
     return STATUS_SUCCESS;
 }
 
@@ -887,3 +890,223 @@ Return Value:
 // --------------------------------------------------------- Internal Functions
 //
 
+ULONG
+IopGetStreamBufferCapacity (
+    ULONG Size,
+    ULONG AtomicWriteSize
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines the ring capacity to use for a requested stream
+    buffer size.
+
+Arguments:
+
+    Size - Supplies the requested size in bytes.
+
+    AtomicWriteSize - Supplies the atomic write size of the stream, which the
+        buffer must be able to hold.
+
+Return Value:
+
+    Returns the capacity: a power of two at least a page in size that holds
+    both the requested size and the atomic write size.
+
+--*/
+
+{
+
+    ULONG Capacity;
+
+    if (Size < AtomicWriteSize) {
+        Size = AtomicWriteSize;
+    }
+
+    Capacity = MmPageSize();
+    while (Capacity < Size) {
+        Capacity <<= 1;
+    }
+
+    ASSERT(POWER_OF_2(Capacity));
+
+    return Capacity;
+}
+
+KSTATUS
+IopCopyStreamBufferData (
+    PSTREAM_BUFFER StreamBuffer,
+    PIO_BUFFER IoBuffer,
+    UINTN IoBufferOffset,
+    ULONG Position,
+    ULONG Size,
+    BOOL ToIoBuffer
+    )
+
+/*++
+
+Routine Description:
+
+    This routine copies data between an I/O buffer and the ring, handling the
+    wrap around the end of the ring.
+
+Arguments:
+
+    StreamBuffer - Supplies a pointer to the stream buffer.
+
+    IoBuffer - Supplies a pointer to the I/O buffer.
+
+    IoBufferOffset - Supplies the offset into the I/O buffer to copy to or
+        from.
+
+    Position - Supplies the free-running ring position to start at.
+
+    Size - Supplies the number of bytes to copy. This must not exceed the
+        capacity of the ring.
+
+    ToIoBuffer - Supplies a boolean indicating whether to copy from the ring
+        into the I/O buffer (TRUE) or from the I/O buffer into the ring
+        (FALSE).
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    ULONG FirstSize;
+    ULONG Offset;
+    KSTATUS Status;
+
+    ASSERT(Size <= StreamBuffer->Capacity);
+
+    Offset = Position & (StreamBuffer->Capacity - 1);
+    FirstSize = StreamBuffer->Capacity - Offset;
+    if (FirstSize > Size) {
+        FirstSize = Size;
+    }
+
+    Status = MmCopyIoBufferData(IoBuffer,
+                                StreamBuffer->Buffer + Offset,
+                                IoBufferOffset,
+                                FirstSize,
+                                ToIoBuffer);
+
+    if (!KSUCCESS(Status)) {
+        return Status;
+    }
+
+    if (FirstSize != Size) {
+        Status = MmCopyIoBufferData(IoBuffer,
+                                    StreamBuffer->Buffer,
+                                    IoBufferOffset + FirstSize,
+                                    Size - FirstSize,
+                                    ToIoBuffer);
+    }
+
+    return Status;
+}
+
+VOID
+IopSignalStreamBufferEvent (
+    PSTREAM_BUFFER StreamBuffer,
+    ULONG Event
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sets a stream buffer event if it is not already set. The
+    caller must have published the position change that justifies the event
+    before calling this routine.
+
+Arguments:
+
+    StreamBuffer - Supplies a pointer to the stream buffer.
+
+    Event - Supplies the poll event to set.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    //
+    // Order the check after the caller's position update, so that a
+    // concurrent clear either is seen here or sees the new position.
+    //
+
+    RtlMemoryBarrier();
+    if ((StreamBuffer->IoState->Events & Event) != 0) {
+        return;
+    }
+
+    KeAcquireQueuedLock(StreamBuffer->EventLock);
+    IoSetIoObjectState(StreamBuffer->IoState, Event, TRUE);
+    KeReleaseQueuedLock(StreamBuffer->EventLock);
+    return;
+}
+
+VOID
+IopClearStreamBufferEvent (
+    PSTREAM_BUFFER StreamBuffer,
+    ULONG Event
+    )
+
+/*++
+
+Routine Description:
+
+    This routine clears a stream buffer event, then sets it again if the
+    other end changed the buffer enough in the meantime to warrant it. This
+    closes the window where the other end sees the event still set, skips its
+    signal, and the event then gets cleared out from under it.
+
+Arguments:
+
+    StreamBuffer - Supplies a pointer to the stream buffer.
+
+    Event - Supplies the poll event to clear. Only POLL_EVENT_IN and
+        POLL_EVENT_OUT are supported.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG BytesAvailable;
+    BOOL Set;
+
+    ASSERT((Event == POLL_EVENT_IN) || (Event == POLL_EVENT_OUT));
+
+    KeAcquireQueuedLock(StreamBuffer->EventLock);
+    IoSetIoObjectState(StreamBuffer->IoState, Event, FALSE);
+    RtlMemoryBarrier();
+    BytesAvailable = StreamBuffer->WritePosition - StreamBuffer->ReadPosition;
+    if (Event == POLL_EVENT_IN) {
+        Set = (BytesAvailable != 0);
+
+    } else {
+        Set = ((StreamBuffer->Capacity - BytesAvailable) >=
+               StreamBuffer->AtomicWriteSize);
+    }
+
+    if (Set != FALSE) {
+        IoSetIoObjectState(StreamBuffer->IoState, Event, TRUE);
+    }
+
+    KeReleaseQueuedLock(StreamBuffer->EventLock);
+    return;
+}
+
@@ -58,6 +58,31 @@ Module Name:
 
 #define UNIX_SOCKET_MAX_CONTROL_DATA 32768
 
+//
+// Define the initial and maximum sizes of the receive ring used by connected
+// stream sockets. Plain stream data is copied into this ring rather than into
+// individually allocated packets. The ring starts small and doubles as data
+// backs up, up to the default send maximum so that a sender with the default
+// limit never overflows it. Once a grown ring drains it is freed, so idle
+// connections only ever hold a small ring. Both must be powers of two.
+//
+
+#define UNIX_SOCKET_STREAM_RING_INITIAL_SIZE 0x1000
+#define UNIX_SOCKET_STREAM_RING_MAX_SIZE UNIX_SOCKET_DEFAULT_SEND_MAX
+
+//
+// Define the largest payload that is allocated from the small packet block
+// allocator rather than from paged pool.
+//
+
+#define UNIX_SOCKET_SMALL_PACKET_SIZE 512
+
+//
+// Define the number of small packets the block allocator grows by at a time.
+//
+
+#define UNIX_SOCKET_PACKET_EXPANSION_COUNT 32
+
 //
 // Define local socket flags.
 //
@@ -202,6 +227,18 @@ Structure Description:
     Credentials - Stores the credentials of the process when the socket was
         connected.
 
+    Ring - Stores an optional pointer to the receive ring of a connected
+        stream socket, allocated the first time plain data is sent to it. All
+        data in the ring was sent by the remote socket and precedes anything
+        on the receive list.
+
+    RingSize - Stores the size of the ring in bytes, a power of two. This is
+        zero if no ring is allocated.
+
+    RingStart - Stores the offset of the first unread byte in the ring.
+
+    RingCount - Stores the number of unread bytes in the ring.
+
 --*/
 
 struct _UNIX_SOCKET {
@@ -220,6 +257,10 @@ struct _UNIX_SOCKET {
     PUNIX_SOCKET Remote;
     ULONG Flags;
     UNIX_SOCKET_CREDENTIALS Credentials;
+    PUCHAR Ring;
+    UINTN RingSize;
+    UINTN RingStart;
+    UINTN RingCount;
 };
 
 //
@@ -251,6 +292,31 @@ IopUnixSocketDestroyPacket (
     PUNIX_SOCKET_PACKET Packet
     );
 
+KSTATUS
+IopUnixSocketWriteRing (
+    PUNIX_SOCKET Socket,
+    PIO_BUFFER IoBuffer,
+    UINTN Offset,
+    UINTN Size
+    );
+
+KSTATUS
+IopUnixSocketCopyRingData (
+    PUNIX_SOCKET Socket,
+    UINTN RingOffset,
+    PIO_BUFFER IoBuffer,
+    UINTN IoBufferOffset,
+    UINTN Size,
+    BOOL ToIoBuffer
+    );
+
+KSTATUS
+IopUnixSocketReturnSenderAddress (
+    BOOL FromKernelMode,
+    PUNIX_SOCKET Sender,
+    PSOCKET_IO_PARAMETERS Parameters
+    );
+
 KSTATUS
 IopUnixSocketSendControlData (
     BOOL FromKernelMode,
@@ -277,10 +343,58 @@ IopUnixSocketInitializeCredentials (
 // -------------------------------------------------------------------- Globals
 //
 
+//
+// Store the block allocator used for packets with small payloads, which are
+// the common case for datagram and sequenced packet sockets.
+//
+
+PBLOCK_ALLOCATOR IoUnixSocketPacketAllocator;
+
 //
 // ------------------------------------------------------------------ Functions
 //
 
+KSTATUS
+IopInitializeUnixSocketSupport (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine is called during system initialization to set up support for
+    Unix domain sockets.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    PBLOCK_ALLOCATOR BlockAllocator;
+
+    BlockAllocator = MmCreateBlockAllocator(
+                  sizeof(UNIX_SOCKET_PACKET) + UNIX_SOCKET_SMALL_PACKET_SIZE,
+                  0,
+                  UNIX_SOCKET_PACKET_EXPANSION_COUNT,
+                  BLOCK_ALLOCATOR_FLAG_TRIM,
+                  UNIX_SOCKET_ALLOCATION_TAG);
+
+    if (BlockAllocator == NULL) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    IoUnixSocketPacketAllocator = BlockAllocator;
+    return STATUS_SUCCESS;
+}
+
 KSTATUS
 IopCreateUnixSocketPair (
     NET_SOCKET_TYPE Type,
@@ -523,6 +637,11 @@ Return Value:
     ASSERT(UnixSocket->CurrentBacklog == 0);
     ASSERT(UnixSocket->SendListSize == 0);
     ASSERT(LIST_EMPTY(&(UnixSocket->ReceiveList)) != FALSE);
+    ASSERT(UnixSocket->RingCount == 0);
+
+    if (UnixSocket->Ring != NULL) {
+        MmFreePagedPool(UnixSocket->Ring);
+    }
 
     if (UnixSocket->PathPoint.PathEntry != NULL) {
         IO_PATH_POINT_RELEASE_REFERENCE(&(UnixSocket->PathPoint));
@@ -1347,6 +1466,7 @@ Return Value:
 {
 
     UINTN BytesCompleted;
+    UINTN ChargedSize;
     PNETWORK_ADDRESS Destination;
     NETWORK_ADDRESS DestinationLocal;
     PFILE_OBJECT FileObject;
@@ -1365,10 +1485,12 @@ Return Value:
     PKTHREAD Thread;
     PUNIX_SOCKET UnixSocket;
     BOOL UnixSocketLockHeld;
+    BOOL UseRing;
     PCSTR WalkedPath;
     ULONG WalkedPathSize;
 
     BytesCompleted = 0;
+    ChargedSize = 0;
     Packet = NULL;
     IO_INITIALIZE_PATH_POINT(&PathPoint);
     RemoteCopy = NULL;
@@ -1551,19 +1673,32 @@ Return Value:
         }
 
         //
-        // Create the packet.
+        // Create the packet. Plain stream data with no control data or
+        // credentials attached is copied straight into the remote's receive
+        // ring instead, which avoids allocating anything per send.
         //
 
         Packet = NULL;
+        UseRing = FALSE;
         if (PacketSize != 0) {
-            Status = IopUnixSocketCreatePacket(UnixSocket,
-                                               IoBuffer,
-                                               BytesCompleted,
-                                               PacketSize,
-                                               &Packet);
+            if ((Socket->Type == NetSocketStream) &&
+                ((Parameters->ControlData == NULL) ||
+                 (Parameters->ControlDataSize == 0)) &&
+                (((UnixSocket->Flags | RemoteUnixSocket->Flags) &
+                  UNIX_SOCKET_FLAG_SEND_CREDENTIALS) == 0)) {
 
-            if (!KSUCCESS(Status)) {
-                goto UnixSocketSendDataEnd;
+                UseRing = TRUE;
+
+            } else {
+                Status = IopUnixSocketCreatePacket(UnixSocket,
+                                                   IoBuffer,
+                                                   BytesCompleted,
+                                                   PacketSize,
+                                                   &Packet);
+
+                if (!KSUCCESS(Status)) {
+                    goto UnixSocketSendDataEnd;
+                }
             }
 
             //
@@ -1571,11 +1706,13 @@ Return Value:
             //
 
             UnixSocket->SendListSize += PacketSize;
+            ChargedSize = PacketSize;
             if (UnixSocket->SendListSize >= UnixSocket->SendListMax) {
                 IoSetIoObjectState(Socket->IoState, POLL_EVENT_OUT, FALSE);
             }
 
-            if ((Parameters->ControlData != NULL) &&
+            if ((Packet != NULL) &&
+                (Parameters->ControlData != NULL) &&
                 (Parameters->ControlDataSize != 0)) {
 
                 Status = IopUnixSocketSendControlData(
@@ -1594,7 +1731,8 @@ Return Value:
             // Send the credentials if either side has that option set.
             //
 
-            if ((Packet->Credentials.ProcessId == -1) &&
+            if ((Packet != NULL) &&
+                (Packet->Credentials.ProcessId == -1) &&
                 (((UnixSocket->Flags | RemoteUnixSocket->Flags) &
                   UNIX_SOCKET_FLAG_SEND_CREDENTIALS) != 0)) {
 
@@ -1617,10 +1755,10 @@ Return Value:
         UnixSocketLockHeld = FALSE;
 
         //
-        // If no packet was created, wait for some space to open up.
+        // If nothing was charged, wait for some space to open up.
         //
 
-        if (Packet == NULL) {
+        if (ChargedSize == 0) {
             if ((OpenFlags & OPEN_FLAG_NON_BLOCKING) != 0) {
                 if (BytesCompleted != 0) {
                     Status = STATUS_SUCCESS;
@@ -1674,20 +1812,53 @@ Return Value:
             goto UnixSocketSendDataEnd;
         }
 
-        INSERT_BEFORE(&(Packet->ListEntry), &(RemoteUnixSocket->ReceiveList));
-
         //
-        // If this is the only item on the list, signal the remote socket.
+        // Try to put stream data in the receive ring. If packets are already
+        // queued or the ring is full, fall back to a packet so the data stays
+        // in order.
         //
 
-        if (Packet->ListEntry.Previous == &(RemoteUnixSocket->ReceiveList)) {
-            IoSetIoObjectState(RemoteUnixSocket->KernelSocket.IoState,
-                               POLL_EVENT_IN,
-                               TRUE);
+        if (UseRing != FALSE) {
+            Status = IopUnixSocketWriteRing(RemoteUnixSocket,
+                                            IoBuffer,
+                                            BytesCompleted,
+                                            PacketSize);
+
+            if (Status == STATUS_BUFFER_TOO_SMALL) {
+                Status = IopUnixSocketCreatePacket(UnixSocket,
+                                                   IoBuffer,
+                                                   BytesCompleted,
+                                                   PacketSize,
+                                                   &Packet);
+            }
+
+            if (!KSUCCESS(Status)) {
+                KeReleaseQueuedLock(RemoteUnixSocket->Lock);
+                goto UnixSocketSendDataEnd;
+            }
+        }
+
+        if (Packet != NULL) {
+            INSERT_BEFORE(&(Packet->ListEntry),
+                          &(RemoteUnixSocket->ReceiveList));
+
+            //
+            // If this is the only item on the list, signal the remote socket.
+            //
+
+            if ((Packet->ListEntry.Previous ==
+                 &(RemoteUnixSocket->ReceiveList)) &&
+                (RemoteUnixSocket->RingCount == 0)) {
+
+                IoSetIoObjectState(RemoteUnixSocket->KernelSocket.IoState,
+                                   POLL_EVENT_IN,
+                                   TRUE);
+            }
         }
 
         KeReleaseQueuedLock(RemoteUnixSocket->Lock);
         Packet = NULL;
+        ChargedSize = 0;
         BytesCompleted += PacketSize;
         Size -= PacketSize;
     }
@@ -1700,23 +1871,26 @@ Return Value:
     if (!KSUCCESS(Status)) {
 
         //
-        // Roll back the charge to the socket if the packet is still around.
+        // Roll back the charge to the socket if the data never made it to
+        // the remote.
         //
 
-        if (Packet != NULL) {
+        if (ChargedSize != 0) {
             if (UnixSocketLockHeld == FALSE) {
                 KeAcquireQueuedLock(UnixSocket->Lock);
                 UnixSocketLockHeld = TRUE;
             }
 
-            ASSERT(UnixSocket->SendListSize >= Packet->Length);
+            ASSERT(UnixSocket->SendListSize >= ChargedSize);
 
-            UnixSocket->SendListSize -= Packet->Length;
+            UnixSocket->SendListSize -= ChargedSize;
             if (UnixSocket->SendListSize < UnixSocket->SendListMax) {
                 IoSetIoObjectState(Socket->IoState, POLL_EVENT_OUT, TRUE);
             }
 
-            IopUnixSocketDestroyPacket(Packet);
+            if (Packet != NULL) {
+                IopUnixSocketDestroyPacket(Packet);
+            }
         }
     }
 
@@ -1773,9 +1947,7 @@ Return Value:
     ULONG OpenFlags;
     PUNIX_SOCKET_PACKET Packet;
     PUNIX_SOCKET Remote;
-    NETWORK_ADDRESS RemoteAddressLocal;
     ULONG ReturnedEvents;
-    UINTN SenderCopySize;
     UINTN Size;
     KSTATUS Status;
     PUNIX_SOCKET UnixSocket;
@@ -1805,6 +1977,94 @@ Return Value:
             goto UnixSocketReceiveDataEnd;
         }
 
+        //
+        // Data in the receive ring always precedes anything on the receive
+        // list, so drain that first. Only the remote of a connected stream
+        // socket ever writes to the ring.
+        //
+
+        if (UnixSocket->RingCount != 0) {
+            Remote = UnixSocket->Remote;
+
+            ASSERT((Socket->Type == NetSocketStream) && (Remote != NULL));
+
+            ByteCount = UnixSocket->RingCount;
+            if (ByteCount > Size) {
+                ByteCount = Size;
+            }
+
+            Status = IopUnixSocketCopyRingData(UnixSocket,
+                                               UnixSocket->RingStart,
+                                               IoBuffer,
+                                               BytesReceived,
+                                               ByteCount,
+                                               TRUE);
+
+            if (!KSUCCESS(Status)) {
+                goto UnixSocketReceiveDataEnd;
+            }
+
+            if (FirstSender == NULL) {
+                Status = IopUnixSocketReturnSenderAddress(FromKernelMode,
+                                                          Remote,
+                                                          Parameters);
+
+                if (!KSUCCESS(Status)) {
+                    goto UnixSocketReceiveDataEnd;
+                }
+            }
+
+            UnixSocket->RingStart = (UnixSocket->RingStart + ByteCount) &
+                                    (UnixSocket->RingSize - 1);
+
+            UnixSocket->RingCount -= ByteCount;
+            BytesReceived += ByteCount;
+            Size -= ByteCount;
+            FirstSender = Remote;
+            if (UnixSocket->RingCount == 0) {
+                UnixSocket->RingStart = 0;
+
+                //
+                // Release a ring that grew to absorb a burst now that it is
+                // empty. The next send starts over with a small one.
+                //
+
+                if (UnixSocket->RingSize >
+                    UNIX_SOCKET_STREAM_RING_INITIAL_SIZE) {
+
+                    MmFreePagedPool(UnixSocket->Ring);
+                    UnixSocket->Ring = NULL;
+                    UnixSocket->RingSize = 0;
+                }
+
+                if (LIST_EMPTY(&(UnixSocket->ReceiveList)) != FALSE) {
+                    IoSetIoObjectState(Socket->IoState, POLL_EVENT_IN, FALSE);
+                }
+            }
+
+            //
+            // Return the charge to the sender. Hold a reference on it so it
+            // does not disappear once this socket's lock is released, as
+            // both locks should not be held at once.
+            //
+
+            IoSocketAddReference(&(Remote->KernelSocket));
+            KeReleaseQueuedLock(UnixSocket->Lock);
+            UnixSocketLockHeld = FALSE;
+            KeAcquireQueuedLock(Remote->Lock);
+
+            ASSERT(Remote->SendListSize >= ByteCount);
+
+            IoSetIoObjectState(Remote->KernelSocket.IoState,
+                               POLL_EVENT_OUT,
+                               TRUE);
+
+            Remote->SendListSize -= ByteCount;
+            KeReleaseQueuedLock(Remote->Lock);
+            IoSocketReleaseReference(&(Remote->KernelSocket));
+            continue;
+        }
+
         //
         // If the list is empty, wait and try again.
         //
@@ -1916,55 +2176,15 @@ Return Value:
             }
 
             //
-            // Return the remote path if requested.
-            //
-
-            if ((Parameters->RemotePath != NULL) &&
-                (Parameters->RemotePathSize != 0)) {
-
-                SenderCopySize = Packet->Sender->NameSize;
-                if (SenderCopySize > Parameters->RemotePathSize) {
-                    SenderCopySize = Parameters->RemotePathSize;
-                }
-
-                Parameters->RemotePathSize = Packet->Sender->NameSize;
-                if (SenderCopySize != 0) {
-                    if (FromKernelMode != FALSE) {
-                        RtlCopyMemory(Parameters->RemotePath,
-                                      Packet->Sender->Name,
-                                      SenderCopySize);
-
-                    } else {
-                        Status = MmCopyToUserMode(Parameters->RemotePath,
-                                                  Packet->Sender->Name,
-                                                  SenderCopySize);
-
-                        if (!KSUCCESS(Status)) {
-                            goto UnixSocketReceiveDataEnd;
-                        }
-                    }
-                }
-            }
-
-            //
-            // Copy the network address portion of the sender address as well.
+            // Return the remote address if requested.
             //
 
-            if (Parameters->NetworkAddress != NULL) {
-                if (FromKernelMode != FALSE) {
-                    Parameters->NetworkAddress->Domain = NetDomainLocal;
+            Status = IopUnixSocketReturnSenderAddress(FromKernelMode,
+                                                      Packet->Sender,
+                                                      Parameters);
 
-                } else {
-                    RtlZeroMemory(&RemoteAddressLocal, sizeof(NETWORK_ADDRESS));
-                    RemoteAddressLocal.Domain = NetDomainLocal;
-                    Status = MmCopyToUserMode(Parameters->NetworkAddress,
-                                              &RemoteAddressLocal,
-                                              sizeof(NETWORK_ADDRESS));
-
-                    if (!KSUCCESS(Status)) {
-                        goto UnixSocketReceiveDataEnd;
-                    }
-                }
+            if (!KSUCCESS(Status)) {
+                goto UnixSocketReceiveDataEnd;
             }
 
             //
@@ -2643,6 +2863,34 @@ Return Value:
 {
 
     PUNIX_SOCKET_PACKET Packet;
+    PUNIX_SOCKET Remote;
+
+    //
+    // Return the charge for anything in the ring to the remote, which wrote
+    // it.
+    //
+
+    if (Socket->RingCount != 0) {
+        Remote = Socket->Remote;
+
+        ASSERT(Remote != NULL);
+
+        KeAcquireQueuedLock(Remote->Lock);
+
+        ASSERT(Remote->SendListSize >= Socket->RingCount);
+
+        IoSetIoObjectState(Remote->KernelSocket.IoState, POLL_EVENT_OUT, TRUE);
+        Remote->SendListSize -= Socket->RingCount;
+        KeReleaseQueuedLock(Remote->Lock);
+        Socket->RingStart = 0;
+        Socket->RingCount = 0;
+    }
+
+    if (Socket->RingSize > UNIX_SOCKET_STREAM_RING_INITIAL_SIZE) {
+        MmFreePagedPool(Socket->Ring);
+        Socket->Ring = NULL;
+        Socket->RingSize = 0;
+    }
 
     while (LIST_EMPTY(&(Socket->ReceiveList)) == FALSE) {
         Packet = LIST_VALUE(Socket->ReceiveList.Next,
@@ -2708,8 +2956,20 @@ Return Value:
     PUNIX_SOCKET_PACKET Packet;
     KSTATUS Status;
 
-    AllocationSize = sizeof(UNIX_SOCKET_PACKET) + DataSize;
-    Packet = MmAllocatePagedPool(AllocationSize, UNIX_SOCKET_ALLOCATION_TAG);
+    //
+    // Small packets come from the block allocator, which recycles freed
+    // packets rather than going back to the pool each time.
+    //
+
+    if (DataSize <= UNIX_SOCKET_SMALL_PACKET_SIZE) {
+        Packet = MmAllocateBlock(IoUnixSocketPacketAllocator, NULL);
+
+    } else {
+        AllocationSize = sizeof(UNIX_SOCKET_PACKET) + DataSize;
+        Packet = MmAllocatePagedPool(AllocationSize,
+                                     UNIX_SOCKET_ALLOCATION_TAG);
+    }
+
     if (Packet == NULL) {
         return STATUS_INSUFFICIENT_RESOURCES;
     }
@@ -2731,7 +2991,13 @@ Return Value:
                                     FALSE);
 
         if (!KSUCCESS(Status)) {
-            MmFreePagedPool(Packet);
+            if (DataSize <= UNIX_SOCKET_SMALL_PACKET_SIZE) {
+                MmFreeBlock(IoUnixSocketPacketAllocator, Packet);
+
+            } else {
+                MmFreePagedPool(Packet);
+            }
+
             return Status;
         }
     }
@@ -2781,10 +3047,298 @@ Return Value:
     }
 
     IoSocketReleaseReference(&(Packet->Sender->KernelSocket));
-    MmFreePagedPool(Packet);
+    if (Packet->Length <= UNIX_SOCKET_SMALL_PACKET_SIZE) {
+        MmFreeBlock(IoUnixSocketPacketAllocator, Packet);
+
+    } else {
+        MmFreePagedPool(Packet);
+    }
+
     return;
 }
 
+KSTATUS
+IopUnixSocketWriteRing (
+    PUNIX_SOCKET Socket,
+    PIO_BUFFER IoBuffer,
+    UINTN Offset,
+    UINTN Size
+    )
+
+/*++
+
+Routine Description:
+
+    This routine copies stream data into the given socket's receive ring,
+    allocating or growing the ring as needed. This routine assumes the
+    receiving socket's lock is already held.
+
+Arguments:
+
+    Socket - Supplies a pointer to the receiving socket.
+
+    IoBuffer - Supplies a pointer to the I/O buffer containing the data.
+
+    Offset - Supplies the offset from the start of the I/O buffer to copy from.
+
+    Size - Supplies the number of bytes to copy.
+
+Return Value:
+
+    STATUS_SUCCESS if the data was copied into the ring.
+
+    STATUS_BUFFER_TOO_SMALL if the data cannot go in the ring, either because
+    packets are already queued ahead of it, the ring is too full, or the ring
+    could not be allocated. The caller should send a packet instead.
+
+    Other error codes if the data could not be copied.
+
+--*/
+
+{
+
+    UINTN FirstSize;
+    PUCHAR NewRing;
+    UINTN NewSize;
+    KSTATUS Status;
+
+    if ((LIST_EMPTY(&(Socket->ReceiveList)) == FALSE) ||
+        (Size > UNIX_SOCKET_STREAM_RING_MAX_SIZE - Socket->RingCount)) {
+
+        return STATUS_BUFFER_TOO_SMALL;
+    }
+
+    //
+    // Grow the ring if the data does not fit, moving any unread data to the
+    // start of the new ring.
+    //
+
+    if (Socket->RingCount + Size > Socket->RingSize) {
+        NewSize = Socket->RingSize;
+        if (NewSize == 0) {
+            NewSize = UNIX_SOCKET_STREAM_RING_INITIAL_SIZE;
+        }
+
+        while (NewSize < Socket->RingCount + Size) {
+            NewSize <<= 1;
+        }
+
+        ASSERT(NewSize <= UNIX_SOCKET_STREAM_RING_MAX_SIZE);
+
+        NewRing = MmAllocatePagedPool(NewSize, UNIX_SOCKET_ALLOCATION_TAG);
+        if (NewRing == NULL) {
+            return STATUS_BUFFER_TOO_SMALL;
+        }
+
+        if (Socket->Ring != NULL) {
+            FirstSize = Socket->RingSize - Socket->RingStart;
+            if (FirstSize > Socket->RingCount) {
+                FirstSize = Socket->RingCount;
+            }
+
+            RtlCopyMemory(NewRing,
+                          Socket->Ring + Socket->RingStart,
+                          FirstSize);
+
+            RtlCopyMemory(NewRing + FirstSize,
+                          Socket->Ring,
+                          Socket->RingCount - FirstSize);
+
+            MmFreePagedPool(Socket->Ring);
+        }
+
+        Socket->Ring = NewRing;
+        Socket->RingSize = NewSize;
+        Socket->RingStart = 0;
+    }
+
+    Status = IopUnixSocketCopyRingData(Socket,
+                                       Socket->RingStart + Socket->RingCount,
+                                       IoBuffer,
+                                       Offset,
+                                       Size,
+                                       FALSE);
+
+    if (!KSUCCESS(Status)) {
+        return Status;
+    }
+
+    //
+    // Signal the receiver if the socket just went from empty to having data.
+    //
+
+    if (Socket->RingCount == 0) {
+        IoSetIoObjectState(Socket->KernelSocket.IoState, POLL_EVENT_IN, TRUE);
+    }
+
+    Socket->RingCount += Size;
+    return STATUS_SUCCESS;
+}
+
+KSTATUS
+IopUnixSocketCopyRingData (
+    PUNIX_SOCKET Socket,
+    UINTN RingOffset,
+    PIO_BUFFER IoBuffer,
+    UINTN IoBufferOffset,
+    UINTN Size,
+    BOOL ToIoBuffer
+    )
+
+/*++
+
+Routine Description:
+
+    This routine copies data between a socket's receive ring and an I/O
+    buffer, handling wrapping around the end of the ring. This routine assumes
+    the socket lock is already held.
+
+Arguments:
+
+    Socket - Supplies a pointer to the socket whose ring is being accessed.
+
+    RingOffset - Supplies the offset into the ring to copy to or from. This
+        may be beyond the ring size, in which case it is wrapped.
+
+    IoBuffer - Supplies a pointer to the I/O buffer to copy to or from.
+
+    IoBufferOffset - Supplies the offset into the I/O buffer to copy to or
+        from.
+
+    Size - Supplies the number of bytes to copy.
+
+    ToIoBuffer - Supplies a boolean indicating whether data is copied out of
+        the ring into the I/O buffer (TRUE) or from the I/O buffer into the
+        ring (FALSE).
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    UINTN FirstSize;
+    KSTATUS Status;
+
+    ASSERT(Size <= Socket->RingSize);
+
+    RingOffset &= Socket->RingSize - 1;
+    FirstSize = Socket->RingSize - RingOffset;
+    if (FirstSize > Size) {
+        FirstSize = Size;
+    }
+
+    Status = MmCopyIoBufferData(IoBuffer,
+                                Socket->Ring + RingOffset,
+                                IoBufferOffset,
+                                FirstSize,
+                                ToIoBuffer);
+
+    if (!KSUCCESS(Status)) {
+        return Status;
+    }
+
+    if (FirstSize != Size) {
+        Status = MmCopyIoBufferData(IoBuffer,
+                                    Socket->Ring,
+                                    IoBufferOffset + FirstSize,
+                                    Size - FirstSize,
+                                    ToIoBuffer);
+    }
+
+    return Status;
+}
+
+KSTATUS
+IopUnixSocketReturnSenderAddress (
+    BOOL FromKernelMode,
+    PUNIX_SOCKET Sender,
+    PSOCKET_IO_PARAMETERS Parameters
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the address of the socket that sent received data,
+    if the caller asked for it.
+
+Arguments:
+
+    FromKernelMode - Supplies a boolean indicating whether or not the request
+        came from kernel mode.
+
+    Sender - Supplies a pointer to the socket that sent the data.
+
+    Parameters - Supplies a pointer to the socket I/O parameters.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    NETWORK_ADDRESS RemoteAddressLocal;
+    UINTN SenderCopySize;
+    KSTATUS Status;
+
+    Status = STATUS_SUCCESS;
+
+    //
+    // Return the remote path if requested.
+    //
+
+    if ((Parameters->RemotePath != NULL) &&
+        (Parameters->RemotePathSize != 0)) {
+
+        SenderCopySize = Sender->NameSize;
+        if (SenderCopySize > Parameters->RemotePathSize) {
+            SenderCopySize = Parameters->RemotePathSize;
+        }
+
+        Parameters->RemotePathSize = Sender->NameSize;
+        if (SenderCopySize != 0) {
+            if (FromKernelMode != FALSE) {
+                RtlCopyMemory(Parameters->RemotePath,
+                              Sender->Name,
+                              SenderCopySize);
+
+            } else {
+                Status = MmCopyToUserMode(Parameters->RemotePath,
+                                          Sender->Name,
+                                          SenderCopySize);
+
+                if (!KSUCCESS(Status)) {
+                    return Status;
+                }
+            }
+        }
+    }
+
+    //
+    // Copy the network address portion of the sender address as well.
+    //
+
+    if (Parameters->NetworkAddress != NULL) {
+        if (FromKernelMode != FALSE) {
+            Parameters->NetworkAddress->Domain = NetDomainLocal;
+
+        } else {
+            RtlZeroMemory(&RemoteAddressLocal, sizeof(NETWORK_ADDRESS));
+            RemoteAddressLocal.Domain = NetDomainLocal;
+            Status = MmCopyToUserMode(Parameters->NetworkAddress,
+                                      &RemoteAddressLocal,
+                                      sizeof(NETWORK_ADDRESS));
+        }
+    }
+
+    return Status;
+}
+
 KSTATUS
 IopUnixSocketSendControlData (
     BOOL FromKernelMode,
@@ -68,6 +68,28 @@ typedef struct _SOCKET_CREATION_PARAMETERS {
 // -------------------------------------------------------- Function Prototypes
 //
 
+KSTATUS
+IopInitializeUnixSocketSupport (
+    VOID
+    );
+
+/*++
+
+Routine Description:
+
+    This routine is called during system initialization to set up support for
+    Unix domain sockets.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Status code.
+
+--*/
+
 KSTATUS
 IopCreateUnixSocketPair (
     NET_SOCKET_TYPE Type,
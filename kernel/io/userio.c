@@ -2195,6 +2195,41 @@ Return Value:
 
         break;
 
+    case FileControlCommandGetPipeSize:
+        Status = IopGetSetPipeSize(IoHandle,
+                                   FALSE,
+                                   &(LocalParameters.PipeSize));
+
+        if (KSUCCESS(Status)) {
+            CopyOutSize = sizeof(ULONG);
+        }
+
+        break;
+
+    case FileControlCommandSetPipeSize:
+        if (FileControl->Parameters == NULL) {
+            Status = STATUS_INVALID_PARAMETER;
+            goto SysFileControlEnd;
+        }
+
+        Status = MmCopyFromUserMode(&LocalParameters,
+                                    FileControl->Parameters,
+                                    sizeof(ULONG));
+
+        if (!KSUCCESS(Status)) {
+            goto SysFileControlEnd;
+        }
+
+        Status = IopGetSetPipeSize(IoHandle,
+                                   TRUE,
+                                   &(LocalParameters.PipeSize));
+
+        if (KSUCCESS(Status)) {
+            CopyOutSize = sizeof(ULONG);
+        }
+
+        break;
+
     default:
         Status = STATUS_INVALID_PARAMETER;
         break;
@@ -512,6 +512,7 @@ Return Value:
 {
 
     CALENDAR_TIME CalendarTime;
+    ULONG ProcessorCount;
     KSTATUS Status;
     SYSTEM_TIME SystemTime;
     PUSER_SHARED_DATA UserSharedData;
@@ -524,6 +525,13 @@ Return Value:
     UserSharedData->ProcessorCounterFrequency =
                                             HlQueryProcessorCounterFrequency();
 
+    ProcessorCount = HlGetMaximumProcessorCount();
+    if (ProcessorCount > USER_SHARED_DATA_MAX_PROCESSORS) {
+        ProcessorCount = USER_SHARED_DATA_MAX_PROCESSORS;
+    }
+
+    UserSharedData->ProcessorCount = ProcessorCount;
+
     //
     // If no calendar services are around, set this to the boot time and go
     // from there.
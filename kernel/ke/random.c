@@ -37,6 +37,13 @@ Module Name:
 // ---------------------------------------------------------------- Definitions
 //
 
+//
+// Define the size of the stack buffer used to stage random data on its way to
+// user mode.
+//
+
+#define RANDOM_SYSTEM_CALL_CHUNK_SIZE 256
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -113,6 +120,93 @@ Return Value:
     return STATUS_SUCCESS;
 }
 
+INTN
+KeSysGetRandomBytes (
+    PVOID SystemCallParameter
+    )
+
+/*++
+
+Routine Description:
+
+    This routine implements the system call for getting random bytes directly
+    from the system's random source, without going through a device handle.
+
+Arguments:
+
+    SystemCallParameter - Supplies a pointer to the parameters supplied with
+        the system call. This structure will be a stack-local copy of the
+        actual parameters passed from user-mode.
+
+Return Value:
+
+    STATUS_SUCCESS or positive integer on success.
+
+    Error status code on failure.
+
+--*/
+
+{
+
+    UCHAR Buffer[RANDOM_SYSTEM_CALL_CHUNK_SIZE];
+    UINTN BytesCompleted;
+    PINTERFACE_PSEUDO_RANDOM_SOURCE Interface;
+    PSYSTEM_CALL_GET_RANDOM_BYTES Parameters;
+    UINTN Size;
+    KSTATUS Status;
+    PUCHAR UserBuffer;
+
+    Parameters = SystemCallParameter;
+    BytesCompleted = 0;
+    if ((Parameters->Flags & ~SYS_RANDOM_FLAG_MASK) != 0) {
+        Status = STATUS_INVALID_PARAMETER;
+        goto SysGetRandomBytesEnd;
+    }
+
+    //
+    // There is no notion of blocking until the pools are full, but if the
+    // random source has not shown up yet, tell non-blocking callers to come
+    // back later.
+    //
+
+    Interface = KePseudoRandomInterface;
+    if (Interface == NULL) {
+        Status = STATUS_NO_SUCH_DEVICE;
+        if ((Parameters->Flags & SYS_RANDOM_FLAG_NON_BLOCKING) != 0) {
+            Status = STATUS_OPERATION_WOULD_BLOCK;
+        }
+
+        goto SysGetRandomBytesEnd;
+    }
+
+    if (Parameters->Size > SYS_RANDOM_MAX_SIZE) {
+        Parameters->Size = SYS_RANDOM_MAX_SIZE;
+    }
+
+    UserBuffer = Parameters->Buffer;
+    Status = STATUS_SUCCESS;
+    while (BytesCompleted < Parameters->Size) {
+        Size = Parameters->Size - BytesCompleted;
+        if (Size > RANDOM_SYSTEM_CALL_CHUNK_SIZE) {
+            Size = RANDOM_SYSTEM_CALL_CHUNK_SIZE;
+        }
+
+        Interface->GetBytes(Interface, Buffer, Size);
+        Status = MmCopyToUserMode(UserBuffer + BytesCompleted, Buffer, Size);
+        if (!KSUCCESS(Status)) {
+            break;
+        }
+
+        BytesCompleted += Size;
+    }
+
+    RtlZeroMemory(Buffer, sizeof(Buffer));
+
+SysGetRandomBytesEnd:
+    Parameters->BytesCompleted = BytesCompleted;
+    return Status;
+}
+
 KSTATUS
 KepInitializeEntropy (
     VOID
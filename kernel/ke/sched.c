@@ -182,6 +182,8 @@ Return Value:
     PKTHREAD OldThread;
     PPROCESSOR_BLOCK Processor;
     PVOID *SaveLocation;
+    PUSER_SHARED_PROCESSOR SharedProcessor;
+    PUSER_SHARED_DATA UserSharedData;
 
     Enabled = FALSE;
     FirstTime = FALSE;
@@ -315,6 +317,24 @@ Return Value:
     Processor->RunningThread = NextThread;
     Processor->PreviousThread = OldThread;
 
+    //
+    // Publish the IDs of the new thread for user mode locks deciding whether
+    // or not to spin. The shared page may not exist yet very early in boot.
+    //
+
+    UserSharedData = MmGetUserSharedData();
+    if ((UserSharedData != NULL) &&
+        (Processor->ProcessorNumber < USER_SHARED_DATA_MAX_PROCESSORS)) {
+
+        SharedProcessor = &(UserSharedData->RunningThread[0]) +
+                          Processor->ProcessorNumber;
+
+        SharedProcessor->ProcessId =
+                               NextThread->OwningProcess->Identifiers.ProcessId;
+
+        SharedProcessor->ThreadId = NextThread->ThreadId;
+    }
+
     //
     // Deal with reasons other than being preempted for scheduling the old
     // thread out.
@@ -221,6 +221,12 @@ SYSTEM_CALL_TABLE_ENTRY KeSystemCallTable[SystemCallCount] = {
     {MmSysSetBreak,
         sizeof(SYSTEM_CALL_SET_BREAK),
         sizeof(SYSTEM_CALL_SET_BREAK)},
+    {IoSysSocketPerformMultipleIo,
+        sizeof(SYSTEM_CALL_SOCKET_PERFORM_MULTIPLE_IO),
+        sizeof(SYSTEM_CALL_SOCKET_PERFORM_MULTIPLE_IO)},
+    {KeSysGetRandomBytes,
+        sizeof(SYSTEM_CALL_GET_RANDOM_BYTES),
+        sizeof(SYSTEM_CALL_GET_RANDOM_BYTES)},
 };
 
 //
@@ -800,6 +800,138 @@ Return Value:
     return;
 }
 
+VOID
+MmGetResidentPageCounts (
+    PADDRESS_SPACE AddressSpace,
+    PUINTN SharedPages,
+    PUINTN PrivatePages
+    )
+
+/*++
+
+Routine Description:
+
+    This routine counts the pages currently mapped into the given address
+    space, split by whether or not the physical page can also be mapped by
+    other processes. This routine must be called at low level.
+
+Arguments:
+
+    AddressSpace - Supplies a pointer to the address space to examine.
+
+    SharedPages - Supplies a pointer where the number of mapped pages that may
+        be shared with other processes (page cache pages and pages inherited
+        from a parent) will be returned.
+
+    PrivatePages - Supplies a pointer where the number of mapped pages owned
+        solely by this address space will be returned.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UINTN BitmapIndex;
+    ULONG BitmapMask;
+    PLIST_ENTRY CurrentEntry;
+    UINTN EndOffset;
+    PIMAGE_SECTION OwningSection;
+    UINTN PageOffset;
+    ULONG PageShift;
+    UINTN Private;
+    PIMAGE_SECTION Section;
+    UINTN Shared;
+
+    ASSERT(KeGetRunLevel() == RunLevelLow);
+
+    //
+    // The kernel's sections span the paged pool, so don't walk them. Report
+    // everything as private, which is accurate enough for the kernel process.
+    //
+
+    if (AddressSpace == MmKernelAddressSpace) {
+        *SharedPages = 0;
+        *PrivatePages = AddressSpace->ResidentSet;
+        return;
+    }
+
+    PageShift = MmPageShift();
+    Private = 0;
+    Shared = 0;
+    MmAcquireAddressSpaceLock(AddressSpace);
+    CurrentEntry = AddressSpace->SectionListHead.Next;
+    while (CurrentEntry != &(AddressSpace->SectionListHead)) {
+        Section = LIST_VALUE(CurrentEntry, IMAGE_SECTION, AddressListEntry);
+        CurrentEntry = CurrentEntry->Next;
+        KeAcquireQueuedLock(Section->Lock);
+        if (((Section->Flags & IMAGE_SECTION_DESTROYED) != 0) ||
+            (Section->MinTouched >= Section->MaxTouched)) {
+
+            KeReleaseQueuedLock(Section->Lock);
+            continue;
+        }
+
+        //
+        // Only the touched region of the section can have pages mapped.
+        //
+
+        PageOffset = (Section->MinTouched - Section->VirtualAddress) >>
+                     PageShift;
+
+        EndOffset = (Section->MaxTouched - Section->VirtualAddress) >>
+                    PageShift;
+
+        while (PageOffset < EndOffset) {
+            if (MmpIsImageSectionMapped(Section, PageOffset, NULL) == FALSE) {
+                PageOffset += 1;
+                continue;
+            }
+
+            //
+            // Shared sections only ever map page cache pages.
+            //
+
+            if ((Section->Flags & IMAGE_SECTION_SHARED) != 0) {
+                Shared += 1;
+                PageOffset += 1;
+                continue;
+            }
+
+            //
+            // A page still inherited from a parent is shared with it. A page
+            // owned by this section is private unless the section is backed
+            // and the page is clean, in which case it is the page cache page.
+            //
+
+            BitmapIndex = IMAGE_SECTION_BITMAP_INDEX(PageOffset);
+            BitmapMask = IMAGE_SECTION_BITMAP_MASK(PageOffset);
+            OwningSection = MmpGetOwningSection(Section, PageOffset);
+            if ((OwningSection != Section) ||
+                (((Section->Flags & IMAGE_SECTION_BACKED) != 0) &&
+                 ((Section->DirtyPageBitmap[BitmapIndex] & BitmapMask) == 0))) {
+
+                Shared += 1;
+
+            } else {
+                Private += 1;
+            }
+
+            MmpImageSectionReleaseReference(OwningSection);
+            PageOffset += 1;
+        }
+
+        KeReleaseQueuedLock(Section->Lock);
+    }
+
+    MmReleaseAddressSpaceLock(AddressSpace);
+    *SharedPages = Shared;
+    *PrivatePages = Private;
+    return;
+}
+
 KSTATUS
 MmUserModeDebuggerWrite (
     PVOID KernelBuffer,
@@ -47,10 +47,11 @@ Module Name:
 #define INITIAL_NON_PAGED_POOL_SIZE (512 * 1024)
 
 //
-// Define the number of default-sized kernel stacks to keep around.
+// Define the number of default-sized kernel stacks to keep around in the
+// global cache, in addition to those cached on each processor.
 //
 
-#define KERNEL_STACK_CACHE_SIZE 10
+#define KERNEL_STACK_CACHE_SIZE 32
 
 //
 // Do not collect pool tag statistics on non-debug builds.
@@ -136,8 +137,8 @@ PQUEUED_LOCK MmPagedPoolLock = NULL;
 
 //
 // Keep a little cache of kernel stacks to avoid the constant mapping and
-// unmapping associated with thread creation.
-// TODO: Maintain the kernel stack cache so it doesn't just keep growing.
+// unmapping associated with thread creation. Each processor block has a
+// smaller lockless cache in front of this one.
 //
 
 KSPIN_LOCK MmFreeKernelStackLock;
@@ -701,6 +702,7 @@ Return Value:
     PLIST_ENTRY Entry;
     RUNLEVEL OldRunLevel;
     ULONG PageSize;
+    PPROCESSOR_BLOCK Processor;
     BOOL RangeAllocated;
     PVOID Stack;
     KSTATUS Status;
@@ -717,13 +719,20 @@ Return Value:
 
     //
     // If the stack size requested is the default (it always is), then look in
-    // the cache for a previously allocated kernel stack.
+    // the caches for a previously allocated kernel stack, starting with this
+    // processor's own.
     //
 
     if (Size == DEFAULT_KERNEL_STACK_SIZE) {
         Alignment = DEFAULT_KERNEL_STACK_SIZE_ALIGNMENT;
-        if (MmFreeKernelStackCount != 0) {
-            OldRunLevel = KeRaiseRunLevel(RunLevelDispatch);
+        OldRunLevel = KeRaiseRunLevel(RunLevelDispatch);
+        Processor = KeGetCurrentProcessorBlock();
+        if (Processor->KernelStackCacheCount != 0) {
+            Processor->KernelStackCacheCount -= 1;
+            VaRequest.Address =
+               Processor->KernelStackCache[Processor->KernelStackCacheCount];
+
+        } else if (MmFreeKernelStackCount != 0) {
             KeAcquireSpinLock(&MmFreeKernelStackLock);
             if (!LIST_EMPTY(&MmFreeKernelStackList)) {
 
@@ -736,9 +745,10 @@ Return Value:
             }
 
             KeReleaseSpinLock(&MmFreeKernelStackLock);
-            KeLowerRunLevel(OldRunLevel);
         }
 
+        KeLowerRunLevel(OldRunLevel);
+
     //
     // The alignment is the size (rounded up to the next power of 2) to ensure
     // that kernel stacks don't span page directory entries, which would cause
@@ -842,28 +852,43 @@ Return Value:
     PLIST_ENTRY Entry;
     RUNLEVEL OldRunLevel;
     ULONG PageSize;
+    PPROCESSOR_BLOCK Processor;
     ULONG UnmapFlags;
 
     ASSERT(KeGetRunLevel() == RunLevelLow);
 
     //
-    // If there's room, put the stack back onto the cached list of stacks for
-    // the next thread to use. This first check of the count is unprotected
-    // by the lock and could be wrong, but it's really just a best effort and
-    // avoids doing the heavy lock acquire all the time.
+    // If there's room, put the stack back onto this processor's cache, or
+    // failing that the global cached list of stacks, for the next thread to
+    // use. The unlocked check of the global count could be wrong, but it's
+    // really just a best effort and avoids doing the heavy lock acquire all
+    // the time.
     //
 
     Entry = NULL;
-    if (MmFreeKernelStackCount < KERNEL_STACK_CACHE_SIZE) {
+    if (Size == DEFAULT_KERNEL_STACK_SIZE) {
         OldRunLevel = KeRaiseRunLevel(RunLevelDispatch);
-        KeAcquireSpinLock(&MmFreeKernelStackLock);
-        if (MmFreeKernelStackCount < KERNEL_STACK_CACHE_SIZE) {
-            MmFreeKernelStackCount += 1;
+        Processor = KeGetCurrentProcessorBlock();
+        if (Processor->KernelStackCacheCount <
+            PROCESSOR_KERNEL_STACK_CACHE_SIZE) {
+
+            Processor->KernelStackCache[Processor->KernelStackCacheCount] =
+                                                                     StackBase;
+
+            Processor->KernelStackCacheCount += 1;
             Entry = StackBase;
-            INSERT_AFTER(Entry, &MmFreeKernelStackList);
+
+        } else if (MmFreeKernelStackCount < KERNEL_STACK_CACHE_SIZE) {
+            KeAcquireSpinLock(&MmFreeKernelStackLock);
+            if (MmFreeKernelStackCount < KERNEL_STACK_CACHE_SIZE) {
+                MmFreeKernelStackCount += 1;
+                Entry = StackBase;
+                INSERT_AFTER(Entry, &MmFreeKernelStackList);
+            }
+
+            KeReleaseSpinLock(&MmFreeKernelStackLock);
         }
 
-        KeReleaseSpinLock(&MmFreeKernelStackLock);
         KeLowerRunLevel(OldRunLevel);
         if (Entry != NULL) {
             return;
@@ -58,6 +58,13 @@ Module Name:
 
 #define MAX_PROCESS_NAME_LENGTH 11
 
+//
+// Define the maximum amount of recent user stack a vfork caller can ask to
+// have preserved while the child runs on it.
+//
+
+#define VFORK_MAX_FRAME_RESTORE_SIZE 0x4000
+
 //
 // ----------------------------------------------- Internal Function Prototypes
 //
@@ -399,14 +406,54 @@ Return Value:
 {
 
     PKTHREAD CurrentThread;
+    PVOID FrameBuffer;
     PKPROCESS NewProcess;
     INTN NewProcessId;
     PSYSTEM_CALL_FORK Parameters;
+    UINTN RestoreSize;
+    PVOID StackPointer;
     KSTATUS Status;
 
     CurrentThread = KeGetCurrentThread();
+    FrameBuffer = NULL;
     NewProcess = NULL;
+    NewProcessId = 0;
     Parameters = (PSYSTEM_CALL_FORK)SystemCallParameter;
+    RestoreSize = 0;
+    StackPointer = NULL;
+
+    //
+    // A vfork child runs on the parent's stack until it executes an image or
+    // exits. Save the region of recent stack the caller asked to have
+    // preserved so that it can be put back before the parent returns.
+    //
+
+    if ((Parameters->Flags & FORK_FLAG_VFORK) != 0) {
+        StackPointer = PspArchGetUserStackPointer(CurrentThread->TrapFrame);
+        if (Parameters->FrameRestoreBase > StackPointer) {
+            RestoreSize = (UINTN)(Parameters->FrameRestoreBase) -
+                          (UINTN)StackPointer;
+
+            if ((Parameters->FrameRestoreBase > USER_VA_END) ||
+                (RestoreSize > VFORK_MAX_FRAME_RESTORE_SIZE)) {
+
+                Status = STATUS_INVALID_PARAMETER;
+                goto SysForkProcessEnd;
+            }
+
+            FrameBuffer = MmAllocatePagedPool(RestoreSize, PS_ALLOCATION_TAG);
+            if (FrameBuffer == NULL) {
+                Status = STATUS_INSUFFICIENT_RESOURCES;
+                goto SysForkProcessEnd;
+            }
+
+            Status = MmCopyFromUserMode(FrameBuffer, StackPointer, RestoreSize);
+            if (!KSUCCESS(Status)) {
+                goto SysForkProcessEnd;
+            }
+        }
+    }
+
     Status = PspCopyProcess(CurrentThread->OwningProcess,
                             CurrentThread,
                             CurrentThread->TrapFrame,
@@ -415,11 +462,23 @@ Return Value:
 
     if (!KSUCCESS(Status)) {
         RtlDebugPrint("Failed to fork %d\n", Status);
-        return Status;
+        goto SysForkProcessEnd;
     }
 
     NewProcessId = NewProcess->Identifiers.ProcessId;
-    ObReleaseReference(NewProcess);
+
+    //
+    // Wait for a vfork child to give the address space back, and then repair
+    // the stack it was using.
+    //
+
+    if ((Parameters->Flags & FORK_FLAG_VFORK) != 0) {
+        KeWaitForEvent(NewProcess->VforkEvent, FALSE, WAIT_TIME_INDEFINITE);
+        if (RestoreSize != 0) {
+            MmCopyToUserMode(StackPointer, FrameBuffer, RestoreSize);
+        }
+
+        ObReleaseReference(NewProcess);
 
     //
     // Yield to the child. This alleviates extra work during image section
@@ -428,7 +487,20 @@ Return Value:
     // going to wait on its new child.
     //
 
-    KeYield();
+    } else {
+        ObReleaseReference(NewProcess);
+        KeYield();
+    }
+
+SysForkProcessEnd:
+    if (FrameBuffer != NULL) {
+        MmFreePagedPool(FrameBuffer);
+    }
+
+    if (!KSUCCESS(Status)) {
+        return Status;
+    }
+
     return NewProcessId;
 }
 
@@ -607,6 +679,13 @@ Return Value:
 
     PspDestroyProcessTimers(Process);
 
+    //
+    // A vfork child gives the parent's address space back now. Everything
+    // needed from user mode has already been copied into the kernel.
+    //
+
+    PspReleaseVforkParent(Process);
+
     //
     // Unload all images and free all memory associated with this image.
     // Blocked and ignored signals are inherited across the exec. Handled
@@ -615,6 +694,7 @@ Return Value:
 
     Process->SignalHandlerRoutine = NULL;
     INITIALIZE_SIGNAL_SET(Process->HandledSignals);
+    Thread->Flags &= ~THREAD_FLAG_SUPPLIED_STACK;
     PspSetThreadUserStackSize(Thread, 0);
     PspImUnloadAllImages(Process);
     MmCleanUpProcessMemory(Process->AddressSpace, FALSE);
@@ -1894,6 +1974,17 @@ Return Value:
     KeAcquireQueuedLock(Process->QueuedLock);
     NewProcess->SignalHandlerRoutine = Process->SignalHandlerRoutine;
     NewProcess->HandledSignals = Process->HandledSignals;
+
+    //
+    // A vfork child must never run the parent's signal handlers in the
+    // parent's memory, so it treats all signals with the default action. An
+    // exec would have reset these anyway.
+    //
+
+    if ((Flags & FORK_FLAG_VFORK) != 0) {
+        INITIALIZE_SIGNAL_SET(NewProcess->HandledSignals);
+    }
+
     NewProcess->IgnoredSignals = Process->IgnoredSignals;
     NewProcess->Umask = Process->Umask;
     INSERT_BEFORE(&(NewProcess->SiblingListEntry), &(Process->ChildListHead));
@@ -1960,23 +2051,41 @@ Return Value:
     }
 
     //
-    // Copy the process address space.
+    // A vfork child borrows the parent's address space, stashing its own
+    // until it executes an image or exits. The parent waits on the event.
     //
 
-    Status = MmCloneAddressSpace(Process->AddressSpace,
-                                 NewProcess->AddressSpace);
+    if ((Flags & FORK_FLAG_VFORK) != 0) {
+        NewProcess->VforkEvent = KeCreateEvent(NULL);
+        if (NewProcess->VforkEvent == NULL) {
+            Status = STATUS_INSUFFICIENT_RESOURCES;
+            goto CopyProcessEnd;
+        }
 
-    if (!KSUCCESS(Status)) {
-        goto CopyProcessEnd;
-    }
+        NewProcess->VforkAddressSpace = NewProcess->AddressSpace;
+        NewProcess->AddressSpace = Process->AddressSpace;
 
-    //
-    // Copy the image list.
-    //
+    } else {
 
-    Status = PspImCloneProcessImages(Process, NewProcess);
-    if (!KSUCCESS(Status)) {
-        goto CopyProcessEnd;
+        //
+        // Copy the process address space.
+        //
+
+        Status = MmCloneAddressSpace(Process->AddressSpace,
+                                     NewProcess->AddressSpace);
+
+        if (!KSUCCESS(Status)) {
+            goto CopyProcessEnd;
+        }
+
+        //
+        // Copy the image list.
+        //
+
+        Status = PspImCloneProcessImages(Process, NewProcess);
+        if (!KSUCCESS(Status)) {
+            goto CopyProcessEnd;
+        }
     }
 
     //
@@ -2006,9 +2115,15 @@ Return Value:
 
             //
             // If the routine failed, then a thread was never launched. As such,
-            // nothing will clean up the new process. "Terminate" it now.
+            // nothing will clean up the new process. "Terminate" it now, being
+            // careful not to tear down a borrowed address space.
             //
 
+            if (NewProcess->VforkAddressSpace != NULL) {
+                NewProcess->AddressSpace = NewProcess->VforkAddressSpace;
+                NewProcess->VforkAddressSpace = NULL;
+            }
+
             PspRemoveProcessFromLists(NewProcess);
             PspProcessTermination(NewProcess);
             ObReleaseReference(NewProcess);
@@ -2027,6 +2142,64 @@ Return Value:
     return Status;
 }
 
+VOID
+PspReleaseVforkParent (
+    PKPROCESS Process
+    )
+
+/*++
+
+Routine Description:
+
+    This routine stops a vfork child from borrowing its parent's address
+    space, switching it over to its own address space and waking the parent.
+    This routine must be called from the child process. It does nothing if the
+    process is not borrowing an address space.
+
+Arguments:
+
+    Process - Supplies a pointer to the current process.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    RUNLEVEL OldRunLevel;
+    PKTHREAD Thread;
+
+    if (Process->VforkAddressSpace == NULL) {
+        return;
+    }
+
+    ASSERT(Process == PsGetCurrentProcess());
+
+    //
+    // The user stack belongs to the parent's thread. Forget about it rather
+    // than freeing it out from under the parent.
+    //
+
+    Thread = KeGetCurrentThread();
+    Thread->UserStack = NULL;
+    Thread->UserStackSize = 0;
+
+    //
+    // Switch over to the process' own address space. Do this at dispatch so
+    // that the processor can't change underneath the switch.
+    //
+
+    OldRunLevel = KeRaiseRunLevel(RunLevelDispatch);
+    Process->AddressSpace = Process->VforkAddressSpace;
+    Process->VforkAddressSpace = NULL;
+    MmSwitchAddressSpace(KeGetCurrentProcessorBlock(), Process->AddressSpace);
+    KeLowerRunLevel(OldRunLevel);
+    KeSignalEvent(Process->VforkEvent, SignalOptionSignalAll);
+    return;
+}
+
 PKPROCESS
 PspCreateProcess (
     PCSTR CommandLine,
@@ -3372,6 +3545,7 @@ Return Value:
     ASSERT(Process->Paths.SharedMemoryDirectory.MountPoint == NULL);
     ASSERT(Process->Environment == NULL);
     ASSERT(Process->HandleTable == NULL);
+    ASSERT(Process->VforkAddressSpace == NULL);
 
     if (Process->AddressSpace != NULL) {
         MmDestroyAddressSpace(Process->AddressSpace);
@@ -3382,6 +3556,11 @@ Return Value:
         Process->StopEvent = NULL;
     }
 
+    if (Process->VforkEvent != NULL) {
+        KeDestroyEvent(Process->VforkEvent);
+        Process->VforkEvent = NULL;
+    }
+
     if (Process->QueuedLock != NULL) {
         KeDestroyQueuedLock(Process->QueuedLock);
     }
@@ -4959,6 +5138,19 @@ Return Value:
 
         Buffer->Frequency = HlQueryProcessorCounterFrequency();
 
+        //
+        // Counting resident pages walks the whole address space, so skip it
+        // if the caller is only going to come back with a bigger buffer.
+        //
+
+        Buffer->SharedResidentSet = 0;
+        Buffer->PrivateResidentSet = 0;
+        if (KSUCCESS(Status)) {
+            MmGetResidentPageCounts(Process->AddressSpace,
+                                    &(Buffer->SharedResidentSet),
+                                    &(Buffer->PrivateResidentSet));
+        }
+
         //
         // Get the size of the first image on the process's image list. This
         // should be the main image.
@@ -447,6 +447,30 @@ Return Value:
 
 --*/
 
+VOID
+PspReleaseVforkParent (
+    PKPROCESS Process
+    );
+
+/*++
+
+Routine Description:
+
+    This routine stops a vfork child from borrowing its parent's address
+    space, switching it over to its own address space and waking the parent.
+    This routine must be called from the child process. It does nothing if the
+    process is not borrowing an address space.
+
+Arguments:
+
+    Process - Supplies a pointer to the current process.
+
+Return Value:
+
+    None.
+
+--*/
+
 PKPROCESS
 PspCreateProcess (
     PCSTR CommandLine,
@@ -980,6 +1004,27 @@ Return Value:
 
 --*/
 
+PVOID
+PspArchGetUserStackPointer (
+    PTRAP_FRAME TrapFrame
+    );
+
+/*++
+
+Routine Description:
+
+    This routine returns the user mode stack pointer from the given trap frame.
+
+Arguments:
+
+    TrapFrame - Supplies a pointer to the user mode trap frame.
+
+Return Value:
+
+    Returns the user mode stack pointer.
+
+--*/
+
 KSTATUS
 PspArchGetDebugBreakInformation (
     PTRAP_FRAME TrapFrame
@@ -291,6 +291,7 @@ Return Value:
             Parameters->UserStack = NewThread->UserStack;
 
         } else {
+            NewThread->Flags |= THREAD_FLAG_SUPPLIED_STACK;
             NewThread->UserStack = Parameters->UserStack;
             NewThread->UserStackSize = Parameters->StackSize;
         }
@@ -1348,10 +1349,26 @@ Return Value:
     Thread->Flags |= THREAD_FLAG_EXITING;
 
     //
-    // Free the user mode stack before decrementing the thread count.
+    // A vfork child that exits without executing an image gives the parent's
+    // address space back before tearing anything down.
     //
 
-    PspSetThreadUserStackSize(Thread, 0);
+    PspReleaseVforkParent(Process);
+
+    //
+    // Free the user mode stack before decrementing the thread count. A stack
+    // supplied by user mode at creation belongs to user mode, which may be
+    // waiting for the thread ID to clear so it can hand the stack to a new
+    // thread.
+    //
+
+    if ((Thread->Flags & THREAD_FLAG_SUPPLIED_STACK) != 0) {
+        Thread->UserStack = NULL;
+        Thread->UserStackSize = 0;
+
+    } else {
+        PspSetThreadUserStackSize(Thread, 0);
+    }
 
     //
     // Decrement the thread count. If this is the last thread, unload all
@@ -420,6 +420,15 @@ Return Value:
 
     ASSERT((Length % AES_BLOCK_SIZE) == 0);
 
+    if ((CypGetHardwareSupport() & CRYPTO_HARDWARE_AES) != 0) {
+        CypAesHardwareCbcEncrypt(Context,
+                                 Plaintext,
+                                 Ciphertext,
+                                 Length / AES_BLOCK_SIZE);
+
+        return;
+    }
+
     RtlCopyMemory(InitializationVector,
                   Context->InitializationVector,
                   AES_INITIALIZATION_VECTOR_SIZE);
@@ -531,6 +540,15 @@ Return Value:
 
     ASSERT((Length % AES_BLOCK_SIZE) == 0);
 
+    if ((CypGetHardwareSupport() & CRYPTO_HARDWARE_AES) != 0) {
+        CypAesHardwareCbcDecrypt(Context,
+                                 Ciphertext,
+                                 Plaintext,
+                                 Length / AES_BLOCK_SIZE);
+
+        return;
+    }
+
     RtlCopyMemory(InitializationVector,
                   Context->InitializationVector,
                   AES_INITIALIZATION_VECTOR_SIZE);
@@ -639,6 +657,16 @@ Return Value:
 
     ASSERT((Length % AES_BLOCK_SIZE) == 0);
 
+    if ((CypGetHardwareSupport() & CRYPTO_HARDWARE_AES) != 0) {
+        CypAesHardwareEcb(Context,
+                          Plaintext,
+                          Ciphertext,
+                          Length / AES_BLOCK_SIZE,
+                          FALSE);
+
+        return;
+    }
+
     //
     // Loop over and encrypt each block.
     //
@@ -714,6 +742,16 @@ Return Value:
 
     ASSERT((Length % AES_BLOCK_SIZE) == 0);
 
+    if ((CypGetHardwareSupport() & CRYPTO_HARDWARE_AES) != 0) {
+        CypAesHardwareEcb(Context,
+                          Ciphertext,
+                          Plaintext,
+                          Length / AES_BLOCK_SIZE,
+                          TRUE);
+
+        return;
+    }
+
     //
     // Decrypt each block.
     //
@@ -792,6 +830,15 @@ Return Value:
 
     ASSERT((Length % AES_BLOCK_SIZE) == 0);
 
+    if ((CypGetHardwareSupport() & CRYPTO_HARDWARE_AES) != 0) {
+        CypAesHardwareCtr(Context,
+                          Plaintext,
+                          Ciphertext,
+                          Length / AES_BLOCK_SIZE);
+
+        return;
+    }
+
     RtlCopyMemory(Counter,
                   Context->InitializationVector,
                   AES_INITIALIZATION_VECTOR_SIZE);
@@ -26,38 +26,90 @@ Module Name:
 
 --*/
 
-from menv import kernelLibrary, staticLibrary;
+from menv import mconfig, kernelLibrary, staticLibrary;
 
 function build() {
+    var arch = mconfig.arch;
+    var buildArch = mconfig.build_arch;
     var buildLib;
+    var buildSources;
     var entries;
     var lib;
     var sources;
+    var sourcesConfig;
+    var targetSources;
+    var userLib;
+    var x64Sources;
+    var x86Sources;
 
     sources = [
         "aes.c",
+        "chacha.c",
         "fortuna.c",
         "hmac.c",
+        "hwcrypt.c",
         "md5.c",
         "sha1.c",
         "sha256.c",
         "sha512.c"
     ];
 
+    x86Sources = [
+        "x86/hwcrypt.S"
+    ];
+
+    x64Sources = [
+        "x64/hwcrypt.S"
+    ];
+
+    targetSources = sources;
+    if (arch == "x86") {
+        targetSources = sources + x86Sources;
+
+    } else if (arch == "x64") {
+        targetSources = sources + x64Sources;
+    }
+
+    buildSources = sources;
+    if (buildArch == "x86") {
+        buildSources = sources + x86Sources;
+
+    } else if (buildArch == "x64") {
+        buildSources = sources + x64Sources;
+    }
+
+    //
+    // The main library gets linked into the kernel, which does not save the
+    // vector registers the hardware paths use, so leave them off by default.
+    // The user mode flavor leaves them on.
+    //
+
+    sourcesConfig = {
+        "CPPFLAGS": ["-DCRYPTO_HARDWARE_DEFAULT=0"]
+    };
+
     lib = {
         "label": "crypto",
-        "inputs": sources,
+        "inputs": targetSources,
+        "sources_config": sourcesConfig
+    };
+
+    userLib = {
+        "label": "ucrypto",
+        "inputs": targetSources,
+        "prefix": "user"
     };
 
     buildLib = {
         "label": "build_crypto",
         "output": "crypto",
-        "inputs": sources,
+        "inputs": buildSources,
         "build": true,
         "prefix": "build"
     };
 
     entries = kernelLibrary(lib);
+    entries += kernelLibrary(userLib);
     entries += staticLibrary(buildLib);
     return entries;
 }
@@ -0,0 +1,354 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    chacha.c
+
+Abstract:
+
+    This module implements the ChaCha20 stream cipher, as described in
+    RFC 7539.
+
+Author:
+
+    agent 18-Oct-2026
+
+Environment:
+
+    Any
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include "cryptop.h"
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// Define the number of double rounds (a column round and a diagonal round)
+// that make up ChaCha20.
+//
+
+#define CHACHA20_DOUBLE_ROUNDS 10
+
+//
+// Define the indices of the interesting words within the state.
+//
+
+#define CHACHA20_KEY_INDEX 4
+#define CHACHA20_COUNTER_INDEX 12
+#define CHACHA20_NONCE_INDEX 13
+
+#define CHACHA20_ROTATE(_Value, _Count) \
+    (((_Value) << (_Count)) | ((_Value) >> (32 - (_Count))))
+
+#define CHACHA20_QUARTER_ROUND(_State, _A, _B, _C, _D)                  \
+    (_State)[_A] += (_State)[_B];                                       \
+    (_State)[_D] = CHACHA20_ROTATE((_State)[_D] ^ (_State)[_A], 16);    \
+    (_State)[_C] += (_State)[_D];                                       \
+    (_State)[_B] = CHACHA20_ROTATE((_State)[_B] ^ (_State)[_C], 12);    \
+    (_State)[_A] += (_State)[_B];                                       \
+    (_State)[_D] = CHACHA20_ROTATE((_State)[_D] ^ (_State)[_A], 8);     \
+    (_State)[_C] += (_State)[_D];                                       \
+    (_State)[_B] = CHACHA20_ROTATE((_State)[_B] ^ (_State)[_C], 7);
+
+//
+// These macros load and store little endian 32-bit values regardless of the
+// machine's byte order or alignment requirements.
+//
+
+#define CHACHA20_LOAD32(_Bytes)               \
+    ((ULONG)(_Bytes)[0] |                     \
+     ((ULONG)(_Bytes)[1] << 8) |              \
+     ((ULONG)(_Bytes)[2] << 16) |             \
+     ((ULONG)(_Bytes)[3] << 24))
+
+#define CHACHA20_STORE32(_Bytes, _Value)                \
+    (_Bytes)[0] = (UCHAR)(_Value);                      \
+    (_Bytes)[1] = (UCHAR)((_Value) >> 8);               \
+    (_Bytes)[2] = (UCHAR)((_Value) >> 16);              \
+    (_Bytes)[3] = (UCHAR)((_Value) >> 24);
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+VOID
+CypChaCha20Block (
+    PCHACHA20_CONTEXT Context,
+    UCHAR Block[CHACHA20_BLOCK_SIZE]
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// Store the constant words, which spell "expand 32-byte k".
+//
+
+const ULONG CyChaCha20Constants[4] = {
+    0x61707865,
+    0x3320646E,
+    0x79622D32,
+    0x6B206574
+};
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+CRYPTO_API
+VOID
+CyChaCha20Initialize (
+    PCHACHA20_CONTEXT Context,
+    PCUCHAR Key,
+    PCUCHAR Nonce,
+    ULONG Counter
+    )
+
+/*++
+
+Routine Description:
+
+    This routine initializes a ChaCha20 context with a key, nonce, and initial
+    block counter.
+
+Arguments:
+
+    Context - Supplies a pointer to the context to initialize.
+
+    Key - Supplies a pointer to the key, which must be CHACHA20_KEY_SIZE bytes.
+
+    Nonce - Supplies an optional pointer to the nonce, which must be
+        CHACHA20_NONCE_SIZE bytes. If NULL, a nonce of zero is used.
+
+    Counter - Supplies the initial block counter value.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Index;
+
+    for (Index = 0; Index < 4; Index += 1) {
+        Context->State[Index] = CyChaCha20Constants[Index];
+    }
+
+    for (Index = 0; Index < CHACHA20_KEY_SIZE / sizeof(ULONG); Index += 1) {
+        Context->State[CHACHA20_KEY_INDEX + Index] = CHACHA20_LOAD32(Key);
+        Key += sizeof(ULONG);
+    }
+
+    Context->State[CHACHA20_COUNTER_INDEX] = Counter;
+    for (Index = 0; Index < CHACHA20_NONCE_SIZE / sizeof(ULONG); Index += 1) {
+        Context->State[CHACHA20_NONCE_INDEX + Index] = 0;
+        if (Nonce != NULL) {
+            Context->State[CHACHA20_NONCE_INDEX + Index] =
+                                                        CHACHA20_LOAD32(Nonce);
+
+            Nonce += sizeof(ULONG);
+        }
+    }
+
+    Context->KeyStreamSize = 0;
+    return;
+}
+
+CRYPTO_API
+VOID
+CyChaCha20Crypt (
+    PCHACHA20_CONTEXT Context,
+    PCUCHAR Input,
+    PUCHAR Output,
+    UINTN Size
+    )
+
+/*++
+
+Routine Description:
+
+    This routine encrypts or decrypts data with ChaCha20, which is the same
+    operation in both directions. Successive calls continue the key stream
+    where the previous call left off.
+
+Arguments:
+
+    Context - Supplies a pointer to the initialized context.
+
+    Input - Supplies an optional pointer to the data to encrypt or decrypt.
+        This may be the same as the output buffer. If NULL, the raw key stream
+        is returned, which is useful for generating random data.
+
+    Output - Supplies a pointer where the output will be returned.
+
+    Size - Supplies the number of bytes to process.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UCHAR Block[CHACHA20_BLOCK_SIZE];
+    UINTN Index;
+    PUCHAR KeyStream;
+    UINTN StreamSize;
+
+    //
+    // Use up any key stream left over from a previous partial block.
+    //
+
+    while ((Size != 0) && (Context->KeyStreamSize != 0)) {
+        StreamSize = Context->KeyStreamSize;
+        if (StreamSize > Size) {
+            StreamSize = Size;
+        }
+
+        KeyStream = Context->KeyStream +
+                    (CHACHA20_BLOCK_SIZE - Context->KeyStreamSize);
+
+        for (Index = 0; Index < StreamSize; Index += 1) {
+            if (Input != NULL) {
+                Output[Index] = Input[Index] ^ KeyStream[Index];
+
+            } else {
+                Output[Index] = KeyStream[Index];
+            }
+        }
+
+        Context->KeyStreamSize -= StreamSize;
+        Output += StreamSize;
+        if (Input != NULL) {
+            Input += StreamSize;
+        }
+
+        Size -= StreamSize;
+    }
+
+    //
+    // Process whole blocks directly.
+    //
+
+    while (Size >= CHACHA20_BLOCK_SIZE) {
+        CypChaCha20Block(Context, Block);
+        for (Index = 0; Index < CHACHA20_BLOCK_SIZE; Index += 1) {
+            if (Input != NULL) {
+                Output[Index] = Input[Index] ^ Block[Index];
+
+            } else {
+                Output[Index] = Block[Index];
+            }
+        }
+
+        Output += CHACHA20_BLOCK_SIZE;
+        if (Input != NULL) {
+            Input += CHACHA20_BLOCK_SIZE;
+        }
+
+        Size -= CHACHA20_BLOCK_SIZE;
+    }
+
+    //
+    // Save the remainder of a final partial block for the next call.
+    //
+
+    if (Size != 0) {
+        CypChaCha20Block(Context, Context->KeyStream);
+        for (Index = 0; Index < Size; Index += 1) {
+            if (Input != NULL) {
+                Output[Index] = Input[Index] ^ Context->KeyStream[Index];
+
+            } else {
+                Output[Index] = Context->KeyStream[Index];
+            }
+        }
+
+        Context->KeyStreamSize = CHACHA20_BLOCK_SIZE - Size;
+    }
+
+    RtlZeroMemory(Block, sizeof(Block));
+    return;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+VOID
+CypChaCha20Block (
+    PCHACHA20_CONTEXT Context,
+    UCHAR Block[CHACHA20_BLOCK_SIZE]
+    )
+
+/*++
+
+Routine Description:
+
+    This routine generates the next block of ChaCha20 key stream and advances
+    the block counter.
+
+Arguments:
+
+    Context - Supplies a pointer to the context.
+
+    Block - Supplies a pointer where the key stream block will be returned.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Index;
+    ULONG Working[CHACHA20_STATE_SIZE];
+
+    for (Index = 0; Index < CHACHA20_STATE_SIZE; Index += 1) {
+        Working[Index] = Context->State[Index];
+    }
+
+    for (Index = 0; Index < CHACHA20_DOUBLE_ROUNDS; Index += 1) {
+        CHACHA20_QUARTER_ROUND(Working, 0, 4, 8, 12);
+        CHACHA20_QUARTER_ROUND(Working, 1, 5, 9, 13);
+        CHACHA20_QUARTER_ROUND(Working, 2, 6, 10, 14);
+        CHACHA20_QUARTER_ROUND(Working, 3, 7, 11, 15);
+        CHACHA20_QUARTER_ROUND(Working, 0, 5, 10, 15);
+        CHACHA20_QUARTER_ROUND(Working, 1, 6, 11, 12);
+        CHACHA20_QUARTER_ROUND(Working, 2, 7, 8, 13);
+        CHACHA20_QUARTER_ROUND(Working, 3, 4, 9, 14);
+    }
+
+    for (Index = 0; Index < CHACHA20_STATE_SIZE; Index += 1) {
+        Working[Index] += Context->State[Index];
+        CHACHA20_STORE32(Block + (Index * sizeof(ULONG)), Working[Index]);
+    }
+
+    Context->State[CHACHA20_COUNTER_INDEX] += 1;
+    RtlZeroMemory(Working, sizeof(Working));
+    return;
+}
+
@@ -37,7 +37,9 @@ Module Name:
 // ---------------------------------------------------------------- Definitions
 //
 
-#define BIG_INTEGER_RADIX 0x100000000ULL
+#define BIG_INTEGER_RADIX              \
+    ((BIG_INTEGER_LONG_COMPONENT)1 <<  \
+     (BIG_INTEGER_COMPONENT_SIZE * BITS_PER_BYTE))
 
 //
 // Define the modulo indices.
@@ -47,6 +49,18 @@ Module Name:
 #define BIG_INTEGER_P_OFFSET 1
 #define BIG_INTEGER_Q_OFFSET 2
 
+//
+// Define the set of hardware acceleration features enabled by default. The
+// kernel flavor of the library is built with this set to zero, since the
+// kernel does not save vector register state on its own behalf.
+//
+
+#ifndef CRYPTO_HARDWARE_DEFAULT
+
+#define CRYPTO_HARDWARE_DEFAULT CRYPTO_HARDWARE_ALL
+
+#endif
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -55,6 +69,8 @@ Module Name:
 // -------------------------------------------------------------------- Globals
 //
 
+extern const ULONG CySha256KConstants[64];
+
 //
 // -------------------------------------------------------- Function Prototypes
 //
@@ -475,3 +491,216 @@ Return Value:
 
 --*/
 
+//
+// Hardware acceleration functions
+//
+
+ULONG
+CypGetHardwareSupport (
+    VOID
+    );
+
+/*++
+
+Routine Description:
+
+    This routine returns the set of processor acceleration features that are
+    both supported and enabled, detecting them on first use.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns a mask of CRYPTO_HARDWARE_* flags.
+
+--*/
+
+VOID
+CypAesHardwareEcb (
+    PAES_CONTEXT Context,
+    PCUCHAR Input,
+    PUCHAR Output,
+    UINTN BlockCount,
+    BOOL Decrypt
+    );
+
+/*++
+
+Routine Description:
+
+    This routine encrypts or decrypts blocks in ECB mode using the processor's
+    AES instructions.
+
+Arguments:
+
+    Context - Supplies a pointer to the AES context. For decryption, the keys
+        must already have been converted for decryption.
+
+    Input - Supplies a pointer to the input blocks.
+
+    Output - Supplies a pointer where the output blocks will be returned.
+
+    BlockCount - Supplies the number of blocks to process.
+
+    Decrypt - Supplies a boolean indicating whether to decrypt (TRUE) or
+        encrypt (FALSE).
+
+Return Value:
+
+    None.
+
+--*/
+
+VOID
+CypAesHardwareCbcEncrypt (
+    PAES_CONTEXT Context,
+    PCUCHAR Plaintext,
+    PUCHAR Ciphertext,
+    UINTN BlockCount
+    );
+
+/*++
+
+Routine Description:
+
+    This routine encrypts blocks in CBC mode using the processor's AES
+    instructions, and updates the initialization vector in the context.
+
+Arguments:
+
+    Context - Supplies a pointer to the AES context.
+
+    Plaintext - Supplies a pointer to the plaintext blocks.
+
+    Ciphertext - Supplies a pointer where the ciphertext will be returned.
+
+    BlockCount - Supplies the number of blocks to process.
+
+Return Value:
+
+    None.
+
+--*/
+
+VOID
+CypAesHardwareCbcDecrypt (
+    PAES_CONTEXT Context,
+    PCUCHAR Ciphertext,
+    PUCHAR Plaintext,
+    UINTN BlockCount
+    );
+
+/*++
+
+Routine Description:
+
+    This routine decrypts blocks in CBC mode using the processor's AES
+    instructions, and updates the initialization vector in the context.
+
+Arguments:
+
+    Context - Supplies a pointer to the AES context, whose keys must already
+        have been converted for decryption.
+
+    Ciphertext - Supplies a pointer to the ciphertext blocks.
+
+    Plaintext - Supplies a pointer where the plaintext will be returned. This
+        may be the same as the ciphertext buffer.
+
+    BlockCount - Supplies the number of blocks to process.
+
+Return Value:
+
+    None.
+
+--*/
+
+VOID
+CypAesHardwareCtr (
+    PAES_CONTEXT Context,
+    PCUCHAR Input,
+    PUCHAR Output,
+    UINTN BlockCount
+    );
+
+/*++
+
+Routine Description:
+
+    This routine encrypts or decrypts blocks in counter mode using the
+    processor's AES instructions, and updates the counter in the context.
+
+Arguments:
+
+    Context - Supplies a pointer to the AES context.
+
+    Input - Supplies a pointer to the input blocks.
+
+    Output - Supplies a pointer where the output blocks will be returned.
+
+    BlockCount - Supplies the number of blocks to process.
+
+Return Value:
+
+    None.
+
+--*/
+
+VOID
+CypSha1HardwareProcessBlocks (
+    PULONG State,
+    PCUCHAR Message,
+    UINTN BlockCount
+    );
+
+/*++
+
+Routine Description:
+
+    This routine runs the SHA-1 compression function over one or more message
+    blocks using the processor's SHA instructions.
+
+Arguments:
+
+    State - Supplies a pointer to the five word intermediate hash.
+
+    Message - Supplies a pointer to the message blocks.
+
+    BlockCount - Supplies the number of 64 byte blocks to process.
+
+Return Value:
+
+    None.
+
+--*/
+
+VOID
+CypSha256HardwareProcessBlocks (
+    PULONG State,
+    PCUCHAR Message,
+    UINTN BlockCount
+    );
+
+/*++
+
+Routine Description:
+
+    This routine runs the SHA-256 compression function over one or more
+    message blocks using the processor's SHA instructions.
+
+Arguments:
+
+    State - Supplies a pointer to the eight word intermediate hash.
+
+    Message - Supplies a pointer to the message blocks.
+
+    BlockCount - Supplies the number of 64 byte blocks to process.
+
+Return Value:
+
+    None.
+
+--*/
+
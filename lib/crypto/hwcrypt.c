@@ -0,0 +1,897 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    hwcrypt.c
+
+Abstract:
+
+    This module implements support for the processor's cryptographic
+    instructions, including detecting them and wrapping them up into the AES
+    cipher modes and SHA block functions.
+
+Author:
+
+    agent 18-Oct-2026
+
+Environment:
+
+    Any
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include "cryptop.h"
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// Define the size of the byte ordered key schedule handed to the hardware.
+//
+
+#define AES_HARDWARE_KEYS_SIZE ((AES_MAX_ROUNDS + 1) * AES_BLOCK_SIZE)
+
+//
+// Define the number of blocks processed at once by the counter and CBC
+// decrypt paths. These are independent, so the hardware can work on several
+// at a time.
+//
+
+#define AES_HARDWARE_BATCH_BLOCKS 8
+
+//
+// Define the CPUID bits that matter here.
+//
+
+#define X86_CPUID_BASIC_INFORMATION 1
+#define X86_CPUID_EXTENDED_FEATURES 7
+
+#define X86_CPUID_BASIC_EDX_SSE2 (1 << 26)
+#define X86_CPUID_BASIC_ECX_SSSE3 (1 << 9)
+#define X86_CPUID_BASIC_ECX_SSE4_1 (1 << 19)
+#define X86_CPUID_BASIC_ECX_AES (1 << 25)
+#define X86_CPUID_EXTENDED_EBX_SHA (1 << 29)
+
+#define X86_CPUID_EAX 0
+#define X86_CPUID_EBX 1
+#define X86_CPUID_ECX 2
+#define X86_CPUID_EDX 3
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+ULONG
+CypDetectHardwareSupport (
+    VOID
+    );
+
+VOID
+CypAesLoadHardwareKeys (
+    PAES_CONTEXT Context,
+    UCHAR Keys[AES_HARDWARE_KEYS_SIZE]
+    );
+
+VOID
+CypAesHardwareBlocks (
+    PCUCHAR Keys,
+    ULONG Rounds,
+    PCUCHAR Input,
+    PUCHAR Output,
+    UINTN BlockCount,
+    BOOL Decrypt
+    );
+
+VOID
+CypAesXorBlocks (
+    PUCHAR Destination,
+    PCUCHAR Source1,
+    PCUCHAR Source2,
+    UINTN Size
+    );
+
+#if defined(__i386) || defined(__amd64)
+
+//
+// These routines are implemented in assembly.
+//
+
+VOID
+CypCpuid (
+    ULONG Leaf,
+    ULONG Subleaf,
+    ULONG Registers[4]
+    );
+
+VOID
+CypAesNiEncryptBlocks (
+    PCUCHAR Keys,
+    ULONG Rounds,
+    PCUCHAR Input,
+    PUCHAR Output,
+    UINTN BlockCount
+    );
+
+VOID
+CypAesNiDecryptBlocks (
+    PCUCHAR Keys,
+    ULONG Rounds,
+    PCUCHAR Input,
+    PUCHAR Output,
+    UINTN BlockCount
+    );
+
+VOID
+CypShaNiSha1Blocks (
+    PULONG State,
+    PCUCHAR Data,
+    UINTN BlockCount,
+    PCUCHAR ShuffleMask
+    );
+
+VOID
+CypShaNiSha256Blocks (
+    PULONG State,
+    PCUCHAR Data,
+    UINTN BlockCount,
+    const ULONG *Constants,
+    PCUCHAR ShuffleMask
+    );
+
+#endif
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// Store the features the processor supports, which are detected on first use,
+// and the features the library is allowed to use.
+//
+
+BOOL CyHardwareDetected = FALSE;
+ULONG CyHardwareAvailable;
+ULONG CyHardwareEnabled = CRYPTO_HARDWARE_DEFAULT;
+
+//
+// Store the shuffle masks used by the SHA routines. The SHA-1 mask reverses a
+// whole 16 byte value, and the SHA-256 mask byte swaps each 32-bit word.
+//
+
+const UCHAR CySha1ShuffleMask[16] = {
+    0x0F, 0x0E, 0x0D, 0x0C, 0x0B, 0x0A, 0x09, 0x08,
+    0x07, 0x06, 0x05, 0x04, 0x03, 0x02, 0x01, 0x00
+};
+
+const UCHAR CySha256ShuffleMask[16] = {
+    0x03, 0x02, 0x01, 0x00, 0x07, 0x06, 0x05, 0x04,
+    0x0B, 0x0A, 0x09, 0x08, 0x0F, 0x0E, 0x0D, 0x0C
+};
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+CRYPTO_API
+ULONG
+CyGetHardwareSupport (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the set of processor acceleration features that the
+    crypto library is currently using.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns a mask of CRYPTO_HARDWARE_* flags. These are the features that
+    are both supported by the processor and enabled.
+
+--*/
+
+{
+
+    return CypGetHardwareSupport();
+}
+
+CRYPTO_API
+ULONG
+CySetHardwareSupport (
+    ULONG Mask
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sets which processor acceleration features the crypto library
+    is allowed to use. Features not supported by the processor are never used
+    regardless of the mask. The hardware paths use the processor's vector
+    registers, so environments that do not preserve that state across context
+    switches (such as the kernel) must not enable them.
+
+Arguments:
+
+    Mask - Supplies a mask of CRYPTO_HARDWARE_* flags to allow.
+
+Return Value:
+
+    Returns the mask of features that are now in use.
+
+--*/
+
+{
+
+    CyHardwareEnabled = Mask & CRYPTO_HARDWARE_ALL;
+    return CypGetHardwareSupport();
+}
+
+ULONG
+CypGetHardwareSupport (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the set of processor acceleration features that are
+    both supported and enabled, detecting them on first use.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns a mask of CRYPTO_HARDWARE_* flags.
+
+--*/
+
+{
+
+    //
+    // Detection always comes up with the same answer, so it does not matter
+    // if two threads race to do it.
+    //
+
+    if (CyHardwareDetected == FALSE) {
+        CyHardwareAvailable = CypDetectHardwareSupport();
+        CyHardwareDetected = TRUE;
+    }
+
+    return CyHardwareAvailable & CyHardwareEnabled;
+}
+
+VOID
+CypAesHardwareEcb (
+    PAES_CONTEXT Context,
+    PCUCHAR Input,
+    PUCHAR Output,
+    UINTN BlockCount,
+    BOOL Decrypt
+    )
+
+/*++
+
+Routine Description:
+
+    This routine encrypts or decrypts blocks in ECB mode using the processor's
+    AES instructions.
+
+Arguments:
+
+    Context - Supplies a pointer to the AES context. For decryption, the keys
+        must already have been converted for decryption.
+
+    Input - Supplies a pointer to the input blocks.
+
+    Output - Supplies a pointer where the output blocks will be returned.
+
+    BlockCount - Supplies the number of blocks to process.
+
+    Decrypt - Supplies a boolean indicating whether to decrypt (TRUE) or
+        encrypt (FALSE).
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UCHAR Keys[AES_HARDWARE_KEYS_SIZE];
+
+    CypAesLoadHardwareKeys(Context, Keys);
+    CypAesHardwareBlocks(Keys,
+                         Context->Rounds,
+                         Input,
+                         Output,
+                         BlockCount,
+                         Decrypt);
+
+    RtlZeroMemory(Keys, sizeof(Keys));
+    return;
+}
+
+VOID
+CypAesHardwareCbcEncrypt (
+    PAES_CONTEXT Context,
+    PCUCHAR Plaintext,
+    PUCHAR Ciphertext,
+    UINTN BlockCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine encrypts blocks in CBC mode using the processor's AES
+    instructions, and updates the initialization vector in the context.
+
+Arguments:
+
+    Context - Supplies a pointer to the AES context.
+
+    Plaintext - Supplies a pointer to the plaintext blocks.
+
+    Ciphertext - Supplies a pointer where the ciphertext will be returned.
+
+    BlockCount - Supplies the number of blocks to process.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UCHAR Block[AES_BLOCK_SIZE];
+    UCHAR Keys[AES_HARDWARE_KEYS_SIZE];
+
+    //
+    // Each block depends on the one before it, so there is nothing to overlap
+    // here.
+    //
+
+    CypAesLoadHardwareKeys(Context, Keys);
+    RtlCopyMemory(Block, Context->InitializationVector, AES_BLOCK_SIZE);
+    while (BlockCount != 0) {
+        CypAesXorBlocks(Block, Block, Plaintext, AES_BLOCK_SIZE);
+        CypAesHardwareBlocks(Keys, Context->Rounds, Block, Block, 1, FALSE);
+        RtlCopyMemory(Ciphertext, Block, AES_BLOCK_SIZE);
+        Plaintext += AES_BLOCK_SIZE;
+        Ciphertext += AES_BLOCK_SIZE;
+        BlockCount -= 1;
+    }
+
+    RtlCopyMemory(Context->InitializationVector, Block, AES_BLOCK_SIZE);
+    RtlZeroMemory(Keys, sizeof(Keys));
+    return;
+}
+
+VOID
+CypAesHardwareCbcDecrypt (
+    PAES_CONTEXT Context,
+    PCUCHAR Ciphertext,
+    PUCHAR Plaintext,
+    UINTN BlockCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine decrypts blocks in CBC mode using the processor's AES
+    instructions, and updates the initialization vector in the context.
+
+Arguments:
+
+    Context - Supplies a pointer to the AES context, whose keys must already
+        have been converted for decryption.
+
+    Ciphertext - Supplies a pointer to the ciphertext blocks.
+
+    Plaintext - Supplies a pointer where the plaintext will be returned. This
+        may be the same as the ciphertext buffer.
+
+    BlockCount - Supplies the number of blocks to process.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UINTN Count;
+    UCHAR Input[AES_HARDWARE_BATCH_BLOCKS * AES_BLOCK_SIZE];
+    UCHAR Keys[AES_HARDWARE_KEYS_SIZE];
+    UCHAR Previous[AES_BLOCK_SIZE];
+    UINTN Size;
+
+    //
+    // Unlike encryption, the decryption of each block only depends on
+    // ciphertext, so a batch of blocks can be decrypted together and then
+    // chained afterwards. The ciphertext is copied aside first since the
+    // output may overwrite it.
+    //
+
+    CypAesLoadHardwareKeys(Context, Keys);
+    RtlCopyMemory(Previous, Context->InitializationVector, AES_BLOCK_SIZE);
+    while (BlockCount != 0) {
+        Count = BlockCount;
+        if (Count > AES_HARDWARE_BATCH_BLOCKS) {
+            Count = AES_HARDWARE_BATCH_BLOCKS;
+        }
+
+        Size = Count * AES_BLOCK_SIZE;
+        RtlCopyMemory(Input, Ciphertext, Size);
+        CypAesHardwareBlocks(Keys,
+                             Context->Rounds,
+                             Input,
+                             Plaintext,
+                             Count,
+                             TRUE);
+
+        CypAesXorBlocks(Plaintext, Plaintext, Previous, AES_BLOCK_SIZE);
+        CypAesXorBlocks(Plaintext + AES_BLOCK_SIZE,
+                        Plaintext + AES_BLOCK_SIZE,
+                        Input,
+                        Size - AES_BLOCK_SIZE);
+
+        RtlCopyMemory(Previous, Input + Size - AES_BLOCK_SIZE, AES_BLOCK_SIZE);
+        Ciphertext += Size;
+        Plaintext += Size;
+        BlockCount -= Count;
+    }
+
+    RtlCopyMemory(Context->InitializationVector, Previous, AES_BLOCK_SIZE);
+    RtlZeroMemory(Keys, sizeof(Keys));
+    return;
+}
+
+VOID
+CypAesHardwareCtr (
+    PAES_CONTEXT Context,
+    PCUCHAR Input,
+    PUCHAR Output,
+    UINTN BlockCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine encrypts or decrypts blocks in counter mode using the
+    processor's AES instructions, and updates the counter in the context.
+
+Arguments:
+
+    Context - Supplies a pointer to the AES context.
+
+    Input - Supplies a pointer to the input blocks.
+
+    Output - Supplies a pointer where the output blocks will be returned.
+
+    BlockCount - Supplies the number of blocks to process.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    INT ByteIndex;
+    UINTN Count;
+    PUCHAR Counter;
+    UCHAR KeyStream[AES_HARDWARE_BATCH_BLOCKS * AES_BLOCK_SIZE];
+    UCHAR Keys[AES_HARDWARE_KEYS_SIZE];
+    UINTN Index;
+    UINTN Size;
+
+    //
+    // Lay out a batch of consecutive counter values, encrypt them all at
+    // once, and XOR the resulting key stream with the input.
+    //
+
+    CypAesLoadHardwareKeys(Context, Keys);
+    Counter = Context->InitializationVector;
+    while (BlockCount != 0) {
+        Count = BlockCount;
+        if (Count > AES_HARDWARE_BATCH_BLOCKS) {
+            Count = AES_HARDWARE_BATCH_BLOCKS;
+        }
+
+        for (Index = 0; Index < Count; Index += 1) {
+            RtlCopyMemory(KeyStream + (Index * AES_BLOCK_SIZE),
+                          Counter,
+                          AES_BLOCK_SIZE);
+
+            //
+            // Increment the counter. Remember that this is big-endian.
+            //
+
+            for (ByteIndex = AES_BLOCK_SIZE - 1;
+                 ByteIndex >= 0;
+                 ByteIndex -= 1) {
+
+                Counter[ByteIndex] += 1;
+                if (Counter[ByteIndex] != 0) {
+                    break;
+                }
+            }
+        }
+
+        CypAesHardwareBlocks(Keys,
+                             Context->Rounds,
+                             KeyStream,
+                             KeyStream,
+                             Count,
+                             FALSE);
+
+        Size = Count * AES_BLOCK_SIZE;
+        CypAesXorBlocks(Output, Input, KeyStream, Size);
+        Input += Size;
+        Output += Size;
+        BlockCount -= Count;
+    }
+
+    RtlZeroMemory(KeyStream, sizeof(KeyStream));
+    RtlZeroMemory(Keys, sizeof(Keys));
+    return;
+}
+
+VOID
+CypSha1HardwareProcessBlocks (
+    PULONG State,
+    PCUCHAR Message,
+    UINTN BlockCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine runs the SHA-1 compression function over one or more message
+    blocks using the processor's SHA instructions.
+
+Arguments:
+
+    State - Supplies a pointer to the five word intermediate hash.
+
+    Message - Supplies a pointer to the message blocks.
+
+    BlockCount - Supplies the number of 64 byte blocks to process.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+#if defined(__i386) || defined(__amd64)
+
+    CypShaNiSha1Blocks(State, Message, BlockCount, CySha1ShuffleMask);
+
+#else
+
+    ASSERT(FALSE);
+
+#endif
+
+    return;
+}
+
+VOID
+CypSha256HardwareProcessBlocks (
+    PULONG State,
+    PCUCHAR Message,
+    UINTN BlockCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine runs the SHA-256 compression function over one or more
+    message blocks using the processor's SHA instructions.
+
+Arguments:
+
+    State - Supplies a pointer to the eight word intermediate hash.
+
+    Message - Supplies a pointer to the message blocks.
+
+    BlockCount - Supplies the number of 64 byte blocks to process.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+#if defined(__i386) || defined(__amd64)
+
+    CypShaNiSha256Blocks(State,
+                         Message,
+                         BlockCount,
+                         CySha256KConstants,
+                         CySha256ShuffleMask);
+
+#else
+
+    ASSERT(FALSE);
+
+#endif
+
+    return;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+ULONG
+CypDetectHardwareSupport (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines which cryptographic instructions the processor
+    supports.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns a mask of CRYPTO_HARDWARE_* flags.
+
+--*/
+
+{
+
+    ULONG Features;
+
+#if defined(__i386) || defined(__amd64)
+
+    ULONG Basic[4];
+    ULONG Extended[4];
+    ULONG MaxLeaf;
+
+    Features = 0;
+    CypCpuid(0, 0, Basic);
+    MaxLeaf = Basic[X86_CPUID_EAX];
+    if (MaxLeaf < X86_CPUID_BASIC_INFORMATION) {
+        return Features;
+    }
+
+    CypCpuid(X86_CPUID_BASIC_INFORMATION, 0, Basic);
+
+    //
+    // Everything here needs SSE2 and SSSE3 for the loads and shuffles around
+    // the crypto instructions themselves.
+    //
+
+    if (((Basic[X86_CPUID_EDX] & X86_CPUID_BASIC_EDX_SSE2) == 0) ||
+        ((Basic[X86_CPUID_ECX] & X86_CPUID_BASIC_ECX_SSSE3) == 0)) {
+
+        return Features;
+    }
+
+    if ((Basic[X86_CPUID_ECX] & X86_CPUID_BASIC_ECX_AES) != 0) {
+        Features |= CRYPTO_HARDWARE_AES;
+    }
+
+    //
+    // The SHA-256 path also uses a blend from SSE 4.1.
+    //
+
+    if ((MaxLeaf >= X86_CPUID_EXTENDED_FEATURES) &&
+        ((Basic[X86_CPUID_ECX] & X86_CPUID_BASIC_ECX_SSE4_1) != 0)) {
+
+        CypCpuid(X86_CPUID_EXTENDED_FEATURES, 0, Extended);
+        if ((Extended[X86_CPUID_EBX] & X86_CPUID_EXTENDED_EBX_SHA) != 0) {
+            Features |= CRYPTO_HARDWARE_SHA1 | CRYPTO_HARDWARE_SHA256;
+        }
+    }
+
+#else
+
+    //
+    // The ARMv7 processors supported here have no cryptographic extensions.
+    //
+
+    Features = 0;
+
+#endif
+
+    return Features;
+}
+
+VOID
+CypAesLoadHardwareKeys (
+    PAES_CONTEXT Context,
+    UCHAR Keys[AES_HARDWARE_KEYS_SIZE]
+    )
+
+/*++
+
+Routine Description:
+
+    This routine converts the key schedule in the context, which is stored as
+    native 32-bit words, into the byte ordered form the hardware expects.
+
+Arguments:
+
+    Context - Supplies a pointer to the AES context.
+
+    Keys - Supplies a pointer where the byte ordered key schedule will be
+        returned.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UINTN Index;
+    ULONG Value;
+    UINTN WordCount;
+
+    WordCount = (Context->Rounds + 1) * (AES_BLOCK_SIZE / sizeof(ULONG));
+
+    ASSERT(WordCount * sizeof(ULONG) <= AES_HARDWARE_KEYS_SIZE);
+
+    for (Index = 0; Index < WordCount; Index += 1) {
+        Value = Context->Keys[Index];
+        Keys[0] = (UCHAR)(Value >> 24);
+        Keys[1] = (UCHAR)(Value >> 16);
+        Keys[2] = (UCHAR)(Value >> 8);
+        Keys[3] = (UCHAR)Value;
+        Keys += sizeof(ULONG);
+    }
+
+    return;
+}
+
+VOID
+CypAesHardwareBlocks (
+    PCUCHAR Keys,
+    ULONG Rounds,
+    PCUCHAR Input,
+    PUCHAR Output,
+    UINTN BlockCount,
+    BOOL Decrypt
+    )
+
+/*++
+
+Routine Description:
+
+    This routine encrypts or decrypts a run of independent blocks using the
+    processor's AES instructions.
+
+Arguments:
+
+    Keys - Supplies a pointer to the byte ordered key schedule.
+
+    Rounds - Supplies the number of rounds.
+
+    Input - Supplies a pointer to the input blocks.
+
+    Output - Supplies a pointer where the output blocks will be returned. This
+        may be the same as the input.
+
+    BlockCount - Supplies the number of blocks to process.
+
+    Decrypt - Supplies a boolean indicating whether to decrypt (TRUE) or
+        encrypt (FALSE).
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+#if defined(__i386) || defined(__amd64)
+
+    if (Decrypt != FALSE) {
+        CypAesNiDecryptBlocks(Keys, Rounds, Input, Output, BlockCount);
+
+    } else {
+        CypAesNiEncryptBlocks(Keys, Rounds, Input, Output, BlockCount);
+    }
+
+#else
+
+    ASSERT(FALSE);
+
+#endif
+
+    return;
+}
+
+VOID
+CypAesXorBlocks (
+    PUCHAR Destination,
+    PCUCHAR Source1,
+    PCUCHAR Source2,
+    UINTN Size
+    )
+
+/*++
+
+Routine Description:
+
+    This routine XORs two buffers together.
+
+Arguments:
+
+    Destination - Supplies a pointer where the result will be returned. This
+        may be the same as either source.
+
+    Source1 - Supplies a pointer to the first buffer.
+
+    Source2 - Supplies a pointer to the second buffer.
+
+    Size - Supplies the number of bytes to XOR.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UINTN Index;
+
+    for (Index = 0; Index < Size; Index += 1) {
+        Destination[Index] = Source1[Index] ^ Source2[Index];
+    }
+
+    return;
+}
+
@@ -56,7 +56,15 @@ Module Name:
 
 VOID
 CypSha1ProcessMessage (
-    PSHA1_CONTEXT Context
+    PSHA1_CONTEXT Context,
+    PCUCHAR Message,
+    UINTN BlockCount
+    );
+
+VOID
+CypSha1ProcessBlock (
+    PSHA1_CONTEXT Context,
+    PCUCHAR Message
     );
 
 VOID
@@ -144,16 +152,53 @@ Return Value:
 
 {
 
-    while (Length != 0) {
-        Context->MessageBlock[Context->BlockIndex] = *Message;
-        Context->BlockIndex += 1;
-        Context->Length += BITS_PER_BYTE;
+    UINTN BlockCount;
+    UINTN Size;
+
+    Context->Length += (ULONGLONG)Length * BITS_PER_BYTE;
+
+    //
+    // Top off a partially filled block first.
+    //
+
+    if (Context->BlockIndex != 0) {
+        Size = sizeof(Context->MessageBlock) - Context->BlockIndex;
+        if (Size > Length) {
+            Size = Length;
+        }
+
+        RtlCopyMemory(Context->MessageBlock + Context->BlockIndex,
+                      Message,
+                      Size);
+
+        Context->BlockIndex += Size;
+        Message += Size;
+        Length -= Size;
         if (Context->BlockIndex == sizeof(Context->MessageBlock)) {
-            CypSha1ProcessMessage(Context);
+            CypSha1ProcessMessage(Context, Context->MessageBlock, 1);
         }
+    }
 
-        Message += 1;
-        Length -= 1;
+    //
+    // Hash whole blocks straight out of the caller's buffer rather than
+    // copying them through the message block.
+    //
+
+    BlockCount = Length / sizeof(Context->MessageBlock);
+    if (BlockCount != 0) {
+        CypSha1ProcessMessage(Context, Message, BlockCount);
+        Size = BlockCount * sizeof(Context->MessageBlock);
+        Message += Size;
+        Length -= Size;
+    }
+
+    //
+    // Save the remainder for the next call.
+    //
+
+    if (Length != 0) {
+        RtlCopyMemory(Context->MessageBlock, Message, Length);
+        Context->BlockIndex = Length;
     }
 
     return;
@@ -211,20 +256,70 @@ Return Value:
 
 VOID
 CypSha1ProcessMessage (
-    PSHA1_CONTEXT Context
+    PSHA1_CONTEXT Context,
+    PCUCHAR Message,
+    UINTN BlockCount
     )
 
 /*++
 
 Routine Description:
 
-    This routine processes the 512 bits in the current message block and adds
-    them to the digest.
+    This routine processes one or more 512 bit message blocks and adds them to
+    the digest, using the processor's hashing instructions if they are
+    available.
 
 Arguments:
 
-    Context - Supplies a pointer to the initialized SHA-1 context with a full
-        message block.
+    Context - Supplies a pointer to the initialized SHA-1 context.
+
+    Message - Supplies a pointer to the message blocks.
+
+    BlockCount - Supplies the number of 64 byte blocks to process.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    if ((CypGetHardwareSupport() & CRYPTO_HARDWARE_SHA1) != 0) {
+        CypSha1HardwareProcessBlocks(Context->IntermediateHash,
+                                     Message,
+                                     BlockCount);
+
+    } else {
+        while (BlockCount != 0) {
+            CypSha1ProcessBlock(Context, Message);
+            Message += sizeof(Context->MessageBlock);
+            BlockCount -= 1;
+        }
+    }
+
+    Context->BlockIndex = 0;
+    return;
+}
+
+VOID
+CypSha1ProcessBlock (
+    PSHA1_CONTEXT Context,
+    PCUCHAR Message
+    )
+
+/*++
+
+Routine Description:
+
+    This routine processes a single 512 bit message block and adds it to the
+    digest.
+
+Arguments:
+
+    Context - Supplies a pointer to the initialized SHA-1 context.
+
+    Message - Supplies a pointer to the 64 byte message block.
 
 Return Value:
 
@@ -248,10 +343,10 @@ Return Value:
     //
 
     for (Index = 0; Index < 16; Index += 1) {
-        Block[Index] = ((ULONG)Context->MessageBlock[Index * 4] << 24) |
-                       ((ULONG)Context->MessageBlock[(Index * 4) + 1] << 16) |
-                       ((ULONG)Context->MessageBlock[(Index * 4) + 2] << 8) |
-                       (Context->MessageBlock[(Index * 4) + 3]);
+        Block[Index] = ((ULONG)Message[Index * 4] << 24) |
+                       ((ULONG)Message[(Index * 4) + 1] << 16) |
+                       ((ULONG)Message[(Index * 4) + 2] << 8) |
+                       (Message[(Index * 4) + 3]);
     }
 
     for (Index = 16; Index < 80; Index += 1) {
@@ -317,7 +412,6 @@ Return Value:
     Context->IntermediateHash[2] += BlockC;
     Context->IntermediateHash[3] += BlockD;
     Context->IntermediateHash[4] += BlockE;
-    Context->BlockIndex = 0;
     return;
 }
 
@@ -361,7 +455,7 @@ Return Value:
             Context->BlockIndex += 1;
         }
 
-        CypSha1ProcessMessage(Context);
+        CypSha1ProcessMessage(Context, Context->MessageBlock, 1);
         while (Context->BlockIndex < 56) {
             Context->MessageBlock[Context->BlockIndex] = 0;
             Context->BlockIndex += 1;
@@ -388,7 +482,7 @@ Return Value:
     Context->MessageBlock[61] = (UCHAR)(Context->Length >> 16);
     Context->MessageBlock[62] = (UCHAR)(Context->Length >> 8);
     Context->MessageBlock[63] = (UCHAR)(Context->Length);
-    CypSha1ProcessMessage(Context);
+    CypSha1ProcessMessage(Context, Context->MessageBlock, 1);
     return;
 }
 
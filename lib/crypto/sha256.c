@@ -82,7 +82,15 @@ Module Name:
 
 VOID
 CypSha256ProcessMessage (
-    PSHA256_CONTEXT Context
+    PSHA256_CONTEXT Context,
+    PCUCHAR Message,
+    UINTN BlockCount
+    );
+
+VOID
+CypSha256ProcessBlock (
+    PSHA256_CONTEXT Context,
+    PCUCHAR Message
     );
 
 VOID
@@ -180,20 +188,54 @@ Return Value:
 
 {
 
+    UINTN BlockCount;
     PUCHAR Bytes;
+    UINTN Size;
 
     Bytes = Message;
-    while (Length != 0) {
-        Context->MessageBlock[Context->BlockIndex] = *Bytes;
-        Context->BlockIndex += 1;
+
+    //
+    // Top off a partially filled block first.
+    //
+
+    if (Context->BlockIndex != 0) {
+        Size = sizeof(Context->MessageBlock) - Context->BlockIndex;
+        if (Size > Length) {
+            Size = Length;
+        }
+
+        RtlCopyMemory(Context->MessageBlock + Context->BlockIndex, Bytes, Size);
+        Context->BlockIndex += Size;
+        Bytes += Size;
+        Length -= Size;
         if (Context->BlockIndex == sizeof(Context->MessageBlock)) {
-            CypSha256ProcessMessage(Context);
+            CypSha256ProcessMessage(Context, Context->MessageBlock, 1);
             Context->Length += sizeof(Context->MessageBlock) * BITS_PER_BYTE;
             Context->BlockIndex = 0;
         }
+    }
 
-        Bytes += 1;
-        Length -= 1;
+    //
+    // Hash whole blocks straight out of the caller's buffer rather than
+    // copying them through the message block.
+    //
+
+    BlockCount = Length / sizeof(Context->MessageBlock);
+    if (BlockCount != 0) {
+        CypSha256ProcessMessage(Context, Bytes, BlockCount);
+        Size = BlockCount * sizeof(Context->MessageBlock);
+        Context->Length += (ULONGLONG)Size * BITS_PER_BYTE;
+        Bytes += Size;
+        Length -= Size;
+    }
+
+    //
+    // Save the remainder for the next call.
+    //
+
+    if (Length != 0) {
+        RtlCopyMemory(Context->MessageBlock, Bytes, Length);
+        Context->BlockIndex = Length;
     }
 
     return;
@@ -256,20 +298,69 @@ Return Value:
 
 VOID
 CypSha256ProcessMessage (
-    PSHA256_CONTEXT Context
+    PSHA256_CONTEXT Context,
+    PCUCHAR Message,
+    UINTN BlockCount
     )
 
 /*++
 
 Routine Description:
 
-    This routine processes the 512 bits in the current message block and adds
-    them to the digest.
+    This routine processes one or more 512 bit message blocks and adds them to
+    the digest, using the processor's hashing instructions if they are
+    available.
 
 Arguments:
 
-    Context - Supplies a pointer to the initialized SHA-256 context with a full
-        message block.
+    Context - Supplies a pointer to the initialized SHA-256 context.
+
+    Message - Supplies a pointer to the message blocks.
+
+    BlockCount - Supplies the number of 64 byte blocks to process.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    if ((CypGetHardwareSupport() & CRYPTO_HARDWARE_SHA256) != 0) {
+        CypSha256HardwareProcessBlocks(Context->IntermediateHash,
+                                       Message,
+                                       BlockCount);
+
+    } else {
+        while (BlockCount != 0) {
+            CypSha256ProcessBlock(Context, Message);
+            Message += sizeof(Context->MessageBlock);
+            BlockCount -= 1;
+        }
+    }
+
+    return;
+}
+
+VOID
+CypSha256ProcessBlock (
+    PSHA256_CONTEXT Context,
+    PCUCHAR Message
+    )
+
+/*++
+
+Routine Description:
+
+    This routine processes a single 512 bit message block and adds it to the
+    digest.
+
+Arguments:
+
+    Context - Supplies a pointer to the initialized SHA-256 context.
+
+    Message - Supplies a pointer to the 64 byte message block.
 
 Return Value:
 
@@ -295,10 +386,10 @@ Return Value:
 
     ByteIndex = 0;
     for (BlockIndex = 0; BlockIndex < 16; BlockIndex += 1) {
-        Block[BlockIndex] = (Context->MessageBlock[ByteIndex] << 24) |
-                            (Context->MessageBlock[ByteIndex + 1] << 16) |
-                            (Context->MessageBlock[ByteIndex + 2] << 8) |
-                            Context->MessageBlock[ByteIndex + 3];
+        Block[BlockIndex] = ((ULONG)Message[ByteIndex] << 24) |
+                            ((ULONG)Message[ByteIndex + 1] << 16) |
+                            ((ULONG)Message[ByteIndex + 2] << 8) |
+                            Message[ByteIndex + 3];
 
         ByteIndex += 4;
     }
@@ -400,7 +491,7 @@ Return Value:
             Index += 1;
         }
 
-        CypSha256ProcessMessage(Context);
+        CypSha256ProcessMessage(Context, Context->MessageBlock, 1);
         RtlZeroMemory(Context->MessageBlock, 56);
     }
 
@@ -418,7 +509,7 @@ Return Value:
     Context->MessageBlock[61] = (UCHAR)(Context->Length >> 16);
     Context->MessageBlock[62] = (UCHAR)(Context->Length >> 8);
     Context->MessageBlock[63] = (UCHAR)(Context->Length);
-    CypSha256ProcessMessage(Context);
+    CypSha256ProcessMessage(Context, Context->MessageBlock, 1);
     return;
 }
 
@@ -62,7 +62,20 @@ Module Name:
 #define BIG_INTEGER_COMPONENT_BITS \
     (sizeof(BIG_INTEGER_COMPONENT) * BITS_PER_BYTE)
 
-#define BIG_INTEGER_LONG_COMPONENT_MAX 0xFFFFFFFFFFFFFFFFULL
+#define BIG_INTEGER_LONG_COMPONENT_MAX ((BIG_INTEGER_LONG_COMPONENT)-1)
+
+//
+// Define the number of components at which multiplies switch from the
+// standard method to Karatsuba's. This must be at least 4.
+//
+
+#define BIG_INTEGER_KARATSUBA_THRESHOLD 64
+
+//
+// Define the largest window, in bits, used for Montgomery exponentiation.
+//
+
+#define BIG_INTEGER_MAX_WINDOW_SIZE 6
 
 //
 // ------------------------------------------------------ Data Type Definitions
@@ -174,6 +187,107 @@ CypBiComputeExponentTable (
     PBIG_INTEGER Value
     );
 
+PBIG_INTEGER
+CypBiExponentiateMontgomery (
+    PBIG_INTEGER_CONTEXT Context,
+    PBIG_INTEGER Value,
+    PBIG_INTEGER Exponent
+    );
+
+VOID
+CypBiMontgomeryMultiply (
+    PBIG_INTEGER_COMPONENT Result,
+    PBIG_INTEGER_COMPONENT Left,
+    PBIG_INTEGER_COMPONENT Right,
+    PBIG_INTEGER Modulus,
+    BIG_INTEGER_COMPONENT Inverse,
+    PBIG_INTEGER_COMPONENT Workspace
+    );
+
+VOID
+CypBiMontgomeryReduce (
+    PBIG_INTEGER_COMPONENT Result,
+    PBIG_INTEGER_COMPONENT Product,
+    PBIG_INTEGER Modulus,
+    BIG_INTEGER_COMPONENT Inverse
+    );
+
+VOID
+CypBiSelectComponents (
+    PBIG_INTEGER_COMPONENT Result,
+    PBIG_INTEGER_COMPONENT Table,
+    UINTN TableSize,
+    UINTN Count,
+    UINTN Index
+    );
+
+PBIG_INTEGER
+CypBiMultiplyKaratsuba (
+    PBIG_INTEGER_CONTEXT Context,
+    PBIG_INTEGER Left,
+    PBIG_INTEGER Right
+    );
+
+VOID
+CypBiMultiplyComponents (
+    PBIG_INTEGER_COMPONENT Result,
+    PBIG_INTEGER_COMPONENT Left,
+    PBIG_INTEGER_COMPONENT Right,
+    UINTN Count,
+    PBIG_INTEGER_COMPONENT Scratch
+    );
+
+VOID
+CypBiMultiplySchoolbook (
+    PBIG_INTEGER_COMPONENT Result,
+    PBIG_INTEGER_COMPONENT Left,
+    PBIG_INTEGER_COMPONENT Right,
+    UINTN Count
+    );
+
+VOID
+CypBiSquareSchoolbook (
+    PBIG_INTEGER_COMPONENT Result,
+    PBIG_INTEGER_COMPONENT Value,
+    UINTN Count
+    );
+
+BIG_INTEGER_COMPONENT
+CypBiAddComponents (
+    PBIG_INTEGER_COMPONENT Result,
+    PBIG_INTEGER_COMPONENT Left,
+    UINTN LeftCount,
+    PBIG_INTEGER_COMPONENT Right,
+    UINTN RightCount
+    );
+
+BIG_INTEGER_COMPONENT
+CypBiSubtractComponents (
+    PBIG_INTEGER_COMPONENT Result,
+    PBIG_INTEGER_COMPONENT Left,
+    UINTN LeftCount,
+    PBIG_INTEGER_COMPONENT Right,
+    UINTN RightCount
+    );
+
+UINTN
+CypBiGetKaratsubaScratchSize (
+    UINTN Count
+    );
+
+BIG_INTEGER_COMPONENT
+CypBiGetNormalizationFactor (
+    BIG_INTEGER_COMPONENT Value
+    );
+
+BIG_INTEGER_COMPONENT
+CypBiDivideLongComponent (
+    BIG_INTEGER_COMPONENT High,
+    BIG_INTEGER_COMPONENT Low,
+    BIG_INTEGER_COMPONENT Divisor,
+    PBIG_INTEGER_COMPONENT Remainder
+    );
+
 PBIG_INTEGER
 CypBiClone (
     PBIG_INTEGER_CONTEXT Context,
@@ -387,7 +501,12 @@ Return Value:
 {
 
     BIG_INTEGER_COMPONENT DValue;
+    UINTN Index;
+    BIG_INTEGER_COMPONENT Inverse;
+    PBIG_INTEGER NewValue;
+    UCHAR OriginalModOffset;
     PBIG_INTEGER RadixCopy;
+    PBIG_INTEGER RSquared;
     PBIG_INTEGER ShiftedRadix;
     UINTN Size;
     KSTATUS Status;
@@ -395,7 +514,7 @@ Return Value:
     RadixCopy = NULL;
     Size = Value->Size;
     Status = STATUS_INSUFFICIENT_RESOURCES;
-    DValue = BIG_INTEGER_RADIX / (Value->Components[Size - 1] + 1);
+    DValue = CypBiGetNormalizationFactor(Value->Components[Size - 1]);
 
     ASSERT(Context->Modulus[ModOffset] == NULL);
 
@@ -441,6 +560,50 @@ Return Value:
 
     CypBiMakePermanent(Context->Mu[ModOffset]);
     RadixCopy = NULL;
+
+    //
+    // Odd moduli, which includes every RSA modulus and prime, can use
+    // Montgomery multiplication. Compute the negative inverse of the low
+    // component with Newton's method, where the initial guess is correct to
+    // three bits and each step doubles the number of correct bits.
+    //
+
+    if ((Value->Components[0] & 0x1) != 0) {
+        Inverse = Value->Components[0];
+        for (Index = 0; Index < 5; Index += 1) {
+            Inverse *= 2 - (Value->Components[0] * Inverse);
+        }
+
+        Context->MontgomeryInverse[ModOffset] = 0 - Inverse;
+
+        //
+        // Compute R^2 modulo the value, where R is the radix raised to the
+        // size of the modulus.
+        //
+
+        RSquared = CypBiCreate(Context, (Size * 2) + 1);
+        if (RSquared == NULL) {
+            goto BiCalculateModuliEnd;
+        }
+
+        RtlZeroMemory(RSquared->Components,
+                      RSquared->Size * sizeof(BIG_INTEGER_COMPONENT));
+
+        RSquared->Components[Size * 2] = 1;
+        OriginalModOffset = Context->ModOffset;
+        Context->ModOffset = ModOffset;
+        NewValue = CypBiModulo(Context, RSquared);
+        Context->ModOffset = OriginalModOffset;
+        if (NewValue == NULL) {
+            goto BiCalculateModuliEnd;
+        }
+
+        ASSERT(Context->MontgomeryRSquared[ModOffset] == NULL);
+
+        Context->MontgomeryRSquared[ModOffset] = NewValue;
+        CypBiMakePermanent(NewValue);
+    }
+
     Status = STATUS_SUCCESS;
 
 BiCalculateModuliEnd:
@@ -501,6 +664,14 @@ Return Value:
         *Pointer = NULL;
     }
 
+    Pointer = &(Context->MontgomeryRSquared[ModOffset]);
+    if (*Pointer != NULL) {
+        CypBiMakeNonPermanent(*Pointer);
+        CypBiReleaseReference(Context, *Pointer);
+        *Pointer = NULL;
+    }
+
+    Context->MontgomeryInverse[ModOffset] = 0;
     return;
 }
 
@@ -547,6 +718,14 @@ Return Value:
     KSTATUS Status;
     INTN WindowSize;
 
+    //
+    // Use constant time Montgomery exponentiation if the modulus is odd.
+    //
+
+    if (Context->MontgomeryRSquared[Context->ModOffset] != NULL) {
+        return CypBiExponentiateMontgomery(Context, Value, Exponent);
+    }
+
     WindowSize = 1;
     LeadingBit = CypBiFindLeadingBit(Exponent);
 
@@ -894,7 +1073,8 @@ Return Value:
     PBIG_INTEGER Value;
 
     Bytes = Data;
-    ComponentCount = ALIGN_RANGE_UP(Size, sizeof(BIG_INTEGER_COMPONENT));
+    ComponentCount = ALIGN_RANGE_UP(Size, sizeof(BIG_INTEGER_COMPONENT)) /
+                     sizeof(BIG_INTEGER_COMPONENT);
     Value = CypBiCreate(Context, ComponentCount);
     if (Value == NULL) {
         return NULL;
@@ -912,7 +1092,7 @@ Return Value:
     ByteIndex = 0;
     Offset = 0;
     for (Index = Size - 1; Index >= 0; Index -= 1) {
-        Value->Components[Offset] += Bytes[Index] <<
+        Value->Components[Offset] |= (BIG_INTEGER_COMPONENT)Bytes[Index] <<
                                      (ByteIndex * BITS_PER_BYTE);
 
         ByteIndex += 1;
@@ -938,7 +1118,9 @@ CypBiExport (
 
 Routine Description:
 
-    This routine exports a big integer to a byte stream.
+    This routine exports a big integer to a byte stream, most significant
+    byte first. Leading bytes of the buffer beyond the size of the integer are
+    zeroed.
 
 Arguments:
 
@@ -962,35 +1144,40 @@ Return Value:
 
 {
 
-    ULONG Byte;
     UINTN ByteIndex;
+    BIG_INTEGER_COMPONENT Component;
     PUCHAR DataBytes;
     UINTN DataIndex;
     INTN Index;
-    UINTN IntegerSize;
-    BIG_INTEGER_COMPONENT Mask;
 
     DataBytes = Data;
-    IntegerSize = Value->Size * sizeof(BIG_INTEGER_COMPONENT);
-    if (IntegerSize > Size) {
-        return STATUS_BUFFER_TOO_SMALL;
-    }
-
-    DataIndex = IntegerSize - 1;
+    DataIndex = Size;
     for (Index = 0; Index < Value->Size; Index += 1) {
+        Component = Value->Components[Index];
         for (ByteIndex = 0;
              ByteIndex < sizeof(BIG_INTEGER_COMPONENT);
              ByteIndex += 1) {
 
-            Mask = 0xFF << (ByteIndex * BITS_PER_BYTE);
-            Byte = (Value->Components[Index] & Mask) >>
-                   (ByteIndex * BITS_PER_BYTE);
+            //
+            // Running out of buffer is only a problem if there are more
+            // significant bits left.
+            //
+
+            if (DataIndex == 0) {
+                if (Component != 0) {
+                    return STATUS_BUFFER_TOO_SMALL;
+                }
+
+                break;
+            }
 
-            DataBytes[DataIndex] = Byte;
             DataIndex -= 1;
+            DataBytes[DataIndex] = (UCHAR)Component;
+            Component >>= BITS_PER_BYTE;
         }
     }
 
+    RtlZeroMemory(DataBytes, DataIndex);
     CypBiReleaseReference(Context, Value);
     return STATUS_SUCCESS;
 }
@@ -1029,10 +1216,10 @@ Return Value:
     FieldSize = BIG_INTEGER_COMPONENT_BITS / 4;
     Index = Value->Size - 1;
     Components = Value->Components;
-    RtlDebugPrint("%x", Components[Index]);
+    RtlDebugPrint("%llx", (ULONGLONG)(Components[Index]));
     while (Index > 0) {
-        RtlDebugPrint("%0*llx", FieldSize, (ULONGLONG)(Components[Index]));
         Index -= 1;
+        RtlDebugPrint("%0*llx", FieldSize, (ULONGLONG)(Components[Index]));
     }
 
     return;
@@ -1397,6 +1584,12 @@ Return Value:
 
 {
 
+    if ((Left->Size == Right->Size) &&
+        (Left->Size >= BIG_INTEGER_KARATSUBA_THRESHOLD)) {
+
+        return CypBiMultiplyKaratsuba(Context, Left, Right);
+    }
+
     return CypBiMultiplyStandard(Context, Left, Right, 0, 0);
 }
 
@@ -1491,8 +1684,8 @@ Return Value:
     }
 
     CypBiTrim(Denominator);
-    Last = BIG_INTEGER_RADIX /
-           (Denominator->Components[Denominator->Size - 1] + 1);
+    Last = CypBiGetNormalizationFactor(
+                               Denominator->Components[Denominator->Size - 1]);
 
     if (Last > 1) {
         Numerator = CypBiMultiplyComponent(Context, Numerator, Last);
@@ -1530,25 +1723,21 @@ Return Value:
 
         LastWorking = Working->Components[Working->Size - 1];
         LastDenominator = Denominator->Components[Denominator->Size - 1];
-        if (LastWorking == LastDenominator) {
+        if (LastWorking >= LastDenominator) {
             QPrime = BIG_INTEGER_RADIX - 1;
 
         } else {
             SecondLastWorking = Working->Components[Working->Size - 2];
-            QPrime = (((BIG_INTEGER_LONG_COMPONENT)LastWorking *
-                       BIG_INTEGER_RADIX) +
-                      SecondLastWorking) / LastDenominator;
+            QPrime = CypBiDivideLongComponent(LastWorking,
+                                              SecondLastWorking,
+                                              LastDenominator,
+                                              &Inner);
 
             if (Denominator->Size > 1) {
                 SecondLastDenominator =
                                 Denominator->Components[Denominator->Size - 2];
 
                 if (SecondLastDenominator != 0) {
-                    Inner = (BIG_INTEGER_RADIX * LastWorking) +
-                            SecondLastWorking -
-                            ((BIG_INTEGER_LONG_COMPONENT)QPrime *
-                             LastDenominator);
-
                     if (((BIG_INTEGER_LONG_COMPONENT)SecondLastDenominator *
                          QPrime) >
                         (((BIG_INTEGER_LONG_COMPONENT)Inner *
@@ -2035,22 +2224,21 @@ Return Value:
 {
 
     INTN Index;
+    BIG_INTEGER_COMPONENT Remainder;
     PBIG_INTEGER Result;
-    BIG_INTEGER_LONG_COMPONENT ResultComponent;
 
     ASSERT(Numerator->Size != 0);
 
     Result = Numerator;
-    ResultComponent = 0;
+    Remainder = 0;
     Index = Numerator->Size - 1;
     do {
-        ResultComponent = (ResultComponent << BIG_INTEGER_COMPONENT_BITS) +
-                          Numerator->Components[Index];
-
         Result->Components[Index] =
-                        (BIG_INTEGER_COMPONENT)(ResultComponent / Denominator);
+                      CypBiDivideLongComponent(Remainder,
+                                               Numerator->Components[Index],
+                                               Denominator,
+                                               &Remainder);
 
-        ResultComponent = ResultComponent % Denominator;
         Index -= 1;
 
     } while (Index >= 0);
@@ -2217,7 +2405,7 @@ Return Value:
         Mask >>= 1;
         Index -= 1;
 
-    } while (Index != 0);
+    } while (Mask != 0);
 
     return -1;
 }
@@ -2260,7 +2448,8 @@ Return Value:
     ASSERT(ComponentIndex < Value->Size);
 
     Component = Value->Components[ComponentIndex];
-    Mask = 1 << (BitIndex % BIG_INTEGER_COMPONENT_BITS);
+    Mask = (BIG_INTEGER_COMPONENT)1 <<
+           (BitIndex % BIG_INTEGER_COMPONENT_BITS);
     if ((Component & Mask) != 0) {
         return TRUE;
     }
@@ -2510,6 +2699,1122 @@ Return Value:
     return Status;
 }
 
+PBIG_INTEGER
+CypBiExponentiateMontgomery (
+    PBIG_INTEGER_CONTEXT Context,
+    PBIG_INTEGER Value,
+    PBIG_INTEGER Exponent
+    )
+
+/*++
+
+Routine Description:
+
+    This routine performs exponentiation modulo an odd value using Montgomery
+    multiplication and a fixed window. The sequence of operations and the
+    memory touched depend only on the sizes of the operands, not on the bits
+    of the exponent, so private key operations do not leak the exponent
+    through their timing.
+
+Arguments:
+
+    Context - Supplies a pointer to the big integer context.
+
+    Value - Supplies a pointer to the value to reduce. A reference on this
+        value will be released on success.
+
+    Exponent - Supplies the exponent to raise the value to. A reference on this
+        value will be released on success.
+
+Return Value:
+
+    Returns a pointer to the exponentiated value on success.
+
+    NULL on allocation failure.
+
+--*/
+
+{
+
+    PBIG_INTEGER_COMPONENT Accumulator;
+    UINTN AllocationSize;
+    PBIG_INTEGER Base;
+    INTN BitCount;
+    UINTN BitIndex;
+    PBIG_INTEGER_COMPONENT Buffer;
+    UINTN ComponentIndex;
+    UINTN Index;
+    BIG_INTEGER_COMPONENT Inverse;
+    PBIG_INTEGER Modulus;
+    PBIG_INTEGER NewValue;
+    PBIG_INTEGER Result;
+    PBIG_INTEGER RSquared;
+    PBIG_INTEGER_COMPONENT Selected;
+    UINTN Size;
+    PBIG_INTEGER_COMPONENT Table;
+    UINTN TableSize;
+    UINTN Window;
+    UINTN WindowCount;
+    INTN WindowIndex;
+    UINTN WindowSize;
+    PBIG_INTEGER_COMPONENT Workspace;
+
+    AllocationSize = 0;
+    Buffer = NULL;
+    Result = NULL;
+    Modulus = Context->Modulus[Context->ModOffset];
+    RSquared = Context->MontgomeryRSquared[Context->ModOffset];
+    Inverse = Context->MontgomeryInverse[Context->ModOffset];
+    Size = Modulus->Size;
+
+    //
+    // Reduce a copy of the base if it's not already less than the modulus.
+    // The caller's value cannot be reduced in place, as the Chinese Remainder
+    // Theorem exponentiates the same value against both primes.
+    //
+
+    Base = CypBiClone(Context, Value);
+    if (Base == NULL) {
+        goto BiExponentiateMontgomeryEnd;
+    }
+
+    if (CypBiCompare(Base, Modulus) >= 0) {
+        NewValue = CypBiModulo(Context, Base);
+        if (NewValue == NULL) {
+            Base = NULL;
+            goto BiExponentiateMontgomeryEnd;
+        }
+
+        Base = NewValue;
+    }
+
+    //
+    // Pick the window size that minimizes the number of multiplies, counting
+    // both the table setup and one multiply per window.
+    //
+
+    BitCount = CypBiFindLeadingBit(Exponent) + 1;
+    if (BitCount <= 0) {
+        BitCount = 1;
+    }
+
+    WindowSize = 1;
+    while ((WindowSize < BIG_INTEGER_MAX_WINDOW_SIZE) &&
+           (((BitCount / (WindowSize + 1)) + (1 << (WindowSize + 1))) <
+            ((BitCount / WindowSize) + (1 << WindowSize)))) {
+
+        WindowSize += 1;
+    }
+
+    TableSize = 1 << WindowSize;
+    WindowCount = (BitCount + WindowSize - 1) / WindowSize;
+
+    //
+    // Carve a single allocation up into the table of powers, the accumulator,
+    // the selected table entry, and the workspace for the multiplies.
+    //
+
+    AllocationSize = ((TableSize + 4) * Size) +
+                     CypBiGetKaratsubaScratchSize(Size);
+
+    AllocationSize *= sizeof(BIG_INTEGER_COMPONENT);
+    Buffer = Context->AllocateMemory(AllocationSize);
+    if (Buffer == NULL) {
+        goto BiExponentiateMontgomeryEnd;
+    }
+
+    Table = Buffer;
+    Accumulator = Table + (TableSize * Size);
+    Selected = Accumulator + Size;
+    Workspace = Selected + Size;
+
+    //
+    // The first table entry is one in Montgomery form, which is the Montgomery
+    // reduction of R^2. The second is the base in Montgomery form, and the
+    // rest are successive powers of it.
+    //
+
+    RtlZeroMemory(Workspace, (Size * 2) * sizeof(BIG_INTEGER_COMPONENT));
+    RtlCopyMemory(Workspace,
+                  RSquared->Components,
+                  RSquared->Size * sizeof(BIG_INTEGER_COMPONENT));
+
+    CypBiMontgomeryReduce(Table, Workspace, Modulus, Inverse);
+    RtlZeroMemory(Accumulator, Size * sizeof(BIG_INTEGER_COMPONENT));
+    RtlCopyMemory(Accumulator,
+                  RSquared->Components,
+                  RSquared->Size * sizeof(BIG_INTEGER_COMPONENT));
+
+    RtlZeroMemory(Selected, Size * sizeof(BIG_INTEGER_COMPONENT));
+    RtlCopyMemory(Selected,
+                  Base->Components,
+                  Base->Size * sizeof(BIG_INTEGER_COMPONENT));
+
+    CypBiMontgomeryMultiply(Table + Size,
+                            Selected,
+                            Accumulator,
+                            Modulus,
+                            Inverse,
+                            Workspace);
+
+    for (Index = 2; Index < TableSize; Index += 1) {
+        CypBiMontgomeryMultiply(Table + (Index * Size),
+                                Table + ((Index - 1) * Size),
+                                Table + Size,
+                                Modulus,
+                                Inverse,
+                                Workspace);
+    }
+
+    //
+    // Run through the exponent a window at a time from the top, squaring
+    // once per bit and then multiplying in the table entry for the window.
+    // The entry is fetched by reading the whole table, and the multiply
+    // happens even for an all-zero window.
+    //
+
+    RtlCopyMemory(Accumulator, Table, Size * sizeof(BIG_INTEGER_COMPONENT));
+    for (WindowIndex = WindowCount - 1; WindowIndex >= 0; WindowIndex -= 1) {
+        Window = 0;
+        for (Index = 0; Index < WindowSize; Index += 1) {
+            CypBiMontgomeryMultiply(Accumulator,
+                                    Accumulator,
+                                    Accumulator,
+                                    Modulus,
+                                    Inverse,
+                                    Workspace);
+
+            BitIndex = (WindowIndex * WindowSize) + Index;
+            ComponentIndex = BitIndex / BIG_INTEGER_COMPONENT_BITS;
+            if (ComponentIndex < Exponent->Size) {
+                Window |= ((Exponent->Components[ComponentIndex] >>
+                            (BitIndex % BIG_INTEGER_COMPONENT_BITS)) & 0x1) <<
+                          Index;
+            }
+        }
+
+        CypBiSelectComponents(Selected, Table, TableSize, Size, Window);
+        CypBiMontgomeryMultiply(Accumulator,
+                                Accumulator,
+                                Selected,
+                                Modulus,
+                                Inverse,
+                                Workspace);
+    }
+
+    //
+    // Convert out of Montgomery form by reducing once more.
+    //
+
+    RtlZeroMemory(Workspace, (Size * 2) * sizeof(BIG_INTEGER_COMPONENT));
+    RtlCopyMemory(Workspace, Accumulator, Size * sizeof(BIG_INTEGER_COMPONENT));
+    CypBiMontgomeryReduce(Selected, Workspace, Modulus, Inverse);
+    Result = CypBiCreate(Context, Size);
+    if (Result == NULL) {
+        goto BiExponentiateMontgomeryEnd;
+    }
+
+    RtlCopyMemory(Result->Components,
+                  Selected,
+                  Size * sizeof(BIG_INTEGER_COMPONENT));
+
+    CypBiTrim(Result);
+    CypBiReleaseReference(Context, Value);
+    CypBiReleaseReference(Context, Exponent);
+
+BiExponentiateMontgomeryEnd:
+    if (Buffer != NULL) {
+        RtlZeroMemory(Buffer, AllocationSize);
+        Context->FreeMemory(Buffer);
+    }
+
+    if (Base != NULL) {
+        CypBiReleaseReference(Context, Base);
+    }
+
+    return Result;
+}
+
+VOID
+CypBiMontgomeryMultiply (
+    PBIG_INTEGER_COMPONENT Result,
+    PBIG_INTEGER_COMPONENT Left,
+    PBIG_INTEGER_COMPONENT Right,
+    PBIG_INTEGER Modulus,
+    BIG_INTEGER_COMPONENT Inverse,
+    PBIG_INTEGER_COMPONENT Workspace
+    )
+
+/*++
+
+Routine Description:
+
+    This routine multiplies two values in Montgomery form, returning
+    Left * Right / R modulo the modulus.
+
+Arguments:
+
+    Result - Supplies a pointer where the product will be returned. This may
+        be the same as either of the inputs.
+
+    Left - Supplies a pointer to the first value, which is the size of the
+        modulus and less than it.
+
+    Right - Supplies a pointer to the second value, which is the size of the
+        modulus and less than it. Passing the same pointer as the left value
+        squares it.
+
+    Modulus - Supplies a pointer to the odd modulus.
+
+    Inverse - Supplies the negative inverse of the low component of the
+        modulus, modulo the radix.
+
+    Workspace - Supplies a pointer to scratch space, which must be twice the
+        size of the modulus plus the Karatsuba scratch size.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UINTN Size;
+
+    Size = Modulus->Size;
+    CypBiMultiplyComponents(Workspace,
+                            Left,
+                            Right,
+                            Size,
+                            Workspace + (Size * 2));
+
+    CypBiMontgomeryReduce(Result, Workspace, Modulus, Inverse);
+    return;
+}
+
+VOID
+CypBiMontgomeryReduce (
+    PBIG_INTEGER_COMPONENT Result,
+    PBIG_INTEGER_COMPONENT Product,
+    PBIG_INTEGER Modulus,
+    BIG_INTEGER_COMPONENT Inverse
+    )
+
+/*++
+
+Routine Description:
+
+    This routine performs a Montgomery reduction, returning Product / R
+    modulo the modulus.
+
+Arguments:
+
+    Result - Supplies a pointer where the reduced value will be returned. This
+        is the size of the modulus.
+
+    Product - Supplies a pointer to the value to reduce, which is twice the
+        size of the modulus and less than the modulus times R. This buffer is
+        clobbered.
+
+    Modulus - Supplies a pointer to the odd modulus.
+
+    Inverse - Supplies the negative inverse of the low component of the
+        modulus, modulo the radix.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    BIG_INTEGER_COMPONENT Borrow;
+    BIG_INTEGER_COMPONENT Carry;
+    BIG_INTEGER_COMPONENT Factor;
+    UINTN Index;
+    UINTN InnerIndex;
+    BIG_INTEGER_COMPONENT Mask;
+    PBIG_INTEGER_COMPONENT ModulusComponents;
+    UINTN Size;
+    BIG_INTEGER_LONG_COMPONENT Sum;
+    BIG_INTEGER_COMPONENT TopCarry;
+
+    ModulusComponents = Modulus->Components;
+    Size = Modulus->Size;
+    TopCarry = 0;
+
+    //
+    // Add multiples of the modulus to zero out the low components one at a
+    // time. The carry out of the top of each pass is saved and folded into
+    // the next.
+    //
+
+    for (Index = 0; Index < Size; Index += 1) {
+        Factor = Product[Index] * Inverse;
+        Carry = 0;
+        for (InnerIndex = 0; InnerIndex < Size; InnerIndex += 1) {
+            Sum = ((BIG_INTEGER_LONG_COMPONENT)Factor *
+                   ModulusComponents[InnerIndex]) +
+                  Product[Index + InnerIndex] + Carry;
+
+            Product[Index + InnerIndex] = (BIG_INTEGER_COMPONENT)Sum;
+            Carry = (BIG_INTEGER_COMPONENT)(Sum >> BIG_INTEGER_COMPONENT_BITS);
+        }
+
+        Sum = (BIG_INTEGER_LONG_COMPONENT)Product[Index + Size] + Carry +
+              TopCarry;
+
+        Product[Index + Size] = (BIG_INTEGER_COMPONENT)Sum;
+        TopCarry = (BIG_INTEGER_COMPONENT)(Sum >> BIG_INTEGER_COMPONENT_BITS);
+    }
+
+    //
+    // The upper half is now less than twice the modulus. Subtract the modulus
+    // and keep the original only if that went negative without there being a
+    // carry out the top, choosing between them without branching.
+    //
+
+    Borrow = CypBiSubtractComponents(Result,
+                                     Product + Size,
+                                     Size,
+                                     ModulusComponents,
+                                     Size);
+
+    Mask = 0 - (Borrow & (TopCarry ^ 0x1));
+    for (Index = 0; Index < Size; Index += 1) {
+        Result[Index] = (Result[Index] & ~Mask) |
+                        (Product[Index + Size] & Mask);
+    }
+
+    return;
+}
+
+VOID
+CypBiSelectComponents (
+    PBIG_INTEGER_COMPONENT Result,
+    PBIG_INTEGER_COMPONENT Table,
+    UINTN TableSize,
+    UINTN Count,
+    UINTN Index
+    )
+
+/*++
+
+Routine Description:
+
+    This routine copies one entry out of a table of values without the
+    memory access pattern depending on which entry was chosen.
+
+Arguments:
+
+    Result - Supplies a pointer where the selected entry will be returned.
+
+    Table - Supplies a pointer to the table of entries, stored back to back.
+
+    TableSize - Supplies the number of entries in the table.
+
+    Count - Supplies the number of components in each entry.
+
+    Index - Supplies the index of the entry to select.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UINTN ComponentIndex;
+    UINTN Entry;
+    BIG_INTEGER_COMPONENT Mask;
+
+    RtlZeroMemory(Result, Count * sizeof(BIG_INTEGER_COMPONENT));
+    for (Entry = 0; Entry < TableSize; Entry += 1) {
+
+        //
+        // The mask is all ones if the entry matches and zero otherwise.
+        //
+
+        Mask = (BIG_INTEGER_COMPONENT)(Entry ^ Index);
+        Mask = 0 - ((Mask - 1) >> (BIG_INTEGER_COMPONENT_BITS - 1));
+        for (ComponentIndex = 0; ComponentIndex < Count; ComponentIndex += 1) {
+            Result[ComponentIndex] |= *Table & Mask;
+            Table += 1;
+        }
+    }
+
+    return;
+}
+
+PBIG_INTEGER
+CypBiMultiplyKaratsuba (
+    PBIG_INTEGER_CONTEXT Context,
+    PBIG_INTEGER Left,
+    PBIG_INTEGER Right
+    )
+
+/*++
+
+Routine Description:
+
+    This routine multiplies two big integers of the same size together using
+    the Karatsuba method.
+
+Arguments:
+
+    Context - Supplies a pointer to the big integer context.
+
+    Left - Supplies the value to multiply. A reference on this value will be
+        released on success.
+
+    Right - Supplies the value to multiply by. A reference on this value will be
+        released on success.
+
+Return Value:
+
+    Returns a pointer to the new product.
+
+    NULL on allocation failure.
+
+--*/
+
+{
+
+    UINTN Count;
+    PBIG_INTEGER Result;
+    PBIG_INTEGER_COMPONENT Scratch;
+
+    ASSERT(Left->Size == Right->Size);
+
+    Count = Left->Size;
+    Scratch = Context->AllocateMemory(
+                  CypBiGetKaratsubaScratchSize(Count) *
+                  sizeof(BIG_INTEGER_COMPONENT));
+
+    if (Scratch == NULL) {
+        return NULL;
+    }
+
+    Result = CypBiCreate(Context, Count * 2);
+    if (Result != NULL) {
+        CypBiMultiplyComponents(Result->Components,
+                                Left->Components,
+                                Right->Components,
+                                Count,
+                                Scratch);
+
+        CypBiReleaseReference(Context, Left);
+        CypBiReleaseReference(Context, Right);
+        CypBiTrim(Result);
+    }
+
+    Context->FreeMemory(Scratch);
+    return Result;
+}
+
+VOID
+CypBiMultiplyComponents (
+    PBIG_INTEGER_COMPONENT Result,
+    PBIG_INTEGER_COMPONENT Left,
+    PBIG_INTEGER_COMPONENT Right,
+    UINTN Count,
+    PBIG_INTEGER_COMPONENT Scratch
+    )
+
+/*++
+
+Routine Description:
+
+    This routine multiplies two arrays of components together, splitting large
+    operands in half and recursing with Karatsuba's method, which replaces
+    one of the four half-sized multiplies with a few additions.
+
+Arguments:
+
+    Result - Supplies a pointer where the product will be returned. This is
+        twice the given count, and must not overlap either input.
+
+    Left - Supplies a pointer to the first value.
+
+    Right - Supplies a pointer to the second value. Passing the same pointer
+        as the left value squares it.
+
+    Count - Supplies the number of components in each value.
+
+    Scratch - Supplies a pointer to scratch space, which must be at least the
+        size returned by the Karatsuba scratch size routine for this count.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UINTN HighCount;
+    PBIG_INTEGER_COMPONENT LeftSum;
+    UINTN LowCount;
+    PBIG_INTEGER_COMPONENT Middle;
+    PBIG_INTEGER_COMPONENT NextScratch;
+    PBIG_INTEGER_COMPONENT RightSum;
+
+    if (Count < BIG_INTEGER_KARATSUBA_THRESHOLD) {
+        if (Left == Right) {
+            CypBiSquareSchoolbook(Result, Left, Count);
+
+        } else {
+            CypBiMultiplySchoolbook(Result, Left, Right, Count);
+        }
+
+        return;
+    }
+
+    LowCount = Count / 2;
+    HighCount = Count - LowCount;
+    LeftSum = Scratch;
+    RightSum = LeftSum + HighCount + 1;
+    Middle = RightSum + HighCount + 1;
+    NextScratch = Middle + ((HighCount + 1) * 2);
+
+    //
+    // Compute the product of the low halves and the product of the high halves
+    // directly into the result.
+    //
+
+    CypBiMultiplyComponents(Result, Left, Right, LowCount, NextScratch);
+    CypBiMultiplyComponents(Result + (LowCount * 2),
+                            Left + LowCount,
+                            Right + LowCount,
+                            HighCount,
+                            NextScratch);
+
+    //
+    // Multiply the sums of the halves, and subtract off the two products above
+    // to get the middle term.
+    //
+
+    LeftSum[HighCount] = CypBiAddComponents(LeftSum,
+                                            Left + LowCount,
+                                            HighCount,
+                                            Left,
+                                            LowCount);
+
+    if (Left == Right) {
+        RightSum = LeftSum;
+
+    } else {
+        RightSum[HighCount] = CypBiAddComponents(RightSum,
+                                                 Right + LowCount,
+                                                 HighCount,
+                                                 Right,
+                                                 LowCount);
+    }
+
+    CypBiMultiplyComponents(Middle,
+                            LeftSum,
+                            RightSum,
+                            HighCount + 1,
+                            NextScratch);
+
+    CypBiSubtractComponents(Middle,
+                            Middle,
+                            (HighCount + 1) * 2,
+                            Result,
+                            LowCount * 2);
+
+    CypBiSubtractComponents(Middle,
+                            Middle,
+                            (HighCount + 1) * 2,
+                            Result + (LowCount * 2),
+                            HighCount * 2);
+
+    //
+    // Add the middle term in, shifted up by half.
+    //
+
+    CypBiAddComponents(Result + LowCount,
+                       Result + LowCount,
+                       (Count * 2) - LowCount,
+                       Middle,
+                       (HighCount + 1) * 2);
+
+    return;
+}
+
+VOID
+CypBiMultiplySchoolbook (
+    PBIG_INTEGER_COMPONENT Result,
+    PBIG_INTEGER_COMPONENT Left,
+    PBIG_INTEGER_COMPONENT Right,
+    UINTN Count
+    )
+
+/*++
+
+Routine Description:
+
+    This routine multiplies two arrays of components together using the
+    standard method.
+
+Arguments:
+
+    Result - Supplies a pointer where the product will be returned. This is
+        twice the given count, and must not overlap either input.
+
+    Left - Supplies a pointer to the first value.
+
+    Right - Supplies a pointer to the second value.
+
+    Count - Supplies the number of components in each value.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    BIG_INTEGER_COMPONENT Carry;
+    UINTN LeftIndex;
+    BIG_INTEGER_LONG_COMPONENT Product;
+    BIG_INTEGER_COMPONENT RightComponent;
+    UINTN RightIndex;
+
+    RtlZeroMemory(Result, Count * sizeof(BIG_INTEGER_COMPONENT));
+    for (RightIndex = 0; RightIndex < Count; RightIndex += 1) {
+        Carry = 0;
+        RightComponent = Right[RightIndex];
+        for (LeftIndex = 0; LeftIndex < Count; LeftIndex += 1) {
+            Product = ((BIG_INTEGER_LONG_COMPONENT)Left[LeftIndex] *
+                       RightComponent) +
+                      Result[LeftIndex + RightIndex] + Carry;
+
+            Result[LeftIndex + RightIndex] = (BIG_INTEGER_COMPONENT)Product;
+            Carry = (BIG_INTEGER_COMPONENT)
+                    (Product >> BIG_INTEGER_COMPONENT_BITS);
+        }
+
+        Result[RightIndex + Count] = Carry;
+    }
+
+    return;
+}
+
+VOID
+CypBiSquareSchoolbook (
+    PBIG_INTEGER_COMPONENT Result,
+    PBIG_INTEGER_COMPONENT Value,
+    UINTN Count
+    )
+
+/*++
+
+Routine Description:
+
+    This routine squares an array of components, computing each cross product
+    only once and doubling the sum of them.
+
+Arguments:
+
+    Result - Supplies a pointer where the square will be returned. This is
+        twice the given count, and must not overlap the input.
+
+    Value - Supplies a pointer to the value to square.
+
+    Count - Supplies the number of components in the value.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    BIG_INTEGER_COMPONENT Carry;
+    UINTN Index;
+    UINTN InnerIndex;
+    BIG_INTEGER_COMPONENT NextCarry;
+    BIG_INTEGER_LONG_COMPONENT Product;
+
+    //
+    // Sum the products of each pair of distinct components.
+    //
+
+    RtlZeroMemory(Result, Count * sizeof(BIG_INTEGER_COMPONENT));
+    for (Index = 0; Index < Count; Index += 1) {
+        Carry = 0;
+        for (InnerIndex = Index + 1; InnerIndex < Count; InnerIndex += 1) {
+            Product = ((BIG_INTEGER_LONG_COMPONENT)Value[Index] *
+                       Value[InnerIndex]) +
+                      Result[Index + InnerIndex] + Carry;
+
+            Result[Index + InnerIndex] = (BIG_INTEGER_COMPONENT)Product;
+            Carry = (BIG_INTEGER_COMPONENT)
+                    (Product >> BIG_INTEGER_COMPONENT_BITS);
+        }
+
+        Result[Index + Count] = Carry;
+    }
+
+    //
+    // Double the cross products, since each appears twice in the square.
+    //
+
+    Carry = 0;
+    for (Index = 0; Index < Count * 2; Index += 1) {
+        NextCarry = Result[Index] >> (BIG_INTEGER_COMPONENT_BITS - 1);
+        Result[Index] = (Result[Index] << 1) | Carry;
+        Carry = NextCarry;
+    }
+
+    //
+    // Add in the squares of each component.
+    //
+
+    Carry = 0;
+    for (Index = 0; Index < Count; Index += 1) {
+        Product = ((BIG_INTEGER_LONG_COMPONENT)Value[Index] * Value[Index]) +
+                  Result[Index * 2] + Carry;
+
+        Result[Index * 2] = (BIG_INTEGER_COMPONENT)Product;
+        Product = (BIG_INTEGER_LONG_COMPONENT)Result[(Index * 2) + 1] +
+                  (Product >> BIG_INTEGER_COMPONENT_BITS);
+
+        Result[(Index * 2) + 1] = (BIG_INTEGER_COMPONENT)Product;
+        Carry = (BIG_INTEGER_COMPONENT)(Product >> BIG_INTEGER_COMPONENT_BITS);
+    }
+
+    return;
+}
+
+BIG_INTEGER_COMPONENT
+CypBiAddComponents (
+    PBIG_INTEGER_COMPONENT Result,
+    PBIG_INTEGER_COMPONENT Left,
+    UINTN LeftCount,
+    PBIG_INTEGER_COMPONENT Right,
+    UINTN RightCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine adds two arrays of components.
+
+Arguments:
+
+    Result - Supplies a pointer where the sum will be returned. This is the
+        size of the left value, and may be the same as the left value.
+
+    Left - Supplies a pointer to the first value.
+
+    LeftCount - Supplies the number of components in the left value.
+
+    Right - Supplies a pointer to the second value.
+
+    RightCount - Supplies the number of components in the right value, which
+        must not be greater than the left count.
+
+Return Value:
+
+    Returns the carry out of the top of the sum.
+
+--*/
+
+{
+
+    BIG_INTEGER_COMPONENT Carry;
+    UINTN Index;
+    BIG_INTEGER_LONG_COMPONENT Sum;
+
+    ASSERT(RightCount <= LeftCount);
+
+    Carry = 0;
+    for (Index = 0; Index < RightCount; Index += 1) {
+        Sum = (BIG_INTEGER_LONG_COMPONENT)Left[Index] + Right[Index] + Carry;
+        Result[Index] = (BIG_INTEGER_COMPONENT)Sum;
+        Carry = (BIG_INTEGER_COMPONENT)(Sum >> BIG_INTEGER_COMPONENT_BITS);
+    }
+
+    while (Index < LeftCount) {
+        Sum = (BIG_INTEGER_LONG_COMPONENT)Left[Index] + Carry;
+        Result[Index] = (BIG_INTEGER_COMPONENT)Sum;
+        Carry = (BIG_INTEGER_COMPONENT)(Sum >> BIG_INTEGER_COMPONENT_BITS);
+        Index += 1;
+    }
+
+    return Carry;
+}
+
+BIG_INTEGER_COMPONENT
+CypBiSubtractComponents (
+    PBIG_INTEGER_COMPONENT Result,
+    PBIG_INTEGER_COMPONENT Left,
+    UINTN LeftCount,
+    PBIG_INTEGER_COMPONENT Right,
+    UINTN RightCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine subtracts one array of components from another.
+
+Arguments:
+
+    Result - Supplies a pointer where the difference will be returned. This is
+        the size of the left value, and may be the same as the left value.
+
+    Left - Supplies a pointer to the value to subtract from.
+
+    LeftCount - Supplies the number of components in the left value.
+
+    Right - Supplies a pointer to the value to subtract.
+
+    RightCount - Supplies the number of components in the right value, which
+        must not be greater than the left count.
+
+Return Value:
+
+    Returns 1 if the subtraction borrowed out of the top, or 0 otherwise.
+
+--*/
+
+{
+
+    BIG_INTEGER_COMPONENT Borrow;
+    BIG_INTEGER_LONG_COMPONENT Difference;
+    UINTN Index;
+
+    ASSERT(RightCount <= LeftCount);
+
+    Borrow = 0;
+    for (Index = 0; Index < RightCount; Index += 1) {
+        Difference = (BIG_INTEGER_LONG_COMPONENT)Left[Index] - Right[Index] -
+                     Borrow;
+
+        Result[Index] = (BIG_INTEGER_COMPONENT)Difference;
+        Borrow = (BIG_INTEGER_COMPONENT)
+                 (Difference >> BIG_INTEGER_COMPONENT_BITS) & 0x1;
+    }
+
+    while (Index < LeftCount) {
+        Difference = (BIG_INTEGER_LONG_COMPONENT)Left[Index] - Borrow;
+        Result[Index] = (BIG_INTEGER_COMPONENT)Difference;
+        Borrow = (BIG_INTEGER_COMPONENT)
+                 (Difference >> BIG_INTEGER_COMPONENT_BITS) & 0x1;
+
+        Index += 1;
+    }
+
+    return Borrow;
+}
+
+UINTN
+CypBiGetKaratsubaScratchSize (
+    UINTN Count
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines how much scratch space a Karatsuba multiply needs.
+
+Arguments:
+
+    Count - Supplies the number of components in each value to multiply.
+
+Return Value:
+
+    Returns the number of components of scratch space needed.
+
+--*/
+
+{
+
+    UINTN HighCount;
+    UINTN Size;
+
+    //
+    // Each level needs the two sums of the halves and their product. The
+    // deepest recursion is always on the sums, which are one component larger
+    // than the high half.
+    //
+
+    Size = 0;
+    while (Count >= BIG_INTEGER_KARATSUBA_THRESHOLD) {
+        HighCount = Count - (Count / 2);
+        Size += (HighCount + 1) * 4;
+        Count = HighCount + 1;
+    }
+
+    return Size;
+}
+
+BIG_INTEGER_COMPONENT
+CypBiGetNormalizationFactor (
+    BIG_INTEGER_COMPONENT Value
+    )
+
+/*++
+
+Routine Description:
+
+    This routine computes the factor to multiply a divisor by so that its most
+    significant component is as large as possible, which is the radix divided
+    by one more than that component.
+
+Arguments:
+
+    Value - Supplies the most significant component of the divisor, which must
+        not be zero.
+
+Return Value:
+
+    Returns the normalization factor.
+
+--*/
+
+{
+
+    ASSERT(Value != 0);
+
+    if (Value == (BIG_INTEGER_COMPONENT)(BIG_INTEGER_RADIX - 1)) {
+        return 1;
+    }
+
+    return CypBiDivideLongComponent(1, 0, Value + 1, NULL);
+}
+
+BIG_INTEGER_COMPONENT
+CypBiDivideLongComponent (
+    BIG_INTEGER_COMPONENT High,
+    BIG_INTEGER_COMPONENT Low,
+    BIG_INTEGER_COMPONENT Divisor,
+    PBIG_INTEGER_COMPONENT Remainder
+    )
+
+/*++
+
+Routine Description:
+
+    This routine divides a two component value by a single component.
+
+Arguments:
+
+    High - Supplies the high component of the dividend. This must be less than
+        the divisor so that the quotient fits in a component.
+
+    Low - Supplies the low component of the dividend.
+
+    Divisor - Supplies the value to divide by.
+
+    Remainder - Supplies an optional pointer where the remainder will be
+        returned.
+
+Return Value:
+
+    Returns the quotient.
+
+--*/
+
+{
+
+#if BIG_INTEGER_COMPONENT_SIZE == 8
+
+    ULONGLONG DivisorHigh;
+    ULONGLONG DivisorLow;
+    ULONGLONG Estimate;
+    ULONGLONG LowHigh;
+    ULONGLONG LowLow;
+    ULONGLONG Partial;
+    ULONGLONG QuotientHigh;
+    ULONGLONG QuotientLow;
+    INT Shift;
+
+    ASSERT(High < Divisor);
+
+    //
+    // Dividing a 128-bit value would require a compiler support routine,
+    // so perform long division in base 2^32 instead. Start by normalizing the
+    // divisor so that its top bit is set, which keeps each estimated quotient
+    // digit within two of the real one.
+    //
+
+    Shift = RtlCountLeadingZeros64(Divisor);
+    Divisor <<= Shift;
+    DivisorHigh = Divisor >> 32;
+    DivisorLow = Divisor & MAX_ULONG;
+    if (Shift != 0) {
+        High = (High << Shift) | (Low >> (64 - Shift));
+        Low <<= Shift;
+    }
+
+    LowHigh = Low >> 32;
+    LowLow = Low & MAX_ULONG;
+    QuotientHigh = High / DivisorHigh;
+    Estimate = High - (QuotientHigh * DivisorHigh);
+    while ((QuotientHigh > MAX_ULONG) ||
+           ((QuotientHigh * DivisorLow) > ((Estimate << 32) | LowHigh))) {
+
+        QuotientHigh -= 1;
+        Estimate += DivisorHigh;
+        if (Estimate > MAX_ULONG) {
+            break;
+        }
+    }
+
+    Partial = (High << 32) + LowHigh - (QuotientHigh * Divisor);
+    QuotientLow = Partial / DivisorHigh;
+    Estimate = Partial - (QuotientLow * DivisorHigh);
+    while ((QuotientLow > MAX_ULONG) ||
+           ((QuotientLow * DivisorLow) > ((Estimate << 32) | LowLow))) {
+
+        QuotientLow -= 1;
+        Estimate += DivisorHigh;
+        if (Estimate > MAX_ULONG) {
+            break;
+        }
+    }
+
+    if (Remainder != NULL) {
+        *Remainder = ((Partial << 32) + LowLow - (QuotientLow * Divisor)) >>
+                     Shift;
+    }
+
+    return (QuotientHigh << 32) | QuotientLow;
+
+#else
+
+    BIG_INTEGER_LONG_COMPONENT Dividend;
+    BIG_INTEGER_COMPONENT Quotient;
+
+    ASSERT(High < Divisor);
+
+    Dividend = ((BIG_INTEGER_LONG_COMPONENT)High <<
+                BIG_INTEGER_COMPONENT_BITS) | Low;
+
+    Quotient = Dividend / Divisor;
+    if (Remainder != NULL) {
+        *Remainder = Dividend - ((BIG_INTEGER_LONG_COMPONENT)Quotient *
+                                 Divisor);
+    }
+
+    return Quotient;
+
+#endif
+
+}
+
 PBIG_INTEGER
 CypBiClone (
     PBIG_INTEGER_CONTEXT Context,
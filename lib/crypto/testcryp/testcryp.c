@@ -47,6 +47,30 @@ Module Name:
 // ---------------------------------------------------------------- Definitions
 //
 
+//
+// Define the size of the buffer used to compare the hardware and software AES
+// paths. This is deliberately not a multiple of the hardware batch size.
+//
+
+#define TEST_AES_COMPARE_SIZE (AES_BLOCK_SIZE * 37)
+
+//
+// Define the buffer size and minimum run time for the throughput benchmark.
+//
+
+#define TEST_BENCHMARK_BUFFER_SIZE (1024 * 1024)
+#define TEST_BENCHMARK_SECONDS 1
+
+//
+// Define the algorithms the benchmark measures.
+//
+
+#define TEST_BENCHMARK_AES_CTR 0
+#define TEST_BENCHMARK_AES_CBC_DECRYPT 1
+#define TEST_BENCHMARK_SHA1 2
+#define TEST_BENCHMARK_SHA256 3
+#define TEST_BENCHMARK_COUNT 4
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -80,6 +104,45 @@ TestRsa (
     VOID
     );
 
+ULONG
+TestChaCha20 (
+    VOID
+    );
+
+ULONG
+TestAes (
+    VOID
+    );
+
+ULONG
+TestAesCompareModes (
+    AES_CIPHER_MODE Mode,
+    PUCHAR Key
+    );
+
+VOID
+TestCrypBenchmark (
+    VOID
+    );
+
+VOID
+TestCrypBenchmarkRun (
+    PSTR Name,
+    ULONG Algorithm,
+    PUCHAR Buffer,
+    UINTN Size
+    );
+
+VOID
+TestCrypBenchmarkRsa (
+    VOID
+    );
+
+KSTATUS
+TestCrypLoadRsaKey (
+    PRSA_CONTEXT RsaContext
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -371,6 +434,75 @@ PSTR TestCrypRsaPrivateKey =
 
 PSTR TestCrypRsaPrivateKeyPassword = "1234";
 
+//
+// Store the ChaCha20 test vectors from RFC 7539 sections 2.3.2 and 2.4.2. Both
+// use the key 00 01 02 ... 1F and an initial block counter of one.
+//
+
+UCHAR TestCrypChaCha20BlockNonce[CHACHA20_NONCE_SIZE] = {
+    0x00, 0x00, 0x00, 0x09, 0x00, 0x00, 0x00, 0x4A, 0x00, 0x00, 0x00, 0x00
+};
+
+UCHAR TestCrypChaCha20BlockAnswer[CHACHA20_BLOCK_SIZE] = {
+    0x10, 0xF1, 0xE7, 0xE4, 0xD1, 0x3B, 0x59, 0x15, 0x50, 0x0F,
+    0xDD, 0x1F, 0xA3, 0x20, 0x71, 0xC4, 0xC7, 0xD1, 0xF4, 0xC7,
+    0x33, 0xC0, 0x68, 0x03, 0x04, 0x22, 0xAA, 0x9A, 0xC3, 0xD4,
+    0x6C, 0x4E, 0xD2, 0x82, 0x64, 0x46, 0x07, 0x9F, 0xAA, 0x09,
+    0x14, 0xC2, 0xD7, 0x05, 0xD9, 0x8B, 0x02, 0xA2, 0xB5, 0x12,
+    0x9C, 0xD1, 0xDE, 0x16, 0x4E, 0xB9, 0xCB, 0xD0, 0x83, 0xE8,
+    0xA2, 0x50, 0x3C, 0x4E
+};
+
+UCHAR TestCrypChaCha20CipherNonce[CHACHA20_NONCE_SIZE] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x4A, 0x00, 0x00, 0x00, 0x00
+};
+
+PSTR TestCrypChaCha20Plaintext =
+    "Ladies and Gentlemen of the class of '99: If I could offer you only one "
+    "tip for the future, sunscreen would be it.";
+
+//
+// Store the AES known answers from FIPS-197 appendix C. The keys are the byte
+// sequence 00 01 02 03 ... for the key size.
+//
+
+UCHAR TestCrypAesPlaintext[AES_BLOCK_SIZE] = {
+    0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+    0x88, 0x99, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF
+};
+
+UCHAR TestCrypAes128Answer[AES_BLOCK_SIZE] = {
+    0x69, 0xC4, 0xE0, 0xD8, 0x6A, 0x7B, 0x04, 0x30,
+    0xD8, 0xCD, 0xB7, 0x80, 0x70, 0xB4, 0xC5, 0x5A
+};
+
+UCHAR TestCrypAes256Answer[AES_BLOCK_SIZE] = {
+    0x8E, 0xA2, 0xB7, 0xCA, 0x51, 0x67, 0x45, 0xBF,
+    0xEA, 0xFC, 0x49, 0x90, 0x4B, 0x49, 0x60, 0x89
+};
+
+PSTR TestCrypBenchmarkNames[TEST_BENCHMARK_COUNT] = {
+    "AES-128-CTR",
+    "AES-128-CBC decrypt",
+    "SHA-1",
+    "SHA-256"
+};
+
+UCHAR TestCrypChaCha20CipherAnswer[] = {
+    0x6E, 0x2E, 0x35, 0x9A, 0x25, 0x68, 0xF9, 0x80, 0x41, 0xBA,
+    0x07, 0x28, 0xDD, 0x0D, 0x69, 0x81, 0xE9, 0x7E, 0x7A, 0xEC,
+    0x1D, 0x43, 0x60, 0xC2, 0x0A, 0x27, 0xAF, 0xCC, 0xFD, 0x9F,
+    0xAE, 0x0B, 0xF9, 0x1B, 0x65, 0xC5, 0x52, 0x47, 0x33, 0xAB,
+    0x8F, 0x59, 0x3D, 0xAB, 0xCD, 0x62, 0xB3, 0x57, 0x16, 0x39,
+    0xD6, 0x24, 0xE6, 0x51, 0x52, 0xAB, 0x8F, 0x53, 0x0C, 0x35,
+    0x9F, 0x08, 0x61, 0xD8, 0x07, 0xCA, 0x0D, 0xBF, 0x50, 0x0D,
+    0x6A, 0x61, 0x56, 0xA3, 0x8E, 0x08, 0x8A, 0x22, 0xB6, 0x5E,
+    0x52, 0xBC, 0x51, 0x4D, 0x16, 0xCC, 0xF8, 0x06, 0x81, 0x8C,
+    0xE9, 0x1A, 0xB7, 0x79, 0x37, 0x36, 0x5A, 0xF9, 0x0B, 0xBF,
+    0x74, 0xA3, 0x5B, 0xE6, 0xB4, 0x0B, 0x8E, 0xED, 0xF2, 0x78,
+    0x5E, 0x42, 0x87, 0x4D
+};
+
 //
 // ------------------------------------------------------------------ Functions
 //
@@ -404,8 +536,14 @@ Return Value:
 
 {
 
+    ULONG Hardware;
     ULONG TestsFailed;
 
+    if ((ArgumentCount > 1) && (strcmp(Arguments[1], "-b") == 0)) {
+        TestCrypBenchmark();
+        return 0;
+    }
+
     srand(time(NULL));
     TestsFailed = 0;
     TestsFailed += TestSha1();
@@ -413,6 +551,22 @@ Return Value:
     TestsFailed += TestSha512();
     TestsFailed += TestMd5();
     TestsFailed += TestRsa();
+    TestsFailed += TestChaCha20();
+    TestsFailed += TestAes();
+
+    //
+    // If the processor's crypto instructions were used above, run the hashes
+    // again with the portable code.
+    //
+
+    Hardware = CyGetHardwareSupport();
+    if (Hardware != 0) {
+        CySetHardwareSupport(0);
+        TestsFailed += TestSha1();
+        TestsFailed += TestSha256();
+        CySetHardwareSupport(Hardware);
+    }
+
     if (TestsFailed != 0) {
         printf("\n*** %d failures in Crypto test. ***\n", TestsFailed);
         return 1;
@@ -730,28 +884,13 @@ Return Value:
     KSTATUS Status;
 
     Failures = 0;
-    RtlZeroMemory(&RsaContext, sizeof(RSA_CONTEXT));
-    RsaContext.BigIntegerContext.AllocateMemory = (PCY_ALLOCATE_MEMORY)malloc;
-    RsaContext.BigIntegerContext.ReallocateMemory =
-                                                (PCY_REALLOCATE_MEMORY)realloc;
-
-    RsaContext.BigIntegerContext.FreeMemory = (PCY_FREE_MEMORY)free;
-    Status = CyRsaInitializeContext(&RsaContext);
+    Status = TestCrypLoadRsaKey(&RsaContext);
     if (!KSUCCESS(Status)) {
         Failures += 1;
+        printf("Failed to load RSA key: %d\n", Status);
         return Failures;
     }
 
-    Status = CyRsaAddPemFile(&RsaContext,
-                             TestCrypRsaPrivateKey,
-                             RtlStringLength(TestCrypRsaPrivateKey) + 1,
-                             TestCrypRsaPrivateKeyPassword);
-
-    if (!KSUCCESS(Status)) {
-        Failures += 1;
-        goto TestRsaEnd;
-    }
-
     Size = CyRsaEncrypt(&RsaContext,
                         TestCrypSha512Answers[0],
                         SHA512_HASH_SIZE,
@@ -792,3 +931,643 @@ Return Value:
     return Failures;
 }
 
+ULONG
+TestChaCha20 (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine tests the ChaCha20 stream cipher.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns the number of test failures.
+
+--*/
+
+{
+
+    CHACHA20_CONTEXT Context;
+    ULONG Failures;
+    UINTN Index;
+    UCHAR Key[CHACHA20_KEY_SIZE];
+    UCHAR Output[sizeof(TestCrypChaCha20CipherAnswer)];
+    UINTN Size;
+
+    Failures = 0;
+    for (Index = 0; Index < CHACHA20_KEY_SIZE; Index += 1) {
+        Key[Index] = Index;
+    }
+
+    //
+    // Check a raw block of key stream.
+    //
+
+    CyChaCha20Initialize(&Context, Key, TestCrypChaCha20BlockNonce, 1);
+    CyChaCha20Crypt(&Context, NULL, Output, CHACHA20_BLOCK_SIZE);
+    if (memcmp(Output, TestCrypChaCha20BlockAnswer, CHACHA20_BLOCK_SIZE) != 0) {
+        printf("ChaCha20 block function failed.\n");
+        Failures += 1;
+    }
+
+    //
+    // Encrypt the plaintext in uneven pieces to exercise the handling of
+    // partial blocks.
+    //
+
+    Size = strlen(TestCrypChaCha20Plaintext);
+    if (Size != sizeof(TestCrypChaCha20CipherAnswer)) {
+        printf("ChaCha20 plaintext size mismatch.\n");
+        return Failures + 1;
+    }
+
+    CyChaCha20Initialize(&Context, Key, TestCrypChaCha20CipherNonce, 1);
+    CyChaCha20Crypt(&Context, (PUCHAR)TestCrypChaCha20Plaintext, Output, 10);
+    CyChaCha20Crypt(&Context,
+                    (PUCHAR)TestCrypChaCha20Plaintext + 10,
+                    Output + 10,
+                    70);
+
+    CyChaCha20Crypt(&Context,
+                    (PUCHAR)TestCrypChaCha20Plaintext + 80,
+                    Output + 80,
+                    Size - 80);
+
+    if (memcmp(Output, TestCrypChaCha20CipherAnswer, Size) != 0) {
+        printf("ChaCha20 encryption failed.\n");
+        Failures += 1;
+    }
+
+    //
+    // Decrypting in place should get the plaintext back.
+    //
+
+    CyChaCha20Initialize(&Context, Key, TestCrypChaCha20CipherNonce, 1);
+    CyChaCha20Crypt(&Context, Output, Output, Size);
+    if (memcmp(Output, TestCrypChaCha20Plaintext, Size) != 0) {
+        printf("ChaCha20 decryption failed.\n");
+        Failures += 1;
+    }
+
+    return Failures;
+}
+
+ULONG
+TestAes (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine tests the AES cipher, both against known answers and by
+    comparing the hardware accelerated paths (if any) with the portable ones.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns the number of test failures.
+
+--*/
+
+{
+
+    PUCHAR Answer;
+    AES_CONTEXT Context;
+    ULONG Failures;
+    ULONG Hardware;
+    ULONG Index;
+    UCHAR Key[AES_CBC256_KEY_SIZE];
+    AES_CIPHER_MODE Mode;
+    UCHAR Output[AES_BLOCK_SIZE];
+    ULONG Pass;
+
+    Failures = 0;
+    for (Index = 0; Index < sizeof(Key); Index += 1) {
+        Key[Index] = Index;
+    }
+
+    //
+    // Run the known answer tests once with whatever hardware support there is
+    // and once without.
+    //
+
+    Hardware = CyGetHardwareSupport();
+    for (Pass = 0; Pass < 2; Pass += 1) {
+        if (Pass != 0) {
+            CySetHardwareSupport(0);
+        }
+
+        for (Index = 0; Index < 2; Index += 1) {
+            if (Index == 0) {
+                Mode = AesModeEcb128;
+                Answer = TestCrypAes128Answer;
+
+            } else {
+                Mode = AesModeEcb256;
+                Answer = TestCrypAes256Answer;
+            }
+
+            CyAesInitialize(&Context, Mode, Key, NULL);
+            CyAesEcbEncrypt(&Context,
+                            TestCrypAesPlaintext,
+                            Output,
+                            AES_BLOCK_SIZE);
+
+            if (memcmp(Output, Answer, AES_BLOCK_SIZE) != 0) {
+                printf("AES mode %d encrypt failed (hardware 0x%x).\n",
+                       Mode,
+                       CyGetHardwareSupport());
+
+                Failures += 1;
+            }
+
+            CyAesConvertKeyForDecryption(&Context);
+            CyAesEcbDecrypt(&Context, Output, Output, AES_BLOCK_SIZE);
+            if (memcmp(Output, TestCrypAesPlaintext, AES_BLOCK_SIZE) != 0) {
+                printf("AES mode %d decrypt failed (hardware 0x%x).\n",
+                       Mode,
+                       CyGetHardwareSupport());
+
+                Failures += 1;
+            }
+        }
+    }
+
+    CySetHardwareSupport(Hardware);
+    if ((Hardware & CRYPTO_HARDWARE_AES) != 0) {
+        Failures += TestAesCompareModes(AesModeCbc128, Key);
+        Failures += TestAesCompareModes(AesModeCbc256, Key);
+        Failures += TestAesCompareModes(AesModeEcb128, Key);
+        Failures += TestAesCompareModes(AesModeEcb256, Key);
+        Failures += TestAesCompareModes(AesModeCtr128, Key);
+        Failures += TestAesCompareModes(AesModeCtr256, Key);
+    }
+
+    return Failures;
+}
+
+ULONG
+TestAesCompareModes (
+    AES_CIPHER_MODE Mode,
+    PUCHAR Key
+    )
+
+/*++
+
+Routine Description:
+
+    This routine encrypts and decrypts a buffer with both the hardware and
+    software AES paths and makes sure they agree.
+
+Arguments:
+
+    Mode - Supplies the AES mode to test.
+
+    Key - Supplies a pointer to the key to use.
+
+Return Value:
+
+    Returns the number of test failures.
+
+--*/
+
+{
+
+    UCHAR Buffer[2][TEST_AES_COMPARE_SIZE];
+    AES_CONTEXT Context;
+    ULONG Failures;
+    ULONG Hardware;
+    ULONG Index;
+    UCHAR InitializationVector[AES_INITIALIZATION_VECTOR_SIZE];
+    UCHAR Plaintext[TEST_AES_COMPARE_SIZE];
+    ULONG Pass;
+
+    Failures = 0;
+    Hardware = CyGetHardwareSupport();
+    for (Index = 0; Index < sizeof(Plaintext); Index += 1) {
+        Plaintext[Index] = rand();
+    }
+
+    //
+    // Start the counter just shy of a carry out of the low bytes.
+    //
+
+    for (Index = 0; Index < sizeof(InitializationVector); Index += 1) {
+        InitializationVector[Index] = 0xFF - Index;
+    }
+
+    InitializationVector[AES_INITIALIZATION_VECTOR_SIZE - 1] = 0xFE;
+    InitializationVector[AES_INITIALIZATION_VECTOR_SIZE - 2] = 0xFF;
+
+    //
+    // Encrypt with the hardware first and then without it. Do it in two
+    // pieces to make sure the initialization vector carries over.
+    //
+
+    for (Pass = 0; Pass < 2; Pass += 1) {
+        if (Pass != 0) {
+            CySetHardwareSupport(0);
+        }
+
+        CyAesInitialize(&Context, Mode, Key, InitializationVector);
+        memcpy(Buffer[Pass], Plaintext, sizeof(Plaintext));
+        switch (Mode) {
+        case AesModeCbc128:
+        case AesModeCbc256:
+            CyAesCbcEncrypt(&Context,
+                            Buffer[Pass],
+                            Buffer[Pass],
+                            AES_BLOCK_SIZE * 3);
+
+            CyAesCbcEncrypt(&Context,
+                            Buffer[Pass] + (AES_BLOCK_SIZE * 3),
+                            Buffer[Pass] + (AES_BLOCK_SIZE * 3),
+                            sizeof(Plaintext) - (AES_BLOCK_SIZE * 3));
+
+            break;
+
+        case AesModeEcb128:
+        case AesModeEcb256:
+            CyAesEcbEncrypt(&Context,
+                            Buffer[Pass],
+                            Buffer[Pass],
+                            sizeof(Plaintext));
+
+            break;
+
+        default:
+            CyAesCtrEncrypt(&Context,
+                            Buffer[Pass],
+                            Buffer[Pass],
+                            AES_BLOCK_SIZE * 3);
+
+            CyAesCtrEncrypt(&Context,
+                            Buffer[Pass] + (AES_BLOCK_SIZE * 3),
+                            Buffer[Pass] + (AES_BLOCK_SIZE * 3),
+                            sizeof(Plaintext) - (AES_BLOCK_SIZE * 3));
+
+            break;
+        }
+
+        CySetHardwareSupport(Hardware);
+    }
+
+    if (memcmp(Buffer[0], Buffer[1], sizeof(Plaintext)) != 0) {
+        printf("AES mode %d hardware encryption mismatch.\n", Mode);
+        Failures += 1;
+    }
+
+    //
+    // Now decrypt in place with the hardware and make sure the plaintext
+    // comes back.
+    //
+
+    CyAesInitialize(&Context, Mode, Key, InitializationVector);
+    switch (Mode) {
+    case AesModeCbc128:
+    case AesModeCbc256:
+        CyAesConvertKeyForDecryption(&Context);
+        CyAesCbcDecrypt(&Context,
+                        Buffer[0],
+                        Buffer[0],
+                        AES_BLOCK_SIZE * 5);
+
+        CyAesCbcDecrypt(&Context,
+                        Buffer[0] + (AES_BLOCK_SIZE * 5),
+                        Buffer[0] + (AES_BLOCK_SIZE * 5),
+                        sizeof(Plaintext) - (AES_BLOCK_SIZE * 5));
+
+        break;
+
+    case AesModeEcb128:
+    case AesModeEcb256:
+        CyAesConvertKeyForDecryption(&Context);
+        CyAesEcbDecrypt(&Context, Buffer[0], Buffer[0], sizeof(Plaintext));
+        break;
+
+    default:
+        CyAesCtrDecrypt(&Context, Buffer[0], Buffer[0], sizeof(Plaintext));
+        break;
+    }
+
+    if (memcmp(Buffer[0], Plaintext, sizeof(Plaintext)) != 0) {
+        printf("AES mode %d hardware decryption failed.\n", Mode);
+        Failures += 1;
+    }
+
+    return Failures;
+}
+
+VOID
+TestCrypBenchmark (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine measures the throughput of the bulk cipher and hash routines,
+    with and without the processor's crypto instructions, followed by the
+    rate of RSA operations.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Algorithm;
+    PUCHAR Buffer;
+    ULONG Hardware;
+    ULONG Pass;
+
+    Buffer = malloc(TEST_BENCHMARK_BUFFER_SIZE);
+    if (Buffer == NULL) {
+        printf("Failed to allocate benchmark buffer.\n");
+        return;
+    }
+
+    memset(Buffer, 0xA5, TEST_BENCHMARK_BUFFER_SIZE);
+    Hardware = CyGetHardwareSupport();
+    printf("Hardware support: 0x%x\n", Hardware);
+    for (Pass = 0; Pass < 2; Pass += 1) {
+        if (Pass == 0) {
+            if (Hardware == 0) {
+                continue;
+            }
+
+            printf("Hardware:\n");
+
+        } else {
+            CySetHardwareSupport(0);
+            printf("Software:\n");
+        }
+
+        for (Algorithm = 0; Algorithm < TEST_BENCHMARK_COUNT; Algorithm += 1) {
+            TestCrypBenchmarkRun(TestCrypBenchmarkNames[Algorithm],
+                                 Algorithm,
+                                 Buffer,
+                                 TEST_BENCHMARK_BUFFER_SIZE);
+        }
+    }
+
+    CySetHardwareSupport(Hardware);
+    free(Buffer);
+    TestCrypBenchmarkRsa();
+    return;
+}
+
+VOID
+TestCrypBenchmarkRun (
+    PSTR Name,
+    ULONG Algorithm,
+    PUCHAR Buffer,
+    UINTN Size
+    )
+
+/*++
+
+Routine Description:
+
+    This routine runs a single throughput benchmark and prints the result.
+
+Arguments:
+
+    Name - Supplies the name of the algorithm, for printing.
+
+    Algorithm - Supplies the TEST_BENCHMARK_* value of the algorithm to run.
+
+    Buffer - Supplies a pointer to the buffer to work on.
+
+    Size - Supplies the size of the buffer in bytes.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    AES_CONTEXT AesContext;
+    UCHAR Hash[SHA256_HASH_SIZE];
+    UCHAR Key[AES_CBC128_KEY_SIZE];
+    double Megabytes;
+    double Seconds;
+    SHA1_CONTEXT Sha1Context;
+    SHA256_CONTEXT Sha256Context;
+    clock_t Start;
+    clock_t Stop;
+    ULONG Total;
+
+    memset(Key, 0x5A, sizeof(Key));
+    CyAesInitialize(&AesContext, AesModeCtr128, Key, NULL);
+    if (Algorithm == TEST_BENCHMARK_AES_CBC_DECRYPT) {
+        CyAesInitialize(&AesContext, AesModeCbc128, Key, NULL);
+        CyAesConvertKeyForDecryption(&AesContext);
+    }
+
+    CySha1Initialize(&Sha1Context);
+    CySha256Initialize(&Sha256Context);
+    Total = 0;
+    Start = clock();
+    do {
+        switch (Algorithm) {
+        case TEST_BENCHMARK_AES_CTR:
+            CyAesCtrEncrypt(&AesContext, Buffer, Buffer, Size);
+            break;
+
+        case TEST_BENCHMARK_AES_CBC_DECRYPT:
+            CyAesCbcDecrypt(&AesContext, Buffer, Buffer, Size);
+            break;
+
+        case TEST_BENCHMARK_SHA1:
+            CySha1AddContent(&Sha1Context, Buffer, Size);
+            break;
+
+        case TEST_BENCHMARK_SHA256:
+            CySha256AddContent(&Sha256Context, Buffer, Size);
+            break;
+
+        default:
+            return;
+        }
+
+        Total += 1;
+        Stop = clock();
+
+    } while ((Stop - Start) < (TEST_BENCHMARK_SECONDS * CLOCKS_PER_SEC));
+
+    CySha1GetHash(&Sha1Context, Hash);
+    CySha256GetHash(&Sha256Context, Hash);
+    Seconds = (double)(Stop - Start) / CLOCKS_PER_SEC;
+    Megabytes = ((double)Size * Total) / (1024.0 * 1024.0);
+    printf("    %-20s %8.1f MB/s\n", Name, Megabytes / Seconds);
+    return;
+}
+
+VOID
+TestCrypBenchmarkRsa (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine measures how many RSA private key (signing) and public key
+    (verification) operations can be performed per second with the test key.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UCHAR CipherBuffer[512];
+    ULONG Operation;
+    UCHAR PlainBuffer[512];
+    RSA_CONTEXT RsaContext;
+    double Seconds;
+    INTN Size;
+    clock_t Start;
+    KSTATUS Status;
+    clock_t Stop;
+    ULONG Total;
+
+    Status = TestCrypLoadRsaKey(&RsaContext);
+    if (!KSUCCESS(Status)) {
+        printf("Failed to load RSA key: %d\n", Status);
+        return;
+    }
+
+    printf("RSA-%d:\n", (INT)(RsaContext.ModulusSize * BITS_PER_BYTE));
+
+    //
+    // Create a signature up front for the verify pass to check.
+    //
+
+    Size = CyRsaEncrypt(&RsaContext,
+                        TestCrypSha512Answers[0],
+                        SHA512_HASH_SIZE,
+                        CipherBuffer,
+                        TRUE);
+
+    if (Size < 0) {
+        printf("RSA signing failed.\n");
+        goto TestCrypBenchmarkRsaEnd;
+    }
+
+    for (Operation = 0; Operation < 2; Operation += 1) {
+        Total = 0;
+        Start = clock();
+        do {
+            if (Operation == 0) {
+                Size = CyRsaEncrypt(&RsaContext,
+                                    TestCrypSha512Answers[0],
+                                    SHA512_HASH_SIZE,
+                                    CipherBuffer,
+                                    TRUE);
+
+            } else {
+                Size = CyRsaDecrypt(&RsaContext,
+                                    CipherBuffer,
+                                    PlainBuffer,
+                                    FALSE);
+            }
+
+            if (Size < 0) {
+                printf("RSA operation failed.\n");
+                goto TestCrypBenchmarkRsaEnd;
+            }
+
+            Total += 1;
+            Stop = clock();
+
+        } while ((Stop - Start) < (TEST_BENCHMARK_SECONDS * CLOCKS_PER_SEC));
+
+        Seconds = (double)(Stop - Start) / CLOCKS_PER_SEC;
+        printf("    %-20s %8.1f ops/s\n",
+               (Operation == 0) ? "sign" : "verify",
+               Total / Seconds);
+    }
+
+TestCrypBenchmarkRsaEnd:
+    CyRsaDestroyContext(&RsaContext);
+    return;
+}
+
+KSTATUS
+TestCrypLoadRsaKey (
+    PRSA_CONTEXT RsaContext
+    )
+
+/*++
+
+Routine Description:
+
+    This routine initializes an RSA context and loads the test private key
+    into it.
+
+Arguments:
+
+    RsaContext - Supplies a pointer to the context to initialize.
+
+Return Value:
+
+    Status code. On failure, the context does not need to be destroyed.
+
+--*/
+
+{
+
+    KSTATUS Status;
+
+    RtlZeroMemory(RsaContext, sizeof(RSA_CONTEXT));
+    RsaContext->BigIntegerContext.AllocateMemory = (PCY_ALLOCATE_MEMORY)malloc;
+    RsaContext->BigIntegerContext.ReallocateMemory =
+                                                (PCY_REALLOCATE_MEMORY)realloc;
+
+    RsaContext->BigIntegerContext.FreeMemory = (PCY_FREE_MEMORY)free;
+    Status = CyRsaInitializeContext(RsaContext);
+    if (!KSUCCESS(Status)) {
+        return Status;
+    }
+
+    Status = CyRsaAddPemFile(RsaContext,
+                             TestCrypRsaPrivateKey,
+                             RtlStringLength(TestCrypRsaPrivateKey) + 1,
+                             TestCrypRsaPrivateKeyPassword);
+
+    if (!KSUCCESS(Status)) {
+        CyRsaDestroyContext(RsaContext);
+    }
+
+    return Status;
+}
+
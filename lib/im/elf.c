@@ -69,6 +69,8 @@ Module Name:
 #define ImpElfGetSymbolInScope ImpElf64GetSymbolInScope
 #define ImpElfGetSymbol ImpElf64GetSymbol
 #define ImpElfApplyRelocation ImpElf64ApplyRelocation
+#define ImpElfNoteTextRelocation ImpElf64NoteTextRelocation
+#define ImpElfReplayImageRelocations ImpElf64ReplayImageRelocations
 #define ImpElfFreeContext ImpElf64FreeContext
 
 #else
@@ -97,6 +99,8 @@ Module Name:
 #define ImpElfGetSymbolInScope ImpElf32GetSymbolInScope
 #define ImpElfGetSymbol ImpElf32GetSymbol
 #define ImpElfApplyRelocation ImpElf32ApplyRelocation
+#define ImpElfNoteTextRelocation ImpElf32NoteTextRelocation
+#define ImpElfReplayImageRelocations ImpElf32ReplayImageRelocations
 #define ImpElfFreeContext ImpElf32FreeContext
 
 #endif
@@ -143,6 +147,9 @@ Structure Description:
     RelocationEnd - Stores the address at the end of the highest image
         relocation.
 
+    RelocationLog - Stores an optional pointer to a log that records each
+        modification made while relocating the image.
+
 --*/
 
 typedef struct _ELF_LOADING_IMAGE {
@@ -150,6 +157,7 @@ typedef struct _ELF_LOADING_IMAGE {
     PELF_HEADER ElfHeader;
     PVOID RelocationStart;
     PVOID RelocationEnd;
+    PIMAGE_RELOCATION_LOG RelocationLog;
 } ELF_LOADING_IMAGE, *PELF_LOADING_IMAGE;
 
 //
@@ -227,6 +235,20 @@ ImpElfApplyRelocation (
     PVOID *FinalSymbolValue
     );
 
+VOID
+ImpElfNoteTextRelocation (
+    PLOADED_IMAGE Image,
+    PVOID RelocationPlace,
+    PVOID RelocationEnd
+    );
+
+KSTATUS
+ImpElfReplayImageRelocations (
+    PLOADED_IMAGE Image,
+    PIMAGE_RELOCATION_RECORD Records,
+    UINTN RecordCount
+    );
+
 VOID
 ImpElfFreeContext (
     PLOADED_IMAGE Image
@@ -927,7 +949,7 @@ Return Value:
         // that the complete symbol table is built.
         //
 
-        Status = ImpElfRelocateImages(ListHead);
+        Status = ImpElfRelocateImages(ListHead, NULL);
         if (!KSUCCESS(Status)) {
             goto LoadImageEnd;
         }
@@ -1269,6 +1291,7 @@ Return Value:
                 }
 
                 PrimaryExecutable->ScopeSize -= 1;
+                ImScopeGeneration += 1;
                 break;
             }
         }
@@ -1622,7 +1645,8 @@ Return Value:
 
 KSTATUS
 ImpElfRelocateImages (
-    PLIST_ENTRY ListHead
+    PLIST_ENTRY ListHead,
+    PIMAGE_RELOCATION_LOG Log
     )
 
 /*++
@@ -1636,6 +1660,9 @@ Routine Description:
 
     ListHead - Supplies a pointer to the head of the list to relocate.
 
+    Log - Supplies an optional pointer to a relocation log to record the
+        modifications made into.
+
 Return Value:
 
     Status code.
@@ -1646,6 +1673,7 @@ Return Value:
 
     PLIST_ENTRY CurrentEntry;
     PLOADED_IMAGE CurrentImage;
+    PELF_LOADING_IMAGE LoadingImage;
     KSTATUS Status;
 
     Status = ImpElfLoadAllImports(ListHead);
@@ -1666,6 +1694,22 @@ Return Value:
         ASSERT(CurrentImage->Format == ImageElfNative);
 
         if ((CurrentImage->Flags & IMAGE_FLAG_RELOCATED) == 0) {
+
+            //
+            // Each image's records are preceded by a record identifying the
+            // image, so replay can check the log against the image list.
+            //
+
+            if (Log != NULL) {
+                LoadingImage = CurrentImage->ImageContext;
+                LoadingImage->RelocationLog = Log;
+                ImpRecordRelocation(Log,
+                                    ImageRelocationRecordImage,
+                                    CurrentImage->LoadedImageBuffer,
+                                    CurrentImage->Size,
+                                    0);
+            }
+
             Status = ImpElfRelocateImage(CurrentImage);
             if (!KSUCCESS(Status)) {
                 goto RelocateImagesEnd;
@@ -1694,6 +1738,168 @@ Return Value:
     return Status;
 }
 
+KSTATUS
+ImpElfReplayRelocationLog (
+    PLIST_ENTRY ListHead,
+    PIMAGE_RELOCATION_LOG Log
+    )
+
+/*++
+
+Routine Description:
+
+    This routine relocates all images on the given image list that have not
+    yet been relocated by replaying a previously recorded relocation log. The
+    whole log is validated against the images before any of them are
+    modified.
+
+Arguments:
+
+    ListHead - Supplies a pointer to the head of the list to relocate.
+
+    Log - Supplies a pointer to the relocation log to replay.
+
+Return Value:
+
+    Status code.
+
+    STATUS_VERSION_MISMATCH if the log does not describe the images on the
+    list.
+
+--*/
+
+{
+
+    PLIST_ENTRY CurrentEntry;
+    PLOADED_IMAGE CurrentImage;
+    UINTN ImageEnd;
+    UINTN ImageStart;
+    UINTN Index;
+    PIMAGE_RELOCATION_RECORD Record;
+    UINTN RecordCount;
+    PIMAGE_RELOCATION_RECORD Records;
+    UINTN Size;
+    KSTATUS Status;
+
+    Status = ImpElfLoadAllImports(ListHead);
+    if (!KSUCCESS(Status)) {
+        goto ReplayRelocationLogEnd;
+    }
+
+    //
+    // Walk the images in the same order they were recorded in, making sure
+    // each image's records land inside that image. Since relocations without
+    // addends can't be applied twice, nothing gets written until the whole
+    // log checks out.
+    //
+
+    Status = STATUS_VERSION_MISMATCH;
+    Records = Log->Records;
+    Index = 0;
+    CurrentEntry = ListHead->Previous;
+    while (CurrentEntry != ListHead) {
+        CurrentImage = LIST_VALUE(CurrentEntry, LOADED_IMAGE, ListEntry);
+        CurrentEntry = CurrentEntry->Previous;
+        if ((CurrentImage->Flags & IMAGE_FLAG_RELOCATED) != 0) {
+            continue;
+        }
+
+        if (CurrentImage->ImageContext == NULL) {
+            goto ReplayRelocationLogEnd;
+        }
+
+        ImageStart = (UINTN)(CurrentImage->LoadedImageBuffer);
+        ImageEnd = ImageStart + CurrentImage->Size;
+        if ((Index >= Log->Count) ||
+            (Records[Index].Type != ImageRelocationRecordImage) ||
+            (Records[Index].Place != ImageStart) ||
+            (Records[Index].Value != CurrentImage->Size)) {
+
+            goto ReplayRelocationLogEnd;
+        }
+
+        Index += 1;
+        while ((Index < Log->Count) &&
+               (Records[Index].Type != ImageRelocationRecordImage)) {
+
+            Record = &(Records[Index]);
+            if (Record->Type == ImageRelocationRecordStore) {
+                Size = sizeof(ELF_ADDR);
+
+            } else if (Record->Type == ImageRelocationRecordCopy) {
+                Size = Record->Size;
+
+            } else {
+                goto ReplayRelocationLogEnd;
+            }
+
+            if ((Record->Place < ImageStart) ||
+                (Record->Place >= ImageEnd) ||
+                (Size > ImageEnd - (UINTN)(Record->Place))) {
+
+                goto ReplayRelocationLogEnd;
+            }
+
+            Index += 1;
+        }
+    }
+
+    if (Index != Log->Count) {
+        goto ReplayRelocationLogEnd;
+    }
+
+    //
+    // Now go through again and replay each image's records, finishing off
+    // each image the same way a regular relocation would.
+    //
+
+    Index = 0;
+    CurrentEntry = ListHead->Previous;
+    while (CurrentEntry != ListHead) {
+        CurrentImage = LIST_VALUE(CurrentEntry, LOADED_IMAGE, ListEntry);
+        CurrentEntry = CurrentEntry->Previous;
+        if ((CurrentImage->Flags & IMAGE_FLAG_RELOCATED) != 0) {
+            continue;
+        }
+
+        Index += 1;
+        RecordCount = 0;
+        while ((Index + RecordCount < Log->Count) &&
+               (Records[Index + RecordCount].Type !=
+                ImageRelocationRecordImage)) {
+
+            RecordCount += 1;
+        }
+
+        Status = ImpElfReplayImageRelocations(CurrentImage,
+                                              &(Records[Index]),
+                                              RecordCount);
+
+        if (!KSUCCESS(Status)) {
+            goto ReplayRelocationLogEnd;
+        }
+
+        Index += RecordCount;
+        CurrentImage->Flags |= IMAGE_FLAG_RELOCATED;
+        if (ImFinalizeSegments != NULL) {
+            Status = ImFinalizeSegments(CurrentImage->AllocatorHandle,
+                                        CurrentImage->Segments,
+                                        CurrentImage->SegmentCount);
+
+            if (!KSUCCESS(Status)) {
+                goto ReplayRelocationLogEnd;
+            }
+        }
+
+        ImpElfFreeContext(CurrentImage);
+    }
+
+    Status = STATUS_SUCCESS;
+
+ReplayRelocationLogEnd:
+    return Status;
+}
+
 VOID
 ImpElfRelocateSelf (
     PIMAGE_BUFFER Buffer,
@@ -2936,6 +3142,8 @@ Return Value:
 
     ELF_ADDR BaseDifference;
     ELF_XWORD Information;
+    PELF_LOADING_IMAGE LoadingImage;
+    PIMAGE_RELOCATION_LOG Log;
     ELF_ADDR Offset;
     PELF_RELOCATION_ENTRY Relocation;
     PELF_RELOCATION_ADDEND_ENTRY RelocationAddend;
@@ -2949,6 +3157,9 @@ Return Value:
         return;
     }
 
+    LoadingImage = Image->ImageContext;
+    Log = LoadingImage->RelocationLog;
+
     RelocationAddend = Relocations;
     Relocation = Relocations;
     if (Addends != FALSE) {
@@ -2995,6 +3206,13 @@ Return Value:
                                (Offset - (UINTN)Image->PreferredLowestAddress));
 
             *RelocationPlace += BaseDifference;
+            if (Log != NULL) {
+                ImpRecordRelocation(Log,
+                                    ImageRelocationRecordStore,
+                                    RelocationPlace,
+                                    *RelocationPlace,
+                                    0);
+            }
         }
     }
 
@@ -3192,25 +3410,40 @@ Return Value:
 
 {
 
+    ULONG CacheHash;
     ULONG CurrentFlags;
     ULONG Hash;
     PLOADED_IMAGE Image;
     UINTN Index;
+    PSTR Name;
     PELF_SYMBOL Result;
     PLOADED_IMAGE *Scope;
     UINTN ScopeSize;
 
     //
-    // Check the global scope first. The conditional limits recursion to once.
+    // Take a guess at what the hashing style is going to be based on the
+    // hashing style of the scope owner.
     //
 
-    if ((ScopeImage != ImPrimaryExecutable) &&
-        (ImPrimaryExecutable != NULL)) {
+    CurrentFlags = ScopeImage->Flags;
+    if ((CurrentFlags & IMAGE_FLAG_GNU_HASH) != 0) {
+        Hash = ImpElfGnuHash(SymbolName);
 
-        Result = ImpElfGetSymbolInScope(ImPrimaryExecutable,
-                                        Skip,
-                                        SymbolName,
-                                        FoundImage);
+    } else {
+        Hash = ImpElfOriginalHash(SymbolName);
+    }
+
+    //
+    // Check the cache of symbols recently resolved in this scope. Searches
+    // that skip an image get a different answer, so they don't use it.
+    //
+
+    CacheHash = Hash;
+    if (Skip == NULL) {
+        Result = ImpLookupSymbolCache(ScopeImage,
+                                      CacheHash,
+                                      SymbolName,
+                                      FoundImage);
 
         if (Result != NULL) {
             return Result;
@@ -3218,16 +3451,20 @@ Return Value:
     }
 
     //
-    // Take a guess at what the hashing style is going to be based on the
-    // hashing style of the scope owner.
+    // Check the global scope first. The conditional limits recursion to once.
     //
 
-    CurrentFlags = ScopeImage->Flags;
-    if ((CurrentFlags & IMAGE_FLAG_GNU_HASH) != 0) {
-        Hash = ImpElfGnuHash(SymbolName);
+    if ((ScopeImage != ImPrimaryExecutable) &&
+        (ImPrimaryExecutable != NULL)) {
 
-    } else {
-        Hash = ImpElfOriginalHash(SymbolName);
+        Result = ImpElfGetSymbolInScope(ImPrimaryExecutable,
+                                        Skip,
+                                        SymbolName,
+                                        FoundImage);
+
+        if (Result != NULL) {
+            goto GetSymbolInScopeEnd;
+        }
     }
 
     Scope = ScopeImage->Scope;
@@ -3266,11 +3503,19 @@ Return Value:
              (Result->SectionIndex == ELF_SECTION_ABSOLUTE))) {
 
             *FoundImage = Image;
-            return Result;
+            goto GetSymbolInScopeEnd;
         }
     }
 
     return NULL;
+
+GetSymbolInScopeEnd:
+    if (Skip == NULL) {
+        Name = (*FoundImage)->ExportStringTable + Result->NameOffset;
+        ImpInsertSymbolCache(ScopeImage, CacheHash, Name, Result, *FoundImage);
+    }
+
+    return Result;
 }
 
 PELF_SYMBOL
@@ -3309,9 +3554,9 @@ Return Value:
     ELF_WORD BucketCount;
     ELF_WORD BucketIndex;
     BOOL Equal;
-    PELF_WORD Filter;
-    ELF_WORD FilterMask;
-    ELF_WORD FilterWord;
+    PELF_ADDR Filter;
+    ELF_ADDR FilterMask;
+    ELF_ADDR FilterWord;
     ELF_WORD FilterWords;
     PELF_WORD HashBuckets;
     PELF_WORD HashChains;
@@ -3348,18 +3593,19 @@ Return Value:
         //
         // Check the Bloom filter first. The Bloom filter indicates that a
         // symbol is definitely not there, or is maybe there. It basically
-        // represents a quick "no".
+        // represents a quick "no". The filter words are the size of an
+        // address, so they're 64 bits wide in 64-bit images.
         //
 
-        Filter = (PELF_WORD)HashTable;
+        Filter = (PELF_ADDR)HashTable;
         HashTable = (PELF_WORD)(Filter + FilterWords);
         WordIndex = (Hash >> ELF_WORD_SIZE_SHIFT) & (FilterWords - 1);
 
         ASSERT(POWER_OF_2(FilterWords));
 
         FilterWord = Filter[WordIndex];
-        FilterMask = (1 << (Hash & ELF_WORD_SIZE_MASK)) |
-                     (1 << ((Hash >> Shift) & ELF_WORD_SIZE_MASK));
+        FilterMask = ((ELF_ADDR)1 << (Hash & ELF_WORD_SIZE_MASK)) |
+                     ((ELF_ADDR)1 << ((Hash >> Shift) & ELF_WORD_SIZE_MASK));
 
         if ((FilterWord & FilterMask) != FilterMask) {
             return NULL;
@@ -3501,6 +3747,7 @@ Return Value:
     BOOL Copy;
     ELF_XWORD Information;
     PELF_LOADING_IMAGE LoadingImage;
+    PIMAGE_RELOCATION_LOG Log;
     ELF_ADDR Offset;
     ELF_ADDR Place;
     PVOID RelocationEnd;
@@ -4020,6 +4267,11 @@ Return Value:
             Address += *RelocationPlace;
         }
 
+        Log = NULL;
+        if (LoadingImage != NULL) {
+            Log = LoadingImage->RelocationLog;
+        }
+
         if (Copy != FALSE) {
             RtlCopyMemory(RelocationPlace,
                           (PVOID)(UINTN)Address,
@@ -4028,41 +4280,174 @@ Return Value:
             RelocationEnd = (PVOID)RelocationPlace +
                             Symbols[SymbolIndex].Size;
 
+            if (Log != NULL) {
+                ImpRecordRelocation(Log,
+                                    ImageRelocationRecordCopy,
+                                    RelocationPlace,
+                                    Address,
+                                    Symbols[SymbolIndex].Size);
+            }
+
         } else {
 
             //
             // Avoid the write unless it's necessary, as unnecessary write
-            // faults are expensive.
+            // faults are expensive. A replay starts from the same image
+            // contents, so skipped writes don't need to be recorded either.
             //
 
             if (*RelocationPlace != Address) {
                 *RelocationPlace = Address;
                 RelocationEnd = RelocationPlace + 1;
+                if (Log != NULL) {
+                    ImpRecordRelocation(Log,
+                                        ImageRelocationRecordStore,
+                                        RelocationPlace,
+                                        Address,
+                                        0);
+                }
 
             } else {
                 RelocationEnd = NULL;
             }
         }
 
-        if ((LoadingImage != NULL) &&
-            ((Image->Flags & IMAGE_FLAG_TEXT_RELOCATIONS) != 0) &&
-            (RelocationEnd != NULL)) {
+        if ((LoadingImage != NULL) && (RelocationEnd != NULL)) {
+            ImpElfNoteTextRelocation(Image, RelocationPlace, RelocationEnd);
+        }
+    }
 
-            if ((LoadingImage->RelocationStart == ELF_INVALID_RELOCATION) ||
-                (LoadingImage->RelocationStart > (PVOID)RelocationPlace)) {
+    return TRUE;
+}
 
-                LoadingImage->RelocationStart = RelocationPlace;
-            }
+VOID
+ImpElfNoteTextRelocation (
+    PLOADED_IMAGE Image,
+    PVOID RelocationPlace,
+    PVOID RelocationEnd
+    )
+
+/*++
+
+Routine Description:
 
-            if ((LoadingImage->RelocationEnd == ELF_INVALID_RELOCATION) ||
-                (LoadingImage->RelocationEnd < RelocationEnd)) {
+    This routine widens the range of the image that needs its instruction
+    cache invalidated to cover the given modification, if the image has
+    relocations in its text.
 
-                LoadingImage->RelocationEnd = RelocationEnd;
+Arguments:
+
+    Image - Supplies a pointer to the image being relocated. The image must
+        have a loading context.
+
+    RelocationPlace - Supplies the first address modified.
+
+    RelocationEnd - Supplies the address just after the last one modified.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PELF_LOADING_IMAGE LoadingImage;
+
+    if ((Image->Flags & IMAGE_FLAG_TEXT_RELOCATIONS) == 0) {
+        return;
+    }
+
+    LoadingImage = Image->ImageContext;
+    if ((LoadingImage->RelocationStart == ELF_INVALID_RELOCATION) ||
+        (LoadingImage->RelocationStart > RelocationPlace)) {
+
+        LoadingImage->RelocationStart = RelocationPlace;
+    }
+
+    if ((LoadingImage->RelocationEnd == ELF_INVALID_RELOCATION) ||
+        (LoadingImage->RelocationEnd < RelocationEnd)) {
+
+        LoadingImage->RelocationEnd = RelocationEnd;
+    }
+
+    return;
+}
+
+KSTATUS
+ImpElfReplayImageRelocations (
+    PLOADED_IMAGE Image,
+    PIMAGE_RELOCATION_RECORD Records,
+    UINTN RecordCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine applies one image's worth of records from a relocation log.
+    The records are assumed to have already been validated against the image.
+
+Arguments:
+
+    Image - Supplies a pointer to the loaded image.
+
+    Records - Supplies a pointer to the first record for the image.
+
+    RecordCount - Supplies the number of records for the image.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    UINTN Index;
+    PELF_LOADING_IMAGE LoadingImage;
+    PIMAGE_RELOCATION_RECORD Record;
+    PVOID RelocationEnd;
+    PELF_ADDR RelocationPlace;
+    UINTN Size;
+
+    LoadingImage = Image->ImageContext;
+
+    ASSERT(LoadingImage != NULL);
+
+    LoadingImage->RelocationStart = ELF_INVALID_RELOCATION;
+    LoadingImage->RelocationEnd = ELF_INVALID_RELOCATION;
+    for (Index = 0; Index < RecordCount; Index += 1) {
+        Record = &(Records[Index]);
+        RelocationPlace = (PELF_ADDR)(UINTN)(Record->Place);
+        if (Record->Type == ImageRelocationRecordCopy) {
+            RtlCopyMemory(RelocationPlace,
+                          (PVOID)(UINTN)(Record->Value),
+                          Record->Size);
+
+            RelocationEnd = (PVOID)RelocationPlace + Record->Size;
+
+        } else {
+
+            ASSERT(Record->Type == ImageRelocationRecordStore);
+
+            if (*RelocationPlace == (ELF_ADDR)(Record->Value)) {
+                continue;
             }
+
+            *RelocationPlace = (ELF_ADDR)(Record->Value);
+            RelocationEnd = RelocationPlace + 1;
         }
+
+        ImpElfNoteTextRelocation(Image, RelocationPlace, RelocationEnd);
     }
 
-    return TRUE;
+    if (LoadingImage->RelocationStart != ELF_INVALID_RELOCATION) {
+        Size = LoadingImage->RelocationEnd - LoadingImage->RelocationStart;
+        ImInvalidateInstructionCacheRegion(LoadingImage->RelocationStart, Size);
+    }
+
+    return STATUS_SUCCESS;
 }
 
 VOID
@@ -1135,7 +1135,8 @@ Return Value:
 
 KSTATUS
 ImpElf32RelocateImages (
-    PLIST_ENTRY ListHead
+    PLIST_ENTRY ListHead,
+    PIMAGE_RELOCATION_LOG Log
     );
 
 /*++
@@ -1149,12 +1150,45 @@ Routine Description:
 
     ListHead - Supplies a pointer to the head of the list to relocate.
 
+    Log - Supplies an optional pointer to a relocation log to record the
+        modifications made into.
+
 Return Value:
 
     Status code.
 
 --*/
 
+KSTATUS
+ImpElf32ReplayRelocationLog (
+    PLIST_ENTRY ListHead,
+    PIMAGE_RELOCATION_LOG Log
+    );
+
+/*++
+
+Routine Description:
+
+    This routine relocates all images on the given image list that have not
+    yet been relocated by replaying a previously recorded relocation log. The
+    whole log is validated against the images before any of them are
+    modified.
+
+Arguments:
+
+    ListHead - Supplies a pointer to the head of the list to relocate.
+
+    Log - Supplies a pointer to the relocation log to replay.
+
+Return Value:
+
+    Status code.
+
+    STATUS_VERSION_MISMATCH if the log does not describe the images on the
+    list.
+
+--*/
+
 VOID
 ImpElf32RelocateSelf (
     PIMAGE_BUFFER Buffer,
@@ -1527,7 +1561,8 @@ Return Value:
 
 KSTATUS
 ImpElf64RelocateImages (
-    PLIST_ENTRY ListHead
+    PLIST_ENTRY ListHead,
+    PIMAGE_RELOCATION_LOG Log
     );
 
 /*++
@@ -1541,12 +1576,45 @@ Routine Description:
 
     ListHead - Supplies a pointer to the head of the list to relocate.
 
+    Log - Supplies an optional pointer to a relocation log to record the
+        modifications made into.
+
 Return Value:
 
     Status code.
 
 --*/
 
+KSTATUS
+ImpElf64ReplayRelocationLog (
+    PLIST_ENTRY ListHead,
+    PIMAGE_RELOCATION_LOG Log
+    );
+
+/*++
+
+Routine Description:
+
+    This routine relocates all images on the given image list that have not
+    yet been relocated by replaying a previously recorded relocation log. The
+    whole log is validated against the images before any of them are
+    modified.
+
+Arguments:
+
+    ListHead - Supplies a pointer to the head of the list to relocate.
+
+    Log - Supplies a pointer to the relocation log to replay.
+
+Return Value:
+
+    Status code.
+
+    STATUS_VERSION_MISMATCH if the log does not describe the images on the
+    list.
+
+--*/
+
 VOID
 ImpElf64RelocateSelf (
     PIMAGE_BUFFER Buffer,
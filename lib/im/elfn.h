@@ -102,6 +102,7 @@ Module Name:
 #define ImpElfGetSection ImpElf64GetSection
 #define ImpElfLoadAllImports ImpElf64LoadAllImports
 #define ImpElfRelocateImages ImpElf64RelocateImages
+#define ImpElfReplayRelocationLog ImpElf64ReplayRelocationLog
 #define ImpElfRelocateSelf ImpElf64RelocateSelf
 #define ImpElfGetSymbolByName ImpElf64GetSymbolByName
 #define ImpElfGetSymbolByAddress ImpElf64GetSymbolByAddress
@@ -179,6 +180,7 @@ Module Name:
 #define ImpElfGetSection ImpElf32GetSection
 #define ImpElfLoadAllImports ImpElf32LoadAllImports
 #define ImpElfRelocateImages ImpElf32RelocateImages
+#define ImpElfReplayRelocationLog ImpElf32ReplayRelocationLog
 #define ImpElfRelocateSelf ImpElf32RelocateSelf
 #define ImpElfGetSymbolByName ImpElf32GetSymbolByName
 #define ImpElfGetSymbolByAddress ImpElf32GetSymbolByAddress
@@ -98,6 +98,13 @@ PIM_IMPORT_TABLE ImImportTable = NULL;
 
 PLOADED_IMAGE ImPrimaryExecutable = NULL;
 
+//
+// Store the scope generation. This starts at one so that zeroed cache entries
+// are never valid.
+//
+
+volatile ULONG ImScopeGeneration = 1;
+
 //
 // ------------------------------------------------------------------ Functions
 //
@@ -433,7 +440,116 @@ Return Value:
 
 {
 
-    return ImpRelocateImages(ListHead);
+    return ImpRelocateImages(ListHead, NULL);
+}
+
+KSTATUS
+ImRelocateImagesWithLog (
+    PLIST_ENTRY ListHead,
+    PIMAGE_RELOCATION_LOG Log
+    )
+
+/*++
+
+Routine Description:
+
+    This routine relocates all images that have not yet been relocated on the
+    given list, recording every modification made along the way so that it
+    can later be replayed with ImReplayRelocationLog.
+
+Arguments:
+
+    ListHead - Supplies a pointer to the head of the list of loaded images to
+        apply relocations for.
+
+    Log - Supplies a pointer to a zeroed relocation log where the records
+        will be appended. The caller must destroy the log when finished with
+        it. If recording fails the relocations are still applied, but the
+        log's status is set to a failing code.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    return ImpRelocateImages(ListHead, Log);
+}
+
+KSTATUS
+ImReplayRelocationLog (
+    PLIST_ENTRY ListHead,
+    PIMAGE_RELOCATION_LOG Log
+    )
+
+/*++
+
+Routine Description:
+
+    This routine relocates all images that have not yet been relocated on the
+    given list by replaying a previously recorded relocation log rather than
+    processing each image's relocation tables. The log is checked against the
+    images before anything is modified.
+
+Arguments:
+
+    ListHead - Supplies a pointer to the head of the list of loaded images to
+        apply relocations for.
+
+    Log - Supplies a pointer to the relocation log to replay.
+
+Return Value:
+
+    Status code.
+
+    STATUS_VERSION_MISMATCH if the log does not describe the images on the
+    list. No images have been modified in this case.
+
+--*/
+
+{
+
+    if ((Log->Count == 0) || (!KSUCCESS(Log->Status))) {
+        return STATUS_VERSION_MISMATCH;
+    }
+
+    return ImpReplayRelocationLog(ListHead, Log);
+}
+
+VOID
+ImDestroyRelocationLog (
+    PIMAGE_RELOCATION_LOG Log
+    )
+
+/*++
+
+Routine Description:
+
+    This routine frees the records allocated within a relocation log. The log
+    structure itself is not freed.
+
+Arguments:
+
+    Log - Supplies a pointer to the relocation log to destroy.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    if ((Log->Capacity != 0) && (Log->Records != NULL)) {
+        ImFreeMemory(Log->Records);
+    }
+
+    Log->Records = NULL;
+    Log->Count = 0;
+    Log->Capacity = 0;
+    return;
 }
 
 VOID
@@ -516,6 +632,10 @@ Return Value:
         ImFreeMemory(Image->Scope);
     }
 
+    if (Image->SymbolCache != NULL) {
+        ImFreeMemory(Image->SymbolCache);
+    }
+
     ImFreeMemory(Image);
     return;
 }
@@ -1191,11 +1311,25 @@ Return Value:
 
 {
 
+    UINTN CacheSize;
     UINTN ImportCount;
     UINTN ImportIndex;
     UINTN Index;
     KSTATUS Status;
 
+    //
+    // Create the symbol cache for this scope. Failure is not fatal, lookups
+    // just go the long way.
+    //
+
+    if (Parent->SymbolCache == NULL) {
+        CacheSize = IM_SYMBOL_CACHE_SIZE * sizeof(IM_SYMBOL_CACHE_ENTRY);
+        Parent->SymbolCache = ImAllocateMemory(CacheSize, IM_ALLOCATION_TAG);
+        if (Parent->SymbolCache != NULL) {
+            RtlZeroMemory(Parent->SymbolCache, CacheSize);
+        }
+    }
+
     //
     // Add the child itself.
     //
@@ -1227,6 +1361,253 @@ Return Value:
     return STATUS_SUCCESS;
 }
 
+PVOID
+ImpLookupSymbolCache (
+    PLOADED_IMAGE ScopeImage,
+    ULONG Hash,
+    PCSTR SymbolName,
+    PLOADED_IMAGE *FoundImage
+    )
+
+/*++
+
+Routine Description:
+
+    This routine looks for a symbol in the cache of symbols resolved through
+    the given image's scope.
+
+Arguments:
+
+    ScopeImage - Supplies a pointer to the image whose scope was searched.
+
+    Hash - Supplies the hash of the symbol name.
+
+    SymbolName - Supplies a pointer to the name of the symbol.
+
+    FoundImage - Supplies a pointer where a pointer to the image exporting the
+        symbol will be returned on success.
+
+Return Value:
+
+    Returns a pointer to the format specific symbol on a cache hit.
+
+    NULL if the symbol is not in the cache.
+
+--*/
+
+{
+
+    PIM_SYMBOL_CACHE_ENTRY Entry;
+    PLOADED_IMAGE Image;
+    PCSTR Name;
+    ULONG Sequence;
+    PVOID Symbol;
+
+    if (ScopeImage->SymbolCache == NULL) {
+        return NULL;
+    }
+
+    Entry = (PIM_SYMBOL_CACHE_ENTRY)ScopeImage->SymbolCache +
+            (Hash & (IM_SYMBOL_CACHE_SIZE - 1));
+
+    Sequence = Entry->Sequence;
+    if ((Sequence & 0x1) != 0) {
+        return NULL;
+    }
+
+    RtlMemoryBarrier();
+    if ((Entry->Generation != ImScopeGeneration) || (Entry->Hash != Hash)) {
+        return NULL;
+    }
+
+    Name = Entry->Name;
+    Symbol = Entry->Symbol;
+    Image = Entry->Image;
+
+    //
+    // If the entry changed while it was being read, treat it as a miss.
+    //
+
+    RtlMemoryBarrier();
+    if (Entry->Sequence != Sequence) {
+        return NULL;
+    }
+
+    if (RtlAreStringsEqual(SymbolName, Name, MAX_ULONG) == FALSE) {
+        return NULL;
+    }
+
+    *FoundImage = Image;
+    return Symbol;
+}
+
+VOID
+ImpInsertSymbolCache (
+    PLOADED_IMAGE ScopeImage,
+    ULONG Hash,
+    PCSTR Name,
+    PVOID Symbol,
+    PLOADED_IMAGE FoundImage
+    )
+
+/*++
+
+Routine Description:
+
+    This routine records a symbol resolved through the given image's scope.
+    If another thread is writing the same cache entry, the symbol is simply
+    not recorded.
+
+Arguments:
+
+    ScopeImage - Supplies a pointer to the image whose scope was searched.
+
+    Hash - Supplies the hash of the symbol name.
+
+    Name - Supplies a pointer to the symbol name. This must be the copy in the
+        exporting image's string table, since the caller's copy may not last.
+
+    Symbol - Supplies a pointer to the format specific symbol.
+
+    FoundImage - Supplies a pointer to the image exporting the symbol.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PIM_SYMBOL_CACHE_ENTRY Entry;
+    ULONG Sequence;
+
+    if (ScopeImage->SymbolCache == NULL) {
+        return;
+    }
+
+    Entry = (PIM_SYMBOL_CACHE_ENTRY)ScopeImage->SymbolCache +
+            (Hash & (IM_SYMBOL_CACHE_SIZE - 1));
+
+    //
+    // Claim the entry by making the sequence number odd.
+    //
+
+    Sequence = Entry->Sequence;
+    if ((Sequence & 0x1) != 0) {
+        return;
+    }
+
+    if (RtlAtomicCompareExchange32(&(Entry->Sequence),
+                                   Sequence + 1,
+                                   Sequence) != Sequence) {
+
+        return;
+    }
+
+    Entry->Generation = ImScopeGeneration;
+    Entry->Hash = Hash;
+    Entry->Name = Name;
+    Entry->Symbol = Symbol;
+    Entry->Image = FoundImage;
+    RtlMemoryBarrier();
+    Entry->Sequence = Sequence + 2;
+    return;
+}
+
+VOID
+ImpRecordRelocation (
+    PIMAGE_RELOCATION_LOG Log,
+    IMAGE_RELOCATION_RECORD_TYPE Type,
+    PVOID Place,
+    ULONGLONG Value,
+    ULONG Size
+    )
+
+/*++
+
+Routine Description:
+
+    This routine appends a record to a relocation log, growing the log if
+    needed. If the log cannot be grown, its status is set to a failing code
+    and the record is dropped.
+
+Arguments:
+
+    Log - Supplies a pointer to the relocation log.
+
+    Type - Supplies the type of record to append.
+
+    Place - Supplies the address that was modified, or the base of the image
+        for image records.
+
+    Value - Supplies the value written, the address copied from, or the size
+        of the image, depending on the record type.
+
+    Size - Supplies the number of bytes copied for copy records.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UINTN AllocationSize;
+    UINTN NewCapacity;
+    PIMAGE_RELOCATION_RECORD NewRecords;
+    PIMAGE_RELOCATION_RECORD Record;
+
+    if (!KSUCCESS(Log->Status)) {
+        return;
+    }
+
+    if (Log->Count >= Log->Capacity) {
+        NewCapacity = Log->Capacity * 2;
+        if (Log->Capacity == 0) {
+            NewCapacity = IM_INITIAL_RELOCATION_LOG_SIZE;
+
+            //
+            // A log with records but no capacity belongs to the caller, and
+            // can't be appended to.
+            //
+
+            if (Log->Count != 0) {
+                Log->Status = STATUS_INVALID_PARAMETER;
+                return;
+            }
+        }
+
+        AllocationSize = NewCapacity * sizeof(IMAGE_RELOCATION_RECORD);
+        NewRecords = ImAllocateMemory(AllocationSize, IM_ALLOCATION_TAG);
+
+        if (NewRecords == NULL) {
+            Log->Status = STATUS_INSUFFICIENT_RESOURCES;
+            return;
+        }
+
+        if (Log->Count != 0) {
+            RtlCopyMemory(NewRecords,
+                          Log->Records,
+                          Log->Count * sizeof(IMAGE_RELOCATION_RECORD));
+
+            ImFreeMemory(Log->Records);
+        }
+
+        Log->Records = NewRecords;
+        Log->Capacity = NewCapacity;
+    }
+
+    Record = &(Log->Records[Log->Count]);
+    Record->Place = (UINTN)Place;
+    Record->Value = Value;
+    Record->Size = Size;
+    Record->Type = Type;
+    Log->Count += 1;
+    return;
+}
+
 //
 // --------------------------------------------------------- Internal Functions
 //
@@ -1577,6 +1958,7 @@ Return Value:
 
     Image->Scope[Size] = Element;
     Image->ScopeSize += 1;
+    ImScopeGeneration += 1;
     return STATUS_SUCCESS;
 }
 
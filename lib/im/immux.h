@@ -47,6 +47,7 @@ Module Name:
 
 #define ImpLoadImports ImpElf32LoadAllImports
 #define ImpRelocateImages ImpElf32RelocateImages
+#define ImpReplayRelocationLog ImpElf32ReplayRelocationLog
 #define ImpGetImageSize ImpElf32GetImageSize
 #define ImpLoadImage ImpElf32LoadImage
 #define ImpAddImage ImpElf32AddImage
@@ -65,6 +66,7 @@ Module Name:
 
 #define ImpLoadImports ImpElf64LoadAllImports
 #define ImpRelocateImages ImpElf64RelocateImages
+#define ImpReplayRelocationLog ImpElf64ReplayRelocationLog
 #define ImpGetImageSize ImpElf64GetImageSize
 #define ImpLoadImage ImpElf64LoadImage
 #define ImpAddImage ImpElf64AddImage
@@ -132,7 +134,8 @@ Return Value:
 
 KSTATUS
 ImpRelocateImages (
-    PLIST_ENTRY ListHead
+    PLIST_ENTRY ListHead,
+    PIMAGE_RELOCATION_LOG Log
     );
 
 /*++
@@ -147,6 +150,35 @@ Routine Description:
     ListHead - Supplies a pointer to the head of the list of loaded images to
         apply relocations for.
 
+    Log - Supplies an optional pointer to a relocation log to record the
+        modifications made into.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+KSTATUS
+ImpReplayRelocationLog (
+    PLIST_ENTRY ListHead,
+    PIMAGE_RELOCATION_LOG Log
+    );
+
+/*++
+
+Routine Description:
+
+    This routine relocates all images that have not yet been relocated on the
+    given list by replaying a previously recorded relocation log.
+
+Arguments:
+
+    ListHead - Supplies a pointer to the head of the list of loaded images to
+        apply relocations for.
+
+    Log - Supplies a pointer to the relocation log to replay.
+
 Return Value:
 
     Status code.
@@ -76,10 +76,60 @@ Module Name:
 
 #define IM_MAX_SCOPE_SIZE 0x10000
 
+//
+// Define the number of entries in each image's symbol lookup cache. This must
+// be a power of two.
+//
+
+#define IM_SYMBOL_CACHE_SIZE 128
+
+//
+// Define the initial number of records in a relocation log.
+//
+
+#define IM_INITIAL_RELOCATION_LOG_SIZE 256
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
 
+/*++
+
+Structure Description:
+
+    This structure stores a symbol that was recently resolved through an
+    image's scope. Entries are written by whoever resolves a symbol, which may
+    be several threads at once, so each entry is guarded by a sequence number
+    that is odd while the entry is being written.
+
+Members:
+
+    Sequence - Stores the sequence number of the entry.
+
+    Generation - Stores the scope generation the entry was written in. The
+        entry is stale if this doesn't match the current generation.
+
+    Hash - Stores the hash of the symbol name, as computed for the scope
+        owner's hash style.
+
+    Name - Stores a pointer to the symbol name, in the string table of the
+        image that exports it.
+
+    Symbol - Stores a pointer to the format specific symbol structure.
+
+    Image - Stores a pointer to the image that exports the symbol.
+
+--*/
+
+typedef struct _IM_SYMBOL_CACHE_ENTRY {
+    volatile ULONG Sequence;
+    ULONG Generation;
+    ULONG Hash;
+    PCSTR Name;
+    PVOID Symbol;
+    PLOADED_IMAGE Image;
+} IM_SYMBOL_CACHE_ENTRY, *PIM_SYMBOL_CACHE_ENTRY;
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -90,6 +140,13 @@ Module Name:
 
 extern PIM_IMPORT_TABLE ImImportTable;
 
+//
+// Store the scope generation number, which is incremented whenever a scope
+// shrinks or grows, invalidating every symbol cache entry.
+//
+
+extern volatile ULONG ImScopeGeneration;
+
 //
 // -------------------------------------------------------- Function Prototypes
 //
@@ -211,3 +268,110 @@ Return Value:
 
 --*/
 
+PVOID
+ImpLookupSymbolCache (
+    PLOADED_IMAGE ScopeImage,
+    ULONG Hash,
+    PCSTR SymbolName,
+    PLOADED_IMAGE *FoundImage
+    );
+
+/*++
+
+Routine Description:
+
+    This routine looks for a symbol in the cache of symbols resolved through
+    the given image's scope.
+
+Arguments:
+
+    ScopeImage - Supplies a pointer to the image whose scope was searched.
+
+    Hash - Supplies the hash of the symbol name.
+
+    SymbolName - Supplies a pointer to the name of the symbol.
+
+    FoundImage - Supplies a pointer where a pointer to the image exporting the
+        symbol will be returned on success.
+
+Return Value:
+
+    Returns a pointer to the format specific symbol on a cache hit.
+
+    NULL if the symbol is not in the cache.
+
+--*/
+
+VOID
+ImpInsertSymbolCache (
+    PLOADED_IMAGE ScopeImage,
+    ULONG Hash,
+    PCSTR Name,
+    PVOID Symbol,
+    PLOADED_IMAGE FoundImage
+    );
+
+/*++
+
+Routine Description:
+
+    This routine records a symbol resolved through the given image's scope.
+    If another thread is writing the same cache entry, the symbol is simply
+    not recorded.
+
+Arguments:
+
+    ScopeImage - Supplies a pointer to the image whose scope was searched.
+
+    Hash - Supplies the hash of the symbol name.
+
+    Name - Supplies a pointer to the symbol name. This must be the copy in the
+        exporting image's string table, since the caller's copy may not last.
+
+    Symbol - Supplies a pointer to the format specific symbol.
+
+    FoundImage - Supplies a pointer to the image exporting the symbol.
+
+Return Value:
+
+    None.
+
+--*/
+
+VOID
+ImpRecordRelocation (
+    PIMAGE_RELOCATION_LOG Log,
+    IMAGE_RELOCATION_RECORD_TYPE Type,
+    PVOID Place,
+    ULONGLONG Value,
+    ULONG Size
+    );
+
+/*++
+
+Routine Description:
+
+    This routine appends a record to a relocation log, growing the log if
+    needed. If the log cannot be grown, its status is set to a failing code
+    and the record is dropped.
+
+Arguments:
+
+    Log - Supplies a pointer to the relocation log.
+
+    Type - Supplies the type of record to append.
+
+    Place - Supplies the address that was modified, or the base of the image
+        for image records.
+
+    Value - Supplies the value written, the address copied from, or the size
+        of the image, depending on the record type.
+
+    Size - Supplies the number of bytes copied for copy records.
+
+Return Value:
+
+    None.
+
+--*/
+
@@ -333,7 +333,8 @@ Return Value:
 
 KSTATUS
 ImpRelocateImages (
-    PLIST_ENTRY ListHead
+    PLIST_ENTRY ListHead,
+    PIMAGE_RELOCATION_LOG Log
     )
 
 /*++
@@ -348,6 +349,65 @@ Routine Description:
     ListHead - Supplies a pointer to the head of the list of loaded images to
         apply relocations for.
 
+    Log - Supplies an optional pointer to a relocation log to record the
+        modifications made into.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    PLOADED_IMAGE FirstImage;
+    KSTATUS Status;
+
+    FirstImage = LIST_VALUE(ListHead->Next, LOADED_IMAGE, ListEntry);
+    switch (FirstImage->Format) {
+    case ImagePe32:
+        Status = STATUS_SUCCESS;
+        break;
+
+    case ImageElf32:
+        Status = ImpElf32RelocateImages(ListHead, Log);
+        break;
+
+    case ImageElf64:
+        Status = ImpElf64RelocateImages(ListHead, Log);
+        break;
+
+    default:
+
+        ASSERT(FALSE);
+
+        Status = STATUS_FILE_CORRUPT;
+        break;
+    }
+
+    return Status;
+}
+
+KSTATUS
+ImpReplayRelocationLog (
+    PLIST_ENTRY ListHead,
+    PIMAGE_RELOCATION_LOG Log
+    )
+
+/*++
+
+Routine Description:
+
+    This routine relocates all images that have not yet been relocated on the
+    given list by replaying a previously recorded relocation log.
+
+Arguments:
+
+    ListHead - Supplies a pointer to the head of the list of loaded images to
+        apply relocations for.
+
+    Log - Supplies a pointer to the relocation log to replay.
+
 Return Value:
 
     Status code.
@@ -366,11 +426,11 @@ Return Value:
         break;
 
     case ImageElf32:
-        Status = ImpElf32RelocateImages(ListHead);
+        Status = ImpElf32ReplayRelocationLog(ListHead, Log);
         break;
 
     case ImageElf64:
-        Status = ImpElf64RelocateImages(ListHead);
+        Status = ImpElf64ReplayRelocationLog(ListHead, Log);
         break;
 
     default: